@@ -0,0 +1,136 @@
+/*!
+* @file ICryptBackend.h
+*
+* @brief This file defines the interface of the cipher backend used by SdkCrypt.
+*
+* Copyright (C) 2011, LZT Corporation.
+*
+* @author Li Hong
+* @date 2011/06/14
+*/
+
+#ifdef __cplusplus
+#ifndef _ICRYPTBACKEND_H_
+#define _ICRYPTBACKEND_H_
+
+#ifdef _WIN32
+#include "SdkCryptDef.h"
+#else
+// The portable backend does not use Windows, the other platforms (e.g. the benchmark on
+// Linux) only need these types.
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+typedef uint8_t         BYTE;
+typedef uint8_t        *PBYTE;
+typedef uint32_t        DWORD;
+typedef uint32_t        UINT32;
+typedef uint64_t        UINT64;
+typedef unsigned int    UINT;
+typedef int             BOOL;
+typedef const char     *LPCTSTR;
+#ifndef TRUE
+#define TRUE            1
+#define FALSE           0
+#endif // TRUE
+#define IN
+#define OUT
+#define CLASS_DECLSPEC
+#define DECLSPEC_NOVTABLE
+#define __stdcall
+#define _T(x)           x
+#define ZeroMemory(p, n)    memset((p), 0, (n))
+
+// The compiler can not drop these writes, the same as SecureZeroMemory on Windows.
+static inline void* SecureZeroMemory(void *ptr, size_t cnt)
+{
+    volatile BYTE *pb = (volatile BYTE*)ptr;
+    while (cnt--)
+    {
+        *pb++ = 0;
+    }
+    return ptr;
+}
+#endif // _WIN32
+#include "SdkCommonMacro.h"
+
+BEGIN_NAMESPACE_COMMON
+
+/*!
+* @brief The interface of the cipher backend. A backend implements AES in CBC mode
+*        with PKCS#5 padding on the last section, the output must be the same as the
+*        CryptoAPI key which is used by SdkCrypt, so the encrypted files are compatible
+*        whatever backend is used.
+*/
+class DECLSPEC_NOVTABLE ICryptBackend
+{
+public:
+
+    /*!
+    * @brief The destructor function.
+    */
+    virtual ~ICryptBackend() {}
+
+    /*!
+    * @brief Set the initialization vector, this also restarts the cipher chain.
+    *
+    * @param pbIV           [I/ ] The IV buffer, 16 bytes.
+    *
+    * @return TRUE if succeeds, otherwise return FALSE.
+    */
+    virtual BOOL SetIV(IN const BYTE *pbIV) = 0;
+
+    /*!
+    * @brief Encrypt the data in place.
+    *
+    * @param pbData         [I/O] The data buffer.
+    * @param pdwDataLen     [I/O] The data length to encrypt, receives the encrypted length.
+    * @param dwBufLen       [I/ ] The buffer size, in bytes.
+    * @param isFinal        [I/ ] Indicates whether the buffer is the last section, the last
+    *                             section is padded and the chain restarts from the IV.
+    *
+    * @return TRUE if succeeds, otherwise return FALSE.
+    */
+    virtual BOOL Encrypt(IN OUT PBYTE pbData, IN OUT DWORD *pdwDataLen, IN DWORD dwBufLen, IN BOOL isFinal) = 0;
+
+    /*!
+    * @brief Decrypt the data in place.
+    *
+    * @param pbData         [I/O] The data buffer.
+    * @param pdwDataLen     [I/O] The data length to decrypt, receives the decrypted length.
+    * @param isFinal        [I/ ] Indicates whether the buffer is the last section, the padding
+    *                             of the last section is checked and removed.
+    *
+    * @return TRUE if succeeds, otherwise return FALSE.
+    */
+    virtual BOOL Decrypt(IN OUT PBYTE pbData, IN OUT DWORD *pdwDataLen, IN BOOL isFinal) = 0;
+
+    /*!
+    * @brief Encrypt one block without chaining, the cipher chain is not changed.
+    *
+    * @param pbIn           [I/ ] The input block, 16 bytes.
+    * @param pbOut          [ /O] The output block, 16 bytes, it can be the same as pbIn.
+    *
+    * @return TRUE if succeeds, otherwise return FALSE.
+    */
+    virtual BOOL EncryptBlock(IN const BYTE *pbIn, OUT BYTE *pbOut) = 0;
+
+    /*!
+    * @brief Create a new backend with the same key and IV, the chain state is not shared.
+    *
+    * @return The new backend, you should delete the memory. NULL if fails.
+    */
+    virtual ICryptBackend* Clone() = 0;
+
+    /*!
+    * @brief Get the name of the backend.
+    *
+    * @return The backend name.
+    */
+    virtual LPCTSTR GetName() const = 0;
+};
+
+END_NAMESPACE_COMMON
+
+#endif // _ICRYPTBACKEND_H_
+#endif // __cplusplus
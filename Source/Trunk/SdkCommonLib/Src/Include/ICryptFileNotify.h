@@ -67,6 +67,8 @@ public:
     *
     * @param pResult     [ /O] One value of CRYPT_INQUIRE_RESULT.
     * @param lpFilePath  [I/ ] Current conflicted file name.
+    *
+    * @remark It is called on the thread which calls BeginCrypt, also in the batch crypt mode.
     */
     virtual void OnReplaceFiles(OUT CRYPT_INQUIRE_RESULT *pResult, IN LPCTSTR lpFileName) = 0;
 };
@@ -0,0 +1,74 @@
+/*!
+* @file IImageDecodeNotify.h
+*
+* @brief This file defines class IImageDecodeNotify, which is notified when an image is decoded
+*        by SdkImageDecodeService.
+*
+* Copyright (C) 2011, LZT Corporation.
+*
+* @author Li Hong
+* @date 2011/06/30
+*/
+
+#ifdef __cplusplus
+#ifndef _IIMAGEDECODENOTIFY_H_
+#define _IIMAGEDECODENOTIFY_H_
+
+#include "SdkCommon.h"
+#include "SdkCommonMacro.h"
+
+BEGIN_NAMESPACE_UTILITIES
+
+/*!
+* @brief The priority of the decode request, the smaller value is decoded first.
+*/
+typedef enum _IMAGE_DECODE_PRIORITY
+{
+    IMAGE_DECODE_PRIORITY_VISIBLE   = 0,        // The image is shown now.
+    IMAGE_DECODE_PRIORITY_NEARBY    = 1,        // The image will be shown soon, such as the next page.
+    IMAGE_DECODE_PRIORITY_PREFETCH  = 2,        // The image may be shown later.
+
+} IMAGE_DECODE_PRIORITY;
+
+/*!
+* @brief The result of the decode request.
+*/
+typedef struct _IMAGEDECODERESULT
+{
+    DWORD           dwRequestId;                // The request id returned by DecodeFile.
+    LPCWSTR         lpFile;                     // The image file path.
+    HRESULT         hrDecode;                   // S_OK if the image is decoded.
+    UINT            uFrameCount;                // The number of frames of the image file.
+    IWICBitmap     *pBitmap;                    // The first frame in 32bppPBGRA, NULL if fails, add a reference to keep it.
+    UINT32          uWidth;                     // The width of the full image, the preview should be drawn in it.
+    UINT32          uHeight;                    // The height of the full image.
+    BOOL            isPreview;                  // The bitmap is a reduced preview, the full image follows.
+
+} IMAGEDECODERESULT, *LPIMAGEDECODERESULT;
+
+/*!
+* @brief The IImageDecodeNotify class.
+*/
+class CLASS_DECLSPEC IImageDecodeNotify
+{
+public:
+
+    /*!
+    * @brief The destructor function.
+    */
+    virtual ~IImageDecodeNotify() {};
+
+    /*!
+    * @brief Called in the thread which initializes SdkImageDecodeService when a request is
+    *        finished, it is not called for the cancelled requests. A progressive request may
+    *        be notified with a preview first, and then with the full image.
+    *
+    * @param lpResult           [I/ ] The result of the request, it is valid only in this call.
+    */
+    virtual void OnImageDecoded(IN const IMAGEDECODERESULT *lpResult) = 0;
+};
+
+END_NAMESPACE_UTILITIES
+
+#endif // _IIMAGEDECODENOTIFY_H_
+#endif // __cplusplus
@@ -0,0 +1,145 @@
+/*!
+* @file SdkAesCipher.h
+*
+* @brief This file defines SdkAesCipher class, the portable AES cipher backend.
+*
+* Copyright (C) 2011, LZT Corporation.
+*
+* @author Li Hong
+* @date 2011/06/14
+*/
+
+#ifdef __cplusplus
+#ifndef _SDKAESCIPHER_H_
+#define _SDKAESCIPHER_H_
+
+#include "ICryptBackend.h"
+
+BEGIN_NAMESPACE_COMMON
+
+#define AES_BLOCK_SIZE                          16      // The AES block size.
+#define AES_MAX_ROUNDS                          14      // The rounds of AES-256.
+
+/*!
+* @brief This class implements AES in CBC mode without CryptoAPI. It uses the AES
+*        instructions (AES-NI on x86/x64, the crypto extension on ARMv8) when the
+*        processor supports them, otherwise it uses a table-free bitsliced implementation
+*        which runs in constant time.
+*/
+class CLASS_DECLSPEC SdkAesCipher : public ICryptBackend
+{
+public:
+
+    /*!
+    * @brief Indicates whether the processor supports the AES instructions.
+    *
+    * @return TRUE if supports, otherwise FALSE.
+    */
+    static BOOL IsHardwareSupported();
+
+    /*!
+    * @brief The constructor function.
+    *
+    * @param pbKey          [I/ ] The raw key.
+    * @param dwKeySize      [I/ ] The key size, 16, 24 or 32 bytes.
+    * @param isUseHardware  [I/ ] Use the AES instructions if the processor supports them.
+    */
+    SdkAesCipher(IN const BYTE *pbKey, IN DWORD dwKeySize, IN BOOL isUseHardware = TRUE);
+
+    /*!
+    * @brief The destructor function, the round keys are wiped.
+    */
+    virtual ~SdkAesCipher();
+
+    /*!
+    * @brief Indicates whether the key is valid.
+    *
+    * @return TRUE if valid, otherwise FALSE.
+    */
+    BOOL IsValid() const;
+
+    /*!
+    * @brief Indicates whether the AES instructions are used.
+    *
+    * @return TRUE if used, otherwise FALSE.
+    */
+    BOOL IsUseHardware() const;
+
+    /*!
+    * @brief Encrypt the blocks in CBC mode, the chain is continued.
+    *
+    * @param pbData         [I/O] The data buffer.
+    * @param dwBlocks       [I/ ] The number of blocks.
+    */
+    void EncryptBlocksCBC(IN OUT PBYTE pbData, IN DWORD dwBlocks);
+
+    /*!
+    * @brief Decrypt the blocks in CBC mode, the chain is continued.
+    *
+    * @param pbData         [I/O] The data buffer.
+    * @param dwBlocks       [I/ ] The number of blocks.
+    */
+    void DecryptBlocksCBC(IN OUT PBYTE pbData, IN DWORD dwBlocks);
+
+    /*!
+    * @brief Encrypt the independent blocks, used by the counter mode.
+    *
+    * @param pbIn           [I/ ] The input blocks.
+    * @param pbOut          [ /O] The output blocks, it can be the same as pbIn.
+    * @param dwBlocks       [I/ ] The number of blocks.
+    */
+    void EncryptBlocksECB(IN const BYTE *pbIn, OUT PBYTE pbOut, IN DWORD dwBlocks) const;
+
+    // ICryptBackend
+    virtual BOOL SetIV(IN const BYTE *pbIV);
+    virtual BOOL Encrypt(IN OUT PBYTE pbData, IN OUT DWORD *pdwDataLen, IN DWORD dwBufLen, IN BOOL isFinal);
+    virtual BOOL Decrypt(IN OUT PBYTE pbData, IN OUT DWORD *pdwDataLen, IN BOOL isFinal);
+    virtual BOOL EncryptBlock(IN const BYTE *pbIn, OUT BYTE *pbOut);
+    virtual ICryptBackend* Clone();
+    virtual LPCTSTR GetName() const;
+
+private:
+
+    /*!
+    * @brief The copy constructor function, the key and the IV are copied.
+    */
+    SdkAesCipher(IN const SdkAesCipher& srcCipher);
+
+    /*!
+    * @brief [=] override
+    */
+    SdkAesCipher& operator = (const SdkAesCipher& rightVal);
+
+    /*!
+    * @brief Expand the key to the round keys.
+    *
+    * @param pbKey          [I/ ] The raw key.
+    * @param dwKeySize      [I/ ] The key size, 16, 24 or 32 bytes.
+    */
+    void ExpandKey(IN const BYTE *pbKey, IN DWORD dwKeySize);
+
+    /*!
+    * @brief Encrypt one block by software.
+    */
+    void EncryptBlockSoft(IN const BYTE *pbIn, OUT BYTE *pbOut) const;
+
+    /*!
+    * @brief Decrypt one block by software.
+    */
+    void DecryptBlockSoft(IN const BYTE *pbIn, OUT BYTE *pbOut) const;
+
+private:
+
+    BOOL        m_isValid;                                          // The key is valid or not.
+    BOOL        m_isUseHardware;                                    // Use AES instructions or not.
+    DWORD       m_dwRounds;                                         // The number of rounds.
+    BYTE        m_cbEncKeys[(AES_MAX_ROUNDS + 1) * AES_BLOCK_SIZE]; // The encryption round keys.
+    BYTE        m_cbDecKeys[(AES_MAX_ROUNDS + 1) * AES_BLOCK_SIZE]; // The equivalent inverse cipher round keys.
+    BYTE        m_cbIV[AES_BLOCK_SIZE];                             // The initialization vector.
+    BYTE        m_cbChain[AES_BLOCK_SIZE];                          // The current chain block.
+};
+
+END_NAMESPACE_COMMON
+
+#endif // _SDKAESCIPHER_H_
+#endif // __cplusplus
@@ -0,0 +1,125 @@
+/*!
+* @file SdkAesGcm.h
+*
+* @brief This file defines SdkAesGcm class, the AES-GCM authenticated cipher.
+*
+* Copyright (C) 2011, LZT Corporation.
+*
+* @author Li Hong
+* @date 2011/06/18
+*/
+
+#ifdef __cplusplus
+#ifndef _SDKAESGCM_H_
+#define _SDKAESGCM_H_
+
+#include "SdkAesCipher.h"
+
+BEGIN_NAMESPACE_COMMON
+
+#define AES_GCM_IV_SIZE                         12      // The GCM IV size.
+#define AES_GCM_TAG_SIZE                        16      // The GCM tag size.
+
+/*!
+* @brief This class implements AES-GCM. The GHASH uses the carry-less multiply
+*        instruction (PCLMULQDQ) when the processor supports it, otherwise it uses
+*        a constant-time software multiply. The object has no state after it is
+*        constructed, so it can be shared by several threads.
+*/
+class CLASS_DECLSPEC SdkAesGcm
+{
+public:
+
+    /*!
+    * @brief Indicates whether the processor supports the AES and carry-less multiply instructions.
+    *
+    * @return TRUE if supports, otherwise FALSE.
+    */
+    static BOOL IsHardwareSupported();
+
+    /*!
+    * @brief The constructor function.
+    *
+    * @param pbKey          [I/ ] The raw key.
+    * @param dwKeySize      [I/ ] The key size, 16, 24 or 32 bytes.
+    * @param isUseHardware  [I/ ] Use the processor instructions if they are supported.
+    */
+    SdkAesGcm(IN const BYTE *pbKey, IN DWORD dwKeySize, IN BOOL isUseHardware = TRUE);
+
+    /*!
+    * @brief The destructor function.
+    */
+    ~SdkAesGcm();
+
+    /*!
+    * @brief Indicates whether the key is valid.
+    *
+    * @return TRUE if valid, otherwise FALSE.
+    */
+    BOOL IsValid() const;
+
+    /*!
+    * @brief Encrypt the data in place and compute the tag.
+    *
+    * @param pbIV           [I/ ] The IV, AES_GCM_IV_SIZE bytes, must not be reused with the same key.
+    * @param pbAad          [I/ ] The additional authenticated data, can be NULL.
+    * @param dwAadLen       [I/ ] The additional authenticated data size.
+    * @param pbData         [I/O] The data buffer.
+    * @param dwDataLen      [I/ ] The data size, in bytes.
+    * @param pbTag          [ /O] The tag buffer, AES_GCM_TAG_SIZE bytes.
+    *
+    * @return TRUE if succeeds, otherwise return FALSE.
+    */
+    BOOL Seal(IN const BYTE *pbIV, IN const BYTE *pbAad, IN DWORD dwAadLen,
+              IN OUT PBYTE pbData, IN DWORD dwDataLen, OUT PBYTE pbTag) const;
+
+    /*!
+    * @brief Verify the tag and decrypt the data in place. The tag is verified before
+    *        decrypting, the data is not changed if the verification fails.
+    *
+    * @param pbIV           [I/ ] The IV, AES_GCM_IV_SIZE bytes.
+    * @param pbAad          [I/ ] The additional authenticated data, can be NULL.
+    * @param dwAadLen       [I/ ] The additional authenticated data size.
+    * @param pbData         [I/O] The data buffer.
+    * @param dwDataLen      [I/ ] The data size, in bytes.
+    * @param pbTag          [I/ ] The tag, AES_GCM_TAG_SIZE bytes.
+    *
+    * @return TRUE if the tag is valid, otherwise return FALSE.
+    */
+    BOOL Open(IN const BYTE *pbIV, IN const BYTE *pbAad, IN DWORD dwAadLen,
+              IN OUT PBYTE pbData, IN DWORD dwDataLen, IN const BYTE *pbTag) const;
+
+private:
+
+    /*!
+    * @brief The copy constructor function.
+    */
+    SdkAesGcm(IN const SdkAesGcm& srcGcm);
+
+    /*!
+    * @brief [=] override
+    */
+    SdkAesGcm& operator = (const SdkAesGcm& rightVal);
+
+    /*!
+    * @brief Compute the tag of the additional data and the encrypted data.
+    */
+    void ComputeTag(IN const BYTE *pbJ0, IN const BYTE *pbAad, IN DWORD dwAadLen,
+                    IN const BYTE *pbData, IN DWORD dwDataLen, OUT PBYTE pbTag) const;
+
+    /*!
+    * @brief Encrypt or decrypt the data in counter mode, the counter starts after J0.
+    */
+    void CryptCTR(IN const BYTE *pbJ0, IN OUT PBYTE pbData, IN DWORD dwDataLen) const;
+
+private:
+
+    BOOL            m_isUseClmul;           // Use the carry-less multiply instruction or not.
+    SdkAesCipher   *m_pAesCipher;           // The block cipher.
+    BYTE            m_cbH[AES_BLOCK_SIZE];  // The hash subkey.
+};
+
+END_NAMESPACE_COMMON
+
+#endif // _SDKAESGCM_H_
+#endif // __cplusplus
@@ -0,0 +1,119 @@
+/*!
+* @file SdkBase64Stream.h
+*
+* @brief This file defines SdkBase64Stream class to encode and decode Base64 data piece by piece.
+*
+* Copyright (C) 2011, LZT Corporation.
+*
+* @author Li Hong
+* @date 2011/06/28
+*/
+
+#ifdef __cplusplus
+#ifndef _SDKBASE64STREAM_H_
+#define _SDKBASE64STREAM_H_
+
+#include "SdkBase64Util.h"
+
+BEGIN_NAMESPACE_UTILITIES
+
+#define BASE64_STREAM_FINISH_SIZE       4       // The max number of bytes written by Finish.
+
+/*!
+* @brief This class encodes or decodes the data which is fed in pieces of any size, the
+*        partial group of the last piece is kept until the next piece comes. The result
+*        is the same as SdkBase64Util encodes or decodes the whole data once, so a big
+*        data can be converted with a fixed buffer.
+*
+* @remark The kept bytes are wiped when the stream finishes or is deleted.
+*/
+class CLASS_DECLSPEC SdkBase64Stream
+{
+public:
+
+    /*!
+    * @brief The constructor function.
+    *
+    * @param isEncode   [I/ ] TRUE to encode the data, FALSE to decode the characters.
+    */
+    SdkBase64Stream(IN BOOL isEncode);
+
+    /*!
+    * @brief The destructor function.
+    */
+    ~SdkBase64Stream();
+
+    /*!
+    * @brief Discard the kept bytes and the error, the stream can be used for new data.
+    */
+    void Reset();
+
+    /*!
+    * @brief Get the max number of bytes written by Feed.
+    *
+    * @param inlen      [I/ ] The size of the piece to feed.
+    *
+    * @return The size of the output buffer which Feed needs.
+    */
+    size_t GetOutputSize(IN size_t inlen) const;
+
+    /*!
+    * @brief Encode or decode a piece of data.
+    *
+    * @param in         [I/ ] The piece of data.
+    * @param inlen      [I/ ] The size of the piece.
+    * @param out        [ /O] The output buffer, it is not terminated by zero.
+    * @param outlen     [I/O] The size of the output buffer, receives the number of bytes written.
+    *
+    * @return TRUE if succeeds, FALSE if the output buffer is too small or the characters
+    *         are not valid. The stream keeps failing after an invalid character until Reset.
+    */
+    BOOL Feed(IN const char* in, size_t inlen, OUT char* out, IN OUT size_t* outlen);
+
+    /*!
+    * @brief Write the kept partial group and reset the stream.
+    *
+    * @param out        [ /O] The output buffer, BASE64_STREAM_FINISH_SIZE bytes are enough.
+    * @param outlen     [I/O] The size of the output buffer, receives the number of bytes written.
+    *
+    * @return TRUE if succeeds, FALSE if the data is not valid or the output buffer is too small.
+    */
+    BOOL Finish(OUT char* out, IN OUT size_t* outlen);
+
+private:
+
+    /*!
+    * @brief The copy constructor function.
+    */
+    SdkBase64Stream(IN const SdkBase64Stream& srcStream);
+
+    /*!
+    * @brief [=] override
+    */
+    SdkBase64Stream& operator = (const SdkBase64Stream& rightVal);
+
+    /*!
+    * @brief Decode the whole groups, the padded group must be the last one of the stream.
+    *
+    * @param in         [I/ ] The characters, the size is the multiple of 4.
+    * @param inlen      [I/ ] The number of characters.
+    * @param out        [ /O] The output buffer, it is big enough.
+    * @param outlen     [ /O] The number of bytes written.
+    *
+    * @return TRUE if succeeds, FALSE if the characters are not valid.
+    */
+    BOOL DecodeGroups(IN const char* in, size_t inlen, OUT char* out, OUT size_t* outlen);
+
+private:
+
+    BOOL        m_isEncode;         // Encode or decode.
+    BOOL        m_isPadded;         // The padded group is decoded, no more characters are allowed.
+    BOOL        m_isFailed;         // An invalid character is found.
+    size_t      m_nKeptSize;        // The number of kept bytes.
+    char        m_szKept[4];        // The partial group of the last piece.
+};
+
+END_NAMESPACE_UTILITIES
+
+#endif // _SDKBASE64STREAM_H_
+#endif // __cplusplus
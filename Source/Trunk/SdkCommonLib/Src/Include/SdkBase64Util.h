@@ -20,8 +20,17 @@ BEGIN_NAMESPACE_UTILITIES
 
 #define BASE64_LENGTH(inlen) ((((inlen) + 2) / 3) * 4)
 
+#define BASE64_SIMD_NONE                0       // The scalar code.
+#define BASE64_SIMD_SSSE3               1       // The SSSE3 instructions, 12 bytes each time.
+#define BASE64_SIMD_AVX2                2       // The AVX2 instructions, 24 bytes each time.
+#define BASE64_SIMD_NEON                3       // The ARMv8 NEON instructions, 48 bytes each time.
+
 /*!
 * @brief Encode binary data using printable characters
+*
+* @remark The alphabet uses '-' instead of '/', so the result can be used in a file name.
+*         The long data is encoded and decoded with the SIMD instructions which the
+*         processor supports, the result is the same as the scalar code.
 */
 class CLASS_DECLSPEC SdkBase64Util
 {
@@ -47,6 +56,50 @@ public:
     */
     static BOOL Decode (IN const char* in, size_t inlen, OUT char* out, size_t* outlen);
 
+    /*! 
+    * @brief Base64 encode the data, the output string has the exact size.
+    *
+    * @param strData    [I/ ] The data, it can contain the zero bytes.
+    *
+    * @return The encoded string.
+    */
+    static string Encode(IN const string& strData);
+
+    /*! 
+    * @brief Base64 decode the string, the output string has the exact size.
+    *
+    * @param strBase64  [I/ ] The encoded string.
+    * @param strData    [ /O] The decoded data.
+    *
+    * @return TRUE if the whole string is decoded, otherwise FALSE.
+    */
+    static BOOL Decode(IN const string& strBase64, OUT string& strData);
+
+    /*! 
+    * @brief The scalar implementation of Encode, it is the reference of the SIMD code.
+    */
+    static void EncodeScalar(IN const char* in, size_t inlen, OUT char* out, size_t outlen);
+
+    /*! 
+    * @brief The scalar implementation of Decode, it is the reference of the SIMD code.
+    */
+    static BOOL DecodeScalar(IN const char* in, size_t inlen, OUT char* out, size_t* outlen);
+
+    /*! 
+    * @brief Get the SIMD instructions which are used.
+    *
+    * @return One of the BASE64_SIMD_XXX values.
+    */
+    static UINT32 GetSimdLevel();
+
+    /*! 
+    * @brief Limit the SIMD instructions which are used, it is used to test and benchmark.
+    *
+    * @param nLevel     [I/ ] One of the BASE64_SIMD_XXX values, it is lowered to the best
+    *                         level which the processor supports.
+    */
+    static void SetSimdLevel(UINT32 nLevel);
+
 private:
 
     /*! 
@@ -59,11 +112,19 @@ private:
     */
     static BOOL Isbase64 (char ch);
 
+    /*! 
+    * @brief Get the best SIMD instructions which the processor supports.
+    *
+    * @return One of the BASE64_SIMD_XXX values.
+    */
+    static UINT32 GetSupportedSimdLevel();
+
 private:
 
     static const char m_b64[];      // With this approach this file works independent of the charset used
     static const char m_b64str[];   // A const string of this approach this file works 
                                     // independent of the charset used
+    static volatile LONG m_lSimdLevel;  // The SIMD instructions which are used, -1 is not detected.
 };
 
 END_NAMESPACE_UTILITIES
@@ -42,6 +42,8 @@ public:
     * @param nHeight        [I/ ] The height of thumbnail wanted to extract
     *
     * @return The handler of thumbnail
+    *
+    * @remark If SdkThumbnailStore is opened, the thumbnail is found in it first.
     */
     static HBITMAP ExtractFileThumbnail(IN LPCTSTR pszPath, UINT nWidth, UINT nHeight);
 
@@ -338,6 +340,8 @@ public:
     * @param nHeight    [I/ ] The height of icon wanted to extract
     *
     * @return The handle to bitmap.
+    *
+    * @remark If SdkThumbnailStore is opened, the bitmap of the file system item is found in it first.
     */
     static HBITMAP GetItemBitmap(IN LPCITEMIDLIST pidlItem, UINT nWidth, UINT nHeight);
 };
@@ -28,6 +28,7 @@
 #include "SdkDriversManager.h"
 #include "SdkCommandLineParser.h"
 #include "SdkSearchRecentUrl.h"
+#include "SdkThumbnailStore.h"
 #include "SdkFilePropKeyHelper.h"
 #include "SdkFilePropHelper.h"
 #include "SdkFilePropKey.h"
@@ -38,17 +39,28 @@
 #include "SdkUrlShortcutUtil.h"
 #include "SdkFilePropInfoProvider.h"
 #include "SdkFilePropDescription.h"
+#include "SdkGifDecoder.h"
+#include "SdkPixelKernels.h"
 #include "SdkWICAnimatedGif.h"
+#include "SdkWICImageCache.h"
 #include "SdkWICImageHelper.h"
+#include "SdkImageDecodeService.h"
 #include "SdkPreviewHandler.h"
 #include "SdkCrypt.h"
 #include "SdkCryptDef.h"
 #include "SdkCryptKey.h"
 #include "SdkCryptFile.h"
+#include "SdkCryptFileReader.h"
+#include "SdkCryptIoPipeline.h"
+#include "SdkCryptKeyCache.h"
+#include "SdkAesCipher.h"
+#include "SdkAesGcm.h"
 #include "SdkBase64Util.h"
+#include "SdkBase64Stream.h"
 #include "SdkUserInfoUtil.h"
 #include "SdkProgressDialog.h"
 #include "SdkImagesManager.h"
+#include "SdkImageBatchConverter.h"
 #include "SdkAssocHandler.h"
 #include "SdkKnownFolderUtil.h"
 #include "SdkCommonRunTime.h"
@@ -61,8 +73,10 @@
 
 #include "IConfigUtil.h"
 #include "ICryptFileNotify.h"
+#include "ICryptBackend.h"
 #include "IAudioVolumeNotify.h"
 #include "IFileSearcherNotify.h"
+#include "IImageDecodeNotify.h"
 #include "IDropTargetNotify.h"
 
 
@@ -17,11 +17,16 @@
 #include "SdkCommonMacro.h"
 #include "SdkCryptKey.h"
 #include "SdkCryptDef.h"
+#include "ICryptBackend.h"
 
 BEGIN_NAMESPACE_COMMON
 
 #define ENCRYPT_BLOCK_SIZE                      32      // The crypt block size.
 #define ENCRYPT_LAST_PART_VERIFYDATA_SIZE       16      // The last part size.
+#define ENCRYPT_IV_SIZE                         16      // The initialization vector size.
+#define ENCRYPT_DIGEST_SIZE                     32      // The SHA-256 digest size.
+
+class SdkAesGcm;
 
 /*!
 * @brief This class provides functions to encrypt and decrypt streams.
@@ -98,12 +103,120 @@ public:
     */
     CRYPT_RESULT GetCheckedCbSize(IN OUT DWORD *pdwCbSize, BOOL isFinal = TRUE);
 
+    /*!
+    * @brief Set the cipher backend. The output of all backends is the same, so this only
+    *        affects the speed. It can be called before or after the scene is initialized.
+    *
+    * @param backendType    [I/ ] The backend type, default is CRYPT_BACKEND_AUTO.
+    *
+    * @return The CRYPT_RESULT value.
+    *
+    * @remark The portable backend needs the raw key, so InitializeScene imports the key as
+    *         exportable unless CRYPT_BACKEND_CRYPTOAPI is set before. A key which is imported
+    *         for CryptoAPI is imported again when the portable backend is set later.
+    */
+    CRYPT_RESULT SetBackendType(IN CRYPT_BACKEND_TYPE backendType);
+
+    /*!
+    * @brief Get the name of the cipher backend in use.
+    *
+    * @return The backend name, empty string if the scene is not initialized.
+    */
+    LPCTSTR GetBackendName() const;
+
+    /*!
+    * @brief Create a new crypt object which shares the same key but owns its own
+    *        key handle, so that it can be used on another thread.
+    *
+    * @param ppCrypt        [ /O] The pointer to pointer to SdkCrypt class, you should delete the memory.
+    *
+    * @return The CRYPT_RESULT value.
+    */
+    CRYPT_RESULT DuplicateScene(OUT SdkCrypt **ppCrypt);
+
+    /*!
+    * @brief Set the initialization vector, this also restarts the cipher chain.
+    *
+    * @param pbIV           [I/ ] The IV buffer, ENCRYPT_IV_SIZE bytes. NULL means zero IV.
+    *
+    * @return The CRYPT_RESULT value.
+    */
+    CRYPT_RESULT SetStreamIV(IN const BYTE *pbIV = NULL);
+
+    /*!
+    * @brief Derive the initialization vector of a chunk, the IV is the encrypted
+    *        block of the file nonce combined with the chunk index.
+    *
+    * @param pbNonce        [I/ ] The file nonce, ENCRYPT_IV_SIZE bytes.
+    * @param nChunkIndex    [I/ ] The chunk index.
+    * @param pbIV           [ /O] The output IV buffer, ENCRYPT_IV_SIZE bytes.
+    *
+    * @return The CRYPT_RESULT value.
+    */
+    CRYPT_RESULT DeriveChunkIV(IN const BYTE *pbNonce, IN UINT64 nChunkIndex, OUT BYTE *pbIV);
+
+    /*!
+    * @brief Fill the buffer with cryptographically random bytes.
+    *
+    * @param pbBuffer       [ /O] The buffer to fill.
+    * @param dwSize         [I/ ] The buffer size, in bytes.
+    *
+    * @return The CRYPT_RESULT value.
+    */
+    CRYPT_RESULT GenerateRandom(OUT PBYTE pbBuffer, IN DWORD dwSize);
+
+    /*!
+    * @brief Compute the SHA-256 digest of the data.
+    *
+    * @param pbData         [I/ ] The data.
+    * @param dwSize         [I/ ] The data size, in bytes.
+    * @param pbDigest       [ /O] The digest buffer, ENCRYPT_DIGEST_SIZE bytes.
+    *
+    * @return The CRYPT_RESULT value.
+    */
+    CRYPT_RESULT ComputeDigest(IN const BYTE *pbData, IN DWORD dwSize, OUT PBYTE pbDigest);
+
+    /*!
+    * @brief Create the AES-GCM cipher to authenticate the data. The GCM key is derived
+    *        from the current key, so the same key is never used in two modes.
+    *
+    * @param ppAeadCipher   [ /O] The pointer to pointer to SdkAesGcm class, you should delete the memory.
+    *
+    * @return The CRYPT_RESULT value.
+    */
+    CRYPT_RESULT CreateAeadCipher(OUT SdkAesGcm **ppAeadCipher);
+
+private:
+
+    /*!
+    * @brief Create the cipher backend from the current key.
+    *
+    * @return The CRYPT_RESULT value.
+    */
+    CRYPT_RESULT CreateBackend();
+
+    /*!
+    * @brief Get the flags to import the key, the key is exportable only for the portable backend.
+    *
+    * @return CRYPT_EXPORTABLE or 0.
+    */
+    DWORD GetKeyImportFlags() const;
+
+    /*!
+    * @brief Whether the current key can be exported.
+    *
+    * @return TRUE if the key can be exported, otherwise FALSE.
+    */
+    BOOL IsKeyExportable() const;
+
 private:
 
     HCRYPTPROV          m_hCryptProvider;       // The handle to CSP.
     HCRYPTKEY           m_hCryptKey;            // The key to encrypt or decrypt.
     CRYPTKEYBLOBINFO    m_keyBlob;              // The key blob.
     CRYPTKEYBLOBINFO    m_xchgKeyBlob;          // The exchange key blob.
+    CRYPT_BACKEND_TYPE  m_backendType;          // The cipher backend type.
+    ICryptBackend      *m_pCryptBackend;        // The cipher backend.
 };
 
 END_NAMESPACE_COMMON
@@ -48,6 +48,19 @@ typedef enum _CRYPT_INQUIRE_RESULT
 } CRYPT_INQUIRE_RESULT;
 
 
+/*!
+* @brief The cipher backend type of SdkCrypt.
+*/
+typedef enum _CRYPT_BACKEND_TYPE
+{
+    CRYPT_BACKEND_AUTO              = 0x00,         // The portable backend, or CryptoAPI if the key can not be exported.
+    CRYPT_BACKEND_CRYPTOAPI         = 0x01,         // The CryptoAPI backend.
+    CRYPT_BACKEND_PORTABLE          = 0x02,         // The portable backend, uses AES instructions if available.
+    CRYPT_BACKEND_PORTABLE_SOFTWARE = 0x03,         // The portable backend, always uses the constant-time software.
+
+} CRYPT_BACKEND_TYPE;
+
+
 /*!
 * @brief The crypt error codes.
 */
@@ -26,6 +26,16 @@ BEGIN_NAMESPACE_COMMON
 typedef struct _CRYPTHEADER  CRYPTHEADER,  *LPCRYPTHEADER;
 typedef struct _DESTFILEINFO DESTFILEINFO, *LPDESTFILEINFO;
 typedef struct _FILEINFOS    FILEINFOS,    *LPFILEINFOS;
+typedef struct _CRYPTCHUNKINFO   CRYPTCHUNKINFO,   *LPCRYPTCHUNKINFO;
+typedef struct _CRYPTCHUNKTASK   CRYPTCHUNKTASK,   *LPCRYPTCHUNKTASK;
+typedef struct _CRYPTCHUNKWORKER CRYPTCHUNKWORKER, *LPCRYPTCHUNKWORKER;
+typedef struct _CRYPTJOURNAL     CRYPTJOURNAL,     *LPCRYPTJOURNAL;
+typedef struct _CRYPTBATCHTASK   CRYPTBATCHTASK,   *LPCRYPTBATCHTASK;
+typedef struct _CRYPTBATCHWORKER CRYPTBATCHWORKER, *LPCRYPTBATCHWORKER;
+typedef struct _CRYPTBATCHINQUIRY CRYPTBATCHINQUIRY, *LPCRYPTBATCHINQUIRY;
+
+class SdkCryptFileReader;
+class SdkCryptIoPipeline;
 
 /*!
 * @brief This class can encrypt and decrypt and preview files
@@ -122,6 +132,105 @@ public:
     */
     CRYPT_RESULT CancelCrypt();
 
+    /*!
+    * @brief Set the parallel crypt mode. In this mode the big files are split into
+    *        fixed size chunks which are encrypted or decrypted by several threads.
+    *
+    * @param isParallel     [I/ ] TRUE to encrypt big files in parallel chunks.
+    * @param nThreadCount   [I/ ] The number of crypt threads, 0 means the processor count.
+    *
+    * @return CRYPT_ERROR_SUCCEED is success, other values are failure.
+    *
+    * @remark The files encrypted in this mode can only be decrypted by this version or later,
+    *         the decryption detects the chunked files automatically.
+    */
+    CRYPT_RESULT SetParallelCrypt(IN BOOL isParallel, IN UINT32 nThreadCount = 0);
+
+    /*!
+    * @brief Set the authenticated crypt mode. In this mode the big files are encrypted
+    *        by AES-GCM in chunks, every chunk has its own tag, the decryption stops at the
+    *        first chunk which fails the verification and no partial output is kept. The
+    *        tags also cover the digest of the file header, so a modified header fails too.
+    *
+    * @param isAuthenticated    [I/ ] TRUE to encrypt big files with authenticated chunks.
+    *
+    * @return CRYPT_ERROR_SUCCEED is success, other values are failure.
+    *
+    * @remark The small files are not mapped, they still use the classic format. The
+    *         chunks are encrypted by one thread unless the parallel crypt mode is set.
+    */
+    CRYPT_RESULT SetAuthenticatedCrypt(IN BOOL isAuthenticated);
+
+    /*!
+    * @brief Set the in-place crypt mode. In this mode a big file is encrypted in its own
+    *        mapped pages instead of a new file, then it is renamed to the encrypted file.
+    *        The window which is being encrypted is saved in a journal file first, so an
+    *        interrupted encryption is resumed the next time the file is encrypted.
+    *
+    * @param isInPlace      [I/ ] TRUE to encrypt big files in place.
+    *
+    * @return CRYPT_ERROR_SUCCEED is success, other values are failure.
+    *
+    * @remark The mode is used only when the original files are deleted, and it is not
+    *         used together with the parallel or the authenticated crypt mode. The
+    *         encryption of a file can not be cancelled once it starts in this mode.
+    *         An interrupted file is resumed in any mode if its journal matches it, a
+    *         journal which does not match fails the file and nothing is changed.
+    */
+    CRYPT_RESULT SetInPlaceCrypt(IN BOOL isInPlace);
+
+    /*!
+    * @brief Set the asynchronous I/O mode of the small files. In this mode the blocks are
+    *        read and written on two I/O threads, the next block is read and the previous
+    *        block is written while the current block is encrypted or decrypted.
+    *
+    * @param isAsync        [I/ ] TRUE to read and write small files asynchronously, it is the default.
+    *
+    * @return CRYPT_ERROR_SUCCEED is success, other values are failure.
+    *
+    * @remark The encrypted files are the same as the synchronous mode. If the I/O threads
+    *         can not be created, the small files are processed synchronously.
+    */
+    CRYPT_RESULT SetAsyncIO(IN BOOL isAsync);
+
+    /*!
+    * @brief Set the batch crypt mode. In this mode several files are encrypted or decrypted
+    *        at the same time, each worker thread takes the next file when it finishes one.
+    *        The big files keep the format which the other modes select. The big files of the
+    *        stream format are taken by the workers first, the biggest one first. The big files
+    *        of the chunked format, which the parallel or authenticated mode selects, are
+    *        processed one by one after the workers, the chunks of each one are crypted by all
+    *        processors.
+    *
+    * @param isBatch        [I/ ] TRUE to crypt the files in batch.
+    * @param nThreadCount   [I/ ] The number of workers, 0 means the processor count.
+    * @param nIoDepth       [I/ ] The max number of files which are read and written at the
+    *                             same time, 0 means the default value. The number of workers
+    *                             is not bigger than it.
+    *
+    * @return CRYPT_ERROR_SUCCEED is success, other values are failure.
+    *
+    * @remark The progress of all files is reported by OnProgressChanged on the thread which
+    *         calls BeginCrypt, so do OnCryptNext and OnCryptError of the files of the workers,
+    *         which are reported in the order the workers take them. OnReplaceFiles is also called on that
+    *         thread, the worker which asks it waits for the answer.
+    */
+    CRYPT_RESULT SetBatchCrypt(IN BOOL isBatch, IN UINT32 nThreadCount = 0, IN UINT32 nIoDepth = 0);
+
+    /*!
+    * @brief Open an encrypted file to read the plain data at any position, the file
+    *        is not decrypted to the disk. The password and the key path must be set.
+    *
+    * @param lpFilePath     [I/ ] The path of the encrypted file.
+    * @param ppReader       [ /O] The pointer to pointer to SdkCryptFileReader class, you should delete the memory.
+    *
+    * @return CRYPT_ERROR_SUCCEED is success, other values are failure.
+    *
+    * @remark Only the files which use the chunked container can be opened, that is, the big
+    *         files which are encrypted in the parallel or the authenticated crypt mode.
+    */
+    CRYPT_RESULT OpenReader(IN LPCTSTR lpFilePath, OUT SdkCryptFileReader **ppReader);
+
     /*!
     * @brief Get the error string according to the result code.
     *
@@ -133,6 +242,9 @@ public:
 
 private:
 
+    // The reader reads the chunks by the private functions.
+    friend class SdkCryptFileReader;
+
     /*!
     * @brief Initialize the data for encrypting or decrypting
     *
@@ -180,6 +292,16 @@ private:
     */
     CRYPT_RESULT WriteCryptHeader(IN LPFILEINFOS lpDestFileInfos);
 
+    /*!
+    * @brief Compute the digest of the header and the chunk information of an authenticated
+    *        chunked file, every chunk authenticates it.
+    *
+    * @param lpFileInfos      [I/O] The file information, receives the digest.
+    *
+    * @return The operation result. CRYPT_ERROR_SUCCEED is OK, others are error.
+    */
+    CRYPT_RESULT ComputeHeaderDigest(IN OUT LPFILEINFOS lpFileInfos);
+
     /*!
     * @brief Check the header is valid or invalid
     *
@@ -189,6 +311,37 @@ private:
     */
     CRYPT_RESULT CheckCryptHeader(IN const CRYPTHEADER& cryptHeader);
 
+    /*!
+    * @brief Encrypt or decrypt one file of the file list and report the error.
+    *
+    * @param nIndex           [I/ ] The index of the file in the file list.
+    * @param operationType    [I/ ] The operation type.
+    */
+    void CryptFileByIndex(IN UINT32 nIndex, IN CRYPT_OP_TYPE operationType);
+
+    /*!
+    * @brief Encrypt or decrypt the file list in the batch crypt mode.
+    *
+    * @param operationType    [I/ ] The operation type.
+    */
+    void CryptBatchFiles(IN CRYPT_OP_TYPE operationType);
+
+    /*!
+    * @brief Create a worker which has the same settings and key as this object, it crypts
+    *        the small files on a batch thread.
+    *
+    * @param ppWorker         [ /O] The pointer to pointer to the worker, you should delete the memory.
+    *
+    * @return The operation result. CRYPT_ERROR_SUCCEED is OK, others are error.
+    */
+    CRYPT_RESULT CreateBatchWorker(OUT SdkCryptFile **ppWorker);
+
+    /*!
+    * @brief Answer the inquiries which the batch workers queue, it is called on the thread
+    *        which calls BeginCrypt.
+    */
+    void AnswerBatchInquiries();
+
     /*!
     * @brief Encrypt a file
     *
@@ -210,6 +363,83 @@ private:
     */
     CRYPT_RESULT EncryptSmallFile(IN LPFILEINFOS lpFileInfos);
 
+    /*!
+    * @brief Check the journal of the in-place mode which is next to the file.
+    *
+    * @param lpFileInfos      [I/ ] The reference of FILEINFOS, the file must be opened.
+    *
+    * @return CRYPT_ERROR_SUCCEED if the journal is written for the file and matches it, the
+    *         encryption is resumed from it. CRYPT_ERROR_FILE_NOT_FOUND if there is no journal
+    *         or it is written for another file, it is ignored. CRYPT_ERROR_INVALIDFILE if the
+    *         journal can not be read or does not match the file, the file may be encrypted in
+    *         part, so it is not changed.
+    */
+    CRYPT_RESULT CheckCryptJournal(IN LPFILEINFOS lpFileInfos);
+
+    /*!
+    * @brief Encrypt a big file in place and rename it to the encrypted file.
+    *
+    * @param lpFileInfos      [I/ ] The reference of FILEINFOS, the file must be closed.
+    * @param isResume         [I/ ] TRUE to resume the encryption from the journal which is
+    *                               checked by CheckCryptJournal, FALSE to start it.
+    *
+    * @return The operation result. CRYPT_ERROR_SUCCEED is OK, others are error.
+    *
+    * @remark The interrupted encryption is only rolled forward. The windows before the
+    *         journal are encrypted and the journal saves the plain data of one window only.
+    */
+    CRYPT_RESULT EncryptFileInPlace(IN LPFILEINFOS lpFileInfos, IN BOOL isResume);
+
+    /*!
+    * @brief Read the newest valid record of the journal.
+    *
+    * @param hJournal         [I/ ] The handle of the journal file.
+    * @param dwDataSize       [I/ ] The max size of the saved data.
+    * @param lpJournal        [ /O] The journal record.
+    * @param pbData           [ /O] The buffer to receive the saved data.
+    *
+    * @return TRUE if a valid record is read, otherwise FALSE.
+    */
+    static BOOL ReadCryptJournal(IN HANDLE hJournal, IN DWORD dwDataSize, OUT LPCRYPTJOURNAL lpJournal, OUT PBYTE pbData);
+
+    /*!
+    * @brief Write a journal record to the disk, the records are written to two slots
+    *        in turn so the last record is kept if the writing is interrupted.
+    *
+    * @param hJournal         [I/ ] The handle of the journal file.
+    * @param dwDataSize       [I/ ] The max size of the saved data.
+    * @param lpJournal        [I/O] The journal record, the checksum is updated.
+    * @param pbData           [I/ ] The saved data.
+    *
+    * @return TRUE if succeeds, otherwise FALSE.
+    */
+    static BOOL WriteCryptJournal(IN HANDLE hJournal, IN DWORD dwDataSize, IN OUT LPCRYPTJOURNAL lpJournal, IN const BYTE *pbData);
+
+    /*!
+    * @brief Check the journal is written for the file, the file ID, the size and the digest
+    *        of the region which is not written by the window in the journal must match.
+    *
+    * @param hFile            [I/ ] The handle of the file which is encrypted in place.
+    * @param lpJournal        [I/ ] The journal record.
+    * @param pIsOtherFile     [ /O] TRUE if the journal is written for another file, the ID of
+    *                               the file is not the same and the file is not extended.
+    *
+    * @return TRUE if the journal is written for the file, otherwise FALSE.
+    */
+    BOOL VerifyCryptJournal(IN HANDLE hFile, IN const CRYPTJOURNAL *lpJournal, OUT BOOL *pIsOtherFile = NULL);
+
+    /*!
+    * @brief Compute the digest of a region of the file.
+    *
+    * @param hFile            [I/ ] The handle of the file.
+    * @param nOffset          [I/ ] The offset of the region.
+    * @param dwSize           [I/ ] The size of the region.
+    * @param pbDigest         [ /O] The buffer of ENCRYPT_DIGEST_SIZE bytes to receive the digest.
+    *
+    * @return TRUE if succeeds, otherwise FALSE.
+    */
+    BOOL GetFileRegionDigest(IN HANDLE hFile, IN UINT64 nOffset, IN DWORD dwSize, OUT PBYTE pbDigest);
+
     /*!
     * @brief This file is big one, which size is bigger then CRITICAL_VALUE(10MB),
     *        in this function, will use the file mapping to operate the file,
@@ -252,6 +482,109 @@ private:
     */
     CRYPT_RESULT DecryptBigFile(IN LPFILEINFOS lpFileInfos);
 
+    /*!
+    * @brief Encrypt or decrypt the blocks of a small file by the I/O pipeline, the file
+    *        pointers of the source and destination files must be set.
+    *
+    * @param lpFileInfos      [I/ ] The reference of FILEINFOS, the file is not empty.
+    * @param isEncrypt        [I/ ] TRUE is encrypting, FALSE is decrypting.
+    *
+    * @return The operation result. CRYPT_ERROR_SUCCEED is OK, CRYPT_ERROR_OTHER if the
+    *         pipeline can not be used, others are error.
+    */
+    CRYPT_RESULT CryptSmallFileAsync(IN LPFILEINFOS lpFileInfos, IN BOOL isEncrypt);
+
+    /*!
+    * @brief Encrypt or decrypt a chunked file by several threads.
+    *
+    * @param lpFileInfos      [I/ ] The reference of FILEINFOS, the source and destination
+    *                               file mappings must be created.
+    * @param isEncrypt        [I/ ] TRUE is encrypting, FALSE is decrypting.
+    *
+    * @return The operation result. CRYPT_ERROR_SUCCEED is OK, others are error.
+    */
+    CRYPT_RESULT CryptChunkedFile(IN LPFILEINFOS lpFileInfos, IN BOOL isEncrypt);
+
+    /*!
+    * @brief Encrypt or decrypt one chunk of the chunked file.
+    *
+    * @param lpTask           [I/ ] The chunk task.
+    * @param pCrypt           [I/ ] The crypt object owned by the calling thread.
+    * @param pbBuffer         [I/ ] The work buffer owned by the calling thread.
+    * @param nChunkIndex      [I/ ] The chunk index.
+    *
+    * @return The operation result. CRYPT_ERROR_SUCCEED is OK, others are error.
+    */
+    static CRYPT_RESULT CryptChunk(IN LPCRYPTCHUNKTASK lpTask, IN SdkCrypt *pCrypt, IN PBYTE pbBuffer, IN UINT64 nChunkIndex);
+
+    /*!
+    * @brief Decrypt one chunk in the buffer.
+    *
+    * @param destFileInfo     [I/ ] The header and the chunk information of the file.
+    * @param pCrypt           [I/ ] The crypt object owned by the calling thread.
+    * @param pAeadCipher      [I/ ] The GCM cipher, only for authenticated chunks.
+    * @param nChunkIndex      [I/ ] The chunk index.
+    * @param pbBuffer         [I/O] The encrypted chunk, receives the plain data.
+    * @param dwPlainSize      [I/ ] The plain size of the chunk.
+    *
+    * @return CRYPT_ERROR_SUCCEED is success, CRYPT_ERROR_INVALIDFILE if the chunk is modified.
+    */
+    static CRYPT_RESULT DecryptChunkBuffer(IN const DESTFILEINFO& destFileInfo, IN SdkCrypt *pCrypt,
+                                           IN SdkAesGcm *pAeadCipher, IN UINT64 nChunkIndex,
+                                           IN OUT PBYTE pbBuffer, IN DWORD dwPlainSize);
+
+    /*!
+    * @brief Get the IV and the additional authenticated data of an authenticated chunk.
+    *
+    * @param destFileInfo     [I/ ] The header digest and the chunk information of the file.
+    * @param nChunkIndex      [I/ ] The chunk index.
+    * @param dwPlainSize      [I/ ] The plain size of the chunk.
+    * @param pbIV             [ /O] The IV buffer, AES_GCM_IV_SIZE bytes.
+    * @param pbAad            [ /O] The additional data buffer, CHUNK_AAD_SIZE bytes.
+    */
+    static void GetChunkAeadData(IN const DESTFILEINFO& destFileInfo, IN UINT64 nChunkIndex, IN DWORD dwPlainSize,
+                                 OUT PBYTE pbIV, OUT PBYTE pbAad);
+
+    /*!
+    * @brief Read and decrypt one chunk of the file which is opened by OpenReader.
+    *
+    * @param lpFileInfos      [I/ ] The file information of the reader.
+    * @param pCrypt           [I/ ] The crypt object of the reader.
+    * @param pAeadCipher      [I/ ] The GCM cipher of the reader, only for authenticated chunks.
+    * @param nChunkIndex      [I/ ] The chunk index.
+    * @param pbBuffer         [ /O] The buffer, it must hold the encrypted size of a full chunk.
+    * @param pdwPlainSize     [ /O] The plain size of the chunk.
+    *
+    * @return The operation result. CRYPT_ERROR_SUCCEED is OK, others are error.
+    */
+    static CRYPT_RESULT ReadChunk(IN LPFILEINFOS lpFileInfos, IN SdkCrypt *pCrypt, IN SdkAesGcm *pAeadCipher,
+                                  IN UINT64 nChunkIndex, OUT PBYTE pbBuffer, OUT DWORD *pdwPlainSize);
+
+    /*!
+    * @brief Close the file which is opened by OpenReader and free the file information.
+    *
+    * @param lpFileInfos      [I/ ] The file information of the reader.
+    */
+    static void CloseReaderFile(IN LPFILEINFOS lpFileInfos);
+
+    /*!
+    * @brief The thread procedure of chunk worker.
+    *
+    * @param lpParameter      [I/ ] The pointer to CRYPTCHUNKWORKER.
+    *
+    * @return Always 0.
+    */
+    static unsigned int WINAPI ChunkThreadProc(LPVOID lpParameter);
+
+    /*!
+    * @brief The thread procedure of batch worker.
+    *
+    * @param lpParameter      [I/ ] The pointer to CRYPTBATCHWORKER.
+    *
+    * @return Always 0.
+    */
+    static unsigned int WINAPI BatchThreadProc(LPVOID lpParameter);
+
     /*!
     * @brief Open a file and fill the FILEINFOS data structure.
     *
@@ -405,6 +738,14 @@ private:
 
     BOOL                    m_bDelOriginalFiles;        // Delete original files.
     BOOL                    m_hasCancelCrypt;           // Cancel crypt operation or not.
+    BOOL                    m_isParallelCrypt;          // Encrypt big files in parallel chunks.
+    UINT32                  m_nCryptThreads;            // The number of crypt threads, 0 is the processor count.
+    BOOL                    m_isAuthenticatedCrypt;     // Encrypt big files in authenticated chunks.
+    BOOL                    m_isInPlaceCrypt;           // Encrypt big files in place.
+    BOOL                    m_isAsyncIO;                // Read and write small files asynchronously.
+    BOOL                    m_isBatchCrypt;             // Crypt several files at the same time.
+    UINT32                  m_nBatchThreads;            // The number of batch workers, 0 is the processor count.
+    UINT32                  m_nBatchIoDepth;            // The max number of files in I/O at the same time.
     UINT32                  m_nFileNumbers;             // The numbers of files to be encrypted.
     UINT32                  m_nFileIndex;               // The index of already disposed files.
     DWORD                   m_dwAllocationGranularity;  // The system allocation granularity.
@@ -420,6 +761,11 @@ private:
     SdkCrypt               *m_pCrypt;                   // Pointer to the object of TFPUCrypt.
     ICryptFileNotify       *m_pCryptFileSink;           // The crypt sink.
     SdkProgressDialog      *m_pProgressDialog;          // The progress dialog.
+    SdkCryptIoPipeline     *m_pIoPipeline;              // The I/O pipeline of small files, created when it is used.
+    SdkCryptFile           *m_pBatchOwner;              // The object which creates this batch worker.
+    HANDLE                  m_hBatchMutex;              // Guards the queue of the inquiries of the batch workers.
+    HANDLE                  m_hBatchInquiry;            // Wakes up the owner when an inquiry is queued or a worker exits.
+    vector<LPCRYPTBATCHINQUIRY> m_vctBatchInquiries;    // The inquiries which are not answered.
 };
 
 END_NAMESPACE_COMMON
@@ -0,0 +1,120 @@
+/*!
+* @file SdkCryptFileReader.h
+*
+* @brief This file defines SdkCryptFileReader class to read the encrypted files at any position.
+*
+* Copyright (C) 2011, LZT Corporation.
+*
+* @author Li Hong
+* @date 2011/06/20
+*/
+
+#ifdef __cplusplus
+#ifndef _SDKCRYPTFILEREADER_H_
+#define _SDKCRYPTFILEREADER_H_
+
+#include "SdkCryptFile.h"
+
+BEGIN_NAMESPACE_COMMON
+
+typedef struct _CRYPTCHUNKCACHE  CRYPTCHUNKCACHE,  *LPCRYPTCHUNKCACHE;
+
+#define DEFAULT_READER_CACHE_CHUNKS             4       // The default number of cached chunks.
+
+/*!
+* @brief This class reads the plain data of a chunked encrypted file. Only the chunks
+*        which cover the requested range are decrypted, the recently used chunks are
+*        kept in a small LRU cache. The instance is created by SdkCryptFile::OpenReader.
+*
+* @remark One instance should be used by one thread at a time.
+*/
+class CLASS_DECLSPEC SdkCryptFileReader
+{
+public:
+
+    /*!
+    * @brief The destructor function, the cached plain data is wiped.
+    */
+    ~SdkCryptFileReader();
+
+    /*!
+    * @brief Get the plain data length of the file.
+    *
+    * @return The length, in bytes.
+    */
+    UINT64 GetLength() const;
+
+    /*!
+    * @brief Read the plain data.
+    *
+    * @param nOffset        [I/ ] The offset of the plain data.
+    * @param pbBuffer       [ /O] The buffer to receive the data.
+    * @param dwLength       [I/ ] The number of bytes to read.
+    * @param pdwBytesRead   [ /O] The number of bytes read, it is less than dwLength at the end of file, can be NULL.
+    *
+    * @return CRYPT_ERROR_SUCCEED is success, CRYPT_ERROR_INVALIDFILE if a chunk is modified,
+    *         other values are failure.
+    */
+    CRYPT_RESULT Read(IN UINT64 nOffset, OUT PBYTE pbBuffer, IN DWORD dwLength, OUT DWORD *pdwBytesRead = NULL);
+
+    /*!
+    * @brief Set the number of the decrypted chunks in the cache.
+    *
+    * @param nCacheChunks   [I/ ] The number of chunks, at least 1, the default is DEFAULT_READER_CACHE_CHUNKS.
+    *
+    * @return CRYPT_ERROR_SUCCEED is success, other values are failure.
+    */
+    CRYPT_RESULT SetCacheSize(IN UINT32 nCacheChunks);
+
+private:
+
+    friend class SdkCryptFile;
+
+    /*!
+    * @brief The constructor function, only SdkCryptFile creates the instance.
+    */
+    SdkCryptFileReader();
+
+    /*!
+    * @brief The copy constructor function.
+    */
+    SdkCryptFileReader(IN const SdkCryptFileReader& srcReader);
+
+    /*!
+    * @brief [=] override
+    */
+    SdkCryptFileReader& operator = (const SdkCryptFileReader& rightVal);
+
+    /*!
+    * @brief Get the decrypted chunk from the cache, the chunk is decrypted if it is not cached.
+    *
+    * @param nChunkIndex    [I/ ] The chunk index.
+    * @param pResult        [ /O] The operation result.
+    *
+    * @return The cached chunk, NULL if fails.
+    */
+    LPCRYPTCHUNKCACHE GetChunk(IN UINT64 nChunkIndex, OUT CRYPT_RESULT *pResult);
+
+    /*!
+    * @brief Wipe and free the cached chunks beyond the cache size.
+    *
+    * @param nCacheChunks   [I/ ] The number of chunks to keep.
+    */
+    void TrimCache(IN UINT32 nCacheChunks);
+
+private:
+
+    LPFILEINFOS                 m_lpFileInfos;      // The opened encrypted file.
+    SdkCrypt                   *m_pCrypt;           // The crypt object owned by this reader.
+    SdkAesGcm                  *m_pAeadCipher;      // The GCM cipher, only for authenticated chunks.
+    UINT64                      m_nDataLength;      // The plain data length.
+    DWORD                       m_dwChunkSize;      // The plain size of a chunk.
+    DWORD                       m_dwBufferSize;     // The buffer size of a chunk.
+    UINT32                      m_nCacheChunks;     // The max number of cached chunks.
+    vector<LPCRYPTCHUNKCACHE>   m_vctCache;         // The cached chunks, the most recently used is the first.
+};
+
+END_NAMESPACE_COMMON
+
+#endif // _SDKCRYPTFILEREADER_H_
+#endif // __cplusplus
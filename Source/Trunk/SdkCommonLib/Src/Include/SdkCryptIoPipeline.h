@@ -0,0 +1,192 @@
+/*!
+* @file SdkCryptIoPipeline.h
+*
+* @brief This file defines SdkCryptIoPipeline class to read and write the crypt blocks asynchronously.
+*
+* Copyright (C) 2011, LZT Corporation.
+*
+* @author Li Hong
+* @date 2011/06/24
+*/
+
+#ifdef __cplusplus
+#ifndef _SDKCRYPTIOPIPELINE_H_
+#define _SDKCRYPTIOPIPELINE_H_
+
+#include "SdkCryptDef.h"
+
+BEGIN_NAMESPACE_COMMON
+
+#define CRYPT_IO_BUFFER_COUNT                   3       // The default number of buffers, read, crypt and write.
+
+/*!
+* @brief This class reads the blocks of a file and writes them to another file on two
+*        I/O threads, the caller crypts the blocks in place between them. With three
+*        buffers the block N+1 is read and the block N-1 is written while the caller
+*        crypts the block N. The threads are kept for the next files until the instance
+*        is deleted.
+*
+* @remark The blocks are read and written at the current file pointers of the handles, the
+*         handles must not be used by others until the pipeline finishes.
+*/
+class CLASS_DECLSPEC SdkCryptIoPipeline
+{
+public:
+
+    /*!
+    * @brief The constructor function, the buffers and the I/O threads are created.
+    *
+    * @param dwBufferSize   [I/ ] The size of each buffer, it must hold the biggest block.
+    * @param nBufferCount   [I/ ] The number of buffers, at least 2.
+    */
+    SdkCryptIoPipeline(IN DWORD dwBufferSize, IN UINT32 nBufferCount = CRYPT_IO_BUFFER_COUNT);
+
+    /*!
+    * @brief The destructor function, the running blocks are aborted and the threads exit.
+    */
+    ~SdkCryptIoPipeline();
+
+    /*!
+    * @brief Indicates whether the buffers and the threads are created.
+    *
+    * @return TRUE if the pipeline can be used, otherwise FALSE.
+    */
+    BOOL IsValid() const;
+
+    /*!
+    * @brief Start to read the blocks of a file. All blocks except the last one have the same
+    *        size for reading and writing.
+    *
+    * @param hSrcFile           [I/ ] The file to read.
+    * @param hDestFile          [I/ ] The file to write.
+    * @param dwBlockSize        [I/ ] The size of the blocks except the last one.
+    * @param dwBlockCount       [I/ ] The number of blocks.
+    * @param dwLastReadSize     [I/ ] The number of bytes to read of the last block.
+    * @param dwLastWriteSize    [I/ ] The number of bytes to write of the last block.
+    *
+    * @return CRYPT_ERROR_SUCCEED is success, other values are failure.
+    */
+    CRYPT_RESULT Start(IN HANDLE hSrcFile, IN HANDLE hDestFile, IN DWORD dwBlockSize,
+                       IN DWORD dwBlockCount, IN DWORD dwLastReadSize, IN DWORD dwLastWriteSize);
+
+    /*!
+    * @brief Wait for the next block to be read. The bytes beyond the read data are zero.
+    *
+    * @param pdwBytesRead   [ /O] The number of bytes read.
+    *
+    * @return The buffer of the block, NULL if there is no more block or an I/O error occurs.
+    */
+    PBYTE AcquireBlock(OUT DWORD *pdwBytesRead);
+
+    /*!
+    * @brief Give the block got by AcquireBlock to the writer thread.
+    */
+    void ReleaseBlock();
+
+    /*!
+    * @brief Wait until the blocks are written.
+    *
+    * @param isAbort        [I/ ] TRUE to stop reading and writing the left blocks.
+    *
+    * @return CRYPT_ERROR_SUCCEED is success, CRYPT_ERROR_READDATA or CRYPT_ERROR_WRITEDATA
+    *         if an I/O error occurs.
+    */
+    CRYPT_RESULT Finish(IN BOOL isAbort);
+
+private:
+
+    /*!
+    * @brief The copy constructor function.
+    */
+    SdkCryptIoPipeline(IN const SdkCryptIoPipeline& srcPipeline);
+
+    /*!
+    * @brief [=] override
+    */
+    SdkCryptIoPipeline& operator = (const SdkCryptIoPipeline& rightVal);
+
+    /*!
+    * @brief The reader thread procedure.
+    *
+    * @param lpParameter    [I/ ] The pointer to SdkCryptIoPipeline.
+    */
+    static unsigned int WINAPI ReadThreadProc(LPVOID lpParameter);
+
+    /*!
+    * @brief The writer thread procedure.
+    *
+    * @param lpParameter    [I/ ] The pointer to SdkCryptIoPipeline.
+    */
+    static unsigned int WINAPI WriteThreadProc(LPVOID lpParameter);
+
+    /*!
+    * @brief Read the blocks of the current file.
+    */
+    void ReadBlocks();
+
+    /*!
+    * @brief Write the blocks of the current file.
+    */
+    void WriteBlocks();
+
+    /*!
+    * @brief Wait for the next job of a thread.
+    *
+    * @param hJobEvent      [I/ ] The job event of the thread.
+    *
+    * @return TRUE if there is a job, FALSE if the thread should exit.
+    */
+    BOOL WaitForJob(IN HANDLE hJobEvent);
+
+    /*!
+    * @brief Wait for a slot of the semaphore.
+    *
+    * @param hSemaphore     [I/ ] The semaphore.
+    *
+    * @return TRUE if the slot is got, FALSE if the blocks are aborted.
+    */
+    BOOL WaitForSlot(IN HANDLE hSemaphore);
+
+    /*!
+    * @brief Keep the first error and abort the blocks.
+    *
+    * @param nResult        [I/ ] The error code.
+    */
+    void SetError(IN CRYPT_RESULT nResult);
+
+    /*!
+    * @brief Close the semaphores of the last file.
+    */
+    void CloseSemaphores();
+
+private:
+
+    HANDLE          m_hReadThread;          // The reader thread.
+    HANDLE          m_hWriteThread;         // The writer thread.
+    HANDLE          m_hReadJob;             // Signaled when the reader has a new file.
+    HANDLE          m_hWriteJob;            // Signaled when the writer has a new file.
+    HANDLE          m_hReadDone;            // Signaled when the reader finishes a file.
+    HANDLE          m_hWriteDone;           // Signaled when the writer finishes a file.
+    HANDLE          m_hAbort;               // Signaled to abort the blocks of a file.
+    HANDLE          m_hQuit;                // Signaled to let the threads exit.
+    HANDLE          m_hFreeSlots;           // The count of free buffers.
+    HANDLE          m_hReadSlots;           // The count of read buffers.
+    HANDLE          m_hWriteSlots;          // The count of crypted buffers.
+    HANDLE          m_hSrcFile;             // The file to read.
+    HANDLE          m_hDestFile;            // The file to write.
+    DWORD           m_dwBufferSize;         // The size of each buffer.
+    DWORD           m_dwBlockSize;          // The size of the blocks except the last one.
+    DWORD           m_dwBlockCount;         // The number of blocks.
+    DWORD           m_dwLastReadSize;       // The number of bytes to read of the last block.
+    DWORD           m_dwLastWriteSize;      // The number of bytes to write of the last block.
+    DWORD           m_dwCryptIndex;         // The index of the block held by the caller.
+    BOOL            m_isRunning;            // A file is being processed or not.
+    volatile LONG   m_lResult;              // The first I/O error.
+    vector<PBYTE>   m_vctBuffers;           // The buffers.
+    vector<DWORD>   m_vctBytesRead;         // The number of bytes read of each buffer.
+};
+
+END_NAMESPACE_COMMON
+
+#endif // _SDKCRYPTIOPIPELINE_H_
+#endif // __cplusplus
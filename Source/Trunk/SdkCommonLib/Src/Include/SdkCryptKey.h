@@ -74,6 +74,26 @@ public:
     */
     BOOL LoadFromFile(IN LPCTSTR lpKeyFilePath, IN BOOL isLoadExchangeKey = FALSE);
 
+    /*! 
+    * @brief Export key to a text file, the data of SaveToFile is written as Base64 characters.
+    *
+    * @param lpKeyFilePath      [I/ ] The path of the text file.
+    * @param isSaveExchangeKey  [I/ ] Indicates whether export exchange key or not, default value is FALSE.
+    *
+    * @return TRUE if succeeds, otherwise return FALSE.
+    */
+    BOOL ExportToFile(IN LPCTSTR lpKeyFilePath, IN BOOL isSaveExchangeKey = FALSE) const;
+
+    /*! 
+    * @brief Import key from a text file written by ExportToFile.
+    *
+    * @param lpKeyFilePath      [I/ ] The path of the text file.
+    * @param isLoadExchangeKey  [I/ ] Indicates whether import exchange key or not, default value is FALSE.
+    *
+    * @return TRUE if succeeds, otherwise return FALSE.
+    */
+    BOOL ImportFromFile(IN LPCTSTR lpKeyFilePath, IN BOOL isLoadExchangeKey = FALSE);
+
     /*!
     * @brief Get the key blob information.
     *
@@ -107,6 +127,17 @@ private:
     */
     void ReleaseMemory();
 
+    /*! 
+    * @brief Read the key blob and the exchange key blob from the data of a key file.
+    *
+    * @param pbData             [I/ ] The data of the key file.
+    * @param dwDataSize         [I/ ] The size of the data.
+    * @param isLoadExchangeKey  [I/ ] Indicates whether load exchange key or not.
+    *
+    * @return TRUE if succeeds, otherwise return FALSE.
+    */
+    BOOL LoadFromData(IN const BYTE *pbData, IN DWORD dwDataSize, IN BOOL isLoadExchangeKey);
+
     /*! 
     * @brief Set the file pointer to start or end. 
     *
@@ -0,0 +1,121 @@
+/*!
+* @file SdkCryptKeyCache.h
+*
+* @brief This file defines SdkCryptKeyCache class to share the initialized crypt keys in the process.
+*
+* Copyright (C) 2011, LZT Corporation.
+*
+* @author Li Hong
+* @date 2011/06/27
+*/
+
+#ifdef __cplusplus
+#ifndef _SDKCRYPTKEYCACHE_H_
+#define _SDKCRYPTKEYCACHE_H_
+
+#include "SdkCrypt.h"
+
+BEGIN_NAMESPACE_COMMON
+
+typedef struct _CRYPTKEYCACHEENTRY  CRYPTKEYCACHEENTRY,  *LPCRYPTKEYCACHEENTRY;
+
+class SdkCryptKeyCacheLock;
+
+#define DEFAULT_KEY_CACHE_ENTRIES               8       // The default number of cached keys.
+
+/*!
+* @brief This class keeps the keys which are loaded and imported into the CSP, so the next
+*        crypt object of the same key file is duplicated from the cached one instead of
+*        acquiring the CSP and importing the key again. The entries are found by the key
+*        file path and the salted hash of the password, the password itself is not kept.
+*
+* @remark All functions are thread safe. The evicted keys are destroyed and their memory
+*         is wiped. An entry is reloaded if its key file is changed.
+*/
+class CLASS_DECLSPEC SdkCryptKeyCache
+{
+public:
+
+    /*!
+    * @brief Get a crypt object whose scene is initialized with the key of the key file.
+    *
+    * @param lpKeyPath      [I/ ] The path of the key file, NULL means the inner key.
+    * @param lpPassword     [I/ ] The password which the key is used with, can be NULL.
+    * @param ppCrypt        [ /O] The pointer to pointer to SdkCrypt class, you should delete the memory.
+    *
+    * @return CRYPT_ERROR_SUCCEED is success, CRYPT_ERROR_INVALID_KEY if the key file can not
+    *         be loaded, other values are failure.
+    */
+    static CRYPT_RESULT AcquireCrypt(IN LPCTSTR lpKeyPath, IN LPCTSTR lpPassword, OUT SdkCrypt **ppCrypt);
+
+    /*!
+    * @brief Evict the cached keys of a key file.
+    *
+    * @param lpKeyPath      [I/ ] The path of the key file, NULL means the inner key.
+    */
+    static void Evict(IN LPCTSTR lpKeyPath);
+
+    /*!
+    * @brief Evict all cached keys.
+    */
+    static void EvictAll();
+
+    /*!
+    * @brief Set the max number of cached keys, the least recently used keys are evicted.
+    *
+    * @param nEntries       [I/ ] The number of keys, 0 disables the cache.
+    */
+    static void SetCapacity(IN UINT32 nEntries);
+
+private:
+
+    /*!
+    * @brief Get the salted hash of the password, the salt is random in each process.
+    *
+    * @param lpPassword     [I/ ] The password, can be NULL.
+    * @param pbHash         [ /O] The buffer of 32 bytes to receive the hash.
+    *
+    * @return TRUE if succeeds, otherwise FALSE.
+    */
+    static BOOL GetPasswordHash(IN LPCTSTR lpPassword, OUT PBYTE pbHash);
+
+    /*!
+    * @brief Load the key file and initialize a crypt object with it.
+    *
+    * @param lpKeyPath      [I/ ] The path of the key file, NULL means the inner key.
+    * @param ppCrypt        [ /O] The pointer to pointer to SdkCrypt class.
+    *
+    * @return The CRYPT_RESULT value.
+    */
+    static CRYPT_RESULT LoadCrypt(IN LPCTSTR lpKeyPath, OUT SdkCrypt **ppCrypt);
+
+    /*!
+    * @brief Destroy the entries beyond the number, the key material is wiped.
+    *
+    * @param nEntries       [I/ ] The number of entries to keep.
+    */
+    static void TrimEntries(IN UINT32 nEntries);
+
+    /*!
+    * @brief Destroy an entry, the key material is wiped.
+    *
+    * @param lpEntry        [I/ ] The entry.
+    */
+    static void DestroyEntry(IN LPCRYPTKEYCACHEENTRY lpEntry);
+
+private:
+
+    friend class SdkCryptKeyCacheLock;
+
+    static CRITICAL_SECTION                 s_csLock;           // The lock of the cache.
+    static HCRYPTPROV                       s_hHashProvider;    // The CSP to hash the passwords.
+    static BYTE                             s_cbSalt[16];       // The salt of the password hash.
+    static BOOL                             s_hasSalt;          // The salt is generated or not.
+    static UINT32                           s_nCapacity;        // The max number of entries.
+    static vector<LPCRYPTKEYCACHEENTRY>     s_vctEntries;       // The entries, the most recently used is the first.
+};
+
+END_NAMESPACE_COMMON
+
+#endif // _SDKCRYPTKEYCACHE_H_
+#endif // __cplusplus
@@ -0,0 +1,352 @@
+/*!
+* @file SdkGifDecoder.h
+*
+* @brief This file defines the portable GIF decoder.
+*
+* Copyright (C) 2011, LZT Corporation.
+*
+* @author Li Hong
+* @date 2011/06/30
+*/
+
+#ifdef __cplusplus
+#ifndef _SDKGIFDECODER_H_
+#define _SDKGIFDECODER_H_
+
+#ifdef _WIN32
+#include "SdkCommon.h"
+#else
+// The decoder does not use Windows, the other platforms (e.g. the benchmark on Linux)
+// only need these types.
+#include <stddef.h>
+#include <stdint.h>
+#include <vector>
+using namespace std;
+typedef uint8_t         BYTE;
+typedef uint32_t        UINT32;
+typedef unsigned int    UINT;
+typedef int             BOOL;
+#ifndef TRUE
+#define TRUE            1
+#define FALSE           0
+#endif // TRUE
+#define IN
+#define OUT
+#define CLASS_DECLSPEC
+#define __stdcall
+#endif // _WIN32
+#include "SdkCommonMacro.h"
+
+BEGIN_NAMESPACE_UTILITIES
+
+#define GIF_SIMD_NONE                   0       // The scalar code.
+#define GIF_SIMD_AVX2                   1       // The AVX2 instructions, 8 pixels each time.
+
+#define MAX_GIF_PIXELS                  (64 * 1024 * 1024)      // The largest canvas or frame, in pixels.
+
+typedef struct _GIFFRAMEENTRY  GIFFRAMEENTRY,  *LPGIFFRAMEENTRY;
+
+/*!
+* @brief The DISPOSAL_METHODS enumeration.
+*/
+typedef enum _DISPOSAL_METHODS
+{
+    DM_UNDEFINED            = 0,
+    DM_NONE                 = 1,
+    DM_BACKGROUND           = 2,
+    DM_PREVIOUS             = 3,
+
+} DISPOSAL_METHODS;
+
+/*!
+* @brief The information of one frame of the GIF.
+*/
+typedef struct _GIF_FRAME_INFO
+{
+    UINT    uLeft;                      // The left of the frame on the canvas.
+    UINT    uTop;                       // The top of the frame on the canvas.
+    UINT    uWidth;                     // The width of the frame.
+    UINT    uHeight;                    // The height of the frame.
+    UINT    uDelay;                     // The delay in 1/100 second, as it is stored in the file.
+    UINT    uDisposal;                  // One of the DISPOSAL_METHODS values.
+    UINT    uTransparentIndex;          // The transparent palette index.
+    BOOL    hasGraphicControl;          // Whether the frame has a graphic control extension.
+    BOOL    hasTransparency;            // Whether uTransparentIndex is used.
+    BOOL    isInterlaced;               // Whether the rows are interlaced.
+
+} GIF_FRAME_INFO;
+
+/*!
+* @brief The portable GIF decoder, it does not use WIC so it runs on any platform.
+*
+* @remark The frames are indexed when the data is loaded and decoded on request, the
+*         pixels are 32bpp premultiplied BGRA. The palette expansion uses the SIMD
+*         instructions which the processor supports, the result is the same as the
+*         scalar code.
+*/
+class CLASS_DECLSPEC SdkGifDecoder
+{
+public:
+
+    /*!
+    * @brief The default constructor function.
+    */
+    SdkGifDecoder();
+
+    /*!
+    * @brief The default destructor function.
+    */
+    ~SdkGifDecoder();
+
+    /*!
+    * @brief Judge whether the data starts with the GIF signature.
+    *
+    * @param pData      [I/ ] The data.
+    * @param cbData     [I/ ] The size of the data in bytes.
+    *
+    * @return TRUE if the data is GIF, otherwise return FALSE.
+    */
+    static BOOL IsGifData(IN const BYTE *pData, size_t cbData);
+
+    /*!
+    * @brief Load the GIF from memory, the data is copied.
+    *
+    * @param pData      [I/ ] The data of the GIF file.
+    * @param cbData     [I/ ] The size of the data in bytes.
+    *
+    * @return TRUE if the header is valid and there is at least one frame, otherwise FALSE.
+    */
+    BOOL LoadFromMemory(IN const BYTE *pData, size_t cbData);
+
+    /*!
+    * @brief Clear the data and the frames.
+    */
+    void Clear();
+
+    /*!
+    * @brief Get the width of the logical screen.
+    */
+    UINT GetWidth() const;
+
+    /*!
+    * @brief Get the height of the logical screen.
+    */
+    UINT GetHeight() const;
+
+    /*!
+    * @brief Get the pixel aspect ratio byte of the logical screen, 0 is square pixels.
+    */
+    UINT GetPixelAspectRatio() const;
+
+    /*!
+    * @brief Get the frame count.
+    */
+    UINT GetFrameCount() const;
+
+    /*!
+    * @brief Get the loop count of the NETSCAPE2.0 or ANIMEXTS1.0 extension.
+    *
+    * @param uLoopCount     [ /O] The loop count, 0 is infinite.
+    *
+    * @return TRUE if the GIF has the extension, otherwise return FALSE.
+    */
+    BOOL GetLoopCount(OUT UINT &uLoopCount) const;
+
+    /*!
+    * @brief Get the background color from the global color table.
+    *
+    * @param uColor         [ /O] The color in ARGB format.
+    *
+    * @return TRUE if the GIF has a global color table, otherwise return FALSE.
+    */
+    BOOL GetBackgroundColor(OUT UINT32 &uColor) const;
+
+    /*!
+    * @brief Get the information of a frame.
+    *
+    * @param uFrameIndex    [I/ ] The frame index.
+    * @param info           [ /O] The frame information.
+    *
+    * @return TRUE if succeeds, otherwise return FALSE.
+    */
+    BOOL GetFrameInfo(UINT uFrameIndex, OUT GIF_FRAME_INFO &info) const;
+
+    /*!
+    * @brief Decode the palette indices of a frame, the rows are deinterlaced.
+    *
+    * @param uFrameIndex    [I/ ] The frame index.
+    * @param pIndices       [ /O] The buffer of uWidth * uHeight bytes of the frame.
+    *
+    * @return TRUE if succeeds, otherwise return FALSE.
+    */
+    BOOL DecodeFrameIndices(UINT uFrameIndex, OUT BYTE *pIndices);
+
+    /*!
+    * @brief Decode a raw frame, it is not composed with the previous frames.
+    *
+    * @param uFrameIndex    [I/ ] The frame index.
+    * @param pPixels        [ /O] The 32bpp PBGRA buffer of the frame size, the transparent
+    *                             pixels are zero.
+    * @param uStride        [I/ ] The stride of the buffer in bytes.
+    *
+    * @return TRUE if succeeds, otherwise return FALSE.
+    */
+    BOOL DecodeFrame(UINT uFrameIndex, OUT BYTE *pPixels, UINT uStride);
+
+    /*!
+    * @brief Compose the frames on the canvas as they are displayed, the disposal
+    *        methods of the previous frames are applied.
+    *
+    * @param uFrameIndex    [I/ ] The frame index, the next frame is composed fastest.
+    * @param pPixels        [ /O] The 32bpp PBGRA buffer of the canvas size, the area which
+    *                             is not drawn by any frame is transparent.
+    * @param uStride        [I/ ] The stride of the buffer in bytes.
+    *
+    * @return TRUE if succeeds, otherwise return FALSE.
+    */
+    BOOL ComposeFrame(UINT uFrameIndex, OUT BYTE *pPixels, UINT uStride);
+
+    /*!
+    * @brief Look up the palette colors of the indices.
+    *
+    * @param pIndices       [I/ ] The palette indices.
+    * @param nCount         [I/ ] The count of the indices.
+    * @param pPalette       [I/ ] The 256 colors of the palette.
+    * @param pPixels        [ /O] The colors.
+    */
+    static void ExpandPalette(IN const BYTE *pIndices, size_t nCount, IN const UINT32 *pPalette, OUT UINT32 *pPixels);
+
+    /*!
+    * @brief Look up the palette colors of the indices, the pixels of the transparent
+    *        index are not changed.
+    *
+    * @param pIndices           [I/ ] The palette indices.
+    * @param nCount             [I/ ] The count of the indices.
+    * @param pPalette           [I/ ] The 256 colors of the palette.
+    * @param uTransparentIndex  [I/ ] The transparent index.
+    * @param pPixels            [I/O] The colors.
+    */
+    static void ExpandPaletteTransparent(IN const BYTE *pIndices, size_t nCount, IN const UINT32 *pPalette,
+                                         UINT uTransparentIndex, IN OUT UINT32 *pPixels);
+
+    /*!
+    * @brief The scalar implementation of ExpandPalette, it is the reference of the SIMD code.
+    */
+    static void ExpandPaletteScalar(IN const BYTE *pIndices, size_t nCount, IN const UINT32 *pPalette, OUT UINT32 *pPixels);
+
+    /*!
+    * @brief The scalar implementation of ExpandPaletteTransparent, it is the reference of the SIMD code.
+    */
+    static void ExpandPaletteTransparentScalar(IN const BYTE *pIndices, size_t nCount, IN const UINT32 *pPalette,
+                                               UINT uTransparentIndex, IN OUT UINT32 *pPixels);
+
+    /*!
+    * @brief Get the SIMD instructions which are used.
+    *
+    * @return One of the GIF_SIMD_XXX values.
+    */
+    static UINT32 GetSimdLevel();
+
+    /*!
+    * @brief Limit the SIMD instructions which are used, it is used to test and benchmark.
+    *
+    * @param nLevel     [I/ ] One of the GIF_SIMD_XXX values, it is lowered to the best
+    *                         level which the processor supports.
+    */
+    static void SetSimdLevel(UINT32 nLevel);
+
+private:
+
+    /*!
+    * @brief Read the blocks and index the frames.
+    *
+    * @return TRUE if there is at least one frame, otherwise return FALSE.
+    */
+    BOOL ParseBlocks();
+
+    /*!
+    * @brief Skip the data sub-blocks.
+    *
+    * @param nOffset    [I/ ] The offset of the first sub-block.
+    *
+    * @return The offset after the block terminator, or the data size if it is truncated.
+    */
+    size_t SkipSubBlocks(size_t nOffset) const;
+
+    /*!
+    * @brief Decode the LZW data of a frame into m_vctIndices, the rows are in the order
+    *        of the file.
+    *
+    * @param pEntry     [I/ ] The frame.
+    *
+    * @return TRUE if succeeds, otherwise return FALSE.
+    */
+    BOOL DecodeLzw(IN const GIFFRAMEENTRY *pEntry);
+
+    /*!
+    * @brief Decode the palette indices of a frame into m_vctIndices and deinterlace them.
+    *
+    * @param uFrameIndex    [I/ ] The frame index.
+    *
+    * @return The frame, NULL if it fails.
+    */
+    const GIFFRAMEENTRY* DecodeIndices(UINT uFrameIndex);
+
+    /*!
+    * @brief Get the 256 PBGRA colors of the palette of a frame.
+    *
+    * @param pEntry             [I/ ] The frame.
+    * @param isTransparentZero  [I/ ] Whether the transparent color is set to zero.
+    * @param pPalette           [ /O] The 256 colors, the missing ones are opaque black.
+    */
+    void GetFramePalette(IN const GIFFRAMEENTRY *pEntry, BOOL isTransparentZero, OUT UINT32 *pPalette) const;
+
+    /*!
+    * @brief Draw a frame on the canvas, the disposal of the previous frame is applied first.
+    *
+    * @param uFrameIndex    [I/ ] The frame index.
+    *
+    * @return TRUE if succeeds, otherwise return FALSE.
+    */
+    BOOL ComposeNextFrame(UINT uFrameIndex);
+
+    /*!
+    * @brief Get the part of the frame which is on the canvas.
+    *
+    * @return FALSE if the frame is out of the canvas.
+    */
+    BOOL GetCanvasRect(IN const GIF_FRAME_INFO &info, OUT UINT &uLeft, OUT UINT &uTop, OUT UINT &uRight, OUT UINT &uBottom) const;
+
+    /*!
+    * @brief Get the best SIMD instructions which the processor supports.
+    *
+    * @return One of the GIF_SIMD_XXX values.
+    */
+    static UINT32 GetSupportedSimdLevel();
+
+private:
+
+    vector<BYTE>            m_vctData;              // The data of the GIF file.
+    vector<LPGIFFRAMEENTRY> m_vctFrames;            // The frames.
+    vector<BYTE>            m_vctLzwData;           // The LZW data of the frame which is decoded.
+    vector<BYTE>            m_vctIndices;           // The palette indices of the frame which is decoded.
+    vector<BYTE>            m_vctRows;              // The deinterlaced indices.
+    vector<UINT32>          m_vctCanvas;            // The composed canvas.
+    vector<UINT32>          m_vctPrevious;          // The canvas which is restored by DM_PREVIOUS.
+    UINT                    m_uWidth;               // The width of the logical screen.
+    UINT                    m_uHeight;              // The height of the logical screen.
+    UINT                    m_uAspectRatio;         // The pixel aspect ratio byte.
+    UINT                    m_uBkColorIndex;        // The background color index.
+    UINT                    m_uLoopCount;           // The loop count, 0 is infinite.
+    BOOL                    m_hasLoopCount;         // Whether the GIF has the looping extension.
+    size_t                  m_nGlobalPalette;       // The offset of the global color table, 0 is none.
+    UINT                    m_uGlobalPaletteSize;   // The count of the colors of the global color table.
+    UINT                    m_uComposedIndex;       // The frame on the canvas, -1 is none.
+
+    static volatile UINT32  s_uSimdLevel;           // The SIMD instructions which are used, -1 is not detected.
+};
+
+END_NAMESPACE_UTILITIES
+
+#endif // _SDKGIFDECODER_H_
+#endif // __cplusplus
@@ -0,0 +1,219 @@
+/*!
+* @file SdkImageBatchConverter.h
+*
+* @brief This file defines SdkImageBatchConverter class to convert many images on the worker threads.
+*
+* Copyright (C) 2011, LZT Corporation.
+*
+* @author Li Hong
+* @date 2011/06/30
+*/
+
+#ifdef __cplusplus
+#ifndef _SDKIMAGEBATCHCONVERTER_H_
+#define _SDKIMAGEBATCHCONVERTER_H_
+
+#include "SdkCommon.h"
+#include "SdkCommonMacro.h"
+#include "SdkImagesManager.h"
+#include "SdkPixelKernels.h"
+
+BEGIN_NAMESPACE_UTILITIES
+
+typedef struct _IMAGEBATCHJOB       IMAGEBATCHJOB,      *LPIMAGEBATCHJOB;
+
+#define DEFAULT_IMAGE_BATCH_BUDGET          (256 * 1024 * 1024)     // The default bytes of the decoded pixels in flight.
+#define MAX_IMAGE_BATCH_THREADS             16                      // The max number of the worker threads.
+
+/*!
+* @brief The statistics of the last run.
+*/
+typedef struct _IMAGEBATCHSTATS
+{
+    UINT32      uSucceeded;         // The number of the converted images.
+    UINT32      uFailed;            // The number of the failed or cancelled images.
+    UINT64      uDecodeTime;        // The microseconds of the decoding stage, summed over the threads.
+    UINT64      uResizeTime;        // The microseconds of the resizing stage, summed over the threads.
+    UINT64      uEncodeTime;        // The microseconds of the encoding stage, summed over the threads.
+    UINT64      uElapsedTime;       // The microseconds of the whole run.
+    UINT64      uPeakBytes;         // The max bytes of the pixels in flight.
+
+} IMAGEBATCHSTATS, *LPIMAGEBATCHSTATS;
+
+/*!
+* @brief This class converts the images to the other formats and sizes in a batch. Every job
+*        is opened, decoded, resized and encoded, the worker threads take the later stage first
+*        so the decoded pixels are written out before new images are decoded. The size of an
+*        opened image is known, its decoded and resized pixels are reserved from the memory
+*        budget before it is decoded, an image which does not fit waits until other images
+*        are written out.
+*
+* @remark The images are decoded in a reduced size by the codec if possible, then resized by
+*         SdkPixelKernels. The same as SdkImagesManager::SaveImageToFile, the extension is added
+*         to the target file if it has none, and the folder is created. EMF, WMF and ICON have
+*         no WIC encoder, the jobs of these types fail with WINCODEC_ERR_COMPONENTNOTFOUND.
+*/
+class CLASS_DECLSPEC SdkImageBatchConverter
+{
+public:
+
+    /*!
+    * @brief The constructor function.
+    */
+    SdkImageBatchConverter();
+
+    /*!
+    * @brief The destructor function.
+    */
+    ~SdkImageBatchConverter();
+
+    /*!
+    * @brief Add a job, it should not be called while running.
+    *
+    * @param lpSource       [I/ ] The source image file.
+    * @param lpTarget       [I/ ] The target image file.
+    * @param saveType       [I/ ] The format of the target image.
+    * @param uMaxWidth      [I/ ] The max width of the target image, 0 means no limit.
+    * @param uMaxHeight     [I/ ] The max height of the target image, 0 means no limit.
+    *
+    * @return The index of the job.
+    */
+    UINT32 AddJob(IN LPCWSTR lpSource, IN LPCWSTR lpTarget, IN IMAGE_SAVETYPE saveType,
+                  IN UINT32 uMaxWidth = 0, IN UINT32 uMaxHeight = 0);
+
+    /*!
+    * @brief Remove all jobs.
+    */
+    void ClearJobs();
+
+    /*!
+    * @brief Get the count of the jobs.
+    *
+    * @return The count of the jobs.
+    */
+    UINT32 GetJobCount() const;
+
+    /*!
+    * @brief Get the result of the job of the last run.
+    *
+    * @param uIndex         [I/ ] The index of the job.
+    *
+    * @return S_OK if the image is converted, E_ABORT if cancelled, E_PENDING if not run.
+    */
+    HRESULT GetJobResult(IN UINT32 uIndex) const;
+
+    /*!
+    * @brief Set the filter to resize the images, the default is PIXEL_RESIZE_BILINEAR.
+    *
+    * @param filter         [I/ ] The filter.
+    */
+    void SetFilter(IN PIXEL_RESIZE_FILTER filter);
+
+    /*!
+    * @brief Run the jobs and wait until they finish.
+    *
+    * @param uThreadCount   [I/ ] The number of the worker threads, 0 means the number of the processors.
+    * @param uMemoryBudget  [I/ ] The bytes of the pixels in flight. An image which is larger than
+    *                             the budget is decoded alone, when no other pixels are in flight.
+    *
+    * @return TRUE if all jobs succeed, otherwise FALSE.
+    */
+    BOOL Run(IN UINT32 uThreadCount = 0, IN UINT64 uMemoryBudget = DEFAULT_IMAGE_BATCH_BUDGET);
+
+    /*!
+    * @brief Cancel the running jobs, it can be called on any thread. The running stages are
+    *        finished, the jobs which are not encoded fail with E_ABORT.
+    */
+    void Cancel();
+
+    /*!
+    * @brief Get the statistics of the last run.
+    *
+    * @param pStats         [ /O] The statistics.
+    */
+    void GetStats(OUT LPIMAGEBATCHSTATS pStats) const;
+
+private:
+
+    /*!
+    * @brief The copy constructor function.
+    */
+    SdkImageBatchConverter(IN const SdkImageBatchConverter& srcConverter);
+
+    /*!
+    * @brief [=] override
+    */
+    SdkImageBatchConverter& operator = (const SdkImageBatchConverter& rightVal);
+
+    /*!
+    * @brief The worker thread procedure.
+    *
+    * @param lpParameter    [I/ ] The pointer to SdkImageBatchConverter.
+    */
+    static unsigned int WINAPI WorkThreadProc(LPVOID lpParameter);
+
+    /*!
+    * @brief Take the jobs and run their stages until all jobs finish.
+    */
+    void WorkJobs();
+
+    /*!
+    * @brief Open the source image of the job and get the sizes of the decoded and target images.
+    */
+    HRESULT OpenJob(IN OUT LPIMAGEBATCHJOB lpJob);
+
+    /*!
+    * @brief Decode the opened image of the job.
+    */
+    HRESULT DecodeJob(IN OUT LPIMAGEBATCHJOB lpJob);
+
+    /*!
+    * @brief Resize the decoded image of the job into the straight pixels.
+    */
+    HRESULT ResizeJob(IN OUT LPIMAGEBATCHJOB lpJob);
+
+    /*!
+    * @brief Encode the pixels of the job into the target file.
+    */
+    HRESULT EncodeJob(IN OUT LPIMAGEBATCHJOB lpJob);
+
+    /*!
+    * @brief Free the images of the job and keep its result, the lock should be held.
+    */
+    void FinishJob(IN OUT LPIMAGEBATCHJOB lpJob, IN HRESULT hr);
+
+    /*!
+    * @brief Take the first opened job which fits into the memory budget and reserve its bytes,
+    *        the lock should be held.
+    *
+    * @return The job, NULL if no opened job fits.
+    */
+    LPIMAGEBATCHJOB ReserveDecodeJob();
+
+    /*!
+    * @brief Get the microseconds since the counter.
+    */
+    UINT64 GetElapsedTime(IN const LARGE_INTEGER& liStart) const;
+
+private:
+
+    CRITICAL_SECTION            m_csLock;               // The lock of the queues.
+    CONDITION_VARIABLE          m_cvChanged;            // Woken when a job moves or the run is cancelled.
+    vector<LPIMAGEBATCHJOB>     m_vctJobs;              // The jobs.
+    list<LPIMAGEBATCHJOB>       m_lstDecodeQueue;       // The opened jobs.
+    list<LPIMAGEBATCHJOB>       m_lstResizeQueue;       // The decoded jobs.
+    list<LPIMAGEBATCHJOB>       m_lstEncodeQueue;       // The resized jobs.
+    UINT32                      m_uNextOpen;            // The index of the next job to open.
+    UINT32                      m_uActiveCount;         // The number of the threads running a stage.
+    UINT64                      m_uBudget;              // The memory budget of the run.
+    UINT64                      m_uBytesInFlight;       // The bytes of the pixels in flight and reserved.
+    PIXEL_RESIZE_FILTER         m_filter;               // The filter to resize.
+    volatile LONG               m_lCancelled;           // The run is cancelled or not.
+    LARGE_INTEGER               m_liFrequency;          // The frequency of the performance counter.
+    IMAGEBATCHSTATS             m_stats;                // The statistics of the last run.
+};
+
+END_NAMESPACE_UTILITIES
+
+#endif // _SDKIMAGEBATCHCONVERTER_H_
+#endif // __cplusplus
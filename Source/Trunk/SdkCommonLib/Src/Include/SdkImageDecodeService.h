@@ -0,0 +1,175 @@
+/*!
+* @file SdkImageDecodeService.h
+*
+* @brief This file defines SdkImageDecodeService class to decode images in the background.
+*
+* Copyright (C) 2011, LZT Corporation.
+*
+* @author Li Hong
+* @date 2011/06/30
+*/
+
+#ifdef __cplusplus
+#ifndef _SDKIMAGEDECODESERVICE_H_
+#define _SDKIMAGEDECODESERVICE_H_
+
+#include "IImageDecodeNotify.h"
+
+BEGIN_NAMESPACE_UTILITIES
+
+typedef struct _IMAGEDECODEREQUEST  IMAGEDECODEREQUEST,  *LPIMAGEDECODEREQUEST;
+
+class SdkImageDecodeServiceLock;
+
+#define MAX_IMAGE_DECODE_THREADS                4       // The max number of decode threads.
+
+/*!
+* @brief This class decodes the image files with a pool of threads, so the window thread is not
+*        blocked by the big images. The requests are decoded by their priorities, the requests of
+*        the same priority are decoded in order. The result is posted to the thread which calls
+*        Initialize, and IImageDecodeNotify is called there.
+*
+* @remark The request id is the token to cancel the request or change its priority. Once Cancel
+*         or CancelAll returns in the window thread, the notify is not called for the requests,
+*         so a view should cancel its requests when it is deleted.
+*/
+class CLASS_DECLSPEC SdkImageDecodeService
+{
+public:
+
+    /*!
+    * @brief Start the decode threads and create the window which receives the results, it
+    *        should be called in the window thread, SdkCommonRunTime calls it.
+    *
+    * @param uThreadCount   [I/ ] The number of threads, 0 means by the number of processors.
+    *
+    * @return TRUE if succeeds, otherwise FALSE.
+    */
+    static BOOL Initialize(IN UINT32 uThreadCount = 0);
+
+    /*!
+    * @brief Stop the decode threads, the requests which are not finished are discarded.
+    */
+    static void Uninitialize();
+
+    /*!
+    * @brief Indicates whether the service is running.
+    *
+    * @return TRUE if running, otherwise FALSE.
+    */
+    static BOOL IsRunning();
+
+    /*!
+    * @brief Add a request to decode an image file.
+    *
+    * @param lpFile         [I/ ] The image file path.
+    * @param uDestWidth     [I/ ] The target width, 0 means the original width.
+    * @param uDestHeight    [I/ ] The target height, 0 means the original height.
+    * @param priority       [I/ ] The priority of the request.
+    * @param pNotify        [I/ ] The notify called in the window thread when the request finishes.
+    * @param isProgressive  [I/ ] Notify a preview decoded by the native downscale of the codec
+    *                             first, if the codec has one, then decode the full image.
+    *
+    * @return The request id, 0 if the service is not running or the parameters are invalid.
+    */
+    static DWORD DecodeFile(IN LPCWSTR lpFile, IN UINT32 uDestWidth, IN UINT32 uDestHeight,
+                            IN IMAGE_DECODE_PRIORITY priority, IN IImageDecodeNotify *pNotify,
+                            IN BOOL isProgressive = FALSE);
+
+    /*!
+    * @brief Change the priority of a request which is not started.
+    *
+    * @param dwRequestId    [I/ ] The request id.
+    * @param priority       [I/ ] The new priority.
+    *
+    * @return TRUE if the request is waiting and its priority is changed, otherwise FALSE.
+    */
+    static BOOL SetPriority(IN DWORD dwRequestId, IN IMAGE_DECODE_PRIORITY priority);
+
+    /*!
+    * @brief Cancel a request, the notify will not be called for it.
+    *
+    * @param dwRequestId    [I/ ] The request id, 0 is ignored.
+    */
+    static void Cancel(IN DWORD dwRequestId);
+
+    /*!
+    * @brief Cancel all requests of a notify.
+    *
+    * @param pNotify        [I/ ] The notify.
+    */
+    static void CancelAll(IN IImageDecodeNotify *pNotify);
+
+private:
+
+    /*!
+    * @brief The procedure of the decode threads.
+    *
+    * @param lpParameter    [I/ ] Not used.
+    *
+    * @return 0.
+    */
+    static unsigned int WINAPI DecodeThreadProc(LPVOID lpParameter);
+
+    /*!
+    * @brief The procedure of the window which receives the results.
+    */
+    static LRESULT CALLBACK WndProc(HWND hWnd, UINT message, WPARAM wParam, LPARAM lParam);
+
+    /*!
+    * @brief Decode the image of the request, called in the decode threads.
+    *
+    * @param lpRequest      [I/O] The request, receives the result.
+    */
+    static void DecodeRequest(IN OUT LPIMAGEDECODEREQUEST lpRequest);
+
+    /*!
+    * @brief Call the notify of a finished request, called in the window thread.
+    *
+    * @param dwRequestId    [I/ ] The request id.
+    */
+    static void DispatchResult(IN DWORD dwRequestId);
+
+    /*!
+    * @brief Call the notify with the preview of a progressive request, called in the window thread.
+    *
+    * @param dwRequestId    [I/ ] The request id.
+    */
+    static void DispatchPreview(IN DWORD dwRequestId);
+
+    /*!
+    * @brief Remove a request from the waiting queue.
+    *
+    * @param lpRequest      [I/ ] The request.
+    *
+    * @return TRUE if the request is waiting and removed, otherwise FALSE.
+    */
+    static BOOL RemoveQueuedRequest(IN LPIMAGEDECODEREQUEST lpRequest);
+
+    /*!
+    * @brief Delete a request and release its bitmap, the caller removes it from the map.
+    *
+    * @param lpRequest      [I/ ] The request.
+    */
+    static void DestroyRequest(IN LPIMAGEDECODEREQUEST lpRequest);
+
+private:
+
+    friend class SdkImageDecodeServiceLock;
+
+    static CRITICAL_SECTION                     s_csLock;           // The lock of the queue and the requests.
+    static BOOL                                 s_hasRegClass;      // The window class is registered.
+    static HWND                                 s_hNotifyWnd;       // The window which receives the results.
+    static HANDLE                               s_hQueueSemaphore;  // Signaled once for each queued request.
+    static BOOL                                 s_isStopping;       // The threads should exit.
+    static DWORD                                s_dwNextRequestId;  // The id of the next request.
+    static UINT32                               s_uNextSequence;    // The order of the next request.
+    static vector<HANDLE>                       s_vctThreads;       // The decode threads.
+    static vector<LPIMAGEDECODEREQUEST>         s_vctQueue;         // The heap of the waiting requests.
+    static map<DWORD, LPIMAGEDECODEREQUEST>     s_mapRequests;      // All requests which are not dispatched.
+};
+
+END_NAMESPACE_UTILITIES
+
+#endif // _SDKIMAGEDECODESERVICE_H_
+#endif // __cplusplus
@@ -16,6 +16,7 @@
 #include "SdkCommon.h"
 #include "SdkCommonMacro.h"
 #include "SdkCommonHelper.h"
+#include "SdkPixelKernels.h"
 
 BEGIN_NAMESPACE_UTILITIES
 
@@ -77,7 +78,9 @@ public:
     * @param hbmColour      [I/ ] The handle to a color image to be as source of mask bitmap.
     * @param crTransparent  [I/ ] The background color. The default value is RGB(0, 0, 0)(black).
     *
-    * @return The handle of mask bitmap.
+    * @return The handle of mask bitmap, the pixels of the background color are white.
+    *
+    * @remark The pixels of the background color in the color image are turned to black.
     */
     static HBITMAP CreateBitmapMask(HBITMAP hbmColour, COLORREF crTransparent = RGB(0, 0, 0));
 
@@ -174,19 +177,21 @@ public:
     * 
     * @param fWidth         [I/ ] The width of image
     * @param fHeight        [I/ ] The height of image
+    * @param filter         [I/ ] The filter, the default value is PIXEL_RESIZE_BILINEAR.
     * 
     * @return TRUE is success, otherwise is FALSE.
     */
-    BOOL ResizeTo(FLOAT fWidth, FLOAT fHeight);
+    BOOL ResizeTo(FLOAT fWidth, FLOAT fHeight, PIXEL_RESIZE_FILTER filter = PIXEL_RESIZE_BILINEAR);
 
     /*!
     * @brief Change the size of current image according to the specified ratio.
     * 
     * @param fRatio         [I/ ] The ratio of image
+    * @param filter         [I/ ] The filter, the default value is PIXEL_RESIZE_BILINEAR.
     * 
     * @return TRUE is success, otherwise is FALSE.
     */
-    BOOL ResizeTo(FLOAT fRatio);
+    BOOL ResizeTo(FLOAT fRatio, PIXEL_RESIZE_FILTER filter = PIXEL_RESIZE_BILINEAR);
 
     /*!
     * @brief Draw the image on the Device Context specified by hDC.
@@ -316,6 +321,17 @@ protected:
     */
     BOOL GetBitmapBitsData(IN HBITMAP hBitmap, OUT LPBITMAP lpbitmap, OUT LPVOID* pbitbuf);
 
+    /*!
+    * @brief Resize the premultiplied pixels of current image to a new bitmap.
+    *
+    * @param uWidth     [I/ ] The width of the new bitmap.
+    * @param uHeight    [I/ ] The height of the new bitmap.
+    * @param filter     [I/ ] The filter.
+    *
+    * @return The new bitmap, the caller should delete it. NULL if the pixels can not be locked.
+    */
+    Bitmap* ResizePixels(UINT uWidth, UINT uHeight, PIXEL_RESIZE_FILTER filter);
+
     /*!
     * @brief Load resource to memory by identifier, type, from specified handle to HMODULE.
     *
@@ -0,0 +1,202 @@
+/*!
+* @file SdkPixelKernels.h
+*
+* @brief This file defines the portable kernels which process 32bpp pixels.
+*
+* Copyright (C) 2011, LZT Corporation.
+*
+* @author Li Hong
+* @date 2011/06/30
+*/
+
+#ifdef __cplusplus
+#ifndef _SDKPIXELKERNELS_H_
+#define _SDKPIXELKERNELS_H_
+
+#ifdef _WIN32
+#include "SdkCommon.h"
+#else
+// The kernels do not use Windows, the other platforms (e.g. the benchmark on Linux)
+// only need these types.
+#include <stddef.h>
+#include <stdint.h>
+#include <vector>
+using namespace std;
+typedef uint8_t         BYTE;
+typedef uint32_t        UINT32;
+typedef unsigned int    UINT;
+typedef int             BOOL;
+#ifndef TRUE
+#define TRUE            1
+#define FALSE           0
+#endif // TRUE
+#define IN
+#define OUT
+#define CLASS_DECLSPEC
+#define __stdcall
+#endif // _WIN32
+#include "SdkCommonMacro.h"
+
+BEGIN_NAMESPACE_UTILITIES
+
+#define PIXEL_SIMD_NONE                 0       // The scalar code.
+#define PIXEL_SIMD_AVX2                 1       // The AVX2 instructions on x86 and x64.
+#define PIXEL_SIMD_NEON                 2       // The NEON instructions on ARM64.
+
+#define MAX_PIXEL_KERNEL_PIXELS         (256 * 1024 * 1024)     // The largest image to resize, in pixels.
+
+/*!
+* @brief The filters to resize the image.
+*/
+typedef enum _PIXEL_RESIZE_FILTER
+{
+    PIXEL_RESIZE_BOX        = 0,        // The average of the covered pixels, it is good at shrinking.
+    PIXEL_RESIZE_BILINEAR   = 1,        // The triangle filter, the same as the bilinear interpolation.
+    PIXEL_RESIZE_LANCZOS    = 2,        // The Lanczos filter with 3 lobes, it is the sharpest one.
+
+} PIXEL_RESIZE_FILTER;
+
+/*!
+* @brief The pixel kernels. The pixels are 32bpp BGRA in memory, the same as the DIB and
+*        the WIC 32bppBGRA format. Every kernel has the scalar code and the SIMD code, they
+*        give the same result bit by bit.
+*/
+class CLASS_DECLSPEC SdkPixelKernels
+{
+public:
+
+    /*!
+    * @brief Multiply the color channels with the alpha channel.
+    *
+    * @param pPixels        [I/O] The pixels.
+    * @param nCount         [I/ ] The count of the pixels.
+    */
+    static void PremultiplyAlpha(IN OUT UINT32 *pPixels, size_t nCount);
+
+    /*!
+    * @brief Divide the color channels by the alpha channel, the color of the transparent
+    *        pixels is black.
+    *
+    * @param pPixels        [I/O] The pixels.
+    * @param nCount         [I/ ] The count of the pixels.
+    */
+    static void UnpremultiplyAlpha(IN OUT UINT32 *pPixels, size_t nCount);
+
+    /*!
+    * @brief Swap the red and blue channels, it converts BGRA to RGBA and RGBA to BGRA.
+    *
+    * @param pSrc           [I/ ] The source pixels.
+    * @param pDest          [ /O] The destination pixels, it can be the same as pSrc.
+    * @param nCount         [I/ ] The count of the pixels.
+    */
+    static void SwapRedBlue(IN const UINT32 *pSrc, OUT UINT32 *pDest, size_t nCount);
+
+    /*!
+    * @brief Create the 1bpp mask of the pixels whose color is the color key, the bit of
+    *        the matched pixel is 1, the first pixel is the highest bit of the byte.
+    *
+    * @param pPixels        [I/ ] The pixels.
+    * @param uWidth         [I/ ] The width of the image.
+    * @param uHeight        [I/ ] The height of the image.
+    * @param uStride        [I/ ] The bytes of one row of the pixels.
+    * @param uColorKey      [I/ ] The color key, 0x00RRGGBB, the alpha is ignored.
+    * @param pMask          [ /O] The mask, (uWidth + 7) / 8 bytes of each row at least.
+    * @param uMaskStride    [I/ ] The bytes of one row of the mask.
+    *
+    * @return The count of the matched pixels.
+    */
+    static size_t CreateColorKeyMask(
+        IN const BYTE *pPixels,
+        UINT uWidth,
+        UINT uHeight,
+        UINT uStride,
+        UINT32 uColorKey,
+        OUT BYTE *pMask,
+        UINT uMaskStride);
+
+    /*!
+    * @brief Resize the image with the specified filter. The pixels should be premultiplied,
+    *        otherwise the color of the transparent pixels bleeds into the edge.
+    *
+    * @param pSrc           [I/ ] The source pixels.
+    * @param uSrcWidth      [I/ ] The width of the source image.
+    * @param uSrcHeight     [I/ ] The height of the source image.
+    * @param uSrcStride     [I/ ] The bytes of one row of the source image.
+    * @param pDest          [ /O] The destination pixels.
+    * @param uDestWidth     [I/ ] The width of the destination image.
+    * @param uDestHeight    [I/ ] The height of the destination image.
+    * @param uDestStride    [I/ ] The bytes of one row of the destination image.
+    * @param filter         [I/ ] The filter.
+    *
+    * @return TRUE if succeeds, otherwise FALSE.
+    */
+    static BOOL ResizeImage(
+        IN const BYTE *pSrc,
+        UINT uSrcWidth,
+        UINT uSrcHeight,
+        UINT uSrcStride,
+        OUT BYTE *pDest,
+        UINT uDestWidth,
+        UINT uDestHeight,
+        UINT uDestStride,
+        PIXEL_RESIZE_FILTER filter);
+
+    /*!
+    * @brief Get the SIMD level which is used by the kernels.
+    *
+    * @return PIXEL_SIMD_NONE, PIXEL_SIMD_AVX2 or PIXEL_SIMD_NEON.
+    */
+    static UINT32 GetSimdLevel();
+
+    /*!
+    * @brief Set the SIMD level, typically it is used to compare the SIMD code with the scalar
+    *        code. The level which is not supported by the CPU falls back to the scalar code.
+    *
+    * @param nLevel         [I/ ] PIXEL_SIMD_NONE, PIXEL_SIMD_AVX2 or PIXEL_SIMD_NEON.
+    */
+    static void SetSimdLevel(UINT32 nLevel);
+
+private:
+
+    /*!
+    * @brief Resize the rows of the image in horizontal.
+    */
+    static void ResizeHorizontal(
+        const BYTE *pSrc,
+        UINT uSrcStride,
+        UINT uHeight,
+        BYTE *pDest,
+        UINT uDestWidth,
+        UINT uDestStride,
+        const vector<int> &vctBounds,
+        const vector<int> &vctWeights,
+        int nTaps);
+
+    /*!
+    * @brief Resize the columns of the image in vertical.
+    */
+    static void ResizeVertical(
+        const BYTE *pSrc,
+        UINT uSrcStride,
+        UINT uWidth,
+        BYTE *pDest,
+        UINT uDestHeight,
+        UINT uDestStride,
+        const vector<int> &vctBounds,
+        const vector<int> &vctWeights,
+        int nTaps);
+
+    /*!
+    * @brief Get the SIMD level which is supported by the CPU and the OS.
+    */
+    static UINT32 GetSupportedSimdLevel();
+
+private:
+
+    static volatile UINT32      s_uSimdLevel;       // The SIMD level, -1 means it is not detected.
+};
+
+END_NAMESPACE_UTILITIES
+
+#endif // _SDKPIXELKERNELS_H_
+#endif // __cplusplus
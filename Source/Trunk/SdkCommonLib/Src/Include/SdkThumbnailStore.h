@@ -0,0 +1,208 @@
+/*!
+* @file SdkThumbnailStore.h
+*
+* @brief This file defines SdkThumbnailStore class to keep the thumbnails on the disk.
+*
+* Copyright (C) 2011, LZT Corporation.
+*
+* @author Li Hong
+* @date 2011/06/30
+*/
+
+#ifdef __cplusplus
+#ifndef _SDKTHUMBNAILSTORE_H_
+#define _SDKTHUMBNAILSTORE_H_
+
+#include "SdkCommon.h"
+#include "SdkCommonMacro.h"
+
+BEGIN_NAMESPACE_UTILITIES
+
+typedef struct _THUMBNAILFILEHEADER     THUMBNAILFILEHEADER,    *LPTHUMBNAILFILEHEADER;
+typedef struct _THUMBNAILRECORD         THUMBNAILRECORD,        *LPTHUMBNAILRECORD;
+typedef struct _THUMBNAILSLOT           THUMBNAILSLOT,          *LPTHUMBNAILSLOT;
+typedef struct _THUMBNAILKEY            THUMBNAILKEY,           *LPTHUMBNAILKEY;
+
+class SdkThumbnailStoreLock;
+
+#define THUMBNAIL_STORE_MAX_SIZE                1024                        // The max width or height of a stored thumbnail.
+#define THUMBNAIL_STORE_MAX_BYTES               (1024 * 1024 * 1024)        // The max bytes of the data file.
+#define THUMBNAIL_STORE_COMPACT_BYTES           (32 * 1024 * 1024)          // The dead bytes which start the compaction.
+
+/*!
+* @brief The statistics of the thumbnail store.
+*/
+typedef struct _THUMBNAILSTORESTATS
+{
+    UINT64      uHits;              // The number of lookups which find the thumbnail.
+    UINT64      uMisses;            // The number of lookups which do not find the thumbnail.
+    UINT64      uInserts;           // The number of stored thumbnails.
+    UINT64      uDataBytes;         // The bytes of the data file.
+    UINT64      uDeadBytes;         // The bytes of the replaced records in the data file.
+    UINT32      uEntries;           // The number of thumbnails in the index.
+    UINT32      uCompactions;       // The number of finished compactions.
+
+} THUMBNAILSTORESTATS, *LPTHUMBNAILSTORESTATS;
+
+/*!
+* @brief This class keeps the thumbnails of the files in two files, so a folder which is shown
+*        again does not extract them from the shell again. The data file is append only, it
+*        has the records of the path, the size and the pixels. The index file is mapped into
+*        the memory, it is the hash table from the key to the record.
+*
+* @remark All functions are thread safe. The key is made of the lowercase path, the requested
+*         size and the kind of the image, the last write time and the size of the file are
+*         checked when the thumbnail is found, so a changed file is a miss and its new
+*         thumbnail replaces the old one. The replaced records are removed by the compaction
+*         in a background thread when they take half of the data file.
+*/
+class CLASS_DECLSPEC SdkThumbnailStore
+{
+public:
+
+    /*!
+    * @brief Open the store, the broken or old files are created again. SdkCommonRunTime opens it
+    *        in the default directory.
+    *
+    * @param lpDirectory    [I/ ] The directory of the files, NULL means the LightSDK\Thumbnails
+    *                             directory in the local application data.
+    *
+    * @return TRUE if succeeds, otherwise FALSE.
+    */
+    static BOOL Open(IN LPCWSTR lpDirectory = NULL);
+
+    /*!
+    * @brief Close the store, the running compaction is stopped first.
+    */
+    static void Close();
+
+    /*!
+    * @brief Indicates whether the store is opened.
+    *
+    * @return TRUE if opened, otherwise FALSE.
+    */
+    static BOOL IsOpen();
+
+    /*!
+    * @brief Find the thumbnail of the file.
+    *
+    * @param lpPath         [I/ ] The file path.
+    * @param uWidth         [I/ ] The requested width.
+    * @param uHeight        [I/ ] The requested height.
+    * @param uKind          [I/ ] The kind of the image, e.g. the SIIGBF flags used to get it.
+    *
+    * @return The 32bpp top-down DIB section, you should delete it. NULL if not found.
+    */
+    static HBITMAP Lookup(IN LPCWSTR lpPath, IN UINT32 uWidth, IN UINT32 uHeight, IN UINT32 uKind = 0);
+
+    /*!
+    * @brief Store the thumbnail of the file, the old thumbnail of the same key is replaced.
+    *
+    * @param lpPath         [I/ ] The file path.
+    * @param uWidth         [I/ ] The requested width.
+    * @param uHeight        [I/ ] The requested height.
+    * @param hBitmap        [I/ ] The thumbnail, the store copies its pixels.
+    * @param uKind          [I/ ] The kind of the image, e.g. the SIIGBF flags used to get it.
+    *
+    * @return TRUE if stored, FALSE if the store is not opened or the bitmap is too big.
+    */
+    static BOOL Insert(IN LPCWSTR lpPath, IN UINT32 uWidth, IN UINT32 uHeight,
+                       IN HBITMAP hBitmap, IN UINT32 uKind = 0);
+
+    /*!
+    * @brief Start the compaction in the background, it does nothing if the compaction is running.
+    *
+    * @return TRUE if the compaction is running, otherwise FALSE.
+    */
+    static BOOL StartCompaction();
+
+    /*!
+    * @brief Get the statistics of the store.
+    *
+    * @param pStats         [ /O] The statistics.
+    */
+    static void GetStats(OUT LPTHUMBNAILSTORESTATS pStats);
+
+private:
+
+    /*!
+    * @brief Make the key of the file, it fails if the file does not exist.
+    */
+    static BOOL MakeKey(IN LPCWSTR lpPath, IN UINT32 uWidth, IN UINT32 uHeight,
+                        IN UINT32 uKind, OUT LPTHUMBNAILKEY lpKey);
+
+    /*!
+    * @brief Open the data file and the index file in s_szDirectory, the lock should be held.
+    */
+    static BOOL OpenFiles();
+
+    /*!
+    * @brief Close the files, the lock should be held.
+    */
+    static void CloseFiles();
+
+    /*!
+    * @brief Truncate the files and write their headers of a new generation.
+    */
+    static BOOL ResetFiles();
+
+    /*!
+    * @brief Map the index file with the count of the slots, the file grows if needed.
+    */
+    static BOOL MapIndex(IN UINT32 uSlotCount);
+
+    /*!
+    * @brief Find the slot of the hash, it is the empty slot if the hash is not in the index.
+    */
+    static LPTHUMBNAILSLOT FindSlot(IN UINT64 uKeyHash);
+
+    /*!
+    * @brief Double the slots of the index and put the entries again.
+    */
+    static BOOL GrowIndex();
+
+    /*!
+    * @brief Map the record at the offset of the data file and create its bitmap if it matches the key.
+    */
+    static HBITMAP LoadRecord(IN UINT64 uOffset, IN const THUMBNAILKEY *lpKey);
+
+    /*!
+    * @brief Read the record at the offset of the data file into the buffer.
+    */
+    static BOOL ReadRecord(IN HANDLE hFile, IN UINT64 uOffset, OUT vector<BYTE>& vctRecord);
+
+    /*!
+    * @brief The compaction copies the live records into the new files and replaces the old files.
+    */
+    static void CompactFiles();
+
+    /*!
+    * @brief The thread of the compaction.
+    */
+    static unsigned int WINAPI CompactThreadProc(LPVOID lpParameter);
+
+private:
+
+    friend class SdkThumbnailStoreLock;
+
+    static CRITICAL_SECTION         s_csLock;               // The lock of the files.
+    static WCHAR                    s_szDirectory[MAX_PATH];// The directory of the files.
+    static HANDLE                   s_hDataFile;            // The data file.
+    static HANDLE                   s_hIndexFile;           // The index file.
+    static HANDLE                   s_hDataMapping;         // The read only mapping of the data file.
+    static UINT64                   s_uMappedSize;          // The bytes of the data file in the mapping.
+    static HANDLE                   s_hIndexMapping;        // The mapping of the index file.
+    static LPTHUMBNAILFILEHEADER    s_lpIndex;              // The mapped index, the slots follow the header.
+    static HANDLE                   s_hCompactThread;       // The compaction thread.
+    static BOOL                     s_isCompacting;         // The compaction thread is running.
+    static BOOL                     s_isStopping;           // The compaction should stop.
+    static UINT64                   s_uHits;                // The number of hits.
+    static UINT64                   s_uMisses;              // The number of misses.
+    static UINT64                   s_uInserts;             // The number of inserts.
+    static UINT32                   s_uCompactions;         // The number of compactions.
+};
+
+END_NAMESPACE_UTILITIES
+
+#endif // _SDKTHUMBNAILSTORE_H_
+#endif // __cplusplus
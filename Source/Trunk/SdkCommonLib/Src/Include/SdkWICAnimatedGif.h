@@ -15,9 +15,12 @@
 
 #include "SdkCommon.h"
 #include "SdkCommonMacro.h"
+#include "SdkGifDecoder.h"
 
 BEGIN_NAMESPACE_UTILITIES
 
+#define DEFAULT_GIF_FRAME_CACHE_LIMIT   (16 * 1024 * 1024)      // The default bytes of the composed frames of one GIF.
+
 /*!
 * @brief The GIF_RECT_VALUETYPE enumeration.
 */
@@ -31,18 +34,6 @@ typedef enum _GIF_RECT_VALUETYPE
 
 } GIF_RECT_VALUETYPE;
 
-/*!
-* @brief The DISPOSAL_METHODS enumeration.
-*/
-typedef enum _DISPOSAL_METHODS
-{
-    DM_UNDEFINED            = 0,
-    DM_NONE                 = 1,
-    DM_BACKGROUND           = 2,
-    DM_PREVIOUS             = 3,
-
-} DISPOSAL_METHODS;
-
 /*!
 * @brief The WIC_GIF_TYPE enumeration.
 */
@@ -56,6 +47,16 @@ typedef enum _WIC_GIF_TYPE
 
 } WIC_GIF_TYPE;
 
+/*!
+* @brief The GIF_DECODE_BACKEND enumeration.
+*/
+typedef enum _GIF_DECODE_BACKEND
+{
+    GIF_DECODE_BACKEND_WIC      = 0,        // The GIF is decoded by WIC.
+    GIF_DECODE_BACKEND_PORTABLE = 1,        // The GIF is decoded by SdkGifDecoder, other images by WIC.
+
+} GIF_DECODE_BACKEND;
+
 /*!
 * @brief The class is used to operate GIF files.
 */
@@ -105,6 +106,15 @@ public:
     */
     BOOL LoadFromResource(UINT uResId, HMODULE hModule = NULL);
 
+    /*!
+    * @brief Load a still image from a bitmap source, such as a bitmap decoded by another thread.
+    *
+    * @param pSource    [I/ ] The bitmap source, the object adds a reference to it.
+    *
+    * @return TRUE if succeeds, otherwise return FALSE.
+    */
+    BOOL LoadFromWICBitmap(IN IWICBitmapSource *pSource);
+
     /*!
     * @brief Judge loaded file is gif or image.
     * 
@@ -126,6 +136,20 @@ public:
     */
     WIC_GIF_TYPE GetImageType();
 
+    /*!
+    * @brief Set the decoder of the GIF files, it is used by the next loading.
+    *
+    * @param backend        [I/ ] The decoder, the default is GIF_DECODE_BACKEND_WIC.
+    */
+    void SetDecodeBackend(GIF_DECODE_BACKEND backend);
+
+    /*!
+    * @brief Get the decoder of the GIF files.
+    *
+    * @return GIF_DECODE_BACKEND value.
+    */
+    GIF_DECODE_BACKEND GetDecodeBackend();
+
     /*!
     * @brief Get the format converter of the image that presents a bitmap source.
     *
@@ -144,6 +168,14 @@ public:
     */
     BOOL GetNextFrame(OUT IWICFormatConverter **ppConvertedSourceBitmap);
 
+    /*!
+    * @brief Move to the next frame without decoding it, the frame is cached by the caller.
+    *        The frame index and the loop number are changed as GetNextFrame does.
+    *
+    * @param uFrameDelay        [I/ ] The delay of the skipped frame, returned by GetFrameDelay.
+    */
+    void SkipNextFrame(UINT uFrameDelay);
+
     /*!
     * @brief Get frame format convert, presents a frame bitmap source at specified frame index.
     *
@@ -247,6 +279,35 @@ protected:
     */
     BOOL GetRawFrame(UINT uFrameIndex);
 
+    /*!
+    * @brief Get the raw data at specified frame index from the portable decoder.
+    *
+    * @param uFrameIndex  [I/ ] The frame index.
+    *
+    * @return TRUE if succeeds, otherwise return FALSE.
+    */
+    BOOL GetPortableRawFrame(UINT uFrameIndex);
+
+    /*!
+    * @brief Load the GIF data with the portable decoder.
+    *
+    * @param pData          [I/ ] The data of the GIF file.
+    * @param cbData         [I/ ] The size of the data in bytes.
+    *
+    * @return TRUE if succeeds, FALSE if the data is not GIF or it is broken.
+    */
+    BOOL LoadFromGifData(IN const BYTE *pData, size_t cbData);
+
+    /*!
+    * @brief Read the whole file into memory if it is a GIF file.
+    *
+    * @param lpfile         [I/ ] The pointer to file name.
+    * @param vctData        [ /O] The data of the file.
+    *
+    * @return TRUE if succeeds, FALSE if the file is not GIF or it can not be read.
+    */
+    static BOOL ReadGifFileData(IN LPCWSTR lpfile, OUT vector<BYTE>& vctData);
+
     /*!
     * @brief Get global meta data.
     *
@@ -286,6 +347,15 @@ protected:
     */
     BOOL GetGifSizeInfo();
 
+    /*!
+    * @brief Set the displayed size from the size of the logical screen and the pixel aspect ratio.
+    *
+    * @param cxGifImage         [I/ ] The width of the logical screen.
+    * @param cyGifImage         [I/ ] The height of the logical screen.
+    * @param uPixelAspRatio     [I/ ] The pixel aspect ratio byte, 0 is square pixels.
+    */
+    void SetGifPixelSize(UINT cxGifImage, UINT cyGifImage, UINT uPixelAspRatio);
+
     /*!
     * @brief Indicates whether is last frame.
     *
@@ -332,6 +402,9 @@ protected:
     IWICFormatConverter *m_pFormatConverter;            // The format converter.
     IWICBitmapDecoder   *m_pWicBitmapDecoder;           // The bitmap decoder.
     WIC_GIF_TYPE         m_curGifType;                  // Current gif type.
+    GIF_DECODE_BACKEND   m_decodeBackend;               // The decoder of the GIF files.
+    SdkGifDecoder       *m_pGifDecoder;                 // The portable decoder, NULL if WIC decodes the image.
+    vector<BYTE>         m_vctFramePixels;              // The pixels of the frame from the portable decoder.
 
     static IWICImagingFactory   *s_pImagingFactory;    // The WIC image factory.
 };
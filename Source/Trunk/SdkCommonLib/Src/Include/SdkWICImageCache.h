@@ -0,0 +1,168 @@
+/*!
+* @file SdkWICImageCache.h
+*
+* @brief This file defines SdkWICImageCache class to share the decoded images in the process.
+*
+* Copyright (C) 2011, LZT Corporation.
+*
+* @author Li Hong
+* @date 2011/06/29
+*/
+
+#ifdef __cplusplus
+#ifndef _SDKWICIMAGECACHE_H_
+#define _SDKWICIMAGECACHE_H_
+
+#include "SdkCommon.h"
+#include "SdkCommonMacro.h"
+
+BEGIN_NAMESPACE_UTILITIES
+
+typedef struct _WICIMAGECACHEENTRY  WICIMAGECACHEENTRY,  *LPWICIMAGECACHEENTRY;
+
+class SdkWICImageCacheLock;
+
+#define DEFAULT_WIC_IMAGE_CACHE_BUDGET          (64 * 1024 * 1024)      // The default bytes of cached pixels.
+
+/*!
+* @brief The statistics of the image cache.
+*/
+typedef struct _WICIMAGECACHESTATS
+{
+    UINT64      uHits;              // The number of lookups which find the image.
+    UINT64      uMisses;            // The number of lookups which do not find the image.
+    UINT64      uEvictions;         // The number of evicted images.
+    UINT64      uBytes;             // The bytes of the cached pixels.
+    UINT64      uBudget;            // The max bytes of the cached pixels.
+    UINT32      uEntries;           // The number of cached images.
+
+} WICIMAGECACHESTATS, *LPWICIMAGECACHESTATS;
+
+/*!
+* @brief This class keeps the decoded 32bpp bitmaps, so the same image file or resource
+*        which is shown by several views is decoded only once. The images are found by
+*        a key made of the source, its last write time, the target size and the pixel
+*        format, so a changed file gets a new key and its old image is evicted in time.
+*
+* @remark All functions are thread safe. The cached bitmaps are shared by their COM
+*         reference count, an evicted bitmap is released by the cache only and stays
+*         valid for the callers which still hold it. The bytes over the budget are
+*         evicted by the CLOCK algorithm, the images used since the last sweep are kept.
+*/
+class CLASS_DECLSPEC SdkWICImageCache
+{
+public:
+
+    /*!
+    * @brief Find the cached bitmap of the key.
+    *
+    * @param lpKey          [I/ ] The key made by MakeFileKey or MakeResourceKey.
+    * @param ppBitmap       [ /O] The bitmap, you should release it.
+    *
+    * @return TRUE if found, otherwise FALSE.
+    */
+    static BOOL Lookup(IN LPCWSTR lpKey, OUT IWICBitmap **ppBitmap);
+
+    /*!
+    * @brief Add a 32bpp bitmap to the cache, the old bitmap of the same key is replaced.
+    *
+    * @param lpKey          [I/ ] The key made by MakeFileKey or MakeResourceKey.
+    * @param pBitmap        [I/ ] The bitmap, the cache adds a reference to it.
+    *
+    * @return TRUE if the bitmap is cached, FALSE if the cache is disabled or the bitmap
+    *         is bigger than the budget.
+    */
+    static BOOL Insert(IN LPCWSTR lpKey, IN IWICBitmap *pBitmap);
+
+    /*!
+    * @brief Indicates whether an image of the size can be cached.
+    *
+    * @param uWidth         [I/ ] The width of the image.
+    * @param uHeight        [I/ ] The height of the image.
+    *
+    * @return TRUE if the cache is enabled and the image is not bigger than the budget.
+    */
+    static BOOL IsCacheable(IN UINT32 uWidth, IN UINT32 uHeight);
+
+    /*!
+    * @brief Make the key of an image file, the last write time of the file is a part of it.
+    *
+    * @param lpFile         [I/ ] The image file path.
+    * @param uDestWidth     [I/ ] The target width, 0 means the original width.
+    * @param uDestHeight    [I/ ] The target height, 0 means the original height.
+    * @param guidFormat     [I/ ] The pixel format of the decoded image.
+    * @param strKey         [ /O] The key.
+    *
+    * @return TRUE if succeeds, FALSE if the file does not exist.
+    */
+    static BOOL MakeFileKey(IN LPCWSTR lpFile, IN UINT32 uDestWidth, IN UINT32 uDestHeight,
+                            IN REFGUID guidFormat, OUT wstring& strKey);
+
+    /*!
+    * @brief Make the key of an image resource.
+    *
+    * @param hModule        [I/ ] The module which has the resource.
+    * @param lpType         [I/ ] The resource type name.
+    * @param uResId         [I/ ] The resource id.
+    * @param uDestWidth     [I/ ] The target width, 0 means the original width.
+    * @param uDestHeight    [I/ ] The target height, 0 means the original height.
+    * @param guidFormat     [I/ ] The pixel format of the decoded image.
+    * @param strKey         [ /O] The key.
+    */
+    static void MakeResourceKey(IN HMODULE hModule, IN LPCWSTR lpType, IN UINT uResId, IN UINT32 uDestWidth,
+                                IN UINT32 uDestHeight, IN REFGUID guidFormat, OUT wstring& strKey);
+
+    /*!
+    * @brief Set the max bytes of the cached pixels, the images over it are evicted.
+    *
+    * @param uBytes         [I/ ] The bytes, 0 disables the cache.
+    */
+    static void SetBudget(IN UINT64 uBytes);
+
+    /*!
+    * @brief Get the statistics of the cache.
+    *
+    * @param pStats         [ /O] The statistics.
+    */
+    static void GetStats(OUT LPWICIMAGECACHESTATS pStats);
+
+    /*!
+    * @brief Release all cached bitmaps, call it before the COM is uninitialized.
+    */
+    static void Clear();
+
+private:
+
+    /*!
+    * @brief Evict the images until the bytes of the cache and the new image fit the budget.
+    *
+    * @param uNewBytes      [I/ ] The bytes of the new image.
+    */
+    static void EvictEntries(IN UINT64 uNewBytes);
+
+    /*!
+    * @brief Remove the entry and release its bitmap, the clock still points to the same next entry.
+    *
+    * @param nIndex         [I/ ] The position of the entry in the clock.
+    */
+    static void RemoveEntry(IN size_t nIndex);
+
+private:
+
+    friend class SdkWICImageCacheLock;
+
+    static CRITICAL_SECTION                         s_csLock;           // The lock of the cache.
+    static UINT64                                   s_uBudget;          // The max bytes of the cached pixels.
+    static UINT64                                   s_uBytes;           // The bytes of the cached pixels.
+    static UINT64                                   s_uHits;            // The number of hits.
+    static UINT64                                   s_uMisses;          // The number of misses.
+    static UINT64                                   s_uEvictions;       // The number of evictions.
+    static size_t                                   s_nClockHand;       // The next entry to sweep.
+    static vector<LPWICIMAGECACHEENTRY>             s_vctEntries;       // The clock of the entries.
+    static map<wstring, LPWICIMAGECACHEENTRY>       s_mapEntries;       // The entries by the keys.
+};
+
+END_NAMESPACE_UTILITIES
+
+#endif // _SDKWICIMAGECACHE_H_
+#endif // __cplusplus
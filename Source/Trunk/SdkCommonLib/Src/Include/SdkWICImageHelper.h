@@ -31,6 +31,8 @@ typedef enum _WIC_IMAGE_TYPE
 
 } WIC_IMAGE_TYPE;
 
+#define MAX_WIC_REDUCED_DECODE_SCALE    8       // The max native downscale of the codecs, 1/8 by the JPEG DCT.
+
 /*!
 * @brief SdkWICImageHelper class definition.
 */
@@ -61,6 +63,22 @@ public:
     */
     static BOOL SaveWICBitmapToFile(PCWSTR pFileName, IWICBitmapSource *pWICBitmap);
 
+    /*!
+    * @brief Encode the 32bpp BGRA pixels to a file, the pixels are converted if the encoder
+    *        does not take the format, such as 24bpp of JPEG and the palette of GIF.
+    *
+    * @param pFileName      [I/ ] The file name.
+    * @param guidContainer  [I/ ] The container format, such as GUID_ContainerFormatPng.
+    * @param pPixels        [I/ ] The pixels, the alpha is not premultiplied.
+    * @param uWidth         [I/ ] The width of the image.
+    * @param uHeight        [I/ ] The height of the image.
+    * @param uStride        [I/ ] The bytes of one row of the pixels.
+    *
+    * @return S_OK if succeeds.
+    */
+    static HRESULT SavePixelsToFile(PCWSTR pFileName, REFGUID guidContainer, IN const BYTE *pPixels,
+                                    UINT32 uWidth, UINT32 uHeight, UINT32 uStride);
+
     /*!
     * @brief Create HBITMAP from specified WIC Bitmap source.
     *
@@ -68,6 +86,8 @@ public:
     * @param pWICBitmapSource   [I/ ] The WIC bitmap source.
     *
     * @return non-zero if succeed, otherwise returns zero.
+    *
+    * @remark The bitmap is a 32bpp top-down DIB section of BGRA pixels.
     */
     static HBITMAP CreateHBITMAPFromIWICBitmap(HDC hDC, IWICBitmapSource *pWICBitmapSource);
 
@@ -95,6 +115,41 @@ public:
     */
     BOOL LoadFromFile(LPCWSTR lpfile, UINT32 uDestWidth = 0, UINT32 uDestHeight = 0);
 
+    /*!
+    * @brief Load a low resolution preview of a image file, it is decoded only by the native
+    *        downscale of the codec, such as the DCT scaling of JPEG or the embedded thumbnail,
+    *        so it costs a small part of the full decoding. The preview is not scaled to the
+    *        destination bound, it should be stretched when it is drawn.
+    *
+    * @param lpfile         [I/ ] The pointer to file name.
+    * @param uDestWidth     [I/ ] The destination width of the full image.
+    * @param uDestHeight    [I/ ] The destination height of the full image.
+    * @param puFullWidth    [ /O] The width of the full image, can be NULL.
+    * @param puFullHeight   [ /O] The height of the full image, can be NULL.
+    *
+    * @return TRUE if succeeds, FALSE if the codec can not decode a reduced image or the full
+    *         image is cached already, the caller should call LoadFromFile then.
+    */
+    BOOL LoadPreviewFromFile(LPCWSTR lpfile, UINT32 uDestWidth = 0, UINT32 uDestHeight = 0,
+                             OUT UINT32 *puFullWidth = NULL, OUT UINT32 *puFullHeight = NULL);
+
+    /*!
+    * @brief Load a image which is scaled into the bound later, keeping its aspect ratio. It is
+    *        decoded by the native downscale of the codec to the smallest size which is not
+    *        smaller than the scaled size, or in full. The image is used once, such as by a
+    *        batch conversion, so it is not put into SdkWICImageCache.
+    *
+    * @param lpfile         [I/ ] The pointer to file name.
+    * @param uMaxWidth      [I/ ] The max width of the scaled image, 0 means no limit.
+    * @param uMaxHeight     [I/ ] The max height of the scaled image, 0 means no limit.
+    * @param puDestWidth    [ /O] The width of the scaled image, the image is never enlarged.
+    * @param puDestHeight   [ /O] The height of the scaled image.
+    *
+    * @return TRUE if succeeds, otherwise return FALSE.
+    */
+    BOOL LoadReducedFromFile(LPCWSTR lpfile, UINT32 uMaxWidth, UINT32 uMaxHeight,
+                             OUT UINT32 *puDestWidth, OUT UINT32 *puDestHeight);
+
     /*!
     * @brief Load a image from HBITMAP.
     *
@@ -179,6 +234,48 @@ public:
     */
     void ClearImageData();
 
+    /*!
+    * @brief Load the image from a bitmap source, such as a bitmap decoded by another thread.
+    *
+    * @param pSource        [I/ ] The bitmap source, the object adds a reference to it.
+    *
+    * @return TRUE if succeeds, otherwise return FALSE.
+    */
+    BOOL LoadFromWICBitmap(IN IWICBitmapSource *pSource);
+
+    /*!
+    * @brief Decode the converted image into a 32bppPBGRA bitmap, the bitmap can be used
+    *        by other threads after the object is released.
+    *
+    * @param ppBitmap       [ /O] The decoded bitmap, you should release it.
+    *
+    * @return S_OK if succeeds.
+    */
+    HRESULT DecodeToBitmap(OUT IWICBitmap **ppBitmap);
+
+    /*!
+    * @brief Get the number of frames of an image file, it only reads the file header.
+    *
+    * @param lpfile         [I/ ] The pointer to file name.
+    *
+    * @return The number of frames, 0 if the file can not be decoded.
+    */
+    static UINT GetFrameCount(LPCWSTR lpfile);
+
+    /*!
+    * @brief Get the native downscale which keeps the reduced image not smaller than the
+    *        destination, the reduced size is the source size divided by it and rounded up,
+    *        as the JPEG codecs do.
+    *
+    * @param uSrcWidth      [I/ ] The width of the source image.
+    * @param uSrcHeight     [I/ ] The height of the source image.
+    * @param uDestWidth     [I/ ] The destination width, 0 means the source width.
+    * @param uDestHeight    [I/ ] The destination height, 0 means the source height.
+    *
+    * @return 1, 2, 4 or 8, 1 means the image should be decoded in full.
+    */
+    static UINT32 GetReducedDecodeScale(UINT32 uSrcWidth, UINT32 uSrcHeight, UINT32 uDestWidth, UINT32 uDestHeight);
+
 private:
 
     /*!
@@ -218,6 +315,71 @@ private:
     */
     IWICBitmapScaler* CreateBitmapScaler(IN IWICBitmapSource* pWICBitmapSource, UINT32 uDestWidth, UINT32 uDestHeight);
 
+    /*!
+    * @brief Create the source of a decoded frame in the destination bound, the frame is decoded
+    *        in a reduced size by the codec first if it can, and then scaled.
+    *
+    * @param pFrame             [I/ ] The decoded frame.
+    * @param uDestWidth         [I/ ] The destination width, 0 means original width.
+    * @param uDestHeight        [I/ ] The destination height, 0 means original height.
+    * @param ppSource           [ /O] The bitmap source, you should release it.
+    *
+    * @return S_OK if succeeds.
+    */
+    HRESULT CreateFrameSource(IN IWICBitmapFrameDecode *pFrame, UINT32 uDestWidth, UINT32 uDestHeight,
+                              OUT IWICBitmapSource **ppSource);
+
+    /*!
+    * @brief Decode a frame in a reduced size by the codec, by IWICBitmapSourceTransform or
+    *        the embedded thumbnail, the reduced size is not smaller than the min bound.
+    *
+    * @param pFrame             [I/ ] The decoded frame.
+    * @param uMinWidth          [I/ ] The min width of the reduced image.
+    * @param uMinHeight         [I/ ] The min height of the reduced image.
+    * @param ppSource           [ /O] The reduced bitmap source, you should release it.
+    *
+    * @return S_OK if succeeds, S_FALSE if the codec can not reduce the frame to the bound.
+    */
+    HRESULT CreateReducedSource(IN IWICBitmapFrameDecode *pFrame, UINT32 uMinWidth, UINT32 uMinHeight,
+                                OUT IWICBitmapSource **ppSource);
+
+    /*!
+    * @brief Create the format converter which converts the source to 32bppPBGRA.
+    *
+    * @param pSource            [I/ ] The bitmap source.
+    *
+    * @return S_OK if succeeds.
+    */
+    HRESULT ResetFormatConverter(IN IWICBitmapSource *pSource);
+
+    /*!
+    * @brief Create the format converter from the cached image of the key.
+    *
+    * @param strKey             [I/ ] The key of the image in SdkWICImageCache.
+    *
+    * @return TRUE if the image is cached, otherwise return FALSE.
+    */
+    BOOL LoadFromCache(IN const wstring& strKey);
+
+    /*!
+    * @brief Decode the converted image into a bitmap and put it to SdkWICImageCache,
+    *        the format converter is reset to convert the bitmap.
+    *
+    * @param strKey             [I/ ] The key of the image in SdkWICImageCache.
+    */
+    void CacheConvertedImage(IN const wstring& strKey);
+
+    /*!
+    * @brief Create the encoder of the container format by the encoder information found in
+    *        WICInitialize, the installed encoders are not enumerated again.
+    *
+    * @param guidContainer      [I/ ] The container format.
+    * @param ppEncoder          [ /O] The encoder, you should release it.
+    *
+    * @return S_OK if succeeds.
+    */
+    static HRESULT CreateEncoder(REFGUID guidContainer, OUT IWICBitmapEncoder **ppEncoder);
+
 private:
 
     UINT                         m_uImageWidth;                 // The image width.
@@ -226,6 +388,7 @@ private:
     WIC_IMAGE_TYPE               m_curImageType;                // The current image type
     IWICFormatConverter         *m_pConvertedSourceBitmap;      // The format converter.
     static IWICImagingFactory   *s_pImagingFactory;             // The WIC image factory.
+    static vector<IWICBitmapEncoderInfo*> s_vctEncoderInfos;    // The information of the installed encoders.
 };
 
 END_NAMESPACE_UTILITIES
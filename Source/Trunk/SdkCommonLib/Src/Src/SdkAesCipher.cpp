@@ -0,0 +1,947 @@
+/*!
+* @file SdkAesCipher.cpp
+*
+* @brief This file defines SdkAesCipher class, the portable AES cipher backend.
+*
+* Copyright (C) 2011, LZT Corporation.
+*
+* @author Li Hong
+* @date 2011/06/14
+*/
+
+#include "stdafx.h"
+#include "SdkAesCipher.h"
+
+#if defined(_M_IX86) || defined(_M_X64) || defined(__i386__) || defined(__x86_64__)
+#define AES_HW_X86
+#include <emmintrin.h>
+#include <wmmintrin.h>
+#ifdef _MSC_VER
+#include <intrin.h>
+#else
+#include <cpuid.h>
+#endif // _MSC_VER
+#elif defined(_M_ARM64) || (defined(__aarch64__) && defined(__ARM_FEATURE_CRYPTO))
+#define AES_HW_ARMV8
+#ifdef _MSC_VER
+#include <arm64_neon.h>
+#else
+#include <arm_neon.h>
+#endif // _MSC_VER
+#endif
+
+// GCC and Clang need the target attribute to emit AES instructions without global options.
+#if defined(AES_HW_X86) && defined(__GNUC__)
+#define AES_HW_TARGET __attribute__((target("aes,sse2")))
+#else
+#define AES_HW_TARGET
+#endif
+
+USING_NAMESPACE_COMMON
+
+
+//////////////////////////////////////////////////////////////////////////
+//
+// The software implementation, there is no table lookup and no branch on secret data.
+// The S-box is computed by the Boyar-Peralta circuit on the bitsliced state.
+//
+//////////////////////////////////////////////////////////////////////////
+
+/*!
+* @brief Transpose the 8x8 bit matrix, the bit j of byte i is swapped with the bit i of byte j.
+*/
+static inline UINT64 AesTranspose8x8(UINT64 x)
+{
+    UINT64 t = 0;
+    t = (x ^ (x >> 7))  & 0x00AA00AA00AA00AAULL; x ^= t ^ (t << 7);
+    t = (x ^ (x >> 14)) & 0x0000CCCC0000CCCCULL; x ^= t ^ (t << 14);
+    t = (x ^ (x >> 28)) & 0x00000000F0F0F0F0ULL; x ^= t ^ (t << 28);
+    return x;
+}
+
+/*!
+* @brief The forward S-box on the bitsliced data, q[i] holds the bit i of every byte.
+*/
+static void AesBitsliceSbox(UINT32 *q)
+{
+    UINT32 x0, x1, x2, x3, x4, x5, x6, x7;
+    UINT32 y1, y2, y3, y4, y5, y6, y7, y8, y9;
+    UINT32 y10, y11, y12, y13, y14, y15, y16, y17, y18, y19;
+    UINT32 y20, y21;
+    UINT32 z0, z1, z2, z3, z4, z5, z6, z7, z8, z9;
+    UINT32 z10, z11, z12, z13, z14, z15, z16, z17;
+    UINT32 t0, t1, t2, t3, t4, t5, t6, t7, t8, t9;
+    UINT32 t10, t11, t12, t13, t14, t15, t16, t17, t18, t19;
+    UINT32 t20, t21, t22, t23, t24, t25, t26, t27, t28, t29;
+    UINT32 t30, t31, t32, t33, t34, t35, t36, t37, t38, t39;
+    UINT32 t40, t41, t42, t43, t44, t45, t46, t47, t48, t49;
+    UINT32 t50, t51, t52, t53, t54, t55, t56, t57, t58, t59;
+    UINT32 t60, t61, t62, t63, t64, t65, t66, t67;
+    UINT32 s0, s1, s2, s3, s4, s5, s6, s7;
+
+    x0 = q[7];
+    x1 = q[6];
+    x2 = q[5];
+    x3 = q[4];
+    x4 = q[3];
+    x5 = q[2];
+    x6 = q[1];
+    x7 = q[0];
+
+    // Top linear transformation.
+    y14 = x3 ^ x5;
+    y13 = x0 ^ x6;
+    y9  = x0 ^ x3;
+    y8  = x0 ^ x5;
+    t0  = x1 ^ x2;
+    y1  = t0 ^ x7;
+    y4  = y1 ^ x3;
+    y12 = y13 ^ y14;
+    y2  = y1 ^ x0;
+    y5  = y1 ^ x6;
+    y3  = y5 ^ y8;
+    t1  = x4 ^ y12;
+    y15 = t1 ^ x5;
+    y20 = t1 ^ x1;
+    y6  = y15 ^ x7;
+    y10 = y15 ^ t0;
+    y11 = y20 ^ y9;
+    y7  = x7 ^ y11;
+    y17 = y10 ^ y11;
+    y19 = y10 ^ y8;
+    y16 = t0 ^ y11;
+    y21 = y13 ^ y16;
+    y18 = x0 ^ y16;
+
+    // Non-linear section.
+    t2  = y12 & y15;
+    t3  = y3 & y6;
+    t4  = t3 ^ t2;
+    t5  = y4 & x7;
+    t6  = t5 ^ t2;
+    t7  = y13 & y16;
+    t8  = y5 & y1;
+    t9  = t8 ^ t7;
+    t10 = y2 & y7;
+    t11 = t10 ^ t7;
+    t12 = y9 & y11;
+    t13 = y14 & y17;
+    t14 = t13 ^ t12;
+    t15 = y8 & y10;
+    t16 = t15 ^ t12;
+    t17 = t4 ^ t14;
+    t18 = t6 ^ t16;
+    t19 = t9 ^ t14;
+    t20 = t11 ^ t16;
+    t21 = t17 ^ y20;
+    t22 = t18 ^ y19;
+    t23 = t19 ^ y21;
+    t24 = t20 ^ y18;
+
+    t25 = t21 ^ t22;
+    t26 = t21 & t23;
+    t27 = t24 ^ t26;
+    t28 = t25 & t27;
+    t29 = t28 ^ t22;
+    t30 = t23 ^ t24;
+    t31 = t22 ^ t26;
+    t32 = t31 & t30;
+    t33 = t32 ^ t24;
+    t34 = t23 ^ t33;
+    t35 = t27 ^ t33;
+    t36 = t24 & t35;
+    t37 = t36 ^ t34;
+    t38 = t27 ^ t36;
+    t39 = t29 & t38;
+    t40 = t25 ^ t39;
+
+    t41 = t40 ^ t37;
+    t42 = t29 ^ t33;
+    t43 = t29 ^ t40;
+    t44 = t33 ^ t37;
+    t45 = t42 ^ t41;
+    z0  = t44 & y15;
+    z1  = t37 & y6;
+    z2  = t33 & x7;
+    z3  = t43 & y16;
+    z4  = t40 & y1;
+    z5  = t29 & y7;
+    z6  = t42 & y11;
+    z7  = t45 & y17;
+    z8  = t41 & y10;
+    z9  = t44 & y12;
+    z10 = t37 & y3;
+    z11 = t33 & y4;
+    z12 = t43 & y13;
+    z13 = t40 & y5;
+    z14 = t29 & y2;
+    z15 = t42 & y9;
+    z16 = t45 & y14;
+    z17 = t41 & y8;
+
+    // Bottom linear transformation.
+    t46 = z15 ^ z16;
+    t47 = z10 ^ z11;
+    t48 = z5 ^ z13;
+    t49 = z9 ^ z10;
+    t50 = z2 ^ z12;
+    t51 = z2 ^ z5;
+    t52 = z7 ^ z8;
+    t53 = z0 ^ z3;
+    t54 = z6 ^ z7;
+    t55 = z16 ^ z17;
+    t56 = z12 ^ t48;
+    t57 = t50 ^ t53;
+    t58 = z4 ^ t46;
+    t59 = z3 ^ t54;
+    t60 = t46 ^ t57;
+    t61 = z14 ^ t57;
+    t62 = t52 ^ t58;
+    t63 = t49 ^ t58;
+    t64 = z4 ^ t59;
+    t65 = t61 ^ t62;
+    t66 = z1 ^ t63;
+    s0  = t59 ^ t63;
+    s6  = t56 ^ ~t62;
+    s7  = t48 ^ ~t60;
+    t67 = t64 ^ t65;
+    s3  = t53 ^ t66;
+    s4  = t51 ^ t66;
+    s5  = t47 ^ t65;
+    s1  = t64 ^ ~s3;
+    s2  = t55 ^ ~t67;
+
+    q[7] = s0;
+    q[6] = s1;
+    q[5] = s2;
+    q[4] = s3;
+    q[3] = s4;
+    q[2] = s5;
+    q[1] = s6;
+    q[0] = s7;
+}
+
+/*!
+* @brief The inverse affine transformation, it is applied before and after the forward
+*        S-box to get the inverse S-box.
+*/
+static inline void AesBitsliceInvAffine(UINT32 *q)
+{
+    UINT32 q0 = ~q[0];
+    UINT32 q1 = ~q[1];
+    UINT32 q2 = q[2];
+    UINT32 q3 = q[3];
+    UINT32 q4 = q[4];
+    UINT32 q5 = ~q[5];
+    UINT32 q6 = ~q[6];
+    UINT32 q7 = q[7];
+
+    q[7] = q1 ^ q4 ^ q6;
+    q[6] = q0 ^ q3 ^ q5;
+    q[5] = q7 ^ q2 ^ q4;
+    q[4] = q6 ^ q1 ^ q3;
+    q[3] = q5 ^ q0 ^ q2;
+    q[2] = q4 ^ q7 ^ q1;
+    q[1] = q3 ^ q6 ^ q0;
+    q[0] = q2 ^ q5 ^ q7;
+}
+
+/*!
+* @brief Substitute the 16 bytes of the state, the state is sliced to 8 bit planes of 16 bits.
+*/
+static void AesSubBytes(BYTE *pbState, BOOL isInverse)
+{
+    UINT64 lo = 0;
+    UINT64 hi = 0;
+    memcpy(&lo, pbState, 8);
+    memcpy(&hi, pbState + 8, 8);
+    lo = AesTranspose8x8(lo);
+    hi = AesTranspose8x8(hi);
+
+    UINT32 q[8] = { 0 };
+    for (int i = 0; i < 8; ++i)
+    {
+        q[i] = (UINT32)((lo >> (i * 8)) & 0xFF) | ((UINT32)((hi >> (i * 8)) & 0xFF) << 8);
+    }
+
+    if (isInverse)
+    {
+        AesBitsliceInvAffine(q);
+        AesBitsliceSbox(q);
+        AesBitsliceInvAffine(q);
+    }
+    else
+    {
+        AesBitsliceSbox(q);
+    }
+
+    lo = 0;
+    hi = 0;
+    for (int i = 0; i < 8; ++i)
+    {
+        lo |= (UINT64)(q[i] & 0xFF) << (i * 8);
+        hi |= (UINT64)((q[i] >> 8) & 0xFF) << (i * 8);
+    }
+
+    lo = AesTranspose8x8(lo);
+    hi = AesTranspose8x8(hi);
+    memcpy(pbState, &lo, 8);
+    memcpy(pbState + 8, &hi, 8);
+}
+
+/*!
+* @brief Shift the rows of the state, the state is stored by columns.
+*/
+static inline void AesShiftRows(BYTE *pbState, BOOL isInverse)
+{
+    BYTE cbTemp[AES_BLOCK_SIZE];
+    memcpy(cbTemp, pbState, AES_BLOCK_SIZE);
+
+    for (int c = 0; c < 4; ++c)
+    {
+        for (int r = 1; r < 4; ++r)
+        {
+            int nSrc = isInverse ? ((c - r + 4) & 3) : ((c + r) & 3);
+            pbState[r + 4 * c] = cbTemp[r + 4 * nSrc];
+        }
+    }
+}
+
+/*!
+* @brief Multiply every byte of the word by x in GF(2^8).
+*/
+static inline UINT32 AesXtime4(UINT32 w)
+{
+    return ((w & 0x7F7F7F7F) << 1) ^ (((w >> 7) & 0x01010101) * 0x1B);
+}
+
+/*!
+* @brief Rotate the word right, the bytes are the rows of a column.
+*/
+static inline UINT32 AesRotr(UINT32 w, int nBits)
+{
+    return (w >> nBits) | (w << (32 - nBits));
+}
+
+/*!
+* @brief Mix the columns of the state.
+*/
+static inline void AesMixColumns(BYTE *pbState, BOOL isInverse)
+{
+    for (int c = 0; c < 4; ++c)
+    {
+        UINT32 w = 0;
+        memcpy(&w, pbState + 4 * c, 4);
+
+        if (isInverse)
+        {
+            // The inverse matrix is the forward matrix multiplied by (4x^2 + 5).
+            w ^= AesXtime4(AesXtime4(w ^ AesRotr(w, 16)));
+        }
+
+        UINT32 r1 = AesRotr(w, 8);
+        w = AesXtime4(w ^ r1) ^ r1 ^ AesRotr(w, 16) ^ AesRotr(w, 24);
+
+        memcpy(pbState + 4 * c, &w, 4);
+    }
+}
+
+/*!
+* @brief XOR the block with the round key.
+*/
+static inline void AesXorBlock(BYTE *pbDest, const BYTE *pbSrc)
+{
+    for (int i = 0; i < AES_BLOCK_SIZE; ++i)
+    {
+        pbDest[i] ^= pbSrc[i];
+    }
+}
+
+
+//////////////////////////////////////////////////////////////////////////
+//
+// The hardware implementation.
+//
+//////////////////////////////////////////////////////////////////////////
+
+#if defined(AES_HW_X86)
+
+AES_HW_TARGET static void AesHwEncryptBlock(const BYTE *pbKeys, DWORD dwRounds, const BYTE *pbIn, BYTE *pbOut)
+{
+    __m128i b = _mm_loadu_si128((const __m128i*)pbIn);
+    b = _mm_xor_si128(b, _mm_loadu_si128((const __m128i*)pbKeys));
+    for (DWORD r = 1; r < dwRounds; ++r)
+    {
+        b = _mm_aesenc_si128(b, _mm_loadu_si128((const __m128i*)(pbKeys + r * AES_BLOCK_SIZE)));
+    }
+    b = _mm_aesenclast_si128(b, _mm_loadu_si128((const __m128i*)(pbKeys + dwRounds * AES_BLOCK_SIZE)));
+    _mm_storeu_si128((__m128i*)pbOut, b);
+}
+
+AES_HW_TARGET static void AesHwEncryptECB(const BYTE *pbKeys, DWORD dwRounds, const BYTE *pbIn, BYTE *pbOut, DWORD dwBlocks)
+{
+    __m128i rk[AES_MAX_ROUNDS + 1];
+    for (DWORD r = 0; r <= dwRounds; ++r)
+    {
+        rk[r] = _mm_loadu_si128((const __m128i*)(pbKeys + r * AES_BLOCK_SIZE));
+    }
+
+    DWORD i = 0;
+    for (; i + 4 <= dwBlocks; i += 4, pbIn += 4 * AES_BLOCK_SIZE, pbOut += 4 * AES_BLOCK_SIZE)
+    {
+        __m128i b0 = _mm_xor_si128(_mm_loadu_si128((const __m128i*)(pbIn)),      rk[0]);
+        __m128i b1 = _mm_xor_si128(_mm_loadu_si128((const __m128i*)(pbIn + 16)), rk[0]);
+        __m128i b2 = _mm_xor_si128(_mm_loadu_si128((const __m128i*)(pbIn + 32)), rk[0]);
+        __m128i b3 = _mm_xor_si128(_mm_loadu_si128((const __m128i*)(pbIn + 48)), rk[0]);
+        for (DWORD r = 1; r < dwRounds; ++r)
+        {
+            b0 = _mm_aesenc_si128(b0, rk[r]);
+            b1 = _mm_aesenc_si128(b1, rk[r]);
+            b2 = _mm_aesenc_si128(b2, rk[r]);
+            b3 = _mm_aesenc_si128(b3, rk[r]);
+        }
+        _mm_storeu_si128((__m128i*)(pbOut),      _mm_aesenclast_si128(b0, rk[dwRounds]));
+        _mm_storeu_si128((__m128i*)(pbOut + 16), _mm_aesenclast_si128(b1, rk[dwRounds]));
+        _mm_storeu_si128((__m128i*)(pbOut + 32), _mm_aesenclast_si128(b2, rk[dwRounds]));
+        _mm_storeu_si128((__m128i*)(pbOut + 48), _mm_aesenclast_si128(b3, rk[dwRounds]));
+    }
+
+    for (; i < dwBlocks; ++i, pbIn += AES_BLOCK_SIZE, pbOut += AES_BLOCK_SIZE)
+    {
+        AesHwEncryptBlock(pbKeys, dwRounds, pbIn, pbOut);
+    }
+}
+
+AES_HW_TARGET static void AesHwEncryptCBC(const BYTE *pbKeys, DWORD dwRounds, BYTE *pbChain, BYTE *pbData, DWORD dwBlocks)
+{
+    __m128i rk[AES_MAX_ROUNDS + 1];
+    for (DWORD r = 0; r <= dwRounds; ++r)
+    {
+        rk[r] = _mm_loadu_si128((const __m128i*)(pbKeys + r * AES_BLOCK_SIZE));
+    }
+
+    // Every block depends on the previous one, so the encryption is serial.
+    __m128i c = _mm_loadu_si128((const __m128i*)pbChain);
+    for (DWORD i = 0; i < dwBlocks; ++i, pbData += AES_BLOCK_SIZE)
+    {
+        __m128i b = _mm_xor_si128(_mm_loadu_si128((const __m128i*)pbData), c);
+        b = _mm_xor_si128(b, rk[0]);
+        for (DWORD r = 1; r < dwRounds; ++r)
+        {
+            b = _mm_aesenc_si128(b, rk[r]);
+        }
+        c = _mm_aesenclast_si128(b, rk[dwRounds]);
+        _mm_storeu_si128((__m128i*)pbData, c);
+    }
+    _mm_storeu_si128((__m128i*)pbChain, c);
+}
+
+AES_HW_TARGET static void AesHwDecryptCBC(const BYTE *pbKeys, DWORD dwRounds, BYTE *pbChain, BYTE *pbData, DWORD dwBlocks)
+{
+    __m128i rk[AES_MAX_ROUNDS + 1];
+    for (DWORD r = 0; r <= dwRounds; ++r)
+    {
+        rk[r] = _mm_loadu_si128((const __m128i*)(pbKeys + r * AES_BLOCK_SIZE));
+    }
+
+    __m128i prev = _mm_loadu_si128((const __m128i*)pbChain);
+    DWORD i = 0;
+
+    // The blocks are independent in decryption, four blocks are interleaved to fill the pipeline.
+    for (; i + 4 <= dwBlocks; i += 4, pbData += 4 * AES_BLOCK_SIZE)
+    {
+        __m128i c0 = _mm_loadu_si128((const __m128i*)(pbData));
+        __m128i c1 = _mm_loadu_si128((const __m128i*)(pbData + 16));
+        __m128i c2 = _mm_loadu_si128((const __m128i*)(pbData + 32));
+        __m128i c3 = _mm_loadu_si128((const __m128i*)(pbData + 48));
+        __m128i b0 = _mm_xor_si128(c0, rk[0]);
+        __m128i b1 = _mm_xor_si128(c1, rk[0]);
+        __m128i b2 = _mm_xor_si128(c2, rk[0]);
+        __m128i b3 = _mm_xor_si128(c3, rk[0]);
+        for (DWORD r = 1; r < dwRounds; ++r)
+        {
+            b0 = _mm_aesdec_si128(b0, rk[r]);
+            b1 = _mm_aesdec_si128(b1, rk[r]);
+            b2 = _mm_aesdec_si128(b2, rk[r]);
+            b3 = _mm_aesdec_si128(b3, rk[r]);
+        }
+        b0 = _mm_aesdeclast_si128(b0, rk[dwRounds]);
+        b1 = _mm_aesdeclast_si128(b1, rk[dwRounds]);
+        b2 = _mm_aesdeclast_si128(b2, rk[dwRounds]);
+        b3 = _mm_aesdeclast_si128(b3, rk[dwRounds]);
+        _mm_storeu_si128((__m128i*)(pbData),      _mm_xor_si128(b0, prev));
+        _mm_storeu_si128((__m128i*)(pbData + 16), _mm_xor_si128(b1, c0));
+        _mm_storeu_si128((__m128i*)(pbData + 32), _mm_xor_si128(b2, c1));
+        _mm_storeu_si128((__m128i*)(pbData + 48), _mm_xor_si128(b3, c2));
+        prev = c3;
+    }
+
+    for (; i < dwBlocks; ++i, pbData += AES_BLOCK_SIZE)
+    {
+        __m128i c = _mm_loadu_si128((const __m128i*)pbData);
+        __m128i b = _mm_xor_si128(c, rk[0]);
+        for (DWORD r = 1; r < dwRounds; ++r)
+        {
+            b = _mm_aesdec_si128(b, rk[r]);
+        }
+        b = _mm_aesdeclast_si128(b, rk[dwRounds]);
+        _mm_storeu_si128((__m128i*)pbData, _mm_xor_si128(b, prev));
+        prev = c;
+    }
+    _mm_storeu_si128((__m128i*)pbChain, prev);
+}
+
+#elif defined(AES_HW_ARMV8)
+
+static void AesHwEncryptBlock(const BYTE *pbKeys, DWORD dwRounds, const BYTE *pbIn, BYTE *pbOut)
+{
+    uint8x16_t b = vld1q_u8(pbIn);
+    for (DWORD r = 0; r + 1 < dwRounds; ++r)
+    {
+        b = vaesmcq_u8(vaeseq_u8(b, vld1q_u8(pbKeys + r * AES_BLOCK_SIZE)));
+    }
+    b = vaeseq_u8(b, vld1q_u8(pbKeys + (dwRounds - 1) * AES_BLOCK_SIZE));
+    b = veorq_u8(b, vld1q_u8(pbKeys + dwRounds * AES_BLOCK_SIZE));
+    vst1q_u8(pbOut, b);
+}
+
+static void AesHwEncryptECB(const BYTE *pbKeys, DWORD dwRounds, const BYTE *pbIn, BYTE *pbOut, DWORD dwBlocks)
+{
+    for (DWORD i = 0; i < dwBlocks; ++i, pbIn += AES_BLOCK_SIZE, pbOut += AES_BLOCK_SIZE)
+    {
+        AesHwEncryptBlock(pbKeys, dwRounds, pbIn, pbOut);
+    }
+}
+
+static void AesHwEncryptCBC(const BYTE *pbKeys, DWORD dwRounds, BYTE *pbChain, BYTE *pbData, DWORD dwBlocks)
+{
+    uint8x16_t rk[AES_MAX_ROUNDS + 1];
+    for (DWORD r = 0; r <= dwRounds; ++r)
+    {
+        rk[r] = vld1q_u8(pbKeys + r * AES_BLOCK_SIZE);
+    }
+
+    uint8x16_t c = vld1q_u8(pbChain);
+    for (DWORD i = 0; i < dwBlocks; ++i, pbData += AES_BLOCK_SIZE)
+    {
+        uint8x16_t b = veorq_u8(vld1q_u8(pbData), c);
+        for (DWORD r = 0; r + 1 < dwRounds; ++r)
+        {
+            b = vaesmcq_u8(vaeseq_u8(b, rk[r]));
+        }
+        b = vaeseq_u8(b, rk[dwRounds - 1]);
+        c = veorq_u8(b, rk[dwRounds]);
+        vst1q_u8(pbData, c);
+    }
+    vst1q_u8(pbChain, c);
+}
+
+static void AesHwDecryptCBC(const BYTE *pbKeys, DWORD dwRounds, BYTE *pbChain, BYTE *pbData, DWORD dwBlocks)
+{
+    uint8x16_t rk[AES_MAX_ROUNDS + 1];
+    for (DWORD r = 0; r <= dwRounds; ++r)
+    {
+        rk[r] = vld1q_u8(pbKeys + r * AES_BLOCK_SIZE);
+    }
+
+    uint8x16_t prev = vld1q_u8(pbChain);
+    for (DWORD i = 0; i < dwBlocks; ++i, pbData += AES_BLOCK_SIZE)
+    {
+        uint8x16_t c = vld1q_u8(pbData);
+        uint8x16_t b = c;
+        for (DWORD r = 0; r + 1 < dwRounds; ++r)
+        {
+            b = vaesimcq_u8(vaesdq_u8(b, rk[r]));
+        }
+        b = vaesdq_u8(b, rk[dwRounds - 1]);
+        b = veorq_u8(b, rk[dwRounds]);
+        vst1q_u8(pbData, veorq_u8(b, prev));
+        prev = c;
+    }
+    vst1q_u8(pbChain, prev);
+}
+
+#endif
+
+
+//////////////////////////////////////////////////////////////////////////
+
+BOOL SdkAesCipher::IsHardwareSupported()
+{
+#if defined(AES_HW_X86)
+#ifdef _MSC_VER
+    int cpuInfo[4] = { 0 };
+    __cpuid(cpuInfo, 1);
+    return (0 != (cpuInfo[2] & (1 << 25))) ? TRUE : FALSE;
+#else
+    unsigned int eax = 0, ebx = 0, ecx = 0, edx = 0;
+    if (!__get_cpuid(1, &eax, &ebx, &ecx, &edx))
+    {
+        return FALSE;
+    }
+    return (0 != (ecx & (1 << 25))) ? TRUE : FALSE;
+#endif // _MSC_VER
+#elif defined(AES_HW_ARMV8)
+#ifdef _MSC_VER
+    return IsProcessorFeaturePresent(PF_ARM_V8_CRYPTO_INSTRUCTIONS_AVAILABLE);
+#else
+    return TRUE;
+#endif // _MSC_VER
+#else
+    return FALSE;
+#endif
+}
+
+//////////////////////////////////////////////////////////////////////////
+
+SdkAesCipher::SdkAesCipher(IN const BYTE *pbKey, IN DWORD dwKeySize, IN BOOL isUseHardware) : m_isValid(FALSE),
+                                                                                              m_isUseHardware(FALSE),
+                                                                                              m_dwRounds(0)
+{
+    ZeroMemory(m_cbEncKeys, sizeof(m_cbEncKeys));
+    ZeroMemory(m_cbDecKeys, sizeof(m_cbDecKeys));
+    ZeroMemory(m_cbIV,      sizeof(m_cbIV));
+    ZeroMemory(m_cbChain,   sizeof(m_cbChain));
+
+    if ( (NULL != pbKey) && ((16 == dwKeySize) || (24 == dwKeySize) || (32 == dwKeySize)) )
+    {
+        ExpandKey(pbKey, dwKeySize);
+        m_isValid = TRUE;
+        m_isUseHardware = isUseHardware && IsHardwareSupported();
+    }
+}
+
+//////////////////////////////////////////////////////////////////////////
+
+SdkAesCipher::SdkAesCipher(IN const SdkAesCipher& srcCipher) : m_isValid(srcCipher.m_isValid),
+                                                               m_isUseHardware(srcCipher.m_isUseHardware),
+                                                               m_dwRounds(srcCipher.m_dwRounds)
+{
+    memcpy(m_cbEncKeys, srcCipher.m_cbEncKeys, sizeof(m_cbEncKeys));
+    memcpy(m_cbDecKeys, srcCipher.m_cbDecKeys, sizeof(m_cbDecKeys));
+    memcpy(m_cbIV,      srcCipher.m_cbIV,      sizeof(m_cbIV));
+    memcpy(m_cbChain,   srcCipher.m_cbIV,      sizeof(m_cbChain));
+}
+
+//////////////////////////////////////////////////////////////////////////
+
+SdkAesCipher::~SdkAesCipher()
+{
+    SecureZeroMemory(m_cbEncKeys, sizeof(m_cbEncKeys));
+    SecureZeroMemory(m_cbDecKeys, sizeof(m_cbDecKeys));
+    SecureZeroMemory(m_cbChain,   sizeof(m_cbChain));
+}
+
+//////////////////////////////////////////////////////////////////////////
+
+BOOL SdkAesCipher::IsValid() const
+{
+    return m_isValid;
+}
+
+//////////////////////////////////////////////////////////////////////////
+
+BOOL SdkAesCipher::IsUseHardware() const
+{
+    return m_isUseHardware;
+}
+
+//////////////////////////////////////////////////////////////////////////
+
+void SdkAesCipher::EncryptBlocksCBC(IN OUT PBYTE pbData, IN DWORD dwBlocks)
+{
+#if defined(AES_HW_X86) || defined(AES_HW_ARMV8)
+    if (m_isUseHardware)
+    {
+        AesHwEncryptCBC(m_cbEncKeys, m_dwRounds, m_cbChain, pbData, dwBlocks);
+        return;
+    }
+#endif
+
+    for (DWORD i = 0; i < dwBlocks; ++i, pbData += AES_BLOCK_SIZE)
+    {
+        AesXorBlock(pbData, m_cbChain);
+        EncryptBlockSoft(pbData, pbData);
+        memcpy(m_cbChain, pbData, AES_BLOCK_SIZE);
+    }
+}
+
+//////////////////////////////////////////////////////////////////////////
+
+void SdkAesCipher::DecryptBlocksCBC(IN OUT PBYTE pbData, IN DWORD dwBlocks)
+{
+#if defined(AES_HW_X86) || defined(AES_HW_ARMV8)
+    if (m_isUseHardware)
+    {
+        AesHwDecryptCBC(m_cbDecKeys, m_dwRounds, m_cbChain, pbData, dwBlocks);
+        return;
+    }
+#endif
+
+    BYTE cbCipher[AES_BLOCK_SIZE];
+    for (DWORD i = 0; i < dwBlocks; ++i, pbData += AES_BLOCK_SIZE)
+    {
+        memcpy(cbCipher, pbData, AES_BLOCK_SIZE);
+        DecryptBlockSoft(pbData, pbData);
+        AesXorBlock(pbData, m_cbChain);
+        memcpy(m_cbChain, cbCipher, AES_BLOCK_SIZE);
+    }
+}
+
+//////////////////////////////////////////////////////////////////////////
+
+void SdkAesCipher::EncryptBlocksECB(IN const BYTE *pbIn, OUT PBYTE pbOut, IN DWORD dwBlocks) const
+{
+#if defined(AES_HW_X86) || defined(AES_HW_ARMV8)
+    if (m_isUseHardware)
+    {
+        AesHwEncryptECB(m_cbEncKeys, m_dwRounds, pbIn, pbOut, dwBlocks);
+        return;
+    }
+#endif
+
+    for (DWORD i = 0; i < dwBlocks; ++i, pbIn += AES_BLOCK_SIZE, pbOut += AES_BLOCK_SIZE)
+    {
+        EncryptBlockSoft(pbIn, pbOut);
+    }
+}
+
+//////////////////////////////////////////////////////////////////////////
+
+BOOL SdkAesCipher::SetIV(IN const BYTE *pbIV)
+{
+    if (NULL == pbIV)
+    {
+        return FALSE;
+    }
+
+    memcpy(m_cbIV,    pbIV, AES_BLOCK_SIZE);
+    memcpy(m_cbChain, pbIV, AES_BLOCK_SIZE);
+
+    return TRUE;
+}
+
+//////////////////////////////////////////////////////////////////////////
+
+BOOL SdkAesCipher::Encrypt(IN OUT PBYTE pbData, IN OUT DWORD *pdwDataLen, IN DWORD dwBufLen, IN BOOL isFinal)
+{
+    if ( !m_isValid || (NULL == pbData) || (NULL == pdwDataLen) )
+    {
+        return FALSE;
+    }
+
+    DWORD dwDataLen = (*pdwDataLen);
+    if (isFinal)
+    {
+        // PKCS#5 padding, a full block is appended if the data is aligned.
+        DWORD dwPadding = AES_BLOCK_SIZE - (dwDataLen % AES_BLOCK_SIZE);
+        if (dwDataLen + dwPadding > dwBufLen)
+        {
+            return FALSE;
+        }
+
+        memset(pbData + dwDataLen, (int)dwPadding, dwPadding);
+        dwDataLen += dwPadding;
+    }
+    else if (0 != (dwDataLen % AES_BLOCK_SIZE))
+    {
+        return FALSE;
+    }
+
+    EncryptBlocksCBC(pbData, dwDataLen / AES_BLOCK_SIZE);
+    (*pdwDataLen) = dwDataLen;
+
+    // The chain restarts after the last section, the same as CryptEncrypt.
+    if (isFinal)
+    {
+        memcpy(m_cbChain, m_cbIV, AES_BLOCK_SIZE);
+    }
+
+    return TRUE;
+}
+
+//////////////////////////////////////////////////////////////////////////
+
+BOOL SdkAesCipher::Decrypt(IN OUT PBYTE pbData, IN OUT DWORD *pdwDataLen, IN BOOL isFinal)
+{
+    if ( !m_isValid || (NULL == pbData) || (NULL == pdwDataLen) )
+    {
+        return FALSE;
+    }
+
+    DWORD dwDataLen = (*pdwDataLen);
+    if (0 != (dwDataLen % AES_BLOCK_SIZE))
+    {
+        return FALSE;
+    }
+
+    DecryptBlocksCBC(pbData, dwDataLen / AES_BLOCK_SIZE);
+
+    if (isFinal)
+    {
+        memcpy(m_cbChain, m_cbIV, AES_BLOCK_SIZE);
+
+        if (0 == dwDataLen)
+        {
+            return FALSE;
+        }
+
+        // Check the padding without branch on every byte.
+        DWORD dwPadding = pbData[dwDataLen - 1];
+        if ( (0 == dwPadding) || (dwPadding > AES_BLOCK_SIZE) )
+        {
+            return FALSE;
+        }
+
+        BYTE cbDiff = 0;
+        for (DWORD i = 0; i < dwPadding; ++i)
+        {
+            cbDiff |= pbData[dwDataLen - 1 - i] ^ (BYTE)dwPadding;
+        }
+
+        if (0 != cbDiff)
+        {
+            return FALSE;
+        }
+
+        dwDataLen -= dwPadding;
+    }
+
+    (*pdwDataLen) = dwDataLen;
+
+    return TRUE;
+}
+
+//////////////////////////////////////////////////////////////////////////
+
+BOOL SdkAesCipher::EncryptBlock(IN const BYTE *pbIn, OUT BYTE *pbOut)
+{
+    if ( !m_isValid || (NULL == pbIn) || (NULL == pbOut) )
+    {
+        return FALSE;
+    }
+
+#if defined(AES_HW_X86) || defined(AES_HW_ARMV8)
+    if (m_isUseHardware)
+    {
+        AesHwEncryptBlock(m_cbEncKeys, m_dwRounds, pbIn, pbOut);
+        return TRUE;
+    }
+#endif
+
+    EncryptBlockSoft(pbIn, pbOut);
+
+    return TRUE;
+}
+
+//////////////////////////////////////////////////////////////////////////
+
+ICryptBackend* SdkAesCipher::Clone()
+{
+    return new SdkAesCipher(*this);
+}
+
+//////////////////////////////////////////////////////////////////////////
+
+LPCTSTR SdkAesCipher::GetName() const
+{
+    return m_isUseHardware ? _T("AES instructions") : _T("Constant-time software");
+}
+
+//////////////////////////////////////////////////////////////////////////
+
+void SdkAesCipher::ExpandKey(IN const BYTE *pbKey, IN DWORD dwKeySize)
+{
+    DWORD dwKeyWords = dwKeySize / 4;
+    DWORD dwTotalWords = 4 * (dwKeyWords + 7);
+    m_dwRounds = dwKeyWords + 6;
+
+    memcpy(m_cbEncKeys, pbKey, dwKeySize);
+
+    BYTE cbRcon = 0x01;
+    for (DWORD i = dwKeyWords; i < dwTotalWords; ++i)
+    {
+        // The S-box only works on whole blocks, so the word is put in a block.
+        BYTE cbTemp[AES_BLOCK_SIZE] = { 0 };
+        memcpy(cbTemp, m_cbEncKeys + (i - 1) * 4, 4);
+
+        if (0 == (i % dwKeyWords))
+        {
+            BYTE cbFirst = cbTemp[0];
+            cbTemp[0] = cbTemp[1];
+            cbTemp[1] = cbTemp[2];
+            cbTemp[2] = cbTemp[3];
+            cbTemp[3] = cbFirst;
+            AesSubBytes(cbTemp, FALSE);
+            cbTemp[0] ^= cbRcon;
+            cbRcon = (BYTE)((cbRcon << 1) ^ ((cbRcon & 0x80) ? 0x1B : 0x00));
+        }
+        else if ( (dwKeyWords > 6) && (4 == (i % dwKeyWords)) )
+        {
+            AesSubBytes(cbTemp, FALSE);
+        }
+
+        for (DWORD j = 0; j < 4; ++j)
+        {
+            m_cbEncKeys[i * 4 + j] = m_cbEncKeys[(i - dwKeyWords) * 4 + j] ^ cbTemp[j];
+        }
+
+        SecureZeroMemory(cbTemp, sizeof(cbTemp));
+    }
+
+    // The round keys of the equivalent inverse cipher, used by the AES instructions.
+    memcpy(m_cbDecKeys, m_cbEncKeys + m_dwRounds * AES_BLOCK_SIZE, AES_BLOCK_SIZE);
+    for (DWORD r = 1; r < m_dwRounds; ++r)
+    {
+        PBYTE pbDecKey = m_cbDecKeys + r * AES_BLOCK_SIZE;
+        memcpy(pbDecKey, m_cbEncKeys + (m_dwRounds - r) * AES_BLOCK_SIZE, AES_BLOCK_SIZE);
+        AesMixColumns(pbDecKey, TRUE);
+    }
+    memcpy(m_cbDecKeys + m_dwRounds * AES_BLOCK_SIZE, m_cbEncKeys, AES_BLOCK_SIZE);
+}
+
+//////////////////////////////////////////////////////////////////////////
+
+void SdkAesCipher::EncryptBlockSoft(IN const BYTE *pbIn, OUT BYTE *pbOut) const
+{
+    BYTE cbState[AES_BLOCK_SIZE];
+    memcpy(cbState, pbIn, AES_BLOCK_SIZE);
+    AesXorBlock(cbState, m_cbEncKeys);
+
+    for (DWORD r = 1; r <= m_dwRounds; ++r)
+    {
+        AesSubBytes(cbState, FALSE);
+        AesShiftRows(cbState, FALSE);
+        if (r < m_dwRounds)
+        {
+            AesMixColumns(cbState, FALSE);
+        }
+        AesXorBlock(cbState, m_cbEncKeys + r * AES_BLOCK_SIZE);
+    }
+
+    memcpy(pbOut, cbState, AES_BLOCK_SIZE);
+    SecureZeroMemory(cbState, sizeof(cbState));
+}
+
+//////////////////////////////////////////////////////////////////////////
+
+void SdkAesCipher::DecryptBlockSoft(IN const BYTE *pbIn, OUT BYTE *pbOut) const
+{
+    BYTE cbState[AES_BLOCK_SIZE];
+    memcpy(cbState, pbIn, AES_BLOCK_SIZE);
+    AesXorBlock(cbState, m_cbEncKeys + m_dwRounds * AES_BLOCK_SIZE);
+
+    for (DWORD r = m_dwRounds; r > 0; --r)
+    {
+        AesShiftRows(cbState, TRUE);
+        AesSubBytes(cbState, TRUE);
+        AesXorBlock(cbState, m_cbEncKeys + (r - 1) * AES_BLOCK_SIZE);
+        if (r > 1)
+        {
+            AesMixColumns(cbState, TRUE);
+        }
+    }
+
+    memcpy(pbOut, cbState, AES_BLOCK_SIZE);
+    SecureZeroMemory(cbState, sizeof(cbState));
+}
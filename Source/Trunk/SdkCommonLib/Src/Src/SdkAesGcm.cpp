@@ -0,0 +1,398 @@
+/*!
+* @file SdkAesGcm.cpp
+*
+* @brief This file defines SdkAesGcm class, the AES-GCM authenticated cipher.
+*
+* Copyright (C) 2011, LZT Corporation.
+*
+* @author Li Hong
+* @date 2011/06/18
+*/
+
+#include "stdafx.h"
+#include "SdkAesGcm.h"
+
+#if defined(_M_IX86) || defined(_M_X64) || defined(__i386__) || defined(__x86_64__)
+#define GCM_HW_X86
+#include <emmintrin.h>
+#include <tmmintrin.h>
+#include <wmmintrin.h>
+#ifdef _MSC_VER
+#include <intrin.h>
+#else
+#include <cpuid.h>
+#endif // _MSC_VER
+#endif
+
+// GCC and Clang need the target attribute to emit PCLMULQDQ without global options.
+#if defined(GCM_HW_X86) && defined(__GNUC__)
+#define GCM_HW_TARGET __attribute__((target("pclmul,ssse3,sse2")))
+#else
+#define GCM_HW_TARGET
+#endif
+
+#define GCM_CTR_BATCH_BLOCKS        64      // The counter blocks encrypted in one batch.
+
+USING_NAMESPACE_COMMON
+
+
+//////////////////////////////////////////////////////////////////////////
+
+static inline UINT64 GcmLoadBE64(const BYTE *pb)
+{
+    UINT64 v = 0;
+    for (int i = 0; i < 8; ++i)
+    {
+        v = (v << 8) | pb[i];
+    }
+    return v;
+}
+
+static inline void GcmStoreBE64(BYTE *pb, UINT64 v)
+{
+    for (int i = 7; i >= 0; --i)
+    {
+        pb[i] = (BYTE)v;
+        v >>= 8;
+    }
+}
+
+/*!
+* @brief Multiply X by H in GF(2^128), the loop does not branch on the data.
+*/
+static void GcmMultiplySoft(UINT64 *pX, const UINT64 *pH)
+{
+    UINT64 zh = 0;
+    UINT64 zl = 0;
+    UINT64 vh = pH[0];
+    UINT64 vl = pH[1];
+
+    for (int i = 0; i < 128; ++i)
+    {
+        UINT64 bit  = (i < 64) ? ((pX[0] >> (63 - i)) & 1) : ((pX[1] >> (127 - i)) & 1);
+        UINT64 mask = (UINT64)0 - bit;
+        zh ^= vh & mask;
+        zl ^= vl & mask;
+
+        UINT64 lsb = (UINT64)0 - (vl & 1);
+        vl = (vl >> 1) | (vh << 63);
+        vh = (vh >> 1) ^ (0xE100000000000000ULL & lsb);
+    }
+
+    pX[0] = zh;
+    pX[1] = zl;
+}
+
+/*!
+* @brief Hash the data with the software multiply, the last partial block is padded with zero.
+*/
+static void GcmGHashSoft(UINT64 *pState, const UINT64 *pH, const BYTE *pbData, DWORD dwDataLen)
+{
+    while (dwDataLen > 0)
+    {
+        BYTE cbBlock[AES_BLOCK_SIZE] = { 0 };
+        DWORD dwSize = MIN(dwDataLen, (DWORD)AES_BLOCK_SIZE);
+        memcpy(cbBlock, pbData, dwSize);
+
+        pState[0] ^= GcmLoadBE64(cbBlock);
+        pState[1] ^= GcmLoadBE64(cbBlock + 8);
+        GcmMultiplySoft(pState, pH);
+
+        pbData    += dwSize;
+        dwDataLen -= dwSize;
+    }
+}
+
+#if defined(GCM_HW_X86)
+
+/*!
+* @brief Multiply in GF(2^128) with PCLMULQDQ, the operands are byte reflected.
+*/
+GCM_HW_TARGET static __m128i GcmMultiplyHw(__m128i a, __m128i b)
+{
+    __m128i t2, t3, t4, t5, t6, t7, t8, t9;
+
+    // The 256 bits product by the schoolbook multiply.
+    t3 = _mm_clmulepi64_si128(a, b, 0x00);
+    t4 = _mm_clmulepi64_si128(a, b, 0x10);
+    t5 = _mm_clmulepi64_si128(a, b, 0x01);
+    t6 = _mm_clmulepi64_si128(a, b, 0x11);
+    t4 = _mm_xor_si128(t4, t5);
+    t5 = _mm_slli_si128(t4, 8);
+    t4 = _mm_srli_si128(t4, 8);
+    t3 = _mm_xor_si128(t3, t5);
+    t6 = _mm_xor_si128(t6, t4);
+
+    // Shift the product left by one bit since the operands are reflected.
+    t7 = _mm_srli_epi32(t3, 31);
+    t8 = _mm_srli_epi32(t6, 31);
+    t3 = _mm_slli_epi32(t3, 1);
+    t6 = _mm_slli_epi32(t6, 1);
+    t9 = _mm_srli_si128(t7, 12);
+    t8 = _mm_slli_si128(t8, 4);
+    t7 = _mm_slli_si128(t7, 4);
+    t3 = _mm_or_si128(t3, t7);
+    t6 = _mm_or_si128(t6, t8);
+    t6 = _mm_or_si128(t6, t9);
+
+    // Reduce modulo x^128 + x^7 + x^2 + x + 1.
+    t7 = _mm_slli_epi32(t3, 31);
+    t8 = _mm_slli_epi32(t3, 30);
+    t9 = _mm_slli_epi32(t3, 25);
+    t7 = _mm_xor_si128(t7, t8);
+    t7 = _mm_xor_si128(t7, t9);
+    t8 = _mm_srli_si128(t7, 4);
+    t7 = _mm_slli_si128(t7, 12);
+    t3 = _mm_xor_si128(t3, t7);
+
+    t2 = _mm_srli_epi32(t3, 1);
+    t4 = _mm_srli_epi32(t3, 2);
+    t5 = _mm_srli_epi32(t3, 7);
+    t2 = _mm_xor_si128(t2, t4);
+    t2 = _mm_xor_si128(t2, t5);
+    t2 = _mm_xor_si128(t2, t8);
+    t3 = _mm_xor_si128(t3, t2);
+    t6 = _mm_xor_si128(t6, t3);
+
+    return t6;
+}
+
+/*!
+* @brief Hash the data with PCLMULQDQ, the state is kept byte reflected.
+*/
+GCM_HW_TARGET static void GcmGHashHw(BYTE *pbState, const BYTE *pbH, const BYTE *pbData, DWORD dwDataLen)
+{
+    const __m128i bswap = _mm_set_epi8(0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15);
+    __m128i h = _mm_shuffle_epi8(_mm_loadu_si128((const __m128i*)pbH), bswap);
+    __m128i x = _mm_loadu_si128((const __m128i*)pbState);
+
+    for (; dwDataLen >= AES_BLOCK_SIZE; dwDataLen -= AES_BLOCK_SIZE, pbData += AES_BLOCK_SIZE)
+    {
+        __m128i b = _mm_shuffle_epi8(_mm_loadu_si128((const __m128i*)pbData), bswap);
+        x = GcmMultiplyHw(_mm_xor_si128(x, b), h);
+    }
+
+    if (dwDataLen > 0)
+    {
+        BYTE cbBlock[AES_BLOCK_SIZE] = { 0 };
+        memcpy(cbBlock, pbData, dwDataLen);
+        __m128i b = _mm_shuffle_epi8(_mm_loadu_si128((const __m128i*)cbBlock), bswap);
+        x = GcmMultiplyHw(_mm_xor_si128(x, b), h);
+    }
+
+    _mm_storeu_si128((__m128i*)pbState, x);
+}
+
+GCM_HW_TARGET static void GcmReflectBlock(BYTE *pbBlock)
+{
+    const __m128i bswap = _mm_set_epi8(0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15);
+    _mm_storeu_si128((__m128i*)pbBlock, _mm_shuffle_epi8(_mm_loadu_si128((const __m128i*)pbBlock), bswap));
+}
+
+#endif // GCM_HW_X86
+
+/*!
+* @brief Increase the low 32 bits of the counter block, big endian.
+*/
+static inline void GcmIncrease32(BYTE *pbCounter)
+{
+    for (int i = AES_BLOCK_SIZE - 1; i >= AES_BLOCK_SIZE - 4; --i)
+    {
+        if (0 != ++pbCounter[i])
+        {
+            break;
+        }
+    }
+}
+
+
+//////////////////////////////////////////////////////////////////////////
+
+BOOL SdkAesGcm::IsHardwareSupported()
+{
+#if defined(GCM_HW_X86)
+    if ( !SdkAesCipher::IsHardwareSupported() )
+    {
+        return FALSE;
+    }
+
+    // PCLMULQDQ is bit 1 and SSSE3 is bit 9 of ECX.
+#ifdef _MSC_VER
+    int cpuInfo[4] = { 0 };
+    __cpuid(cpuInfo, 1);
+    unsigned int ecx = (unsigned int)cpuInfo[2];
+#else
+    unsigned int eax = 0, ebx = 0, ecx = 0, edx = 0;
+    if (!__get_cpuid(1, &eax, &ebx, &ecx, &edx))
+    {
+        return FALSE;
+    }
+#endif // _MSC_VER
+    return ((0 != (ecx & (1 << 1))) && (0 != (ecx & (1 << 9)))) ? TRUE : FALSE;
+#else
+    return FALSE;
+#endif
+}
+
+//////////////////////////////////////////////////////////////////////////
+
+SdkAesGcm::SdkAesGcm(IN const BYTE *pbKey, IN DWORD dwKeySize, IN BOOL isUseHardware) : m_isUseClmul(FALSE),
+                                                                                        m_pAesCipher(NULL)
+{
+    ZeroMemory(m_cbH, sizeof(m_cbH));
+
+    m_pAesCipher = new SdkAesCipher(pbKey, dwKeySize, isUseHardware);
+    if ( m_pAesCipher->IsValid() )
+    {
+        // The hash subkey is the encrypted zero block.
+        m_pAesCipher->EncryptBlocksECB(m_cbH, m_cbH, 1);
+        m_isUseClmul = isUseHardware && IsHardwareSupported();
+    }
+}
+
+//////////////////////////////////////////////////////////////////////////
+
+SdkAesGcm::~SdkAesGcm()
+{
+    SecureZeroMemory(m_cbH, sizeof(m_cbH));
+    SAFE_DELETE(m_pAesCipher);
+}
+
+//////////////////////////////////////////////////////////////////////////
+
+BOOL SdkAesGcm::IsValid() const
+{
+    return (NULL != m_pAesCipher) && m_pAesCipher->IsValid();
+}
+
+//////////////////////////////////////////////////////////////////////////
+
+BOOL SdkAesGcm::Seal(IN const BYTE *pbIV, IN const BYTE *pbAad, IN DWORD dwAadLen,
+                     IN OUT PBYTE pbData, IN DWORD dwDataLen, OUT PBYTE pbTag) const
+{
+    if ( !IsValid() || (NULL == pbIV) || (NULL == pbTag) || ((NULL == pbData) && (dwDataLen > 0)) )
+    {
+        return FALSE;
+    }
+
+    // J0 is IV || 0x00000001 for the 96 bits IV.
+    BYTE cbJ0[AES_BLOCK_SIZE] = { 0 };
+    memcpy(cbJ0, pbIV, AES_GCM_IV_SIZE);
+    cbJ0[AES_BLOCK_SIZE - 1] = 1;
+
+    CryptCTR(cbJ0, pbData, dwDataLen);
+    ComputeTag(cbJ0, pbAad, dwAadLen, pbData, dwDataLen, pbTag);
+
+    return TRUE;
+}
+
+//////////////////////////////////////////////////////////////////////////
+
+BOOL SdkAesGcm::Open(IN const BYTE *pbIV, IN const BYTE *pbAad, IN DWORD dwAadLen,
+                     IN OUT PBYTE pbData, IN DWORD dwDataLen, IN const BYTE *pbTag) const
+{
+    if ( !IsValid() || (NULL == pbIV) || (NULL == pbTag) || ((NULL == pbData) && (dwDataLen > 0)) )
+    {
+        return FALSE;
+    }
+
+    BYTE cbJ0[AES_BLOCK_SIZE] = { 0 };
+    memcpy(cbJ0, pbIV, AES_GCM_IV_SIZE);
+    cbJ0[AES_BLOCK_SIZE - 1] = 1;
+
+    BYTE cbTag[AES_GCM_TAG_SIZE] = { 0 };
+    ComputeTag(cbJ0, pbAad, dwAadLen, pbData, dwDataLen, cbTag);
+
+    // Compare the tags in constant time.
+    BYTE cbDiff = 0;
+    for (int i = 0; i < AES_GCM_TAG_SIZE; ++i)
+    {
+        cbDiff |= cbTag[i] ^ pbTag[i];
+    }
+
+    if (0 != cbDiff)
+    {
+        return FALSE;
+    }
+
+    CryptCTR(cbJ0, pbData, dwDataLen);
+
+    return TRUE;
+}
+
+//////////////////////////////////////////////////////////////////////////
+
+void SdkAesGcm::ComputeTag(IN const BYTE *pbJ0, IN const BYTE *pbAad, IN DWORD dwAadLen,
+                           IN const BYTE *pbData, IN DWORD dwDataLen, OUT PBYTE pbTag) const
+{
+    // The last block is the bit lengths of the additional data and the encrypted data.
+    BYTE cbLength[AES_BLOCK_SIZE] = { 0 };
+    GcmStoreBE64(cbLength,     (UINT64)dwAadLen * 8);
+    GcmStoreBE64(cbLength + 8, (UINT64)dwDataLen * 8);
+
+    BYTE cbHash[AES_BLOCK_SIZE] = { 0 };
+
+#if defined(GCM_HW_X86)
+    if (m_isUseClmul)
+    {
+        GcmGHashHw(cbHash, m_cbH, pbAad, dwAadLen);
+        GcmGHashHw(cbHash, m_cbH, pbData, dwDataLen);
+        GcmGHashHw(cbHash, m_cbH, cbLength, AES_BLOCK_SIZE);
+        GcmReflectBlock(cbHash);
+    }
+    else
+#endif // GCM_HW_X86
+    {
+        UINT64 h[2] = { GcmLoadBE64(m_cbH), GcmLoadBE64(m_cbH + 8) };
+        UINT64 x[2] = { 0, 0 };
+        GcmGHashSoft(x, h, pbAad, dwAadLen);
+        GcmGHashSoft(x, h, pbData, dwDataLen);
+        GcmGHashSoft(x, h, cbLength, AES_BLOCK_SIZE);
+        GcmStoreBE64(cbHash,     x[0]);
+        GcmStoreBE64(cbHash + 8, x[1]);
+    }
+
+    // The tag is the hash encrypted by the first counter block.
+    BYTE cbMask[AES_BLOCK_SIZE] = { 0 };
+    m_pAesCipher->EncryptBlocksECB(pbJ0, cbMask, 1);
+    for (int i = 0; i < AES_GCM_TAG_SIZE; ++i)
+    {
+        pbTag[i] = cbHash[i] ^ cbMask[i];
+    }
+
+    SecureZeroMemory(cbMask, sizeof(cbMask));
+}
+
+//////////////////////////////////////////////////////////////////////////
+
+void SdkAesGcm::CryptCTR(IN const BYTE *pbJ0, IN OUT PBYTE pbData, IN DWORD dwDataLen) const
+{
+    BYTE cbCounter[AES_BLOCK_SIZE];
+    memcpy(cbCounter, pbJ0, AES_BLOCK_SIZE);
+
+    // The key stream is generated in batches, so the AES instructions can be interleaved.
+    BYTE cbStream[GCM_CTR_BATCH_BLOCKS * AES_BLOCK_SIZE];
+    while (dwDataLen > 0)
+    {
+        DWORD dwSize   = MIN(dwDataLen, (DWORD)sizeof(cbStream));
+        DWORD dwBlocks = (dwSize + AES_BLOCK_SIZE - 1) / AES_BLOCK_SIZE;
+
+        for (DWORD i = 0; i < dwBlocks; ++i)
+        {
+            GcmIncrease32(cbCounter);
+            memcpy(cbStream + i * AES_BLOCK_SIZE, cbCounter, AES_BLOCK_SIZE);
+        }
+
+        m_pAesCipher->EncryptBlocksECB(cbStream, cbStream, dwBlocks);
+
+        for (DWORD i = 0; i < dwSize; ++i)
+        {
+            pbData[i] ^= cbStream[i];
+        }
+
+        pbData    += dwSize;
+        dwDataLen -= dwSize;
+    }
+
+    SecureZeroMemory(cbStream, sizeof(cbStream));
+}
@@ -0,0 +1,198 @@
+/*!
+* @file SdkBase64Stream.cpp
+*
+* @brief This file defines SdkBase64Stream class to encode and decode Base64 data piece by piece.
+*
+* Copyright (C) 2011, LZT Corporation.
+*
+* @author Li Hong
+* @date 2011/06/28
+*/
+
+#include "stdafx.h"
+#include "SdkBase64Stream.h"
+
+USING_NAMESPACE_UTILITIES
+
+
+//////////////////////////////////////////////////////////////////////////
+
+SdkBase64Stream::SdkBase64Stream(IN BOOL isEncode) : m_isEncode(isEncode),
+                                                     m_isPadded(FALSE),
+                                                     m_isFailed(FALSE),
+                                                     m_nKeptSize(0)
+{
+    ZeroMemory(m_szKept, sizeof(m_szKept));
+}
+
+//////////////////////////////////////////////////////////////////////////
+
+SdkBase64Stream::~SdkBase64Stream()
+{
+    Reset();
+}
+
+//////////////////////////////////////////////////////////////////////////
+
+void SdkBase64Stream::Reset()
+{
+    SecureZeroMemory(m_szKept, sizeof(m_szKept));
+    m_nKeptSize = 0;
+    m_isPadded  = FALSE;
+    m_isFailed  = FALSE;
+}
+
+//////////////////////////////////////////////////////////////////////////
+
+size_t SdkBase64Stream::GetOutputSize(IN size_t inlen) const
+{
+    return m_isEncode ? ((m_nKeptSize + inlen) / 3) * 4 : ((m_nKeptSize + inlen) / 4) * 3;
+}
+
+//////////////////////////////////////////////////////////////////////////
+
+BOOL SdkBase64Stream::Feed(IN const char* in, size_t inlen, OUT char* out, IN OUT size_t* outlen)
+{
+    if ( (NULL == outlen) || ((inlen > 0) && (NULL == in)) )
+    {
+        return FALSE;
+    }
+
+    size_t outsize = *outlen;
+    *outlen = 0;
+
+    if ( m_isFailed || (GetOutputSize(inlen) > outsize) )
+    {
+        return FALSE;
+    }
+
+    // The padded group must be the last one.
+    if (m_isPadded && (inlen > 0))
+    {
+        m_isFailed = TRUE;
+        return FALSE;
+    }
+
+    // 3 bytes are encoded to 4 characters, 4 characters are decoded to 3 bytes.
+    size_t nGroupSize = m_isEncode ? 3 : 4;
+    size_t nWritten = 0;
+
+    // First complete the kept group.
+    if (m_nKeptSize > 0)
+    {
+        while ( (m_nKeptSize < nGroupSize) && (inlen > 0) )
+        {
+            m_szKept[m_nKeptSize++] = *in++;
+            --inlen;
+        }
+
+        if (m_nKeptSize == nGroupSize)
+        {
+            if (m_isEncode)
+            {
+                SdkBase64Util::Encode(m_szKept, 3, out, 4);
+                nWritten = 4;
+            }
+            else if ( !DecodeGroups(m_szKept, 4, out, &nWritten) )
+            {
+                return FALSE;
+            }
+
+            m_nKeptSize = 0;
+        }
+    }
+
+    // Then the whole groups of this piece.
+    size_t nBulkSize = inlen - (inlen % nGroupSize);
+    if (nBulkSize > 0)
+    {
+        size_t nBulkWritten = 0;
+        if (m_isEncode)
+        {
+            nBulkWritten = (nBulkSize / 3) * 4;
+            SdkBase64Util::Encode(in, nBulkSize, out + nWritten, nBulkWritten);
+        }
+        else if ( !DecodeGroups(in, nBulkSize, out + nWritten, &nBulkWritten) )
+        {
+            return FALSE;
+        }
+
+        in += nBulkSize;
+        inlen -= nBulkSize;
+        nWritten += nBulkWritten;
+    }
+
+    // Keep the rest for the next piece.
+    if (inlen > 0)
+    {
+        if (m_isPadded)
+        {
+            m_isFailed = TRUE;
+            return FALSE;
+        }
+
+        memcpy(m_szKept + m_nKeptSize, in, inlen);
+        m_nKeptSize += inlen;
+    }
+
+    *outlen = nWritten;
+
+    return TRUE;
+}
+
+//////////////////////////////////////////////////////////////////////////
+
+BOOL SdkBase64Stream::Finish(OUT char* out, IN OUT size_t* outlen)
+{
+    if (NULL == outlen)
+    {
+        return FALSE;
+    }
+
+    size_t outsize = *outlen;
+    *outlen = 0;
+
+    BOOL isOK = !m_isFailed;
+    if ( isOK && (m_nKeptSize > 0) )
+    {
+        if (m_isEncode)
+        {
+            // The last 1 or 2 bytes are padded to 4 characters.
+            isOK = (outsize >= 4);
+            if (isOK)
+            {
+                SdkBase64Util::Encode(m_szKept, m_nKeptSize, out, 4);
+                *outlen = 4;
+            }
+        }
+        else
+        {
+            // The last 2 or 3 characters without padding are 1 or 2 bytes.
+            size_t declen = m_nKeptSize - 1;
+            isOK = (m_nKeptSize >= 2) && (outsize >= declen) &&
+                   SdkBase64Util::Decode(m_szKept, m_nKeptSize, out, &declen);
+            *outlen = isOK ? declen : 0;
+        }
+    }
+
+    Reset();
+
+    return isOK;
+}
+
+//////////////////////////////////////////////////////////////////////////
+
+BOOL SdkBase64Stream::DecodeGroups(IN const char* in, size_t inlen, OUT char* out, OUT size_t* outlen)
+{
+    *outlen = (inlen / 4) * 3;
+
+    if ( m_isPadded || !SdkBase64Util::Decode(in, inlen, out, outlen) )
+    {
+        m_isFailed = TRUE;
+        return FALSE;
+    }
+
+    m_isPadded = ('=' == in[inlen - 1]);
+
+    return TRUE;
+}
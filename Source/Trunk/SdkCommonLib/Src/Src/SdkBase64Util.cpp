@@ -15,6 +15,37 @@
 #include <stdlib.h>         // Get malloc.
 #include <limits.h>         // Get UCHAR_MAX.
 
+#if defined(_M_IX86) || defined(_M_X64) || defined(__i386__) || defined(__x86_64__)
+#define BASE64_HW_X86
+#include <emmintrin.h>
+#include <tmmintrin.h>
+#if !defined(_MSC_VER) || (_MSC_VER >= 1700)
+#define BASE64_HW_AVX2
+#include <immintrin.h>
+#endif
+#ifdef _MSC_VER
+#include <intrin.h>
+#else
+#include <cpuid.h>
+#endif // _MSC_VER
+#elif defined(_M_ARM64) || defined(__aarch64__)
+#define BASE64_HW_NEON
+#ifdef _MSC_VER
+#include <arm64_neon.h>
+#else
+#include <arm_neon.h>
+#endif // _MSC_VER
+#endif
+
+// GCC and Clang need the target attribute to emit SSSE3 and AVX2 instructions without global options.
+#if defined(BASE64_HW_X86) && defined(__GNUC__)
+#define BASE64_SSSE3_TARGET __attribute__((target("ssse3")))
+#define BASE64_AVX2_TARGET  __attribute__((target("avx2")))
+#else
+#define BASE64_SSSE3_TARGET
+#define BASE64_AVX2_TARGET
+#endif
+
 USING_NAMESPACE_UTILITIES
 
 
@@ -166,6 +197,8 @@ const char SdkBase64Util::m_b64[0x100] =
 
 const char SdkBase64Util::m_b64str[] = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+-";
 
+volatile LONG SdkBase64Util::m_lSimdLevel = -1;
+
 
 // C89 compliant way to cast 'char' to 'unsigned char'.
 static inline unsigned char CharToUChar (char ch)
@@ -173,9 +206,398 @@ static inline unsigned char CharToUChar (char ch)
     return ch;
 }
 
+
+//////////////////////////////////////////////////////////////////////////
+//
+// The SIMD implementation. The encoders take the groups of 3 bytes and the decoders take
+// the groups of 4 characters which are all in the alphabet, the rest is left to the scalar
+// code, so the result and the handling of the short buffers are the same as the scalar code.
+//
+//////////////////////////////////////////////////////////////////////////
+
+#if defined(BASE64_HW_X86)
+
+/*!
+* @brief Split each 3 bytes of the first 12 bytes into 4 indices of 6 bits.
+*/
+BASE64_SSSE3_TARGET static inline __m128i Base64SplitSsse3(__m128i in)
+{
+    in = _mm_shuffle_epi8(in, _mm_setr_epi8(1, 0, 2, 1, 4, 3, 5, 4, 7, 6, 8, 7, 10, 9, 11, 10));
+
+    __m128i t0 = _mm_mulhi_epu16(_mm_and_si128(in, _mm_set1_epi32(0x0fc0fc00)), _mm_set1_epi32(0x04000040));
+    __m128i t1 = _mm_mullo_epi16(_mm_and_si128(in, _mm_set1_epi32(0x003f03f0)), _mm_set1_epi32(0x01000010));
+
+    return _mm_or_si128(t0, t1);
+}
+
+/*!
+* @brief Map the indices to the characters, the ranges A-Z, a-z, 0-9, '+' and '-' are
+*        selected by a small index and each range adds its own offset.
+*/
+BASE64_SSSE3_TARGET static inline __m128i Base64LookupSsse3(__m128i indices)
+{
+    const __m128i offsets = _mm_setr_epi8('a' - 26, '0' - 52, '0' - 52, '0' - 52, '0' - 52, '0' - 52,
+                                          '0' - 52, '0' - 52, '0' - 52, '0' - 52, '0' - 52, '+' - 62,
+                                          '-' - 63, 'A', 0, 0);
+
+    __m128i range = _mm_subs_epu8(indices, _mm_set1_epi8(51));
+    range = _mm_or_si128(range, _mm_and_si128(_mm_cmpgt_epi8(_mm_set1_epi8(26), indices), _mm_set1_epi8(13)));
+
+    return _mm_add_epi8(indices, _mm_shuffle_epi8(offsets, range));
+}
+
+/*!
+* @brief Map 16 characters to their values.
+*
+* @return FALSE if any character is not in the alphabet.
+*/
+BASE64_SSSE3_TARGET static inline BOOL Base64ValuesSsse3(__m128i chars, __m128i *pValues)
+{
+    __m128i upper = _mm_and_si128(_mm_cmpgt_epi8(chars, _mm_set1_epi8('A' - 1)), _mm_cmpgt_epi8(_mm_set1_epi8('Z' + 1), chars));
+    __m128i lower = _mm_and_si128(_mm_cmpgt_epi8(chars, _mm_set1_epi8('a' - 1)), _mm_cmpgt_epi8(_mm_set1_epi8('z' + 1), chars));
+    __m128i digit = _mm_and_si128(_mm_cmpgt_epi8(chars, _mm_set1_epi8('0' - 1)), _mm_cmpgt_epi8(_mm_set1_epi8('9' + 1), chars));
+    __m128i plus  = _mm_cmpeq_epi8(chars, _mm_set1_epi8('+'));
+    __m128i minus = _mm_cmpeq_epi8(chars, _mm_set1_epi8('-'));
+
+    __m128i valid = _mm_or_si128(_mm_or_si128(upper, lower), _mm_or_si128(digit, _mm_or_si128(plus, minus)));
+    if (0xFFFF != _mm_movemask_epi8(valid))
+    {
+        return FALSE;
+    }
+
+    __m128i shift = _mm_or_si128(_mm_and_si128(upper, _mm_set1_epi8(-65)), _mm_and_si128(lower, _mm_set1_epi8(-71)));
+    shift = _mm_or_si128(shift, _mm_and_si128(digit, _mm_set1_epi8(4)));
+    shift = _mm_or_si128(shift, _mm_and_si128(plus,  _mm_set1_epi8(62 - '+')));
+    shift = _mm_or_si128(shift, _mm_and_si128(minus, _mm_set1_epi8(63 - '-')));
+
+    *pValues = _mm_add_epi8(chars, shift);
+
+    return TRUE;
+}
+
+/*!
+* @brief Pack each 4 values of 6 bits into 3 bytes, the result is the first 12 bytes.
+*/
+BASE64_SSSE3_TARGET static inline __m128i Base64PackSsse3(__m128i values)
+{
+    __m128i merged = _mm_maddubs_epi16(values, _mm_set1_epi32(0x01400140));
+    merged = _mm_madd_epi16(merged, _mm_set1_epi32(0x00011000));
+
+    return _mm_shuffle_epi8(merged, _mm_setr_epi8(2, 1, 0, 6, 5, 4, 10, 9, 8, 14, 13, 12, -1, -1, -1, -1));
+}
+
+/*!
+* @brief Store the first 12 bytes, the bytes after them are not touched.
+*/
+static inline void Base64Store12(char *out, __m128i data)
+{
+    int nTail = _mm_cvtsi128_si32(_mm_srli_si128(data, 8));
+    _mm_storel_epi64((__m128i*)out, data);
+    memcpy(out + 8, &nTail, sizeof(nTail));
+}
+
+BASE64_SSSE3_TARGET static void Base64EncodeSsse3(const BYTE *&in, size_t &inlen, char *&out, size_t &outlen)
+{
+    // 16 bytes are loaded for 12 bytes.
+    while ((inlen >= 16) && (outlen >= 16))
+    {
+        __m128i indices = Base64SplitSsse3(_mm_loadu_si128((const __m128i*)in));
+        _mm_storeu_si128((__m128i*)out, Base64LookupSsse3(indices));
+
+        in += 12;
+        inlen -= 12;
+        out += 16;
+        outlen -= 16;
+    }
+}
+
+BASE64_SSSE3_TARGET static void Base64DecodeSsse3(const char *&in, size_t &inlen, char *&out, size_t &outleft)
+{
+    while ((inlen >= 16) && (outleft >= 12))
+    {
+        __m128i values;
+        if ( !Base64ValuesSsse3(_mm_loadu_si128((const __m128i*)in), &values) )
+        {
+            break;
+        }
+
+        Base64Store12(out, Base64PackSsse3(values));
+
+        in += 16;
+        inlen -= 16;
+        out += 12;
+        outleft -= 12;
+    }
+}
+
+#endif // BASE64_HW_X86
+
+
+#if defined(BASE64_HW_AVX2)
+
+/*!
+* @brief Put the same 128 bits into both lanes.
+*/
+BASE64_AVX2_TARGET static inline __m256i Base64BroadcastAvx2(__m128i data)
+{
+    return _mm256_inserti128_si256(_mm256_castsi128_si256(data), data, 1);
+}
+
+BASE64_AVX2_TARGET static void Base64EncodeAvx2(const BYTE *&in, size_t &inlen, char *&out, size_t &outlen)
+{
+    const __m256i shuffle = Base64BroadcastAvx2(_mm_setr_epi8(1, 0, 2, 1, 4, 3, 5, 4, 7, 6, 8, 7, 10, 9, 11, 10));
+    const __m256i offsets = Base64BroadcastAvx2(_mm_setr_epi8('a' - 26, '0' - 52, '0' - 52, '0' - 52, '0' - 52, '0' - 52,
+                                                              '0' - 52, '0' - 52, '0' - 52, '0' - 52, '0' - 52, '+' - 62,
+                                                              '-' - 63, 'A', 0, 0));
+
+    // Each lane takes 12 bytes, 28 bytes are loaded for 24 bytes.
+    while ((inlen >= 28) && (outlen >= 32))
+    {
+        __m256i data = _mm256_inserti128_si256(_mm256_castsi128_si256(_mm_loadu_si128((const __m128i*)in)),
+                                               _mm_loadu_si128((const __m128i*)(in + 12)), 1);
+        data = _mm256_shuffle_epi8(data, shuffle);
+
+        __m256i t0 = _mm256_mulhi_epu16(_mm256_and_si256(data, _mm256_set1_epi32(0x0fc0fc00)), _mm256_set1_epi32(0x04000040));
+        __m256i t1 = _mm256_mullo_epi16(_mm256_and_si256(data, _mm256_set1_epi32(0x003f03f0)), _mm256_set1_epi32(0x01000010));
+        __m256i indices = _mm256_or_si256(t0, t1);
+
+        __m256i range = _mm256_subs_epu8(indices, _mm256_set1_epi8(51));
+        range = _mm256_or_si256(range, _mm256_and_si256(_mm256_cmpgt_epi8(_mm256_set1_epi8(26), indices), _mm256_set1_epi8(13)));
+        _mm256_storeu_si256((__m256i*)out, _mm256_add_epi8(indices, _mm256_shuffle_epi8(offsets, range)));
+
+        in += 24;
+        inlen -= 24;
+        out += 32;
+        outlen -= 32;
+    }
+}
+
+BASE64_AVX2_TARGET static void Base64DecodeAvx2(const char *&in, size_t &inlen, char *&out, size_t &outleft)
+{
+    const __m256i pack = Base64BroadcastAvx2(_mm_setr_epi8(2, 1, 0, 6, 5, 4, 10, 9, 8, 14, 13, 12, -1, -1, -1, -1));
+
+    while ((inlen >= 32) && (outleft >= 24))
+    {
+        __m256i chars = _mm256_loadu_si256((const __m256i*)in);
+
+        __m256i upper = _mm256_and_si256(_mm256_cmpgt_epi8(chars, _mm256_set1_epi8('A' - 1)), _mm256_cmpgt_epi8(_mm256_set1_epi8('Z' + 1), chars));
+        __m256i lower = _mm256_and_si256(_mm256_cmpgt_epi8(chars, _mm256_set1_epi8('a' - 1)), _mm256_cmpgt_epi8(_mm256_set1_epi8('z' + 1), chars));
+        __m256i digit = _mm256_and_si256(_mm256_cmpgt_epi8(chars, _mm256_set1_epi8('0' - 1)), _mm256_cmpgt_epi8(_mm256_set1_epi8('9' + 1), chars));
+        __m256i plus  = _mm256_cmpeq_epi8(chars, _mm256_set1_epi8('+'));
+        __m256i minus = _mm256_cmpeq_epi8(chars, _mm256_set1_epi8('-'));
+
+        __m256i valid = _mm256_or_si256(_mm256_or_si256(upper, lower), _mm256_or_si256(digit, _mm256_or_si256(plus, minus)));
+        if (-1 != _mm256_movemask_epi8(valid))
+        {
+            break;
+        }
+
+        __m256i shift = _mm256_or_si256(_mm256_and_si256(upper, _mm256_set1_epi8(-65)), _mm256_and_si256(lower, _mm256_set1_epi8(-71)));
+        shift = _mm256_or_si256(shift, _mm256_and_si256(digit, _mm256_set1_epi8(4)));
+        shift = _mm256_or_si256(shift, _mm256_and_si256(plus,  _mm256_set1_epi8(62 - '+')));
+        shift = _mm256_or_si256(shift, _mm256_and_si256(minus, _mm256_set1_epi8(63 - '-')));
+
+        __m256i merged = _mm256_maddubs_epi16(_mm256_add_epi8(chars, shift), _mm256_set1_epi32(0x01400140));
+        merged = _mm256_madd_epi16(merged, _mm256_set1_epi32(0x00011000));
+        merged = _mm256_shuffle_epi8(merged, pack);
+
+        Base64Store12(out, _mm256_castsi256_si128(merged));
+        Base64Store12(out + 12, _mm256_extracti128_si256(merged, 1));
+
+        in += 32;
+        inlen -= 32;
+        out += 24;
+        outleft -= 24;
+    }
+}
+
+#endif // BASE64_HW_AVX2
+
+
+#if defined(BASE64_HW_NEON)
+
+/*!
+* @brief Map 16 characters to their values.
+*
+* @return FALSE if any character is not in the alphabet.
+*/
+static inline BOOL Base64ValuesNeon(uint8x16_t chars, uint8x16_t *pValues)
+{
+    uint8x16_t upper = vandq_u8(vcgeq_u8(chars, vdupq_n_u8('A')), vcleq_u8(chars, vdupq_n_u8('Z')));
+    uint8x16_t lower = vandq_u8(vcgeq_u8(chars, vdupq_n_u8('a')), vcleq_u8(chars, vdupq_n_u8('z')));
+    uint8x16_t digit = vandq_u8(vcgeq_u8(chars, vdupq_n_u8('0')), vcleq_u8(chars, vdupq_n_u8('9')));
+    uint8x16_t plus  = vceqq_u8(chars, vdupq_n_u8('+'));
+    uint8x16_t minus = vceqq_u8(chars, vdupq_n_u8('-'));
+
+    uint8x16_t valid = vorrq_u8(vorrq_u8(upper, lower), vorrq_u8(digit, vorrq_u8(plus, minus)));
+    if (0 == vminvq_u8(valid))
+    {
+        return FALSE;
+    }
+
+    uint8x16_t shift = vorrq_u8(vandq_u8(upper, vdupq_n_u8((BYTE)-65)), vandq_u8(lower, vdupq_n_u8((BYTE)-71)));
+    shift = vorrq_u8(shift, vandq_u8(digit, vdupq_n_u8(4)));
+    shift = vorrq_u8(shift, vandq_u8(plus,  vdupq_n_u8(62 - '+')));
+    shift = vorrq_u8(shift, vandq_u8(minus, vdupq_n_u8(63 - '-')));
+
+    *pValues = vaddq_u8(chars, shift);
+
+    return TRUE;
+}
+
+static void Base64EncodeNeon(const char *alphabet, const BYTE *&in, size_t &inlen, char *&out, size_t &outlen)
+{
+    uint8x16x4_t table;
+    table.val[0] = vld1q_u8((const BYTE*)alphabet);
+    table.val[1] = vld1q_u8((const BYTE*)alphabet + 16);
+    table.val[2] = vld1q_u8((const BYTE*)alphabet + 32);
+    table.val[3] = vld1q_u8((const BYTE*)alphabet + 48);
+
+    const uint8x16_t mask = vdupq_n_u8(0x3f);
+
+    while ((inlen >= 48) && (outlen >= 64))
+    {
+        uint8x16x3_t src = vld3q_u8(in);
+
+        uint8x16x4_t dst;
+        dst.val[0] = vshrq_n_u8(src.val[0], 2);
+        dst.val[1] = vandq_u8(vorrq_u8(vshlq_n_u8(src.val[0], 4), vshrq_n_u8(src.val[1], 4)), mask);
+        dst.val[2] = vandq_u8(vorrq_u8(vshlq_n_u8(src.val[1], 2), vshrq_n_u8(src.val[2], 6)), mask);
+        dst.val[3] = vandq_u8(src.val[2], mask);
+
+        dst.val[0] = vqtbl4q_u8(table, dst.val[0]);
+        dst.val[1] = vqtbl4q_u8(table, dst.val[1]);
+        dst.val[2] = vqtbl4q_u8(table, dst.val[2]);
+        dst.val[3] = vqtbl4q_u8(table, dst.val[3]);
+        vst4q_u8((BYTE*)out, dst);
+
+        in += 48;
+        inlen -= 48;
+        out += 64;
+        outlen -= 64;
+    }
+}
+
+static void Base64DecodeNeon(const char *&in, size_t &inlen, char *&out, size_t &outleft)
+{
+    while ((inlen >= 64) && (outleft >= 48))
+    {
+        uint8x16x4_t chars = vld4q_u8((const BYTE*)in);
+        uint8x16x4_t values;
+        if ( !Base64ValuesNeon(chars.val[0], &values.val[0]) || !Base64ValuesNeon(chars.val[1], &values.val[1]) ||
+             !Base64ValuesNeon(chars.val[2], &values.val[2]) || !Base64ValuesNeon(chars.val[3], &values.val[3]) )
+        {
+            break;
+        }
+
+        uint8x16x3_t dst;
+        dst.val[0] = vorrq_u8(vshlq_n_u8(values.val[0], 2), vshrq_n_u8(values.val[1], 4));
+        dst.val[1] = vorrq_u8(vshlq_n_u8(values.val[1], 4), vshrq_n_u8(values.val[2], 2));
+        dst.val[2] = vorrq_u8(vshlq_n_u8(values.val[2], 6), values.val[3]);
+        vst3q_u8((BYTE*)out, dst);
+
+        in += 64;
+        inlen -= 64;
+        out += 48;
+        outleft -= 48;
+    }
+}
+
+#endif // BASE64_HW_NEON
+
+
 //////////////////////////////////////////////////////////////////////////
 
 void SdkBase64Util::Encode(IN const char* in, size_t inlen, OUT char* out, size_t outlen)
+{
+    const BYTE *pbIn = (const BYTE*)in;
+
+#if defined(BASE64_HW_X86)
+    UINT32 nLevel = GetSimdLevel();
+#if defined(BASE64_HW_AVX2)
+    if (BASE64_SIMD_AVX2 == nLevel)
+    {
+        Base64EncodeAvx2(pbIn, inlen, out, outlen);
+    }
+#endif // BASE64_HW_AVX2
+    if (nLevel >= BASE64_SIMD_SSSE3)
+    {
+        Base64EncodeSsse3(pbIn, inlen, out, outlen);
+    }
+#elif defined(BASE64_HW_NEON)
+    if (BASE64_SIMD_NEON == GetSimdLevel())
+    {
+        Base64EncodeNeon(m_b64str, pbIn, inlen, out, outlen);
+    }
+#endif
+
+    EncodeScalar((const char*)pbIn, inlen, out, outlen);
+}
+
+//////////////////////////////////////////////////////////////////////////
+
+BOOL SdkBase64Util::Decode(IN const char* in, size_t inlen, OUT char* out, size_t* outlen)
+{
+    size_t outleft = *outlen;
+
+#if defined(BASE64_HW_X86)
+    UINT32 nLevel = GetSimdLevel();
+#if defined(BASE64_HW_AVX2)
+    if (BASE64_SIMD_AVX2 == nLevel)
+    {
+        Base64DecodeAvx2(in, inlen, out, outleft);
+    }
+#endif // BASE64_HW_AVX2
+    if (nLevel >= BASE64_SIMD_SSSE3)
+    {
+        Base64DecodeSsse3(in, inlen, out, outleft);
+    }
+#elif defined(BASE64_HW_NEON)
+    if (BASE64_SIMD_NEON == GetSimdLevel())
+    {
+        Base64DecodeNeon(in, inlen, out, outleft);
+    }
+#endif
+
+    // The scalar code decodes the rest into the left buffer.
+    size_t nDecoded = *outlen - outleft;
+    BOOL isOK = DecodeScalar(in, inlen, out, &outleft);
+    *outlen = nDecoded + outleft;
+
+    return isOK;
+}
+
+//////////////////////////////////////////////////////////////////////////
+
+string SdkBase64Util::Encode(IN const string& strData)
+{
+    size_t outlen = BASE64_LENGTH(strData.size());
+
+    // One more character for the terminating zero.
+    string strBase64(outlen + 1, '\0');
+    Encode(strData.data(), strData.size(), &strBase64[0], outlen + 1);
+    strBase64.resize(outlen);
+
+    return strBase64;
+}
+
+//////////////////////////////////////////////////////////////////////////
+
+BOOL SdkBase64Util::Decode(IN const string& strBase64, OUT string& strData)
+{
+    // Each 4 characters are 3 bytes, the last 2 or 3 characters are 1 or 2 bytes.
+    size_t outlen = (strBase64.size() / 4) * 3 + 2;
+
+    strData.assign(outlen, '\0');
+    BOOL isOK = Decode(strBase64.data(), strBase64.size(), &strData[0], &outlen);
+    strData.resize(outlen);
+
+    return isOK;
+}
+
+//////////////////////////////////////////////////////////////////////////
+
+void SdkBase64Util::EncodeScalar(IN const char* in, size_t inlen, OUT char* out, size_t outlen)
 {
     while (inlen && outlen)
     {
@@ -232,7 +654,7 @@ void SdkBase64Util::Encode(IN const char* in, size_t inlen, OUT char* out, size_
 
 //////////////////////////////////////////////////////////////////////////
 
-BOOL SdkBase64Util::Decode(IN const char* in, size_t inlen, OUT char* out, size_t* outlen)
+BOOL SdkBase64Util::DecodeScalar(IN const char* in, size_t inlen, OUT char* out, size_t* outlen)
 {
     size_t outleft = *outlen;
 
@@ -330,3 +752,78 @@ BOOL SdkBase64Util::Isbase64(char ch)
 {
     return (UCHAR_IN_RANGE(CharToUChar (ch)) && 0 <= m_b64[CharToUChar (ch)]);
 }
+
+//////////////////////////////////////////////////////////////////////////
+
+UINT32 SdkBase64Util::GetSimdLevel()
+{
+    LONG lLevel = m_lSimdLevel;
+    if (lLevel < 0)
+    {
+        lLevel = (LONG)GetSupportedSimdLevel();
+        InterlockedExchange(&m_lSimdLevel, lLevel);
+    }
+
+    return (UINT32)lLevel;
+}
+
+//////////////////////////////////////////////////////////////////////////
+
+void SdkBase64Util::SetSimdLevel(UINT32 nLevel)
+{
+    InterlockedExchange(&m_lSimdLevel, (LONG)MIN(nLevel, GetSupportedSimdLevel()));
+}
+
+//////////////////////////////////////////////////////////////////////////
+
+UINT32 SdkBase64Util::GetSupportedSimdLevel()
+{
+#if defined(BASE64_HW_X86)
+    UINT32 nLevel = BASE64_SIMD_NONE;
+#ifdef _MSC_VER
+    int cpuInfo[4] = { 0 };
+    __cpuid(cpuInfo, 1);
+    unsigned int ecx = (unsigned int)cpuInfo[2];
+#else
+    unsigned int eax = 0, ebx = 0, ecx = 0, edx = 0;
+    if (!__get_cpuid(1, &eax, &ebx, &ecx, &edx))
+    {
+        return BASE64_SIMD_NONE;
+    }
+#endif // _MSC_VER
+
+    if (0 != (ecx & (1 << 9)))
+    {
+        nLevel = BASE64_SIMD_SSSE3;
+    }
+
+#if defined(BASE64_HW_AVX2)
+    // AVX2 also needs the OS to save the YMM registers.
+    if ( (BASE64_SIMD_SSSE3 == nLevel) && (0 != (ecx & (1 << 27))) && (0 != (ecx & (1 << 28))) )
+    {
+#ifdef _MSC_VER
+        __cpuidex(cpuInfo, 7, 0);
+        unsigned int ebx7 = (unsigned int)cpuInfo[1];
+        unsigned int xcr0 = (unsigned int)_xgetbv(0);
+#else
+        unsigned int ebx7 = 0, xcr0 = 0, xcrHigh = 0;
+        if (__get_cpuid_max(0, NULL) >= 7)
+        {
+            __cpuid_count(7, 0, eax, ebx7, ecx, edx);
+        }
+        __asm__ ("xgetbv" : "=a"(xcr0), "=d"(xcrHigh) : "c"(0));
+#endif // _MSC_VER
+        if ( (0 != (ebx7 & (1 << 5))) && (6 == (xcr0 & 6)) )
+        {
+            nLevel = BASE64_SIMD_AVX2;
+        }
+    }
+#endif // BASE64_HW_AVX2
+
+    return nLevel;
+#elif defined(BASE64_HW_NEON)
+    return BASE64_SIMD_NEON;
+#else
+    return BASE64_SIMD_NONE;
+#endif
+}
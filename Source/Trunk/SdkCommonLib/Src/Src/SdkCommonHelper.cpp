@@ -12,11 +12,13 @@
 #include "stdafx.h"
 #include "SdkCommonHelper.h"
 #include "SdkDriversManager.h"
+#include "SdkThumbnailStore.h"
 #include <math.h>
 
 #pragma comment(lib, "comctl32.lib")
 
 USING_NAMESPACE_COMMON
+USING_NAMESPACE_UTILITIES
 
 HBITMAP SdkCommonHelper::ExtractFileIcon(IN LPCTSTR pszPath, UINT nWidth, UINT nHeight)
 {
@@ -43,6 +45,16 @@ HBITMAP SdkCommonHelper::ExtractFileThumbnail(IN LPCTSTR pszPath, UINT nWidth, U
     HBITMAP hBitmpa = NULL;
     if ( (NULL != pszPath) && (nWidth > 0.0) && (nHeight > 0.0) )
     {
+        BOOL isStored = SdkThumbnailStore::IsOpen();
+        if (isStored)
+        {
+            hBitmpa = SdkThumbnailStore::Lookup(pszPath, nWidth, nHeight, SIIGBF_THUMBNAILONLY);
+            if (NULL != hBitmpa)
+            {
+                return hBitmpa;
+            }
+        }
+
         IShellItemImageFactory *psif = NULL;
         SIZE size = { nWidth, nHeight };
         HRESULT hr = ::SHCreateItemFromParsingName(pszPath, NULL, IID_PPV_ARGS(&psif));
@@ -51,6 +63,11 @@ HBITMAP SdkCommonHelper::ExtractFileThumbnail(IN LPCTSTR pszPath, UINT nWidth, U
             psif->GetImage(size, SIIGBF_THUMBNAILONLY, &hBitmpa);
         }
         SAFE_RELEASE(psif);
+
+        if ( isStored && (NULL != hBitmpa) )
+        {
+            SdkThumbnailStore::Insert(pszPath, nWidth, nHeight, hBitmpa, SIIGBF_THUMBNAILONLY);
+        }
     }
 
     return hBitmpa;
@@ -1032,6 +1049,18 @@ HBITMAP SdkCommonHelper::GetItemBitmap(IN LPCITEMIDLIST pidlItem, UINT nWidth, U
 
     if ( NULL != pidlItem )
     {
+        // Only the items in the file system are stored, the virtual items have no path.
+        WCHAR szPath[MAX_PATH] = { 0 };
+        BOOL hasPath = SHGetPathFromIDListW(pidlItem, szPath) && SdkThumbnailStore::IsOpen();
+        if (hasPath)
+        {
+            hBitmap = SdkThumbnailStore::Lookup(szPath, nWidth, nHeight, SIIGBF_THUMBNAILONLY | SIIGBF_ICONONLY);
+            if (NULL != hBitmap)
+            {
+                return hBitmap;
+            }
+        }
+
         IShellItemImageFactory *psif = NULL;
         SIZE size = { nWidth, nHeight };
         HRESULT hr = SHCreateItemFromIDList(pidlItem, IID_PPV_ARGS(&psif));
@@ -1043,6 +1072,12 @@ HBITMAP SdkCommonHelper::GetItemBitmap(IN LPCITEMIDLIST pidlItem, UINT nWidth, U
                 psif->GetImage(size, SIIGBF_ICONONLY, &hBitmap);
             }
         }
+        SAFE_RELEASE(psif);
+
+        if ( hasPath && (NULL != hBitmap) )
+        {
+            SdkThumbnailStore::Insert(szPath, nWidth, nHeight, hBitmap, SIIGBF_THUMBNAILONLY | SIIGBF_ICONONLY);
+        }
     }
 
     return hBitmap;
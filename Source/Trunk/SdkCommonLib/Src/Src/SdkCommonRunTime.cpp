@@ -13,7 +13,10 @@
 #include "SdkCommonRunTime.h"
 #include "SdkImagesManager.h"
 #include "SdkLogger.h"
+#include "SdkImageDecodeService.h"
 #include "SdkWICAnimatedGif.h"
+#include "SdkWICImageCache.h"
+#include "SdkThumbnailStore.h"
 #include "SdkWICImageHelper.h"
 
 USING_NAMESPACE_COMMON
@@ -25,6 +28,8 @@ BOOL SdkCommonRunTime::InitializeRunTime()
     SdkLogger::Initialize();
     SdkWICImageHelper::WICInitialize();
     SdkWICAnimatedGif::WICInitialize();
+    SdkImageDecodeService::Initialize();
+    SdkThumbnailStore::Open();
     SdkImagesManager::GdiplusInitialize();
 
     return TRUE;
@@ -35,6 +40,9 @@ BOOL SdkCommonRunTime::InitializeRunTime()
 void SdkCommonRunTime::UninitializeRunTime()
 {
     SdkLogger::Uninitialize();
+    SdkImageDecodeService::Uninitialize();
+    SdkThumbnailStore::Close();
+    SdkWICImageCache::Clear();
     SdkWICImageHelper::WICUninitialize();
     SdkWICAnimatedGif::WICUninitialize();
     SdkImagesManager::GdiplusInitialize();
@@ -11,6 +11,8 @@
 
 #include "stdafx.h"
 #include "SdkCrypt.h"
+#include "SdkAesCipher.h"
+#include "SdkAesGcm.h"
 
 USING_NAMESPACE_COMMON
 
@@ -123,10 +125,116 @@ static const BYTE g_szInnerXchgCryptKeyData[] =
 };
 
 
+/*!
+* @brief The cipher backend which calls CryptoAPI, the key handle keeps the chain state.
+*/
+class SdkCryptApiBackend : public ICryptBackend
+{
+public:
+
+    SdkCryptApiBackend(IN HCRYPTKEY hCryptKey) : m_hCryptKey(NULL)
+    {
+        // The backend owns a duplicated key, so its chain state is not shared.
+        if (NULL != hCryptKey)
+        {
+            CryptDuplicateKey(hCryptKey, NULL, 0, &m_hCryptKey);
+        }
+    }
+
+    virtual ~SdkCryptApiBackend()
+    {
+        if (NULL != m_hCryptKey)
+        {
+            CryptDestroyKey(m_hCryptKey);
+            m_hCryptKey = NULL;
+        }
+    }
+
+    BOOL IsValid() const
+    {
+        return (NULL != m_hCryptKey);
+    }
+
+    virtual BOOL SetIV(IN const BYTE *pbIV)
+    {
+        // Setting the IV also resets the feedback register of the key.
+        return CryptSetKeyParam(m_hCryptKey, KP_IV, pbIV, 0);
+    }
+
+    virtual BOOL Encrypt(IN OUT PBYTE pbData, IN OUT DWORD *pdwDataLen, IN DWORD dwBufLen, IN BOOL isFinal)
+    {
+        return CryptEncrypt(m_hCryptKey, NULL, isFinal, 0, pbData, pdwDataLen, dwBufLen);
+    }
+
+    virtual BOOL Decrypt(IN OUT PBYTE pbData, IN OUT DWORD *pdwDataLen, IN BOOL isFinal)
+    {
+        return CryptDecrypt(m_hCryptKey, NULL, isFinal, 0, pbData, pdwDataLen);
+    }
+
+    virtual BOOL EncryptBlock(IN const BYTE *pbIn, OUT BYTE *pbOut)
+    {
+        BYTE cbBlock[ENCRYPT_IV_SIZE] = { 0 };
+        memcpy_s(cbBlock, ENCRYPT_IV_SIZE, pbIn, ENCRYPT_IV_SIZE);
+
+        // Encrypt the block with ECB mode on a copy of the key, the chain state of
+        // the key used for streams is not touched.
+        HCRYPTKEY hEcbKey = NULL;
+        BOOL isOK = CryptDuplicateKey(m_hCryptKey, NULL, 0, &hEcbKey);
+        if ( isOK )
+        {
+            DWORD dwMode = CRYPT_MODE_ECB;
+            isOK = CryptSetKeyParam(hEcbKey, KP_MODE, (BYTE*)&dwMode, 0);
+        }
+
+        if ( isOK )
+        {
+            DWORD dwDataLen = ENCRYPT_IV_SIZE;
+            isOK = CryptEncrypt(hEcbKey, NULL, FALSE, 0, cbBlock, &dwDataLen, ENCRYPT_IV_SIZE);
+        }
+
+        if (NULL != hEcbKey)
+        {
+            CryptDestroyKey(hEcbKey);
+        }
+
+        if ( isOK )
+        {
+            memcpy_s(pbOut, ENCRYPT_IV_SIZE, cbBlock, ENCRYPT_IV_SIZE);
+        }
+
+        SecureZeroMemory(cbBlock, sizeof(cbBlock));
+
+        return isOK;
+    }
+
+    virtual ICryptBackend* Clone()
+    {
+        SdkCryptApiBackend *pBackend = new SdkCryptApiBackend(m_hCryptKey);
+        if ( !pBackend->IsValid() )
+        {
+            SAFE_DELETE(pBackend);
+        }
+
+        return pBackend;
+    }
+
+    virtual LPCTSTR GetName() const
+    {
+        return _T("CryptoAPI");
+    }
+
+private:
+
+    HCRYPTKEY   m_hCryptKey;        // The duplicated key.
+};
+
+
 //////////////////////////////////////////////////////////////////////////
 
 SdkCrypt::SdkCrypt() : m_hCryptProvider(NULL),
-                       m_hCryptKey(NULL)
+                       m_hCryptKey(NULL),
+                       m_backendType(CRYPT_BACKEND_AUTO),
+                       m_pCryptBackend(NULL)
 {
     ZeroMemory(&m_keyBlob,     sizeof(CRYPTKEYBLOBINFO));
     ZeroMemory(&m_xchgKeyBlob, sizeof(CRYPTKEYBLOBINFO));
@@ -162,7 +270,9 @@ SdkCrypt::SdkCrypt() : m_hCryptProvider(NULL),
 //////////////////////////////////////////////////////////////////////////
 
 SdkCrypt::SdkCrypt(IN SdkCryptKey *pCryptKey) : m_hCryptProvider(NULL),
-                                                m_hCryptKey(NULL)
+                                                m_hCryptKey(NULL),
+                                                m_backendType(CRYPT_BACKEND_AUTO),
+                                                m_pCryptBackend(NULL)
 {
     ZeroMemory(&m_keyBlob,     sizeof(CRYPTKEYBLOBINFO));
     ZeroMemory(&m_xchgKeyBlob, sizeof(CRYPTKEYBLOBINFO));
@@ -195,9 +305,23 @@ SdkCrypt::SdkCrypt(IN SdkCryptKey *pCryptKey) : m_hCryptProvider(NULL),
 
 SdkCrypt::~SdkCrypt()
 {
+    // The backend may hold a key of the CSP, so delete it first.
+    SAFE_DELETE(m_pCryptBackend);
+
     ::CryptDestroyKey(m_hCryptKey);
     ::CryptReleaseContext(m_hCryptProvider, 0);
 
+    // The blobs hold the plain key, wipe them before they are freed.
+    if (NULL != m_keyBlob.pbKeyBlob)
+    {
+        SecureZeroMemory(m_keyBlob.pbKeyBlob, m_keyBlob.dwKeyBlobLen);
+    }
+
+    if (NULL != m_xchgKeyBlob.pbKeyBlob)
+    {
+        SecureZeroMemory(m_xchgKeyBlob.pbKeyBlob, m_xchgKeyBlob.dwKeyBlobLen);
+    }
+
     SAFE_DELETE_ARRAY(m_keyBlob.pbKeyBlob);
     SAFE_DELETE_ARRAY(m_xchgKeyBlob.pbKeyBlob);
 }
@@ -229,7 +353,7 @@ CRYPT_RESULT SdkCrypt::InitializeScene()
             m_keyBlob.pbKeyBlob,    // The key blob data.
             m_keyBlob.dwKeyBlobLen, // The blob data size.
             NULL,                   // No public key.
-            0,                      // Zero.
+            GetKeyImportFlags(),    // Exportable only for the portable backend.
             &m_hCryptKey);          // The outer cryptographic key.
 
         // If fails to transfer cryptographic key.
@@ -252,7 +376,7 @@ CRYPT_RESULT SdkCrypt::InitializeScene()
                     m_keyBlob.pbKeyBlob,    // The key blob data.
                     m_keyBlob.dwKeyBlobLen, // The blob data size.
                     hxchgKey,               // The exchange key.
-                    0,                      // Zero.
+                    GetKeyImportFlags(),    // Exportable only for the portable backend.
                     &m_hCryptKey);          // The outer cryptographic key.
             }
 
@@ -262,6 +386,11 @@ CRYPT_RESULT SdkCrypt::InitializeScene()
 
     lResult = isOK ? CRYPT_ERROR_SUCCEED : CRYPT_ERROR_FAIL;
 
+    if (CRYPT_ERROR_SUCCEED == lResult)
+    {
+        lResult = CreateBackend();
+    }
+
     return lResult;
 }
 
@@ -307,6 +436,11 @@ CRYPT_RESULT SdkCrypt::CreateCryptKey(OUT SdkCryptKey **ppCryptKey)
         lResult = isOK ? CRYPT_ERROR_SUCCEED : CRYPT_ERROR_FAIL;
     }
 
+    if (CRYPT_ERROR_SUCCEED == lResult)
+    {
+        lResult = CreateBackend();
+    }
+
     if (CRYPT_ERROR_SUCCEED == lResult)
     {
         (*ppCryptKey) = new SdkCryptKey();
@@ -334,14 +468,11 @@ CRYPT_RESULT SdkCrypt::EncryptStream(IN OUT PBYTE pbData, DWORD dwDataSize, BOOL
         dwRealDataLen = dwDataSize;
     }
 
-    BOOL isOK = CryptEncrypt(
-        m_hCryptKey,            // The key handle.
-        NULL,                   // Not hash key.
-        isFinal,                // Is last section.
-        0,                      // dwFlags
+    BOOL isOK = (NULL != m_pCryptBackend) && m_pCryptBackend->Encrypt(
         pbData,                 // Data buffer to be encrypted.
         &dwRealDataLen,         // The block size to be encrypted.
-        dwDataSize);            // The buffer size.
+        dwDataSize,             // The buffer size.
+        isFinal);               // Is last section.
 
     lResult = isOK ? CRYPT_ERROR_SUCCEED : CRYPT_ERROR_FAIL;
 
@@ -352,7 +483,7 @@ CRYPT_RESULT SdkCrypt::EncryptStream(IN OUT PBYTE pbData, DWORD dwDataSize, BOOL
 
 CRYPT_RESULT SdkCrypt::DecryptStream(IN OUT PBYTE pbData, DWORD dwDataSize, BOOL isFinal)
 {
-    BOOL isOK = CryptDecrypt(m_hCryptKey, NULL, isFinal, 0, pbData, &dwDataSize);
+    BOOL isOK = (NULL != m_pCryptBackend) && m_pCryptBackend->Decrypt(pbData, &dwDataSize, isFinal);
 
     return (isOK ? CRYPT_ERROR_SUCCEED : CRYPT_ERROR_FAIL);
 }
@@ -391,3 +522,298 @@ CRYPT_RESULT SdkCrypt::GetCheckedCbSize(IN OUT DWORD *pdwCbSize, BOOL isFinal)
 
     return lResult;
 }
+
+//////////////////////////////////////////////////////////////////////////
+
+CRYPT_RESULT SdkCrypt::SetBackendType(IN CRYPT_BACKEND_TYPE backendType)
+{
+    m_backendType = backendType;
+
+    // The backend is created with the key.
+    if (NULL == m_hCryptKey)
+    {
+        return CRYPT_ERROR_SUCCEED;
+    }
+
+    // The key which is imported for CryptoAPI can not be exported, import it again. A created
+    // key is always exportable, so only an imported key goes here.
+    if ( (0 != GetKeyImportFlags()) && !IsKeyExportable() )
+    {
+        SAFE_DELETE(m_pCryptBackend);
+        ::CryptDestroyKey(m_hCryptKey);
+        m_hCryptKey = NULL;
+
+        return InitializeScene();
+    }
+
+    // Recreate the backend.
+    return CreateBackend();
+}
+
+//////////////////////////////////////////////////////////////////////////
+
+LPCTSTR SdkCrypt::GetBackendName() const
+{
+    return (NULL != m_pCryptBackend) ? m_pCryptBackend->GetName() : _T("");
+}
+
+//////////////////////////////////////////////////////////////////////////
+
+CRYPT_RESULT SdkCrypt::DuplicateScene(OUT SdkCrypt **ppCrypt)
+{
+    if ( (NULL == ppCrypt) || (NULL == m_hCryptProvider) || (NULL == m_hCryptKey) || (NULL == m_pCryptBackend) )
+    {
+        return CRYPT_ERROR_FAIL;
+    }
+
+    // The backend keeps the chaining state, so each thread must own its backend.
+    ICryptBackend *pDupBackend = m_pCryptBackend->Clone();
+    if (NULL == pDupBackend)
+    {
+        return CRYPT_ERROR_FAIL;
+    }
+
+    HCRYPTKEY hDupKey = NULL;
+    if ( !CryptDuplicateKey(m_hCryptKey, NULL, 0, &hDupKey) )
+    {
+        SAFE_DELETE(pDupBackend);
+        return CRYPT_ERROR_FAIL;
+    }
+
+    // The new object releases the CSP in its destructor, so add a reference here.
+    if ( !CryptContextAddRef(m_hCryptProvider, NULL, 0) )
+    {
+        CryptDestroyKey(hDupKey);
+        SAFE_DELETE(pDupBackend);
+        return CRYPT_ERROR_FAIL;
+    }
+
+    SdkCrypt *pCrypt = new SdkCrypt((SdkCryptKey*)NULL);
+    pCrypt->m_hCryptProvider = m_hCryptProvider;
+    pCrypt->m_hCryptKey      = hDupKey;
+    pCrypt->m_backendType    = m_backendType;
+    pCrypt->m_pCryptBackend  = pDupBackend;
+
+    CRYPT_RESULT lResult = pCrypt->SetStreamIV(NULL);
+    if (CRYPT_ERROR_SUCCEED != lResult)
+    {
+        SAFE_DELETE(pCrypt);
+    }
+
+    (*ppCrypt) = pCrypt;
+
+    return lResult;
+}
+
+//////////////////////////////////////////////////////////////////////////
+
+CRYPT_RESULT SdkCrypt::SetStreamIV(IN const BYTE *pbIV)
+{
+    BYTE cbIV[ENCRYPT_IV_SIZE] = { 0 };
+    if (NULL != pbIV)
+    {
+        memcpy_s(cbIV, ENCRYPT_IV_SIZE, pbIV, ENCRYPT_IV_SIZE);
+    }
+
+    BOOL isOK = (NULL != m_pCryptBackend) && m_pCryptBackend->SetIV(cbIV);
+
+    return (isOK ? CRYPT_ERROR_SUCCEED : CRYPT_ERROR_FAIL);
+}
+
+//////////////////////////////////////////////////////////////////////////
+
+CRYPT_RESULT SdkCrypt::DeriveChunkIV(IN const BYTE *pbNonce, IN UINT64 nChunkIndex, OUT BYTE *pbIV)
+{
+    if ( (NULL == pbNonce) || (NULL == pbIV) )
+    {
+        return CRYPT_ERROR_INVALIDPARAM;
+    }
+
+    BYTE cbBlock[ENCRYPT_IV_SIZE] = { 0 };
+    memcpy_s(cbBlock, ENCRYPT_IV_SIZE, pbNonce, ENCRYPT_IV_SIZE);
+
+    // Mix the chunk index into the last 8 bytes of the nonce, little endian.
+    for (int i = 0; i < 8; ++i)
+    {
+        cbBlock[ENCRYPT_IV_SIZE - 8 + i] ^= (BYTE)(nChunkIndex >> (i * 8));
+    }
+
+    // The block is encrypted without chaining, the stream state is not touched.
+    BOOL isOK = (NULL != m_pCryptBackend) && m_pCryptBackend->EncryptBlock(cbBlock, cbBlock);
+
+    if ( isOK )
+    {
+        memcpy_s(pbIV, ENCRYPT_IV_SIZE, cbBlock, ENCRYPT_IV_SIZE);
+    }
+
+    SecureZeroMemory(cbBlock, sizeof(cbBlock));
+
+    return (isOK ? CRYPT_ERROR_SUCCEED : CRYPT_ERROR_FAIL);
+}
+
+//////////////////////////////////////////////////////////////////////////
+
+CRYPT_RESULT SdkCrypt::GenerateRandom(OUT PBYTE pbBuffer, IN DWORD dwSize)
+{
+    if ( (NULL == pbBuffer) || (NULL == m_hCryptProvider) )
+    {
+        return CRYPT_ERROR_FAIL;
+    }
+
+    BOOL isOK = CryptGenRandom(m_hCryptProvider, dwSize, pbBuffer);
+
+    return (isOK ? CRYPT_ERROR_SUCCEED : CRYPT_ERROR_FAIL);
+}
+
+//////////////////////////////////////////////////////////////////////////
+
+CRYPT_RESULT SdkCrypt::ComputeDigest(IN const BYTE *pbData, IN DWORD dwSize, OUT PBYTE pbDigest)
+{
+    if ( (NULL == pbData) || (NULL == pbDigest) || (NULL == m_hCryptProvider) )
+    {
+        return CRYPT_ERROR_FAIL;
+    }
+
+    HCRYPTHASH hHash = NULL;
+    if ( !CryptCreateHash(m_hCryptProvider, CALG_SHA_256, 0, 0, &hHash) )
+    {
+        return CRYPT_ERROR_FAIL;
+    }
+
+    DWORD dwDigestSize = ENCRYPT_DIGEST_SIZE;
+    BOOL isOK = CryptHashData(hHash, pbData, dwSize, 0) &&
+                CryptGetHashParam(hHash, HP_HASHVAL, pbDigest, &dwDigestSize, 0) &&
+                (ENCRYPT_DIGEST_SIZE == dwDigestSize);
+
+    CryptDestroyHash(hHash);
+
+    return (isOK ? CRYPT_ERROR_SUCCEED : CRYPT_ERROR_FAIL);
+}
+
+//////////////////////////////////////////////////////////////////////////
+
+CRYPT_RESULT SdkCrypt::CreateAeadCipher(OUT SdkAesGcm **ppAeadCipher)
+{
+    if ( (NULL == ppAeadCipher) || (NULL == m_pCryptBackend) )
+    {
+        return CRYPT_ERROR_FAIL;
+    }
+
+    // The GCM key is two encrypted label blocks, it works with any backend.
+    static const BYTE s_cbKeyLabel[2][ENCRYPT_IV_SIZE] =
+    {
+        { 'S', 'd', 'k', 'C', 'r', 'y', 'p', 't', '-', 'G', 'C', 'M', '-', 'K', 'E', 'Y' },
+        { 'S', 'd', 'k', 'C', 'r', 'y', 'p', 't', '-', 'G', 'C', 'M', '-', 'K', 'E', 'Z' },
+    };
+
+    BYTE cbKey[2 * ENCRYPT_IV_SIZE] = { 0 };
+    BOOL isOK = m_pCryptBackend->EncryptBlock(s_cbKeyLabel[0], cbKey) &&
+                m_pCryptBackend->EncryptBlock(s_cbKeyLabel[1], cbKey + ENCRYPT_IV_SIZE);
+
+    SdkAesGcm *pAeadCipher = NULL;
+    if ( isOK )
+    {
+        BOOL isUseHardware = (CRYPT_BACKEND_PORTABLE_SOFTWARE != m_backendType);
+        pAeadCipher = new SdkAesGcm(cbKey, sizeof(cbKey), isUseHardware);
+        if ( !pAeadCipher->IsValid() )
+        {
+            SAFE_DELETE(pAeadCipher);
+        }
+    }
+
+    SecureZeroMemory(cbKey, sizeof(cbKey));
+
+    *ppAeadCipher = pAeadCipher;
+
+    return (NULL != pAeadCipher) ? CRYPT_ERROR_SUCCEED : CRYPT_ERROR_FAIL;
+}
+
+//////////////////////////////////////////////////////////////////////////
+
+CRYPT_RESULT SdkCrypt::CreateBackend()
+{
+    SAFE_DELETE(m_pCryptBackend);
+
+    if (NULL == m_hCryptKey)
+    {
+        return CRYPT_ERROR_FAIL;
+    }
+
+    if (CRYPT_BACKEND_CRYPTOAPI != m_backendType)
+    {
+        // Export the raw key for the portable backend, the blob is BLOBHEADER, key size and key.
+        DWORD dwBlobLen = 0;
+        if ( CryptExportKey(m_hCryptKey, NULL, PLAINTEXTKEYBLOB, 0, NULL, &dwBlobLen) )
+        {
+            PBYTE pbBlob = new BYTE[dwBlobLen];
+            if ( CryptExportKey(m_hCryptKey, NULL, PLAINTEXTKEYBLOB, 0, pbBlob, &dwBlobLen) &&
+                 (dwBlobLen >= sizeof(BLOBHEADER) + sizeof(DWORD)) )
+            {
+                DWORD dwKeySize = *(DWORD*)(pbBlob + sizeof(BLOBHEADER));
+                if (dwBlobLen >= sizeof(BLOBHEADER) + sizeof(DWORD) + dwKeySize)
+                {
+                    SdkAesCipher *pAesCipher = new SdkAesCipher(
+                        pbBlob + sizeof(BLOBHEADER) + sizeof(DWORD),
+                        dwKeySize,
+                        (CRYPT_BACKEND_PORTABLE_SOFTWARE != m_backendType));
+
+                    if ( pAesCipher->IsValid() )
+                    {
+                        m_pCryptBackend = pAesCipher;
+                    }
+                    else
+                    {
+                        SAFE_DELETE(pAesCipher);
+                    }
+                }
+            }
+
+            SecureZeroMemory(pbBlob, dwBlobLen);
+            SAFE_DELETE_ARRAY(pbBlob);
+        }
+
+        // Only the automatic type can fall back to CryptoAPI.
+        if ( (NULL == m_pCryptBackend) && (CRYPT_BACKEND_AUTO != m_backendType) )
+        {
+            return CRYPT_ERROR_FAIL;
+        }
+    }
+
+    if (NULL == m_pCryptBackend)
+    {
+        SdkCryptApiBackend *pApiBackend = new SdkCryptApiBackend(m_hCryptKey);
+        if ( pApiBackend->IsValid() )
+        {
+            m_pCryptBackend = pApiBackend;
+        }
+        else
+        {
+            SAFE_DELETE(pApiBackend);
+        }
+    }
+
+    return (NULL != m_pCryptBackend) ? CRYPT_ERROR_SUCCEED : CRYPT_ERROR_FAIL;
+}
+
+//////////////////////////////////////////////////////////////////////////
+
+DWORD SdkCrypt::GetKeyImportFlags() const
+{
+    // The automatic type tries the portable backend first.
+    return (CRYPT_BACKEND_CRYPTOAPI != m_backendType) ? CRYPT_EXPORTABLE : 0;
+}
+
+//////////////////////////////////////////////////////////////////////////
+
+BOOL SdkCrypt::IsKeyExportable() const
+{
+    DWORD dwPermissions = 0;
+    DWORD dwDataLen = sizeof(DWORD);
+    if ( (NULL == m_hCryptKey) ||
+         !CryptGetKeyParam(m_hCryptKey, KP_PERMISSIONS, (PBYTE)&dwPermissions, &dwDataLen, 0) )
+    {
+        return FALSE;
+    }
+
+    return (0 != (dwPermissions & CRYPT_EXPORT)) ? TRUE : FALSE;
+}
@@ -16,6 +16,12 @@
 #include "SdkUserInfoUtil.h"
 #include "SdkCommonHelper.h"
 #include "SdkBase64Util.h"
+#include "SdkAesGcm.h"
+#include "SdkCryptFileReader.h"
+#include "SdkCryptIoPipeline.h"
+#include "SdkCryptKeyCache.h"
+#include <process.h>
+#include <algorithm>
 
 USING_NAMESPACE_COMMON
 
@@ -35,6 +41,39 @@ struct NAMESPACE_COMMONLIB:: _CRYPTHEADER
 };
 
 
+/*!
+* @brief The chunk information of the chunked encrypted files, it follows the crypt header.
+*/
+struct NAMESPACE_COMMONLIB::_CRYPTCHUNKINFO
+{
+    DWORD   dwVersion;                              // The version of the chunk container.
+    DWORD   dwChunkSize;                            // The plain size of every chunk except the last one.
+    UINT64  nChunkCount;                            // The number of chunks.
+    BYTE    cbNonce[ENCRYPT_IV_SIZE];               // The file nonce to derive the IV of each chunk.
+};
+
+
+/*!
+* @brief The journal record of the in-place encryption, the plain data of the window
+*        being encrypted follows it.
+*/
+struct NAMESPACE_COMMONLIB::_CRYPTJOURNAL
+{
+    DWORD   dwIdentity;                             // The flag of the journal.
+    DWORD   dwChecksum;                             // The checksum of the following fields and the saved data.
+    UINT64  nSequence;                              // The sequence of the record, the bigger one is newer.
+    UINT64  nFileSize;                              // The plain size of the file.
+    UINT64  nFileIndex;                             // The file ID, the file is not replaced by another one.
+    UINT64  nWindowIndex;                           // The window which is being encrypted.
+    DWORD   dwWindowSize;                           // The plain size of a window.
+    DWORD   dwDataSize;                             // The size of the saved data.
+    DWORD   dwVolumeSerial;                         // The serial number of the volume of the file.
+    DWORD   dwCheckSize;                            // The size of the region which is checked by the digest.
+    BYTE    cbCheckDigest[ENCRYPT_DIGEST_SIZE];     // The digest of a region which the window does not write.
+    BYTE    cbChainIV[ENCRYPT_IV_SIZE];             // The last encrypted block before the window.
+};
+
+
 /*!
 * @brief The DESTFILEINFO structure.
 */
@@ -46,6 +85,8 @@ struct NAMESPACE_COMMONLIB::_DESTFILEINFO
     BOOL            isSuccess;                // Create or open the destination file success or failure
     DWORD           dwFlagsAndAttributes;     // The flag and attributes
     CRYPTHEADER     destFileHeader;           // The struct of the CRYPTHEADER
+    CRYPTCHUNKINFO  chunkInfo;                // The chunk information, only for chunked files
+    BYTE            cbHeaderDigest[ENCRYPT_DIGEST_SIZE];  // The digest of the header, only for authenticated chunks
 };
 
 
@@ -64,6 +105,7 @@ struct NAMESPACE_COMMONLIB::_FILEINFOS
     BOOL            isSuccess;                // This member determines encrypt or open file success or not
     BOOL            isBigFile;                // This member determines this file is big or small file
     BOOL            isReplaced;               // Replace the old file or not
+    BOOL            isChunked;                // This member determines the file uses chunked container
     DESTFILEINFO    sDestFileInfo;            // The struct of the destination file information
 };
 
@@ -76,6 +118,164 @@ struct NAMESPACE_COMMONLIB::_FILEINFOS
 #define ENCRYPTED_FILE_IDENTIFIER    0x55504654              // 0x55504654 is the DWORD value of "TFPU"
 #define MAX_BUFFER_SIZE              64 * 1024               // the buffer size, this value must be multiple of 16
 #define HEADER_SIZE                  sizeof(CRYPTHEADER)     // the header size
+#define ENCRYPTED_FILE_IDENTIFIER_CHUNKED  0x43504654        // 0x43504654 is the DWORD value of "TFPC"
+#define CRYPT_CHUNK_VERSION_CBC      1                       // each chunk is a CBC stream with its own IV
+#define CRYPT_CHUNK_VERSION_GCM      2                       // each chunk is AES-GCM ciphertext followed by its tag
+#define CRYPT_CHUNK_SIZE             (MAX_WRITE_RATE * ALLOCATION_GRANULARITY)   // the plain size of a chunk
+#define CHUNKINFO_SIZE               sizeof(CRYPTCHUNKINFO)  // the chunk information size, multiple of 32
+#define MAX_CRYPT_THREADS            MAXIMUM_WAIT_OBJECTS    // the max number of chunk workers
+#define CHUNK_WAIT_INTERVAL          200                     // the interval to update progress, in ms
+#define INPLACE_JOURNAL_EXTENDNAME   _T(".tofpj")            // the extension of the in-place journal
+#define INPLACE_JOURNAL_IDENTIFIER   0x4A504654              // 0x4A504654 is the DWORD value of "TFPJ"
+#define INPLACE_WINDOW_RATE          256                     // the window of the in-place mode, in allocation granularities
+#define CHUNK_AAD_SIZE               (3 * sizeof(UINT64) + ENCRYPT_DIGEST_SIZE)  // the additional authenticated data size of a GCM chunk
+#define DEFAULT_BATCH_IO_DEPTH       8                       // the default max number of files in I/O at the same time
+
+
+/*!
+* @brief The shared state of the workers which crypt one chunked file.
+*/
+struct NAMESPACE_COMMONLIB::_CRYPTCHUNKTASK
+{
+    LPFILEINFOS     lpFileInfos;              // The file to crypt.
+    BOOL            isEncrypt;                // Encrypt or decrypt.
+    DWORD           dwVersion;                // The version of the chunk container.
+    DWORD           dwChunkSize;              // The plain size of a chunk.
+    DWORD           dwAllocationGranularity;  // The system allocation granularity.
+    LONG            lChunkCount;              // The number of chunks.
+    volatile LONG   lNextChunk;               // The next chunk to be picked by a worker.
+    volatile LONG   lCompletedChunks;         // The number of finished chunks.
+    volatile LONG   lResult;                  // The first error of the workers.
+    volatile LONG   lCancelled;               // The operation is cancelled.
+    SdkAesGcm      *pAeadCipher;              // The shared GCM cipher, only for authenticated chunks.
+};
+
+
+/*!
+* @brief The private data of one chunk worker thread.
+*/
+struct NAMESPACE_COMMONLIB::_CRYPTCHUNKWORKER
+{
+    LPCRYPTCHUNKTASK lpTask;                  // The shared task.
+    SdkCrypt        *pCrypt;                  // The crypt object owned by this worker.
+    PBYTE            pbBuffer;                // The chunk buffer owned by this worker.
+};
+
+
+/*!
+* @brief The shared state of the workers which crypt the small files in batch.
+*/
+struct NAMESPACE_COMMONLIB::_CRYPTBATCHTASK
+{
+    CRYPT_OP_TYPE               operationType;    // Encrypt or decrypt.
+    const vector<LPFILEINFOS>  *pFileInfoList;    // The file list of the owner.
+    vector<UINT32>              vctFileIndices;   // The indices of the files of the workers in the file list.
+    vector<LONG>                vctResults;       // The result of each file.
+    vector<LONG>                vctFinished;      // Each file is finished or not.
+    LONG                        lFileCount;       // The number of files of the workers.
+    volatile LONG               lNextFile;        // The next file to be picked by a worker.
+    volatile LONG               lCancelled;       // The operation is cancelled.
+    volatile LONG               lRunningWorkers;  // The number of workers which are running.
+};
+
+
+/*!
+* @brief The private data of one batch worker thread.
+*/
+struct NAMESPACE_COMMONLIB::_CRYPTBATCHWORKER
+{
+    LPCRYPTBATCHTASK lpTask;                  // The shared task.
+    SdkCryptFile    *pCryptFile;              // The worker object which owns its key handle and buffers.
+};
+
+
+/*!
+* @brief An inquiry of a batch worker, it is answered on the thread which calls BeginCrypt.
+*/
+struct NAMESPACE_COMMONLIB::_CRYPTBATCHINQUIRY
+{
+    LPCTSTR                 lpFileName;       // The conflicted file name.
+    CRYPT_INQUIRE_RESULT    nResult;          // The answer of the sink.
+    HANDLE                  hAnswered;        // Signaled when the answer is set.
+};
+
+
+/*!
+* @brief Get the encrypted size of a chunk. A CBC chunk is a final block so it is padded,
+*        a GCM chunk keeps the plain size and is followed by its tag.
+*/
+static inline DWORD GetChunkCipherSize(DWORD dwVersion, DWORD dwPlainSize)
+{
+    if (CRYPT_CHUNK_VERSION_GCM == dwVersion)
+    {
+        return dwPlainSize + AES_GCM_TAG_SIZE;
+    }
+
+    DWORD dwMod = dwPlainSize % ENCRYPT_LAST_PART_VERIFYDATA_SIZE;
+    if (0 != dwMod)
+    {
+        dwPlainSize += ENCRYPT_LAST_PART_VERIFYDATA_SIZE - dwMod;
+    }
+
+    return dwPlainSize + ENCRYPT_LAST_PART_VERIFYDATA_SIZE;
+}
+
+
+/*!
+* @brief Get the checksum of the journal record and the saved data, it is FNV-1a.
+*/
+static DWORD GetJournalChecksum(const CRYPTJOURNAL& journal, const BYTE *pbData)
+{
+    DWORD dwHash = 2166136261;
+    const BYTE *pbFields = (const BYTE*)&journal.nSequence;
+    DWORD dwFieldsSize = sizeof(CRYPTJOURNAL) - (DWORD)(pbFields - (const BYTE*)&journal);
+
+    for (DWORD i = 0; i < dwFieldsSize; ++i)
+    {
+        dwHash = (dwHash ^ pbFields[i]) * 16777619;
+    }
+
+    for (DWORD i = 0; i < journal.dwDataSize; ++i)
+    {
+        dwHash = (dwHash ^ pbData[i]) * 16777619;
+    }
+
+    return dwHash;
+}
+
+
+/*!
+* @brief Get the size of the encrypted file which is not chunked.
+*/
+static inline UINT64 GetCipherFileSize(UINT64 nFileSize, DWORD dwDataBegin)
+{
+    UINT64 nCipherFileSize = nFileSize + dwDataBegin;
+    DWORD dwMod = (DWORD)(nFileSize % ENCRYPT_BLOCK_SIZE);
+    if ( 0 != dwMod )
+    {
+        nCipherFileSize += ENCRYPT_BLOCK_SIZE - dwMod;
+    }
+
+    return nCipherFileSize + ENCRYPT_LAST_PART_VERIFYDATA_SIZE;
+}
+
+
+/*!
+* @brief The order of the big files of the batch mode, the biggest one is the first.
+*/
+static bool BatchFileSizeGreater(const pair<UINT64, UINT32>& first, const pair<UINT64, UINT32>& second)
+{
+    return (first.first > second.first);
+}
+
+
+/*!
+* @brief Get the number of chunks of the data.
+*/
+static inline UINT64 GetChunkCount(UINT64 nDataLength, DWORD dwChunkSize)
+{
+    return (nDataLength + dwChunkSize - 1) / dwChunkSize;
+}
 
 
 //////////////////////////////////////////////////////////////////////////
@@ -85,42 +285,39 @@ CryptString SdkCryptFile::EncryptFileName(IN const CryptString& strFileName)
     CryptString strRetFileName = strFileName;
     DWORD dwOriSize  = (strFileName.size() + 1) * sizeof(TCHAR);
     DWORD dwDataSize = dwOriSize;
-    SdkCrypt cryptObj;
+    SdkCrypt *pCrypt = NULL;
     CRYPT_RESULT nResult = CRYPT_ERROR_FAIL;
 
-    // Get the appropriate size of data buffer.
-    nResult = cryptObj.GetCheckedCbSize(&dwDataSize, TRUE);
-
-    // Initialize the crypt scene.
-    nResult = cryptObj.InitializeScene();
+    // The scene of the inner key is duplicated from the key cache, it is not imported each time.
+    nResult = SdkCryptKeyCache::AcquireCrypt(NULL, NULL, &pCrypt);
     if (CRYPT_ERROR_SUCCEED == nResult)
     {
+        // Get the appropriate size of data buffer.
+        pCrypt->GetCheckedCbSize(&dwDataSize, TRUE);
+
         BYTE *pData = new BYTE[dwDataSize];
         ZeroMemory(pData, dwDataSize);
         memcpy_s(pData, dwDataSize, (void*)strFileName.c_str(), dwOriSize);
 
         // Encrypt the data.
-        nResult = cryptObj.EncryptStream(pData, dwDataSize, TRUE);
+        nResult = pCrypt->EncryptStream(pData, dwDataSize, TRUE);
         if (CRYPT_ERROR_SUCCEED == nResult)
         {
-            CHAR szConvertBuffer[512] = { 0 };
-            CHAR *pEncryptData = new CHAR[dwDataSize + 2];
-            ZeroMemory(pEncryptData, dwDataSize+ 2);
-            memcpy_s(pEncryptData, dwDataSize, pData, dwDataSize);
-            SdkBase64Util::Encode(pEncryptData, dwDataSize, szConvertBuffer, 512);
+            // The encoded string is sized by the data, the long names are not truncated.
+            string strBase64 = SdkBase64Util::Encode(string((const CHAR*)pData, dwDataSize));
 
 #ifdef UNICODE
-            strRetFileName = SdkCommonHelper::AnsiToUnicode(szConvertBuffer);
+            strRetFileName = SdkCommonHelper::AnsiToUnicode(strBase64.c_str());
 #else
-            strRetFileName = CryptString(szConvertBuffer);
+            strRetFileName = CryptString(strBase64);
 #endif // UNICODE
-
-            SAFE_DELETE_ARRAY(pEncryptData);
         }
 
         SAFE_DELETE_ARRAY(pData);
     }
 
+    SAFE_DELETE(pCrypt);
+
     return strRetFileName;
 }
 
@@ -130,9 +327,21 @@ SdkCryptFile::SdkCryptFile(BOOL isDefProgressBar) : m_nFileIndex(0),
                                                     m_nFileNumbers(0),
                                                     m_hasCancelCrypt(FALSE),
                                                     m_bDelOriginalFiles(FALSE),
+                                                    m_isParallelCrypt(FALSE),
+                                                    m_nCryptThreads(0),
+                                                    m_isAuthenticatedCrypt(FALSE),
+                                                    m_isInPlaceCrypt(FALSE),
+                                                    m_isAsyncIO(TRUE),
+                                                    m_isBatchCrypt(FALSE),
+                                                    m_nBatchThreads(0),
+                                                    m_nBatchIoDepth(0),
                                                     m_pCryptFileSink(NULL),
                                                     m_pCrypt(NULL),
-                                                    m_pProgressDialog(NULL)
+                                                    m_pProgressDialog(NULL),
+                                                    m_pIoPipeline(NULL),
+                                                    m_pBatchOwner(NULL),
+                                                    m_hBatchMutex(NULL),
+                                                    m_hBatchInquiry(NULL)
 {
     // Get the allocation granularity, typical value is 65536.
     SYSTEM_INFO sinf;
@@ -153,7 +362,7 @@ SdkCryptFile::SdkCryptFile(BOOL isDefProgressBar) : m_nFileIndex(0),
 
     // Allocate the memory for header block.
     m_HeaderBlock.dwBlobSize = 
-        HEADER_SIZE + ENCRYPT_BLOCK_SIZE + ENCRYPT_LAST_PART_VERIFYDATA_SIZE;
+        HEADER_SIZE + CHUNKINFO_SIZE + ENCRYPT_BLOCK_SIZE + ENCRYPT_LAST_PART_VERIFYDATA_SIZE;
     m_HeaderBlock.pbBlob = new BYTE[m_HeaderBlock.dwBlobSize];
 
     // Allocate the memory for small file block.
@@ -180,6 +389,9 @@ SdkCryptFile::~SdkCryptFile()
 
     SAFE_DELETE(m_pCrypt);
     SAFE_DELETE(m_pProgressDialog);
+    SAFE_DELETE(m_pIoPipeline);
+    SAFE_CLOSE_HANDLE(m_hBatchMutex);
+    SAFE_CLOSE_HANDLE(m_hBatchInquiry);
     SAFE_DELETE_ARRAY(m_SmallFileBlock.pbBlob);
     SAFE_DELETE_ARRAY(m_HeaderBlock.pbBlob);
 }
@@ -214,36 +426,22 @@ CRYPT_RESULT SdkCryptFile::BeginCrypt(IN CRYPT_OP_TYPE operationType)
 
     OnCryptBegin(operationType);
 
-    int nSize = (int)m_vFileInfoList.size();
-    for (int i = 0; i < nSize; ++i)
+    if ( m_isBatchCrypt )
     {
-        // The user cancel the operation.
-        if ( HasCancelled() )
-        {
-            break;
-        }
-
-        LPFILEINFOS lpFileInfo = m_vFileInfoList[i];
-        OnCryptNext(i, lpFileInfo->szFilePath);
-
-        // Do encrypt or decrypt operation.
-        if (CRYPT_OP_ENCRYPT == operationType)
-        {
-            nResult = EncryptFile(lpFileInfo);
-        }
-        else
+        CryptBatchFiles(operationType);
+    }
+    else
+    {
+        int nSize = (int)m_vFileInfoList.size();
+        for (int i = 0; i < nSize; ++i)
         {
-            nResult = DecryptFile(lpFileInfo);
-        }
-
-        CloseHandles(lpFileInfo);
+            // The user cancel the operation.
+            if ( HasCancelled() )
+            {
+                break;
+            }
 
-        // Show the error.
-        if ( (CRYPT_ERROR_SUCCEED != nResult) && (CRYPT_ERROR_CANCEL != nResult) )
-        {
-            // Show the error message.
-            CryptString strErrorMsg(FormatErrorMessage(nResult, lpFileInfo->szFilePath));
-            OnCryptError(strErrorMsg.c_str());
+            CryptFileByIndex(i, operationType);
         }
     }
 
@@ -298,6 +496,54 @@ CRYPT_RESULT SdkCryptFile::SetCryptFileSink(IN ICryptFileNotify *pCryptFileSink)
 
 //////////////////////////////////////////////////////////////////////////
 
+CRYPT_RESULT SdkCryptFile::SetParallelCrypt(IN BOOL isParallel, IN UINT32 nThreadCount)
+{
+    m_isParallelCrypt = isParallel;
+    m_nCryptThreads   = MIN(nThreadCount, MAX_CRYPT_THREADS);
+
+    return CRYPT_ERROR_SUCCEED;
+}
+
+//////////////////////////////////////////////////////////////////////////
+
+CRYPT_RESULT SdkCryptFile::SetAuthenticatedCrypt(IN BOOL isAuthenticated)
+{
+    m_isAuthenticatedCrypt = isAuthenticated;
+
+    return CRYPT_ERROR_SUCCEED;
+}
+
+//////////////////////////////////////////////////////////////////////////
+
+CRYPT_RESULT SdkCryptFile::SetInPlaceCrypt(IN BOOL isInPlace)
+{
+    m_isInPlaceCrypt = isInPlace;
+
+    return CRYPT_ERROR_SUCCEED;
+}
+
+//////////////////////////////////////////////////////////////////////////
+
+CRYPT_RESULT SdkCryptFile::SetAsyncIO(IN BOOL isAsync)
+{
+    m_isAsyncIO = isAsync;
+
+    return CRYPT_ERROR_SUCCEED;
+}
+
+//////////////////////////////////////////////////////////////////////////
+
+CRYPT_RESULT SdkCryptFile::SetBatchCrypt(IN BOOL isBatch, IN UINT32 nThreadCount, IN UINT32 nIoDepth)
+{
+    m_isBatchCrypt  = isBatch;
+    m_nBatchThreads = MIN(nThreadCount, MAX_CRYPT_THREADS);
+    m_nBatchIoDepth = nIoDepth;
+
+    return CRYPT_ERROR_SUCCEED;
+}
+
+//////////////////////////////////////////////////////////////////////////
+
 CRYPT_RESULT SdkCryptFile::CancelCrypt()
 {
     m_hasCancelCrypt = TRUE;
@@ -355,9 +601,15 @@ CRYPT_RESULT SdkCryptFile::InitCryptData(IN CRYPT_OP_TYPE operationType)
 
 CRYPT_RESULT SdkCryptFile::InitCryptScene()
 {
-    CRYPT_RESULT nResult = CRYPT_ERROR_SUCCEED;
+    SAFE_DELETE(m_pCrypt);
+
+    // First get the key of user's folder from the key cache, it is loaded if it is not cached.
+    CRYPT_RESULT nResult = SdkCryptKeyCache::AcquireCrypt(m_strCryptKeyPath.c_str(), m_strPassword.c_str(), &m_pCrypt);
+    if (CRYPT_ERROR_SUCCEED == nResult)
+    {
+        return nResult;
+    }
 
-    // First load key from user's folder.
     SdkCryptKey cryptKey;
     BOOL isSucceed = cryptKey.LoadFromFile(m_strCryptKeyPath.c_str());
 
@@ -371,6 +623,9 @@ CRYPT_RESULT SdkCryptFile::InitCryptScene()
         if (CRYPT_ERROR_SUCCEED == nResult)
         {
             isSucceed = pCryptKey->SaveToFile(m_strCryptKeyPath.c_str());
+
+            // The keys cached for the old file are not valid any more.
+            SdkCryptKeyCache::Evict(m_strCryptKeyPath.c_str());
         }
 
         if (!isSucceed)
@@ -406,6 +661,23 @@ CRYPT_RESULT SdkCryptFile::InitCryptHeader(OUT LPFILEINFOS lpDestFileInfos)
     // set the identity value, is ENCRYPTED_FILE_IDENTIFIER
     lpDestFileInfos->sDestFileInfo.destFileHeader.dwIdentity = ENCRYPTED_FILE_IDENTIFIER;
 
+    // The chunked file has its own identity and the chunk information.
+    if (lpDestFileInfos->isChunked)
+    {
+        LPCRYPTCHUNKINFO lpChunkInfo = &lpDestFileInfos->sDestFileInfo.chunkInfo;
+
+        lpDestFileInfos->sDestFileInfo.destFileHeader.dwIdentity = ENCRYPTED_FILE_IDENTIFIER_CHUNKED;
+        lpChunkInfo->dwVersion   = m_isAuthenticatedCrypt ? CRYPT_CHUNK_VERSION_GCM : CRYPT_CHUNK_VERSION_CBC;
+        lpChunkInfo->dwChunkSize = CRYPT_CHUNK_SIZE;
+        lpChunkInfo->nChunkCount = GetChunkCount(lpDestFileInfos->nFileSize, CRYPT_CHUNK_SIZE);
+
+        CRYPT_RESULT nResult = m_pCrypt->GenerateRandom(lpChunkInfo->cbNonce, ENCRYPT_IV_SIZE);
+        if (CRYPT_ERROR_SUCCEED != nResult)
+        {
+            return CRYPT_ERROR_ENCRYPT;
+        }
+    }
+
     // Set current user name
     memcpy(lpDestFileInfos->sDestFileInfo.destFileHeader.cbUserName,
         m_strDomainUserName.c_str(),
@@ -486,11 +758,53 @@ CRYPT_RESULT SdkCryptFile::ReadCryptHeader(OUT LPFILEINFOS lpFileInfos)
     // Copy data in buffer to the struct
     memcpy(&cryptHeader, m_HeaderBlock.pbBlob, HEADER_SIZE);
 
+    // The chunk information follows the header, it is in the same cipher chain.
+    if (ENCRYPTED_FILE_IDENTIFIER_CHUNKED == cryptHeader.dwIdentity)
+    {
+        PBYTE pbChunkInfo = m_HeaderBlock.pbBlob + dwHeaderSize;
+
+        isSucceed = ReadFile(
+            lpFileInfos->hFile,
+            pbChunkInfo,
+            CHUNKINFO_SIZE,
+            &dwBytesRead,
+            NULL);
+
+        if ( !isSucceed || (CHUNKINFO_SIZE != dwBytesRead) )
+        {
+            return CRYPT_ERROR_READDATA;
+        }
+
+        nResult = m_pCrypt->DecryptStream(pbChunkInfo, CHUNKINFO_SIZE, isLastBlock);
+        if (CRYPT_ERROR_SUCCEED != nResult)
+        {
+            return CRYPT_ERROR_DECRYPT;
+        }
+
+        CRYPTCHUNKINFO chunkInfo = { 0 };
+        memcpy(&chunkInfo, pbChunkInfo, sizeof(CRYPTCHUNKINFO));
+
+        // Validate the chunk layout before any mapping is done with it. The chunk size sets
+        // the buffers of the workers, so only the size written by this class is accepted.
+        BOOL isValidLayout = ( (CRYPT_CHUNK_VERSION_CBC == chunkInfo.dwVersion) ||
+                               (CRYPT_CHUNK_VERSION_GCM == chunkInfo.dwVersion) ) &&
+                             (CRYPT_CHUNK_SIZE == chunkInfo.dwChunkSize) &&
+                             (chunkInfo.nChunkCount == GetChunkCount(cryptHeader.nDataLength, chunkInfo.dwChunkSize)) &&
+                             (chunkInfo.nChunkCount <= LONG_MAX);
+        if ( !isValidLayout )
+        {
+            return CRYPT_ERROR_INVALIDHEADER;
+        }
+
+        lpFileInfos->isChunked = TRUE;
+        lpFileInfos->sDestFileInfo.chunkInfo = chunkInfo;
+    }
+
     // Set the header
     lpFileInfos->sDestFileInfo.destFileHeader = cryptHeader;
     lpFileInfos->sDestFileInfo.dwFlagsAndAttributes = cryptHeader.dwFlagsAndAttributes;
 
-    return CRYPT_ERROR_SUCCEED;
+    return ComputeHeaderDigest(lpFileInfos);
 }
 
 //////////////////////////////////////////////////////////////////////////
@@ -498,7 +812,8 @@ CRYPT_RESULT SdkCryptFile::ReadCryptHeader(OUT LPFILEINFOS lpFileInfos)
 CRYPT_RESULT SdkCryptFile::CheckCryptHeader(IN const CRYPTHEADER& cryptHeader)
 {
     // Invalid identity.
-    if (ENCRYPTED_FILE_IDENTIFIER != cryptHeader.dwIdentity)
+    if ( (ENCRYPTED_FILE_IDENTIFIER != cryptHeader.dwIdentity) &&
+         (ENCRYPTED_FILE_IDENTIFIER_CHUNKED != cryptHeader.dwIdentity) )
     {
         return CRYPT_ERROR_INVALIDFILE;
     }
@@ -552,12 +867,24 @@ CRYPT_RESULT SdkCryptFile::WriteCryptHeader(IN LPFILEINFOS lpDestFileInfos)
         lpDestFileInfos->sDestFileInfo.destFileHeader.nDataLength = lpDestFileInfos->nFileSize;
         cryptHeader = lpDestFileInfos->sDestFileInfo.destFileHeader;
 
+        if (CRYPT_ERROR_SUCCEED != ComputeHeaderDigest(lpDestFileInfos))
+        {
+            return CRYPT_ERROR_ENCRYPT;
+        }
+
+        // The chunk information is appended to the header for chunked files.
+        DWORD dwMapSize = dwHeaderSize;
+        if (lpDestFileInfos->isChunked)
+        {
+            dwMapSize += CHUNKINFO_SIZE;
+        }
+
         PBYTE pDestMapBuffer = (PBYTE)MapViewOfFile(
             lpDestFileInfos->sDestFileInfo.hDestMapFile,
             FILE_MAP_READ | FILE_MAP_WRITE,
             0,
             0,
-            dwHeaderSize);
+            dwMapSize);
 
         if (NULL == pDestMapBuffer)
         {
@@ -567,8 +894,17 @@ CRYPT_RESULT SdkCryptFile::WriteCryptHeader(IN LPFILEINFOS lpDestFileInfos)
         // Copy the header memory to buffer.
         memcpy_s(pDestMapBuffer, dwHeaderSize, &cryptHeader, dwHeaderSize);
 
+        if (lpDestFileInfos->isChunked)
+        {
+            memcpy_s(
+                pDestMapBuffer + dwHeaderSize,
+                CHUNKINFO_SIZE,
+                &lpDestFileInfos->sDestFileInfo.chunkInfo,
+                sizeof(CRYPTCHUNKINFO));
+        }
+
         // Encrypt the data buffer
-        CRYPT_RESULT nResult = m_pCrypt->EncryptStream(pDestMapBuffer, dwHeaderSize, FALSE);
+        CRYPT_RESULT nResult = m_pCrypt->EncryptStream(pDestMapBuffer, dwMapSize, FALSE);
         // Fail to encrypt data buffer.
         if (CRYPT_ERROR_SUCCEED != nResult)
         {
@@ -624,72 +960,408 @@ CRYPT_RESULT SdkCryptFile::WriteCryptHeader(IN LPFILEINFOS lpDestFileInfos)
 
 //////////////////////////////////////////////////////////////////////////
 
-CRYPT_RESULT SdkCryptFile::EncryptFile(IN LPFILEINFOS lpFileInfos)
+CRYPT_RESULT SdkCryptFile::ComputeHeaderDigest(IN OUT LPFILEINFOS lpFileInfos)
 {
-    CRYPT_RESULT nResult = CRYPT_ERROR_SUCCEED;
-
-    if (CRYPT_ERROR_SUCCEED != (nResult = OpenFile(lpFileInfos)))
+    LPDESTFILEINFO lpDestFileInfo = &lpFileInfos->sDestFileInfo;
+    if ( !lpFileInfos->isChunked || (CRYPT_CHUNK_VERSION_GCM != lpDestFileInfo->chunkInfo.dwVersion) )
     {
-        return nResult;
+        return CRYPT_ERROR_SUCCEED;
     }
 
-    // Get the path of destination files.
-    GetDestFilePath(lpFileInfos, TRUE);
+    // The header is serialized as it is written. The nonce is left out, it is authenticated
+    // by the IV of every chunk.
+    BYTE cbHeader[HEADER_SIZE + CHUNKINFO_SIZE] = { 0 };
+    CRYPTCHUNKINFO chunkInfo = lpDestFileInfo->chunkInfo;
+    ZeroMemory(chunkInfo.cbNonce, sizeof(chunkInfo.cbNonce));
+    memcpy_s(cbHeader, HEADER_SIZE, &lpDestFileInfo->destFileHeader, HEADER_SIZE);
+    memcpy_s(cbHeader + HEADER_SIZE, CHUNKINFO_SIZE, &chunkInfo, CHUNKINFO_SIZE);
 
-    // Create the files.
-    if (CRYPT_ERROR_SUCCEED != (nResult = CreateFile(lpFileInfos)))
-    {
-        return nResult;
-    }
+    CRYPT_RESULT nResult = m_pCrypt->ComputeDigest(cbHeader, sizeof(cbHeader), lpDestFileInfo->cbHeaderDigest);
 
-    if ( !lpFileInfos->isSuccess || !lpFileInfos->sDestFileInfo.isSuccess )
-    {
-        DeleteFiles(lpFileInfos, FALSE);
-        return CRYPT_ERROR_ENCRYPT;
-    }
+    // The header holds the password.
+    SecureZeroMemory(cbHeader, sizeof(cbHeader));
 
-    // initialize the crypt header
-    if ( CRYPT_ERROR_SUCCEED != (nResult = InitCryptHeader(lpFileInfos)) )
-    {
-        return nResult;
-    }
+    return nResult;
+}
 
-    // write the crypt header to the destination file
-    if ( CRYPT_ERROR_SUCCEED != (nResult = WriteCryptHeader(lpFileInfos)) )
-    {
-        DeleteFiles(lpFileInfos, FALSE);
-        return nResult;
-    }
+//////////////////////////////////////////////////////////////////////////
 
-    nResult = lpFileInfos->isBigFile ? EncryptBigFile(lpFileInfos) : EncryptSmallFile(lpFileInfos);
+void SdkCryptFile::CryptFileByIndex(IN UINT32 nIndex, IN CRYPT_OP_TYPE operationType)
+{
+    CRYPT_RESULT nResult = CRYPT_ERROR_SUCCEED;
 
-    if ( CRYPT_ERROR_SUCCEED != nResult )
+    LPFILEINFOS lpFileInfo = m_vFileInfoList[nIndex];
+    OnCryptNext(nIndex, lpFileInfo->szFilePath);
+
+    // Do encrypt or decrypt operation.
+    if (CRYPT_OP_ENCRYPT == operationType)
     {
-        DeleteFiles(lpFileInfos, FALSE);
-        return nResult;
+        nResult = EncryptFile(lpFileInfo);
     }
-
-    // Delete the original file
-    if ( this->m_bDelOriginalFiles )
+    else
     {
-        DeleteFiles(lpFileInfos);
+        nResult = DecryptFile(lpFileInfo);
     }
 
-    return CRYPT_ERROR_SUCCEED;
+    CloseHandles(lpFileInfo);
+
+    // Show the error.
+    if ( (CRYPT_ERROR_SUCCEED != nResult) && (CRYPT_ERROR_CANCEL != nResult) )
+    {
+        // Show the error message.
+        CryptString strErrorMsg(FormatErrorMessage(nResult, lpFileInfo->szFilePath));
+        OnCryptError(strErrorMsg.c_str());
+    }
 }
 
 //////////////////////////////////////////////////////////////////////////
 
-CRYPT_RESULT SdkCryptFile::EncryptBigFile(IN LPFILEINFOS lpFileInfos)
+void SdkCryptFile::CryptBatchFiles(IN CRYPT_OP_TYPE operationType)
 {
-    if ( NULL == lpFileInfos )
-    {
-        return CRYPT_ERROR_FAIL;
+    CRYPTBATCHTASK task;
+    task.operationType = operationType;
+    task.pFileInfoList = &m_vFileInfoList;
+    task.lNextFile     = 0;
+    task.lCancelled    = FALSE;
+    task.lRunningWorkers = 0;
+
+    // A big file in the chunked container is split across the processors after the workers
+    // finish. A big file in the stream format is one cipher chain which can not be split, so
+    // it goes to the workers with the small files, several of them are crypted at once. The
+    // header of an encrypted file is encrypted too, so the settings tell whether the big files
+    // are chunked when they are decrypted.
+    BOOL isChunkedBigFile = (m_isParallelCrypt || m_isAuthenticatedCrypt);
+
+    // The size is only used to schedule the files, the worker checks it again when the file is opened.
+    vector<UINT32> vctBigFiles;
+    vector< pair<UINT64, UINT32> > vctStreamFiles;
+    vector<UINT32> vctSmallFiles;
+    UINT32 nSize = (UINT32)m_vFileInfoList.size();
+    for (UINT32 i = 0; i < nSize; ++i)
+    {
+        WIN32_FILE_ATTRIBUTE_DATA fileData = { 0 };
+        GetFileAttributesEx(m_vFileInfoList[i]->szFilePath, GetFileExInfoStandard, &fileData);
+
+        UINT64 nFileSize = ((UINT64)fileData.nFileSizeHigh << 32) | fileData.nFileSizeLow;
+        if (nFileSize < CRITICAL_VALUE)
+        {
+            vctSmallFiles.push_back(i);
+        }
+        else if (isChunkedBigFile)
+        {
+            vctBigFiles.push_back(i);
+        }
+        else
+        {
+            vctStreamFiles.push_back(make_pair(nFileSize, i));
+        }
     }
 
-    if ( (NULL == lpFileInfos->hMapFile) || (NULL == lpFileInfos->sDestFileInfo.hDestMapFile) )
+    // The biggest files are picked first, so the last file a worker takes is a small one and
+    // the workers finish at about the same time.
+    sort(vctStreamFiles.begin(), vctStreamFiles.end(), BatchFileSizeGreater);
+    for each (const pair<UINT64, UINT32>& streamFile in vctStreamFiles)
     {
-        return CRYPT_ERROR_INVALID_HANDLE;
+        task.vctFileIndices.push_back(streamFile.second);
+    }
+    task.vctFileIndices.insert(task.vctFileIndices.end(), vctSmallFiles.begin(), vctSmallFiles.end());
+
+    task.lFileCount = (LONG)task.vctFileIndices.size();
+    task.vctResults.resize(task.lFileCount, CRYPT_ERROR_SUCCEED);
+    task.vctFinished.resize(task.lFileCount, FALSE);
+
+    // The workers are bounded by the processor count and the I/O depth.
+    UINT32 nThreadCount = m_nBatchThreads;
+    if (0 == nThreadCount)
+    {
+        SYSTEM_INFO sinf;
+        GetSystemInfo(&sinf);
+        nThreadCount = MIN(sinf.dwNumberOfProcessors, MAX_CRYPT_THREADS);
+    }
+    nThreadCount = MIN(nThreadCount, (0 == m_nBatchIoDepth) ? DEFAULT_BATCH_IO_DEPTH : m_nBatchIoDepth);
+    nThreadCount = (UINT32)MIN((LONG)nThreadCount, task.lFileCount);
+
+    m_hBatchMutex   = CreateMutex(NULL, FALSE, NULL);
+    m_hBatchInquiry = CreateEvent(NULL, FALSE, FALSE, NULL);
+
+    vector<HANDLE> vctThreads;
+    vector<LPCRYPTBATCHWORKER> vctWorkers;
+
+    for (UINT32 i = 0; (i < nThreadCount) && (NULL != m_hBatchMutex) && (NULL != m_hBatchInquiry); ++i)
+    {
+        SdkCryptFile *pWorker = NULL;
+        if (CRYPT_ERROR_SUCCEED != CreateBatchWorker(&pWorker))
+        {
+            break;
+        }
+
+        LPCRYPTBATCHWORKER lpWorker = new CRYPTBATCHWORKER();
+        lpWorker->lpTask     = &task;
+        lpWorker->pCryptFile = pWorker;
+        vctWorkers.push_back(lpWorker);
+
+        InterlockedIncrement(&task.lRunningWorkers);
+        unsigned int nThreadId = 0;
+        HANDLE hThread = chBEGINTHREADEX(
+            NULL,
+            0,
+            SdkCryptFile::BatchThreadProc,
+            lpWorker,
+            0,
+            &nThreadId);
+
+        if (NULL == hThread)
+        {
+            InterlockedDecrement(&task.lRunningWorkers);
+            break;
+        }
+
+        vctThreads.push_back(hThread);
+    }
+
+    // The files of the workers are reported in the order they are picked on this thread, the
+    // workers only update the percent.
+    // A worker wakes up this thread when it asks the sink or exits, the inquiries are answered
+    // here so that the sink is always called on this thread.
+    LONG lReportedNext = 0;
+    LONG lReportedDone = 0;
+    DWORD dwThreadCount = (DWORD)vctThreads.size();
+    BOOL isRunning = (dwThreadCount > 0);
+    while (isRunning)
+    {
+        WaitForSingleObject(m_hBatchInquiry, CHUNK_WAIT_INTERVAL);
+        isRunning = (task.lRunningWorkers > 0);
+
+        AnswerBatchInquiries();
+
+        LONG lStarted = MIN(task.lNextFile, task.lFileCount);
+        for (; lReportedNext < lStarted; ++lReportedNext)
+        {
+            UINT32 nIndex = task.vctFileIndices[lReportedNext];
+            OnCryptNext(nIndex, m_vFileInfoList[nIndex]->szFilePath);
+        }
+
+        for (; (lReportedDone < lReportedNext) && task.vctFinished[lReportedDone]; ++lReportedDone)
+        {
+            CRYPT_RESULT nResult = (CRYPT_RESULT)task.vctResults[lReportedDone];
+            if ( (CRYPT_ERROR_SUCCEED != nResult) && (CRYPT_ERROR_CANCEL != nResult) )
+            {
+                UINT32 nIndex = task.vctFileIndices[lReportedDone];
+                CryptString strErrorMsg(FormatErrorMessage(nResult, m_vFileInfoList[nIndex]->szFilePath));
+                OnCryptError(strErrorMsg.c_str());
+            }
+        }
+
+        SetPercent();
+
+        if ( HasCancelled() )
+        {
+            InterlockedExchange(&task.lCancelled, TRUE);
+            for each (LPCRYPTBATCHWORKER lpWorker in vctWorkers)
+            {
+                lpWorker->pCryptFile->CancelCrypt();
+            }
+        }
+    }
+
+    if (dwThreadCount > 0)
+    {
+        WaitForMultipleObjects(dwThreadCount, &vctThreads[0], TRUE, INFINITE);
+    }
+
+    for each (HANDLE hThread in vctThreads)
+    {
+        SAFE_CLOSE_HANDLE(hThread);
+    }
+
+    for each (LPCRYPTBATCHWORKER lpWorker in vctWorkers)
+    {
+        SAFE_DELETE(lpWorker->pCryptFile);
+        SAFE_DELETE(lpWorker);
+    }
+
+    SAFE_CLOSE_HANDLE(m_hBatchMutex);
+    SAFE_CLOSE_HANDLE(m_hBatchInquiry);
+
+    // The files which are not picked by any worker, it happens only if no worker starts.
+    for (LONG i = MIN(task.lNextFile, task.lFileCount); i < task.lFileCount; ++i)
+    {
+        if ( HasCancelled() )
+        {
+            return;
+        }
+
+        CryptFileByIndex(task.vctFileIndices[i], operationType);
+    }
+
+    // The chunks of each big file are crypted by all processors, see CryptChunkedFile.
+    for each (UINT32 nIndex in vctBigFiles)
+    {
+        if ( HasCancelled() )
+        {
+            return;
+        }
+
+        CryptFileByIndex(nIndex, operationType);
+    }
+}
+
+//////////////////////////////////////////////////////////////////////////
+
+void SdkCryptFile::AnswerBatchInquiries()
+{
+    vector<LPCRYPTBATCHINQUIRY> vctInquiries;
+
+    WaitForSingleObject(m_hBatchMutex, INFINITE);
+    vctInquiries.swap(m_vctBatchInquiries);
+    ReleaseMutex(m_hBatchMutex);
+
+    for each (LPCRYPTBATCHINQUIRY lpInquiry in vctInquiries)
+    {
+        OnReplaceFiles(&lpInquiry->nResult, lpInquiry->lpFileName);
+        SetEvent(lpInquiry->hAnswered);
+    }
+}
+
+//////////////////////////////////////////////////////////////////////////
+
+CRYPT_RESULT SdkCryptFile::CreateBatchWorker(OUT SdkCryptFile **ppWorker)
+{
+    if ( (NULL == ppWorker) || (NULL == m_pCrypt) )
+    {
+        return CRYPT_ERROR_INVALIDPARAM;
+    }
+
+    // The worker has no sink and no progress dialog, the owner reports for it.
+    SdkCryptFile *pWorker = new SdkCryptFile(FALSE);
+    pWorker->m_bDelOriginalFiles    = m_bDelOriginalFiles;
+    pWorker->m_isParallelCrypt      = m_isParallelCrypt;
+    pWorker->m_nCryptThreads        = m_nCryptThreads;
+    pWorker->m_isAuthenticatedCrypt = m_isAuthenticatedCrypt;
+    pWorker->m_isInPlaceCrypt       = m_isInPlaceCrypt;
+    pWorker->m_isAsyncIO            = m_isAsyncIO;
+    pWorker->m_isBatchCrypt         = m_isBatchCrypt;
+    pWorker->m_strPassword          = m_strPassword;
+    pWorker->m_strCryptKeyPath      = m_strCryptKeyPath;
+    pWorker->m_pBatchOwner          = this;
+
+    // Every worker owns a key handle, the chain state can not be shared.
+    CRYPT_RESULT nResult = m_pCrypt->DuplicateScene(&pWorker->m_pCrypt);
+    if (CRYPT_ERROR_SUCCEED != nResult)
+    {
+        SAFE_DELETE(pWorker);
+        return nResult;
+    }
+
+    *ppWorker = pWorker;
+
+    return CRYPT_ERROR_SUCCEED;
+}
+
+//////////////////////////////////////////////////////////////////////////
+
+CRYPT_RESULT SdkCryptFile::EncryptFile(IN LPFILEINFOS lpFileInfos)
+{
+    CRYPT_RESULT nResult = CRYPT_ERROR_SUCCEED;
+
+    if (CRYPT_ERROR_SUCCEED != (nResult = OpenFile(lpFileInfos)))
+    {
+        return nResult;
+    }
+
+    // Restart the cipher chain, the last file may leave it in the middle of a stream.
+    if (CRYPT_ERROR_SUCCEED != m_pCrypt->SetStreamIV(NULL))
+    {
+        return CRYPT_ERROR_ENCRYPT;
+    }
+
+    // Big files are split into chunks which are encrypted on the workers, the
+    // authenticated mode always uses chunks so that every chunk has its own tag.
+    lpFileInfos->isChunked = ( (m_isParallelCrypt || m_isAuthenticatedCrypt) && lpFileInfos->isBigFile );
+
+    // A file which is interrupted in the in-place mode must be resumed whatever the mode is now,
+    // a journal which does not match the file fails it. Otherwise the big file is encrypted in
+    // place only when the original file is deleted.
+    nResult = CheckCryptJournal(lpFileInfos);
+    if ( (CRYPT_ERROR_SUCCEED != nResult) && (CRYPT_ERROR_FILE_NOT_FOUND != nResult) )
+    {
+        return nResult;
+    }
+
+    BOOL isResume  = (CRYPT_ERROR_SUCCEED == nResult);
+    BOOL isInPlace = m_isInPlaceCrypt && m_bDelOriginalFiles && lpFileInfos->isBigFile && !lpFileInfos->isChunked;
+    if ( isInPlace || isResume )
+    {
+        CloseHandles(lpFileInfos);
+        lpFileInfos->isChunked = FALSE;
+
+        return EncryptFileInPlace(lpFileInfos, isResume);
+    }
+
+    // Get the path of destination files.
+    GetDestFilePath(lpFileInfos, TRUE);
+
+    // Create the files.
+    if (CRYPT_ERROR_SUCCEED != (nResult = CreateFile(lpFileInfos)))
+    {
+        return nResult;
+    }
+
+    if ( !lpFileInfos->isSuccess || !lpFileInfos->sDestFileInfo.isSuccess )
+    {
+        DeleteFiles(lpFileInfos, FALSE);
+        return CRYPT_ERROR_ENCRYPT;
+    }
+
+    // initialize the crypt header
+    if ( CRYPT_ERROR_SUCCEED != (nResult = InitCryptHeader(lpFileInfos)) )
+    {
+        return nResult;
+    }
+
+    // write the crypt header to the destination file
+    if ( CRYPT_ERROR_SUCCEED != (nResult = WriteCryptHeader(lpFileInfos)) )
+    {
+        DeleteFiles(lpFileInfos, FALSE);
+        return nResult;
+    }
+
+    if (lpFileInfos->isChunked)
+    {
+        nResult = CryptChunkedFile(lpFileInfos, TRUE);
+    }
+    else
+    {
+        nResult = lpFileInfos->isBigFile ? EncryptBigFile(lpFileInfos) : EncryptSmallFile(lpFileInfos);
+    }
+
+    if ( CRYPT_ERROR_SUCCEED != nResult )
+    {
+        DeleteFiles(lpFileInfos, FALSE);
+        return nResult;
+    }
+
+    // Delete the original file
+    if ( this->m_bDelOriginalFiles )
+    {
+        DeleteFiles(lpFileInfos);
+    }
+
+    return CRYPT_ERROR_SUCCEED;
+}
+
+//////////////////////////////////////////////////////////////////////////
+
+CRYPT_RESULT SdkCryptFile::EncryptBigFile(IN LPFILEINFOS lpFileInfos)
+{
+    if ( NULL == lpFileInfos )
+    {
+        return CRYPT_ERROR_FAIL;
+    }
+
+    if ( (NULL == lpFileInfos->hMapFile) || (NULL == lpFileInfos->sDestFileInfo.hDestMapFile) )
+    {
+        return CRYPT_ERROR_INVALID_HANDLE;
     }
 
     DWORD dwBlockSize = MAX_WRITE_RATE * m_dwAllocationGranularity;
@@ -845,6 +1517,15 @@ CRYPT_RESULT SdkCryptFile::EncryptSmallFile(IN LPFILEINFOS lpFileInfos)
         return CRYPT_ERROR_SUCCEED;
     }
 
+    if ( m_isAsyncIO )
+    {
+        CRYPT_RESULT nResult = CryptSmallFileAsync(lpFileInfos, TRUE);
+        if ( CRYPT_ERROR_OTHER != nResult )
+        {
+            return nResult;
+        }
+    }
+
     while ( dwLeftSize > 0 )
     {
         ZeroMemory(m_SmallFileBlock.pbBlob, m_SmallFileBlock.dwBlobSize);
@@ -917,324 +1598,1419 @@ CRYPT_RESULT SdkCryptFile::EncryptSmallFile(IN LPFILEINFOS lpFileInfos)
 
 //////////////////////////////////////////////////////////////////////////
 
-CRYPT_RESULT SdkCryptFile::DecryptFile(IN LPFILEINFOS lpFileInfos)
+CRYPT_RESULT SdkCryptFile::CheckCryptJournal(IN LPFILEINFOS lpFileInfos)
 {
-    CRYPT_RESULT nResult = CRYPT_ERROR_SUCCEED;
+    CryptString strJournalPath = CryptString(lpFileInfos->szFilePath) + INPLACE_JOURNAL_EXTENDNAME;
+    HANDLE hJournal = ::CreateFile(
+        strJournalPath.c_str(),
+        GENERIC_READ,
+        FILE_SHARE_READ,
+        NULL,
+        OPEN_EXISTING,
+        FILE_ATTRIBUTE_NORMAL,
+        NULL);
 
-    if ( CRYPT_ERROR_SUCCEED != (nResult = OpenFile(lpFileInfos)) )
+    if ( !ISVALIDHANDLE(hJournal) )
     {
-        return nResult;
+        return ::PathFileExists(strJournalPath.c_str()) ? CRYPT_ERROR_INVALIDFILE : CRYPT_ERROR_FILE_NOT_FOUND;
     }
 
-    // Get crypt header from encrypted file.
-    if ( CRYPT_ERROR_SUCCEED != (nResult = ReadCryptHeader(lpFileInfos)) )
+    DWORD dwWindowSize = INPLACE_WINDOW_RATE * m_dwAllocationGranularity;
+    DWORD dwDataSize   = dwWindowSize + m_dwAllocationGranularity;
+    PBYTE pbData       = new BYTE[dwDataSize];
+
+    CRYPTJOURNAL journal = { 0 };
+    BOOL isOtherFile = FALSE;
+    BOOL isMatched = ReadCryptJournal(hJournal, dwDataSize, &journal, pbData) &&
+                     (dwWindowSize == journal.dwWindowSize) &&
+                     VerifyCryptJournal(lpFileInfos->hFile, &journal, &isOtherFile);
+
+    SecureZeroMemory(pbData, dwDataSize);
+    SAFE_DELETE_ARRAY(pbData);
+    SAFE_CLOSE_HANDLE(hJournal);
+
+    // The digest is read through the handle of the file, the file is read from the start again.
+    LARGE_INTEGER liDistanceToMove;
+    liDistanceToMove.QuadPart = 0;
+    if ( !SetFilePointerEx(lpFileInfos->hFile, liDistanceToMove, NULL, FILE_BEGIN) )
     {
-        return nResult;
+        return CRYPT_ERROR_READDATA;
     }
 
-    // Check the header valid or invalid.
-    nResult = CheckCryptHeader(lpFileInfos->sDestFileInfo.destFileHeader);
-    if ( CRYPT_ERROR_SUCCEED != nResult )
+    if ( isMatched )
     {
-        return nResult;
+        return CRYPT_ERROR_SUCCEED;
     }
 
-    // Get the destination file full path.
-    GetDestFilePath(lpFileInfos, FALSE);
+    return isOtherFile ? CRYPT_ERROR_FILE_NOT_FOUND : CRYPT_ERROR_INVALIDFILE;
+}
 
-    if ( CRYPT_ERROR_SUCCEED != (nResult = CreateFile(lpFileInfos, FALSE)) )
-    {
-        return nResult;
-    }
+//////////////////////////////////////////////////////////////////////////
 
-    if ( !lpFileInfos->isSuccess || !lpFileInfos->sDestFileInfo.isSuccess )
+CRYPT_RESULT SdkCryptFile::EncryptFileInPlace(IN LPFILEINFOS lpFileInfos, IN BOOL isResume)
+{
+    if ( NULL == lpFileInfos )
     {
-        if ( HasCancelled() || !lpFileInfos->isReplaced )
-        {
-            return CRYPT_ERROR_CANCEL;
-        }
-
-        DeleteFiles(lpFileInfos, FALSE);
         return CRYPT_ERROR_FAIL;
     }
 
-    nResult = lpFileInfos->isBigFile ? DecryptBigFile(lpFileInfos) : DecryptSmallFile(lpFileInfos);;
-    if ( CRYPT_ERROR_SUCCEED != nResult )
+    // Ask the user before the file is changed.
+    GetDestFilePath(lpFileInfos, TRUE);
+    if ( !ReplaceDestFile(lpFileInfos, TRUE) )
     {
-        DeleteFiles(lpFileInfos, FALSE);
-        return nResult;
+        return CRYPT_ERROR_CANCEL;
     }
 
-    // Delete the original file.
-    if ( this->m_bDelOriginalFiles )
+    HANDLE hFile = ::CreateFile(
+        lpFileInfos->szFilePath,
+        GENERIC_READ | GENERIC_WRITE,
+        0,
+        NULL,
+        OPEN_EXISTING,
+        FILE_ATTRIBUTE_NORMAL,
+        NULL);
+
+    if ( !ISVALIDHANDLE(hFile) )
     {
-        DeleteFiles(lpFileInfos);
+        return (CRYPT_RESULT)GetLastError();
     }
 
-    return CRYPT_ERROR_SUCCEED;
-}
+    lpFileInfos->hFile = hFile;
 
-//////////////////////////////////////////////////////////////////////////
+    CryptString strJournalPath = CryptString(lpFileInfos->szFilePath) + INPLACE_JOURNAL_EXTENDNAME;
+    HANDLE hJournal = ::CreateFile(
+        strJournalPath.c_str(),
+        GENERIC_READ | GENERIC_WRITE,
+        0,
+        NULL,
+        OPEN_ALWAYS,
+        FILE_ATTRIBUTE_HIDDEN | FILE_FLAG_WRITE_THROUGH,
+        NULL);
 
-CRYPT_RESULT SdkCryptFile::DecryptBigFile(IN LPFILEINFOS lpFileInfos)
-{
-    if ( (NULL == lpFileInfos) ||
-         (!ISVALIDHANDLE(lpFileInfos->hMapFile)) ||
-         (!ISVALIDHANDLE(lpFileInfos->sDestFileInfo.hDestMapFile)) )
+    if ( !ISVALIDHANDLE(hJournal) )
     {
-        return CRYPT_ERROR_INVALID_HANDLE;
+        CloseHandles(lpFileInfos);
+        return (CRYPT_RESULT)GetLastError();
     }
 
-    // get the system allocation granularity, this value is 64KB(64 * 1024 = 65536)
-    DWORD dwBlockSize = MAX_WRITE_RATE * m_dwAllocationGranularity;
+    // The encrypted data is one allocation granularity behind the plain data, so every window
+    // overwrites the tail of itself and the head of the next window. The journal saves both of
+    // them before the window is written, the head of the next window is also the carry.
+    // The window is flushed once before the next journal record, a big window needs fewer
+    // flushes but a bigger buffer, and more data is encrypted again after an interruption.
+    DWORD dwWindowSize = INPLACE_WINDOW_RATE * m_dwAllocationGranularity;
+    DWORD dwDataSize   = dwWindowSize + m_dwAllocationGranularity;
+    PBYTE pbData       = new BYTE[dwDataSize];
 
-    UINT64 nDestFileOffset  = 0;
-    UINT64 nSrcFileOffset = lpFileInfos->sDestFileInfo.destFileHeader.nDataBegin;
-    UINT64 nSrcFileLength = lpFileInfos->sDestFileInfo.destFileHeader.nDataLength;
-    UINT64 nFileLeftSize  = nSrcFileLength;         // the left bytes which not to be map
+    CRYPTJOURNAL journal = { 0 };
+    CRYPT_RESULT nResult = CRYPT_ERROR_SUCCEED;
+    if ( isResume )
+    {
+        // The journal is read again with the file opened for writing, nothing is changed if
+        // it does not match any more.
+        BOOL isMatched = ReadCryptJournal(hJournal, dwDataSize, &journal, pbData) &&
+                         (dwWindowSize == journal.dwWindowSize) &&
+                         VerifyCryptJournal(hFile, &journal);
+
+        if ( !isMatched )
+        {
+            SecureZeroMemory(pbData, dwDataSize);
+            SAFE_DELETE_ARRAY(pbData);
+            SAFE_CLOSE_HANDLE(hJournal);
+            CloseHandles(lpFileInfos);
+            return CRYPT_ERROR_INVALIDFILE;
+        }
+
+        lpFileInfos->nFileSize = journal.nFileSize;
+    }
+    else
+    {
+        // A journal of another file is discarded, the older slot must not be read again.
+        LARGE_INTEGER liDistanceToMove;
+        liDistanceToMove.QuadPart = 0;
+        BY_HANDLE_FILE_INFORMATION fileInfo = { 0 };
+        ZeroMemory(&journal, sizeof(journal));
+
+        BOOL isSucceed = SetFilePointerEx(hJournal, liDistanceToMove, NULL, FILE_BEGIN) &&
+                         SetEndOfFile(hJournal) &&
+                         GetFileInformationByHandle(hFile, &fileInfo);
+
+        // Nothing is changed without a valid journal, save the first window. The digest covers
+        // the plain data after the first window, which is not written until the next window.
+        DWORD dwBytesRead = 0;
+        journal.dwIdentity     = INPLACE_JOURNAL_IDENTIFIER;
+        journal.nFileSize      = lpFileInfos->nFileSize;
+        journal.nFileIndex     = ((UINT64)fileInfo.nFileIndexHigh << 32) | fileInfo.nFileIndexLow;
+        journal.dwVolumeSerial = fileInfo.dwVolumeSerialNumber;
+        journal.dwWindowSize   = dwWindowSize;
+        journal.dwDataSize     = (DWORD)MIN((UINT64)dwDataSize, lpFileInfos->nFileSize);
+        journal.dwCheckSize    = (DWORD)MIN((UINT64)m_dwAllocationGranularity, lpFileInfos->nFileSize - journal.dwDataSize);
+
+        isSucceed = isSucceed &&
+                    SetFilePointerEx(hFile, liDistanceToMove, NULL, FILE_BEGIN) &&
+                    ReadFile(hFile, pbData, journal.dwDataSize, &dwBytesRead, NULL) &&
+                    (dwBytesRead == journal.dwDataSize) &&
+                    GetFileRegionDigest(hFile, dwDataSize, journal.dwCheckSize, journal.cbCheckDigest) &&
+                    WriteCryptJournal(hJournal, dwDataSize, &journal, pbData);
+
+        nResult = isSucceed ? CRYPT_ERROR_SUCCEED : CRYPT_ERROR_WRITEDATA;
+    }
+
+    UINT64 nFileSize       = lpFileInfos->nFileSize;
+    UINT64 nWindowIndex    = journal.nWindowIndex;
+    UINT64 nCipherFileSize = GetCipherFileSize(nFileSize, m_dwAllocationGranularity);
+
+    // Extend the file to the encrypted size and map it.
+    if ( CRYPT_ERROR_SUCCEED == nResult )
+    {
+        LARGE_INTEGER liDistanceToMove;
+        liDistanceToMove.QuadPart = nCipherFileSize;
+
+        BOOL isSucceed = SetFilePointerEx(hFile, liDistanceToMove, NULL, FILE_BEGIN) && SetEndOfFile(hFile);
+        if ( isSucceed )
+        {
+            lpFileInfos->hMapFile = CreateFileMapping(
+                hFile,
+                NULL,
+                PAGE_READWRITE,
+                (DWORD)(nCipherFileSize >> 32),
+                (DWORD)(nCipherFileSize & 0xFFFFFFFF),
+                NULL);
+        }
+
+        nResult = (NULL != lpFileInfos->hMapFile) ? CRYPT_ERROR_SUCCEED : CRYPT_ERROR_WRITEDATA;
+    }
+
+    // The header is written after the first window is saved, it starts the cipher chain.
+    if ( (CRYPT_ERROR_SUCCEED == nResult) && (0 == nWindowIndex) )
+    {
+        lpFileInfos->sDestFileInfo.hDestMapFile = lpFileInfos->hMapFile;
+
+        nResult = InitCryptHeader(lpFileInfos);
+        if ( CRYPT_ERROR_SUCCEED == nResult )
+        {
+            nResult = WriteCryptHeader(lpFileInfos);
+        }
+
+        lpFileInfos->sDestFileInfo.hDestMapFile = NULL;
+
+        // Wipe the plain data between the header and the encrypted data.
+        PBYTE pHeaderMapBuffer = (CRYPT_ERROR_SUCCEED == nResult) ?
+            (PBYTE)MapViewOfFile(lpFileInfos->hMapFile, FILE_MAP_WRITE, 0, 0, m_dwAllocationGranularity) : NULL;
+        if ( NULL != pHeaderMapBuffer )
+        {
+            DWORD dwHeaderSize = HEADER_SIZE;
+            DWORD dwMod = dwHeaderSize % ENCRYPT_BLOCK_SIZE;
+            if ( 0 != dwMod )
+            {
+                dwHeaderSize += ENCRYPT_BLOCK_SIZE - dwMod;
+            }
+
+            ZeroMemory(pHeaderMapBuffer + dwHeaderSize, m_dwAllocationGranularity - dwHeaderSize);
+            UnmapViewOfFile(pHeaderMapBuffer);
+        }
+    }
+    else if ( CRYPT_ERROR_SUCCEED == nResult )
+    {
+        nResult = (CRYPT_ERROR_SUCCEED == m_pCrypt->SetStreamIV(journal.cbChainIV)) ? CRYPT_ERROR_SUCCEED : CRYPT_ERROR_ENCRYPT;
+    }
+
+    BOOL isSaved = TRUE;
+    while ( CRYPT_ERROR_SUCCEED == nResult )
+    {
+        UINT64 nWindowOffset = nWindowIndex * dwWindowSize;
+        DWORD  dwBytesToMap  = (DWORD)MIN((UINT64)dwWindowSize, nFileSize - nWindowOffset);
+        DWORD  dwHeadSize    = (DWORD)MIN((UINT64)m_dwAllocationGranularity, nFileSize - nWindowOffset - dwBytesToMap);
+        BOOL   isLastBlock   = (0 == dwHeadSize);
+        DWORD  dwBlockSize   = dwWindowSize;
+
+        if ( isLastBlock )
+        {
+            // The same size as the last block of EncryptBigFile.
+            dwBlockSize = dwBytesToMap;
+            DWORD dwMod = dwBytesToMap % ENCRYPT_BLOCK_SIZE;
+            if ( 0 != dwMod )
+            {
+                dwBlockSize += ENCRYPT_BLOCK_SIZE - dwMod + ENCRYPT_LAST_PART_VERIFYDATA_SIZE;
+            }
+        }
+
+        // The view holds the plain window and the encrypted window.
+        PBYTE pMapBuffer = (PBYTE)MapViewOfFile(
+            lpFileInfos->hMapFile,
+            FILE_MAP_READ | FILE_MAP_WRITE,
+            (DWORD)(nWindowOffset >> 32),
+            (DWORD)(nWindowOffset & 0xFFFFFFFF),
+            m_dwAllocationGranularity + dwBlockSize);
+
+        if ( NULL == pMapBuffer )
+        {
+            nResult = CRYPT_ERROR_INVALID_HANDLE;
+            break;
+        }
+
+        // The data buffer starts with the carry, read the rest of the window and the next head.
+        if ( !isSaved )
+        {
+            if ( dwBytesToMap > m_dwAllocationGranularity )
+            {
+                memcpy_s(pbData + m_dwAllocationGranularity, dwDataSize - m_dwAllocationGranularity,
+                    pMapBuffer + m_dwAllocationGranularity, dwBytesToMap - m_dwAllocationGranularity);
+            }
+            memcpy_s(pbData + dwBytesToMap, dwDataSize - dwBytesToMap, pMapBuffer + dwWindowSize, dwHeadSize);
+
+            journal.nWindowIndex = nWindowIndex;
+            journal.dwDataSize   = dwBytesToMap + dwHeadSize;
+            if ( !WriteCryptJournal(hJournal, dwDataSize, &journal, pbData) )
+            {
+                UnmapViewOfFile(pMapBuffer);
+                nResult = CRYPT_ERROR_WRITEDATA;
+                break;
+            }
+        }
+
+        // Encrypt in the mapped pages of the file.
+        PBYTE pbCipher = pMapBuffer + m_dwAllocationGranularity;
+        memcpy_s(pbCipher, dwBlockSize, pbData, dwBytesToMap);
+        ZeroMemory(pbCipher + dwBytesToMap, dwBlockSize - dwBytesToMap);
+
+        nResult = m_pCrypt->EncryptStream(pbCipher, dwBlockSize, isLastBlock);
+        nResult = (CRYPT_ERROR_SUCCEED == nResult) ? CRYPT_ERROR_SUCCEED : CRYPT_ERROR_ENCRYPT;
+
+        // The window must be on the disk before the journal is overwritten, this is the only
+        // flush of the window and it is paired with the next journal record.
+        memcpy_s(journal.cbChainIV, ENCRYPT_IV_SIZE, pbCipher + dwBlockSize - ENCRYPT_IV_SIZE, ENCRYPT_IV_SIZE);
+        BOOL isFlushed = FlushViewOfFile(pMapBuffer, 0);
+
+        // The first window is not written again, its digest identifies the file from now on.
+        if ( (0 == nWindowIndex) && !isLastBlock && (CRYPT_ERROR_SUCCEED == nResult) )
+        {
+            journal.dwCheckSize = dwDataSize;
+            isFlushed = isFlushed &&
+                        (CRYPT_ERROR_SUCCEED == m_pCrypt->ComputeDigest(pMapBuffer, dwDataSize, journal.cbCheckDigest));
+        }
+
+        UnmapViewOfFile(pMapBuffer);
+
+        if ( (CRYPT_ERROR_SUCCEED == nResult) && (!isFlushed || !FlushFileBuffers(hFile)) )
+        {
+            nResult = CRYPT_ERROR_WRITEDATA;
+        }
+
+        lpFileInfos->fPencent = ((FLOAT)(nWindowOffset + dwBytesToMap) / (FLOAT)nFileSize) * 100;
+        SetPercent();
+
+        if ( isLastBlock || (CRYPT_ERROR_SUCCEED != nResult) )
+        {
+            break;
+        }
+
+        // The head of the next window becomes the carry.
+        memmove(pbData, pbData + dwBytesToMap, dwHeadSize);
+        isSaved = FALSE;
+        ++nWindowIndex;
+    }
+
+    SecureZeroMemory(pbData, dwDataSize);
+    SAFE_DELETE_ARRAY(pbData);
+    CloseHandles(lpFileInfos);
+
+    // The journal is kept on failure, the encryption is resumed next time.
+    if ( CRYPT_ERROR_SUCCEED != nResult )
+    {
+        SAFE_CLOSE_HANDLE(hJournal);
+        return nResult;
+    }
+
+    // Replace the encrypted file, the journal is deleted after the file is renamed.
+    LPCTSTR lpDestFilePath = lpFileInfos->sDestFileInfo.szDestFilePath;
+    if ( ::PathFileExists(lpDestFilePath) )
+    {
+        SetFileAttributes(lpDestFilePath, FILE_ATTRIBUTE_NORMAL);
+    }
+
+    BOOL isMoved = MoveFileEx(lpFileInfos->szFilePath, lpDestFilePath, MOVEFILE_REPLACE_EXISTING | MOVEFILE_WRITE_THROUGH);
+    if ( !isMoved )
+    {
+        nResult = (CRYPT_RESULT)GetLastError();
+        SAFE_CLOSE_HANDLE(hJournal);
+        return nResult;
+    }
+
+    SetFileAttributes(lpDestFilePath, FILE_ATTRIBUTE_READONLY);
+
+    SAFE_CLOSE_HANDLE(hJournal);
+    DeleteFile(strJournalPath.c_str());
+
+    return CRYPT_ERROR_SUCCEED;
+}
+
+//////////////////////////////////////////////////////////////////////////
+
+BOOL SdkCryptFile::ReadCryptJournal(IN HANDLE hJournal, IN DWORD dwDataSize, OUT LPCRYPTJOURNAL lpJournal, OUT PBYTE pbData)
+{
+    DWORD dwSlotSize = sizeof(CRYPTJOURNAL) + dwDataSize;
+    CRYPTJOURNAL slots[2] = { 0 };
+    BOOL isValid[2] = { FALSE, FALSE };
+
+    // Read the record of both slots.
+    for (int i = 0; i < 2; ++i)
+    {
+        LARGE_INTEGER liDistanceToMove;
+        liDistanceToMove.QuadPart = (LONGLONG)i * dwSlotSize;
+
+        DWORD dwBytesRead = 0;
+        isValid[i] = SetFilePointerEx(hJournal, liDistanceToMove, NULL, FILE_BEGIN) &&
+                     ReadFile(hJournal, &slots[i], sizeof(CRYPTJOURNAL), &dwBytesRead, NULL) &&
+                     (sizeof(CRYPTJOURNAL) == dwBytesRead) &&
+                     (INPLACE_JOURNAL_IDENTIFIER == slots[i].dwIdentity) &&
+                     (slots[i].dwDataSize <= dwDataSize);
+    }
+
+    // The newer record is tried first, a torn record fails the checksum.
+    int nFirst = (isValid[1] && (!isValid[0] || (slots[1].nSequence > slots[0].nSequence))) ? 1 : 0;
+    for (int n = 0; n < 2; ++n)
+    {
+        int i = (0 == n) ? nFirst : (1 - nFirst);
+        if ( !isValid[i] )
+        {
+            continue;
+        }
+
+        LARGE_INTEGER liDistanceToMove;
+        liDistanceToMove.QuadPart = (LONGLONG)i * dwSlotSize + sizeof(CRYPTJOURNAL);
+
+        DWORD dwBytesRead = 0;
+        BOOL isSucceed = SetFilePointerEx(hJournal, liDistanceToMove, NULL, FILE_BEGIN) &&
+                         ReadFile(hJournal, pbData, slots[i].dwDataSize, &dwBytesRead, NULL) &&
+                         (slots[i].dwDataSize == dwBytesRead);
+
+        if ( isSucceed && (slots[i].dwChecksum == GetJournalChecksum(slots[i], pbData)) )
+        {
+            *lpJournal = slots[i];
+            return TRUE;
+        }
+    }
+
+    return FALSE;
+}
+
+//////////////////////////////////////////////////////////////////////////
+
+BOOL SdkCryptFile::VerifyCryptJournal(IN HANDLE hFile, IN const CRYPTJOURNAL *lpJournal, OUT BOOL *pIsOtherFile)
+{
+    if ( NULL != pIsOtherFile )
+    {
+        *pIsOtherFile = FALSE;
+    }
+
+    BY_HANDLE_FILE_INFORMATION fileInfo = { 0 };
+    if ( !GetFileInformationByHandle(hFile, &fileInfo) )
+    {
+        return FALSE;
+    }
+
+    UINT64 nFileIndex = ((UINT64)fileInfo.nFileIndexHigh << 32) | fileInfo.nFileIndexLow;
+    UINT64 nFileSize  = ((UINT64)fileInfo.nFileSizeHigh << 32) | fileInfo.nFileSizeLow;
+    UINT64 nCipherFileSize = GetCipherFileSize(lpJournal->nFileSize, m_dwAllocationGranularity);
+
+    // The file is extended before the first window is written.
+    BOOL isSameFile = (nFileIndex == lpJournal->nFileIndex) &&
+                      (fileInfo.dwVolumeSerialNumber == lpJournal->dwVolumeSerial) &&
+                      ( (nFileSize == nCipherFileSize) ||
+                        ((0 == lpJournal->nWindowIndex) && (nFileSize == lpJournal->nFileSize)) );
+
+    if ( !isSameFile )
+    {
+        // A copy of a file which is encrypted in part has another ID, but it is extended.
+        if ( NULL != pIsOtherFile )
+        {
+            *pIsOtherFile = ( (nFileIndex != lpJournal->nFileIndex) || (fileInfo.dwVolumeSerialNumber != lpJournal->dwVolumeSerial) ) &&
+                            (nFileSize != nCipherFileSize);
+        }
+
+        return FALSE;
+    }
+
+    // The first journal checks the plain data after the first window, the later ones check
+    // the encrypted first window.
+    UINT64 nOffset = (0 == lpJournal->nWindowIndex) ? lpJournal->dwWindowSize + m_dwAllocationGranularity : 0;
+    BYTE cbDigest[ENCRYPT_DIGEST_SIZE] = { 0 };
+
+    return GetFileRegionDigest(hFile, nOffset, lpJournal->dwCheckSize, cbDigest) &&
+           (0 == memcmp(cbDigest, lpJournal->cbCheckDigest, ENCRYPT_DIGEST_SIZE));
+}
+
+//////////////////////////////////////////////////////////////////////////
+
+BOOL SdkCryptFile::GetFileRegionDigest(IN HANDLE hFile, IN UINT64 nOffset, IN DWORD dwSize, OUT PBYTE pbDigest)
+{
+    LARGE_INTEGER liDistanceToMove;
+    liDistanceToMove.QuadPart = (LONGLONG)nOffset;
+
+    DWORD dwBytesRead = 0;
+    PBYTE pbBuffer = new BYTE[MAX(dwSize, 1)];
+    BOOL isSucceed = SetFilePointerEx(hFile, liDistanceToMove, NULL, FILE_BEGIN) &&
+                     ReadFile(hFile, pbBuffer, dwSize, &dwBytesRead, NULL) &&
+                     (dwSize == dwBytesRead) &&
+                     (CRYPT_ERROR_SUCCEED == m_pCrypt->ComputeDigest(pbBuffer, dwSize, pbDigest));
+
+    // The region may be plain data.
+    SecureZeroMemory(pbBuffer, dwSize);
+    SAFE_DELETE_ARRAY(pbBuffer);
+
+    return isSucceed;
+}
+
+//////////////////////////////////////////////////////////////////////////
+
+BOOL SdkCryptFile::WriteCryptJournal(IN HANDLE hJournal, IN DWORD dwDataSize, IN OUT LPCRYPTJOURNAL lpJournal, IN const BYTE *pbData)
+{
+    lpJournal->nSequence += 1;
+    lpJournal->dwChecksum = GetJournalChecksum(*lpJournal, pbData);
+
+    LARGE_INTEGER liDistanceToMove;
+    liDistanceToMove.QuadPart = (LONGLONG)(lpJournal->nSequence % 2) * (sizeof(CRYPTJOURNAL) + dwDataSize);
+
+    DWORD dwBytesWritten = 0;
+    BOOL isSucceed = SetFilePointerEx(hJournal, liDistanceToMove, NULL, FILE_BEGIN) &&
+                     WriteFile(hJournal, lpJournal, sizeof(CRYPTJOURNAL), &dwBytesWritten, NULL) &&
+                     (sizeof(CRYPTJOURNAL) == dwBytesWritten) &&
+                     WriteFile(hJournal, pbData, lpJournal->dwDataSize, &dwBytesWritten, NULL) &&
+                     (lpJournal->dwDataSize == dwBytesWritten) &&
+                     FlushFileBuffers(hJournal);
+
+    return isSucceed;
+}
+
+//////////////////////////////////////////////////////////////////////////
+
+CRYPT_RESULT SdkCryptFile::DecryptFile(IN LPFILEINFOS lpFileInfos)
+{
+    CRYPT_RESULT nResult = CRYPT_ERROR_SUCCEED;
+
+    if ( CRYPT_ERROR_SUCCEED != (nResult = OpenFile(lpFileInfos)) )
+    {
+        return nResult;
+    }
+
+    // Restart the cipher chain, the last file may leave it in the middle of a stream.
+    if ( CRYPT_ERROR_SUCCEED != m_pCrypt->SetStreamIV(NULL) )
+    {
+        return CRYPT_ERROR_DECRYPT;
+    }
+
+    // Get crypt header from encrypted file.
+    if ( CRYPT_ERROR_SUCCEED != (nResult = ReadCryptHeader(lpFileInfos)) )
+    {
+        return nResult;
+    }
+
+    // Check the header valid or invalid.
+    nResult = CheckCryptHeader(lpFileInfos->sDestFileInfo.destFileHeader);
+    if ( CRYPT_ERROR_SUCCEED != nResult )
+    {
+        return nResult;
+    }
+
+    // Get the destination file full path.
+    GetDestFilePath(lpFileInfos, FALSE);
+
+    if ( CRYPT_ERROR_SUCCEED != (nResult = CreateFile(lpFileInfos, FALSE)) )
+    {
+        return nResult;
+    }
+
+    if ( !lpFileInfos->isSuccess || !lpFileInfos->sDestFileInfo.isSuccess )
+    {
+        if ( HasCancelled() || !lpFileInfos->isReplaced )
+        {
+            return CRYPT_ERROR_CANCEL;
+        }
+
+        DeleteFiles(lpFileInfos, FALSE);
+        return CRYPT_ERROR_FAIL;
+    }
+
+    if ( lpFileInfos->isChunked )
+    {
+        nResult = CryptChunkedFile(lpFileInfos, FALSE);
+    }
+    else
+    {
+        nResult = lpFileInfos->isBigFile ? DecryptBigFile(lpFileInfos) : DecryptSmallFile(lpFileInfos);
+    }
+    if ( CRYPT_ERROR_SUCCEED != nResult )
+    {
+        DeleteFiles(lpFileInfos, FALSE);
+        return nResult;
+    }
+
+    // Delete the original file.
+    if ( this->m_bDelOriginalFiles )
+    {
+        DeleteFiles(lpFileInfos);
+    }
+
+    return CRYPT_ERROR_SUCCEED;
+}
+
+//////////////////////////////////////////////////////////////////////////
+
+CRYPT_RESULT SdkCryptFile::DecryptBigFile(IN LPFILEINFOS lpFileInfos)
+{
+    if ( (NULL == lpFileInfos) ||
+         (!ISVALIDHANDLE(lpFileInfos->hMapFile)) ||
+         (!ISVALIDHANDLE(lpFileInfos->sDestFileInfo.hDestMapFile)) )
+    {
+        return CRYPT_ERROR_INVALID_HANDLE;
+    }
+
+    // get the system allocation granularity, this value is 64KB(64 * 1024 = 65536)
+    DWORD dwBlockSize = MAX_WRITE_RATE * m_dwAllocationGranularity;
+
+    UINT64 nDestFileOffset  = 0;
+    UINT64 nSrcFileOffset = lpFileInfos->sDestFileInfo.destFileHeader.nDataBegin;
+    UINT64 nSrcFileLength = lpFileInfos->sDestFileInfo.destFileHeader.nDataLength;
+    UINT64 nFileLeftSize  = nSrcFileLength;         // the left bytes which not to be map
     DWORD  dwBytesToMap   = dwBlockSize;            // the bytes to map
     BOOL   isLastBlock    = FALSE;                  // last block or not
     CRYPT_RESULT nResult  = CRYPT_ERROR_SUCCEED;               // The crypt error code.
 
     while ( nFileLeftSize > 0 )
     {
-        // User cancels the operation
-        if ( HasCancelled() )
+        // User cancels the operation
+        if ( HasCancelled() )
+        {
+            return CRYPT_ERROR_CANCEL;
+        }
+
+        if ( nFileLeftSize <= dwBlockSize )
+        {
+            dwBytesToMap = (DWORD)nFileLeftSize;
+            isLastBlock = TRUE;
+
+            dwBlockSize = dwBytesToMap;
+            DWORD dwMod = dwBytesToMap % ENCRYPT_BLOCK_SIZE;
+            if ( 0 != dwMod )
+            {
+                dwBlockSize += ENCRYPT_BLOCK_SIZE - dwMod + ENCRYPT_LAST_PART_VERIFYDATA_SIZE;
+            }
+        }
+
+        PBYTE pSrcMapBuffer = (PBYTE)MapViewOfFile(
+            lpFileInfos->hMapFile,
+            FILE_MAP_READ,
+            (DWORD)(nSrcFileOffset >> 32),
+            (DWORD)(nSrcFileOffset & 0xFFFFFFFF),
+            dwBlockSize );
+
+        if ( NULL == pSrcMapBuffer )
+        {
+            return CRYPT_ERROR_INVALID_HANDLE;
+        }
+
+        // the map of the destination file
+        PBYTE pDestMapBuffer = (PBYTE)MapViewOfFile(
+            lpFileInfos->sDestFileInfo.hDestMapFile,
+            FILE_MAP_READ | FILE_MAP_WRITE,
+            (DWORD)(nDestFileOffset >> 32),
+            (DWORD)(nDestFileOffset & 0xFFFFFFFF),
+            dwBytesToMap);
+
+        if ( NULL == pDestMapBuffer )
+        {
+            UnmapViewOfFile(pSrcMapBuffer);
+            return CRYPT_ERROR_INVALID_HANDLE;
+        }
+
+        // The last block.
+        if ( isLastBlock )
+        {
+            // allocate the new buffer, which size is dwBlockSize + 1. the last byte is 0
+            PBYTE pBuffer = new BYTE[dwBlockSize + 1];
+            ZeroMemory(pBuffer, dwBlockSize + 1);
+            memmove(pBuffer, pSrcMapBuffer, dwBlockSize);
+
+            // Decrypt the buffer. the size of the buffer must be dwBlockSize,
+            // because encryption the
+            // last block size is also dwBlockSize. but the m_pDestBuffer size
+            // is dwBytesToMap, which
+            // is below dwBlockSize, so I copy the m_pSrcBuffer to a new buffer,
+            // which allocated memory
+            // dwBlockSize + 1. then decrypt the new buffer, and copy the new 
+            // buffer to m_pDestBuffer,
+            // the destination size is must be dwBytesToMap,
+            // because the map size of m_pDestBuffer is dwBytesToMap.
+            nResult = m_pCrypt->DecryptStream(pBuffer, dwBlockSize, isLastBlock);
+            if ( CRYPT_ERROR_SUCCEED != nResult )
+            {
+                SAFE_DELETE(pBuffer);
+                UnmapViewOfFile(pDestMapBuffer);
+                UnmapViewOfFile(pSrcMapBuffer);
+                return CRYPT_ERROR_DECRYPT;
+            }
+
+            memmove(pDestMapBuffer, pBuffer, dwBytesToMap);
+
+            // Delete the buffer memory.
+            SAFE_DELETE(pBuffer);
+        }
+        else
+        {
+            //memcpy_s(m_pDestBuffer, dwBlockSize, m_pSrcBuffer, dwBytesToMap);
+            memmove(pDestMapBuffer, pSrcMapBuffer, dwBytesToMap);
+
+            // Decrypt the data buffer
+            nResult = m_pCrypt->DecryptStream(pDestMapBuffer, dwBlockSize, isLastBlock);
+            if ( CRYPT_ERROR_SUCCEED != nResult )
+            {
+                UnmapViewOfFile(pDestMapBuffer);
+                UnmapViewOfFile(pSrcMapBuffer);
+                return CRYPT_ERROR_DECRYPT;
+            }
+        }
+
+        nSrcFileOffset  += dwBlockSize;
+        nDestFileOffset += dwBytesToMap;
+        nFileLeftSize   -= dwBytesToMap;
+
+        // update the percent
+        lpFileInfos->fPencent = ( (FLOAT)nSrcFileOffset / (FLOAT)nSrcFileLength ) * 100;
+        SetPercent();
+
+        UnmapViewOfFile(pDestMapBuffer);
+        UnmapViewOfFile(pSrcMapBuffer);
+    }
+
+    return CRYPT_ERROR_SUCCEED;
+}
+
+//////////////////////////////////////////////////////////////////////////
+
+CRYPT_RESULT SdkCryptFile::DecryptSmallFile(IN LPFILEINFOS lpFileInfos)
+{
+    if ( (NULL == lpFileInfos) ||
+         (!ISVALIDHANDLE(lpFileInfos->hFile)) ||
+         (!ISVALIDHANDLE(lpFileInfos->sDestFileInfo.hDestFile)) )
+    {
+        return CRYPT_ERROR_INVALID_HANDLE;
+    }
+
+    HANDLE hFile       = lpFileInfos->hFile;
+    HANDLE hOutFile    = lpFileInfos->sDestFileInfo.hDestFile;
+    LONG  dwOffsetLow  = (LONG)(lpFileInfos->sDestFileInfo.destFileHeader.nDataBegin & 0xFFFFFFFF);
+    LONG  dwOffsetHigh = (LONG)(lpFileInfos->sDestFileInfo.destFileHeader.nDataBegin >> 32);
+    DWORD dwDataLength = (DWORD)lpFileInfos->sDestFileInfo.destFileHeader.nDataLength;
+
+    SetFilePointer(hFile, dwOffsetLow, &dwOffsetHigh, FILE_BEGIN);
+    SetFilePointer(hOutFile, 0, NULL, FILE_BEGIN);
+
+    DWORD dwBufferSize = (MAX_BUFFER_SIZE >= dwDataLength) ? dwDataLength : MAX_BUFFER_SIZE;
+
+    if ( NULL == m_SmallFileBlock.pbBlob )
+    {
+        return CRYPT_ERROR_FAIL;
+    }
+
+    DWORD dwLeftSize = dwDataLength;
+    DWORD dwBytesToWrite = dwBufferSize;
+    DWORD dwBytesRead = 0;
+    DWORD dwBytesWritten = 0;
+    BOOL  isLastBlock = FALSE;
+    BOOL  isSucceed = FALSE;
+    CRYPT_RESULT nResult = CRYPT_ERROR_SUCCEED;
+
+    // when file size is 0 bytes, decrypt the additional bytes, and the block is last one
+    if ( 0 == dwLeftSize )
+    {
+        dwLeftSize = ENCRYPT_BLOCK_SIZE + ENCRYPT_LAST_PART_VERIFYDATA_SIZE;
+        dwBufferSize = dwLeftSize;
+
+        isSucceed = ReadFile(
+            hFile,
+            m_SmallFileBlock.pbBlob,
+            dwBufferSize,
+            &dwBytesRead,
+            NULL);
+
+        if ( !isSucceed )
+        {
+            return CRYPT_ERROR_READDATA;
+        }
+
+        nResult = m_pCrypt->DecryptStream(m_SmallFileBlock.pbBlob, dwBufferSize, TRUE);
+        if ( CRYPT_ERROR_SUCCEED != nResult )
+        {
+            return CRYPT_ERROR_DECRYPT;
+        }
+
+        lpFileInfos->fPencent = 100;
+        SetPercent();
+
+        return CRYPT_ERROR_SUCCEED;
+    }
+
+    if ( m_isAsyncIO )
+    {
+        nResult = CryptSmallFileAsync(lpFileInfos, FALSE);
+        if ( CRYPT_ERROR_OTHER != nResult )
+        {
+            return nResult;
+        }
+    }
+
+    while ( dwLeftSize > 0 )
+    {
+        ZeroMemory(m_SmallFileBlock.pbBlob, m_SmallFileBlock.dwBlobSize);
+
+        if ( HasCancelled() )
+        {
+            return CRYPT_ERROR_CANCEL;
+        }
+
+        if ( dwLeftSize <= dwBufferSize )
+        {
+            isLastBlock = TRUE;
+            dwBytesToWrite = dwLeftSize;
+            dwBufferSize = dwLeftSize;
+            DWORD dwMod = dwBufferSize % ENCRYPT_BLOCK_SIZE;
+            if ( 0 != dwMod )
+            {
+                dwBufferSize += ENCRYPT_BLOCK_SIZE - dwMod + ENCRYPT_LAST_PART_VERIFYDATA_SIZE;
+            }
+        }
+
+        // Read data from file, the data is encrypted
+        isSucceed = ReadFile(
+            hFile,
+            m_SmallFileBlock.pbBlob,
+            dwBufferSize,
+            &dwBytesRead,
+            NULL);
+
+        if ( !isSucceed )
+        {
+            return CRYPT_ERROR_READDATA;
+        }
+
+        // Decrypt the data.
+        nResult = m_pCrypt->DecryptStream(
+            m_SmallFileBlock.pbBlob,
+            dwBufferSize,
+            isLastBlock);
+
+        if ( CRYPT_ERROR_SUCCEED != nResult )
+        {
+            return CRYPT_ERROR_DECRYPT;
+        }
+
+        // Write the data to destination file, the data has been decrypted.
+        isSucceed = WriteFile(
+            hOutFile,
+            m_SmallFileBlock.pbBlob, 
+            dwBytesToWrite,
+            &dwBytesWritten,
+            NULL);
+
+        if ( !isSucceed )
+        {
+            return CRYPT_ERROR_WRITEDATA;
+        }
+
+        dwLeftSize -= dwBytesWritten;
+
+        lpFileInfos->fPencent = ( (FLOAT)(dwDataLength - dwLeftSize) / (FLOAT)dwDataLength ) * 100;
+        SetPercent();
+    }
+
+    return CRYPT_ERROR_SUCCEED;
+}
+
+//////////////////////////////////////////////////////////////////////////
+
+CRYPT_RESULT SdkCryptFile::CryptSmallFileAsync(IN LPFILEINFOS lpFileInfos, IN BOOL isEncrypt)
+{
+    // The pipeline keeps its threads for the next small files.
+    if (NULL == m_pIoPipeline)
+    {
+        m_pIoPipeline = new SdkCryptIoPipeline(m_SmallFileBlock.dwBlobSize);
+    }
+
+    if ( !m_pIoPipeline->IsValid() )
+    {
+        return CRYPT_ERROR_OTHER;
+    }
+
+    HANDLE hFile       = lpFileInfos->hFile;
+    HANDLE hOutFile    = lpFileInfos->sDestFileInfo.hDestFile;
+    DWORD dwDataLength = (DWORD)lpFileInfos->sDestFileInfo.destFileHeader.nDataLength;
+
+    // The blocks are the same as the synchronous path, only the last one is padded.
+    DWORD dwBlockSize     = MAX_BUFFER_SIZE;
+    DWORD dwBlockCount    = (dwDataLength + dwBlockSize - 1) / dwBlockSize;
+    DWORD dwLastSize      = dwDataLength - (dwBlockCount - 1) * dwBlockSize;
+    DWORD dwLastCryptSize = dwLastSize;
+    DWORD dwMod = dwLastSize % ENCRYPT_BLOCK_SIZE;
+    if ( 0 != dwMod )
+    {
+        dwLastCryptSize += ENCRYPT_BLOCK_SIZE - dwMod + ENCRYPT_LAST_PART_VERIFYDATA_SIZE;
+    }
+
+    CRYPT_RESULT nResult = m_pIoPipeline->Start(
+        hFile,
+        hOutFile,
+        dwBlockSize,
+        dwBlockCount,
+        dwLastCryptSize,
+        isEncrypt ? dwLastCryptSize : dwLastSize);
+
+    if ( CRYPT_ERROR_SUCCEED != nResult )
+    {
+        return nResult;
+    }
+
+    DWORD dwDoneSize = 0;
+    for (DWORD i = 0; i < dwBlockCount; ++i)
+    {
+        if ( HasCancelled() )
+        {
+            nResult = CRYPT_ERROR_CANCEL;
+            break;
+        }
+
+        // NULL means an I/O error, the pipeline returns it when it finishes.
+        DWORD dwBytesRead = 0;
+        PBYTE pbBlock = m_pIoPipeline->AcquireBlock(&dwBytesRead);
+        if ( NULL == pbBlock )
+        {
+            break;
+        }
+
+        BOOL  isLastBlock = (i + 1 == dwBlockCount);
+        DWORD dwCryptSize = isLastBlock ? dwLastCryptSize : dwBlockSize;
+
+        nResult = isEncrypt ?
+            m_pCrypt->EncryptStream(pbBlock, dwCryptSize, isLastBlock) :
+            m_pCrypt->DecryptStream(pbBlock, dwCryptSize, isLastBlock);
+
+        if ( CRYPT_ERROR_SUCCEED != nResult )
+        {
+            nResult = isEncrypt ? CRYPT_ERROR_ENCRYPT : CRYPT_ERROR_DECRYPT;
+            break;
+        }
+
+        m_pIoPipeline->ReleaseBlock();
+
+        dwDoneSize += isLastBlock ? dwLastSize : dwBlockSize;
+        lpFileInfos->fPencent = ( (FLOAT)dwDoneSize / (FLOAT)dwDataLength ) * 100;
+        SetPercent();
+    }
+
+    CRYPT_RESULT nIoResult = m_pIoPipeline->Finish(CRYPT_ERROR_SUCCEED != nResult);
+
+    return (CRYPT_ERROR_SUCCEED != nResult) ? nResult : nIoResult;
+}
+
+//////////////////////////////////////////////////////////////////////////
+
+CRYPT_RESULT SdkCryptFile::CryptChunkedFile(IN LPFILEINFOS lpFileInfos, IN BOOL isEncrypt)
+{
+    if ( (NULL == lpFileInfos) ||
+         (!ISVALIDHANDLE(lpFileInfos->hMapFile)) ||
+         (!ISVALIDHANDLE(lpFileInfos->sDestFileInfo.hDestMapFile)) )
+    {
+        return CRYPT_ERROR_INVALID_HANDLE;
+    }
+
+    const CRYPTCHUNKINFO& chunkInfo = lpFileInfos->sDestFileInfo.chunkInfo;
+
+    CRYPTCHUNKTASK task = { 0 };
+    task.lpFileInfos             = lpFileInfos;
+    task.isEncrypt               = isEncrypt;
+    task.dwVersion               = chunkInfo.dwVersion;
+    task.dwChunkSize             = chunkInfo.dwChunkSize;
+    task.dwAllocationGranularity = m_dwAllocationGranularity;
+    task.lChunkCount             = (LONG)chunkInfo.nChunkCount;
+    task.lResult                 = CRYPT_ERROR_SUCCEED;
+
+    // The thread count is the processor count if the caller does not specify it.
+    UINT32 nThreadCount = m_nCryptThreads;
+    if (0 == nThreadCount)
+    {
+        SYSTEM_INFO sinf;
+        GetSystemInfo(&sinf);
+        nThreadCount = MIN(sinf.dwNumberOfProcessors, MAX_CRYPT_THREADS);
+    }
+    // The authenticated mode alone encrypts on one worker, the parallel and batch modes use all of them.
+    if ( isEncrypt && !m_isParallelCrypt && !m_isBatchCrypt )
+    {
+        nThreadCount = 1;
+    }
+    nThreadCount = (UINT32)MIN((LONG)nThreadCount, task.lChunkCount);
+    nThreadCount = MAX(nThreadCount, 1);
+
+    // The GCM cipher has no state after it is created, all workers share it.
+    if (CRYPT_CHUNK_VERSION_GCM == task.dwVersion)
+    {
+        if (CRYPT_ERROR_SUCCEED != m_pCrypt->CreateAeadCipher(&task.pAeadCipher))
+        {
+            return isEncrypt ? CRYPT_ERROR_ENCRYPT : CRYPT_ERROR_DECRYPT;
+        }
+    }
+
+    vector<HANDLE> vctThreads;
+    vector<LPCRYPTCHUNKWORKER> vctWorkers;
+
+    for (UINT32 i = 0; i < nThreadCount; ++i)
+    {
+        // Every worker owns a key handle, the chain state can not be shared.
+        SdkCrypt *pCrypt = NULL;
+        if (CRYPT_ERROR_SUCCEED != m_pCrypt->DuplicateScene(&pCrypt))
+        {
+            task.lResult = isEncrypt ? CRYPT_ERROR_ENCRYPT : CRYPT_ERROR_DECRYPT;
+            break;
+        }
+
+        LPCRYPTCHUNKWORKER lpWorker = new CRYPTCHUNKWORKER();
+        lpWorker->lpTask   = &task;
+        lpWorker->pCrypt   = pCrypt;
+        lpWorker->pbBuffer = new BYTE[GetChunkCipherSize(task.dwVersion, task.dwChunkSize)];
+        vctWorkers.push_back(lpWorker);
+
+        unsigned int nThreadId = 0;
+        HANDLE hThread = chBEGINTHREADEX(
+            NULL,
+            0,
+            SdkCryptFile::ChunkThreadProc,
+            lpWorker,
+            0,
+            &nThreadId);
+
+        if (NULL == hThread)
+        {
+            task.lResult = CRYPT_ERROR_OTHER;
+            break;
+        }
+
+        vctThreads.push_back(hThread);
+    }
+
+    // Wait for the workers, the progress and the cancellation are handled on this thread.
+    DWORD dwThreadCount = (DWORD)vctThreads.size();
+    while (dwThreadCount > 0)
+    {
+        DWORD dwWait = WaitForMultipleObjects(dwThreadCount, &vctThreads[0], TRUE, CHUNK_WAIT_INTERVAL);
+
+        lpFileInfos->fPencent = ((FLOAT)task.lCompletedChunks / (FLOAT)task.lChunkCount) * 100;
+        SetPercent();
+
+        if ( HasCancelled() )
+        {
+            InterlockedExchange(&task.lCancelled, TRUE);
+        }
+
+        if (WAIT_TIMEOUT != dwWait)
+        {
+            break;
+        }
+    }
+
+    for each (HANDLE hThread in vctThreads)
+    {
+        SAFE_CLOSE_HANDLE(hThread);
+    }
+
+    for each (LPCRYPTCHUNKWORKER lpWorker in vctWorkers)
+    {
+        SAFE_DELETE(lpWorker->pCrypt);
+        SAFE_DELETE_ARRAY(lpWorker->pbBuffer);
+        SAFE_DELETE(lpWorker);
+    }
+
+    SAFE_DELETE(task.pAeadCipher);
+
+    if (task.lCancelled)
+    {
+        return CRYPT_ERROR_CANCEL;
+    }
+
+    return (CRYPT_RESULT)task.lResult;
+}
+
+//////////////////////////////////////////////////////////////////////////
+
+unsigned int WINAPI SdkCryptFile::ChunkThreadProc(LPVOID lpParameter)
+{
+    LPCRYPTCHUNKWORKER lpWorker = (LPCRYPTCHUNKWORKER)lpParameter;
+    LPCRYPTCHUNKTASK lpTask = lpWorker->lpTask;
+
+    while ( !lpTask->lCancelled && (CRYPT_ERROR_SUCCEED == lpTask->lResult) )
+    {
+        // Pick the next chunk, the chunks have fixed offsets so they can finish in any order.
+        LONG lChunkIndex = InterlockedIncrement(&lpTask->lNextChunk) - 1;
+        if (lChunkIndex >= lpTask->lChunkCount)
+        {
+            break;
+        }
+
+        CRYPT_RESULT nResult = CryptChunk(lpTask, lpWorker->pCrypt, lpWorker->pbBuffer, lChunkIndex);
+        if (CRYPT_ERROR_SUCCEED != nResult)
+        {
+            // Keep the first error only.
+            InterlockedCompareExchange(&lpTask->lResult, nResult, CRYPT_ERROR_SUCCEED);
+            break;
+        }
+
+        InterlockedIncrement(&lpTask->lCompletedChunks);
+    }
+
+    return 0;
+}
+
+//////////////////////////////////////////////////////////////////////////
+
+unsigned int WINAPI SdkCryptFile::BatchThreadProc(LPVOID lpParameter)
+{
+    LPCRYPTBATCHWORKER lpWorker = (LPCRYPTBATCHWORKER)lpParameter;
+    LPCRYPTBATCHTASK lpTask = lpWorker->lpTask;
+    SdkCryptFile *pCryptFile = lpWorker->pCryptFile;
+
+    while ( !lpTask->lCancelled )
+    {
+        // Pick the next file, a worker which finishes early takes more files.
+        LONG lFileIndex = InterlockedIncrement(&lpTask->lNextFile) - 1;
+        if (lFileIndex >= lpTask->lFileCount)
+        {
+            break;
+        }
+
+        LPFILEINFOS lpFileInfo = (*lpTask->pFileInfoList)[lpTask->vctFileIndices[lFileIndex]];
+
+        CRYPT_RESULT nResult = (CRYPT_OP_ENCRYPT == lpTask->operationType) ?
+            pCryptFile->EncryptFile(lpFileInfo) :
+            pCryptFile->DecryptFile(lpFileInfo);
+
+        pCryptFile->CloseHandles(lpFileInfo);
+
+        // The result is published before the finished flag, the owner reads them in this order.
+        lpTask->vctResults[lFileIndex] = nResult;
+        InterlockedExchange(&lpTask->vctFinished[lFileIndex], TRUE);
+    }
+
+    InterlockedDecrement(&lpTask->lRunningWorkers);
+    SetEvent(pCryptFile->m_pBatchOwner->m_hBatchInquiry);
+
+    return 0;
+}
+
+//////////////////////////////////////////////////////////////////////////
+
+CRYPT_RESULT SdkCryptFile::CryptChunk(IN LPCRYPTCHUNKTASK lpTask, IN SdkCrypt *pCrypt, IN PBYTE pbBuffer, IN UINT64 nChunkIndex)
+{
+    LPFILEINFOS lpFileInfos = lpTask->lpFileInfos;
+    const CRYPTHEADER& cryptHeader = lpFileInfos->sDestFileInfo.destFileHeader;
+    const CRYPTCHUNKINFO& chunkInfo = lpFileInfos->sDestFileInfo.chunkInfo;
+
+    // Compute the plain and the encrypted range of the chunk.
+    UINT64 nPlainOffset  = nChunkIndex * lpTask->dwChunkSize;
+    UINT64 nCipherOffset = cryptHeader.nDataBegin + nChunkIndex * GetChunkCipherSize(lpTask->dwVersion, lpTask->dwChunkSize);
+    DWORD  dwPlainSize   = (DWORD)MIN((UINT64)lpTask->dwChunkSize, cryptHeader.nDataLength - nPlainOffset);
+    DWORD  dwCipherSize  = GetChunkCipherSize(lpTask->dwVersion, dwPlainSize);
+
+    UINT64 nSrcOffset  = lpTask->isEncrypt ? nPlainOffset  : nCipherOffset;
+    UINT64 nDestOffset = lpTask->isEncrypt ? nCipherOffset : nPlainOffset;
+    DWORD  dwSrcSize   = lpTask->isEncrypt ? dwPlainSize   : dwCipherSize;
+    DWORD  dwDestSize  = lpTask->isEncrypt ? dwCipherSize  : dwPlainSize;
+
+    // The view offset must be the multiple of allocation granularity.
+    DWORD dwSrcDelta  = (DWORD)(nSrcOffset  % lpTask->dwAllocationGranularity);
+    DWORD dwDestDelta = (DWORD)(nDestOffset % lpTask->dwAllocationGranularity);
+    nSrcOffset  -= dwSrcDelta;
+    nDestOffset -= dwDestDelta;
+
+    PBYTE pSrcMapBuffer = (PBYTE)MapViewOfFile(
+        lpFileInfos->hMapFile,
+        FILE_MAP_READ,
+        (DWORD)(nSrcOffset >> 32),
+        (DWORD)(nSrcOffset & 0xFFFFFFFF),
+        dwSrcDelta + dwSrcSize);
+
+    if (NULL == pSrcMapBuffer)
+    {
+        return CRYPT_ERROR_INVALID_HANDLE;
+    }
+
+    PBYTE pDestMapBuffer = (PBYTE)MapViewOfFile(
+        lpFileInfos->sDestFileInfo.hDestMapFile,
+        FILE_MAP_READ | FILE_MAP_WRITE,
+        (DWORD)(nDestOffset >> 32),
+        (DWORD)(nDestOffset & 0xFFFFFFFF),
+        dwDestDelta + dwDestSize);
+
+    if (NULL == pDestMapBuffer)
+    {
+        UnmapViewOfFile(pSrcMapBuffer);
+        return CRYPT_ERROR_INVALID_HANDLE;
+    }
+
+    CRYPT_RESULT nResult = CRYPT_ERROR_SUCCEED;
+    PBYTE pbSrc  = pSrcMapBuffer + dwSrcDelta;
+    PBYTE pbDest = pDestMapBuffer + dwDestDelta;
+
+    if (!lpTask->isEncrypt)
+    {
+        // The destination view only holds the plain size, so decrypt in the worker buffer.
+        memcpy_s(pbBuffer, dwCipherSize, pbSrc, dwCipherSize);
+
+        nResult = DecryptChunkBuffer(lpFileInfos->sDestFileInfo, pCrypt, lpTask->pAeadCipher, nChunkIndex, pbBuffer, dwPlainSize);
+        if (CRYPT_ERROR_SUCCEED == nResult)
+        {
+            memcpy_s(pbDest, dwPlainSize, pbBuffer, dwPlainSize);
+        }
+    }
+    else if (CRYPT_CHUNK_VERSION_GCM == lpTask->dwVersion)
+    {
+        // The ciphertext has the plain size and the tag follows it.
+        BYTE cbIV[AES_GCM_IV_SIZE] = { 0 };
+        BYTE cbAad[CHUNK_AAD_SIZE] = { 0 };
+        GetChunkAeadData(lpFileInfos->sDestFileInfo, nChunkIndex, dwPlainSize, cbIV, cbAad);
+
+        memcpy_s(pbDest, dwCipherSize, pbSrc, dwPlainSize);
+        BOOL isOK = lpTask->pAeadCipher->Seal(cbIV, cbAad, sizeof(cbAad), pbDest, dwPlainSize, pbDest + dwPlainSize);
+        nResult = isOK ? CRYPT_ERROR_SUCCEED : CRYPT_ERROR_ENCRYPT;
+    }
+    else
+    {
+        // Each chunk is an independent final stream which starts from its own IV.
+        BYTE cbIV[ENCRYPT_IV_SIZE] = { 0 };
+        nResult = pCrypt->DeriveChunkIV(chunkInfo.cbNonce, nChunkIndex, cbIV);
+        if (CRYPT_ERROR_SUCCEED == nResult)
         {
-            return CRYPT_ERROR_CANCEL;
+            nResult = pCrypt->SetStreamIV(cbIV);
         }
 
-        if ( nFileLeftSize <= dwBlockSize )
+        if (CRYPT_ERROR_SUCCEED == nResult)
         {
-            dwBytesToMap = (DWORD)nFileLeftSize;
-            isLastBlock = TRUE;
+            // Encrypt in place in the destination view, the tail of the last block is zero.
+            memcpy_s(pbDest, dwCipherSize, pbSrc, dwPlainSize);
+            ZeroMemory(pbDest + dwPlainSize, dwCipherSize - dwPlainSize);
 
-            dwBlockSize = dwBytesToMap;
-            DWORD dwMod = dwBytesToMap % ENCRYPT_BLOCK_SIZE;
-            if ( 0 != dwMod )
-            {
-                dwBlockSize += ENCRYPT_BLOCK_SIZE - dwMod + ENCRYPT_LAST_PART_VERIFYDATA_SIZE;
-            }
+            nResult = pCrypt->EncryptStream(pbDest, dwCipherSize, TRUE);
         }
+        nResult = (CRYPT_ERROR_SUCCEED == nResult) ? CRYPT_ERROR_SUCCEED : CRYPT_ERROR_ENCRYPT;
 
-        PBYTE pSrcMapBuffer = (PBYTE)MapViewOfFile(
-            lpFileInfos->hMapFile,
-            FILE_MAP_READ,
-            (DWORD)(nSrcFileOffset >> 32),
-            (DWORD)(nSrcFileOffset & 0xFFFFFFFF),
-            dwBlockSize );
+        SecureZeroMemory(cbIV, sizeof(cbIV));
+    }
 
-        if ( NULL == pSrcMapBuffer )
-        {
-            return CRYPT_ERROR_INVALID_HANDLE;
-        }
+    UnmapViewOfFile(pDestMapBuffer);
+    UnmapViewOfFile(pSrcMapBuffer);
 
-        // the map of the destination file
-        PBYTE pDestMapBuffer = (PBYTE)MapViewOfFile(
-            lpFileInfos->sDestFileInfo.hDestMapFile,
-            FILE_MAP_READ | FILE_MAP_WRITE,
-            (DWORD)(nDestFileOffset >> 32),
-            (DWORD)(nDestFileOffset & 0xFFFFFFFF),
-            dwBytesToMap);
+    return nResult;
+}
 
-        if ( NULL == pDestMapBuffer )
+//////////////////////////////////////////////////////////////////////////
+
+CRYPT_RESULT SdkCryptFile::DecryptChunkBuffer(IN const DESTFILEINFO& destFileInfo, IN SdkCrypt *pCrypt,
+                                              IN SdkAesGcm *pAeadCipher, IN UINT64 nChunkIndex,
+                                              IN OUT PBYTE pbBuffer, IN DWORD dwPlainSize)
+{
+    const CRYPTCHUNKINFO& chunkInfo = destFileInfo.chunkInfo;
+
+    if (CRYPT_CHUNK_VERSION_GCM == chunkInfo.dwVersion)
+    {
+        if (NULL == pAeadCipher)
         {
-            UnmapViewOfFile(pSrcMapBuffer);
-            return CRYPT_ERROR_INVALID_HANDLE;
+            return CRYPT_ERROR_DECRYPT;
         }
 
-        // The last block.
-        if ( isLastBlock )
-        {
-            // allocate the new buffer, which size is dwBlockSize + 1. the last byte is 0
-            PBYTE pBuffer = new BYTE[dwBlockSize + 1];
-            ZeroMemory(pBuffer, dwBlockSize + 1);
-            memmove(pBuffer, pSrcMapBuffer, dwBlockSize);
+        BYTE cbIV[AES_GCM_IV_SIZE] = { 0 };
+        BYTE cbAad[CHUNK_AAD_SIZE] = { 0 };
+        GetChunkAeadData(destFileInfo, nChunkIndex, dwPlainSize, cbIV, cbAad);
 
-            // Decrypt the buffer. the size of the buffer must be dwBlockSize,
-            // because encryption the
-            // last block size is also dwBlockSize. but the m_pDestBuffer size
-            // is dwBytesToMap, which
-            // is below dwBlockSize, so I copy the m_pSrcBuffer to a new buffer,
-            // which allocated memory
-            // dwBlockSize + 1. then decrypt the new buffer, and copy the new 
-            // buffer to m_pDestBuffer,
-            // the destination size is must be dwBytesToMap,
-            // because the map size of m_pDestBuffer is dwBytesToMap.
-            nResult = m_pCrypt->DecryptStream(pBuffer, dwBlockSize, isLastBlock);
-            if ( CRYPT_ERROR_SUCCEED != nResult )
-            {
-                SAFE_DELETE(pBuffer);
-                UnmapViewOfFile(pDestMapBuffer);
-                UnmapViewOfFile(pSrcMapBuffer);
-                return CRYPT_ERROR_DECRYPT;
-            }
+        // The tag is verified before the data is decrypted, a modified chunk is never
+        // decrypted and the caller drops the output.
+        BOOL isOK = pAeadCipher->Open(cbIV, cbAad, sizeof(cbAad), pbBuffer, dwPlainSize, pbBuffer + dwPlainSize);
 
-            memmove(pDestMapBuffer, pBuffer, dwBytesToMap);
+        return isOK ? CRYPT_ERROR_SUCCEED : CRYPT_ERROR_INVALIDFILE;
+    }
 
-            // Delete the buffer memory.
-            SAFE_DELETE(pBuffer);
-        }
-        else
-        {
-            //memcpy_s(m_pDestBuffer, dwBlockSize, m_pSrcBuffer, dwBytesToMap);
-            memmove(pDestMapBuffer, pSrcMapBuffer, dwBytesToMap);
+    // Each chunk is an independent final stream which starts from its own IV.
+    BYTE cbIV[ENCRYPT_IV_SIZE] = { 0 };
+    CRYPT_RESULT nResult = pCrypt->DeriveChunkIV(chunkInfo.cbNonce, nChunkIndex, cbIV);
+    if (CRYPT_ERROR_SUCCEED == nResult)
+    {
+        nResult = pCrypt->SetStreamIV(cbIV);
+    }
 
-            // Decrypt the data buffer
-            nResult = m_pCrypt->DecryptStream(pDestMapBuffer, dwBlockSize, isLastBlock);
-            if ( CRYPT_ERROR_SUCCEED != nResult )
-            {
-                UnmapViewOfFile(pDestMapBuffer);
-                UnmapViewOfFile(pSrcMapBuffer);
-                return CRYPT_ERROR_DECRYPT;
-            }
-        }
+    if (CRYPT_ERROR_SUCCEED == nResult)
+    {
+        nResult = pCrypt->DecryptStream(pbBuffer, GetChunkCipherSize(chunkInfo.dwVersion, dwPlainSize), TRUE);
+    }
 
-        nSrcFileOffset  += dwBlockSize;
-        nDestFileOffset += dwBytesToMap;
-        nFileLeftSize   -= dwBytesToMap;
+    SecureZeroMemory(cbIV, sizeof(cbIV));
 
-        // update the percent
-        lpFileInfos->fPencent = ( (FLOAT)nSrcFileOffset / (FLOAT)nSrcFileLength ) * 100;
-        SetPercent();
+    return (CRYPT_ERROR_SUCCEED == nResult) ? CRYPT_ERROR_SUCCEED : CRYPT_ERROR_DECRYPT;
+}
 
-        UnmapViewOfFile(pDestMapBuffer);
-        UnmapViewOfFile(pSrcMapBuffer);
+//////////////////////////////////////////////////////////////////////////
+
+void SdkCryptFile::GetChunkAeadData(IN const DESTFILEINFO& destFileInfo, IN UINT64 nChunkIndex, IN DWORD dwPlainSize,
+                                    OUT PBYTE pbIV, OUT PBYTE pbAad)
+{
+    const CRYPTCHUNKINFO& chunkInfo = destFileInfo.chunkInfo;
+
+    // The IV is the file nonce with the chunk index mixed into the last 8 bytes, big endian.
+    memcpy_s(pbIV, AES_GCM_IV_SIZE, chunkInfo.cbNonce, AES_GCM_IV_SIZE);
+    for (int i = 0; i < 8; ++i)
+    {
+        pbIV[AES_GCM_IV_SIZE - 1 - i] ^= (BYTE)(nChunkIndex >> (i * 8));
     }
 
-    return CRYPT_ERROR_SUCCEED;
+    // The chunk index, the chunk count and the chunk size are authenticated, so the chunks
+    // can not be reordered, dropped or truncated.
+    UINT64 nAadValues[3] = { nChunkIndex, chunkInfo.nChunkCount, dwPlainSize };
+    for (int n = 0; n < 3; ++n)
+    {
+        for (int i = 0; i < 8; ++i)
+        {
+            pbAad[n * 8 + i] = (BYTE)(nAadValues[n] >> (i * 8));
+        }
+    }
+
+    // The digest of the header follows, so a modified header fails every chunk.
+    memcpy_s(pbAad + 3 * sizeof(UINT64), ENCRYPT_DIGEST_SIZE, destFileInfo.cbHeaderDigest, ENCRYPT_DIGEST_SIZE);
 }
 
 //////////////////////////////////////////////////////////////////////////
 
-CRYPT_RESULT SdkCryptFile::DecryptSmallFile(IN LPFILEINFOS lpFileInfos)
+CRYPT_RESULT SdkCryptFile::OpenReader(IN LPCTSTR lpFilePath, OUT SdkCryptFileReader **ppReader)
 {
-    if ( (NULL == lpFileInfos) ||
-         (!ISVALIDHANDLE(lpFileInfos->hFile)) ||
-         (!ISVALIDHANDLE(lpFileInfos->sDestFileInfo.hDestFile)) )
+    if ( (NULL == lpFilePath) || (NULL == ppReader) )
     {
-        return CRYPT_ERROR_INVALID_HANDLE;
+        return CRYPT_ERROR_INVALIDPARAM;
     }
 
-    HANDLE hFile       = lpFileInfos->hFile;
-    HANDLE hOutFile    = lpFileInfos->sDestFileInfo.hDestFile;
-    LONG  dwOffsetLow  = (LONG)(lpFileInfos->sDestFileInfo.destFileHeader.nDataBegin & 0xFFFFFFFF);
-    LONG  dwOffsetHigh = (LONG)(lpFileInfos->sDestFileInfo.destFileHeader.nDataBegin >> 32);
-    DWORD dwDataLength = (DWORD)lpFileInfos->sDestFileInfo.destFileHeader.nDataLength;
+    *ppReader = NULL;
 
-    SetFilePointer(hFile, dwOffsetLow, &dwOffsetHigh, FILE_BEGIN);
-    SetFilePointer(hOutFile, 0, NULL, FILE_BEGIN);
+    // The reader never creates a key, the file can only be read with the key which encrypts it.
+    if (NULL == m_pCrypt)
+    {
+        if (CRYPT_ERROR_SUCCEED != SdkCryptKeyCache::AcquireCrypt(m_strCryptKeyPath.c_str(), m_strPassword.c_str(), &m_pCrypt))
+        {
+            return CRYPT_ERROR_INVALID_KEY;
+        }
+    }
 
-    DWORD dwBufferSize = (MAX_BUFFER_SIZE >= dwDataLength) ? dwDataLength : MAX_BUFFER_SIZE;
+    LPFILEINFOS lpFileInfos = new FILEINFOS();
+    ZeroMemory(lpFileInfos, sizeof(FILEINFOS));
+    _tcscpy_s(lpFileInfos->szFilePath, MAX_PATH, lpFilePath);
+    lpFileInfos->isEncrypted = TRUE;
 
-    if ( NULL == m_SmallFileBlock.pbBlob )
+    CRYPT_RESULT nResult = OpenFile(lpFileInfos);
+
+    if (CRYPT_ERROR_SUCCEED == nResult)
     {
-        return CRYPT_ERROR_FAIL;
+        nResult = (CRYPT_ERROR_SUCCEED == m_pCrypt->SetStreamIV(NULL)) ? ReadCryptHeader(lpFileInfos) : CRYPT_ERROR_DECRYPT;
     }
 
-    DWORD dwLeftSize = dwDataLength;
-    DWORD dwBytesToWrite = dwBufferSize;
-    DWORD dwBytesRead = 0;
-    DWORD dwBytesWritten = 0;
-    BOOL  isLastBlock = FALSE;
-    BOOL  isSucceed = FALSE;
-    CRYPT_RESULT nResult = CRYPT_ERROR_SUCCEED;
+    if (CRYPT_ERROR_SUCCEED == nResult)
+    {
+        nResult = CheckCryptHeader(lpFileInfos->sDestFileInfo.destFileHeader);
+    }
 
-    // when file size is 0 bytes, decrypt the additional bytes, and the block is last one
-    if ( 0 == dwLeftSize )
+    // Only the chunked files can be decrypted at any position.
+    if ( (CRYPT_ERROR_SUCCEED == nResult) && !lpFileInfos->isChunked )
     {
-        dwLeftSize = ENCRYPT_BLOCK_SIZE + ENCRYPT_LAST_PART_VERIFYDATA_SIZE;
-        dwBufferSize = dwLeftSize;
+        nResult = CRYPT_ERROR_INVALIDFILE;
+    }
 
-        isSucceed = ReadFile(
-            hFile,
-            m_SmallFileBlock.pbBlob,
-            dwBufferSize,
-            &dwBytesRead,
-            NULL);
+    // The reader reads the chunks by the file handle, the mapping is not needed.
+    SAFE_CLOSE_HANDLE(lpFileInfos->hMapFile);
 
-        if ( !isSucceed )
+    SdkCryptFileReader *pReader = NULL;
+    if (CRYPT_ERROR_SUCCEED == nResult)
+    {
+        pReader = new SdkCryptFileReader();
+        pReader->m_lpFileInfos = lpFileInfos;
+        pReader->m_nDataLength = lpFileInfos->sDestFileInfo.destFileHeader.nDataLength;
+        pReader->m_dwChunkSize = lpFileInfos->sDestFileInfo.chunkInfo.dwChunkSize;
+        pReader->m_dwBufferSize = GetChunkCipherSize(lpFileInfos->sDestFileInfo.chunkInfo.dwVersion, pReader->m_dwChunkSize);
+
+        // The reader owns a crypt object, so it does not depend on this instance.
+        nResult = m_pCrypt->DuplicateScene(&pReader->m_pCrypt);
+        if ( (CRYPT_ERROR_SUCCEED == nResult) &&
+             (CRYPT_CHUNK_VERSION_GCM == lpFileInfos->sDestFileInfo.chunkInfo.dwVersion) )
         {
-            return CRYPT_ERROR_READDATA;
+            nResult = m_pCrypt->CreateAeadCipher(&pReader->m_pAeadCipher);
         }
 
-        nResult = m_pCrypt->DecryptStream(m_SmallFileBlock.pbBlob, dwBufferSize, TRUE);
-        if ( CRYPT_ERROR_SUCCEED != nResult )
+        if (CRYPT_ERROR_SUCCEED != nResult)
         {
+            // The reader releases the file information.
+            SAFE_DELETE(pReader);
             return CRYPT_ERROR_DECRYPT;
         }
 
-        lpFileInfos->fPencent = 100;
-        SetPercent();
-
+        *ppReader = pReader;
         return CRYPT_ERROR_SUCCEED;
     }
 
-    while ( dwLeftSize > 0 )
-    {
-        ZeroMemory(m_SmallFileBlock.pbBlob, m_SmallFileBlock.dwBlobSize);
-
-        if ( HasCancelled() )
-        {
-            return CRYPT_ERROR_CANCEL;
-        }
+    CloseHandles(lpFileInfos);
+    SAFE_DELETE(lpFileInfos);
 
-        if ( dwLeftSize <= dwBufferSize )
-        {
-            isLastBlock = TRUE;
-            dwBytesToWrite = dwLeftSize;
-            dwBufferSize = dwLeftSize;
-            DWORD dwMod = dwBufferSize % ENCRYPT_BLOCK_SIZE;
-            if ( 0 != dwMod )
-            {
-                dwBufferSize += ENCRYPT_BLOCK_SIZE - dwMod + ENCRYPT_LAST_PART_VERIFYDATA_SIZE;
-            }
-        }
+    return nResult;
+}
 
-        // Read data from file, the data is encrypted
-        isSucceed = ReadFile(
-            hFile,
-            m_SmallFileBlock.pbBlob,
-            dwBufferSize,
-            &dwBytesRead,
-            NULL);
+//////////////////////////////////////////////////////////////////////////
 
-        if ( !isSucceed )
-        {
-            return CRYPT_ERROR_READDATA;
-        }
+CRYPT_RESULT SdkCryptFile::ReadChunk(IN LPFILEINFOS lpFileInfos, IN SdkCrypt *pCrypt, IN SdkAesGcm *pAeadCipher,
+                                     IN UINT64 nChunkIndex, OUT PBYTE pbBuffer, OUT DWORD *pdwPlainSize)
+{
+    const CRYPTHEADER& cryptHeader = lpFileInfos->sDestFileInfo.destFileHeader;
+    const CRYPTCHUNKINFO& chunkInfo = lpFileInfos->sDestFileInfo.chunkInfo;
 
-        // Decrypt the data.
-        nResult = m_pCrypt->DecryptStream(
-            m_SmallFileBlock.pbBlob,
-            dwBufferSize,
-            isLastBlock);
+    if (nChunkIndex >= chunkInfo.nChunkCount)
+    {
+        return CRYPT_ERROR_INVALIDPARAM;
+    }
 
-        if ( CRYPT_ERROR_SUCCEED != nResult )
-        {
-            return CRYPT_ERROR_DECRYPT;
-        }
+    // Compute the plain and the encrypted range of the chunk.
+    UINT64 nPlainOffset  = nChunkIndex * chunkInfo.dwChunkSize;
+    DWORD  dwPlainSize   = (DWORD)MIN((UINT64)chunkInfo.dwChunkSize, cryptHeader.nDataLength - nPlainOffset);
+    DWORD  dwCipherSize  = GetChunkCipherSize(chunkInfo.dwVersion, dwPlainSize);
 
-        // Write the data to destination file, the data has been decrypted.
-        isSucceed = WriteFile(
-            hOutFile,
-            m_SmallFileBlock.pbBlob, 
-            dwBytesToWrite,
-            &dwBytesWritten,
-            NULL);
+    LARGE_INTEGER liDistanceToMove;
+    liDistanceToMove.QuadPart = cryptHeader.nDataBegin + nChunkIndex * GetChunkCipherSize(chunkInfo.dwVersion, chunkInfo.dwChunkSize);
 
-        if ( !isSucceed )
-        {
-            return CRYPT_ERROR_WRITEDATA;
-        }
+    DWORD dwBytesRead = 0;
+    BOOL isSucceed = SetFilePointerEx(lpFileInfos->hFile, liDistanceToMove, NULL, FILE_BEGIN) &&
+                     ReadFile(lpFileInfos->hFile, pbBuffer, dwCipherSize, &dwBytesRead, NULL);
 
-        dwLeftSize -= dwBytesWritten;
+    if ( !isSucceed || (dwCipherSize != dwBytesRead) )
+    {
+        return CRYPT_ERROR_READDATA;
+    }
 
-        lpFileInfos->fPencent = ( (FLOAT)(dwDataLength - dwLeftSize) / (FLOAT)dwDataLength ) * 100;
-        SetPercent();
+    CRYPT_RESULT nResult = DecryptChunkBuffer(lpFileInfos->sDestFileInfo, pCrypt, pAeadCipher, nChunkIndex, pbBuffer, dwPlainSize);
+    if (CRYPT_ERROR_SUCCEED == nResult)
+    {
+        *pdwPlainSize = dwPlainSize;
     }
 
-    return CRYPT_ERROR_SUCCEED;
+    return nResult;
+}
+
+//////////////////////////////////////////////////////////////////////////
+
+void SdkCryptFile::CloseReaderFile(IN LPFILEINFOS lpFileInfos)
+{
+    if (NULL != lpFileInfos)
+    {
+        SAFE_CLOSE_HANDLE(lpFileInfos->hMapFile);
+        SAFE_CLOSE_HANDLE(lpFileInfos->hFile);
+        delete lpFileInfos;
+    }
 }
 
 //////////////////////////////////////////////////////////////////////////
@@ -1342,16 +3118,20 @@ CRYPT_RESULT SdkCryptFile::CreateFile(IN OUT LPFILEINFOS lpDestFileInfos, IN BOO
         HANDLE hOutMapFile = NULL;
         LARGE_INTEGER liDistanceToMove;
 
-        if ( isEncrypt )
+        if ( isEncrypt && lpDestFileInfos->isChunked )
         {
-            liDistanceToMove.QuadPart = 
-                lpDestFileInfos->nFileSize + m_dwAllocationGranularity;
-            DWORD dwMod = (DWORD)(lpDestFileInfos->nFileSize % ENCRYPT_BLOCK_SIZE);
-            if ( 0 != dwMod )
-            {
-                liDistanceToMove.QuadPart += ENCRYPT_BLOCK_SIZE - dwMod;
-            }
-            liDistanceToMove.QuadPart += ENCRYPT_LAST_PART_VERIFYDATA_SIZE;
+            // All chunks but the last one are full, every chunk has its padding block or tag.
+            UINT64 nChunkCount = GetChunkCount(lpDestFileInfos->nFileSize, CRYPT_CHUNK_SIZE);
+            DWORD dwLastChunkSize = (DWORD)(lpDestFileInfos->nFileSize - (nChunkCount - 1) * CRYPT_CHUNK_SIZE);
+            DWORD dwVersion = m_isAuthenticatedCrypt ? CRYPT_CHUNK_VERSION_GCM : CRYPT_CHUNK_VERSION_CBC;
+
+            liDistanceToMove.QuadPart = m_dwAllocationGranularity;
+            liDistanceToMove.QuadPart += (nChunkCount - 1) * GetChunkCipherSize(dwVersion, CRYPT_CHUNK_SIZE);
+            liDistanceToMove.QuadPart += GetChunkCipherSize(dwVersion, dwLastChunkSize);
+        }
+        else if ( isEncrypt )
+        {
+            liDistanceToMove.QuadPart = GetCipherFileSize(lpDestFileInfos->nFileSize, m_dwAllocationGranularity);
         }
         else
         {
@@ -1756,6 +3536,29 @@ void SdkCryptFile::OnProgressChanged(IN DWORD dwCompleted, IN DWORD dwTotal)
 
 void SdkCryptFile::OnReplaceFiles(OUT CRYPT_INQUIRE_RESULT *pResult, IN LPCTSTR lpFileName)
 {
+    // The batch worker queues the inquiry and waits until the owner answers it.
+    if (NULL != m_pBatchOwner)
+    {
+        CRYPTBATCHINQUIRY inquiry;
+        inquiry.lpFileName = lpFileName;
+        inquiry.nResult    = *pResult;
+        inquiry.hAnswered  = CreateEvent(NULL, TRUE, FALSE, NULL);
+
+        if (NULL != inquiry.hAnswered)
+        {
+            WaitForSingleObject(m_pBatchOwner->m_hBatchMutex, INFINITE);
+            m_pBatchOwner->m_vctBatchInquiries.push_back(&inquiry);
+            ReleaseMutex(m_pBatchOwner->m_hBatchMutex);
+
+            SetEvent(m_pBatchOwner->m_hBatchInquiry);
+            WaitForSingleObject(inquiry.hAnswered, INFINITE);
+
+            *pResult = inquiry.nResult;
+            SAFE_CLOSE_HANDLE(inquiry.hAnswered);
+        }
+        return;
+    }
+
     if (NULL != m_pCryptFileSink)
     {
         m_pCryptFileSink->OnReplaceFiles(pResult, lpFileName);
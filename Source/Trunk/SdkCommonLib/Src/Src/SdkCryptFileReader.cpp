@@ -0,0 +1,191 @@
+/*!
+* @file SdkCryptFileReader.cpp
+*
+* @brief This file defines SdkCryptFileReader class to read the encrypted files at any position.
+*
+* Copyright (C) 2011, LZT Corporation.
+*
+* @author Li Hong
+* @date 2011/06/20
+*/
+
+#include "stdafx.h"
+#include "SdkCryptFileReader.h"
+#include "SdkAesGcm.h"
+
+USING_NAMESPACE_COMMON
+
+
+/*!
+* @brief One decrypted chunk in the cache.
+*/
+struct NAMESPACE_COMMONLIB::_CRYPTCHUNKCACHE
+{
+    UINT64  nChunkIndex;                    // The chunk index.
+    DWORD   dwPlainSize;                    // The plain size of the chunk.
+    PBYTE   pbData;                         // The plain data, the buffer holds the encrypted chunk.
+};
+
+
+//////////////////////////////////////////////////////////////////////////
+
+SdkCryptFileReader::SdkCryptFileReader() : m_lpFileInfos(NULL),
+                                           m_pCrypt(NULL),
+                                           m_pAeadCipher(NULL),
+                                           m_nDataLength(0),
+                                           m_dwChunkSize(0),
+                                           m_dwBufferSize(0),
+                                           m_nCacheChunks(DEFAULT_READER_CACHE_CHUNKS)
+{
+}
+
+//////////////////////////////////////////////////////////////////////////
+
+SdkCryptFileReader::~SdkCryptFileReader()
+{
+    TrimCache(0);
+
+    SAFE_DELETE(m_pAeadCipher);
+    SAFE_DELETE(m_pCrypt);
+    SdkCryptFile::CloseReaderFile(m_lpFileInfos);
+    m_lpFileInfos = NULL;
+}
+
+//////////////////////////////////////////////////////////////////////////
+
+UINT64 SdkCryptFileReader::GetLength() const
+{
+    return m_nDataLength;
+}
+
+//////////////////////////////////////////////////////////////////////////
+
+CRYPT_RESULT SdkCryptFileReader::Read(IN UINT64 nOffset, OUT PBYTE pbBuffer, IN DWORD dwLength, OUT DWORD *pdwBytesRead)
+{
+    if (NULL != pdwBytesRead)
+    {
+        *pdwBytesRead = 0;
+    }
+
+    if ( (NULL == pbBuffer) && (0 != dwLength) )
+    {
+        return CRYPT_ERROR_INVALIDPARAM;
+    }
+
+    if (nOffset >= m_nDataLength)
+    {
+        return CRYPT_ERROR_SUCCEED;
+    }
+
+    // Only the chunks which cover the range are decrypted.
+    DWORD dwTotalRead = (DWORD)MIN((UINT64)dwLength, m_nDataLength - nOffset);
+    DWORD dwCopied = 0;
+
+    while (dwCopied < dwTotalRead)
+    {
+        UINT64 nPosition = nOffset + dwCopied;
+        UINT64 nChunkIndex = nPosition / m_dwChunkSize;
+        DWORD  dwChunkOffset = (DWORD)(nPosition % m_dwChunkSize);
+
+        CRYPT_RESULT nResult = CRYPT_ERROR_SUCCEED;
+        LPCRYPTCHUNKCACHE lpChunk = GetChunk(nChunkIndex, &nResult);
+        if (NULL == lpChunk)
+        {
+            return nResult;
+        }
+
+        DWORD dwCopySize = MIN(lpChunk->dwPlainSize - dwChunkOffset, dwTotalRead - dwCopied);
+        memcpy_s(pbBuffer + dwCopied, dwTotalRead - dwCopied, lpChunk->pbData + dwChunkOffset, dwCopySize);
+        dwCopied += dwCopySize;
+    }
+
+    if (NULL != pdwBytesRead)
+    {
+        *pdwBytesRead = dwCopied;
+    }
+
+    return CRYPT_ERROR_SUCCEED;
+}
+
+//////////////////////////////////////////////////////////////////////////
+
+CRYPT_RESULT SdkCryptFileReader::SetCacheSize(IN UINT32 nCacheChunks)
+{
+    if (0 == nCacheChunks)
+    {
+        return CRYPT_ERROR_INVALIDPARAM;
+    }
+
+    m_nCacheChunks = nCacheChunks;
+    TrimCache(m_nCacheChunks);
+
+    return CRYPT_ERROR_SUCCEED;
+}
+
+//////////////////////////////////////////////////////////////////////////
+
+LPCRYPTCHUNKCACHE SdkCryptFileReader::GetChunk(IN UINT64 nChunkIndex, OUT CRYPT_RESULT *pResult)
+{
+    // Move the cached chunk to the front.
+    int nSize = (int)m_vctCache.size();
+    for (int i = 0; i < nSize; ++i)
+    {
+        LPCRYPTCHUNKCACHE lpChunk = m_vctCache[i];
+        if (nChunkIndex == lpChunk->nChunkIndex)
+        {
+            m_vctCache.erase(m_vctCache.begin() + i);
+            m_vctCache.insert(m_vctCache.begin(), lpChunk);
+            *pResult = CRYPT_ERROR_SUCCEED;
+            return lpChunk;
+        }
+    }
+
+    // Reuse the least recently used chunk if the cache is full.
+    LPCRYPTCHUNKCACHE lpChunk = NULL;
+    if ( (nSize > 0) && ((UINT32)nSize >= m_nCacheChunks) )
+    {
+        lpChunk = m_vctCache.back();
+        m_vctCache.pop_back();
+    }
+    else
+    {
+        lpChunk = new CRYPTCHUNKCACHE();
+        lpChunk->pbData = new BYTE[m_dwBufferSize];
+    }
+
+    *pResult = SdkCryptFile::ReadChunk(
+        m_lpFileInfos,
+        m_pCrypt,
+        m_pAeadCipher,
+        nChunkIndex,
+        lpChunk->pbData,
+        &lpChunk->dwPlainSize);
+
+    if (CRYPT_ERROR_SUCCEED != *pResult)
+    {
+        SecureZeroMemory(lpChunk->pbData, m_dwBufferSize);
+        SAFE_DELETE_ARRAY(lpChunk->pbData);
+        SAFE_DELETE(lpChunk);
+        return NULL;
+    }
+
+    lpChunk->nChunkIndex = nChunkIndex;
+    m_vctCache.insert(m_vctCache.begin(), lpChunk);
+
+    return lpChunk;
+}
+
+//////////////////////////////////////////////////////////////////////////
+
+void SdkCryptFileReader::TrimCache(IN UINT32 nCacheChunks)
+{
+    while (m_vctCache.size() > nCacheChunks)
+    {
+        LPCRYPTCHUNKCACHE lpChunk = m_vctCache.back();
+        m_vctCache.pop_back();
+
+        SecureZeroMemory(lpChunk->pbData, m_dwBufferSize);
+        SAFE_DELETE_ARRAY(lpChunk->pbData);
+        SAFE_DELETE(lpChunk);
+    }
+}
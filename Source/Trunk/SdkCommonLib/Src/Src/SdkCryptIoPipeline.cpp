@@ -0,0 +1,353 @@
+/*!
+* @file SdkCryptIoPipeline.cpp
+*
+* @brief This file defines SdkCryptIoPipeline class to read and write the crypt blocks asynchronously.
+*
+* Copyright (C) 2011, LZT Corporation.
+*
+* @author Li Hong
+* @date 2011/06/24
+*/
+
+#include "stdafx.h"
+#include "SdkCryptIoPipeline.h"
+#include <process.h>
+
+USING_NAMESPACE_COMMON
+
+
+//////////////////////////////////////////////////////////////////////////
+
+SdkCryptIoPipeline::SdkCryptIoPipeline(IN DWORD dwBufferSize, IN UINT32 nBufferCount) : m_hReadThread(NULL),
+                                                                                      m_hWriteThread(NULL),
+                                                                                      m_hReadJob(NULL),
+                                                                                      m_hWriteJob(NULL),
+                                                                                      m_hReadDone(NULL),
+                                                                                      m_hWriteDone(NULL),
+                                                                                      m_hAbort(NULL),
+                                                                                      m_hQuit(NULL),
+                                                                                      m_hFreeSlots(NULL),
+                                                                                      m_hReadSlots(NULL),
+                                                                                      m_hWriteSlots(NULL),
+                                                                                      m_hSrcFile(NULL),
+                                                                                      m_hDestFile(NULL),
+                                                                                      m_dwBufferSize(dwBufferSize),
+                                                                                      m_dwBlockSize(0),
+                                                                                      m_dwBlockCount(0),
+                                                                                      m_dwLastReadSize(0),
+                                                                                      m_dwLastWriteSize(0),
+                                                                                      m_dwCryptIndex(0),
+                                                                                      m_isRunning(FALSE),
+                                                                                      m_lResult(CRYPT_ERROR_SUCCEED)
+{
+    nBufferCount = MAX(nBufferCount, 2);
+    for (UINT32 i = 0; i < nBufferCount; ++i)
+    {
+        m_vctBuffers.push_back(new BYTE[m_dwBufferSize]);
+        m_vctBytesRead.push_back(0);
+    }
+
+    m_hReadJob   = CreateEvent(NULL, FALSE, FALSE, NULL);
+    m_hWriteJob  = CreateEvent(NULL, FALSE, FALSE, NULL);
+    m_hReadDone  = CreateEvent(NULL, FALSE, FALSE, NULL);
+    m_hWriteDone = CreateEvent(NULL, FALSE, FALSE, NULL);
+    m_hAbort     = CreateEvent(NULL, TRUE, FALSE, NULL);
+    m_hQuit      = CreateEvent(NULL, TRUE, FALSE, NULL);
+
+    if ( (NULL == m_hReadJob) || (NULL == m_hWriteJob) || (NULL == m_hReadDone) ||
+         (NULL == m_hWriteDone) || (NULL == m_hAbort) || (NULL == m_hQuit) )
+    {
+        return;
+    }
+
+    unsigned int nThreadId = 0;
+    m_hReadThread  = chBEGINTHREADEX(NULL, 0, SdkCryptIoPipeline::ReadThreadProc, this, 0, &nThreadId);
+    m_hWriteThread = chBEGINTHREADEX(NULL, 0, SdkCryptIoPipeline::WriteThreadProc, this, 0, &nThreadId);
+}
+
+//////////////////////////////////////////////////////////////////////////
+
+SdkCryptIoPipeline::~SdkCryptIoPipeline()
+{
+    Finish(TRUE);
+
+    if (NULL != m_hQuit)
+    {
+        SetEvent(m_hQuit);
+    }
+
+    HANDLE hThreads[2] = { 0 };
+    DWORD dwThreadCount = 0;
+    if (NULL != m_hReadThread)
+    {
+        hThreads[dwThreadCount++] = m_hReadThread;
+    }
+    if (NULL != m_hWriteThread)
+    {
+        hThreads[dwThreadCount++] = m_hWriteThread;
+    }
+    if (dwThreadCount > 0)
+    {
+        WaitForMultipleObjects(dwThreadCount, hThreads, TRUE, INFINITE);
+    }
+
+    CloseSemaphores();
+
+    SAFE_CLOSE_HANDLE(m_hReadThread);
+    SAFE_CLOSE_HANDLE(m_hWriteThread);
+    SAFE_CLOSE_HANDLE(m_hReadJob);
+    SAFE_CLOSE_HANDLE(m_hWriteJob);
+    SAFE_CLOSE_HANDLE(m_hReadDone);
+    SAFE_CLOSE_HANDLE(m_hWriteDone);
+    SAFE_CLOSE_HANDLE(m_hAbort);
+    SAFE_CLOSE_HANDLE(m_hQuit);
+
+    for each (PBYTE pbBuffer in m_vctBuffers)
+    {
+        SAFE_DELETE_ARRAY(pbBuffer);
+    }
+    m_vctBuffers.clear();
+}
+
+//////////////////////////////////////////////////////////////////////////
+
+BOOL SdkCryptIoPipeline::IsValid() const
+{
+    return (NULL != m_hReadThread) && (NULL != m_hWriteThread);
+}
+
+//////////////////////////////////////////////////////////////////////////
+
+CRYPT_RESULT SdkCryptIoPipeline::Start(IN HANDLE hSrcFile, IN HANDLE hDestFile, IN DWORD dwBlockSize,
+                                       IN DWORD dwBlockCount, IN DWORD dwLastReadSize, IN DWORD dwLastWriteSize)
+{
+    if ( !IsValid() || m_isRunning )
+    {
+        return CRYPT_ERROR_FAIL;
+    }
+
+    if ( !ISVALIDHANDLE(hSrcFile) || !ISVALIDHANDLE(hDestFile) )
+    {
+        return CRYPT_ERROR_INVALID_HANDLE;
+    }
+
+    if ( (0 == dwBlockCount) || (dwBlockSize > m_dwBufferSize) ||
+         (dwLastReadSize > m_dwBufferSize) || (dwLastWriteSize > m_dwBufferSize) )
+    {
+        return CRYPT_ERROR_INVALIDPARAM;
+    }
+
+    // The threads are idle, the semaphores of the last file may be left by an abort.
+    CloseSemaphores();
+
+    LONG lBufferCount = (LONG)m_vctBuffers.size();
+    m_hFreeSlots  = CreateSemaphore(NULL, lBufferCount, lBufferCount, NULL);
+    m_hReadSlots  = CreateSemaphore(NULL, 0, lBufferCount, NULL);
+    m_hWriteSlots = CreateSemaphore(NULL, 0, lBufferCount, NULL);
+
+    if ( (NULL == m_hFreeSlots) || (NULL == m_hReadSlots) || (NULL == m_hWriteSlots) )
+    {
+        CloseSemaphores();
+        return CRYPT_ERROR_OTHER;
+    }
+
+    m_hSrcFile        = hSrcFile;
+    m_hDestFile       = hDestFile;
+    m_dwBlockSize     = dwBlockSize;
+    m_dwBlockCount    = dwBlockCount;
+    m_dwLastReadSize  = dwLastReadSize;
+    m_dwLastWriteSize = dwLastWriteSize;
+    m_dwCryptIndex    = 0;
+    m_lResult         = CRYPT_ERROR_SUCCEED;
+    m_isRunning       = TRUE;
+
+    ResetEvent(m_hAbort);
+    SetEvent(m_hReadJob);
+    SetEvent(m_hWriteJob);
+
+    return CRYPT_ERROR_SUCCEED;
+}
+
+//////////////////////////////////////////////////////////////////////////
+
+PBYTE SdkCryptIoPipeline::AcquireBlock(OUT DWORD *pdwBytesRead)
+{
+    if ( !m_isRunning || (m_dwCryptIndex >= m_dwBlockCount) )
+    {
+        return NULL;
+    }
+
+    if ( !WaitForSlot(m_hReadSlots) )
+    {
+        return NULL;
+    }
+
+    DWORD dwSlot = m_dwCryptIndex % (DWORD)m_vctBuffers.size();
+    if (NULL != pdwBytesRead)
+    {
+        *pdwBytesRead = m_vctBytesRead[dwSlot];
+    }
+
+    return m_vctBuffers[dwSlot];
+}
+
+//////////////////////////////////////////////////////////////////////////
+
+void SdkCryptIoPipeline::ReleaseBlock()
+{
+    if ( m_isRunning && (m_dwCryptIndex < m_dwBlockCount) )
+    {
+        ++m_dwCryptIndex;
+        ReleaseSemaphore(m_hWriteSlots, 1, NULL);
+    }
+}
+
+//////////////////////////////////////////////////////////////////////////
+
+CRYPT_RESULT SdkCryptIoPipeline::Finish(IN BOOL isAbort)
+{
+    if ( !m_isRunning )
+    {
+        return CRYPT_ERROR_SUCCEED;
+    }
+
+    // The writer never gets the blocks which are not released, so they are aborted too.
+    if ( isAbort || (m_dwCryptIndex < m_dwBlockCount) )
+    {
+        SetEvent(m_hAbort);
+    }
+
+    HANDLE hDoneEvents[2] = { m_hReadDone, m_hWriteDone };
+    WaitForMultipleObjects(2, hDoneEvents, TRUE, INFINITE);
+
+    m_isRunning = FALSE;
+    m_hSrcFile  = NULL;
+    m_hDestFile = NULL;
+
+    return (CRYPT_RESULT)m_lResult;
+}
+
+//////////////////////////////////////////////////////////////////////////
+
+unsigned int WINAPI SdkCryptIoPipeline::ReadThreadProc(LPVOID lpParameter)
+{
+    SdkCryptIoPipeline *pThis = (SdkCryptIoPipeline*)lpParameter;
+
+    while ( pThis->WaitForJob(pThis->m_hReadJob) )
+    {
+        pThis->ReadBlocks();
+        SetEvent(pThis->m_hReadDone);
+    }
+
+    return 0;
+}
+
+//////////////////////////////////////////////////////////////////////////
+
+unsigned int WINAPI SdkCryptIoPipeline::WriteThreadProc(LPVOID lpParameter)
+{
+    SdkCryptIoPipeline *pThis = (SdkCryptIoPipeline*)lpParameter;
+
+    while ( pThis->WaitForJob(pThis->m_hWriteJob) )
+    {
+        pThis->WriteBlocks();
+        SetEvent(pThis->m_hWriteDone);
+    }
+
+    return 0;
+}
+
+//////////////////////////////////////////////////////////////////////////
+
+void SdkCryptIoPipeline::ReadBlocks()
+{
+    DWORD dwBufferCount = (DWORD)m_vctBuffers.size();
+
+    for (DWORD i = 0; i < m_dwBlockCount; ++i)
+    {
+        if ( !WaitForSlot(m_hFreeSlots) )
+        {
+            break;
+        }
+
+        DWORD dwSlot      = i % dwBufferCount;
+        DWORD dwReadSize  = (i + 1 == m_dwBlockCount) ? m_dwLastReadSize : m_dwBlockSize;
+        DWORD dwBytesRead = 0;
+        PBYTE pbBuffer    = m_vctBuffers[dwSlot];
+
+        if ( !ReadFile(m_hSrcFile, pbBuffer, dwReadSize, &dwBytesRead, NULL) )
+        {
+            SetError(CRYPT_ERROR_READDATA);
+            break;
+        }
+
+        // The padding of the last block must be zero, as the synchronous path does.
+        ZeroMemory(pbBuffer + dwBytesRead, m_dwBufferSize - dwBytesRead);
+        m_vctBytesRead[dwSlot] = dwBytesRead;
+
+        ReleaseSemaphore(m_hReadSlots, 1, NULL);
+    }
+}
+
+//////////////////////////////////////////////////////////////////////////
+
+void SdkCryptIoPipeline::WriteBlocks()
+{
+    DWORD dwBufferCount = (DWORD)m_vctBuffers.size();
+
+    for (DWORD i = 0; i < m_dwBlockCount; ++i)
+    {
+        if ( !WaitForSlot(m_hWriteSlots) )
+        {
+            break;
+        }
+
+        DWORD dwSlot         = i % dwBufferCount;
+        DWORD dwWriteSize    = (i + 1 == m_dwBlockCount) ? m_dwLastWriteSize : m_dwBlockSize;
+        DWORD dwBytesWritten = 0;
+
+        BOOL isSucceed = WriteFile(m_hDestFile, m_vctBuffers[dwSlot], dwWriteSize, &dwBytesWritten, NULL);
+        if ( !isSucceed || (dwBytesWritten != dwWriteSize) )
+        {
+            SetError(CRYPT_ERROR_WRITEDATA);
+            break;
+        }
+
+        ReleaseSemaphore(m_hFreeSlots, 1, NULL);
+    }
+}
+
+//////////////////////////////////////////////////////////////////////////
+
+BOOL SdkCryptIoPipeline::WaitForJob(IN HANDLE hJobEvent)
+{
+    HANDLE hEvents[2] = { m_hQuit, hJobEvent };
+    return (WAIT_OBJECT_0 + 1) == WaitForMultipleObjects(2, hEvents, FALSE, INFINITE);
+}
+
+//////////////////////////////////////////////////////////////////////////
+
+BOOL SdkCryptIoPipeline::WaitForSlot(IN HANDLE hSemaphore)
+{
+    // The abort event is the first one, so it wins when both are signaled.
+    HANDLE hEvents[2] = { m_hAbort, hSemaphore };
+    return (WAIT_OBJECT_0 + 1) == WaitForMultipleObjects(2, hEvents, FALSE, INFINITE);
+}
+
+//////////////////////////////////////////////////////////////////////////
+
+void SdkCryptIoPipeline::SetError(IN CRYPT_RESULT nResult)
+{
+    // Keep the first error only.
+    InterlockedCompareExchange(&m_lResult, nResult, CRYPT_ERROR_SUCCEED);
+    SetEvent(m_hAbort);
+}
+
+//////////////////////////////////////////////////////////////////////////
+
+void SdkCryptIoPipeline::CloseSemaphores()
+{
+    SAFE_CLOSE_HANDLE(m_hFreeSlots);
+    SAFE_CLOSE_HANDLE(m_hReadSlots);
+    SAFE_CLOSE_HANDLE(m_hWriteSlots);
+}
@@ -11,8 +11,12 @@
 
 #include "stdafx.h"
 #include "SdkCryptKey.h"
+#include "SdkBase64Stream.h"
 
 USING_NAMESPACE_COMMON
+USING_NAMESPACE_UTILITIES
+
+#define KEY_EXPORT_BUFFER_SIZE      4096        // The size of the characters written or read each time.
 
 // The default exchange key data.
 static const BYTE g_szDefaultXchgCryptKeyData[] = 
@@ -95,6 +99,35 @@ static const BYTE g_szDefaultXchgCryptKeyData[] =
 };
 
 
+/*!
+* @brief Encode the data and write the characters to the file with a fixed buffer.
+*/
+static BOOL WriteBase64ToFile(HANDLE hFile, SdkBase64Stream *pEncoder, const BYTE *pbData, DWORD dwDataSize)
+{
+    CHAR szBuffer[KEY_EXPORT_BUFFER_SIZE] = { 0 };
+    const DWORD dwSliceSize = (KEY_EXPORT_BUFFER_SIZE / 4) * 3 - 3;
+
+    BOOL lResult = TRUE;
+    while ( lResult && (dwDataSize > 0) )
+    {
+        DWORD dwSize = MIN(dwDataSize, dwSliceSize);
+        size_t nChars = sizeof(szBuffer);
+        DWORD dwBytesWritten = 0;
+
+        lResult = pEncoder->Feed((const char*)pbData, dwSize, szBuffer, &nChars) &&
+                  WriteFile(hFile, szBuffer, (DWORD)nChars, &dwBytesWritten, NULL) &&
+                  (dwBytesWritten == (DWORD)nChars);
+
+        pbData += dwSize;
+        dwDataSize -= dwSize;
+    }
+
+    SecureZeroMemory(szBuffer, sizeof(szBuffer));
+
+    return lResult;
+}
+
+
 //////////////////////////////////////////////////////////////////////////
 
 SdkCryptKey::SdkCryptKey()
@@ -385,85 +418,135 @@ BOOL SdkCryptKey::LoadFromFile(IN LPCTSTR lpKeyFilePath, IN BOOL isLoadExchangeK
     DWORD dwBytesRead = 0;
     DWORD dwFileSize = GetFileSize(hFile, NULL);
 
-    // The size of file should be bigger than zero.
-    if ( dwFileSize > 0 )
+    // The size of file should be bigger than zero, the data is parsed as ImportFromFile does.
+    if ( (dwFileSize > 0) && (INVALID_FILE_SIZE != dwFileSize) )
     {
-        // First release the memory of key and exchange key.
-        ReleaseMemory();
+        vector<BYTE> vctData(dwFileSize);
+        lResult = ReadFile(hFile, &vctData[0], dwFileSize, &dwBytesRead, NULL) &&
+                  (dwBytesRead == dwFileSize) &&
+                  LoadFromData(&vctData[0], dwFileSize, isLoadExchangeKey);
 
-        // Read the key data length.
-        lResult = ReadFile(
-            hFile,
-            (LPVOID)&m_keyBlobInfo.dwKeyBlobLen,
-            (DWORD)sizeof(m_keyBlobInfo.dwKeyBlobLen),
-            &dwBytesRead,
-            NULL);
+        SecureZeroMemory(&vctData[0], vctData.size());
+    }
 
-        lResult = (lResult && (sizeof(m_keyBlobInfo.dwKeyBlobLen) == dwBytesRead));
-        if ( lResult )
-        {
-            if ( (m_keyBlobInfo.dwKeyBlobLen + sizeof(m_keyBlobInfo.dwKeyBlobLen)) <= dwFileSize && 
-                 (0 != m_keyBlobInfo.dwKeyBlobLen) )
-            {
-                // Allocate the memory for key buffer.
-                m_keyBlobInfo.pbKeyBlob = new BYTE[m_keyBlobInfo.dwKeyBlobLen];
-                // Read the key data from file.
-                BOOL res = ReadFile(
-                    hFile,
-                    (LPVOID)m_keyBlobInfo.pbKeyBlob,
-                    m_keyBlobInfo.dwKeyBlobLen,
-                    &dwBytesRead,
-                    NULL);
-
-                lResult = res && (dwBytesRead == m_keyBlobInfo.dwKeyBlobLen);
-            }
-        }
+    SAFE_CLOSE_HANDLE(hFile);
 
-        // Read exchange key data from file.
-        if ( isLoadExchangeKey && lResult )
-        {
-            lResult = ReadFile(
-                hFile,
-                (LPVOID)&(m_xchKeyBlobInfo.dwKeyBlobLen),
-                (DWORD)sizeof(m_xchKeyBlobInfo.dwKeyBlobLen),
-                &dwBytesRead,
-                NULL);
+    return lResult;
+}
 
-            lResult = ( lResult && 
-                       (sizeof(m_xchKeyBlobInfo.dwKeyBlobLen) == dwBytesRead) &&
-                       (dwBytesRead > 0) );
+//////////////////////////////////////////////////////////////////////////
 
-            if ( lResult )
-            {
-                // Allocate the memory for exchange buffer.
-                m_xchKeyBlobInfo.pbKeyBlob = new BYTE[m_xchKeyBlobInfo.dwKeyBlobLen];
-                // Read the exchange key data from file.
-                lResult = ReadFile(
-                    hFile,
-                    (LPVOID)(m_xchKeyBlobInfo.pbKeyBlob),
-                    (DWORD)(m_xchKeyBlobInfo.dwKeyBlobLen),
-                    &dwBytesRead,
-                    NULL);
-
-                lResult = lResult && (dwBytesRead == m_xchKeyBlobInfo.dwKeyBlobLen);
-            }
-        }
-        else
+BOOL SdkCryptKey::ExportToFile(IN LPCTSTR lpKeyFilePath, IN BOOL isSaveExchangeKey) const
+{
+    if ( (NULL == m_keyBlobInfo.pbKeyBlob) ||
+         (isSaveExchangeKey && (NULL == m_xchKeyBlobInfo.pbKeyBlob)) )
+    {
+        return FALSE;
+    }
+
+    HANDLE hFile = CreateFile(
+        lpKeyFilePath,              // File name.
+        FILE_WRITE_DATA,            // Desired access.
+        0,                          // Not shared.
+        NULL,                       // Not security attributes.
+        CREATE_ALWAYS,              // Create always.
+        FILE_ATTRIBUTE_NORMAL,      // Normal attribute.
+        NULL);
+
+    if ( !ISVALIDHANDLE(hFile) )
+    {
+        return FALSE;
+    }
+
+    // The same data as SaveToFile, each part is encoded as soon as it is fed.
+    SdkBase64Stream encoder(TRUE);
+    BOOL lResult = WriteBase64ToFile(hFile, &encoder, (const BYTE*)&m_keyBlobInfo.dwKeyBlobLen, sizeof(m_keyBlobInfo.dwKeyBlobLen)) &&
+                   WriteBase64ToFile(hFile, &encoder, m_keyBlobInfo.pbKeyBlob, m_keyBlobInfo.dwKeyBlobLen);
+
+    if ( isSaveExchangeKey && lResult )
+    {
+        lResult = WriteBase64ToFile(hFile, &encoder, (const BYTE*)&m_xchKeyBlobInfo.dwKeyBlobLen, sizeof(m_xchKeyBlobInfo.dwKeyBlobLen)) &&
+                  WriteBase64ToFile(hFile, &encoder, m_xchKeyBlobInfo.pbKeyBlob, m_xchKeyBlobInfo.dwKeyBlobLen);
+    }
+
+    if ( lResult )
+    {
+        CHAR szTail[BASE64_STREAM_FINISH_SIZE] = { 0 };
+        size_t nChars = sizeof(szTail);
+        DWORD dwBytesWritten = 0;
+
+        lResult = encoder.Finish(szTail, &nChars) &&
+                  WriteFile(hFile, szTail, (DWORD)nChars, &dwBytesWritten, NULL) &&
+                  (dwBytesWritten == (DWORD)nChars);
+    }
+
+    SAFE_CLOSE_HANDLE(hFile);
+
+    // If fail to write file, delete the crashed file.
+    if ( !lResult )
+    {
+        ::DeleteFile(lpKeyFilePath);
+    }
+
+    return lResult;
+}
+
+//////////////////////////////////////////////////////////////////////////
+
+BOOL SdkCryptKey::ImportFromFile(IN LPCTSTR lpKeyFilePath, IN BOOL isLoadExchangeKey)
+{
+    HANDLE hFile = CreateFile(
+        lpKeyFilePath,          // File path.
+        FILE_READ_DATA,         // Read data access.
+        FILE_SHARE_READ,        // Share read.
+        NULL,                   // No security.
+        OPEN_EXISTING,          // Open existing.
+        FILE_ATTRIBUTE_NORMAL,  // Normal attribute.
+        NULL);
+
+    if ( !ISVALIDHANDLE(hFile) )
+    {
+        return FALSE;
+    }
+
+    // The characters are read and decoded with a fixed buffer, only the key data is kept.
+    SdkBase64Stream decoder(FALSE);
+    vector<BYTE> vctData;
+    CHAR szChars[KEY_EXPORT_BUFFER_SIZE] = { 0 };
+    CHAR szBytes[KEY_EXPORT_BUFFER_SIZE] = { 0 };
+    DWORD dwBytesRead = 0;
+
+    BOOL lResult = TRUE;
+    while ( lResult )
+    {
+        lResult = ReadFile(hFile, szChars, sizeof(szChars), &dwBytesRead, NULL);
+        if ( !lResult || (0 == dwBytesRead) )
         {
-            DWORD dwcbCount = ARRAYSIZE(g_szDefaultXchgCryptKeyData);
-            m_xchKeyBlobInfo.dwKeyBlobLen = dwcbCount;
-            // Allocate the memory for exchange buffer.
-            m_xchKeyBlobInfo.pbKeyBlob = new BYTE[dwcbCount];
-            memcpy_s(
-                m_xchKeyBlobInfo.pbKeyBlob,
-                dwcbCount,
-                g_szDefaultXchgCryptKeyData,
-                dwcbCount);
+            break;
         }
+
+        size_t nBytes = sizeof(szBytes);
+        lResult = decoder.Feed(szChars, dwBytesRead, szBytes, &nBytes);
+        vctData.insert(vctData.end(), (BYTE*)szBytes, (BYTE*)szBytes + nBytes);
+    }
+
+    if ( lResult )
+    {
+        size_t nBytes = sizeof(szBytes);
+        lResult = decoder.Finish(szBytes, &nBytes);
+        vctData.insert(vctData.end(), (BYTE*)szBytes, (BYTE*)szBytes + nBytes);
     }
 
     SAFE_CLOSE_HANDLE(hFile);
 
+    lResult = lResult && !vctData.empty() && LoadFromData(&vctData[0], (DWORD)vctData.size(), isLoadExchangeKey);
+
+    if ( !vctData.empty() )
+    {
+        SecureZeroMemory(&vctData[0], vctData.size());
+    }
+    SecureZeroMemory(szBytes, sizeof(szBytes));
+
     return lResult;
 }
 
@@ -494,6 +577,62 @@ void SdkCryptKey::ReleaseMemory()
 
 //////////////////////////////////////////////////////////////////////////
 
+BOOL SdkCryptKey::LoadFromData(IN const BYTE *pbData, IN DWORD dwDataSize, IN BOOL isLoadExchangeKey)
+{
+    ReleaseMemory();
+
+    // The key data length and the key data, then the exchange key in the same way.
+    DWORD dwKeySize = 0;
+    BOOL lResult = (dwDataSize >= sizeof(dwKeySize));
+    if ( lResult )
+    {
+        memcpy(&dwKeySize, pbData, sizeof(dwKeySize));
+        pbData += sizeof(dwKeySize);
+        dwDataSize -= sizeof(dwKeySize);
+
+        lResult = (0 != dwKeySize) && (dwKeySize <= dwDataSize);
+    }
+
+    if ( lResult )
+    {
+        Initialize((const PBYTE)pbData, dwKeySize, NULL, 0);
+        pbData += dwKeySize;
+        dwDataSize -= dwKeySize;
+    }
+
+    if ( isLoadExchangeKey && lResult )
+    {
+        DWORD dwXchgKeySize = 0;
+        lResult = (dwDataSize >= sizeof(dwXchgKeySize));
+        if ( lResult )
+        {
+            memcpy(&dwXchgKeySize, pbData, sizeof(dwXchgKeySize));
+            pbData += sizeof(dwXchgKeySize);
+            dwDataSize -= sizeof(dwXchgKeySize);
+
+            lResult = (0 != dwXchgKeySize) && (dwXchgKeySize <= dwDataSize);
+        }
+
+        if ( lResult )
+        {
+            Initialize(NULL, 0, (const PBYTE)pbData, dwXchgKeySize);
+        }
+    }
+    else if ( lResult )
+    {
+        Initialize(NULL, 0, (const PBYTE)g_szDefaultXchgCryptKeyData, ARRAYSIZE(g_szDefaultXchgCryptKeyData));
+    }
+
+    if ( !lResult )
+    {
+        ReleaseMemory();
+    }
+
+    return lResult;
+}
+
+//////////////////////////////////////////////////////////////////////////
+
 BOOL SdkCryptKey::ClearFileContent(IN LPCTSTR lpFilePath) const
 {
     if ( !PathFileExists(lpFilePath) )
@@ -0,0 +1,295 @@
+/*!
+* @file SdkCryptKeyCache.cpp
+*
+* @brief This file defines SdkCryptKeyCache class to share the initialized crypt keys in the process.
+*
+* Copyright (C) 2011, LZT Corporation.
+*
+* @author Li Hong
+* @date 2011/06/27
+*/
+
+#include "stdafx.h"
+#include "SdkCryptKeyCache.h"
+
+USING_NAMESPACE_COMMON
+
+#define KEY_CACHE_HASH_SIZE             32              // The size of the password hash, SHA-256.
+
+
+/*!
+* @brief One cached key.
+*/
+struct NAMESPACE_COMMONLIB::_CRYPTKEYCACHEENTRY
+{
+    CryptString strKeyPath;                             // The key file path, empty for the inner key.
+    BYTE        cbPasswordHash[KEY_CACHE_HASH_SIZE];    // The salted hash of the password.
+    FILETIME    ftLastWrite;                            // The last write time of the key file.
+    DWORD       dwFileSize;                             // The size of the key file.
+    SdkCrypt   *pCrypt;                                 // The crypt object, the scene is initialized.
+};
+
+
+/*!
+* @brief The lock of the cache is created when the module is loaded, and the cached keys
+*        are wiped when the module is unloaded.
+*/
+class NAMESPACE_COMMONLIB::SdkCryptKeyCacheLock
+{
+public:
+
+    SdkCryptKeyCacheLock()
+    {
+        InitializeCriticalSection(&SdkCryptKeyCache::s_csLock);
+    }
+
+    ~SdkCryptKeyCacheLock()
+    {
+        SdkCryptKeyCache::EvictAll();
+
+        if (NULL != SdkCryptKeyCache::s_hHashProvider)
+        {
+            CryptReleaseContext(SdkCryptKeyCache::s_hHashProvider, 0);
+            SdkCryptKeyCache::s_hHashProvider = NULL;
+        }
+
+        SecureZeroMemory(SdkCryptKeyCache::s_cbSalt, sizeof(SdkCryptKeyCache::s_cbSalt));
+        DeleteCriticalSection(&SdkCryptKeyCache::s_csLock);
+    }
+};
+
+
+CRITICAL_SECTION                SdkCryptKeyCache::s_csLock;
+HCRYPTPROV                      SdkCryptKeyCache::s_hHashProvider = NULL;
+BYTE                            SdkCryptKeyCache::s_cbSalt[16] = { 0 };
+BOOL                            SdkCryptKeyCache::s_hasSalt = FALSE;
+UINT32                          SdkCryptKeyCache::s_nCapacity = DEFAULT_KEY_CACHE_ENTRIES;
+vector<LPCRYPTKEYCACHEENTRY>    SdkCryptKeyCache::s_vctEntries;
+
+// It must be defined after the static members, it uses them when it is constructed.
+static SdkCryptKeyCacheLock     g_keyCacheLock;
+
+
+//////////////////////////////////////////////////////////////////////////
+
+CRYPT_RESULT SdkCryptKeyCache::AcquireCrypt(IN LPCTSTR lpKeyPath, IN LPCTSTR lpPassword, OUT SdkCrypt **ppCrypt)
+{
+    if (NULL == ppCrypt)
+    {
+        return CRYPT_ERROR_INVALIDPARAM;
+    }
+
+    *ppCrypt = NULL;
+
+    // The key file is checked every time, the cached key is stale if the file is changed.
+    CryptString strKeyPath = (NULL != lpKeyPath) ? lpKeyPath : _T("");
+    WIN32_FILE_ATTRIBUTE_DATA fileData = { 0 };
+    if ( !strKeyPath.empty() && !GetFileAttributesEx(strKeyPath.c_str(), GetFileExInfoStandard, &fileData) )
+    {
+        return CRYPT_ERROR_INVALID_KEY;
+    }
+
+    CRYPT_RESULT nResult = CRYPT_ERROR_FAIL;
+    BYTE cbPasswordHash[KEY_CACHE_HASH_SIZE] = { 0 };
+
+    EnterCriticalSection(&s_csLock);
+
+    if ( (0 == s_nCapacity) || !GetPasswordHash(lpPassword, cbPasswordHash) )
+    {
+        // The cache is disabled, the key is loaded as before.
+        LeaveCriticalSection(&s_csLock);
+        return LoadCrypt(lpKeyPath, ppCrypt);
+    }
+
+    LPCRYPTKEYCACHEENTRY lpEntry = NULL;
+    for (vector<LPCRYPTKEYCACHEENTRY>::iterator iter = s_vctEntries.begin(); iter != s_vctEntries.end(); ++iter)
+    {
+        if ( (0 == _tcsicmp((*iter)->strKeyPath.c_str(), strKeyPath.c_str())) &&
+             (0 == memcmp((*iter)->cbPasswordHash, cbPasswordHash, KEY_CACHE_HASH_SIZE)) )
+        {
+            lpEntry = *iter;
+            s_vctEntries.erase(iter);
+            break;
+        }
+    }
+
+    BOOL isStale = (NULL != lpEntry) &&
+                   ( (0 != CompareFileTime(&lpEntry->ftLastWrite, &fileData.ftLastWriteTime)) ||
+                     (lpEntry->dwFileSize != fileData.nFileSizeLow) );
+    if (isStale)
+    {
+        DestroyEntry(lpEntry);
+        lpEntry = NULL;
+    }
+
+    if (NULL == lpEntry)
+    {
+        SdkCrypt *pCrypt = NULL;
+        nResult = LoadCrypt(lpKeyPath, &pCrypt);
+        if (CRYPT_ERROR_SUCCEED == nResult)
+        {
+            lpEntry = new CRYPTKEYCACHEENTRY();
+            lpEntry->strKeyPath  = strKeyPath;
+            lpEntry->ftLastWrite = fileData.ftLastWriteTime;
+            lpEntry->dwFileSize  = fileData.nFileSizeLow;
+            lpEntry->pCrypt      = pCrypt;
+            memcpy(lpEntry->cbPasswordHash, cbPasswordHash, KEY_CACHE_HASH_SIZE);
+        }
+    }
+
+    if (NULL != lpEntry)
+    {
+        // The most recently used entry is the first.
+        s_vctEntries.insert(s_vctEntries.begin(), lpEntry);
+        TrimEntries(s_nCapacity);
+
+        nResult = lpEntry->pCrypt->DuplicateScene(ppCrypt);
+    }
+
+    LeaveCriticalSection(&s_csLock);
+
+    SecureZeroMemory(cbPasswordHash, sizeof(cbPasswordHash));
+
+    return nResult;
+}
+
+//////////////////////////////////////////////////////////////////////////
+
+void SdkCryptKeyCache::Evict(IN LPCTSTR lpKeyPath)
+{
+    CryptString strKeyPath = (NULL != lpKeyPath) ? lpKeyPath : _T("");
+
+    EnterCriticalSection(&s_csLock);
+
+    vector<LPCRYPTKEYCACHEENTRY>::iterator iter = s_vctEntries.begin();
+    while (iter != s_vctEntries.end())
+    {
+        if (0 == _tcsicmp((*iter)->strKeyPath.c_str(), strKeyPath.c_str()))
+        {
+            DestroyEntry(*iter);
+            iter = s_vctEntries.erase(iter);
+        }
+        else
+        {
+            ++iter;
+        }
+    }
+
+    LeaveCriticalSection(&s_csLock);
+}
+
+//////////////////////////////////////////////////////////////////////////
+
+void SdkCryptKeyCache::EvictAll()
+{
+    EnterCriticalSection(&s_csLock);
+    TrimEntries(0);
+    LeaveCriticalSection(&s_csLock);
+}
+
+//////////////////////////////////////////////////////////////////////////
+
+void SdkCryptKeyCache::SetCapacity(IN UINT32 nEntries)
+{
+    EnterCriticalSection(&s_csLock);
+    s_nCapacity = nEntries;
+    TrimEntries(s_nCapacity);
+    LeaveCriticalSection(&s_csLock);
+}
+
+//////////////////////////////////////////////////////////////////////////
+
+BOOL SdkCryptKeyCache::GetPasswordHash(IN LPCTSTR lpPassword, OUT PBYTE pbHash)
+{
+    if (NULL == s_hHashProvider)
+    {
+        if ( !CryptAcquireContext(&s_hHashProvider, NULL, NULL, PROV_RSA_AES, CRYPT_VERIFYCONTEXT) )
+        {
+            s_hHashProvider = NULL;
+            return FALSE;
+        }
+    }
+
+    if ( !s_hasSalt )
+    {
+        s_hasSalt = CryptGenRandom(s_hHashProvider, sizeof(s_cbSalt), s_cbSalt);
+        if ( !s_hasSalt )
+        {
+            return FALSE;
+        }
+    }
+
+    HCRYPTHASH hHash = NULL;
+    if ( !CryptCreateHash(s_hHashProvider, CALG_SHA_256, 0, 0, &hHash) )
+    {
+        return FALSE;
+    }
+
+    DWORD dwPasswordSize = (NULL != lpPassword) ? (DWORD)(_tcslen(lpPassword) * sizeof(TCHAR)) : 0;
+    DWORD dwHashSize = KEY_CACHE_HASH_SIZE;
+
+    BOOL isOK = CryptHashData(hHash, s_cbSalt, sizeof(s_cbSalt), 0) &&
+                CryptHashData(hHash, (const BYTE*)lpPassword, dwPasswordSize, 0) &&
+                CryptGetHashParam(hHash, HP_HASHVAL, pbHash, &dwHashSize, 0) &&
+                (KEY_CACHE_HASH_SIZE == dwHashSize);
+
+    CryptDestroyHash(hHash);
+
+    return isOK;
+}
+
+//////////////////////////////////////////////////////////////////////////
+
+CRYPT_RESULT SdkCryptKeyCache::LoadCrypt(IN LPCTSTR lpKeyPath, OUT SdkCrypt **ppCrypt)
+{
+    SdkCrypt *pCrypt = NULL;
+
+    if (NULL == lpKeyPath)
+    {
+        pCrypt = new SdkCrypt();
+    }
+    else
+    {
+        SdkCryptKey cryptKey;
+        if ( !cryptKey.LoadFromFile(lpKeyPath) )
+        {
+            return CRYPT_ERROR_INVALID_KEY;
+        }
+
+        pCrypt = new SdkCrypt(&cryptKey);
+    }
+
+    CRYPT_RESULT nResult = pCrypt->InitializeScene();
+    if (CRYPT_ERROR_SUCCEED != nResult)
+    {
+        SAFE_DELETE(pCrypt);
+    }
+
+    *ppCrypt = pCrypt;
+
+    return nResult;
+}
+
+//////////////////////////////////////////////////////////////////////////
+
+void SdkCryptKeyCache::TrimEntries(IN UINT32 nEntries)
+{
+    while (s_vctEntries.size() > nEntries)
+    {
+        DestroyEntry(s_vctEntries.back());
+        s_vctEntries.pop_back();
+    }
+}
+
+//////////////////////////////////////////////////////////////////////////
+
+void SdkCryptKeyCache::DestroyEntry(IN LPCRYPTKEYCACHEENTRY lpEntry)
+{
+    if (NULL != lpEntry)
+    {
+        // The crypt object wipes its key blobs and the expanded key.
+        SAFE_DELETE(lpEntry->pCrypt);
+        SecureZeroMemory(lpEntry->cbPasswordHash, sizeof(lpEntry->cbPasswordHash));
+        delete lpEntry;
+    }
+}
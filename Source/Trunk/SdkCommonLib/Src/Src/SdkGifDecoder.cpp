@@ -0,0 +1,916 @@
+/*!
+* @file SdkGifDecoder.cpp
+*
+* @brief The implementation of functions defined in SdkGifDecoder class.
+*
+* Copyright (C) 2011, LZT Corporation.
+*
+* @author Li Hong
+* @date 2011/06/30
+*/
+
+#include "stdafx.h"
+#include "SdkGifDecoder.h"
+
+#include <string.h>         // Get memcpy.
+
+#if defined(_M_IX86) || defined(_M_X64) || defined(__i386__) || defined(__x86_64__)
+#define GIF_HW_X86
+#include <emmintrin.h>
+#if !defined(_MSC_VER) || (_MSC_VER >= 1700)
+#define GIF_HW_AVX2
+#include <immintrin.h>
+#endif
+#ifdef _MSC_VER
+#include <intrin.h>
+#else
+#include <cpuid.h>
+#endif // _MSC_VER
+#endif
+
+// GCC and Clang need the target attribute to emit AVX2 instructions without global options.
+#if defined(GIF_HW_X86) && defined(__GNUC__)
+#define GIF_AVX2_TARGET     __attribute__((target("avx2")))
+#else
+#define GIF_AVX2_TARGET
+#endif
+
+USING_NAMESPACE_UTILITIES
+
+#define GIF_BLOCK_EXTENSION             0x21        // The extension introducer.
+#define GIF_BLOCK_IMAGE                 0x2C        // The image separator.
+#define GIF_BLOCK_TRAILER               0x3B        // The trailer.
+#define GIF_EXTENSION_CONTROL           0xF9        // The graphic control extension label.
+#define GIF_EXTENSION_APPLICATION       0xFF        // The application extension label.
+#define GIF_LZW_MAX_CODES               4096        // The LZW codes are 12 bits at most.
+#define GIF_LZW_COPY_SLACK              16          // The LZW strings are copied 16 bytes each time.
+
+/*!
+* @brief The frame which is indexed when the GIF is loaded.
+*/
+struct NAMESPACE_UTILITIES::_GIFFRAMEENTRY
+{
+    GIF_FRAME_INFO  info;                   // The frame information.
+    size_t          nPalette;               // The offset of the local color table, 0 is none.
+    UINT            uPaletteSize;           // The count of the colors of the local color table.
+    size_t          nData;                  // The offset of the LZW minimum code size.
+};
+
+volatile UINT32 SdkGifDecoder::s_uSimdLevel = (UINT32)-1;
+
+
+//////////////////////////////////////////////////////////////////////////
+//
+// The LZW strings are copied from the output which is decoded before, the copy takes
+// 16 bytes each time and may write some bytes after the string, they are overwritten by
+// the next strings. The source string always ends before the destination, so the bytes
+// of the string are read before they are written.
+//
+//////////////////////////////////////////////////////////////////////////
+
+static inline void GifCopyString(BYTE *pDest, const BYTE *pSrc, size_t nLength)
+{
+    for (size_t i = 0; i < nLength; i += GIF_LZW_COPY_SLACK)
+    {
+#if defined(GIF_HW_X86)
+        _mm_storeu_si128((__m128i*)(pDest + i), _mm_loadu_si128((const __m128i*)(pSrc + i)));
+#else
+        BYTE block[GIF_LZW_COPY_SLACK];
+        memcpy(block, pSrc + i, GIF_LZW_COPY_SLACK);
+        memcpy(pDest + i, block, GIF_LZW_COPY_SLACK);
+#endif // GIF_HW_X86
+    }
+}
+
+static inline UINT GifReadWord(const BYTE *p)
+{
+    return (UINT)p[0] | ((UINT)p[1] << 8);
+}
+
+
+//////////////////////////////////////////////////////////////////////////
+//
+// The SIMD implementation of the palette expansion, the tail is left to the scalar code.
+//
+//////////////////////////////////////////////////////////////////////////
+
+#if defined(GIF_HW_AVX2)
+
+GIF_AVX2_TARGET static size_t GifExpandPaletteAvx2(const BYTE *pIndices, size_t nCount, const UINT32 *pPalette, UINT32 *pPixels)
+{
+    size_t i = 0;
+    for (; i + 8 <= nCount; i += 8)
+    {
+        __m256i indices = _mm256_cvtepu8_epi32(_mm_loadl_epi64((const __m128i*)(pIndices + i)));
+        __m256i colors  = _mm256_i32gather_epi32((const int*)pPalette, indices, 4);
+        _mm256_storeu_si256((__m256i*)(pPixels + i), colors);
+    }
+
+    return i;
+}
+
+GIF_AVX2_TARGET static size_t GifExpandPaletteTransparentAvx2(const BYTE *pIndices, size_t nCount, const UINT32 *pPalette,
+                                                              UINT uTransparentIndex, UINT32 *pPixels)
+{
+    const __m256i transparent = _mm256_set1_epi32((int)uTransparentIndex);
+
+    size_t i = 0;
+    for (; i + 8 <= nCount; i += 8)
+    {
+        __m256i indices = _mm256_cvtepu8_epi32(_mm_loadl_epi64((const __m128i*)(pIndices + i)));
+        __m256i keep    = _mm256_cmpeq_epi32(indices, transparent);
+        if (-1 == _mm256_movemask_epi8(keep))
+        {
+            continue;
+        }
+
+        __m256i colors  = _mm256_i32gather_epi32((const int*)pPalette, indices, 4);
+        __m256i old     = _mm256_loadu_si256((const __m256i*)(pPixels + i));
+        _mm256_storeu_si256((__m256i*)(pPixels + i), _mm256_blendv_epi8(colors, old, keep));
+    }
+
+    return i;
+}
+
+#endif // GIF_HW_AVX2
+
+
+//////////////////////////////////////////////////////////////////////////
+
+SdkGifDecoder::SdkGifDecoder() : m_uWidth(0),
+                                 m_uHeight(0),
+                                 m_uAspectRatio(0),
+                                 m_uBkColorIndex(0),
+                                 m_uLoopCount(0),
+                                 m_hasLoopCount(FALSE),
+                                 m_nGlobalPalette(0),
+                                 m_uGlobalPaletteSize(0),
+                                 m_uComposedIndex((UINT)-1)
+{
+}
+
+//////////////////////////////////////////////////////////////////////////
+
+SdkGifDecoder::~SdkGifDecoder()
+{
+    Clear();
+}
+
+//////////////////////////////////////////////////////////////////////////
+
+BOOL SdkGifDecoder::IsGifData(IN const BYTE *pData, size_t cbData)
+{
+    return (NULL != pData) && (cbData >= 6) &&
+           ((0 == memcmp(pData, "GIF87a", 6)) || (0 == memcmp(pData, "GIF89a", 6)));
+}
+
+//////////////////////////////////////////////////////////////////////////
+
+BOOL SdkGifDecoder::LoadFromMemory(IN const BYTE *pData, size_t cbData)
+{
+    Clear();
+
+    // The header and the logical screen descriptor.
+    if ( !IsGifData(pData, cbData) || (cbData < 13) )
+    {
+        return FALSE;
+    }
+
+    m_vctData.assign(pData, pData + cbData);
+    if ( !ParseBlocks() )
+    {
+        Clear();
+        return FALSE;
+    }
+
+    return TRUE;
+}
+
+//////////////////////////////////////////////////////////////////////////
+
+void SdkGifDecoder::Clear()
+{
+    for (size_t i = 0; i < m_vctFrames.size(); ++i)
+    {
+        delete m_vctFrames[i];
+    }
+
+    m_vctFrames.clear();
+    vector<BYTE>().swap(m_vctData);
+    vector<BYTE>().swap(m_vctLzwData);
+    vector<BYTE>().swap(m_vctIndices);
+    vector<BYTE>().swap(m_vctRows);
+    vector<UINT32>().swap(m_vctCanvas);
+    vector<UINT32>().swap(m_vctPrevious);
+
+    m_uWidth             = 0;
+    m_uHeight            = 0;
+    m_uAspectRatio       = 0;
+    m_uBkColorIndex      = 0;
+    m_uLoopCount         = 0;
+    m_hasLoopCount       = FALSE;
+    m_nGlobalPalette     = 0;
+    m_uGlobalPaletteSize = 0;
+    m_uComposedIndex     = (UINT)-1;
+}
+
+//////////////////////////////////////////////////////////////////////////
+
+UINT SdkGifDecoder::GetWidth() const
+{
+    return m_uWidth;
+}
+
+//////////////////////////////////////////////////////////////////////////
+
+UINT SdkGifDecoder::GetHeight() const
+{
+    return m_uHeight;
+}
+
+//////////////////////////////////////////////////////////////////////////
+
+UINT SdkGifDecoder::GetPixelAspectRatio() const
+{
+    return m_uAspectRatio;
+}
+
+//////////////////////////////////////////////////////////////////////////
+
+UINT SdkGifDecoder::GetFrameCount() const
+{
+    return (UINT)m_vctFrames.size();
+}
+
+//////////////////////////////////////////////////////////////////////////
+
+BOOL SdkGifDecoder::GetLoopCount(OUT UINT &uLoopCount) const
+{
+    uLoopCount = m_uLoopCount;
+    return m_hasLoopCount;
+}
+
+//////////////////////////////////////////////////////////////////////////
+
+BOOL SdkGifDecoder::GetBackgroundColor(OUT UINT32 &uColor) const
+{
+    if ( (0 == m_nGlobalPalette) || (m_uBkColorIndex >= m_uGlobalPaletteSize) )
+    {
+        return FALSE;
+    }
+
+    const BYTE *pRGB = &m_vctData[m_nGlobalPalette + m_uBkColorIndex * 3];
+    uColor = 0xFF000000 | ((UINT32)pRGB[0] << 16) | ((UINT32)pRGB[1] << 8) | (UINT32)pRGB[2];
+
+    return TRUE;
+}
+
+//////////////////////////////////////////////////////////////////////////
+
+BOOL SdkGifDecoder::GetFrameInfo(UINT uFrameIndex, OUT GIF_FRAME_INFO &info) const
+{
+    if (uFrameIndex >= m_vctFrames.size())
+    {
+        return FALSE;
+    }
+
+    info = m_vctFrames[uFrameIndex]->info;
+    return TRUE;
+}
+
+//////////////////////////////////////////////////////////////////////////
+
+BOOL SdkGifDecoder::DecodeFrameIndices(UINT uFrameIndex, OUT BYTE *pIndices)
+{
+    const GIFFRAMEENTRY *pEntry = DecodeIndices(uFrameIndex);
+    if ( (NULL == pEntry) || (NULL == pIndices) )
+    {
+        return FALSE;
+    }
+
+    size_t nCount = (size_t)pEntry->info.uWidth * pEntry->info.uHeight;
+    if (nCount > 0)
+    {
+        memcpy(pIndices, &m_vctIndices[0], nCount);
+    }
+
+    return TRUE;
+}
+
+//////////////////////////////////////////////////////////////////////////
+
+BOOL SdkGifDecoder::DecodeFrame(UINT uFrameIndex, OUT BYTE *pPixels, UINT uStride)
+{
+    const GIFFRAMEENTRY *pEntry = DecodeIndices(uFrameIndex);
+    if ( (NULL == pEntry) || (NULL == pPixels) || (uStride < pEntry->info.uWidth * 4) )
+    {
+        return FALSE;
+    }
+
+    UINT32 palette[256];
+    GetFramePalette(pEntry, TRUE, palette);
+
+    UINT uWidth = pEntry->info.uWidth;
+    for (UINT y = 0; y < pEntry->info.uHeight; ++y)
+    {
+        ExpandPalette(&m_vctIndices[(size_t)y * uWidth], uWidth, palette, (UINT32*)(pPixels + (size_t)y * uStride));
+    }
+
+    return TRUE;
+}
+
+//////////////////////////////////////////////////////////////////////////
+
+BOOL SdkGifDecoder::ComposeFrame(UINT uFrameIndex, OUT BYTE *pPixels, UINT uStride)
+{
+    if ( (uFrameIndex >= m_vctFrames.size()) || (NULL == pPixels) || (uStride < m_uWidth * 4) )
+    {
+        return FALSE;
+    }
+
+    // The frames are drawn in order, going back starts from the first frame.
+    if ( ((UINT)-1 == m_uComposedIndex) || (uFrameIndex < m_uComposedIndex) )
+    {
+        m_uComposedIndex = (UINT)-1;
+    }
+
+    for (UINT i = m_uComposedIndex + 1; i <= uFrameIndex; ++i)
+    {
+        if ( !ComposeNextFrame(i) )
+        {
+            m_uComposedIndex = (UINT)-1;
+            return FALSE;
+        }
+    }
+
+    for (UINT y = 0; y < m_uHeight; ++y)
+    {
+        memcpy(pPixels + (size_t)y * uStride, &m_vctCanvas[(size_t)y * m_uWidth], m_uWidth * 4);
+    }
+
+    return TRUE;
+}
+
+//////////////////////////////////////////////////////////////////////////
+
+void SdkGifDecoder::ExpandPalette(IN const BYTE *pIndices, size_t nCount, IN const UINT32 *pPalette, OUT UINT32 *pPixels)
+{
+    size_t nDone = 0;
+
+#if defined(GIF_HW_AVX2)
+    if (GIF_SIMD_AVX2 == GetSimdLevel())
+    {
+        nDone = GifExpandPaletteAvx2(pIndices, nCount, pPalette, pPixels);
+    }
+#endif // GIF_HW_AVX2
+
+    ExpandPaletteScalar(pIndices + nDone, nCount - nDone, pPalette, pPixels + nDone);
+}
+
+//////////////////////////////////////////////////////////////////////////
+
+void SdkGifDecoder::ExpandPaletteTransparent(IN const BYTE *pIndices, size_t nCount, IN const UINT32 *pPalette,
+                                             UINT uTransparentIndex, IN OUT UINT32 *pPixels)
+{
+    size_t nDone = 0;
+
+#if defined(GIF_HW_AVX2)
+    if (GIF_SIMD_AVX2 == GetSimdLevel())
+    {
+        nDone = GifExpandPaletteTransparentAvx2(pIndices, nCount, pPalette, uTransparentIndex, pPixels);
+    }
+#endif // GIF_HW_AVX2
+
+    ExpandPaletteTransparentScalar(pIndices + nDone, nCount - nDone, pPalette, uTransparentIndex, pPixels + nDone);
+}
+
+//////////////////////////////////////////////////////////////////////////
+
+void SdkGifDecoder::ExpandPaletteScalar(IN const BYTE *pIndices, size_t nCount, IN const UINT32 *pPalette, OUT UINT32 *pPixels)
+{
+    for (size_t i = 0; i < nCount; ++i)
+    {
+        pPixels[i] = pPalette[pIndices[i]];
+    }
+}
+
+//////////////////////////////////////////////////////////////////////////
+
+void SdkGifDecoder::ExpandPaletteTransparentScalar(IN const BYTE *pIndices, size_t nCount, IN const UINT32 *pPalette,
+                                                   UINT uTransparentIndex, IN OUT UINT32 *pPixels)
+{
+    for (size_t i = 0; i < nCount; ++i)
+    {
+        if (pIndices[i] != uTransparentIndex)
+        {
+            pPixels[i] = pPalette[pIndices[i]];
+        }
+    }
+}
+
+//////////////////////////////////////////////////////////////////////////
+
+UINT32 SdkGifDecoder::GetSimdLevel()
+{
+    UINT32 nLevel = s_uSimdLevel;
+    if ((UINT32)-1 == nLevel)
+    {
+        nLevel = GetSupportedSimdLevel();
+        s_uSimdLevel = nLevel;
+    }
+
+    return nLevel;
+}
+
+//////////////////////////////////////////////////////////////////////////
+
+void SdkGifDecoder::SetSimdLevel(UINT32 nLevel)
+{
+    UINT32 nSupported = GetSupportedSimdLevel();
+    s_uSimdLevel = (nLevel < nSupported) ? nLevel : nSupported;
+}
+
+//////////////////////////////////////////////////////////////////////////
+
+BOOL SdkGifDecoder::ParseBlocks()
+{
+    const BYTE *pData = &m_vctData[0];
+    size_t cbData = m_vctData.size();
+
+    m_uWidth        = GifReadWord(pData + 6);
+    m_uHeight       = GifReadWord(pData + 8);
+    m_uBkColorIndex = pData[11];
+    m_uAspectRatio  = pData[12];
+
+    size_t nOffset = 13;
+    if (0 != (pData[10] & 0x80))
+    {
+        m_uGlobalPaletteSize = 2u << (pData[10] & 0x07);
+        m_nGlobalPalette = nOffset;
+        nOffset += m_uGlobalPaletteSize * 3;
+        if (nOffset > cbData)
+        {
+            return FALSE;
+        }
+    }
+
+    // The graphic control extension applies to the next image.
+    GIF_FRAME_INFO control;
+    memset(&control, 0, sizeof(control));
+
+    while (nOffset < cbData)
+    {
+        BYTE block = pData[nOffset++];
+        if (GIF_BLOCK_EXTENSION == block)
+        {
+            if (nOffset >= cbData)
+            {
+                break;
+            }
+
+            BYTE label = pData[nOffset++];
+            if ( (GIF_EXTENSION_CONTROL == label) && (nOffset + 5 <= cbData) && (pData[nOffset] >= 4) )
+            {
+                BYTE flags = pData[nOffset + 1];
+                control.hasGraphicControl = TRUE;
+                control.uDisposal         = (flags >> 2) & 0x07;
+                control.hasTransparency   = (0 != (flags & 0x01));
+                control.uDelay            = GifReadWord(pData + nOffset + 2);
+                control.uTransparentIndex = pData[nOffset + 4];
+            }
+            else if ( (GIF_EXTENSION_APPLICATION == label) && (nOffset + 12 <= cbData) && (11 == pData[nOffset]) &&
+                      ((0 == memcmp(pData + nOffset + 1, "NETSCAPE2.0", 11)) || (0 == memcmp(pData + nOffset + 1, "ANIMEXTS1.0", 11))) )
+            {
+                // The first sub-block is 1 and the loop count.
+                size_t nSubBlock = nOffset + 12;
+                if ( (nSubBlock + 4 <= cbData) && (pData[nSubBlock] >= 3) && (1 == pData[nSubBlock + 1]) )
+                {
+                    m_uLoopCount   = GifReadWord(pData + nSubBlock + 2);
+                    m_hasLoopCount = TRUE;
+                }
+            }
+
+            nOffset = SkipSubBlocks(nOffset);
+        }
+        else if (GIF_BLOCK_IMAGE == block)
+        {
+            // The image descriptor and the LZW minimum code size.
+            if (nOffset + 10 > cbData)
+            {
+                break;
+            }
+
+            LPGIFFRAMEENTRY pEntry = new GIFFRAMEENTRY;
+            pEntry->info              = control;
+            pEntry->info.uLeft        = GifReadWord(pData + nOffset);
+            pEntry->info.uTop         = GifReadWord(pData + nOffset + 2);
+            pEntry->info.uWidth       = GifReadWord(pData + nOffset + 4);
+            pEntry->info.uHeight      = GifReadWord(pData + nOffset + 6);
+            pEntry->info.isInterlaced = (0 != (pData[nOffset + 8] & 0x40));
+            pEntry->nPalette          = 0;
+            pEntry->uPaletteSize      = 0;
+
+            BYTE flags = pData[nOffset + 8];
+            nOffset += 9;
+            if (0 != (flags & 0x80))
+            {
+                pEntry->uPaletteSize = 2u << (flags & 0x07);
+                pEntry->nPalette = nOffset;
+                nOffset += pEntry->uPaletteSize * 3;
+            }
+
+            if ( (nOffset >= cbData) || ((size_t)pEntry->info.uWidth * pEntry->info.uHeight > MAX_GIF_PIXELS) )
+            {
+                delete pEntry;
+                break;
+            }
+
+            pEntry->nData = nOffset;
+            m_vctFrames.push_back(pEntry);
+            memset(&control, 0, sizeof(control));
+
+            nOffset = SkipSubBlocks(nOffset + 1);
+        }
+        else
+        {
+            // The trailer, or the data is broken.
+            break;
+        }
+    }
+
+    if (m_vctFrames.empty())
+    {
+        return FALSE;
+    }
+
+    // Some encoders write zero size, the frames decide it.
+    if ( (0 == m_uWidth) || (0 == m_uHeight) )
+    {
+        for (size_t i = 0; i < m_vctFrames.size(); ++i)
+        {
+            const GIF_FRAME_INFO &info = m_vctFrames[i]->info;
+            m_uWidth  = (m_uWidth  > info.uLeft + info.uWidth)  ? m_uWidth  : info.uLeft + info.uWidth;
+            m_uHeight = (m_uHeight > info.uTop  + info.uHeight) ? m_uHeight : info.uTop  + info.uHeight;
+        }
+    }
+
+    return ((size_t)m_uWidth * m_uHeight <= MAX_GIF_PIXELS);
+}
+
+//////////////////////////////////////////////////////////////////////////
+
+size_t SdkGifDecoder::SkipSubBlocks(size_t nOffset) const
+{
+    size_t cbData = m_vctData.size();
+    while (nOffset < cbData)
+    {
+        BYTE cbBlock = m_vctData[nOffset++];
+        if (0 == cbBlock)
+        {
+            return nOffset;
+        }
+
+        nOffset += cbBlock;
+    }
+
+    return cbData;
+}
+
+//////////////////////////////////////////////////////////////////////////
+
+BOOL SdkGifDecoder::DecodeLzw(IN const GIFFRAMEENTRY *pEntry)
+{
+    const GIF_FRAME_INFO &info = pEntry->info;
+    size_t nCount = (size_t)info.uWidth * info.uHeight;
+
+    // The missing pixels of a short frame are transparent.
+    m_vctIndices.resize(nCount + GIF_LZW_COPY_SLACK);
+    BYTE *pOut = &m_vctIndices[0];
+    memset(pOut, info.hasTransparency ? (BYTE)info.uTransparentIndex : 0, nCount);
+
+    UINT uMinCodeSize = m_vctData[pEntry->nData];
+    if ( (uMinCodeSize < 1) || (uMinCodeSize > 11) )
+    {
+        return FALSE;
+    }
+
+    // Join the sub-blocks, so the codes are read without checking the block boundaries.
+    m_vctLzwData.clear();
+    size_t nOffset = pEntry->nData + 1;
+    size_t cbData = m_vctData.size();
+    while (nOffset < cbData)
+    {
+        size_t cbBlock = m_vctData[nOffset++];
+        if (0 == cbBlock)
+        {
+            break;
+        }
+
+        cbBlock = (nOffset + cbBlock <= cbData) ? cbBlock : cbData - nOffset;
+        m_vctLzwData.insert(m_vctLzwData.end(), m_vctData.begin() + nOffset, m_vctData.begin() + nOffset + cbBlock);
+        nOffset += cbBlock;
+    }
+
+    // Each string is kept as the position and the length of its first output, a new string
+    // is the previous output and one more byte, which is always the next byte of the output.
+    UINT32 stringPos[GIF_LZW_MAX_CODES];
+    UINT32 stringLength[GIF_LZW_MAX_CODES];
+
+    const UINT uClearCode = 1u << uMinCodeSize;
+    const UINT uEndCode   = uClearCode + 1;
+    UINT uCodeSize        = uMinCodeSize + 1;
+    UINT uNextCode        = uClearCode + 2;
+    UINT uPrevCode        = (UINT)-1;
+    size_t nPrevPos       = 0;
+    size_t nPrevLength    = 0;
+    size_t nOutPos        = 0;
+
+    const BYTE *pIn  = m_vctLzwData.empty() ? NULL : &m_vctLzwData[0];
+    const BYTE *pEnd = pIn + m_vctLzwData.size();
+    UINT32 uBits     = 0;
+    UINT   uBitCount = 0;
+
+    while (nOutPos < nCount)
+    {
+        while (uBitCount < uCodeSize)
+        {
+            if (pIn >= pEnd)
+            {
+                return TRUE;
+            }
+            uBits |= (UINT32)(*pIn++) << uBitCount;
+            uBitCount += 8;
+        }
+
+        UINT uCode = uBits & ((1u << uCodeSize) - 1);
+        uBits >>= uCodeSize;
+        uBitCount -= uCodeSize;
+
+        if (uCode == uClearCode)
+        {
+            uCodeSize = uMinCodeSize + 1;
+            uNextCode = uClearCode + 2;
+            uPrevCode = (UINT)-1;
+            continue;
+        }
+
+        if (uCode == uEndCode)
+        {
+            break;
+        }
+
+        size_t nLength = 0;
+        if (uCode < uClearCode)
+        {
+            pOut[nOutPos] = (BYTE)uCode;
+            nLength = 1;
+        }
+        else if ( ((UINT)-1 != uPrevCode) && (uCode < uNextCode) )
+        {
+            nLength = stringLength[uCode];
+            nLength = (nLength < nCount - nOutPos) ? nLength : nCount - nOutPos;
+            GifCopyString(pOut + nOutPos, pOut + stringPos[uCode], nLength);
+        }
+        else if ( ((UINT)-1 != uPrevCode) && (uCode == uNextCode) )
+        {
+            // The string is the previous one and its first byte, it is cut at the end of the frame.
+            nPrevLength = (nPrevLength < nCount - nOutPos) ? nPrevLength : nCount - nOutPos;
+            GifCopyString(pOut + nOutPos, pOut + nPrevPos, nPrevLength);
+            if (nOutPos + nPrevLength < nCount)
+            {
+                pOut[nOutPos + nPrevLength] = pOut[nPrevPos];
+                nLength = nPrevLength + 1;
+            }
+            else
+            {
+                nLength = nPrevLength;
+            }
+        }
+        else
+        {
+            // The code is broken, the decoded pixels are kept.
+            break;
+        }
+
+        if ( ((UINT)-1 != uPrevCode) && (uNextCode < GIF_LZW_MAX_CODES) )
+        {
+            stringPos[uNextCode]    = (UINT32)nPrevPos;
+            stringLength[uNextCode] = (UINT32)nPrevLength + 1;
+            ++uNextCode;
+            if ( (uNextCode == (1u << uCodeSize)) && (uCodeSize < 12) )
+            {
+                ++uCodeSize;
+            }
+        }
+
+        uPrevCode   = uCode;
+        nPrevPos    = nOutPos;
+        nPrevLength = nLength;
+        nOutPos    += nLength;
+    }
+
+    return TRUE;
+}
+
+//////////////////////////////////////////////////////////////////////////
+
+const GIFFRAMEENTRY* SdkGifDecoder::DecodeIndices(UINT uFrameIndex)
+{
+    if (uFrameIndex >= m_vctFrames.size())
+    {
+        return NULL;
+    }
+
+    const GIFFRAMEENTRY *pEntry = m_vctFrames[uFrameIndex];
+    if ( !DecodeLzw(pEntry) )
+    {
+        return NULL;
+    }
+
+    const GIF_FRAME_INFO &info = pEntry->info;
+    if (info.isInterlaced && (info.uHeight > 1))
+    {
+        // The passes take every 8th row from 0, every 8th row from 4, every 4th row
+        // from 2 and every 2nd row from 1.
+        static const UINT s_passStart[4] = { 0, 4, 2, 1 };
+        static const UINT s_passStep[4]  = { 8, 8, 4, 2 };
+
+        m_vctRows.resize(m_vctIndices.size());
+        const BYTE *pSrc = &m_vctIndices[0];
+        for (int nPass = 0; nPass < 4; ++nPass)
+        {
+            for (UINT y = s_passStart[nPass]; y < info.uHeight; y += s_passStep[nPass])
+            {
+                memcpy(&m_vctRows[(size_t)y * info.uWidth], pSrc, info.uWidth);
+                pSrc += info.uWidth;
+            }
+        }
+
+        m_vctIndices.swap(m_vctRows);
+    }
+
+    return pEntry;
+}
+
+//////////////////////////////////////////////////////////////////////////
+
+void SdkGifDecoder::GetFramePalette(IN const GIFFRAMEENTRY *pEntry, BOOL isTransparentZero, OUT UINT32 *pPalette) const
+{
+    size_t nPalette = (0 != pEntry->nPalette) ? pEntry->nPalette : m_nGlobalPalette;
+    UINT uSize = (0 != pEntry->nPalette) ? pEntry->uPaletteSize : m_uGlobalPaletteSize;
+    uSize = (0 != nPalette) ? uSize : 0;
+
+    for (UINT i = 0; i < 256; ++i)
+    {
+        pPalette[i] = 0xFF000000;
+    }
+
+    // The colors are opaque, so the premultiplied BGRA is the same as the BGRA.
+    for (UINT i = 0; i < uSize; ++i)
+    {
+        const BYTE *pRGB = &m_vctData[nPalette + i * 3];
+        pPalette[i] = 0xFF000000 | ((UINT32)pRGB[0] << 16) | ((UINT32)pRGB[1] << 8) | (UINT32)pRGB[2];
+    }
+
+    if (isTransparentZero && pEntry->info.hasTransparency)
+    {
+        pPalette[pEntry->info.uTransparentIndex] = 0;
+    }
+}
+
+//////////////////////////////////////////////////////////////////////////
+
+BOOL SdkGifDecoder::ComposeNextFrame(UINT uFrameIndex)
+{
+    size_t nCanvasSize = (size_t)m_uWidth * m_uHeight;
+    UINT uLeft = 0, uTop = 0, uRight = 0, uBottom = 0;
+
+    if (0 == uFrameIndex)
+    {
+        m_vctCanvas.assign(nCanvasSize, 0);
+    }
+    else
+    {
+        // Dispose the previous frame.
+        const GIF_FRAME_INFO &prevInfo = m_vctFrames[uFrameIndex - 1]->info;
+        if ( ((DM_BACKGROUND == prevInfo.uDisposal) || (DM_PREVIOUS == prevInfo.uDisposal)) &&
+             GetCanvasRect(prevInfo, uLeft, uTop, uRight, uBottom) )
+        {
+            for (UINT y = uTop; y < uBottom; ++y)
+            {
+                size_t nRow = (size_t)y * m_uWidth;
+                if (DM_PREVIOUS == prevInfo.uDisposal)
+                {
+                    memcpy(&m_vctCanvas[nRow + uLeft], &m_vctPrevious[nRow + uLeft], (uRight - uLeft) * 4);
+                }
+                else
+                {
+                    memset(&m_vctCanvas[nRow + uLeft], 0, (uRight - uLeft) * 4);
+                }
+            }
+        }
+    }
+
+    const GIFFRAMEENTRY *pEntry = DecodeIndices(uFrameIndex);
+    if (NULL == pEntry)
+    {
+        return FALSE;
+    }
+
+    const GIF_FRAME_INFO &info = pEntry->info;
+    if ( !GetCanvasRect(info, uLeft, uTop, uRight, uBottom) )
+    {
+        m_uComposedIndex = uFrameIndex;
+        return TRUE;
+    }
+
+    // Only the area of the frame is restored, the rest of the canvas is not changed.
+    if (DM_PREVIOUS == info.uDisposal)
+    {
+        m_vctPrevious.resize(nCanvasSize);
+        for (UINT y = uTop; y < uBottom; ++y)
+        {
+            size_t nRow = (size_t)y * m_uWidth;
+            memcpy(&m_vctPrevious[nRow + uLeft], &m_vctCanvas[nRow + uLeft], (uRight - uLeft) * 4);
+        }
+    }
+
+    UINT32 palette[256];
+    GetFramePalette(pEntry, FALSE, palette);
+
+    for (UINT y = uTop; y < uBottom; ++y)
+    {
+        const BYTE *pIndices = &m_vctIndices[(size_t)(y - info.uTop) * info.uWidth];
+        UINT32 *pPixels = &m_vctCanvas[(size_t)y * m_uWidth + uLeft];
+        if (info.hasTransparency)
+        {
+            ExpandPaletteTransparent(pIndices, uRight - uLeft, palette, info.uTransparentIndex, pPixels);
+        }
+        else
+        {
+            ExpandPalette(pIndices, uRight - uLeft, palette, pPixels);
+        }
+    }
+
+    m_uComposedIndex = uFrameIndex;
+
+    return TRUE;
+}
+
+//////////////////////////////////////////////////////////////////////////
+
+BOOL SdkGifDecoder::GetCanvasRect(IN const GIF_FRAME_INFO &info, OUT UINT &uLeft, OUT UINT &uTop, OUT UINT &uRight, OUT UINT &uBottom) const
+{
+    uLeft   = info.uLeft;
+    uTop    = info.uTop;
+    uRight  = (info.uLeft + info.uWidth  < m_uWidth)  ? info.uLeft + info.uWidth  : m_uWidth;
+    uBottom = (info.uTop  + info.uHeight < m_uHeight) ? info.uTop  + info.uHeight : m_uHeight;
+
+    return (uLeft < uRight) && (uTop < uBottom);
+}
+
+//////////////////////////////////////////////////////////////////////////
+
+UINT32 SdkGifDecoder::GetSupportedSimdLevel()
+{
+#if defined(GIF_HW_AVX2)
+    unsigned int ecx = 0;
+#ifdef _MSC_VER
+    int cpuInfo[4] = { 0 };
+    __cpuid(cpuInfo, 1);
+    ecx = (unsigned int)cpuInfo[2];
+#else
+    unsigned int eax = 0, ebx = 0, edx = 0;
+    if (!__get_cpuid(1, &eax, &ebx, &ecx, &edx))
+    {
+        return GIF_SIMD_NONE;
+    }
+#endif // _MSC_VER
+
+    // AVX2 also needs the OS to save the YMM registers.
+    if ( (0 == (ecx & (1 << 27))) || (0 == (ecx & (1 << 28))) )
+    {
+        return GIF_SIMD_NONE;
+    }
+
+#ifdef _MSC_VER
+    __cpuidex(cpuInfo, 7, 0);
+    unsigned int ebx7 = (unsigned int)cpuInfo[1];
+    unsigned int xcr0 = (unsigned int)_xgetbv(0);
+#else
+    unsigned int ebx7 = 0, xcr0 = 0, xcrHigh = 0;
+    if (__get_cpuid_max(0, NULL) >= 7)
+    {
+        __cpuid_count(7, 0, eax, ebx7, ecx, edx);
+    }
+    __asm__ ("xgetbv" : "=a"(xcr0), "=d"(xcrHigh) : "c"(0));
+#endif // _MSC_VER
+
+    if ( (0 != (ebx7 & (1 << 5))) && (6 == (xcr0 & 6)) )
+    {
+        return GIF_SIMD_AVX2;
+    }
+#endif // GIF_HW_AVX2
+
+    return GIF_SIMD_NONE;
+}
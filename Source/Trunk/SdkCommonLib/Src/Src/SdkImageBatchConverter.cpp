@@ -0,0 +1,579 @@
+/*!
+* @file SdkImageBatchConverter.cpp
+*
+* @brief This file defines SdkImageBatchConverter class to convert many images on the worker threads.
+*
+* Copyright (C) 2011, LZT Corporation.
+*
+* @author Li Hong
+* @date 2011/06/30
+*/
+
+#include "stdafx.h"
+#include "SdkImageBatchConverter.h"
+#include "SdkWICImageHelper.h"
+#include <process.h>
+
+USING_NAMESPACE_UTILITIES
+
+/*!
+* @brief The job of the batch.
+*/
+struct NAMESPACE_UTILITIES::_IMAGEBATCHJOB
+{
+    wstring             strSource;          // The source image file.
+    wstring             strTarget;          // The target image file.
+    IMAGE_SAVETYPE      saveType;           // The format of the target image.
+    UINT32              uMaxWidth;          // The max width of the target image.
+    UINT32              uMaxHeight;         // The max height of the target image.
+    HRESULT             hrResult;           // The result of the last run.
+    IWICFormatConverter *pOpened;           // The opened image which is not decoded yet.
+    IWICBitmap         *pDecoded;           // The decoded 32bppPBGRA image.
+    UINT32              uSrcWidth;          // The width of the decoded image.
+    UINT32              uSrcHeight;         // The height of the decoded image.
+    UINT32              uDestWidth;         // The width of the target image.
+    UINT32              uDestHeight;        // The height of the target image.
+    vector<BYTE>        vctPixels;          // The straight 32bppBGRA pixels of the target image.
+    UINT64              uBytes;             // The bytes of the job counted in flight, reserved before decoding.
+};
+
+/*!
+* @brief The encoder and the extension of each IMAGE_SAVETYPE.
+*/
+static const struct
+{
+    const GUID     *pContainer;             // The container format, NULL if WIC has no encoder.
+    LPCWSTR         lpExtension;            // The extension added to the file which has none.
+
+} g_batchFormats[] =
+{
+    { &GUID_ContainerFormatBmp,     L"bmp" },       // SAVETYPE_BMP
+    { &GUID_ContainerFormatJpeg,    L"jpg" },       // SAVETYPE_JPEG
+    { &GUID_ContainerFormatGif,     L"gif" },       // SAVETYPE_GIF
+    { NULL,                         L"emf" },       // SAVETYPE_EMF
+    { NULL,                         L"wmf" },       // SAVETYPE_WMF
+    { &GUID_ContainerFormatTiff,    L"tif" },       // SAVETYPE_TIFF
+    { &GUID_ContainerFormatPng,     L"png" },       // SAVETYPE_PNG
+    { NULL,                         L"ico" },       // SAVETYPE_ICON
+};
+
+
+//////////////////////////////////////////////////////////////////////////
+
+SdkImageBatchConverter::SdkImageBatchConverter() : m_uNextOpen(0),
+                                                   m_uActiveCount(0),
+                                                   m_uBudget(DEFAULT_IMAGE_BATCH_BUDGET),
+                                                   m_uBytesInFlight(0),
+                                                   m_filter(PIXEL_RESIZE_BILINEAR),
+                                                   m_lCancelled(0)
+{
+    InitializeCriticalSection(&m_csLock);
+    InitializeConditionVariable(&m_cvChanged);
+    QueryPerformanceFrequency(&m_liFrequency);
+    ZeroMemory(&m_stats, sizeof(m_stats));
+}
+
+//////////////////////////////////////////////////////////////////////////
+
+SdkImageBatchConverter::~SdkImageBatchConverter()
+{
+    ClearJobs();
+    DeleteCriticalSection(&m_csLock);
+}
+
+//////////////////////////////////////////////////////////////////////////
+
+UINT32 SdkImageBatchConverter::AddJob(IN LPCWSTR lpSource, IN LPCWSTR lpTarget, IN IMAGE_SAVETYPE saveType,
+                                      IN UINT32 uMaxWidth, IN UINT32 uMaxHeight)
+{
+    LPIMAGEBATCHJOB lpJob = new IMAGEBATCHJOB();
+    lpJob->strSource   = (NULL != lpSource) ? lpSource : L"";
+    lpJob->strTarget   = (NULL != lpTarget) ? lpTarget : L"";
+    lpJob->saveType    = saveType;
+    lpJob->uMaxWidth   = uMaxWidth;
+    lpJob->uMaxHeight  = uMaxHeight;
+    lpJob->hrResult    = E_PENDING;
+    lpJob->pOpened     = NULL;
+    lpJob->pDecoded    = NULL;
+    lpJob->uSrcWidth   = 0;
+    lpJob->uSrcHeight  = 0;
+    lpJob->uDestWidth  = 0;
+    lpJob->uDestHeight = 0;
+    lpJob->uBytes      = 0;
+
+    m_vctJobs.push_back(lpJob);
+
+    return (UINT32)(m_vctJobs.size() - 1);
+}
+
+//////////////////////////////////////////////////////////////////////////
+
+void SdkImageBatchConverter::ClearJobs()
+{
+    for (vector<LPIMAGEBATCHJOB>::iterator itor = m_vctJobs.begin(); itor != m_vctJobs.end(); ++itor)
+    {
+        SAFE_RELEASE((*itor)->pOpened);
+        SAFE_RELEASE((*itor)->pDecoded);
+        SAFE_DELETE(*itor);
+    }
+
+    m_vctJobs.clear();
+    m_lstDecodeQueue.clear();
+    m_lstResizeQueue.clear();
+    m_lstEncodeQueue.clear();
+}
+
+//////////////////////////////////////////////////////////////////////////
+
+UINT32 SdkImageBatchConverter::GetJobCount() const
+{
+    return (UINT32)m_vctJobs.size();
+}
+
+//////////////////////////////////////////////////////////////////////////
+
+HRESULT SdkImageBatchConverter::GetJobResult(IN UINT32 uIndex) const
+{
+    if ( uIndex >= m_vctJobs.size() )
+    {
+        return E_INVALIDARG;
+    }
+
+    return m_vctJobs[uIndex]->hrResult;
+}
+
+//////////////////////////////////////////////////////////////////////////
+
+void SdkImageBatchConverter::SetFilter(IN PIXEL_RESIZE_FILTER filter)
+{
+    m_filter = filter;
+}
+
+//////////////////////////////////////////////////////////////////////////
+
+BOOL SdkImageBatchConverter::Run(IN UINT32 uThreadCount, IN UINT64 uMemoryBudget)
+{
+    LARGE_INTEGER liStart = { 0 };
+    QueryPerformanceCounter(&liStart);
+
+    for (vector<LPIMAGEBATCHJOB>::iterator itor = m_vctJobs.begin(); itor != m_vctJobs.end(); ++itor)
+    {
+        (*itor)->hrResult = E_PENDING;
+    }
+
+    ZeroMemory(&m_stats, sizeof(m_stats));
+    m_lstDecodeQueue.clear();
+    m_lstResizeQueue.clear();
+    m_lstEncodeQueue.clear();
+    m_uNextOpen      = 0;
+    m_uActiveCount   = 0;
+    m_uBudget        = uMemoryBudget;
+    m_uBytesInFlight = 0;
+    InterlockedExchange(&m_lCancelled, 0);
+
+    if ( 0 == uThreadCount )
+    {
+        SYSTEM_INFO sysInfo = { 0 };
+        GetSystemInfo(&sysInfo);
+        uThreadCount = sysInfo.dwNumberOfProcessors;
+    }
+
+    uThreadCount = MIN(uThreadCount, (UINT32)MAX_IMAGE_BATCH_THREADS);
+    uThreadCount = MIN(uThreadCount, (UINT32)m_vctJobs.size());
+
+    HANDLE hThreads[MAX_IMAGE_BATCH_THREADS] = { 0 };
+    DWORD dwThreadCount = 0;
+    for (UINT32 i = 0; i < uThreadCount; ++i)
+    {
+        HANDLE hThread = (HANDLE)_beginthreadex(NULL, 0, WorkThreadProc, this, 0, NULL);
+        if ( NULL != hThread )
+        {
+            hThreads[dwThreadCount++] = hThread;
+        }
+    }
+
+    if ( dwThreadCount > 0 )
+    {
+        WaitForMultipleObjects(dwThreadCount, hThreads, TRUE, INFINITE);
+        for (DWORD i = 0; i < dwThreadCount; ++i)
+        {
+            CloseHandle(hThreads[i]);
+        }
+    }
+    else
+    {
+        // No thread can be created, the jobs run on the caller thread.
+        WorkJobs();
+    }
+
+    m_stats.uElapsedTime = GetElapsedTime(liStart);
+
+    return (0 == m_stats.uFailed) ? TRUE : FALSE;
+}
+
+//////////////////////////////////////////////////////////////////////////
+
+void SdkImageBatchConverter::Cancel()
+{
+    InterlockedExchange(&m_lCancelled, 1);
+
+    EnterCriticalSection(&m_csLock);
+    WakeAllConditionVariable(&m_cvChanged);
+    LeaveCriticalSection(&m_csLock);
+}
+
+//////////////////////////////////////////////////////////////////////////
+
+void SdkImageBatchConverter::GetStats(OUT LPIMAGEBATCHSTATS pStats) const
+{
+    if ( NULL != pStats )
+    {
+        *pStats = m_stats;
+    }
+}
+
+//////////////////////////////////////////////////////////////////////////
+
+unsigned int WINAPI SdkImageBatchConverter::WorkThreadProc(LPVOID lpParameter)
+{
+    SdkImageBatchConverter *pThis = static_cast<SdkImageBatchConverter*>(lpParameter);
+
+    HRESULT hr = CoInitializeEx(NULL, COINIT_MULTITHREADED);
+    pThis->WorkJobs();
+    if ( SUCCEEDED(hr) )
+    {
+        CoUninitialize();
+    }
+
+    return 0;
+}
+
+//////////////////////////////////////////////////////////////////////////
+
+void SdkImageBatchConverter::WorkJobs()
+{
+    EnterCriticalSection(&m_csLock);
+
+    for (;;)
+    {
+        if ( 0 != m_lCancelled )
+        {
+            // The queued jobs are dropped, the jobs in the stages are finished by their threads.
+            while ( !m_lstEncodeQueue.empty() )
+            {
+                FinishJob(m_lstEncodeQueue.front(), E_ABORT);
+                m_lstEncodeQueue.pop_front();
+            }
+            while ( !m_lstResizeQueue.empty() )
+            {
+                FinishJob(m_lstResizeQueue.front(), E_ABORT);
+                m_lstResizeQueue.pop_front();
+            }
+            while ( !m_lstDecodeQueue.empty() )
+            {
+                FinishJob(m_lstDecodeQueue.front(), E_ABORT);
+                m_lstDecodeQueue.pop_front();
+            }
+            while ( m_uNextOpen < m_vctJobs.size() )
+            {
+                FinishJob(m_vctJobs[m_uNextOpen++], E_ABORT);
+            }
+        }
+
+        // The later stage is taken first, so the pixels in flight are written out. A job is
+        // decoded when its bytes are reserved, a new image is opened only when no opened job
+        // is waiting for the budget.
+        LPIMAGEBATCHJOB lpJob = NULL;
+        int nStage = 0;
+        if ( !m_lstEncodeQueue.empty() )
+        {
+            lpJob = m_lstEncodeQueue.front();
+            m_lstEncodeQueue.pop_front();
+            nStage = 3;
+        }
+        else if ( !m_lstResizeQueue.empty() )
+        {
+            lpJob = m_lstResizeQueue.front();
+            m_lstResizeQueue.pop_front();
+            nStage = 2;
+        }
+        else if ( NULL != (lpJob = ReserveDecodeJob()) )
+        {
+            nStage = 1;
+        }
+        else if ( m_lstDecodeQueue.empty() && (m_uNextOpen < m_vctJobs.size()) )
+        {
+            lpJob = m_vctJobs[m_uNextOpen++];
+            nStage = 0;
+        }
+        else if ( m_lstDecodeQueue.empty() && (m_uNextOpen >= m_vctJobs.size()) && (0 == m_uActiveCount) )
+        {
+            break;
+        }
+        else
+        {
+            SleepConditionVariableCS(&m_cvChanged, &m_csLock, INFINITE);
+            continue;
+        }
+
+        ++m_uActiveCount;
+        LeaveCriticalSection(&m_csLock);
+
+        LARGE_INTEGER liStart = { 0 };
+        QueryPerformanceCounter(&liStart);
+
+        HRESULT hr = S_OK;
+        switch (nStage)
+        {
+        case 0:
+            hr = OpenJob(lpJob);
+            break;
+
+        case 1:
+            hr = DecodeJob(lpJob);
+            break;
+
+        case 2:
+            hr = ResizeJob(lpJob);
+            break;
+
+        default:
+            hr = EncodeJob(lpJob);
+            break;
+        }
+
+        UINT64 uTime = GetElapsedTime(liStart);
+
+        EnterCriticalSection(&m_csLock);
+        --m_uActiveCount;
+
+        switch (nStage)
+        {
+        case 0:
+        case 1:
+            m_stats.uDecodeTime += uTime;
+            break;
+
+        case 2:
+            m_stats.uResizeTime += uTime;
+            break;
+
+        default:
+            m_stats.uEncodeTime += uTime;
+            break;
+        }
+
+        // A failed job gives back the bytes which are reserved for it.
+        if ( FAILED(hr) || (3 == nStage) )
+        {
+            FinishJob(lpJob, hr);
+        }
+        else if ( 0 == nStage )
+        {
+            m_lstDecodeQueue.push_back(lpJob);
+        }
+        else if ( 1 == nStage )
+        {
+            m_lstResizeQueue.push_back(lpJob);
+        }
+        else
+        {
+            // The decoded image is released, only the resized pixels stay in flight.
+            UINT64 uBytes = lpJob->vctPixels.size();
+            m_uBytesInFlight = m_uBytesInFlight - lpJob->uBytes + uBytes;
+            lpJob->uBytes = uBytes;
+            m_lstEncodeQueue.push_back(lpJob);
+        }
+
+        WakeAllConditionVariable(&m_cvChanged);
+    }
+
+    LeaveCriticalSection(&m_csLock);
+}
+
+//////////////////////////////////////////////////////////////////////////
+
+HRESULT SdkImageBatchConverter::OpenJob(IN OUT LPIMAGEBATCHJOB lpJob)
+{
+    if ( (UINT)lpJob->saveType >= ARRAYSIZE(g_batchFormats) )
+    {
+        return E_INVALIDARG;
+    }
+
+    if ( NULL == g_batchFormats[lpJob->saveType].pContainer )
+    {
+        return WINCODEC_ERR_COMPONENTNOTFOUND;
+    }
+
+    // Only the header is read here, the pixels are decoded by DecodeJob.
+    SdkWICImageHelper imageHelper;
+    if ( !imageHelper.LoadReducedFromFile(lpJob->strSource.c_str(), lpJob->uMaxWidth, lpJob->uMaxHeight,
+                                          &lpJob->uDestWidth, &lpJob->uDestHeight) )
+    {
+        return E_FAIL;
+    }
+
+    imageHelper.GetFormatConverter(&lpJob->pOpened);
+    if ( NULL == lpJob->pOpened )
+    {
+        return E_FAIL;
+    }
+
+    return lpJob->pOpened->GetSize(&lpJob->uSrcWidth, &lpJob->uSrcHeight);
+}
+
+//////////////////////////////////////////////////////////////////////////
+
+HRESULT SdkImageBatchConverter::DecodeJob(IN OUT LPIMAGEBATCHJOB lpJob)
+{
+    SdkWICImageHelper imageHelper;
+    BOOL isLoaded = imageHelper.LoadFromWICBitmap(lpJob->pOpened);
+    SAFE_RELEASE(lpJob->pOpened);
+    if ( !isLoaded )
+    {
+        return E_FAIL;
+    }
+
+    return imageHelper.DecodeToBitmap(&lpJob->pDecoded);
+}
+
+//////////////////////////////////////////////////////////////////////////
+
+HRESULT SdkImageBatchConverter::ResizeJob(IN OUT LPIMAGEBATCHJOB lpJob)
+{
+    WICRect rcLock = { 0, 0, (INT)lpJob->uSrcWidth, (INT)lpJob->uSrcHeight };
+    IWICBitmapLock *pLock = NULL;
+    HRESULT hr = lpJob->pDecoded->Lock(&rcLock, WICBitmapLockRead, &pLock);
+
+    UINT uSrcStride = 0;
+    UINT uBufferSize = 0;
+    BYTE *pSrc = NULL;
+    if ( SUCCEEDED(hr) )
+    {
+        hr = pLock->GetStride(&uSrcStride);
+    }
+    if ( SUCCEEDED(hr) )
+    {
+        hr = pLock->GetDataPointer(&uBufferSize, &pSrc);
+    }
+
+    if ( SUCCEEDED(hr) )
+    {
+        UINT uDestStride = lpJob->uDestWidth * 4;
+        lpJob->vctPixels.resize((size_t)uDestStride * lpJob->uDestHeight);
+
+        if ( (lpJob->uSrcWidth == lpJob->uDestWidth) && (lpJob->uSrcHeight == lpJob->uDestHeight) )
+        {
+            for (UINT32 y = 0; y < lpJob->uDestHeight; ++y)
+            {
+                memcpy(&lpJob->vctPixels[(size_t)y * uDestStride], pSrc + (size_t)y * uSrcStride, uDestStride);
+            }
+        }
+        else if ( !SdkPixelKernels::ResizeImage(pSrc, lpJob->uSrcWidth, lpJob->uSrcHeight, uSrcStride,
+                                                &lpJob->vctPixels[0], lpJob->uDestWidth, lpJob->uDestHeight,
+                                                uDestStride, m_filter) )
+        {
+            hr = E_OUTOFMEMORY;
+        }
+
+        if ( SUCCEEDED(hr) )
+        {
+            // The encoders take the straight alpha.
+            SdkPixelKernels::UnpremultiplyAlpha((UINT32*)&lpJob->vctPixels[0],
+                                                (size_t)lpJob->uDestWidth * lpJob->uDestHeight);
+        }
+    }
+
+    SAFE_RELEASE(pLock);
+    SAFE_RELEASE(lpJob->pDecoded);
+
+    return hr;
+}
+
+//////////////////////////////////////////////////////////////////////////
+
+HRESULT SdkImageBatchConverter::EncodeJob(IN OUT LPIMAGEBATCHJOB lpJob)
+{
+    WCHAR szFolderPath[MAX_PATH] = { 0 };
+    wcscpy_s(szFolderPath, MAX_PATH, lpJob->strTarget.c_str());
+    PathRemoveFileSpec(szFolderPath);
+
+    // The folder does not exist, create it.
+    if ( (0 != wcslen(szFolderPath)) && (FALSE == PathFileExists(szFolderPath)) )
+    {
+        SHCreateDirectory(NULL, szFolderPath);
+    }
+
+    WCHAR szFilePath[MAX_PATH] = { 0 };
+    wcscpy_s(szFilePath, MAX_PATH, lpJob->strTarget.c_str());
+    // The file has no extension
+    if ( 0 == wcslen(PathFindExtension(szFilePath)) )
+    {
+        PathAddExtension(szFilePath, g_batchFormats[lpJob->saveType].lpExtension);
+    }
+
+    return SdkWICImageHelper::SavePixelsToFile(szFilePath, *g_batchFormats[lpJob->saveType].pContainer,
+                                               &lpJob->vctPixels[0], lpJob->uDestWidth, lpJob->uDestHeight,
+                                               lpJob->uDestWidth * 4);
+}
+
+//////////////////////////////////////////////////////////////////////////
+
+void SdkImageBatchConverter::FinishJob(IN OUT LPIMAGEBATCHJOB lpJob, IN HRESULT hr)
+{
+    SAFE_RELEASE(lpJob->pOpened);
+    SAFE_RELEASE(lpJob->pDecoded);
+    vector<BYTE>().swap(lpJob->vctPixels);
+
+    m_uBytesInFlight -= lpJob->uBytes;
+    lpJob->uBytes = 0;
+    lpJob->hrResult = hr;
+
+    if ( SUCCEEDED(hr) )
+    {
+        ++m_stats.uSucceeded;
+    }
+    else
+    {
+        ++m_stats.uFailed;
+    }
+}
+
+//////////////////////////////////////////////////////////////////////////
+
+LPIMAGEBATCHJOB SdkImageBatchConverter::ReserveDecodeJob()
+{
+    for (list<LPIMAGEBATCHJOB>::iterator itor = m_lstDecodeQueue.begin(); itor != m_lstDecodeQueue.end(); ++itor)
+    {
+        // The decoded image and the resized pixels are alive together while resizing.
+        LPIMAGEBATCHJOB lpJob = *itor;
+        UINT64 uBytes = ((UINT64)lpJob->uSrcWidth * lpJob->uSrcHeight +
+                         (UINT64)lpJob->uDestWidth * lpJob->uDestHeight) * 4;
+
+        if ( (0 == m_uBytesInFlight) || (m_uBytesInFlight + uBytes <= m_uBudget) )
+        {
+            m_lstDecodeQueue.erase(itor);
+            lpJob->uBytes = uBytes;
+            m_uBytesInFlight += uBytes;
+            m_stats.uPeakBytes = MAX(m_stats.uPeakBytes, m_uBytesInFlight);
+            return lpJob;
+        }
+    }
+
+    return NULL;
+}
+
+//////////////////////////////////////////////////////////////////////////
+
+UINT64 SdkImageBatchConverter::GetElapsedTime(IN const LARGE_INTEGER& liStart) const
+{
+    LARGE_INTEGER liNow = { 0 };
+    QueryPerformanceCounter(&liNow);
+
+    if ( 0 == m_liFrequency.QuadPart )
+    {
+        return 0;
+    }
+
+    return (UINT64)(liNow.QuadPart - liStart.QuadPart) * 1000000 / m_liFrequency.QuadPart;
+}
@@ -0,0 +1,602 @@
+/*!
+* @file SdkImageDecodeService.cpp
+*
+* @brief This file defines SdkImageDecodeService class to decode images in the background.
+*
+* Copyright (C) 2011, LZT Corporation.
+*
+* @author Li Hong
+* @date 2011/06/30
+*/
+
+#include "stdafx.h"
+#include "SdkImageDecodeService.h"
+#include "SdkWICImageHelper.h"
+#include <process.h>
+#include <algorithm>
+
+USING_NAMESPACE_UTILITIES
+
+#define IMAGEDECODESERVICECLASSNAME     L"SdkImageDecodeService"
+#define WM_IMAGEDECODED                 (WM_USER + 1)   // wParam is the request id.
+#define WM_IMAGEPREVIEWED               (WM_USER + 2)   // wParam is the request id.
+
+
+/*!
+* @brief One decode request.
+*/
+struct NAMESPACE_UTILITIES::_IMAGEDECODEREQUEST
+{
+    DWORD                   dwRequestId;                // The request id.
+    UINT32                  uSequence;                  // The order of the request in the same priority.
+    IMAGE_DECODE_PRIORITY   priority;                   // The priority.
+    BOOL                    isCancelled;                // The request is cancelled while decoding or posted.
+    BOOL                    isQueued;                   // The request is waiting in the queue.
+    wstring                 strFile;                    // The image file path.
+    UINT32                  uDestWidth;                 // The target width.
+    UINT32                  uDestHeight;                // The target height.
+    IImageDecodeNotify     *pNotify;                    // The notify.
+    BOOL                    isProgressive;              // Decode a preview before the full image.
+    IWICBitmap             *pPreviewBitmap;             // The preview which is posted and not dispatched.
+    UINT32                  uFullWidth;                 // The width of the full image of the preview.
+    UINT32                  uFullHeight;                // The height of the full image of the preview.
+    IMAGEDECODERESULT       result;                     // The result.
+};
+
+
+/*!
+* @brief The lock of the service is created when the module is loaded.
+*/
+class NAMESPACE_UTILITIES::SdkImageDecodeServiceLock
+{
+public:
+
+    SdkImageDecodeServiceLock()
+    {
+        InitializeCriticalSection(&SdkImageDecodeService::s_csLock);
+    }
+
+    ~SdkImageDecodeServiceLock()
+    {
+        DeleteCriticalSection(&SdkImageDecodeService::s_csLock);
+    }
+};
+
+
+CRITICAL_SECTION                        SdkImageDecodeService::s_csLock;
+BOOL                                    SdkImageDecodeService::s_hasRegClass = FALSE;
+HWND                                    SdkImageDecodeService::s_hNotifyWnd = NULL;
+HANDLE                                  SdkImageDecodeService::s_hQueueSemaphore = NULL;
+BOOL                                    SdkImageDecodeService::s_isStopping = FALSE;
+DWORD                                   SdkImageDecodeService::s_dwNextRequestId = 1;
+UINT32                                  SdkImageDecodeService::s_uNextSequence = 0;
+vector<HANDLE>                          SdkImageDecodeService::s_vctThreads;
+vector<LPIMAGEDECODEREQUEST>            SdkImageDecodeService::s_vctQueue;
+map<DWORD, LPIMAGEDECODEREQUEST>        SdkImageDecodeService::s_mapRequests;
+
+// It must be defined after the static members, it uses them when it is constructed.
+static SdkImageDecodeServiceLock        g_imageDecodeServiceLock;
+
+
+/*!
+* @brief The order of the heap, the request of the smaller priority value is on the top,
+*        the earlier request is on the top in the same priority.
+*/
+static bool DecodeRequestLater(LPIMAGEDECODEREQUEST lpFirst, LPIMAGEDECODEREQUEST lpSecond)
+{
+    if (lpFirst->priority != lpSecond->priority)
+    {
+        return (lpFirst->priority > lpSecond->priority);
+    }
+
+    return (lpFirst->uSequence > lpSecond->uSequence);
+}
+
+
+//////////////////////////////////////////////////////////////////////////
+
+BOOL SdkImageDecodeService::Initialize(IN UINT32 uThreadCount)
+{
+    if (NULL != s_hNotifyWnd)
+    {
+        return TRUE;
+    }
+
+    if ( !s_hasRegClass )
+    {
+        WNDCLASSEX wcex = { 0 };
+        wcex.cbSize         = sizeof(WNDCLASSEX);
+        wcex.lpfnWndProc    = SdkImageDecodeService::WndProc;
+        wcex.hInstance      = HINST_THISCOMPONENT;
+        wcex.lpszClassName  = IMAGEDECODESERVICECLASSNAME;
+
+        if ( !RegisterClassEx(&wcex) )
+        {
+            return FALSE;
+        }
+
+        s_hasRegClass = TRUE;
+    }
+
+    // The message-only window receives the results in the thread which calls this function.
+    s_hNotifyWnd = CreateWindowEx(0, IMAGEDECODESERVICECLASSNAME, NULL, 0, 0, 0, 0, 0,
+                                  HWND_MESSAGE, NULL, HINST_THISCOMPONENT, NULL);
+    s_hQueueSemaphore = CreateSemaphore(NULL, 0, LONG_MAX, NULL);
+    if ( (NULL == s_hNotifyWnd) || (NULL == s_hQueueSemaphore) )
+    {
+        Uninitialize();
+        return FALSE;
+    }
+
+    if (0 == uThreadCount)
+    {
+        // Leave one processor for the window thread.
+        SYSTEM_INFO sysInfo = { 0 };
+        GetSystemInfo(&sysInfo);
+        uThreadCount = (sysInfo.dwNumberOfProcessors > 1) ? (sysInfo.dwNumberOfProcessors - 1) : 1;
+    }
+    uThreadCount = min(uThreadCount, (UINT32)MAX_IMAGE_DECODE_THREADS);
+
+    s_isStopping = FALSE;
+    for (UINT32 i = 0; i < uThreadCount; ++i)
+    {
+        unsigned int dwThreadId = 0;
+        HANDLE hThread = (HANDLE)_beginthreadex(
+            NULL,
+            0,
+            SdkImageDecodeService::DecodeThreadProc,
+            NULL,
+            0,
+            &dwThreadId);
+
+        if (NULL != hThread)
+        {
+            s_vctThreads.push_back(hThread);
+        }
+    }
+
+    if (s_vctThreads.empty())
+    {
+        Uninitialize();
+        return FALSE;
+    }
+
+    return TRUE;
+}
+
+//////////////////////////////////////////////////////////////////////////
+
+void SdkImageDecodeService::Uninitialize()
+{
+    EnterCriticalSection(&s_csLock);
+    s_isStopping = TRUE;
+    LeaveCriticalSection(&s_csLock);
+
+    if ( !s_vctThreads.empty() )
+    {
+        // Each thread takes one count and exits, the decoding images are finished first.
+        ReleaseSemaphore(s_hQueueSemaphore, (LONG)s_vctThreads.size(), NULL);
+        WaitForMultipleObjects((DWORD)s_vctThreads.size(), &s_vctThreads[0], TRUE, INFINITE);
+
+        for (vector<HANDLE>::iterator iter = s_vctThreads.begin(); iter != s_vctThreads.end(); ++iter)
+        {
+            CloseHandle(*iter);
+        }
+        s_vctThreads.clear();
+    }
+
+    EnterCriticalSection(&s_csLock);
+
+    for (map<DWORD, LPIMAGEDECODEREQUEST>::iterator iter = s_mapRequests.begin(); iter != s_mapRequests.end(); ++iter)
+    {
+        DestroyRequest(iter->second);
+    }
+    s_mapRequests.clear();
+    s_vctQueue.clear();
+
+    LeaveCriticalSection(&s_csLock);
+
+    // The posted results are removed with the window.
+    if (NULL != s_hNotifyWnd)
+    {
+        DestroyWindow(s_hNotifyWnd);
+        s_hNotifyWnd = NULL;
+    }
+
+    if (NULL != s_hQueueSemaphore)
+    {
+        CloseHandle(s_hQueueSemaphore);
+        s_hQueueSemaphore = NULL;
+    }
+}
+
+//////////////////////////////////////////////////////////////////////////
+
+BOOL SdkImageDecodeService::IsRunning()
+{
+    return (NULL != s_hNotifyWnd) && !s_vctThreads.empty();
+}
+
+//////////////////////////////////////////////////////////////////////////
+
+DWORD SdkImageDecodeService::DecodeFile(IN LPCWSTR lpFile, IN UINT32 uDestWidth, IN UINT32 uDestHeight,
+                                        IN IMAGE_DECODE_PRIORITY priority, IN IImageDecodeNotify *pNotify,
+                                        IN BOOL isProgressive)
+{
+    if ( (NULL == lpFile) || (NULL == pNotify) || !IsRunning() )
+    {
+        return 0;
+    }
+
+    LPIMAGEDECODEREQUEST lpRequest = new IMAGEDECODEREQUEST();
+    lpRequest->priority    = priority;
+    lpRequest->isCancelled = FALSE;
+    lpRequest->isQueued    = TRUE;
+    lpRequest->strFile     = lpFile;
+    lpRequest->uDestWidth  = uDestWidth;
+    lpRequest->uDestHeight = uDestHeight;
+    lpRequest->pNotify     = pNotify;
+    lpRequest->isProgressive  = isProgressive;
+    lpRequest->pPreviewBitmap = NULL;
+    lpRequest->uFullWidth     = 0;
+    lpRequest->uFullHeight    = 0;
+    ZeroMemory(&lpRequest->result, sizeof(IMAGEDECODERESULT));
+
+    EnterCriticalSection(&s_csLock);
+
+    // The id 0 means no request.
+    if (0 == s_dwNextRequestId)
+    {
+        s_dwNextRequestId = 1;
+    }
+    lpRequest->dwRequestId = s_dwNextRequestId++;
+    lpRequest->uSequence   = s_uNextSequence++;
+
+    s_vctQueue.push_back(lpRequest);
+    push_heap(s_vctQueue.begin(), s_vctQueue.end(), DecodeRequestLater);
+    s_mapRequests[lpRequest->dwRequestId] = lpRequest;
+
+    DWORD dwRequestId = lpRequest->dwRequestId;
+
+    LeaveCriticalSection(&s_csLock);
+
+    ReleaseSemaphore(s_hQueueSemaphore, 1, NULL);
+
+    return dwRequestId;
+}
+
+//////////////////////////////////////////////////////////////////////////
+
+BOOL SdkImageDecodeService::SetPriority(IN DWORD dwRequestId, IN IMAGE_DECODE_PRIORITY priority)
+{
+    BOOL isChanged = FALSE;
+
+    EnterCriticalSection(&s_csLock);
+
+    map<DWORD, LPIMAGEDECODEREQUEST>::iterator iter = s_mapRequests.find(dwRequestId);
+    if ( (iter != s_mapRequests.end()) && iter->second->isQueued )
+    {
+        if (iter->second->priority != priority)
+        {
+            iter->second->priority = priority;
+            make_heap(s_vctQueue.begin(), s_vctQueue.end(), DecodeRequestLater);
+        }
+        isChanged = TRUE;
+    }
+
+    LeaveCriticalSection(&s_csLock);
+
+    return isChanged;
+}
+
+//////////////////////////////////////////////////////////////////////////
+
+void SdkImageDecodeService::Cancel(IN DWORD dwRequestId)
+{
+    if (0 == dwRequestId)
+    {
+        return;
+    }
+
+    EnterCriticalSection(&s_csLock);
+
+    map<DWORD, LPIMAGEDECODEREQUEST>::iterator iter = s_mapRequests.find(dwRequestId);
+    if (iter != s_mapRequests.end())
+    {
+        LPIMAGEDECODEREQUEST lpRequest = iter->second;
+        if ( RemoveQueuedRequest(lpRequest) )
+        {
+            s_mapRequests.erase(iter);
+            DestroyRequest(lpRequest);
+        }
+        else
+        {
+            // The decode thread or the window deletes it.
+            lpRequest->isCancelled = TRUE;
+        }
+    }
+
+    LeaveCriticalSection(&s_csLock);
+}
+
+//////////////////////////////////////////////////////////////////////////
+
+void SdkImageDecodeService::CancelAll(IN IImageDecodeNotify *pNotify)
+{
+    EnterCriticalSection(&s_csLock);
+
+    map<DWORD, LPIMAGEDECODEREQUEST>::iterator iter = s_mapRequests.begin();
+    while (iter != s_mapRequests.end())
+    {
+        LPIMAGEDECODEREQUEST lpRequest = iter->second;
+        if (lpRequest->pNotify != pNotify)
+        {
+            ++iter;
+        }
+        else if ( RemoveQueuedRequest(lpRequest) )
+        {
+            s_mapRequests.erase(iter++);
+            DestroyRequest(lpRequest);
+        }
+        else
+        {
+            lpRequest->isCancelled = TRUE;
+            ++iter;
+        }
+    }
+
+    LeaveCriticalSection(&s_csLock);
+}
+
+//////////////////////////////////////////////////////////////////////////
+
+unsigned int WINAPI SdkImageDecodeService::DecodeThreadProc(LPVOID lpParameter)
+{
+    UNREFERENCED_PARAMETER(lpParameter);
+
+    // The threads share the free threaded WIC factory of SdkWICImageHelper, they should
+    // not call WICInitialize or WICUninitialize.
+    CoInitializeEx(NULL, COINIT_MULTITHREADED);
+
+    for (;;)
+    {
+        WaitForSingleObject(s_hQueueSemaphore, INFINITE);
+
+        EnterCriticalSection(&s_csLock);
+
+        if (s_isStopping)
+        {
+            LeaveCriticalSection(&s_csLock);
+            break;
+        }
+
+        // The count of a cancelled request is left, the queue may be empty.
+        LPIMAGEDECODEREQUEST lpRequest = NULL;
+        if ( !s_vctQueue.empty() )
+        {
+            pop_heap(s_vctQueue.begin(), s_vctQueue.end(), DecodeRequestLater);
+            lpRequest = s_vctQueue.back();
+            lpRequest->isQueued = FALSE;
+            s_vctQueue.pop_back();
+        }
+
+        LeaveCriticalSection(&s_csLock);
+
+        if (NULL == lpRequest)
+        {
+            continue;
+        }
+
+        DecodeRequest(lpRequest);
+
+        EnterCriticalSection(&s_csLock);
+
+        BOOL isPosted = FALSE;
+        if ( !lpRequest->isCancelled )
+        {
+            isPosted = PostMessage(s_hNotifyWnd, WM_IMAGEDECODED, (WPARAM)lpRequest->dwRequestId, 0);
+        }
+
+        if ( !isPosted )
+        {
+            s_mapRequests.erase(lpRequest->dwRequestId);
+            DestroyRequest(lpRequest);
+        }
+
+        LeaveCriticalSection(&s_csLock);
+    }
+
+    CoUninitialize();
+
+    return 0;
+}
+
+//////////////////////////////////////////////////////////////////////////
+
+LRESULT CALLBACK SdkImageDecodeService::WndProc(HWND hWnd, UINT message, WPARAM wParam, LPARAM lParam)
+{
+    if (WM_IMAGEDECODED == message)
+    {
+        DispatchResult((DWORD)wParam);
+        return 0;
+    }
+
+    if (WM_IMAGEPREVIEWED == message)
+    {
+        DispatchPreview((DWORD)wParam);
+        return 0;
+    }
+
+    return DefWindowProc(hWnd, message, wParam, lParam);
+}
+
+//////////////////////////////////////////////////////////////////////////
+
+void SdkImageDecodeService::DecodeRequest(IN OUT LPIMAGEDECODEREQUEST lpRequest)
+{
+    LPIMAGEDECODERESULT lpResult = &lpRequest->result;
+    lpResult->dwRequestId = lpRequest->dwRequestId;
+    lpResult->lpFile      = lpRequest->strFile.c_str();
+    lpResult->hrDecode    = E_FAIL;
+
+    // The request may be cancelled while it is taken from the queue.
+    if (lpRequest->isCancelled)
+    {
+        lpResult->hrDecode = E_ABORT;
+        return;
+    }
+
+    SdkWICImageHelper imageHelper;
+
+    // The preview is decoded only if the codec can reduce the image natively, such as
+    // 1/8 of a JPEG, so it costs a small part of the full image and is shown at once.
+    IWICBitmap *pPreviewBitmap = NULL;
+    UINT32 uFullWidth  = 0;
+    UINT32 uFullHeight = 0;
+    if ( lpRequest->isProgressive &&
+         imageHelper.LoadPreviewFromFile(lpResult->lpFile, lpRequest->uDestWidth, lpRequest->uDestHeight,
+                                         &uFullWidth, &uFullHeight) &&
+         SUCCEEDED(imageHelper.DecodeToBitmap(&pPreviewBitmap)) )
+    {
+        EnterCriticalSection(&s_csLock);
+
+        if ( !lpRequest->isCancelled && (NULL == lpRequest->pPreviewBitmap) &&
+             PostMessage(s_hNotifyWnd, WM_IMAGEPREVIEWED, (WPARAM)lpRequest->dwRequestId, 0) )
+        {
+            lpRequest->pPreviewBitmap = pPreviewBitmap;
+            lpRequest->uFullWidth     = uFullWidth;
+            lpRequest->uFullHeight    = uFullHeight;
+            pPreviewBitmap = NULL;
+        }
+
+        LeaveCriticalSection(&s_csLock);
+
+        SAFE_RELEASE(pPreviewBitmap);
+        imageHelper.ClearImageData();
+    }
+
+    if (lpRequest->isCancelled)
+    {
+        lpResult->hrDecode = E_ABORT;
+        return;
+    }
+
+    // The file is decoded through the image cache, the same file shown by several
+    // views is decoded only once.
+    if ( imageHelper.LoadFromFile(lpResult->lpFile, lpRequest->uDestWidth, lpRequest->uDestHeight) )
+    {
+        lpResult->hrDecode    = imageHelper.DecodeToBitmap(&lpResult->pBitmap);
+        lpResult->uFrameCount = SdkWICImageHelper::GetFrameCount(lpResult->lpFile);
+        if ( SUCCEEDED(lpResult->hrDecode) )
+        {
+            lpResult->pBitmap->GetSize(&lpResult->uWidth, &lpResult->uHeight);
+        }
+    }
+}
+
+//////////////////////////////////////////////////////////////////////////
+
+void SdkImageDecodeService::DispatchResult(IN DWORD dwRequestId)
+{
+    LPIMAGEDECODEREQUEST lpRequest = NULL;
+
+    EnterCriticalSection(&s_csLock);
+
+    map<DWORD, LPIMAGEDECODEREQUEST>::iterator iter = s_mapRequests.find(dwRequestId);
+    if (iter != s_mapRequests.end())
+    {
+        lpRequest = iter->second;
+        s_mapRequests.erase(iter);
+    }
+
+    LeaveCriticalSection(&s_csLock);
+
+    if (NULL == lpRequest)
+    {
+        return;
+    }
+
+    // The notify is called without the lock, so it can add or cancel requests.
+    if ( !lpRequest->isCancelled && (NULL != lpRequest->pNotify) )
+    {
+        lpRequest->pNotify->OnImageDecoded(&lpRequest->result);
+    }
+
+    DestroyRequest(lpRequest);
+}
+
+//////////////////////////////////////////////////////////////////////////
+
+void SdkImageDecodeService::DispatchPreview(IN DWORD dwRequestId)
+{
+    IMAGEDECODERESULT result;
+    ZeroMemory(&result, sizeof(IMAGEDECODERESULT));
+    IImageDecodeNotify *pNotify = NULL;
+    wstring strFile;
+
+    EnterCriticalSection(&s_csLock);
+
+    // The request stays in the map, the full image is dispatched later.
+    map<DWORD, LPIMAGEDECODEREQUEST>::iterator iter = s_mapRequests.find(dwRequestId);
+    if (iter != s_mapRequests.end())
+    {
+        LPIMAGEDECODEREQUEST lpRequest = iter->second;
+        result.pBitmap = lpRequest->pPreviewBitmap;
+        result.uWidth  = lpRequest->uFullWidth;
+        result.uHeight = lpRequest->uFullHeight;
+        lpRequest->pPreviewBitmap = NULL;
+        if ( !lpRequest->isCancelled )
+        {
+            pNotify = lpRequest->pNotify;
+            strFile = lpRequest->strFile;
+        }
+    }
+
+    LeaveCriticalSection(&s_csLock);
+
+    if ( (NULL != pNotify) && (NULL != result.pBitmap) )
+    {
+        result.dwRequestId = dwRequestId;
+        result.lpFile      = strFile.c_str();
+        result.hrDecode    = S_OK;
+        result.uFrameCount = 1;
+        result.isPreview   = TRUE;
+        pNotify->OnImageDecoded(&result);
+    }
+
+    SAFE_RELEASE(result.pBitmap);
+}
+
+//////////////////////////////////////////////////////////////////////////
+
+BOOL SdkImageDecodeService::RemoveQueuedRequest(IN LPIMAGEDECODEREQUEST lpRequest)
+{
+    if ( !lpRequest->isQueued )
+    {
+        return FALSE;
+    }
+
+    vector<LPIMAGEDECODEREQUEST>::iterator iter = find(s_vctQueue.begin(), s_vctQueue.end(), lpRequest);
+    if (iter == s_vctQueue.end())
+    {
+        return FALSE;
+    }
+
+    s_vctQueue.erase(iter);
+    make_heap(s_vctQueue.begin(), s_vctQueue.end(), DecodeRequestLater);
+    lpRequest->isQueued = FALSE;
+
+    return TRUE;
+}
+
+//////////////////////////////////////////////////////////////////////////
+
+void SdkImageDecodeService::DestroyRequest(IN LPIMAGEDECODEREQUEST lpRequest)
+{
+    if (NULL != lpRequest)
+    {
+        SAFE_RELEASE(lpRequest->result.pBitmap);
+        SAFE_RELEASE(lpRequest->pPreviewBitmap);
+        delete lpRequest;
+    }
+}
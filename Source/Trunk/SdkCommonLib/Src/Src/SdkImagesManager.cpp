@@ -29,6 +29,65 @@ const LPWSTR g_szImageFormat[] =
     L"image/x-icon",
 };
 
+/*!
+* @brief The image encoder of GDI+.
+*/
+typedef struct _IMAGEENCODERINFO
+{
+    wstring     strMimeType;                            // The MIME type, such as image/png.
+    CLSID       clsid;                                  // The CLSID of the encoder.
+    wstring     strExtension;                           // The first file extension, such as *.PNG.
+
+} IMAGEENCODERINFO;
+
+/*!
+* @brief The encoders found when GDI+ is initialized, so saving an image does not scan
+*        the encoders of GDI+ every time.
+*/
+static vector<IMAGEENCODERINFO> g_vctImageEncoders;
+
+/*!
+* @brief Get the image encoders of GDI+.
+*/
+static void LoadImageEncoders(OUT vector<IMAGEENCODERINFO>& vctEncoders)
+{
+    UINT numEncoders = 0;                   // number of image encoders
+    UINT size = 0;                          // size, in bytes, of the image encoder array
+
+    vctEncoders.clear();
+
+    // How many encoders are there? How big (in bytes) is the array of all ImageCodecInfo objects?
+    GetImageEncodersSize(&numEncoders, &size);
+    if ( (0 == size) || (0 == numEncoders) )
+    {
+        return;
+    }
+
+    ImageCodecInfo* pImageCodecInfo = (ImageCodecInfo*)malloc(size);
+    if ( (NULL != pImageCodecInfo) &&
+         (Gdiplus::Ok == GetImageEncoders(numEncoders, size, pImageCodecInfo)) )
+    {
+        for ( UINT i = 0; i < numEncoders; i++ )
+        {
+            IMAGEENCODERINFO encoderInfo;
+            encoderInfo.strMimeType  = pImageCodecInfo[i].MimeType;
+            encoderInfo.clsid        = pImageCodecInfo[i].Clsid;
+            encoderInfo.strExtension = pImageCodecInfo[i].FilenameExtension;
+
+            size_t length = encoderInfo.strExtension.find_first_of(L';');
+            if ( wstring::npos != length )
+            {
+                encoderInfo.strExtension.resize(length);
+            }
+
+            vctEncoders.push_back(encoderInfo);
+        }
+    }
+
+    free(pImageCodecInfo);
+}
+
+
 ULONG_PTR SdkImagesManager::m_gdiplusToken = 0;
 
 //////////////////////////////////////////////////////////////////////////
@@ -37,12 +96,14 @@ void SdkImagesManager::GdiplusInitialize()
 {
     GdiplusStartupInput gdiplusStartupInput;
     GdiplusStartup(&m_gdiplusToken, &gdiplusStartupInput, NULL);
+    LoadImageEncoders(g_vctImageEncoders);
 }
 
 //////////////////////////////////////////////////////////////////////////
 
 void SdkImagesManager::UnGdiplusInitialize()
 {
+    g_vctImageEncoders.clear();
     GdiplusShutdown(m_gdiplusToken);
 }
 
@@ -50,15 +111,48 @@ void SdkImagesManager::UnGdiplusInitialize()
 
 HBITMAP SdkImagesManager::CreateBitmapMask(HBITMAP hbmColour, COLORREF crTransparent)
 {
-    UNREFERENCED_PARAMETER(crTransparent);
     HDC hdcMem = NULL;
     HDC hdcMemMask = NULL;
     HBITMAP hbmMask = NULL;
-    BITMAP bm;
+    BITMAP bm = { 0 };
+
+    if ( (0 == GetObject(hbmColour, sizeof(BITMAP), &bm)) || (bm.bmWidth <= 0) || (bm.bmHeight <= 0) )
+    {
+        return NULL;
+    }
+
+    // Read the color image as 32bpp top-down pixels.
+    BITMAPINFO bmi = { 0 };
+    bmi.bmiHeader.biSize        = sizeof(BITMAPINFOHEADER);
+    bmi.bmiHeader.biWidth       = bm.bmWidth;
+    bmi.bmiHeader.biHeight      = -bm.bmHeight;
+    bmi.bmiHeader.biPlanes      = 1;
+    bmi.bmiHeader.biBitCount    = 32;
+    bmi.bmiHeader.biCompression = BI_RGB;
+
+    vector<UINT32> vctPixels((size_t)bm.bmWidth * bm.bmHeight);
+    HDC hdcScreen = GetDC(NULL);
+    int nLines = GetDIBits(hdcScreen, hbmColour, 0, bm.bmHeight, &vctPixels[0], &bmi, DIB_RGB_COLORS);
+    ReleaseDC(NULL, hdcScreen);
+
+    if ( nLines != bm.bmHeight )
+    {
+        return NULL;
+    }
 
-    // Create a monochrome (1 bit) mask bitmap
-    GetObject(hbmColour, sizeof(BITMAP), &bm);
-    hbmMask = CreateBitmap(bm.bmWidth, bm.bmHeight, 1, 1, NULL);
+    // Create a monochrome (1 bit) mask bitmap, the rows of it are aligned to WORD. Everything
+    // with the background ends up white while everything else ends up black.
+    UINT uMaskStride = ((bm.bmWidth + 15) / 16) * 2;
+    vector<BYTE> vctMask((size_t)uMaskStride * bm.bmHeight, 0);
+    UINT32 uColorKey = (GetRValue(crTransparent) << 16) | (GetGValue(crTransparent) << 8) | GetBValue(crTransparent);
+    SdkPixelKernels::CreateColorKeyMask((const BYTE*)&vctPixels[0], bm.bmWidth, bm.bmHeight, bm.bmWidth * 4,
+        uColorKey, &vctMask[0], uMaskStride);
+
+    hbmMask = CreateBitmap(bm.bmWidth, bm.bmHeight, 1, 1, &vctMask[0]);
+    if ( NULL == hbmMask )
+    {
+        return NULL;
+    }
 
     // Get some DCs that are compatible with the display driver.
     hdcMem = CreateCompatibleDC(NULL);
@@ -67,12 +161,10 @@ HBITMAP SdkImagesManager::CreateBitmapMask(HBITMAP hbmColour, COLORREF crTranspa
     HGDIOBJ hbmOldColour = SelectObject(hdcMem, hbmColour);
     HGDIOBJ hbmOldMask = SelectObject(hdcMemMask, hbmMask);
 
-    // Set the background color of the color image to the color you want to be transparent.
-    SetBkColor(hdcMem, 0);
-
-    // Copy the color image to the B+W mask. Everything with the background ends up white while
-    // everything else ends up black.
-    BitBlt(hdcMemMask, 0, 0, bm.bmWidth, bm.bmHeight, hdcMem, 0, 0, SRCCOPY);
+    // The white of the mask becomes the background color when it is copied to the color image,
+    // and the black becomes the text color.
+    SetBkColor(hdcMem, crTransparent);
+    SetTextColor(hdcMem, RGB(0, 0, 0));
 
     // Take our new mask and use it to turn the transparent color in our
     // original color image to black so the transparency effect will work right.
@@ -81,8 +173,8 @@ HBITMAP SdkImagesManager::CreateBitmapMask(HBITMAP hbmColour, COLORREF crTranspa
     // Clean up these GDI resources
     SelectObject(hdcMemMask, hbmOldMask);
     SelectObject(hdcMem, hbmOldColour);
-    DeleteObject(hdcMemMask);
-    DeleteObject(hdcMem);
+    DeleteDC(hdcMemMask);
+    DeleteDC(hdcMem);
 
     return hbmMask;
 }
@@ -187,8 +279,7 @@ BOOL SdkImagesManager::LoadImageFromFile(LPCTSTR pszfilePath)
 BOOL SdkImagesManager::LoadImageFromHBITMAP(HBITMAP hBitmap)
 {
     BITMAP bmp = { 0 };
-    BYTE *piexlsSrc = NULL;
-    if ( (FALSE == GetBitmapBitsData(hBitmap, &bmp, (LPVOID*)&piexlsSrc)) || (0 != bmp.bmType) )
+    if ( (NULL == hBitmap) || (0 == GetObject(hBitmap, sizeof(BITMAP), &bmp)) || (0 != bmp.bmType) )
     {
         return FALSE;
     }
@@ -209,32 +300,34 @@ BOOL SdkImagesManager::LoadImageFromHBITMAP(HBITMAP hBitmap)
 
     if ( Ok != state )
     {
-        SAFE_DELETE_ARRAY(piexlsSrc);
         SAFE_DELETE(this->m_pGdiImage);
         return FALSE;
     }
 
-    BYTE *pixelsDest = (BYTE*)bitmapData.Scan0;
-    int nLinesize = bmp.bmWidth * sizeof(UINT);
-    int nHeight = bmp.bmHeight;
-
-    // Copy pixel data from HBITMAP by bottom-up.
-    for ( int y = 0; y < nHeight; y++ )
+    // The rows of 32bpp pixels have no padding, so the pixels are read as a top-down DIB
+    // into the locked bits directly.
+    LONG cbCopied = 0;
+    if ( bitmapData.Stride == bmp.bmWidth * 4 )
     {
-        memcpy_s(
-            (pixelsDest + y * nLinesize),
-            nLinesize,
-            (piexlsSrc + (nHeight - y - 1) * nLinesize),
-            nLinesize);
+        BITMAPINFO bmpInfo = { 0 };
+        bmpInfo.bmiHeader.biSize        = sizeof(BITMAPINFOHEADER);
+        bmpInfo.bmiHeader.biWidth       = bmp.bmWidth;
+        bmpInfo.bmiHeader.biHeight      = -bmp.bmHeight;
+        bmpInfo.bmiHeader.biPlanes      = 1;
+        bmpInfo.bmiHeader.biBitCount    = 32;
+        bmpInfo.bmiHeader.biCompression = BI_RGB;
+
+        HDC hdcScreen = GetDC(NULL);
+        cbCopied = GetDIBits(hdcScreen, hBitmap, 0, bmp.bmHeight, bitmapData.Scan0, &bmpInfo, DIB_RGB_COLORS);
+        ReleaseDC(NULL, hdcScreen);
     }
 
-    // Copy the data in temporary buffer to this->m_pGdiImage
-    if ( Ok != m_pGdiImage->UnlockBits(&bitmapData) )
+    if ( (Ok != m_pGdiImage->UnlockBits(&bitmapData)) || (cbCopied != bmp.bmHeight) )
     {
         SAFE_DELETE(this->m_pGdiImage);
+        return FALSE;
     }
 
-    SAFE_DELETE_ARRAY(piexlsSrc);
     return this->CheckLastStatus();
 }
 
@@ -299,7 +392,7 @@ BOOL SdkImagesManager::SaveImageToFile(IN LPCWSTR lpfileName, IMAGE_SAVETYPE ima
 
 //////////////////////////////////////////////////////////////////////////
 
-BOOL SdkImagesManager::ResizeTo(FLOAT fWidth, FLOAT fHeight)
+BOOL SdkImagesManager::ResizeTo(FLOAT fWidth, FLOAT fHeight, PIXEL_RESIZE_FILTER filter)
 {
     if ( NULL == this->m_pGdiImage )
     {
@@ -308,6 +401,20 @@ BOOL SdkImagesManager::ResizeTo(FLOAT fWidth, FLOAT fHeight)
 
     UINT32 nWidth = (UINT32)fWidth;
     UINT32 nHeight = (UINT32)fHeight;
+    if ( (0 == nWidth) || (0 == nHeight) )
+    {
+        return FALSE;
+    }
+
+    // The pixels are resized by the pixel kernels, GDI+ is only used when the pixels of the
+    // image can not be accessed.
+    Bitmap *pResized = ResizePixels(nWidth, nHeight, filter);
+    if ( NULL != pResized )
+    {
+        this->DeleteImage();
+        this->m_pGdiImage = pResized;
+        return this->CheckLastStatus();
+    }
 
     // +1 newImg
     Bitmap *newImg = new Bitmap(nWidth, nHeight, PixelFormat32bppARGB);
@@ -332,13 +439,13 @@ BOOL SdkImagesManager::ResizeTo(FLOAT fWidth, FLOAT fHeight)
 
 //////////////////////////////////////////////////////////////////////////
 
-BOOL SdkImagesManager::ResizeTo(FLOAT fRatio)
+BOOL SdkImagesManager::ResizeTo(FLOAT fRatio, PIXEL_RESIZE_FILTER filter)
 {
     if ( m_bLoadImage && (m_pGdiImage != NULL) && (fRatio > 0) )
     {
         REAL fWidth = (REAL)(m_pGdiImage->GetWidth() * fRatio);
         REAL fHeight = (REAL)(m_pGdiImage->GetHeight() * fRatio);
-        return ResizeTo(fWidth, fHeight);
+        return ResizeTo(fWidth, fHeight, filter);
     }
 
     return FALSE;
@@ -618,6 +725,60 @@ BOOL SdkImagesManager::GetBitmapBitsData(IN HBITMAP hBitmap, OUT LPBITMAP lpbitm
 
 //////////////////////////////////////////////////////////////////////////
 
+Bitmap* SdkImagesManager::ResizePixels(UINT uWidth, UINT uHeight, PIXEL_RESIZE_FILTER filter)
+{
+    UINT uSrcWidth = m_pGdiImage->GetWidth();
+    UINT uSrcHeight = m_pGdiImage->GetHeight();
+    if ( (0 == uSrcWidth) || (0 == uSrcHeight) )
+    {
+        return NULL;
+    }
+
+    // +1 pResized
+    Bitmap *pResized = new Bitmap(uWidth, uHeight, PixelFormat32bppPARGB);
+    if ( (NULL == pResized) || (Gdiplus::Ok != pResized->GetLastStatus()) )
+    {
+        SAFE_DELETE(pResized);
+        return NULL;
+    }
+
+    // The pixels are resized in the premultiplied format, so the color of the transparent
+    // pixels does not bleed into the edge.
+    BitmapData srcData = { 0 };
+    BitmapData destData = { 0 };
+    Gdiplus::Rect rcSrc(0, 0, uSrcWidth, uSrcHeight);
+    Gdiplus::Rect rcDest(0, 0, uWidth, uHeight);
+    BOOL isOK = FALSE;
+
+    if ( Ok == m_pGdiImage->LockBits(&rcSrc, ImageLockModeRead, PixelFormat32bppPARGB, &srcData) )
+    {
+        if ( Ok == pResized->LockBits(&rcDest, ImageLockModeWrite, PixelFormat32bppPARGB, &destData) )
+        {
+            if ( (srcData.Stride > 0) && (destData.Stride > 0) )
+            {
+                isOK = SdkPixelKernels::ResizeImage(
+                    (const BYTE*)srcData.Scan0, uSrcWidth, uSrcHeight, (UINT)srcData.Stride,
+                    (BYTE*)destData.Scan0, uWidth, uHeight, (UINT)destData.Stride,
+                    filter);
+            }
+
+            pResized->UnlockBits(&destData);
+        }
+
+        m_pGdiImage->UnlockBits(&srcData);
+    }
+
+    // -1 pResized
+    if ( !isOK )
+    {
+        SAFE_DELETE(pResized);
+    }
+
+    return pResized;
+}
+
+//////////////////////////////////////////////////////////////////////////
+
 DWORD SdkImagesManager::LoadResourceData(
     UINT nResID,
     IN LPCWSTR lpcsType,
@@ -678,52 +839,35 @@ BOOL SdkImagesManager::GetEncoderClsid(
         return FALSE;
     }
 
-    BOOL bResult = FALSE;
-    UINT numEncoders = 0;                   // number of image decoders
-    UINT size = 0;                          // size, in bytes, of the image decoder array
-    ImageCodecInfo* pImageCodecInfo = NULL;
-
-    // How many decoders are there? How big (in bytes) is the array of all ImageCodecInfo objects?
-    GetImageEncodersSize(&numEncoders, &size);
-
-    if ( (0 == size) || (0 == numEncoders) )
-    {
-        return FALSE;
-    }
-
-    pImageCodecInfo = (ImageCodecInfo*)malloc(size);
-    if ( (NULL == pImageCodecInfo) ||
-         (Gdiplus::Ok != GetImageEncoders(numEncoders, size, pImageCodecInfo)) )
+    // The encoders are found when GDI+ is initialized, they are only scanned here if
+    // GDI+ is initialized by others.
+    vector<IMAGEENCODERINFO> vctEncoders;
+    const vector<IMAGEENCODERINFO> *pEncoders = &g_vctImageEncoders;
+    if ( g_vctImageEncoders.empty() )
     {
-        return FALSE;
+        LoadImageEncoders(vctEncoders);
+        pEncoders = &vctEncoders;
     }
 
-    for ( UINT i = 0; i < numEncoders; i++ )
+    BOOL bResult = FALSE;
+    for (vector<IMAGEENCODERINFO>::const_iterator iter = pEncoders->begin(); iter != pEncoders->end(); ++iter)
     {
-        if ( 0 == wcscmp(pImageCodecInfo[i].MimeType, pszformat) )
+        if ( 0 == wcscmp(iter->strMimeType.c_str(), pszformat) )
         {
             if ( (NULL != szFileNameExtension) && (dwSize > 0) )
             {
-                wstring strFileExtension(pImageCodecInfo[i].FilenameExtension);
-                int length = strFileExtension.find_first_of(L';');
-                length = (length < 0) ? strFileExtension.length() : length;
-                wcsncpy_s(
-                    szFileNameExtension,
-                    dwSize, pImageCodecInfo[i].FilenameExtension,
-                    length);
-
+                wcsncpy_s(szFileNameExtension, dwSize, iter->strExtension.c_str(), _TRUNCATE);
                 bResult = TRUE;
             }
 
             if ( NULL != pclsid )
             {
-                *pclsid = pImageCodecInfo[i].Clsid;
+                *pclsid = iter->clsid;
                 bResult = TRUE;
             }
             break;
         }
     }
 
-    free(pImageCodecInfo);
     return bResult;
 }
\ No newline at end of file
@@ -0,0 +1,986 @@
+/*!
+* @file SdkPixelKernels.cpp
+*
+* @brief The implementation of functions defined in SdkPixelKernels class.
+*
+* Copyright (C) 2011, LZT Corporation.
+*
+* @author Li Hong
+* @date 2011/06/30
+*/
+
+#include "stdafx.h"
+#include "SdkPixelKernels.h"
+
+#include <math.h>           // Get sin, fabs, floor and ceil.
+#include <string.h>         // Get memset and memcpy.
+
+#if defined(_M_IX86) || defined(_M_X64) || defined(__i386__) || defined(__x86_64__)
+#define PIXEL_HW_X86
+#include <emmintrin.h>
+#if !defined(_MSC_VER) || (_MSC_VER >= 1700)
+#define PIXEL_HW_AVX2
+#include <immintrin.h>
+#endif
+#ifdef _MSC_VER
+#include <intrin.h>
+#else
+#include <cpuid.h>
+#endif // _MSC_VER
+#endif
+
+// NEON is always there on ARM64, the 32 bits ARM is left to the scalar code.
+#if defined(_M_ARM64) || defined(__aarch64__)
+#define PIXEL_HW_NEON
+#include <arm_neon.h>
+#endif
+
+// GCC and Clang need the target attribute to emit AVX2 instructions without global options.
+#if defined(PIXEL_HW_X86) && defined(__GNUC__)
+#define PIXEL_AVX2_TARGET   __attribute__((target("avx2")))
+#else
+#define PIXEL_AVX2_TARGET
+#endif
+
+USING_NAMESPACE_UTILITIES
+
+#define PIXEL_SIZE                      4                               // The bytes of one pixel.
+#define PIXEL_RGB_MASK                  0x00FFFFFF                      // The color channels of one pixel.
+#define PIXEL_WEIGHT_BITS               14                              // The fraction bits of the resize weights.
+#define PIXEL_WEIGHT_ONE                (1 << PIXEL_WEIGHT_BITS)        // The weight 1.0.
+#define PIXEL_WEIGHT_ROUND              (1 << (PIXEL_WEIGHT_BITS - 1))  // The weight 0.5, it rounds the sum.
+#define PIXEL_PI                        3.14159265358979323846
+
+volatile UINT32 SdkPixelKernels::s_uSimdLevel = (UINT32)-1;
+
+
+//////////////////////////////////////////////////////////////////////////
+//
+// The common helpers of the scalar code and the SIMD code.
+//
+//////////////////////////////////////////////////////////////////////////
+
+/*!
+* @brief The reciprocal of the alpha for the unpremultiplication, it is 255 / alpha in 16.16
+*        fixed point, the transparent pixel gets 0.
+*/
+struct PIXELRECIPROCALTABLE
+{
+    UINT32  uValues[256];
+
+    PIXELRECIPROCALTABLE()
+    {
+        uValues[0] = 0;
+        for (UINT32 a = 1; a < 256; ++a)
+        {
+            uValues[a] = (255 * 65536 + a / 2) / a;
+        }
+    }
+};
+
+static const PIXELRECIPROCALTABLE s_reciprocalTable;
+
+static inline BYTE PixelClampByte(int nValue)
+{
+    return (BYTE)((nValue < 0) ? 0 : ((nValue > 255) ? 255 : nValue));
+}
+
+static inline UINT32 PixelMulDiv255(UINT32 uColor, UINT32 uAlpha)
+{
+    UINT32 t = uColor * uAlpha + 128;
+    return (t + (t >> 8)) >> 8;
+}
+
+static inline UINT32 PixelUnpremultiply(UINT32 uColor, UINT32 uReciprocal)
+{
+    UINT32 uValue = (uColor * uReciprocal + 32768) >> 16;
+    return (uValue < 255) ? uValue : 255;
+}
+
+// The mask byte takes the first pixel as the highest bit, the movemask gives the lowest bit.
+static inline UINT32 PixelReverseBits(UINT32 b)
+{
+    b = ((b & 0xF0) >> 4) | ((b & 0x0F) << 4);
+    b = ((b & 0xCC) >> 2) | ((b & 0x33) << 2);
+    b = ((b & 0xAA) >> 1) | ((b & 0x55) << 1);
+    return b;
+}
+
+static inline UINT32 PixelCountBits(UINT32 b)
+{
+    b = (b & 0x55) + ((b >> 1) & 0x55);
+    b = (b & 0x33) + ((b >> 2) & 0x33);
+    return (b & 0x0F) + (b >> 4);
+}
+
+static double PixelFilterSupport(PIXEL_RESIZE_FILTER filter)
+{
+    switch (filter)
+    {
+    case PIXEL_RESIZE_BOX:
+        return 0.5;
+
+    case PIXEL_RESIZE_LANCZOS:
+        return 3.0;
+
+    default:
+        return 1.0;
+    }
+}
+
+static inline double PixelSinc(double x)
+{
+    if (0.0 == x)
+    {
+        return 1.0;
+    }
+
+    x *= PIXEL_PI;
+    return sin(x) / x;
+}
+
+static double PixelFilterWeight(PIXEL_RESIZE_FILTER filter, double x)
+{
+    switch (filter)
+    {
+    case PIXEL_RESIZE_BOX:
+        return ((x > -0.5) && (x <= 0.5)) ? 1.0 : 0.0;
+
+    case PIXEL_RESIZE_LANCZOS:
+        return (fabs(x) < 3.0) ? PixelSinc(x) * PixelSinc(x / 3.0) : 0.0;
+
+    default:
+        x = fabs(x);
+        return (x < 1.0) ? 1.0 - x : 0.0;
+    }
+}
+
+//////////////////////////////////////////////////////////////////////////
+//
+// The weights of one dimension, the source range of the destination pixel i is
+// vctBounds[2 * i] and vctBounds[2 * i + 1] (the start and the count), its weights
+// start at vctWeights[i * nTaps]. The filter is stretched when shrinking, so every
+// source pixel contributes to the result.
+//
+//////////////////////////////////////////////////////////////////////////
+
+static int PixelComputeWeights(UINT uSrcSize, UINT uDestSize, PIXEL_RESIZE_FILTER filter,
+                               vector<int> &vctBounds, vector<int> &vctWeights)
+{
+    double dScale = (double)uSrcSize / uDestSize;
+    double dFilterScale = (dScale > 1.0) ? dScale : 1.0;
+    double dSupport = PixelFilterSupport(filter) * dFilterScale;
+    int nTaps = (int)ceil(dSupport) * 2 + 1;
+
+    vctBounds.assign((size_t)uDestSize * 2, 0);
+    vctWeights.assign((size_t)uDestSize * nTaps, 0);
+    vector<double> vctValues(nTaps, 0.0);
+
+    for (UINT i = 0; i < uDestSize; ++i)
+    {
+        double dCenter = (i + 0.5) * dScale;
+        int nMin = (int)floor(dCenter - dSupport + 0.5);
+        int nMax = (int)floor(dCenter + dSupport + 0.5);
+        nMin = (nMin > 0) ? nMin : 0;
+        nMax = (nMax < (int)uSrcSize) ? nMax : (int)uSrcSize;
+        int nCount = (nMax - nMin < nTaps) ? nMax - nMin : nTaps;
+
+        double dTotal = 0.0;
+        for (int k = 0; k < nCount; ++k)
+        {
+            vctValues[k] = PixelFilterWeight(filter, (nMin + k + 0.5 - dCenter) / dFilterScale);
+            dTotal += vctValues[k];
+        }
+
+        // Take the nearest pixel if the filter misses all pixels.
+        if ( (nCount <= 0) || (0.0 == dTotal) )
+        {
+            nMin = (int)dCenter;
+            nMin = (nMin < (int)uSrcSize) ? nMin : (int)uSrcSize - 1;
+            nCount = 1;
+            vctValues[0] = 1.0;
+            dTotal = 1.0;
+        }
+
+        // The rounding error goes to the largest weight, the sum is exactly one, so a flat
+        // area keeps its color.
+        int *pWeights = &vctWeights[(size_t)i * nTaps];
+        int nSum = 0;
+        int nLargest = 0;
+        for (int k = 0; k < nCount; ++k)
+        {
+            pWeights[k] = (int)floor(vctValues[k] / dTotal * PIXEL_WEIGHT_ONE + 0.5);
+            nSum += pWeights[k];
+            nLargest = (pWeights[k] > pWeights[nLargest]) ? k : nLargest;
+        }
+        pWeights[nLargest] += PIXEL_WEIGHT_ONE - nSum;
+
+        vctBounds[2 * i]     = nMin;
+        vctBounds[2 * i + 1] = nCount;
+    }
+
+    return nTaps;
+}
+
+
+//////////////////////////////////////////////////////////////////////////
+//
+// The scalar implementation, it is the reference of the SIMD code, the SIMD code
+// calculates in the same integers and gives the same result.
+//
+//////////////////////////////////////////////////////////////////////////
+
+static void PixelPremultiplyScalar(UINT32 *pPixels, size_t nCount)
+{
+    for (size_t i = 0; i < nCount; ++i)
+    {
+        UINT32 uPixel = pPixels[i];
+        UINT32 uAlpha = uPixel >> 24;
+        pPixels[i] = (uAlpha << 24) |
+                     (PixelMulDiv255((uPixel >> 16) & 0xFF, uAlpha) << 16) |
+                     (PixelMulDiv255((uPixel >> 8) & 0xFF, uAlpha) << 8) |
+                      PixelMulDiv255(uPixel & 0xFF, uAlpha);
+    }
+}
+
+static void PixelUnpremultiplyScalar(UINT32 *pPixels, size_t nCount)
+{
+    for (size_t i = 0; i < nCount; ++i)
+    {
+        UINT32 uPixel = pPixels[i];
+        UINT32 uAlpha = uPixel >> 24;
+        UINT32 uReciprocal = s_reciprocalTable.uValues[uAlpha];
+        pPixels[i] = (uAlpha << 24) |
+                     (PixelUnpremultiply((uPixel >> 16) & 0xFF, uReciprocal) << 16) |
+                     (PixelUnpremultiply((uPixel >> 8) & 0xFF, uReciprocal) << 8) |
+                      PixelUnpremultiply(uPixel & 0xFF, uReciprocal);
+    }
+}
+
+static void PixelSwapRedBlueScalar(const UINT32 *pSrc, UINT32 *pDest, size_t nCount)
+{
+    for (size_t i = 0; i < nCount; ++i)
+    {
+        UINT32 uPixel = pSrc[i];
+        pDest[i] = (uPixel & 0xFF00FF00) | ((uPixel >> 16) & 0xFF) | ((uPixel & 0xFF) << 16);
+    }
+}
+
+static size_t PixelColorKeyRowScalar(const BYTE *pRow, UINT uBegin, UINT uWidth, UINT32 uColorKey, BYTE *pMaskRow)
+{
+    size_t nMatched = 0;
+    for (UINT x = uBegin; x < uWidth; ++x)
+    {
+        UINT32 uPixel = 0;
+        memcpy(&uPixel, pRow + (size_t)x * PIXEL_SIZE, PIXEL_SIZE);
+        if ((uPixel & PIXEL_RGB_MASK) == uColorKey)
+        {
+            pMaskRow[x >> 3] |= (BYTE)(0x80 >> (x & 7));
+            ++nMatched;
+        }
+    }
+
+    return nMatched;
+}
+
+static void PixelResizeRowScalar(const BYTE *pSrc, BYTE *pDest, UINT uDestWidth,
+                                 const int *pBounds, const int *pWeights, int nTaps)
+{
+    for (UINT x = 0; x < uDestWidth; ++x)
+    {
+        const BYTE *p = pSrc + (size_t)pBounds[2 * x] * PIXEL_SIZE;
+        const int *w = pWeights + (size_t)x * nTaps;
+        int nCount = pBounds[2 * x + 1];
+        int b = PIXEL_WEIGHT_ROUND, g = PIXEL_WEIGHT_ROUND, r = PIXEL_WEIGHT_ROUND, a = PIXEL_WEIGHT_ROUND;
+        for (int k = 0; k < nCount; ++k, p += PIXEL_SIZE)
+        {
+            b += p[0] * w[k];
+            g += p[1] * w[k];
+            r += p[2] * w[k];
+            a += p[3] * w[k];
+        }
+
+        BYTE *pOut = pDest + (size_t)x * PIXEL_SIZE;
+        pOut[0] = PixelClampByte(b >> PIXEL_WEIGHT_BITS);
+        pOut[1] = PixelClampByte(g >> PIXEL_WEIGHT_BITS);
+        pOut[2] = PixelClampByte(r >> PIXEL_WEIGHT_BITS);
+        pOut[3] = PixelClampByte(a >> PIXEL_WEIGHT_BITS);
+    }
+}
+
+static void PixelResizeColumnsScalar(const BYTE *pSrc, UINT uSrcStride, size_t nBegin, size_t nBytes, BYTE *pDest,
+                                     int nStart, int nCount, const int *pWeights, int *pSums)
+{
+    for (size_t i = nBegin; i < nBytes; ++i)
+    {
+        pSums[i] = PIXEL_WEIGHT_ROUND;
+    }
+
+    for (int k = 0; k < nCount; ++k)
+    {
+        const BYTE *pRow = pSrc + (size_t)(nStart + k) * uSrcStride;
+        int nWeight = pWeights[k];
+        for (size_t i = nBegin; i < nBytes; ++i)
+        {
+            pSums[i] += pRow[i] * nWeight;
+        }
+    }
+
+    for (size_t i = nBegin; i < nBytes; ++i)
+    {
+        pDest[i] = PixelClampByte(pSums[i] >> PIXEL_WEIGHT_BITS);
+    }
+}
+
+
+//////////////////////////////////////////////////////////////////////////
+//
+// The AVX2 implementation, the tail is left to the scalar code.
+//
+//////////////////////////////////////////////////////////////////////////
+
+#if defined(PIXEL_HW_AVX2)
+
+PIXEL_AVX2_TARGET static inline __m256i PixelMulDiv255Avx2(__m256i color, __m256i alpha)
+{
+    __m256i t = _mm256_add_epi16(_mm256_mullo_epi16(color, alpha), _mm256_set1_epi16(128));
+    return _mm256_srli_epi16(_mm256_add_epi16(t, _mm256_srli_epi16(t, 8)), 8);
+}
+
+PIXEL_AVX2_TARGET static size_t PixelPremultiplyAvx2(UINT32 *pPixels, size_t nCount)
+{
+    const __m256i zero  = _mm256_setzero_si256();
+    const __m256i alpha = _mm256_set1_epi32((int)0xFF000000);
+
+    size_t i = 0;
+    for (; i + 8 <= nCount; i += 8)
+    {
+        // Each pixel takes four 16 bits lanes, the alpha is spread to the other three lanes.
+        __m256i pixels = _mm256_loadu_si256((const __m256i*)(pPixels + i));
+        __m256i lo = _mm256_unpacklo_epi8(pixels, zero);
+        __m256i hi = _mm256_unpackhi_epi8(pixels, zero);
+        lo = PixelMulDiv255Avx2(lo, _mm256_shufflehi_epi16(_mm256_shufflelo_epi16(lo, 0xFF), 0xFF));
+        hi = PixelMulDiv255Avx2(hi, _mm256_shufflehi_epi16(_mm256_shufflelo_epi16(hi, 0xFF), 0xFF));
+        __m256i result = _mm256_blendv_epi8(_mm256_packus_epi16(lo, hi), pixels, alpha);
+        _mm256_storeu_si256((__m256i*)(pPixels + i), result);
+    }
+
+    return i;
+}
+
+PIXEL_AVX2_TARGET static inline __m256i PixelUnpremultiplyAvx2(__m256i color, __m256i reciprocal)
+{
+    __m256i value = _mm256_add_epi32(_mm256_mullo_epi32(color, reciprocal), _mm256_set1_epi32(32768));
+    return _mm256_min_epu32(_mm256_srli_epi32(value, 16), _mm256_set1_epi32(255));
+}
+
+PIXEL_AVX2_TARGET static size_t PixelUnpremultiplyAvx2(UINT32 *pPixels, size_t nCount)
+{
+    const __m256i mask = _mm256_set1_epi32(0xFF);
+
+    size_t i = 0;
+    for (; i + 8 <= nCount; i += 8)
+    {
+        __m256i pixels = _mm256_loadu_si256((const __m256i*)(pPixels + i));
+        __m256i alpha  = _mm256_srli_epi32(pixels, 24);
+        __m256i reciprocal = _mm256_i32gather_epi32((const int*)s_reciprocalTable.uValues, alpha, 4);
+        __m256i b = PixelUnpremultiplyAvx2(_mm256_and_si256(pixels, mask), reciprocal);
+        __m256i g = PixelUnpremultiplyAvx2(_mm256_and_si256(_mm256_srli_epi32(pixels, 8), mask), reciprocal);
+        __m256i r = PixelUnpremultiplyAvx2(_mm256_and_si256(_mm256_srli_epi32(pixels, 16), mask), reciprocal);
+        __m256i result = _mm256_or_si256(_mm256_or_si256(b, _mm256_slli_epi32(g, 8)),
+                                         _mm256_or_si256(_mm256_slli_epi32(r, 16), _mm256_slli_epi32(alpha, 24)));
+        _mm256_storeu_si256((__m256i*)(pPixels + i), result);
+    }
+
+    return i;
+}
+
+PIXEL_AVX2_TARGET static size_t PixelSwapRedBlueAvx2(const UINT32 *pSrc, UINT32 *pDest, size_t nCount)
+{
+    const __m256i shuffle = _mm256_setr_epi8(2, 1, 0, 3, 6, 5, 4, 7, 10, 9, 8, 11, 14, 13, 12, 15,
+                                             2, 1, 0, 3, 6, 5, 4, 7, 10, 9, 8, 11, 14, 13, 12, 15);
+
+    size_t i = 0;
+    for (; i + 8 <= nCount; i += 8)
+    {
+        __m256i pixels = _mm256_loadu_si256((const __m256i*)(pSrc + i));
+        _mm256_storeu_si256((__m256i*)(pDest + i), _mm256_shuffle_epi8(pixels, shuffle));
+    }
+
+    return i;
+}
+
+PIXEL_AVX2_TARGET static UINT PixelColorKeyRowAvx2(const BYTE *pRow, UINT uWidth, UINT32 uColorKey,
+                                                   BYTE *pMaskRow, size_t &nMatched)
+{
+    const __m256i rgb = _mm256_set1_epi32(PIXEL_RGB_MASK);
+    const __m256i key = _mm256_set1_epi32((int)uColorKey);
+
+    UINT x = 0;
+    for (; x + 8 <= uWidth; x += 8)
+    {
+        __m256i pixels = _mm256_loadu_si256((const __m256i*)(pRow + (size_t)x * PIXEL_SIZE));
+        __m256i equal  = _mm256_cmpeq_epi32(_mm256_and_si256(pixels, rgb), key);
+        UINT32 uBits = (UINT32)_mm256_movemask_ps(_mm256_castsi256_ps(equal));
+        pMaskRow[x >> 3] = (BYTE)PixelReverseBits(uBits);
+        nMatched += PixelCountBits(uBits);
+    }
+
+    return x;
+}
+
+PIXEL_AVX2_TARGET static void PixelResizeRowAvx2(const BYTE *pSrc, BYTE *pDest, UINT uDestWidth,
+                                                 const int *pBounds, const int *pWeights, int nTaps)
+{
+    const __m128i round = _mm_set1_epi32(PIXEL_WEIGHT_ROUND);
+
+    for (UINT x = 0; x < uDestWidth; ++x)
+    {
+        const BYTE *p = pSrc + (size_t)pBounds[2 * x] * PIXEL_SIZE;
+        const int *w = pWeights + (size_t)x * nTaps;
+        int nCount = pBounds[2 * x + 1];
+
+        // Two source pixels are taken each time, one in each half of the register.
+        __m256i sum = _mm256_setzero_si256();
+        int k = 0;
+        for (; k + 2 <= nCount; k += 2)
+        {
+            __m256i pixels  = _mm256_cvtepu8_epi32(_mm_loadl_epi64((const __m128i*)(p + k * PIXEL_SIZE)));
+            __m256i weights = _mm256_inserti128_si256(_mm256_castsi128_si256(_mm_set1_epi32(w[k])), _mm_set1_epi32(w[k + 1]), 1);
+            sum = _mm256_add_epi32(sum, _mm256_mullo_epi32(pixels, weights));
+        }
+
+        __m128i result = _mm_add_epi32(_mm_add_epi32(_mm256_castsi256_si128(sum), _mm256_extracti128_si256(sum, 1)), round);
+        if (k < nCount)
+        {
+            int nPixel = 0;
+            memcpy(&nPixel, p + k * PIXEL_SIZE, PIXEL_SIZE);
+            __m128i pixel = _mm_cvtepu8_epi32(_mm_cvtsi32_si128(nPixel));
+            result = _mm_add_epi32(result, _mm_mullo_epi32(pixel, _mm_set1_epi32(w[k])));
+        }
+
+        result = _mm_srai_epi32(result, PIXEL_WEIGHT_BITS);
+        result = _mm_packus_epi16(_mm_packs_epi32(result, result), result);
+        int nResult = _mm_cvtsi128_si32(result);
+        memcpy(pDest + (size_t)x * PIXEL_SIZE, &nResult, PIXEL_SIZE);
+    }
+}
+
+PIXEL_AVX2_TARGET static size_t PixelResizeColumnsAvx2(const BYTE *pSrc, UINT uSrcStride, size_t nBytes, BYTE *pDest,
+                                                       int nStart, int nCount, const int *pWeights)
+{
+    size_t i = 0;
+    for (; i + 16 <= nBytes; i += 16)
+    {
+        __m256i sum0 = _mm256_set1_epi32(PIXEL_WEIGHT_ROUND);
+        __m256i sum1 = sum0;
+        const BYTE *pRow = pSrc + (size_t)nStart * uSrcStride + i;
+        for (int k = 0; k < nCount; ++k, pRow += uSrcStride)
+        {
+            __m128i bytes  = _mm_loadu_si128((const __m128i*)pRow);
+            __m256i weight = _mm256_set1_epi32(pWeights[k]);
+            sum0 = _mm256_add_epi32(sum0, _mm256_mullo_epi32(_mm256_cvtepu8_epi32(bytes), weight));
+            sum1 = _mm256_add_epi32(sum1, _mm256_mullo_epi32(_mm256_cvtepu8_epi32(_mm_srli_si128(bytes, 8)), weight));
+        }
+
+        // The pack works in each half of the register, the permutation restores the order.
+        __m256i words = _mm256_packs_epi32(_mm256_srai_epi32(sum0, PIXEL_WEIGHT_BITS), _mm256_srai_epi32(sum1, PIXEL_WEIGHT_BITS));
+        words = _mm256_permute4x64_epi64(words, 0xD8);
+        __m128i result = _mm_packus_epi16(_mm256_castsi256_si128(words), _mm256_extracti128_si256(words, 1));
+        _mm_storeu_si128((__m128i*)(pDest + i), result);
+    }
+
+    return i;
+}
+
+#endif // PIXEL_HW_AVX2
+
+
+//////////////////////////////////////////////////////////////////////////
+//
+// The NEON implementation, the tail is left to the scalar code.
+//
+//////////////////////////////////////////////////////////////////////////
+
+#if defined(PIXEL_HW_NEON)
+
+static inline uint8x16_t PixelMulDiv255Neon(uint8x16_t color, uint8x16_t alpha)
+{
+    uint16x8_t lo = vmlal_u8(vdupq_n_u16(128), vget_low_u8(color), vget_low_u8(alpha));
+    uint16x8_t hi = vmlal_u8(vdupq_n_u16(128), vget_high_u8(color), vget_high_u8(alpha));
+    lo = vsraq_n_u16(lo, lo, 8);
+    hi = vsraq_n_u16(hi, hi, 8);
+    return vcombine_u8(vshrn_n_u16(lo, 8), vshrn_n_u16(hi, 8));
+}
+
+static size_t PixelPremultiplyNeon(UINT32 *pPixels, size_t nCount)
+{
+    size_t i = 0;
+    for (; i + 16 <= nCount; i += 16)
+    {
+        uint8x16x4_t pixels = vld4q_u8((const uint8_t*)(pPixels + i));
+        pixels.val[0] = PixelMulDiv255Neon(pixels.val[0], pixels.val[3]);
+        pixels.val[1] = PixelMulDiv255Neon(pixels.val[1], pixels.val[3]);
+        pixels.val[2] = PixelMulDiv255Neon(pixels.val[2], pixels.val[3]);
+        vst4q_u8((uint8_t*)(pPixels + i), pixels);
+    }
+
+    return i;
+}
+
+static inline uint32x4_t PixelUnpremultiplyNeon(uint32x4_t color, uint32x4_t reciprocal)
+{
+    uint32x4_t value = vmlaq_u32(vdupq_n_u32(32768), color, reciprocal);
+    return vminq_u32(vshrq_n_u32(value, 16), vdupq_n_u32(255));
+}
+
+static size_t PixelUnpremultiplyNeon(UINT32 *pPixels, size_t nCount)
+{
+    const uint32x4_t mask = vdupq_n_u32(0xFF);
+
+    size_t i = 0;
+    for (; i + 4 <= nCount; i += 4)
+    {
+        uint32x4_t pixels = vld1q_u32((const uint32_t*)(pPixels + i));
+        uint32x4_t alpha  = vshrq_n_u32(pixels, 24);
+        UINT32 reciprocals[4] =
+        {
+            s_reciprocalTable.uValues[vgetq_lane_u32(alpha, 0)],
+            s_reciprocalTable.uValues[vgetq_lane_u32(alpha, 1)],
+            s_reciprocalTable.uValues[vgetq_lane_u32(alpha, 2)],
+            s_reciprocalTable.uValues[vgetq_lane_u32(alpha, 3)],
+        };
+        uint32x4_t reciprocal = vld1q_u32((const uint32_t*)reciprocals);
+        uint32x4_t b = PixelUnpremultiplyNeon(vandq_u32(pixels, mask), reciprocal);
+        uint32x4_t g = PixelUnpremultiplyNeon(vandq_u32(vshrq_n_u32(pixels, 8), mask), reciprocal);
+        uint32x4_t r = PixelUnpremultiplyNeon(vandq_u32(vshrq_n_u32(pixels, 16), mask), reciprocal);
+        uint32x4_t result = vorrq_u32(vorrq_u32(b, vshlq_n_u32(g, 8)), vorrq_u32(vshlq_n_u32(r, 16), vshlq_n_u32(alpha, 24)));
+        vst1q_u32((uint32_t*)(pPixels + i), result);
+    }
+
+    return i;
+}
+
+static size_t PixelSwapRedBlueNeon(const UINT32 *pSrc, UINT32 *pDest, size_t nCount)
+{
+    size_t i = 0;
+    for (; i + 16 <= nCount; i += 16)
+    {
+        uint8x16x4_t pixels = vld4q_u8((const uint8_t*)(pSrc + i));
+        uint8x16_t blue = pixels.val[0];
+        pixels.val[0] = pixels.val[2];
+        pixels.val[2] = blue;
+        vst4q_u8((uint8_t*)(pDest + i), pixels);
+    }
+
+    return i;
+}
+
+static UINT PixelColorKeyRowNeon(const BYTE *pRow, UINT uWidth, UINT32 uColorKey, BYTE *pMaskRow, size_t &nMatched)
+{
+    static const uint32_t bitValues[4] = { 8, 4, 2, 1 };
+    const uint32x4_t rgb  = vdupq_n_u32(PIXEL_RGB_MASK);
+    const uint32x4_t key  = vdupq_n_u32(uColorKey);
+    const uint32x4_t bits = vld1q_u32(bitValues);
+
+    UINT x = 0;
+    for (; x + 8 <= uWidth; x += 8)
+    {
+        const uint32_t *pPixels = (const uint32_t*)(pRow + (size_t)x * PIXEL_SIZE);
+        uint32x4_t equal0 = vceqq_u32(vandq_u32(vld1q_u32(pPixels), rgb), key);
+        uint32x4_t equal1 = vceqq_u32(vandq_u32(vld1q_u32(pPixels + 4), rgb), key);
+        UINT32 uBits = (vaddvq_u32(vandq_u32(equal0, bits)) << 4) | vaddvq_u32(vandq_u32(equal1, bits));
+        pMaskRow[x >> 3] = (BYTE)uBits;
+        nMatched += PixelCountBits(uBits);
+    }
+
+    return x;
+}
+
+static void PixelResizeRowNeon(const BYTE *pSrc, BYTE *pDest, UINT uDestWidth,
+                               const int *pBounds, const int *pWeights, int nTaps)
+{
+    for (UINT x = 0; x < uDestWidth; ++x)
+    {
+        const BYTE *p = pSrc + (size_t)pBounds[2 * x] * PIXEL_SIZE;
+        const int *w = pWeights + (size_t)x * nTaps;
+        int nCount = pBounds[2 * x + 1];
+
+        int32x4_t sum = vdupq_n_s32(PIXEL_WEIGHT_ROUND);
+        for (int k = 0; k < nCount; ++k, p += PIXEL_SIZE)
+        {
+            uint32_t uPixel = 0;
+            memcpy(&uPixel, p, PIXEL_SIZE);
+            uint16x8_t words = vmovl_u8(vreinterpret_u8_u32(vdup_n_u32(uPixel)));
+            sum = vmlaq_n_s32(sum, vreinterpretq_s32_u32(vmovl_u16(vget_low_u16(words))), w[k]);
+        }
+
+        uint16x4_t words = vqmovun_s32(vshrq_n_s32(sum, PIXEL_WEIGHT_BITS));
+        uint8x8_t bytes = vqmovn_u16(vcombine_u16(words, words));
+        uint32_t uResult = vget_lane_u32(vreinterpret_u32_u8(bytes), 0);
+        memcpy(pDest + (size_t)x * PIXEL_SIZE, &uResult, PIXEL_SIZE);
+    }
+}
+
+static size_t PixelResizeColumnsNeon(const BYTE *pSrc, UINT uSrcStride, size_t nBytes, BYTE *pDest,
+                                     int nStart, int nCount, const int *pWeights)
+{
+    size_t i = 0;
+    for (; i + 16 <= nBytes; i += 16)
+    {
+        int32x4_t sum0 = vdupq_n_s32(PIXEL_WEIGHT_ROUND);
+        int32x4_t sum1 = sum0, sum2 = sum0, sum3 = sum0;
+        const BYTE *pRow = pSrc + (size_t)nStart * uSrcStride + i;
+        for (int k = 0; k < nCount; ++k, pRow += uSrcStride)
+        {
+            uint8x16_t bytes = vld1q_u8(pRow);
+            uint16x8_t lo = vmovl_u8(vget_low_u8(bytes));
+            uint16x8_t hi = vmovl_u8(vget_high_u8(bytes));
+            sum0 = vmlaq_n_s32(sum0, vreinterpretq_s32_u32(vmovl_u16(vget_low_u16(lo))), pWeights[k]);
+            sum1 = vmlaq_n_s32(sum1, vreinterpretq_s32_u32(vmovl_u16(vget_high_u16(lo))), pWeights[k]);
+            sum2 = vmlaq_n_s32(sum2, vreinterpretq_s32_u32(vmovl_u16(vget_low_u16(hi))), pWeights[k]);
+            sum3 = vmlaq_n_s32(sum3, vreinterpretq_s32_u32(vmovl_u16(vget_high_u16(hi))), pWeights[k]);
+        }
+
+        uint16x8_t lo = vcombine_u16(vqmovun_s32(vshrq_n_s32(sum0, PIXEL_WEIGHT_BITS)), vqmovun_s32(vshrq_n_s32(sum1, PIXEL_WEIGHT_BITS)));
+        uint16x8_t hi = vcombine_u16(vqmovun_s32(vshrq_n_s32(sum2, PIXEL_WEIGHT_BITS)), vqmovun_s32(vshrq_n_s32(sum3, PIXEL_WEIGHT_BITS)));
+        vst1q_u8(pDest + i, vcombine_u8(vqmovn_u16(lo), vqmovn_u16(hi)));
+    }
+
+    return i;
+}
+
+#endif // PIXEL_HW_NEON
+
+
+//////////////////////////////////////////////////////////////////////////
+
+void SdkPixelKernels::PremultiplyAlpha(IN OUT UINT32 *pPixels, size_t nCount)
+{
+    size_t nDone = 0;
+
+#if defined(PIXEL_HW_AVX2)
+    if (PIXEL_SIMD_AVX2 == GetSimdLevel())
+    {
+        nDone = PixelPremultiplyAvx2(pPixels, nCount);
+    }
+#elif defined(PIXEL_HW_NEON)
+    if (PIXEL_SIMD_NEON == GetSimdLevel())
+    {
+        nDone = PixelPremultiplyNeon(pPixels, nCount);
+    }
+#endif // PIXEL_HW_AVX2
+
+    PixelPremultiplyScalar(pPixels + nDone, nCount - nDone);
+}
+
+//////////////////////////////////////////////////////////////////////////
+
+void SdkPixelKernels::UnpremultiplyAlpha(IN OUT UINT32 *pPixels, size_t nCount)
+{
+    size_t nDone = 0;
+
+#if defined(PIXEL_HW_AVX2)
+    if (PIXEL_SIMD_AVX2 == GetSimdLevel())
+    {
+        nDone = PixelUnpremultiplyAvx2(pPixels, nCount);
+    }
+#elif defined(PIXEL_HW_NEON)
+    if (PIXEL_SIMD_NEON == GetSimdLevel())
+    {
+        nDone = PixelUnpremultiplyNeon(pPixels, nCount);
+    }
+#endif // PIXEL_HW_AVX2
+
+    PixelUnpremultiplyScalar(pPixels + nDone, nCount - nDone);
+}
+
+//////////////////////////////////////////////////////////////////////////
+
+void SdkPixelKernels::SwapRedBlue(IN const UINT32 *pSrc, OUT UINT32 *pDest, size_t nCount)
+{
+    size_t nDone = 0;
+
+#if defined(PIXEL_HW_AVX2)
+    if (PIXEL_SIMD_AVX2 == GetSimdLevel())
+    {
+        nDone = PixelSwapRedBlueAvx2(pSrc, pDest, nCount);
+    }
+#elif defined(PIXEL_HW_NEON)
+    if (PIXEL_SIMD_NEON == GetSimdLevel())
+    {
+        nDone = PixelSwapRedBlueNeon(pSrc, pDest, nCount);
+    }
+#endif // PIXEL_HW_AVX2
+
+    PixelSwapRedBlueScalar(pSrc + nDone, pDest + nDone, nCount - nDone);
+}
+
+//////////////////////////////////////////////////////////////////////////
+
+size_t SdkPixelKernels::CreateColorKeyMask(
+    IN const BYTE *pPixels,
+    UINT uWidth,
+    UINT uHeight,
+    UINT uStride,
+    UINT32 uColorKey,
+    OUT BYTE *pMask,
+    UINT uMaskStride)
+{
+    if ( (NULL == pPixels) || (NULL == pMask) || (uStride < uWidth * PIXEL_SIZE) || (uMaskStride < (uWidth + 7) / 8) )
+    {
+        return 0;
+    }
+
+    UINT32 nLevel = GetSimdLevel();
+    size_t nMatched = 0;
+    uColorKey &= PIXEL_RGB_MASK;
+
+    for (UINT y = 0; y < uHeight; ++y)
+    {
+        const BYTE *pRow = pPixels + (size_t)y * uStride;
+        BYTE *pMaskRow = pMask + (size_t)y * uMaskStride;
+        UINT uDone = 0;
+        memset(pMaskRow, 0, (uWidth + 7) / 8);
+
+#if defined(PIXEL_HW_AVX2)
+        if (PIXEL_SIMD_AVX2 == nLevel)
+        {
+            uDone = PixelColorKeyRowAvx2(pRow, uWidth, uColorKey, pMaskRow, nMatched);
+        }
+#elif defined(PIXEL_HW_NEON)
+        if (PIXEL_SIMD_NEON == nLevel)
+        {
+            uDone = PixelColorKeyRowNeon(pRow, uWidth, uColorKey, pMaskRow, nMatched);
+        }
+#endif // PIXEL_HW_AVX2
+
+        nMatched += PixelColorKeyRowScalar(pRow, uDone, uWidth, uColorKey, pMaskRow);
+    }
+
+    (void)nLevel;
+
+    return nMatched;
+}
+
+//////////////////////////////////////////////////////////////////////////
+
+BOOL SdkPixelKernels::ResizeImage(
+    IN const BYTE *pSrc,
+    UINT uSrcWidth,
+    UINT uSrcHeight,
+    UINT uSrcStride,
+    OUT BYTE *pDest,
+    UINT uDestWidth,
+    UINT uDestHeight,
+    UINT uDestStride,
+    PIXEL_RESIZE_FILTER filter)
+{
+    if ( (NULL == pSrc) || (NULL == pDest) ||
+         (0 == uSrcWidth) || (0 == uSrcHeight) || (0 == uDestWidth) || (0 == uDestHeight) )
+    {
+        return FALSE;
+    }
+
+    if ( ((double)uSrcWidth * uSrcHeight > MAX_PIXEL_KERNEL_PIXELS) ||
+         ((double)uDestWidth * uDestHeight > MAX_PIXEL_KERNEL_PIXELS) ||
+         ((double)uDestWidth * uSrcHeight > MAX_PIXEL_KERNEL_PIXELS) ||
+         (uSrcStride < uSrcWidth * PIXEL_SIZE) || (uDestStride < uDestWidth * PIXEL_SIZE) )
+    {
+        return FALSE;
+    }
+
+    vector<int> vctBounds;
+    vector<int> vctWeights;
+    vector<BYTE> vctTemp;
+    const BYTE *pRows = pSrc;
+    UINT uRowsStride = uSrcStride;
+
+    // The image is resized in horizontal first, then in vertical, the dimension which does
+    // not change is skipped.
+    if (uDestWidth != uSrcWidth)
+    {
+        int nTaps = PixelComputeWeights(uSrcWidth, uDestWidth, filter, vctBounds, vctWeights);
+        if (uDestHeight == uSrcHeight)
+        {
+            ResizeHorizontal(pSrc, uSrcStride, uSrcHeight, pDest, uDestWidth, uDestStride, vctBounds, vctWeights, nTaps);
+            return TRUE;
+        }
+
+        vctTemp.resize((size_t)uDestWidth * uSrcHeight * PIXEL_SIZE);
+        uRowsStride = uDestWidth * PIXEL_SIZE;
+        ResizeHorizontal(pSrc, uSrcStride, uSrcHeight, &vctTemp[0], uDestWidth, uRowsStride, vctBounds, vctWeights, nTaps);
+        pRows = &vctTemp[0];
+    }
+
+    if (uDestHeight != uSrcHeight)
+    {
+        int nTaps = PixelComputeWeights(uSrcHeight, uDestHeight, filter, vctBounds, vctWeights);
+        ResizeVertical(pRows, uRowsStride, uDestWidth, pDest, uDestHeight, uDestStride, vctBounds, vctWeights, nTaps);
+        return TRUE;
+    }
+
+    for (UINT y = 0; y < uDestHeight; ++y)
+    {
+        memcpy(pDest + (size_t)y * uDestStride, pRows + (size_t)y * uRowsStride, (size_t)uDestWidth * PIXEL_SIZE);
+    }
+
+    return TRUE;
+}
+
+//////////////////////////////////////////////////////////////////////////
+
+UINT32 SdkPixelKernels::GetSimdLevel()
+{
+    UINT32 nLevel = s_uSimdLevel;
+    if ((UINT32)-1 == nLevel)
+    {
+        nLevel = GetSupportedSimdLevel();
+        s_uSimdLevel = nLevel;
+    }
+
+    return nLevel;
+}
+
+//////////////////////////////////////////////////////////////////////////
+
+void SdkPixelKernels::SetSimdLevel(UINT32 nLevel)
+{
+    // The levels are different instruction sets rather than the steps of one, so only the
+    // supported one or the scalar code can be chosen.
+    UINT32 nSupported = GetSupportedSimdLevel();
+    s_uSimdLevel = (nLevel == nSupported) ? nLevel : PIXEL_SIMD_NONE;
+}
+
+//////////////////////////////////////////////////////////////////////////
+
+void SdkPixelKernels::ResizeHorizontal(
+    const BYTE *pSrc,
+    UINT uSrcStride,
+    UINT uHeight,
+    BYTE *pDest,
+    UINT uDestWidth,
+    UINT uDestStride,
+    const vector<int> &vctBounds,
+    const vector<int> &vctWeights,
+    int nTaps)
+{
+    UINT32 nLevel = GetSimdLevel();
+
+    for (UINT y = 0; y < uHeight; ++y)
+    {
+        const BYTE *pSrcRow = pSrc + (size_t)y * uSrcStride;
+        BYTE *pDestRow = pDest + (size_t)y * uDestStride;
+
+#if defined(PIXEL_HW_AVX2)
+        if (PIXEL_SIMD_AVX2 == nLevel)
+        {
+            PixelResizeRowAvx2(pSrcRow, pDestRow, uDestWidth, &vctBounds[0], &vctWeights[0], nTaps);
+            continue;
+        }
+#elif defined(PIXEL_HW_NEON)
+        if (PIXEL_SIMD_NEON == nLevel)
+        {
+            PixelResizeRowNeon(pSrcRow, pDestRow, uDestWidth, &vctBounds[0], &vctWeights[0], nTaps);
+            continue;
+        }
+#endif // PIXEL_HW_AVX2
+
+        PixelResizeRowScalar(pSrcRow, pDestRow, uDestWidth, &vctBounds[0], &vctWeights[0], nTaps);
+    }
+
+    (void)nLevel;
+}
+
+//////////////////////////////////////////////////////////////////////////
+
+void SdkPixelKernels::ResizeVertical(
+    const BYTE *pSrc,
+    UINT uSrcStride,
+    UINT uWidth,
+    BYTE *pDest,
+    UINT uDestHeight,
+    UINT uDestStride,
+    const vector<int> &vctBounds,
+    const vector<int> &vctWeights,
+    int nTaps)
+{
+    UINT32 nLevel = GetSimdLevel();
+    size_t nBytes = (size_t)uWidth * PIXEL_SIZE;
+    vector<int> vctSums(nBytes, 0);
+
+    // Each destination row is the weighted sum of some source rows, the bytes of the row
+    // are independent, so the SIMD code takes 16 bytes each time.
+    for (UINT y = 0; y < uDestHeight; ++y)
+    {
+        int nStart = vctBounds[2 * y];
+        int nCount = vctBounds[2 * y + 1];
+        const int *pWeights = &vctWeights[(size_t)y * nTaps];
+        BYTE *pDestRow = pDest + (size_t)y * uDestStride;
+        size_t nDone = 0;
+
+#if defined(PIXEL_HW_AVX2)
+        if (PIXEL_SIMD_AVX2 == nLevel)
+        {
+            nDone = PixelResizeColumnsAvx2(pSrc, uSrcStride, nBytes, pDestRow, nStart, nCount, pWeights);
+        }
+#elif defined(PIXEL_HW_NEON)
+        if (PIXEL_SIMD_NEON == nLevel)
+        {
+            nDone = PixelResizeColumnsNeon(pSrc, uSrcStride, nBytes, pDestRow, nStart, nCount, pWeights);
+        }
+#endif // PIXEL_HW_AVX2
+
+        PixelResizeColumnsScalar(pSrc, uSrcStride, nDone, nBytes, pDestRow, nStart, nCount, pWeights, &vctSums[0]);
+    }
+
+    (void)nLevel;
+}
+
+//////////////////////////////////////////////////////////////////////////
+
+UINT32 SdkPixelKernels::GetSupportedSimdLevel()
+{
+#if defined(PIXEL_HW_AVX2)
+    unsigned int ecx = 0;
+#ifdef _MSC_VER
+    int cpuInfo[4] = { 0 };
+    __cpuid(cpuInfo, 1);
+    ecx = (unsigned int)cpuInfo[2];
+#else
+    unsigned int eax = 0, ebx = 0, edx = 0;
+    if (!__get_cpuid(1, &eax, &ebx, &ecx, &edx))
+    {
+        return PIXEL_SIMD_NONE;
+    }
+#endif // _MSC_VER
+
+    // AVX2 also needs the OS to save the YMM registers.
+    if ( (0 == (ecx & (1 << 27))) || (0 == (ecx & (1 << 28))) )
+    {
+        return PIXEL_SIMD_NONE;
+    }
+
+#ifdef _MSC_VER
+    __cpuidex(cpuInfo, 7, 0);
+    unsigned int ebx7 = (unsigned int)cpuInfo[1];
+    unsigned int xcr0 = (unsigned int)_xgetbv(0);
+#else
+    unsigned int ebx7 = 0, xcr0 = 0, xcrHigh = 0;
+    if (__get_cpuid_max(0, NULL) >= 7)
+    {
+        __cpuid_count(7, 0, eax, ebx7, ecx, edx);
+    }
+    __asm__ ("xgetbv" : "=a"(xcr0), "=d"(xcrHigh) : "c"(0));
+#endif // _MSC_VER
+
+    if ( (0 != (ebx7 & (1 << 5))) && (6 == (xcr0 & 6)) )
+    {
+        return PIXEL_SIMD_AVX2;
+    }
+#elif defined(PIXEL_HW_NEON)
+    return PIXEL_SIMD_NEON;
+#endif // PIXEL_HW_AVX2
+
+    return PIXEL_SIMD_NONE;
+}
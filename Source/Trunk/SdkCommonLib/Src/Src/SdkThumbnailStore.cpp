@@ -0,0 +1,1220 @@
+/*!
+* @file SdkThumbnailStore.cpp
+*
+* @brief This file defines SdkThumbnailStore class to keep the thumbnails on the disk.
+*
+* Copyright (C) 2011, LZT Corporation.
+*
+* @author Li Hong
+* @date 2011/06/30
+*/
+
+#include "stdafx.h"
+#include "SdkThumbnailStore.h"
+#include "SdkCommonHelper.h"
+#include <process.h>
+#include <algorithm>
+
+USING_NAMESPACE_COMMON
+USING_NAMESPACE_UTILITIES
+
+#define THUMBNAIL_FILE_MAGIC            0x4D554854          // "THUM", the magic of the data file and the index file.
+#define THUMBNAIL_RECORD_MAGIC          0x44434552          // "RECD", the magic of a record.
+#define THUMBNAIL_STORE_VERSION         1                   // The version of the file format.
+#define THUMBNAIL_DATA_FILE             L"Thumbnails.dat"   // The name of the data file.
+#define THUMBNAIL_INDEX_FILE            L"Thumbnails.idx"   // The name of the index file.
+#define THUMBNAIL_TEMP_SUFFIX           L".tmp"             // The suffix of the files written by the compaction.
+#define THUMBNAIL_STORE_DIRECTORY       L"LightSDK\\Thumbnails"     // The default directory in the local application data.
+#define THUMBNAIL_MIN_SLOTS             1024                // The min count of the index slots, it is a power of 2.
+#define THUMBNAIL_RECORD_ALIGN          16                  // The alignment of the parts of a record.
+#define THUMBNAIL_RECORD_RLE            0x00000001          // The pixels of the record are run length encoded.
+#define THUMBNAIL_PIXEL_SIZE            4                   // The bytes of one 32bpp pixel.
+#define THUMBNAIL_RLE_RUN               0x80000000          // The control word is a run, the low bits are its length.
+#define THUMBNAIL_RLE_MIN_RUN           3                   // The min length of a run.
+
+#define THUMBNAIL_ALIGN(x)              (((x) + (THUMBNAIL_RECORD_ALIGN - 1)) & ~((UINT64)THUMBNAIL_RECORD_ALIGN - 1))
+
+
+/*!
+* @brief The header of the data file and the index file. The data file only uses the magic, the
+*        version and the generation, the index file keeps the state of the store.
+*/
+struct NAMESPACE_UTILITIES::_THUMBNAILFILEHEADER
+{
+    UINT32      uMagic;                                 // THUMBNAIL_FILE_MAGIC.
+    UINT32      uVersion;                               // THUMBNAIL_STORE_VERSION.
+    UINT64      uGeneration;                            // The index only works with the data file of the same generation.
+    UINT64      uDataSize;                              // The committed bytes of the data file.
+    UINT64      uDeadBytes;                             // The bytes of the replaced records.
+    UINT32      uSlotCount;                             // The count of the slots, it is a power of 2.
+    UINT32      uUsedCount;                             // The count of the used slots.
+    UINT64      uReserved;                              // Reserved.
+};
+
+/*!
+* @brief The header of a record in the data file, the lowercase path and the pixels follow it,
+*        each of them is aligned to THUMBNAIL_RECORD_ALIGN.
+*/
+struct NAMESPACE_UTILITIES::_THUMBNAILRECORD
+{
+    UINT32      uMagic;                                 // THUMBNAIL_RECORD_MAGIC.
+    UINT32      uFlags;                                 // THUMBNAIL_RECORD_RLE or 0.
+    UINT64      uKeyHash;                               // The hash of the key.
+    UINT64      uWriteTime;                             // The last write time of the file.
+    UINT64      uFileSize;                              // The size of the file.
+    UINT32      uReqWidth;                              // The requested width.
+    UINT32      uReqHeight;                             // The requested height.
+    UINT32      uWidth;                                 // The width of the thumbnail.
+    UINT32      uHeight;                                // The height of the thumbnail.
+    UINT32      cchPath;                                // The characters of the path, no terminator.
+    UINT32      cbPixels;                               // The bytes of the pixels.
+    UINT32      uKind;                                  // The kind of the image.
+    UINT32      uReserved;                              // Reserved.
+};
+
+/*!
+* @brief The slot of the index, the offset 0 means the slot is empty.
+*/
+struct NAMESPACE_UTILITIES::_THUMBNAILSLOT
+{
+    UINT64      uKeyHash;                               // The hash of the key.
+    UINT64      uOffset;                                // The offset of the record in the data file.
+    UINT32      uSize;                                  // The bytes of the record.
+    UINT32      uReserved;                              // Reserved.
+};
+
+/*!
+* @brief The key of a thumbnail.
+*/
+struct NAMESPACE_UTILITIES::_THUMBNAILKEY
+{
+    WCHAR       szPath[MAX_PATH];                       // The lowercase path.
+    UINT32      cchPath;                                // The characters of the path.
+    UINT64      uKeyHash;                               // The hash of the path, the size and the kind.
+    UINT64      uWriteTime;                             // The last write time of the file.
+    UINT64      uFileSize;                              // The size of the file.
+    UINT32      uReqWidth;                              // The requested width.
+    UINT32      uReqHeight;                             // The requested height.
+    UINT32      uKind;                                  // The kind of the image.
+};
+
+
+/*!
+* @brief The lock of the store is created when the module is loaded. The store should be
+*        closed by Close, the files are closed here if it is not.
+*/
+class NAMESPACE_UTILITIES::SdkThumbnailStoreLock
+{
+public:
+
+    SdkThumbnailStoreLock()
+    {
+        InitializeCriticalSection(&SdkThumbnailStore::s_csLock);
+    }
+
+    ~SdkThumbnailStoreLock()
+    {
+        // The threads are not waited here, the loader lock may be held.
+        EnterCriticalSection(&SdkThumbnailStore::s_csLock);
+        SdkThumbnailStore::s_isStopping = TRUE;
+        SdkThumbnailStore::CloseFiles();
+        LeaveCriticalSection(&SdkThumbnailStore::s_csLock);
+        DeleteCriticalSection(&SdkThumbnailStore::s_csLock);
+    }
+};
+
+
+CRITICAL_SECTION                SdkThumbnailStore::s_csLock;
+WCHAR                           SdkThumbnailStore::s_szDirectory[MAX_PATH] = { 0 };
+HANDLE                          SdkThumbnailStore::s_hDataFile = NULL;
+HANDLE                          SdkThumbnailStore::s_hIndexFile = NULL;
+HANDLE                          SdkThumbnailStore::s_hDataMapping = NULL;
+UINT64                          SdkThumbnailStore::s_uMappedSize = 0;
+HANDLE                          SdkThumbnailStore::s_hIndexMapping = NULL;
+LPTHUMBNAILFILEHEADER           SdkThumbnailStore::s_lpIndex = NULL;
+HANDLE                          SdkThumbnailStore::s_hCompactThread = NULL;
+BOOL                            SdkThumbnailStore::s_isCompacting = FALSE;
+BOOL                            SdkThumbnailStore::s_isStopping = FALSE;
+UINT64                          SdkThumbnailStore::s_uHits = 0;
+UINT64                          SdkThumbnailStore::s_uMisses = 0;
+UINT64                          SdkThumbnailStore::s_uInserts = 0;
+UINT32                          SdkThumbnailStore::s_uCompactions = 0;
+
+// It must be defined after the static members, it uses them when it is constructed.
+static SdkThumbnailStoreLock    g_thumbnailStoreLock;
+
+
+/*!
+* @brief Get the bytes of the record with its path and its pixels.
+*/
+static UINT64 GetRecordSize(const THUMBNAILRECORD *lpRecord)
+{
+    return sizeof(THUMBNAILRECORD) + THUMBNAIL_ALIGN((UINT64)lpRecord->cchPath * sizeof(WCHAR)) +
+           THUMBNAIL_ALIGN((UINT64)lpRecord->cbPixels);
+}
+
+/*!
+* @brief Indicates whether the header of the record is valid, the size is not bigger than the max record.
+*/
+static BOOL IsRecordValid(const THUMBNAILRECORD *lpRecord)
+{
+    UINT64 uPixelBytes = (UINT64)lpRecord->uWidth * lpRecord->uHeight * THUMBNAIL_PIXEL_SIZE;
+
+    return (THUMBNAIL_RECORD_MAGIC == lpRecord->uMagic) &&
+           (lpRecord->uWidth > 0) && (lpRecord->uWidth <= THUMBNAIL_STORE_MAX_SIZE) &&
+           (lpRecord->uHeight > 0) && (lpRecord->uHeight <= THUMBNAIL_STORE_MAX_SIZE) &&
+           (lpRecord->cchPath > 0) && (lpRecord->cchPath < MAX_PATH) &&
+           (0 == (lpRecord->cbPixels % THUMBNAIL_PIXEL_SIZE)) &&
+           ((lpRecord->uFlags & THUMBNAIL_RECORD_RLE) ? (lpRecord->cbPixels < uPixelBytes)
+                                                      : (lpRecord->cbPixels == uPixelBytes));
+}
+
+/*!
+* @brief The max bytes of one record.
+*/
+static UINT64 GetMaxRecordSize()
+{
+    return sizeof(THUMBNAILRECORD) + THUMBNAIL_ALIGN(MAX_PATH * sizeof(WCHAR)) +
+           (UINT64)THUMBNAIL_STORE_MAX_SIZE * THUMBNAIL_STORE_MAX_SIZE * THUMBNAIL_PIXEL_SIZE;
+}
+
+/*!
+* @brief Find the slot of the hash in the slots, the empty slot is returned if not found.
+*/
+static LPTHUMBNAILSLOT ProbeSlot(LPTHUMBNAILSLOT lpSlots, UINT32 uSlotCount, UINT64 uKeyHash)
+{
+    UINT32 uMask = uSlotCount - 1;
+    UINT32 uIndex = (UINT32)(uKeyHash ^ (uKeyHash >> 32)) & uMask;
+
+    // The index always has empty slots, it grows when half of the slots are used.
+    while ( (0 != lpSlots[uIndex].uOffset) && (lpSlots[uIndex].uKeyHash != uKeyHash) )
+    {
+        uIndex = (uIndex + 1) & uMask;
+    }
+
+    return &lpSlots[uIndex];
+}
+
+/*!
+* @brief The order of the slots by their offsets, the compaction reads the data file in order.
+*/
+static bool SlotOffsetLess(const THUMBNAILSLOT& first, const THUMBNAILSLOT& second)
+{
+    return (first.uOffset < second.uOffset);
+}
+
+/*!
+* @brief Read the bytes at the offset of the file.
+*/
+static BOOL ReadFileAt(HANDLE hFile, UINT64 uOffset, LPVOID lpBuffer, DWORD dwBytes)
+{
+    OVERLAPPED overlapped = { 0 };
+    overlapped.Offset     = (DWORD)uOffset;
+    overlapped.OffsetHigh = (DWORD)(uOffset >> 32);
+
+    DWORD dwRead = 0;
+    return ReadFile(hFile, lpBuffer, dwBytes, &dwRead, &overlapped) && (dwRead == dwBytes);
+}
+
+/*!
+* @brief Write the bytes at the offset of the file.
+*/
+static BOOL WriteFileAt(HANDLE hFile, UINT64 uOffset, LPCVOID lpBuffer, DWORD dwBytes)
+{
+    OVERLAPPED overlapped = { 0 };
+    overlapped.Offset     = (DWORD)uOffset;
+    overlapped.OffsetHigh = (DWORD)(uOffset >> 32);
+
+    DWORD dwWritten = 0;
+    return WriteFile(hFile, lpBuffer, dwBytes, &dwWritten, &overlapped) && (dwWritten == dwBytes);
+}
+
+/*!
+* @brief Get the last write time and the size of the file.
+*/
+static BOOL GetFileStamp(LPCWSTR lpPath, OUT UINT64& uWriteTime, OUT UINT64& uFileSize)
+{
+    WIN32_FILE_ATTRIBUTE_DATA fileData = { 0 };
+    if ( !GetFileAttributesExW(lpPath, GetFileExInfoStandard, &fileData) )
+    {
+        return FALSE;
+    }
+
+    uWriteTime = ((UINT64)fileData.ftLastWriteTime.dwHighDateTime << 32) | fileData.ftLastWriteTime.dwLowDateTime;
+    uFileSize  = ((UINT64)fileData.nFileSizeHigh << 32) | fileData.nFileSizeLow;
+
+    return TRUE;
+}
+
+/*!
+* @brief Encode the pixels by runs, the literal pixels are stored after their count and a run
+*        is stored as its length with THUMBNAIL_RLE_RUN and its pixel.
+*
+* @return TRUE if the encoded pixels are smaller than the pixels.
+*/
+static BOOL EncodePixels(const vector<UINT32>& vctPixels, OUT vector<UINT32>& vctEncoded)
+{
+    size_t nCount = vctPixels.size();
+    size_t i = 0;
+
+    vctEncoded.clear();
+    vctEncoded.reserve(nCount);
+
+    while (i < nCount)
+    {
+        size_t nRun = 1;
+        while ( (i + nRun < nCount) && (vctPixels[i + nRun] == vctPixels[i]) )
+        {
+            ++nRun;
+        }
+
+        if (nRun >= THUMBNAIL_RLE_MIN_RUN)
+        {
+            vctEncoded.push_back(THUMBNAIL_RLE_RUN | (UINT32)nRun);
+            vctEncoded.push_back(vctPixels[i]);
+            i += nRun;
+        }
+        else
+        {
+            // The literal pixels end before the next run.
+            size_t nEnd = i + nRun;
+            while (nEnd < nCount)
+            {
+                if ( (nEnd + THUMBNAIL_RLE_MIN_RUN <= nCount) &&
+                     (vctPixels[nEnd] == vctPixels[nEnd + 1]) && (vctPixels[nEnd] == vctPixels[nEnd + 2]) )
+                {
+                    break;
+                }
+                ++nEnd;
+            }
+
+            vctEncoded.push_back((UINT32)(nEnd - i));
+            vctEncoded.insert(vctEncoded.end(), vctPixels.begin() + i, vctPixels.begin() + nEnd);
+            i = nEnd;
+        }
+
+        if (vctEncoded.size() >= nCount)
+        {
+            return FALSE;
+        }
+    }
+
+    return TRUE;
+}
+
+/*!
+* @brief Decode the pixels encoded by EncodePixels, the broken data is checked.
+*/
+static BOOL DecodePixels(const UINT32 *pEncoded, size_t nWords, OUT UINT32 *pPixels, size_t nCount)
+{
+    size_t i = 0;
+    size_t nPixel = 0;
+
+    while (i < nWords)
+    {
+        UINT32 uControl = pEncoded[i++];
+        size_t nLength = uControl & ~THUMBNAIL_RLE_RUN;
+
+        if ( (0 == nLength) || (nLength > nCount - nPixel) )
+        {
+            return FALSE;
+        }
+
+        if (uControl & THUMBNAIL_RLE_RUN)
+        {
+            if (i >= nWords)
+            {
+                return FALSE;
+            }
+
+            UINT32 uPixel = pEncoded[i++];
+            for (size_t n = 0; n < nLength; ++n)
+            {
+                pPixels[nPixel++] = uPixel;
+            }
+        }
+        else
+        {
+            if (nLength > nWords - i)
+            {
+                return FALSE;
+            }
+
+            memcpy(pPixels + nPixel, pEncoded + i, nLength * THUMBNAIL_PIXEL_SIZE);
+            nPixel += nLength;
+            i += nLength;
+        }
+    }
+
+    return (nPixel == nCount);
+}
+
+
+//////////////////////////////////////////////////////////////////////////
+
+BOOL SdkThumbnailStore::Open(IN LPCWSTR lpDirectory)
+{
+    EnterCriticalSection(&s_csLock);
+
+    BOOL isOpen = (NULL != s_lpIndex);
+    if ( !isOpen && !s_isStopping )
+    {
+        WCHAR szDirectory[MAX_PATH] = { 0 };
+        if (NULL != lpDirectory)
+        {
+            StringCchCopyW(szDirectory, MAX_PATH, lpDirectory);
+        }
+        else if ( SdkCommonHelper::GetKnownFolderPath(szDirectory, CSIDL_LOCAL_APPDATA) )
+        {
+            PathAppendW(szDirectory, THUMBNAIL_STORE_DIRECTORY);
+        }
+
+        if ( (0 != szDirectory[0]) && (PathIsDirectoryW(szDirectory) || SdkCommonHelper::CreateFolder(szDirectory)) )
+        {
+            // The files may be left open by a failed mapping.
+            CloseFiles();
+            StringCchCopyW(s_szDirectory, MAX_PATH, szDirectory);
+            isOpen = OpenFiles();
+        }
+    }
+
+    LeaveCriticalSection(&s_csLock);
+
+    return isOpen;
+}
+
+//////////////////////////////////////////////////////////////////////////
+
+void SdkThumbnailStore::Close()
+{
+    EnterCriticalSection(&s_csLock);
+    s_isStopping = TRUE;
+    HANDLE hThread = s_hCompactThread;
+    s_hCompactThread = NULL;
+    LeaveCriticalSection(&s_csLock);
+
+    // The compaction takes the lock at last, so it is waited without the lock.
+    if (NULL != hThread)
+    {
+        WaitForSingleObject(hThread, INFINITE);
+        CloseHandle(hThread);
+    }
+
+    EnterCriticalSection(&s_csLock);
+    CloseFiles();
+    s_isCompacting = FALSE;
+    s_isStopping = FALSE;
+    LeaveCriticalSection(&s_csLock);
+}
+
+//////////////////////////////////////////////////////////////////////////
+
+BOOL SdkThumbnailStore::IsOpen()
+{
+    EnterCriticalSection(&s_csLock);
+    BOOL isOpen = (NULL != s_lpIndex);
+    LeaveCriticalSection(&s_csLock);
+
+    return isOpen;
+}
+
+//////////////////////////////////////////////////////////////////////////
+
+HBITMAP SdkThumbnailStore::Lookup(IN LPCWSTR lpPath, IN UINT32 uWidth, IN UINT32 uHeight, IN UINT32 uKind)
+{
+    THUMBNAILKEY key;
+    if ( !MakeKey(lpPath, uWidth, uHeight, uKind, &key) )
+    {
+        return NULL;
+    }
+
+    HBITMAP hBitmap = NULL;
+
+    EnterCriticalSection(&s_csLock);
+
+    if (NULL != s_lpIndex)
+    {
+        LPTHUMBNAILSLOT lpSlot = FindSlot(key.uKeyHash);
+        if (0 != lpSlot->uOffset)
+        {
+            hBitmap = LoadRecord(lpSlot->uOffset, &key);
+        }
+
+        if (NULL != hBitmap)
+        {
+            ++s_uHits;
+        }
+        else
+        {
+            ++s_uMisses;
+        }
+    }
+
+    LeaveCriticalSection(&s_csLock);
+
+    return hBitmap;
+}
+
+//////////////////////////////////////////////////////////////////////////
+
+BOOL SdkThumbnailStore::Insert(IN LPCWSTR lpPath, IN UINT32 uWidth, IN UINT32 uHeight,
+                               IN HBITMAP hBitmap, IN UINT32 uKind)
+{
+    BITMAP bitmap = { 0 };
+    if ( (NULL == hBitmap) || (0 == GetObject(hBitmap, sizeof(BITMAP), &bitmap)) )
+    {
+        return FALSE;
+    }
+
+    UINT32 uBmpWidth  = (UINT32)bitmap.bmWidth;
+    UINT32 uBmpHeight = (UINT32)abs(bitmap.bmHeight);
+    if ( (0 == uBmpWidth) || (0 == uBmpHeight) ||
+         (uBmpWidth > THUMBNAIL_STORE_MAX_SIZE) || (uBmpHeight > THUMBNAIL_STORE_MAX_SIZE) )
+    {
+        return FALSE;
+    }
+
+    THUMBNAILKEY key;
+    if ( !MakeKey(lpPath, uWidth, uHeight, uKind, &key) )
+    {
+        return FALSE;
+    }
+
+    BITMAPINFO bmi = { 0 };
+    bmi.bmiHeader.biSize        = sizeof(BITMAPINFOHEADER);
+    bmi.bmiHeader.biWidth       = uBmpWidth;
+    bmi.bmiHeader.biHeight      = -(int)uBmpHeight;
+    bmi.bmiHeader.biPlanes      = 1;
+    bmi.bmiHeader.biBitCount    = 32;
+    bmi.bmiHeader.biCompression = BI_RGB;
+
+    vector<UINT32> vctPixels(uBmpWidth * uBmpHeight, 0);
+    HDC hdcScreen = GetDC(NULL);
+    int nLines = GetDIBits(hdcScreen, hBitmap, 0, uBmpHeight, &vctPixels[0], &bmi, DIB_RGB_COLORS);
+    ReleaseDC(NULL, hdcScreen);
+
+    if (nLines != (int)uBmpHeight)
+    {
+        return FALSE;
+    }
+
+    // The flat images such as the icons are much smaller by runs, the photos are stored as they are.
+    vector<UINT32> vctEncoded;
+    BOOL isEncoded = EncodePixels(vctPixels, vctEncoded);
+    const vector<UINT32>& vctStored = isEncoded ? vctEncoded : vctPixels;
+
+    THUMBNAILRECORD record = { 0 };
+    record.uMagic     = THUMBNAIL_RECORD_MAGIC;
+    record.uFlags     = isEncoded ? THUMBNAIL_RECORD_RLE : 0;
+    record.uKeyHash   = key.uKeyHash;
+    record.uWriteTime = key.uWriteTime;
+    record.uFileSize  = key.uFileSize;
+    record.uReqWidth  = key.uReqWidth;
+    record.uReqHeight = key.uReqHeight;
+    record.uWidth     = uBmpWidth;
+    record.uHeight    = uBmpHeight;
+    record.cchPath    = key.cchPath;
+    record.cbPixels   = (UINT32)(vctStored.size() * THUMBNAIL_PIXEL_SIZE);
+    record.uKind      = key.uKind;
+
+    UINT64 uPathBytes = THUMBNAIL_ALIGN((UINT64)key.cchPath * sizeof(WCHAR));
+    UINT64 uRecordSize = GetRecordSize(&record);
+    vector<BYTE> vctRecord((size_t)uRecordSize, 0);
+    memcpy(&vctRecord[0], &record, sizeof(THUMBNAILRECORD));
+    memcpy(&vctRecord[sizeof(THUMBNAILRECORD)], key.szPath, key.cchPath * sizeof(WCHAR));
+    memcpy(&vctRecord[(size_t)(sizeof(THUMBNAILRECORD) + uPathBytes)], &vctStored[0], record.cbPixels);
+
+    BOOL isStored = FALSE;
+    BOOL needCompact = FALSE;
+
+    EnterCriticalSection(&s_csLock);
+
+    if ( (NULL != s_lpIndex) && (s_lpIndex->uDataSize + uRecordSize <= THUMBNAIL_STORE_MAX_BYTES) )
+    {
+        BOOL hasRoom = TRUE;
+        if ( (s_lpIndex->uUsedCount + 1) * 2 > s_lpIndex->uSlotCount )
+        {
+            hasRoom = GrowIndex() && (NULL != s_lpIndex);
+        }
+
+        // The record is written before the index points to it, a broken write is never found.
+        UINT64 uOffset = hasRoom ? s_lpIndex->uDataSize : 0;
+        if ( hasRoom && WriteFileAt(s_hDataFile, uOffset, &vctRecord[0], (DWORD)uRecordSize) )
+        {
+            LPTHUMBNAILSLOT lpSlot = FindSlot(key.uKeyHash);
+            if (0 != lpSlot->uOffset)
+            {
+                s_lpIndex->uDeadBytes += lpSlot->uSize;
+            }
+            else
+            {
+                s_lpIndex->uUsedCount++;
+            }
+
+            lpSlot->uKeyHash = key.uKeyHash;
+            lpSlot->uOffset  = uOffset;
+            lpSlot->uSize    = (UINT32)uRecordSize;
+            s_lpIndex->uDataSize += uRecordSize;
+            ++s_uInserts;
+            isStored = TRUE;
+        }
+    }
+
+    if (NULL != s_lpIndex)
+    {
+        needCompact = (s_lpIndex->uDeadBytes >= THUMBNAIL_STORE_COMPACT_BYTES) &&
+                      (s_lpIndex->uDeadBytes * 2 >= s_lpIndex->uDataSize);
+    }
+
+    LeaveCriticalSection(&s_csLock);
+
+    if (needCompact)
+    {
+        StartCompaction();
+    }
+
+    return isStored;
+}
+
+//////////////////////////////////////////////////////////////////////////
+
+BOOL SdkThumbnailStore::StartCompaction()
+{
+    EnterCriticalSection(&s_csLock);
+
+    BOOL isRunning = s_isCompacting;
+    if ( !isRunning && !s_isStopping && (NULL != s_lpIndex) )
+    {
+        // The last compaction has exited.
+        if (NULL != s_hCompactThread)
+        {
+            CloseHandle(s_hCompactThread);
+            s_hCompactThread = NULL;
+        }
+
+        unsigned int dwThreadId = 0;
+        s_hCompactThread = (HANDLE)_beginthreadex(
+            NULL,
+            0,
+            SdkThumbnailStore::CompactThreadProc,
+            NULL,
+            0,
+            &dwThreadId);
+
+        s_isCompacting = (NULL != s_hCompactThread);
+        isRunning = s_isCompacting;
+    }
+
+    LeaveCriticalSection(&s_csLock);
+
+    return isRunning;
+}
+
+//////////////////////////////////////////////////////////////////////////
+
+void SdkThumbnailStore::GetStats(OUT LPTHUMBNAILSTORESTATS pStats)
+{
+    if (NULL == pStats)
+    {
+        return;
+    }
+
+    ZeroMemory(pStats, sizeof(THUMBNAILSTORESTATS));
+
+    EnterCriticalSection(&s_csLock);
+
+    pStats->uHits        = s_uHits;
+    pStats->uMisses      = s_uMisses;
+    pStats->uInserts     = s_uInserts;
+    pStats->uCompactions = s_uCompactions;
+    if (NULL != s_lpIndex)
+    {
+        pStats->uDataBytes = s_lpIndex->uDataSize;
+        pStats->uDeadBytes = s_lpIndex->uDeadBytes;
+        pStats->uEntries   = s_lpIndex->uUsedCount;
+    }
+
+    LeaveCriticalSection(&s_csLock);
+}
+
+//////////////////////////////////////////////////////////////////////////
+
+BOOL SdkThumbnailStore::MakeKey(IN LPCWSTR lpPath, IN UINT32 uWidth, IN UINT32 uHeight,
+                                IN UINT32 uKind, OUT LPTHUMBNAILKEY lpKey)
+{
+    ZeroMemory(lpKey, sizeof(THUMBNAILKEY));
+
+    if ( (NULL == lpPath) || FAILED(StringCchCopyW(lpKey->szPath, MAX_PATH, lpPath)) ||
+         !GetFileStamp(lpPath, lpKey->uWriteTime, lpKey->uFileSize) )
+    {
+        return FALSE;
+    }
+
+    // The paths are not case sensitive.
+    CharLowerW(lpKey->szPath);
+    lpKey->cchPath    = (UINT32)wcslen(lpKey->szPath);
+    lpKey->uReqWidth  = uWidth;
+    lpKey->uReqHeight = uHeight;
+    lpKey->uKind      = uKind;
+
+    // The FNV-1a hash, the time and the size of the file are not hashed, so the thumbnail
+    // of a changed file replaces the old one.
+    UINT32 uParams[3] = { uWidth, uHeight, uKind };
+    const BYTE *pBytes[2] = { (const BYTE*)lpKey->szPath, (const BYTE*)uParams };
+    size_t nBytes[2] = { lpKey->cchPath * sizeof(WCHAR), sizeof(uParams) };
+
+    UINT64 uHash = 14695981039346656037ULL;
+    for (int n = 0; n < 2; ++n)
+    {
+        for (size_t i = 0; i < nBytes[n]; ++i)
+        {
+            uHash ^= pBytes[n][i];
+            uHash *= 1099511628211ULL;
+        }
+    }
+    lpKey->uKeyHash = uHash;
+
+    return TRUE;
+}
+
+//////////////////////////////////////////////////////////////////////////
+
+BOOL SdkThumbnailStore::OpenFiles()
+{
+    WCHAR szDataFile[MAX_PATH] = { 0 };
+    WCHAR szIndexFile[MAX_PATH] = { 0 };
+    StringCchPrintfW(szDataFile, MAX_PATH, L"%s\\%s", s_szDirectory, THUMBNAIL_DATA_FILE);
+    StringCchPrintfW(szIndexFile, MAX_PATH, L"%s\\%s", s_szDirectory, THUMBNAIL_INDEX_FILE);
+
+    // The compaction reads the data file by another handle, the index is only used by the store.
+    s_hDataFile = CreateFileW(szDataFile, GENERIC_READ | GENERIC_WRITE, FILE_SHARE_READ,
+                              NULL, OPEN_ALWAYS, FILE_ATTRIBUTE_NORMAL, NULL);
+    s_hIndexFile = CreateFileW(szIndexFile, GENERIC_READ | GENERIC_WRITE, 0,
+                               NULL, OPEN_ALWAYS, FILE_ATTRIBUTE_NORMAL, NULL);
+
+    if (INVALID_HANDLE_VALUE == s_hDataFile)
+    {
+        s_hDataFile = NULL;
+    }
+    if (INVALID_HANDLE_VALUE == s_hIndexFile)
+    {
+        s_hIndexFile = NULL;
+    }
+    if ( (NULL == s_hDataFile) || (NULL == s_hIndexFile) )
+    {
+        CloseFiles();
+        return FALSE;
+    }
+
+    THUMBNAILFILEHEADER dataHeader = { 0 };
+    THUMBNAILFILEHEADER indexHeader = { 0 };
+    LARGE_INTEGER liDataSize = { 0 };
+    LARGE_INTEGER liIndexSize = { 0 };
+
+    BOOL isValid = GetFileSizeEx(s_hDataFile, &liDataSize) && GetFileSizeEx(s_hIndexFile, &liIndexSize) &&
+                   ReadFileAt(s_hDataFile, 0, &dataHeader, sizeof(THUMBNAILFILEHEADER)) &&
+                   ReadFileAt(s_hIndexFile, 0, &indexHeader, sizeof(THUMBNAILFILEHEADER));
+
+    if (isValid)
+    {
+        UINT32 uSlotCount = indexHeader.uSlotCount;
+        isValid = (THUMBNAIL_FILE_MAGIC == dataHeader.uMagic) && (THUMBNAIL_STORE_VERSION == dataHeader.uVersion) &&
+                  (THUMBNAIL_FILE_MAGIC == indexHeader.uMagic) && (THUMBNAIL_STORE_VERSION == indexHeader.uVersion) &&
+                  (dataHeader.uGeneration == indexHeader.uGeneration) &&
+                  (uSlotCount >= THUMBNAIL_MIN_SLOTS) && (0 == (uSlotCount & (uSlotCount - 1))) &&
+                  (indexHeader.uUsedCount < uSlotCount) &&
+                  ((UINT64)liIndexSize.QuadPart == sizeof(THUMBNAILFILEHEADER) + (UINT64)uSlotCount * sizeof(THUMBNAILSLOT)) &&
+                  (indexHeader.uDataSize >= sizeof(THUMBNAILFILEHEADER)) &&
+                  (indexHeader.uDataSize <= (UINT64)liDataSize.QuadPart);
+    }
+
+    if (isValid)
+    {
+        // The tail which is not committed to the index is dropped.
+        if ( (UINT64)liDataSize.QuadPart > indexHeader.uDataSize )
+        {
+            LARGE_INTEGER liSize = { 0 };
+            liSize.QuadPart = (LONGLONG)indexHeader.uDataSize;
+            isValid = SetFilePointerEx(s_hDataFile, liSize, NULL, FILE_BEGIN) && SetEndOfFile(s_hDataFile);
+        }
+
+        isValid = isValid && MapIndex(indexHeader.uSlotCount);
+    }
+
+    if ( !isValid && !ResetFiles() )
+    {
+        CloseFiles();
+        return FALSE;
+    }
+
+    return TRUE;
+}
+
+//////////////////////////////////////////////////////////////////////////
+
+void SdkThumbnailStore::CloseFiles()
+{
+    if (NULL != s_lpIndex)
+    {
+        UnmapViewOfFile(s_lpIndex);
+        s_lpIndex = NULL;
+    }
+
+    if (NULL != s_hIndexMapping)
+    {
+        CloseHandle(s_hIndexMapping);
+        s_hIndexMapping = NULL;
+    }
+
+    if (NULL != s_hDataMapping)
+    {
+        CloseHandle(s_hDataMapping);
+        s_hDataMapping = NULL;
+    }
+    s_uMappedSize = 0;
+
+    if (NULL != s_hIndexFile)
+    {
+        CloseHandle(s_hIndexFile);
+        s_hIndexFile = NULL;
+    }
+
+    if (NULL != s_hDataFile)
+    {
+        CloseHandle(s_hDataFile);
+        s_hDataFile = NULL;
+    }
+}
+
+//////////////////////////////////////////////////////////////////////////
+
+BOOL SdkThumbnailStore::ResetFiles()
+{
+    if (NULL != s_lpIndex)
+    {
+        UnmapViewOfFile(s_lpIndex);
+        s_lpIndex = NULL;
+    }
+
+    if (NULL != s_hIndexMapping)
+    {
+        CloseHandle(s_hIndexMapping);
+        s_hIndexMapping = NULL;
+    }
+
+    // The generation is the time, so an index never matches a data file created again.
+    FILETIME ftNow = { 0 };
+    GetSystemTimeAsFileTime(&ftNow);
+
+    THUMBNAILFILEHEADER header = { 0 };
+    header.uMagic      = THUMBNAIL_FILE_MAGIC;
+    header.uVersion    = THUMBNAIL_STORE_VERSION;
+    header.uGeneration = ((UINT64)ftNow.dwHighDateTime << 32) | ftNow.dwLowDateTime;
+    header.uDataSize   = sizeof(THUMBNAILFILEHEADER);
+    header.uSlotCount  = THUMBNAIL_MIN_SLOTS;
+
+    LARGE_INTEGER liZero = { 0 };
+    BOOL isSucceed = SetFilePointerEx(s_hDataFile, liZero, NULL, FILE_BEGIN) && SetEndOfFile(s_hDataFile) &&
+                     SetFilePointerEx(s_hIndexFile, liZero, NULL, FILE_BEGIN) && SetEndOfFile(s_hIndexFile) &&
+                     WriteFileAt(s_hDataFile, 0, &header, sizeof(THUMBNAILFILEHEADER)) &&
+                     WriteFileAt(s_hIndexFile, 0, &header, sizeof(THUMBNAILFILEHEADER));
+
+    // The mapping extends the index file with the zero slots.
+    return isSucceed && MapIndex(THUMBNAIL_MIN_SLOTS);
+}
+
+//////////////////////////////////////////////////////////////////////////
+
+BOOL SdkThumbnailStore::MapIndex(IN UINT32 uSlotCount)
+{
+    if (NULL != s_lpIndex)
+    {
+        UnmapViewOfFile(s_lpIndex);
+        s_lpIndex = NULL;
+    }
+
+    if (NULL != s_hIndexMapping)
+    {
+        CloseHandle(s_hIndexMapping);
+        s_hIndexMapping = NULL;
+    }
+
+    UINT64 uSize = sizeof(THUMBNAILFILEHEADER) + (UINT64)uSlotCount * sizeof(THUMBNAILSLOT);
+    s_hIndexMapping = CreateFileMappingW(s_hIndexFile, NULL, PAGE_READWRITE,
+                                         (DWORD)(uSize >> 32), (DWORD)uSize, NULL);
+    if (NULL == s_hIndexMapping)
+    {
+        return FALSE;
+    }
+
+    s_lpIndex = (LPTHUMBNAILFILEHEADER)MapViewOfFile(s_hIndexMapping, FILE_MAP_WRITE, 0, 0, (SIZE_T)uSize);
+    if (NULL == s_lpIndex)
+    {
+        CloseHandle(s_hIndexMapping);
+        s_hIndexMapping = NULL;
+        return FALSE;
+    }
+
+    return TRUE;
+}
+
+//////////////////////////////////////////////////////////////////////////
+
+LPTHUMBNAILSLOT SdkThumbnailStore::FindSlot(IN UINT64 uKeyHash)
+{
+    return ProbeSlot((LPTHUMBNAILSLOT)(s_lpIndex + 1), s_lpIndex->uSlotCount, uKeyHash);
+}
+
+//////////////////////////////////////////////////////////////////////////
+
+BOOL SdkThumbnailStore::GrowIndex()
+{
+    UINT32 uSlotCount = s_lpIndex->uSlotCount;
+    LPTHUMBNAILSLOT lpSlots = (LPTHUMBNAILSLOT)(s_lpIndex + 1);
+
+    vector<THUMBNAILSLOT> vctSlots;
+    vctSlots.reserve(s_lpIndex->uUsedCount);
+    for (UINT32 i = 0; i < uSlotCount; ++i)
+    {
+        if (0 != lpSlots[i].uOffset)
+        {
+            vctSlots.push_back(lpSlots[i]);
+        }
+    }
+
+    // The old slot count is mapped again if the index can not grow, it is still usable.
+    if ( !MapIndex(uSlotCount * 2) )
+    {
+        MapIndex(uSlotCount);
+        return FALSE;
+    }
+
+    s_lpIndex->uSlotCount = uSlotCount * 2;
+    lpSlots = (LPTHUMBNAILSLOT)(s_lpIndex + 1);
+    ZeroMemory(lpSlots, (SIZE_T)s_lpIndex->uSlotCount * sizeof(THUMBNAILSLOT));
+
+    for (vector<THUMBNAILSLOT>::iterator iter = vctSlots.begin(); iter != vctSlots.end(); ++iter)
+    {
+        *ProbeSlot(lpSlots, s_lpIndex->uSlotCount, iter->uKeyHash) = *iter;
+    }
+
+    return TRUE;
+}
+
+//////////////////////////////////////////////////////////////////////////
+
+HBITMAP SdkThumbnailStore::LoadRecord(IN UINT64 uOffset, IN const THUMBNAILKEY *lpKey)
+{
+    UINT64 uDataSize = s_lpIndex->uDataSize;
+    if (uOffset + sizeof(THUMBNAILRECORD) > uDataSize)
+    {
+        return NULL;
+    }
+
+    // The mapping is created again when the data file grows.
+    if (s_uMappedSize < uDataSize)
+    {
+        if (NULL != s_hDataMapping)
+        {
+            CloseHandle(s_hDataMapping);
+            s_hDataMapping = NULL;
+        }
+
+        s_hDataMapping = CreateFileMappingW(s_hDataFile, NULL, PAGE_READONLY,
+                                            (DWORD)(uDataSize >> 32), (DWORD)uDataSize, NULL);
+        s_uMappedSize = (NULL != s_hDataMapping) ? uDataSize : 0;
+        if (NULL == s_hDataMapping)
+        {
+            return NULL;
+        }
+    }
+
+    // Only the view of the record is mapped, the data file may be bigger than the address space.
+    static DWORD s_dwGranularity = 0;
+    if (0 == s_dwGranularity)
+    {
+        SYSTEM_INFO sysInfo = { 0 };
+        GetSystemInfo(&sysInfo);
+        s_dwGranularity = sysInfo.dwAllocationGranularity;
+    }
+
+    UINT64 uViewOffset = uOffset - (uOffset % s_dwGranularity);
+    UINT64 uViewSize = min(uDataSize - uOffset, GetMaxRecordSize()) + (uOffset - uViewOffset);
+    LPBYTE lpView = (LPBYTE)MapViewOfFile(s_hDataMapping, FILE_MAP_READ, (DWORD)(uViewOffset >> 32),
+                                          (DWORD)uViewOffset, (SIZE_T)uViewSize);
+    if (NULL == lpView)
+    {
+        return NULL;
+    }
+
+    const BYTE *pRecord = lpView + (uOffset - uViewOffset);
+    const THUMBNAILRECORD *lpRecord = (const THUMBNAILRECORD*)pRecord;
+    UINT64 uAvailable = uDataSize - uOffset;
+
+    BOOL isMatched = IsRecordValid(lpRecord) && (GetRecordSize(lpRecord) <= uAvailable) &&
+                     (lpRecord->uKeyHash == lpKey->uKeyHash) &&
+                     (lpRecord->uWriteTime == lpKey->uWriteTime) &&
+                     (lpRecord->uFileSize == lpKey->uFileSize) &&
+                     (lpRecord->uReqWidth == lpKey->uReqWidth) &&
+                     (lpRecord->uReqHeight == lpKey->uReqHeight) &&
+                     (lpRecord->uKind == lpKey->uKind) &&
+                     (lpRecord->cchPath == lpKey->cchPath) &&
+                     (0 == memcmp(pRecord + sizeof(THUMBNAILRECORD), lpKey->szPath, lpKey->cchPath * sizeof(WCHAR)));
+
+    HBITMAP hBitmap = NULL;
+    if (isMatched)
+    {
+        BITMAPINFO bmi = { 0 };
+        bmi.bmiHeader.biSize        = sizeof(BITMAPINFOHEADER);
+        bmi.bmiHeader.biWidth       = lpRecord->uWidth;
+        bmi.bmiHeader.biHeight      = -(int)lpRecord->uHeight;
+        bmi.bmiHeader.biPlanes      = 1;
+        bmi.bmiHeader.biBitCount    = 32;
+        bmi.bmiHeader.biCompression = BI_RGB;
+
+        LPVOID pvBits = NULL;
+        hBitmap = CreateDIBSection(NULL, &bmi, DIB_RGB_COLORS, &pvBits, NULL, 0);
+
+        if (NULL != hBitmap)
+        {
+            const BYTE *pPixels = pRecord + sizeof(THUMBNAILRECORD) + THUMBNAIL_ALIGN((UINT64)lpRecord->cchPath * sizeof(WCHAR));
+            size_t nCount = (size_t)lpRecord->uWidth * lpRecord->uHeight;
+
+            if (lpRecord->uFlags & THUMBNAIL_RECORD_RLE)
+            {
+                if ( !DecodePixels((const UINT32*)pPixels, lpRecord->cbPixels / THUMBNAIL_PIXEL_SIZE, (UINT32*)pvBits, nCount) )
+                {
+                    DeleteObject(hBitmap);
+                    hBitmap = NULL;
+                }
+            }
+            else
+            {
+                memcpy(pvBits, pPixels, lpRecord->cbPixels);
+            }
+        }
+    }
+
+    UnmapViewOfFile(lpView);
+
+    return hBitmap;
+}
+
+//////////////////////////////////////////////////////////////////////////
+
+BOOL SdkThumbnailStore::ReadRecord(IN HANDLE hFile, IN UINT64 uOffset, OUT vector<BYTE>& vctRecord)
+{
+    THUMBNAILRECORD record = { 0 };
+    if ( !ReadFileAt(hFile, uOffset, &record, sizeof(THUMBNAILRECORD)) || !IsRecordValid(&record) )
+    {
+        return FALSE;
+    }
+
+    vctRecord.resize((size_t)GetRecordSize(&record));
+
+    return ReadFileAt(hFile, uOffset, &vctRecord[0], (DWORD)vctRecord.size());
+}
+
+//////////////////////////////////////////////////////////////////////////
+
+void SdkThumbnailStore::CompactFiles()
+{
+    WCHAR szDataFile[MAX_PATH] = { 0 };
+    WCHAR szIndexFile[MAX_PATH] = { 0 };
+    WCHAR szTempDataFile[MAX_PATH] = { 0 };
+    WCHAR szTempIndexFile[MAX_PATH] = { 0 };
+
+    // Take the live slots, the records are copied without the lock.
+    EnterCriticalSection(&s_csLock);
+
+    if ( (NULL == s_lpIndex) || s_isStopping )
+    {
+        LeaveCriticalSection(&s_csLock);
+        return;
+    }
+
+    StringCchPrintfW(szDataFile, MAX_PATH, L"%s\\%s", s_szDirectory, THUMBNAIL_DATA_FILE);
+    StringCchPrintfW(szIndexFile, MAX_PATH, L"%s\\%s", s_szDirectory, THUMBNAIL_INDEX_FILE);
+    StringCchPrintfW(szTempDataFile, MAX_PATH, L"%s%s", szDataFile, THUMBNAIL_TEMP_SUFFIX);
+    StringCchPrintfW(szTempIndexFile, MAX_PATH, L"%s%s", szIndexFile, THUMBNAIL_TEMP_SUFFIX);
+
+    UINT64 uGeneration = s_lpIndex->uGeneration;
+    UINT64 uSnapshotSize = s_lpIndex->uDataSize;
+    LPTHUMBNAILSLOT lpSlots = (LPTHUMBNAILSLOT)(s_lpIndex + 1);
+    vector<THUMBNAILSLOT> vctSlots;
+    for (UINT32 i = 0; i < s_lpIndex->uSlotCount; ++i)
+    {
+        if (0 != lpSlots[i].uOffset)
+        {
+            vctSlots.push_back(lpSlots[i]);
+        }
+    }
+
+    LeaveCriticalSection(&s_csLock);
+
+    sort(vctSlots.begin(), vctSlots.end(), SlotOffsetLess);
+
+    HANDLE hSource = CreateFileW(szDataFile, GENERIC_READ, FILE_SHARE_READ | FILE_SHARE_WRITE,
+                                 NULL, OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, NULL);
+    HANDLE hTempData = CreateFileW(szTempDataFile, GENERIC_READ | GENERIC_WRITE, 0,
+                                   NULL, CREATE_ALWAYS, FILE_ATTRIBUTE_NORMAL, NULL);
+    HANDLE hTempIndex = CreateFileW(szTempIndexFile, GENERIC_READ | GENERIC_WRITE, 0,
+                                    NULL, CREATE_ALWAYS, FILE_ATTRIBUTE_NORMAL, NULL);
+
+    BOOL isSucceed = (INVALID_HANDLE_VALUE != hSource) && (INVALID_HANDLE_VALUE != hTempData) &&
+                     (INVALID_HANDLE_VALUE != hTempIndex);
+
+    // The records of the changed or removed files are dropped.
+    map<UINT64, UINT64> mapMoved;
+    UINT64 uNewSize = sizeof(THUMBNAILFILEHEADER);
+    vector<BYTE> vctRecord;
+
+    for (vector<THUMBNAILSLOT>::iterator iter = vctSlots.begin(); isSucceed && (iter != vctSlots.end()); ++iter)
+    {
+        if (s_isStopping)
+        {
+            isSucceed = FALSE;
+            break;
+        }
+
+        if ( !ReadRecord(hSource, iter->uOffset, vctRecord) )
+        {
+            continue;
+        }
+
+        const THUMBNAILRECORD *lpRecord = (const THUMBNAILRECORD*)&vctRecord[0];
+        WCHAR szPath[MAX_PATH] = { 0 };
+        memcpy(szPath, &vctRecord[sizeof(THUMBNAILRECORD)], lpRecord->cchPath * sizeof(WCHAR));
+
+        UINT64 uWriteTime = 0;
+        UINT64 uFileSize = 0;
+        if ( !GetFileStamp(szPath, uWriteTime, uFileSize) ||
+             (uWriteTime != lpRecord->uWriteTime) || (uFileSize != lpRecord->uFileSize) )
+        {
+            continue;
+        }
+
+        isSucceed = WriteFileAt(hTempData, uNewSize, &vctRecord[0], (DWORD)vctRecord.size());
+        mapMoved[iter->uOffset] = uNewSize;
+        uNewSize += vctRecord.size();
+    }
+
+    if (INVALID_HANDLE_VALUE != hSource)
+    {
+        CloseHandle(hSource);
+    }
+
+    EnterCriticalSection(&s_csLock);
+
+    // The store may be closed or opened again while copying.
+    isSucceed = isSucceed && !s_isStopping && (NULL != s_lpIndex) && (s_lpIndex->uGeneration == uGeneration);
+
+    if (isSucceed)
+    {
+        UINT32 uSlotCount = s_lpIndex->uSlotCount;
+        UINT32 uNewSlotCount = THUMBNAIL_MIN_SLOTS;
+        while ( (s_lpIndex->uUsedCount + 1) * 2 > uNewSlotCount )
+        {
+            uNewSlotCount *= 2;
+        }
+
+        vector<BYTE> vctIndex(sizeof(THUMBNAILFILEHEADER) + (size_t)uNewSlotCount * sizeof(THUMBNAILSLOT), 0);
+        LPTHUMBNAILFILEHEADER lpNewHeader = (LPTHUMBNAILFILEHEADER)&vctIndex[0];
+        LPTHUMBNAILSLOT lpNewSlots = (LPTHUMBNAILSLOT)(lpNewHeader + 1);
+
+        // The records replaced while copying are dead in the new data file.
+        UINT64 uLiveBytes = 0;
+        lpSlots = (LPTHUMBNAILSLOT)(s_lpIndex + 1);
+        for (UINT32 i = 0; isSucceed && (i < uSlotCount); ++i)
+        {
+            THUMBNAILSLOT slot = lpSlots[i];
+            if (0 == slot.uOffset)
+            {
+                continue;
+            }
+
+            map<UINT64, UINT64>::iterator iterMoved = mapMoved.find(slot.uOffset);
+            if (iterMoved != mapMoved.end())
+            {
+                slot.uOffset = iterMoved->second;
+            }
+            else if (slot.uOffset >= uSnapshotSize)
+            {
+                // The record is inserted while copying.
+                if ( !ReadRecord(s_hDataFile, slot.uOffset, vctRecord) )
+                {
+                    continue;
+                }
+
+                isSucceed = WriteFileAt(hTempData, uNewSize, &vctRecord[0], (DWORD)vctRecord.size());
+                slot.uOffset = uNewSize;
+                uNewSize += vctRecord.size();
+            }
+            else
+            {
+                continue;
+            }
+
+            *ProbeSlot(lpNewSlots, uNewSlotCount, slot.uKeyHash) = slot;
+            lpNewHeader->uUsedCount++;
+            uLiveBytes += slot.uSize;
+        }
+
+        lpNewHeader->uMagic      = THUMBNAIL_FILE_MAGIC;
+        lpNewHeader->uVersion    = THUMBNAIL_STORE_VERSION;
+        lpNewHeader->uGeneration = uGeneration + 1;
+        lpNewHeader->uDataSize   = uNewSize;
+        lpNewHeader->uDeadBytes  = uNewSize - sizeof(THUMBNAILFILEHEADER) - uLiveBytes;
+        lpNewHeader->uSlotCount  = uNewSlotCount;
+
+        THUMBNAILFILEHEADER dataHeader = { 0 };
+        dataHeader.uMagic      = THUMBNAIL_FILE_MAGIC;
+        dataHeader.uVersion    = THUMBNAIL_STORE_VERSION;
+        dataHeader.uGeneration = uGeneration + 1;
+
+        isSucceed = isSucceed &&
+                    WriteFileAt(hTempData, 0, &dataHeader, sizeof(THUMBNAILFILEHEADER)) &&
+                    WriteFileAt(hTempIndex, 0, &vctIndex[0], (DWORD)vctIndex.size());
+    }
+
+    if (INVALID_HANDLE_VALUE != hTempData)
+    {
+        CloseHandle(hTempData);
+    }
+    if (INVALID_HANDLE_VALUE != hTempIndex)
+    {
+        CloseHandle(hTempIndex);
+    }
+
+    if (isSucceed)
+    {
+        // If only the data file is replaced, the generations do not match and the files are reset.
+        CloseFiles();
+        if ( MoveFileExW(szTempDataFile, szDataFile, MOVEFILE_REPLACE_EXISTING) )
+        {
+            MoveFileExW(szTempIndexFile, szIndexFile, MOVEFILE_REPLACE_EXISTING);
+        }
+        OpenFiles();
+        ++s_uCompactions;
+    }
+
+    LeaveCriticalSection(&s_csLock);
+
+    DeleteFileW(szTempDataFile);
+    DeleteFileW(szTempIndexFile);
+}
+
+//////////////////////////////////////////////////////////////////////////
+
+unsigned int WINAPI SdkThumbnailStore::CompactThreadProc(LPVOID lpParameter)
+{
+    UNREFERENCED_PARAMETER(lpParameter);
+
+    CompactFiles();
+
+    EnterCriticalSection(&s_csLock);
+    s_isCompacting = FALSE;
+    LeaveCriticalSection(&s_csLock);
+
+    return 0;
+}
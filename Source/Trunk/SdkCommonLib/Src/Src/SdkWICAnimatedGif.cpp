@@ -27,6 +27,7 @@ USING_NAMESPACE_UTILITIES
 #define GIF_PATH_FRAME_HEIGHT                   L"/imgdesc/Height"
 #define GIF_PATH_FRAME_DELAY                    L"/grctlext/Delay"
 #define GIF_PATH_FRAME_DISPOSAL                 L"/grctlext/Disposal"
+#define MAX_GIF_FILE_SIZE                       (64 * 1024 * 1024)      // The larger GIF files are decoded by WIC.
 
 
 #ifndef TYPE_TO_TYPENAME
@@ -114,7 +115,9 @@ SdkWICAnimatedGif::SdkWICAnimatedGif() : m_pWicBitmapDecoder(NULL),
                                          m_bkColorRGB(0),
                                          m_bkColorAlpha(1.0f),
                                          m_fHasLoop(FALSE),
-                                         m_curGifType(WIC_GIF_TYPE_GIF)
+                                         m_curGifType(WIC_GIF_TYPE_GIF),
+                                         m_decodeBackend(GIF_DECODE_BACKEND_WIC),
+                                         m_pGifDecoder(NULL)
 {
     SetRect(&m_frameRect, 0, 0, 0, 0);
 }
@@ -125,6 +128,7 @@ SdkWICAnimatedGif::~SdkWICAnimatedGif()
 {
     SAFE_RELEASE(m_pWicBitmapDecoder);
     SAFE_RELEASE(m_pFormatConverter);
+    SAFE_DELETE(m_pGifDecoder);
 }
 
 //////////////////////////////////////////////////////////////////////////
@@ -136,8 +140,19 @@ BOOL SdkWICAnimatedGif::LoadFromFile(LPCWSTR lpfile)
         return FALSE;
     }
 
+    // The other images and the GIF which the portable decoder can not read are left to WIC.
+    if (GIF_DECODE_BACKEND_PORTABLE == m_decodeBackend)
+    {
+        vector<BYTE> vctData;
+        if ( ReadGifFileData(lpfile, vctData) && LoadFromGifData(&vctData[0], vctData.size()) )
+        {
+            return TRUE;
+        }
+    }
+
     HRESULT hr = E_FAIL;
     SAFE_RELEASE(m_pWicBitmapDecoder);
+    SAFE_DELETE(m_pGifDecoder);
     hr = s_pImagingFactory->CreateDecoderFromFilename(
         lpfile,                             // Image to be decoded.
         NULL,                               // Do not prefer a particular vendor.
@@ -188,6 +203,11 @@ BOOL SdkWICAnimatedGif::LoadFromResource(UINT uResId, HMODULE hModule)
         return FALSE;
     }
 
+    if ( (GIF_DECODE_BACKEND_PORTABLE == m_decodeBackend) && LoadFromGifData(reinterpret_cast<BYTE*>(pData), dwSize) )
+    {
+        return TRUE;
+    }
+
     HRESULT hr = E_FAIL;
     IWICStream *pWicStream = NULL;
     hr = s_pImagingFactory->CreateStream(&pWicStream);
@@ -197,6 +217,7 @@ BOOL SdkWICAnimatedGif::LoadFromResource(UINT uResId, HMODULE hModule)
         if (SUCCEEDED(hr))
         {
             SAFE_RELEASE(m_pWicBitmapDecoder);
+            SAFE_DELETE(m_pGifDecoder);
             hr = s_pImagingFactory->CreateDecoderFromStream(
                pWicStream,                         // Image to be decoded.
                NULL,                               // Do not prefer a particular vendor.
@@ -232,6 +253,52 @@ BOOL SdkWICAnimatedGif::LoadFromResource(UINT uResId, HMODULE hModule)
 
 //////////////////////////////////////////////////////////////////////////
 
+BOOL SdkWICAnimatedGif::LoadFromWICBitmap(IN IWICBitmapSource *pSource)
+{
+    if ( (NULL == s_pImagingFactory) || (NULL == pSource) )
+    {
+        return FALSE;
+    }
+
+    ClearData();
+
+    HRESULT hr = s_pImagingFactory->CreateFormatConverter(&m_pFormatConverter);
+    if (SUCCEEDED(hr))
+    {
+        hr = m_pFormatConverter->Initialize(
+            pSource,                         // Input bitmap to convert.
+            GUID_WICPixelFormat32bppPBGRA,   // Input bitmap to convert.
+            WICBitmapDitherTypeNone,         // Destination pixel format.
+            NULL,                            // Specified dither pattern.
+            0.0f,                            // Specify a particular palette.
+            WICBitmapPaletteTypeCustom);     // Palette translation type.
+    }
+
+    if (SUCCEEDED(hr))
+    {
+        // There is no decoder, GetFrameAt always returns this format converter.
+        hr = m_pFormatConverter->GetSize(&m_cxGifImagePixel, &m_cyGifImagePixel);
+    }
+
+    if (SUCCEEDED(hr))
+    {
+        m_uFrameCount     = 1;
+        m_uNextFrameIndex = 0;
+        m_uFrameDelay     = 0;
+        m_uFrameDisposal  = DM_NONE;
+        m_fHasLoop        = FALSE;
+        SetRect(&m_frameRect, 0, 0, 0, 0);
+    }
+    else
+    {
+        SAFE_RELEASE(m_pFormatConverter);
+    }
+
+    return (SUCCEEDED(hr)) ? TRUE : FALSE;
+}
+
+//////////////////////////////////////////////////////////////////////////
+
 BOOL SdkWICAnimatedGif::IsGif(IWICBitmapDecoder *pWicBitmapDecoder)
 {
     if (NULL == pWicBitmapDecoder)
@@ -266,6 +333,20 @@ WIC_GIF_TYPE SdkWICAnimatedGif::GetImageType()
 
 //////////////////////////////////////////////////////////////////////////
 
+void SdkWICAnimatedGif::SetDecodeBackend(GIF_DECODE_BACKEND backend)
+{
+    m_decodeBackend = backend;
+}
+
+//////////////////////////////////////////////////////////////////////////
+
+GIF_DECODE_BACKEND SdkWICAnimatedGif::GetDecodeBackend()
+{
+    return m_decodeBackend;
+}
+
+//////////////////////////////////////////////////////////////////////////
+
 BOOL SdkWICAnimatedGif::GetFormatConverter(OUT IWICFormatConverter **ppConvertedSourceBitmap)
 {
     if (NULL != ppConvertedSourceBitmap && NULL != m_pFormatConverter)
@@ -298,6 +379,24 @@ BOOL SdkWICAnimatedGif::GetNextFrame(OUT IWICFormatConverter **ppConvertedSource
 
 //////////////////////////////////////////////////////////////////////////
 
+void SdkWICAnimatedGif::SkipNextFrame(UINT uFrameDelay)
+{
+    if (0 == m_uFrameCount)
+    {
+        return;
+    }
+
+    if (0 == m_uNextFrameIndex)
+    {
+        m_uLoopNumber++;
+    }
+
+    m_uNextFrameIndex = (m_uNextFrameIndex + 1) % m_uFrameCount;
+    m_uFrameDelay = uFrameDelay;
+}
+
+//////////////////////////////////////////////////////////////////////////
+
 BOOL SdkWICAnimatedGif::GetFrameAt(UINT uFrameIndex, OUT IWICFormatConverter **ppConvertedSourceBitmap)
 {
     if (NULL != ppConvertedSourceBitmap)
@@ -424,6 +523,8 @@ void SdkWICAnimatedGif::ClearData()
 {
     SAFE_RELEASE(m_pWicBitmapDecoder);
     SAFE_RELEASE(m_pFormatConverter);
+    SAFE_DELETE(m_pGifDecoder);
+    vector<BYTE>().swap(m_vctFramePixels);
 }
 
 //////////////////////////////////////////////////////////////////////////
@@ -437,6 +538,11 @@ BOOL SdkWICAnimatedGif::IsEndAnimation()
 
 BOOL SdkWICAnimatedGif::GetRawFrame(UINT uFrameIndex)
 {
+    if (NULL != m_pGifDecoder)
+    {
+        return GetPortableRawFrame(uFrameIndex);
+    }
+
     if (NULL == m_pWicBitmapDecoder)
     {
         return FALSE;
@@ -524,6 +630,140 @@ BOOL SdkWICAnimatedGif::GetRawFrame(UINT uFrameIndex)
 
 //////////////////////////////////////////////////////////////////////////
 
+BOOL SdkWICAnimatedGif::GetPortableRawFrame(UINT uFrameIndex)
+{
+    GIF_FRAME_INFO info;
+    if ( (NULL == m_pGifDecoder) || !m_pGifDecoder->GetFrameInfo(uFrameIndex, info) )
+    {
+        return FALSE;
+    }
+
+    SAFE_RELEASE(m_pFormatConverter);
+
+    // The bitmap copies the pixels, so the buffer is used by the next frame.
+    UINT uStride = info.uWidth * 4;
+    m_vctFramePixels.resize((size_t)uStride * info.uHeight + 4);
+    HRESULT hr = m_pGifDecoder->DecodeFrame(uFrameIndex, &m_vctFramePixels[0], uStride) ? S_OK : E_FAIL;
+
+    IWICBitmap *pWicBitmap = NULL;
+    if (SUCCEEDED(hr))
+    {
+        hr = s_pImagingFactory->CreateBitmapFromMemory(
+            info.uWidth,
+            info.uHeight,
+            GUID_WICPixelFormat32bppPBGRA,
+            uStride,
+            uStride * info.uHeight,
+            &m_vctFramePixels[0],
+            &pWicBitmap);
+    }
+
+    if (SUCCEEDED(hr))
+    {
+        hr = s_pImagingFactory->CreateFormatConverter(&m_pFormatConverter);
+    }
+
+    if (SUCCEEDED(hr))
+    {
+        hr = m_pFormatConverter->Initialize(
+           pWicBitmap,
+           GUID_WICPixelFormat32bppPBGRA,
+           WICBitmapDitherTypeNone,
+           NULL,
+           0.0f,
+           WICBitmapPaletteTypeCustom);
+    }
+
+    if (SUCCEEDED(hr))
+    {
+        // The same values as the metadata which is read from WIC.
+        SetRect(&m_frameRect, (int)info.uLeft, (int)info.uTop, (int)(info.uLeft + info.uWidth), (int)(info.uTop + info.uHeight));
+        m_uFrameDelay    = info.hasGraphicControl ? ((info.uDelay * 10 < 90) ? 90 : info.uDelay * 10) : 0;
+        m_uFrameDisposal = info.hasGraphicControl ? info.uDisposal : DM_UNDEFINED;
+    }
+    else
+    {
+        SAFE_RELEASE(m_pFormatConverter);
+    }
+
+    SAFE_RELEASE(pWicBitmap);
+
+    return SUCCEEDED(hr) ? TRUE : FALSE;
+}
+
+//////////////////////////////////////////////////////////////////////////
+
+BOOL SdkWICAnimatedGif::LoadFromGifData(IN const BYTE *pData, size_t cbData)
+{
+    if ( !SdkGifDecoder::IsGifData(pData, cbData) )
+    {
+        return FALSE;
+    }
+
+    ClearData();
+    m_pGifDecoder = new SdkGifDecoder();
+    if ( !m_pGifDecoder->LoadFromMemory(pData, cbData) )
+    {
+        SAFE_DELETE(m_pGifDecoder);
+        return FALSE;
+    }
+
+    m_uFrameCount = m_pGifDecoder->GetFrameCount();
+    SetGifPixelSize(m_pGifDecoder->GetWidth(), m_pGifDecoder->GetHeight(), m_pGifDecoder->GetPixelAspectRatio());
+
+    UINT32 uBkColor = 0;
+    if (m_pGifDecoder->GetBackgroundColor(uBkColor))
+    {
+        m_bkColorRGB   = uBkColor;
+        m_bkColorAlpha = (uBkColor >> 24) / 255.0f;
+    }
+
+    UINT uLoopCount = 0;
+    if (m_pGifDecoder->GetLoopCount(uLoopCount))
+    {
+        // If it is 0, then we repeat infinitely.
+        m_uTotalLoopCount = uLoopCount;
+        if (0 != m_uTotalLoopCount)
+        {
+            m_fHasLoop = TRUE;
+        }
+    }
+
+    return TRUE;
+}
+
+//////////////////////////////////////////////////////////////////////////
+
+BOOL SdkWICAnimatedGif::ReadGifFileData(IN LPCWSTR lpfile, OUT vector<BYTE>& vctData)
+{
+    HANDLE hFile = CreateFileW(lpfile, GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+    if (INVALID_HANDLE_VALUE == hFile)
+    {
+        return FALSE;
+    }
+
+    // Only the signature is read if the file is not GIF.
+    BYTE signature[6] = { 0 };
+    DWORD dwRead = 0;
+    LARGE_INTEGER liSize = { 0 };
+    BOOL isOK = GetFileSizeEx(hFile, &liSize) && (liSize.QuadPart > 13) && (liSize.QuadPart < MAX_GIF_FILE_SIZE) &&
+                ReadFile(hFile, signature, sizeof(signature), &dwRead, NULL) &&
+                SdkGifDecoder::IsGifData(signature, dwRead);
+    if (isOK)
+    {
+        vctData.resize((size_t)liSize.QuadPart);
+        memcpy(&vctData[0], signature, sizeof(signature));
+        DWORD cbLeft = (DWORD)vctData.size() - sizeof(signature);
+        isOK = ReadFile(hFile, &vctData[sizeof(signature)], cbLeft, &dwRead, NULL) && (dwRead == cbLeft);
+    }
+
+    CloseHandle(hFile);
+
+    return isOK;
+}
+
+//////////////////////////////////////////////////////////////////////////
+
 BOOL SdkWICAnimatedGif::GetGlobalMetaData()
 {
     // Get background color of the GIF image.
@@ -644,38 +884,44 @@ BOOL SdkWICAnimatedGif::GetGifSizeInfo()
     hr = pMetadataQueryReader->GetMetadataByName(GIF_PATH_PIXELASPECTRATIO, &propValue);
     if (SUCCEEDED(hr) && (VT_UI1 == propValue.vt))
     {
-        UINT uPixelAspRatio = propValue.bVal;
-        if (uPixelAspRatio != 0)
+        SetGifPixelSize(cxGifImage, cyGifImage, propValue.bVal);
+    }
+
+    SAFE_RELEASE(pMetadataQueryReader);
+
+    return SUCCEEDED(hr) ? TRUE : FALSE;
+}
+
+//////////////////////////////////////////////////////////////////////////
+
+void SdkWICAnimatedGif::SetGifPixelSize(UINT cxGifImage, UINT cyGifImage, UINT uPixelAspRatio)
+{
+    if (uPixelAspRatio != 0)
+    {
+        // Need to calculate the ratio. The value in uPixelAspRatio 
+        // allows specifying widest pixel 4:1 to the tallest pixel of 
+        // 1:4 in increments of 1/64th.
+        FLOAT pixelAspRatio = (uPixelAspRatio + 15.f) / 64.f;
+
+        // Calculate the image width and height in pixel based on the
+        // pixel aspect ratio. Only shrink the image.
+        if (pixelAspRatio > 1.f)
         {
-            // Need to calculate the ratio. The value in uPixelAspRatio 
-            // allows specifying widest pixel 4:1 to the tallest pixel of 
-            // 1:4 in increments of 1/64th.
-            FLOAT pixelAspRatio = (uPixelAspRatio + 15.f) / 64.f;
-
-            // Calculate the image width and height in pixel based on the
-            // pixel aspect ratio. Only shrink the image.
-            if (pixelAspRatio > 1.f)
-            {
-                m_cxGifImagePixel = cxGifImage;
-                m_cyGifImagePixel = (UINT)(cyGifImage / pixelAspRatio);
-            }
-            else
-            {
-                m_cxGifImagePixel = (UINT)(cxGifImage * pixelAspRatio);
-                m_cyGifImagePixel = cyGifImage;
-            }
+            m_cxGifImagePixel = cxGifImage;
+            m_cyGifImagePixel = (UINT)(cyGifImage / pixelAspRatio);
         }
         else
         {
-            // The value is 0, so its ratio is 1
-            m_cxGifImagePixel = cxGifImage;
+            m_cxGifImagePixel = (UINT)(cxGifImage * pixelAspRatio);
             m_cyGifImagePixel = cyGifImage;
         }
     }
-
-    SAFE_RELEASE(pMetadataQueryReader);
-
-    return SUCCEEDED(hr) ? TRUE : FALSE;
+    else
+    {
+        // The value is 0, so its ratio is 1
+        m_cxGifImagePixel = cxGifImage;
+        m_cyGifImagePixel = cyGifImage;
+    }
 }
 
 //////////////////////////////////////////////////////////////////////////
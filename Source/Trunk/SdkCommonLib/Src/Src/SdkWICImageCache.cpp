@@ -0,0 +1,310 @@
+/*!
+* @file SdkWICImageCache.cpp
+*
+* @brief This file defines SdkWICImageCache class to share the decoded images in the process.
+*
+* Copyright (C) 2011, LZT Corporation.
+*
+* @author Li Hong
+* @date 2011/06/29
+*/
+
+#include "stdafx.h"
+#include "SdkWICImageCache.h"
+
+USING_NAMESPACE_UTILITIES
+
+#define WIC_IMAGE_CACHE_PIXEL_SIZE      4               // The bytes of one 32bpp pixel.
+
+
+/*!
+* @brief One cached image.
+*/
+struct NAMESPACE_UTILITIES::_WICIMAGECACHEENTRY
+{
+    wstring     strKey;                                 // The key of the image.
+    IWICBitmap *pBitmap;                                // The decoded bitmap.
+    UINT64      uBytes;                                 // The bytes of the pixels.
+    BOOL        isReferenced;                           // The image is used since the last sweep.
+};
+
+
+/*!
+* @brief The lock of the cache is created when the module is loaded. The bitmaps should
+*        be released by Clear before the COM is uninitialized, the rest are released here.
+*/
+class NAMESPACE_UTILITIES::SdkWICImageCacheLock
+{
+public:
+
+    SdkWICImageCacheLock()
+    {
+        InitializeCriticalSection(&SdkWICImageCache::s_csLock);
+    }
+
+    ~SdkWICImageCacheLock()
+    {
+        SdkWICImageCache::Clear();
+        DeleteCriticalSection(&SdkWICImageCache::s_csLock);
+    }
+};
+
+
+CRITICAL_SECTION                        SdkWICImageCache::s_csLock;
+UINT64                                  SdkWICImageCache::s_uBudget = DEFAULT_WIC_IMAGE_CACHE_BUDGET;
+UINT64                                  SdkWICImageCache::s_uBytes = 0;
+UINT64                                  SdkWICImageCache::s_uHits = 0;
+UINT64                                  SdkWICImageCache::s_uMisses = 0;
+UINT64                                  SdkWICImageCache::s_uEvictions = 0;
+size_t                                  SdkWICImageCache::s_nClockHand = 0;
+vector<LPWICIMAGECACHEENTRY>            SdkWICImageCache::s_vctEntries;
+map<wstring, LPWICIMAGECACHEENTRY>      SdkWICImageCache::s_mapEntries;
+
+// It must be defined after the static members, it uses them when it is constructed.
+static SdkWICImageCacheLock             g_imageCacheLock;
+
+
+//////////////////////////////////////////////////////////////////////////
+
+BOOL SdkWICImageCache::Lookup(IN LPCWSTR lpKey, OUT IWICBitmap **ppBitmap)
+{
+    if ( (NULL == lpKey) || (NULL == ppBitmap) )
+    {
+        return FALSE;
+    }
+
+    *ppBitmap = NULL;
+
+    EnterCriticalSection(&s_csLock);
+
+    map<wstring, LPWICIMAGECACHEENTRY>::iterator iter = s_mapEntries.find(lpKey);
+    if (iter != s_mapEntries.end())
+    {
+        LPWICIMAGECACHEENTRY lpEntry = iter->second;
+        lpEntry->isReferenced = TRUE;
+        *ppBitmap = lpEntry->pBitmap;
+        SAFE_ADDREF((*ppBitmap));
+        ++s_uHits;
+    }
+    else
+    {
+        ++s_uMisses;
+    }
+
+    LeaveCriticalSection(&s_csLock);
+
+    return (NULL != *ppBitmap);
+}
+
+//////////////////////////////////////////////////////////////////////////
+
+BOOL SdkWICImageCache::Insert(IN LPCWSTR lpKey, IN IWICBitmap *pBitmap)
+{
+    UINT32 uWidth = 0;
+    UINT32 uHeight = 0;
+    if ( (NULL == lpKey) || (NULL == pBitmap) || FAILED(pBitmap->GetSize(&uWidth, &uHeight)) )
+    {
+        return FALSE;
+    }
+
+    UINT64 uBytes = (UINT64)uWidth * uHeight * WIC_IMAGE_CACHE_PIXEL_SIZE;
+    BOOL isCached = FALSE;
+
+    EnterCriticalSection(&s_csLock);
+
+    map<wstring, LPWICIMAGECACHEENTRY>::iterator iter = s_mapEntries.find(lpKey);
+    if (iter != s_mapEntries.end())
+    {
+        for (size_t i = 0; i < s_vctEntries.size(); ++i)
+        {
+            if (s_vctEntries[i] == iter->second)
+            {
+                RemoveEntry(i);
+                break;
+            }
+        }
+    }
+
+    if (uBytes <= s_uBudget)
+    {
+        EvictEntries(uBytes);
+
+        LPWICIMAGECACHEENTRY lpEntry = new WICIMAGECACHEENTRY();
+        lpEntry->strKey       = lpKey;
+        lpEntry->pBitmap      = pBitmap;
+        lpEntry->uBytes       = uBytes;
+        lpEntry->isReferenced = FALSE;
+        pBitmap->AddRef();
+
+        // The new entry is put just behind the clock, it is swept at last.
+        s_vctEntries.insert(s_vctEntries.begin() + s_nClockHand, lpEntry);
+        s_nClockHand = (s_nClockHand + 1) % s_vctEntries.size();
+        s_mapEntries[lpEntry->strKey] = lpEntry;
+        s_uBytes += uBytes;
+        isCached = TRUE;
+    }
+
+    LeaveCriticalSection(&s_csLock);
+
+    return isCached;
+}
+
+//////////////////////////////////////////////////////////////////////////
+
+BOOL SdkWICImageCache::IsCacheable(IN UINT32 uWidth, IN UINT32 uHeight)
+{
+    UINT64 uBytes = (UINT64)uWidth * uHeight * WIC_IMAGE_CACHE_PIXEL_SIZE;
+
+    EnterCriticalSection(&s_csLock);
+    BOOL isCacheable = (uBytes > 0) && (uBytes <= s_uBudget);
+    LeaveCriticalSection(&s_csLock);
+
+    return isCacheable;
+}
+
+//////////////////////////////////////////////////////////////////////////
+
+BOOL SdkWICImageCache::MakeFileKey(IN LPCWSTR lpFile, IN UINT32 uDestWidth, IN UINT32 uDestHeight,
+                                   IN REFGUID guidFormat, OUT wstring& strKey)
+{
+    WIN32_FILE_ATTRIBUTE_DATA fileData = { 0 };
+    if ( (NULL == lpFile) || !GetFileAttributesExW(lpFile, GetFileExInfoStandard, &fileData) )
+    {
+        return FALSE;
+    }
+
+    // The paths are not case sensitive.
+    WCHAR szPath[MAX_PATH] = { 0 };
+    if ( FAILED(StringCchCopyW(szPath, MAX_PATH, lpFile)) )
+    {
+        return FALSE;
+    }
+    CharLowerW(szPath);
+
+    WCHAR szFormat[40] = { 0 };
+    StringFromGUID2(guidFormat, szFormat, ARRAYSIZE(szFormat));
+
+    WCHAR szInfo[128] = { 0 };
+    StringCchPrintfW(szInfo, ARRAYSIZE(szInfo), L"|%08X%08X|%08X%08X|%ux%u|%s",
+        fileData.ftLastWriteTime.dwHighDateTime, fileData.ftLastWriteTime.dwLowDateTime,
+        fileData.nFileSizeHigh, fileData.nFileSizeLow, uDestWidth, uDestHeight, szFormat);
+
+    strKey = L"file:";
+    strKey.append(szPath);
+    strKey.append(szInfo);
+
+    return TRUE;
+}
+
+//////////////////////////////////////////////////////////////////////////
+
+void SdkWICImageCache::MakeResourceKey(IN HMODULE hModule, IN LPCWSTR lpType, IN UINT uResId, IN UINT32 uDestWidth,
+                                       IN UINT32 uDestHeight, IN REFGUID guidFormat, OUT wstring& strKey)
+{
+    WCHAR szFormat[40] = { 0 };
+    StringFromGUID2(guidFormat, szFormat, ARRAYSIZE(szFormat));
+
+    // The resources are not changed while the module is loaded.
+    WCHAR szKey[MAX_PATH] = { 0 };
+    StringCchPrintfW(szKey, ARRAYSIZE(szKey), L"res:%p|%s|%u|%ux%u|%s",
+        hModule, (NULL != lpType) ? lpType : L"", uResId, uDestWidth, uDestHeight, szFormat);
+
+    strKey = szKey;
+}
+
+//////////////////////////////////////////////////////////////////////////
+
+void SdkWICImageCache::SetBudget(IN UINT64 uBytes)
+{
+    EnterCriticalSection(&s_csLock);
+    s_uBudget = uBytes;
+    EvictEntries(0);
+    LeaveCriticalSection(&s_csLock);
+}
+
+//////////////////////////////////////////////////////////////////////////
+
+void SdkWICImageCache::GetStats(OUT LPWICIMAGECACHESTATS pStats)
+{
+    if (NULL == pStats)
+    {
+        return;
+    }
+
+    EnterCriticalSection(&s_csLock);
+
+    pStats->uHits      = s_uHits;
+    pStats->uMisses    = s_uMisses;
+    pStats->uEvictions = s_uEvictions;
+    pStats->uBytes     = s_uBytes;
+    pStats->uBudget    = s_uBudget;
+    pStats->uEntries   = (UINT32)s_vctEntries.size();
+
+    LeaveCriticalSection(&s_csLock);
+}
+
+//////////////////////////////////////////////////////////////////////////
+
+void SdkWICImageCache::Clear()
+{
+    EnterCriticalSection(&s_csLock);
+
+    for (vector<LPWICIMAGECACHEENTRY>::iterator iter = s_vctEntries.begin(); iter != s_vctEntries.end(); ++iter)
+    {
+        SAFE_RELEASE((*iter)->pBitmap);
+        delete (*iter);
+    }
+
+    s_vctEntries.clear();
+    s_mapEntries.clear();
+    s_nClockHand = 0;
+    s_uBytes = 0;
+
+    LeaveCriticalSection(&s_csLock);
+}
+
+//////////////////////////////////////////////////////////////////////////
+
+void SdkWICImageCache::EvictEntries(IN UINT64 uNewBytes)
+{
+    // Each entry is passed at most twice, the first pass clears the reference bits.
+    while ( !s_vctEntries.empty() && (s_uBytes + uNewBytes > s_uBudget) )
+    {
+        s_nClockHand %= s_vctEntries.size();
+        LPWICIMAGECACHEENTRY lpEntry = s_vctEntries[s_nClockHand];
+        if (lpEntry->isReferenced)
+        {
+            lpEntry->isReferenced = FALSE;
+            ++s_nClockHand;
+        }
+        else
+        {
+            RemoveEntry(s_nClockHand);
+            ++s_uEvictions;
+        }
+    }
+}
+
+//////////////////////////////////////////////////////////////////////////
+
+void SdkWICImageCache::RemoveEntry(IN size_t nIndex)
+{
+    LPWICIMAGECACHEENTRY lpEntry = s_vctEntries[nIndex];
+
+    s_mapEntries.erase(lpEntry->strKey);
+    s_vctEntries.erase(s_vctEntries.begin() + nIndex);
+    s_uBytes -= lpEntry->uBytes;
+
+    if (nIndex < s_nClockHand)
+    {
+        --s_nClockHand;
+    }
+
+    if (s_nClockHand >= s_vctEntries.size())
+    {
+        s_nClockHand = 0;
+    }
+
+    SAFE_RELEASE(lpEntry->pBitmap);
+    delete lpEntry;
+}
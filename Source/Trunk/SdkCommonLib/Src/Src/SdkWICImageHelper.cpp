@@ -11,6 +11,8 @@
 
 #include "stdafx.h"
 #include "SdkWICImageHelper.h"
+#include "SdkWICImageCache.h"
+#include "SdkPixelKernels.h"
 
 USING_NAMESPACE_UTILITIES
 
@@ -36,10 +38,11 @@ USING_NAMESPACE_UTILITIES
 #endif // TYPE_TO_TYPENAME
 
 IWICImagingFactory* SdkWICImageHelper::s_pImagingFactory = NULL;
+vector<IWICBitmapEncoderInfo*> SdkWICImageHelper::s_vctEncoderInfos;
 
 HRESULT SdkWICImageHelper::WICInitialize()
 {
-    SAFE_RELEASE(s_pImagingFactory);
+    WICUninitialize();
 
     HRESULT hr = S_OK;
 
@@ -50,6 +53,25 @@ HRESULT SdkWICImageHelper::WICInitialize()
                               IID_PPV_ARGS(&s_pImagingFactory));
     }
 
+    // The encoders are enumerated once, CreateEncoder of the factory enumerates them for each image.
+    IEnumUnknown *pEnum = NULL;
+    if ( SUCCEEDED(hr) &&
+         SUCCEEDED(s_pImagingFactory->CreateComponentEnumerator(WICEncoder, WICComponentEnumerateDefault, &pEnum)) )
+    {
+        IUnknown *pUnknown = NULL;
+        ULONG uFetched = 0;
+        while ( (S_OK == pEnum->Next(1, &pUnknown, &uFetched)) && (1 == uFetched) )
+        {
+            IWICBitmapEncoderInfo *pEncoderInfo = NULL;
+            if ( SUCCEEDED(pUnknown->QueryInterface(IID_PPV_ARGS(&pEncoderInfo))) )
+            {
+                s_vctEncoderInfos.push_back(pEncoderInfo);
+            }
+            SAFE_RELEASE(pUnknown);
+        }
+    }
+    SAFE_RELEASE(pEnum);
+
     return hr;
 }
 
@@ -57,6 +79,12 @@ HRESULT SdkWICImageHelper::WICInitialize()
 
 void SdkWICImageHelper::WICUninitialize()
 {
+    for (vector<IWICBitmapEncoderInfo*>::iterator iter = s_vctEncoderInfos.begin(); iter != s_vctEncoderInfos.end(); ++iter)
+    {
+        SAFE_RELEASE((*iter));
+    }
+    s_vctEncoderInfos.clear();
+
     SAFE_RELEASE(s_pImagingFactory);
 }
 
@@ -82,7 +110,7 @@ BOOL SdkWICImageHelper::SaveWICBitmapToFile(PCWSTR pFileName, IWICBitmapSource *
 
     if (SUCCEEDED(hr))
     {
-        hr = s_pImagingFactory->CreateEncoder(GUID_ContainerFormatPng, NULL, &pEncoder);
+        hr = CreateEncoder(GUID_ContainerFormatPng, &pEncoder);
     }
 
     if (SUCCEEDED(hr))
@@ -137,22 +165,170 @@ BOOL SdkWICImageHelper::SaveWICBitmapToFile(PCWSTR pFileName, IWICBitmapSource *
 
 //////////////////////////////////////////////////////////////////////////
 
+HRESULT SdkWICImageHelper::SavePixelsToFile(PCWSTR pFileName, REFGUID guidContainer, IN const BYTE *pPixels,
+                                            UINT32 uWidth, UINT32 uHeight, UINT32 uStride)
+{
+    if ( (NULL == pFileName) || (NULL == pPixels) || (0 == uWidth) || (0 == uHeight) )
+    {
+        return E_INVALIDARG;
+    }
+
+    if (NULL == s_pImagingFactory)
+    {
+        return E_FAIL;
+    }
+
+    WICPixelFormatGUID format = GUID_WICPixelFormat32bppBGRA;
+    UINT32 cbPixels = uStride * uHeight;
+    IWICStream *pStream = NULL;
+    IWICBitmapEncoder *pEncoder = NULL;
+    IWICBitmapFrameEncode *pFrameEncode = NULL;
+    IPropertyBag2 *pPropertyBag = NULL;
+
+    HRESULT hr = s_pImagingFactory->CreateStream(&pStream);
+    if (SUCCEEDED(hr))
+    {
+        hr = pStream->InitializeFromFilename(pFileName, GENERIC_WRITE);
+    }
+
+    if (SUCCEEDED(hr))
+    {
+        hr = CreateEncoder(guidContainer, &pEncoder);
+    }
+
+    if (SUCCEEDED(hr))
+    {
+        hr = pEncoder->Initialize(pStream, WICBitmapEncoderNoCache);
+    }
+
+    if (SUCCEEDED(hr))
+    {
+        hr = pEncoder->CreateNewFrame(&pFrameEncode, &pPropertyBag);
+    }
+
+    if (SUCCEEDED(hr))
+    {
+        hr = pFrameEncode->Initialize(pPropertyBag);
+    }
+
+    if (SUCCEEDED(hr))
+    {
+        hr = pFrameEncode->SetSize(uWidth, uHeight);
+    }
+
+    if (SUCCEEDED(hr))
+    {
+        hr = pFrameEncode->SetPixelFormat(&format);
+    }
+
+    if ( SUCCEEDED(hr) && IsEqualGUID(format, GUID_WICPixelFormat32bppBGRA) )
+    {
+        // The encoder takes the pixels as they are, such as PNG, BMP and TIFF.
+        hr = pFrameEncode->WritePixels(uHeight, uStride, cbPixels, const_cast<BYTE*>(pPixels));
+    }
+    else if ( SUCCEEDED(hr) )
+    {
+        IWICBitmap *pBitmap = NULL;
+        IWICPalette *pPalette = NULL;
+        IWICFormatConverter *pConverter = NULL;
+
+        hr = s_pImagingFactory->CreateBitmapFromMemory(uWidth, uHeight, GUID_WICPixelFormat32bppBGRA,
+                                                       uStride, cbPixels, const_cast<BYTE*>(pPixels), &pBitmap);
+
+        // The indexed format needs the palette of the image, the encoder takes it too.
+        if ( SUCCEEDED(hr) && IsEqualGUID(format, GUID_WICPixelFormat8bppIndexed) )
+        {
+            hr = s_pImagingFactory->CreatePalette(&pPalette);
+            if (SUCCEEDED(hr))
+            {
+                hr = pPalette->InitializeFromBitmap(pBitmap, 256, TRUE);
+            }
+            if (SUCCEEDED(hr))
+            {
+                hr = pFrameEncode->SetPalette(pPalette);
+            }
+        }
+
+        if (SUCCEEDED(hr))
+        {
+            hr = s_pImagingFactory->CreateFormatConverter(&pConverter);
+        }
+
+        if (SUCCEEDED(hr))
+        {
+            hr = pConverter->Initialize(
+                pBitmap,
+                format,
+                WICBitmapDitherTypeNone,
+                pPalette,
+                0.0f,
+                (NULL != pPalette) ? WICBitmapPaletteTypeCustom : WICBitmapPaletteTypeMedianCut);
+        }
+
+        if (SUCCEEDED(hr))
+        {
+            hr = pFrameEncode->WriteSource(pConverter, NULL);
+        }
+
+        SAFE_RELEASE(pConverter);
+        SAFE_RELEASE(pPalette);
+        SAFE_RELEASE(pBitmap);
+    }
+
+    if (SUCCEEDED(hr))
+    {
+        hr = pFrameEncode->Commit();
+    }
+
+    if (SUCCEEDED(hr))
+    {
+        hr = pEncoder->Commit();
+    }
+
+    SAFE_RELEASE(pPropertyBag);
+    SAFE_RELEASE(pFrameEncode);
+    SAFE_RELEASE(pEncoder);
+    SAFE_RELEASE(pStream);
+
+    return hr;
+}
+
+//////////////////////////////////////////////////////////////////////////
+
 HBITMAP SdkWICImageHelper::CreateHBITMAPFromIWICBitmap(HDC hDC, IWICBitmapSource *pWICBitmapSource)
 {
     UINT uWidth = 0;
     UINT uHeight = 0;
-    if ((NULL == pWICBitmapSource) || FAILED(pWICBitmapSource->GetSize(&uWidth, &uHeight)))
+    WICPixelFormatGUID format = GUID_WICPixelFormatDontCare;
+    if ( (NULL == pWICBitmapSource) || FAILED(pWICBitmapSource->GetSize(&uWidth, &uHeight)) ||
+         FAILED(pWICBitmapSource->GetPixelFormat(&format)) || (0 == uWidth) || (0 == uHeight) )
     {
         return NULL;
     }
 
+    // The 32bpp BGRA pixels are copied as they are, the RGBA pixels are swapped by the pixel
+    // kernels after copying, the other formats are converted by WIC.
+    BOOL isRGBA = IsEqualGUID(format, GUID_WICPixelFormat32bppRGBA) || IsEqualGUID(format, GUID_WICPixelFormat32bppPRGBA);
+    BOOL isBGRA = IsEqualGUID(format, GUID_WICPixelFormat32bppBGRA) || IsEqualGUID(format, GUID_WICPixelFormat32bppPBGRA) ||
+                  IsEqualGUID(format, GUID_WICPixelFormat32bppBGR);
+
+    IWICBitmapSource *pSource = NULL;
+    HRESULT hr = S_OK;
+    if ( isRGBA || isBGRA )
+    {
+        pSource = pWICBitmapSource;
+        SAFE_ADDREF(pSource);
+    }
+    else
+    {
+        hr = WICConvertBitmapSource(GUID_WICPixelFormat32bppPBGRA, pWICBitmapSource, &pSource);
+    }
+
     HBITMAP hBitmap = NULL;
     UINT uStride = uWidth * 4;
     UINT pixelBufSize = uStride * uHeight;
-    BYTE *pbBuffer = new BYTE[pixelBufSize];
-    memset(pbBuffer, 0, pixelBufSize);
+    BYTE *pbBits = NULL;
 
-    HRESULT hr = pWICBitmapSource->CopyPixels(NULL, uStride, pixelBufSize, pbBuffer);
     if (SUCCEEDED(hr))
     {
         BITMAPINFO bmi = 
@@ -171,14 +347,28 @@ HBITMAP SdkWICImageHelper::CreateHBITMAPFromIWICBitmap(HDC hDC, IWICBitmapSource
             0                           // RGB QUAD
         };
 
-        hBitmap = CreateCompatibleBitmap(hDC, uWidth, uHeight);
-        if (NULL != hBitmap)
-        {
-            SetDIBits(hDC, hBitmap, 0, uHeight, (PVOID)&pbBuffer[0], &bmi, DIB_RGB_COLORS);
-        }
+        // The pixels are copied into the DIB section directly, there is no temporary buffer.
+        hBitmap = CreateDIBSection(hDC, &bmi, DIB_RGB_COLORS, (void**)&pbBits, NULL, 0);
+        hr = ((NULL != hBitmap) && (NULL != pbBits)) ? S_OK : E_OUTOFMEMORY;
+    }
+
+    if (SUCCEEDED(hr))
+    {
+        hr = pSource->CopyPixels(NULL, uStride, pixelBufSize, pbBits);
     }
 
-    SAFE_DELETE_ARRAY(pbBuffer);
+    if (SUCCEEDED(hr) && isRGBA)
+    {
+        SdkPixelKernels::SwapRedBlue((const UINT32*)pbBits, (UINT32*)pbBits, (size_t)uWidth * uHeight);
+    }
+
+    if (FAILED(hr) && (NULL != hBitmap))
+    {
+        DeleteObject(hBitmap);
+        hBitmap = NULL;
+    }
+
+    SAFE_RELEASE(pSource);
 
     return hBitmap;
 }
@@ -211,6 +401,15 @@ BOOL SdkWICImageHelper::LoadFromFile(LPCWSTR lpfile, UINT32 uDestWidth, UINT32 u
 
     ClearImageData();
 
+    // The same file of the same size is decoded only once in the process.
+    wstring strKey;
+    BOOL hasKey = SdkWICImageCache::MakeFileKey(
+        lpfile, uDestWidth, uDestHeight, GUID_WICPixelFormat32bppPBGRA, strKey);
+    if ( hasKey && LoadFromCache(strKey) )
+    {
+        return TRUE;
+    }
+
     IWICBitmapDecoder *pWicBitmapDecoder = NULL;
     HRESULT hr = s_pImagingFactory->CreateDecoderFromFilename(
         lpfile,                             // Image to be decoded.
@@ -231,29 +430,176 @@ BOOL SdkWICImageHelper::LoadFromFile(LPCWSTR lpfile, UINT32 uDestWidth, UINT32 u
             hr = s_pImagingFactory->CreateFormatConverter(&m_pConvertedSourceBitmap);
             if ( SUCCEEDED(hr) )
             {
-                // Clone a new bitmap source from a specified bitmap source so that the file can be deleted.
-                IWICBitmapSource *pTempSource = pFrame;
-                pTempSource->AddRef();
-                //hr = CloneWICBitmapSource(pFrame, &pTempSource);
-                IWICBitmapScaler *pScaler = CreateBitmapScaler(pTempSource, uDestWidth, uDestHeight);
-                IWICBitmapSource *pSource = (NULL != pScaler) ?
-                    ((IWICBitmapSource*)pScaler) : ((IWICBitmapSource*)pTempSource);
-                if ( NULL == pSource )
+                // A small destination is decoded in a reduced size by the codec, not in full.
+                IWICBitmapSource *pSource = NULL;
+                hr = CreateFrameSource(pFrame, uDestWidth, uDestHeight, &pSource);
+                if ( SUCCEEDED(hr) )
                 {
-                    pSource = pFrame;
+                    hr = m_pConvertedSourceBitmap->Initialize(
+                        pSource,                         // Input bitmap to convert.
+                        GUID_WICPixelFormat32bppPBGRA,   // Input bitmap to convert.
+                        WICBitmapDitherTypeNone,         // Destination pixel format.
+                        NULL,                            // Specified dither pattern.
+                        0.0f,                            // Specify a particular palette.
+                        WICBitmapPaletteTypeCustom);     // Palette translation type.
                 }
 
-                hr = m_pConvertedSourceBitmap->Initialize(
-                    pSource,                         // Input bitmap to convert.
-                    GUID_WICPixelFormat32bppPBGRA,   // Input bitmap to convert.
-                    WICBitmapDitherTypeNone,         // Destination pixel format.
-                    NULL,                            // Specified dither pattern.
-                    0.0f,                            // Specify a particular palette.
-                    WICBitmapPaletteTypeCustom);     // Palette translation type.
+                SAFE_RELEASE(pSource);
+            }
+        }
+
+        SAFE_RELEASE(pFrame);
+        SAFE_RELEASE(pWicBitmapDecoder);
+    }
+
+    if ( SUCCEEDED(hr) && hasKey )
+    {
+        CacheConvertedImage(strKey);
+    }
+
+    return (SUCCEEDED(hr)) ? TRUE : FALSE;
+}
+
+//////////////////////////////////////////////////////////////////////////
+
+BOOL SdkWICImageHelper::LoadPreviewFromFile(LPCWSTR lpfile, UINT32 uDestWidth, UINT32 uDestHeight,
+                                            OUT UINT32 *puFullWidth, OUT UINT32 *puFullHeight)
+{
+    if (NULL == s_pImagingFactory)
+    {
+        return FALSE;
+    }
+
+    ClearImageData();
+
+    // The cached full image is better and cheaper than any preview.
+    wstring strKey;
+    IWICBitmap *pCachedBitmap = NULL;
+    if ( SdkWICImageCache::MakeFileKey(lpfile, uDestWidth, uDestHeight, GUID_WICPixelFormat32bppPBGRA, strKey) &&
+         SdkWICImageCache::Lookup(strKey.c_str(), &pCachedBitmap) )
+    {
+        SAFE_RELEASE(pCachedBitmap);
+        return FALSE;
+    }
+
+    IWICBitmapDecoder *pWicBitmapDecoder = NULL;
+    HRESULT hr = s_pImagingFactory->CreateDecoderFromFilename(
+        lpfile,                             // Image to be decoded.
+        NULL,                               // Do not prefer a particular vendor.
+        GENERIC_READ,                       // Desired read a access to the file.
+        WICDecodeMetadataCacheOnDemand,     // Cache metadata when needed.
+        &pWicBitmapDecoder                  // Pointer to the decoder.
+        );
+
+    if ( SUCCEEDED(hr) )
+    {
+        IWICBitmapFrameDecode *pFrame = NULL;
+        hr = pWicBitmapDecoder->GetFrame(0, &pFrame);
+        if ( SUCCEEDED(hr) )
+        {
+            UINT32 uWidth  = 0;
+            UINT32 uHeight = 0;
+            pFrame->GetSize(&uWidth, &uHeight);
+            uWidth  = (0 == uDestWidth)  ? uWidth  : uDestWidth;
+            uHeight = (0 == uDestHeight) ? uHeight : uDestHeight;
+
+            if (NULL != puFullWidth)
+            {
+                *puFullWidth = uWidth;
+            }
+            if (NULL != puFullHeight)
+            {
+                *puFullHeight = uHeight;
+            }
+
+            // The preview is the cheapest reduced image of the codec.
+            IWICBitmapSource *pSource = NULL;
+            hr = CreateReducedSource(pFrame,
+                (uWidth  + MAX_WIC_REDUCED_DECODE_SCALE - 1) / MAX_WIC_REDUCED_DECODE_SCALE,
+                (uHeight + MAX_WIC_REDUCED_DECODE_SCALE - 1) / MAX_WIC_REDUCED_DECODE_SCALE,
+                &pSource);
+            if (S_OK == hr)
+            {
+                hr = ResetFormatConverter(pSource);
+            }
+            else
+            {
+                hr = E_FAIL;
+            }
+
+            SAFE_RELEASE(pSource);
+        }
+
+        SAFE_RELEASE(pFrame);
+        SAFE_RELEASE(pWicBitmapDecoder);
+    }
+
+    return (SUCCEEDED(hr)) ? TRUE : FALSE;
+}
+
+//////////////////////////////////////////////////////////////////////////
+
+BOOL SdkWICImageHelper::LoadReducedFromFile(LPCWSTR lpfile, UINT32 uMaxWidth, UINT32 uMaxHeight,
+                                            OUT UINT32 *puDestWidth, OUT UINT32 *puDestHeight)
+{
+    if ( (NULL == s_pImagingFactory) || (NULL == puDestWidth) || (NULL == puDestHeight) )
+    {
+        return FALSE;
+    }
+
+    ClearImageData();
+
+    IWICBitmapDecoder *pWicBitmapDecoder = NULL;
+    HRESULT hr = s_pImagingFactory->CreateDecoderFromFilename(
+        lpfile,                             // Image to be decoded.
+        NULL,                               // Do not prefer a particular vendor.
+        GENERIC_READ,                       // Desired read a access to the file.
+        WICDecodeMetadataCacheOnDemand,     // Cache metadata when needed.
+        &pWicBitmapDecoder                  // Pointer to the decoder.
+        );
+
+    if ( SUCCEEDED(hr) )
+    {
+        IWICBitmapFrameDecode *pFrame = NULL;
+        hr = pWicBitmapDecoder->GetFrame(0, &pFrame);
+
+        UINT32 uWidth  = 0;
+        UINT32 uHeight = 0;
+        if ( SUCCEEDED(hr) )
+        {
+            hr = pFrame->GetSize(&uWidth, &uHeight);
+        }
+
+        if ( SUCCEEDED(hr) && ((0 == uWidth) || (0 == uHeight)) )
+        {
+            hr = E_FAIL;
+        }
+
+        if ( SUCCEEDED(hr) )
+        {
+            // The image is scaled into the bound, it is never enlarged.
+            DOUBLE dScale = 1.0;
+            if (uMaxWidth > 0)
+            {
+                dScale = min(dScale, (DOUBLE)uMaxWidth / uWidth);
+            }
+            if (uMaxHeight > 0)
+            {
+                dScale = min(dScale, (DOUBLE)uMaxHeight / uHeight);
+            }
+
+            *puDestWidth  = max((UINT32)(uWidth * dScale + 0.5), (UINT32)1);
+            *puDestHeight = max((UINT32)(uHeight * dScale + 0.5), (UINT32)1);
 
-                SAFE_RELEASE(pScaler);
-                SAFE_RELEASE(pTempSource);
+            IWICBitmapSource *pSource = NULL;
+            if (S_OK != CreateReducedSource(pFrame, *puDestWidth, *puDestHeight, &pSource))
+            {
+                pSource = pFrame;
+                pSource->AddRef();
             }
+
+            hr = ResetFormatConverter(pSource);
+            SAFE_RELEASE(pSource);
         }
 
         SAFE_RELEASE(pFrame);
@@ -317,6 +663,18 @@ BOOL SdkWICImageHelper::LoadFromResource(UINT uResId, HMODULE hModule, UINT32 uD
         return FALSE;
     }
 
+    WCHAR *pTypeName = NULL;
+    TYPE_TO_TYPENAME(m_curImageType, pTypeName);
+    HMODULE hResInst = (NULL == hModule) ? GetModuleHandle(NULL) : hModule;
+
+    wstring strKey;
+    SdkWICImageCache::MakeResourceKey(
+        hResInst, pTypeName, uResId, uDestWidth, uDestHeight, GUID_WICPixelFormat32bppPBGRA, strKey);
+    if ( LoadFromCache(strKey) )
+    {
+        return TRUE;
+    }
+
     PVOID pData = NULL;
     DWORD dwSize = LoadResourceData(uResId, hModule, &pData);
     if (dwSize <= 0)
@@ -352,19 +710,20 @@ BOOL SdkWICImageHelper::LoadFromResource(UINT uResId, HMODULE hModule, UINT32 uD
                     hr = s_pImagingFactory->CreateFormatConverter(&m_pConvertedSourceBitmap);
                     if ( SUCCEEDED(hr) )
                     {
-                        IWICBitmapScaler *pScaler = CreateBitmapScaler(
-                            pFrame,
-                            uDestWidth, uDestHeight);
-                        IWICBitmapSource *pSource = (NULL != pScaler) ? 
-                            ((IWICBitmapSource*)pScaler) : ((IWICBitmapSource*)pFrame);
-
-                        hr = m_pConvertedSourceBitmap->Initialize(
-                            pSource,                         // Input bitmap to convert.
-                            GUID_WICPixelFormat32bppPBGRA,   // Input bitmap to convert.
-                            WICBitmapDitherTypeNone,         // Destination pixel format.
-                            NULL,                            // Specified dither pattern.
-                            0.0f,                            // Specify a particular palette.
-                            WICBitmapPaletteTypeCustom);     // Palette translation type.
+                        IWICBitmapSource *pSource = NULL;
+                        hr = CreateFrameSource(pFrame, uDestWidth, uDestHeight, &pSource);
+                        if ( SUCCEEDED(hr) )
+                        {
+                            hr = m_pConvertedSourceBitmap->Initialize(
+                                pSource,                         // Input bitmap to convert.
+                                GUID_WICPixelFormat32bppPBGRA,   // Input bitmap to convert.
+                                WICBitmapDitherTypeNone,         // Destination pixel format.
+                                NULL,                            // Specified dither pattern.
+                                0.0f,                            // Specify a particular palette.
+                                WICBitmapPaletteTypeCustom);     // Palette translation type.
+                        }
+
+                        SAFE_RELEASE(pSource);
                     }
                 }
             }
@@ -374,6 +733,11 @@ BOOL SdkWICImageHelper::LoadFromResource(UINT uResId, HMODULE hModule, UINT32 uD
     SAFE_RELEASE(pWicStream);
     SAFE_RELEASE(pWicBitmapDecoder);
 
+    if ( SUCCEEDED(hr) )
+    {
+        CacheConvertedImage(strKey);
+    }
+
     return (SUCCEEDED(hr)) ? TRUE : FALSE;
 }
 
@@ -476,6 +840,89 @@ void SdkWICImageHelper::ClearImageData()
 
 //////////////////////////////////////////////////////////////////////////
 
+BOOL SdkWICImageHelper::LoadFromWICBitmap(IN IWICBitmapSource *pSource)
+{
+    if ( (NULL == s_pImagingFactory) || (NULL == pSource) )
+    {
+        return FALSE;
+    }
+
+    ClearImageData();
+
+    return SUCCEEDED(ResetFormatConverter(pSource)) ? TRUE : FALSE;
+}
+
+//////////////////////////////////////////////////////////////////////////
+
+HRESULT SdkWICImageHelper::DecodeToBitmap(OUT IWICBitmap **ppBitmap)
+{
+    if ( (NULL == ppBitmap) || (NULL == m_pConvertedSourceBitmap) || (NULL == s_pImagingFactory) )
+    {
+        return E_INVALIDARG;
+    }
+
+    // The cached image is a bitmap already, the format converter only passes it through.
+    return s_pImagingFactory->CreateBitmapFromSource(
+        m_pConvertedSourceBitmap, WICBitmapCacheOnLoad, ppBitmap);
+}
+
+//////////////////////////////////////////////////////////////////////////
+
+UINT SdkWICImageHelper::GetFrameCount(LPCWSTR lpfile)
+{
+    if ( (NULL == lpfile) || (NULL == s_pImagingFactory) )
+    {
+        return 0;
+    }
+
+    UINT uFrameCount = 0;
+    IWICBitmapDecoder *pWicBitmapDecoder = NULL;
+    HRESULT hr = s_pImagingFactory->CreateDecoderFromFilename(
+        lpfile,                             // Image to be decoded.
+        NULL,                               // Do not prefer a particular vendor.
+        GENERIC_READ,                       // Desired read a access to the file.
+        WICDecodeMetadataCacheOnDemand,     // Cache metadata when needed.
+        &pWicBitmapDecoder                  // Pointer to the decoder.
+        );
+
+    if ( SUCCEEDED(hr) )
+    {
+        hr = pWicBitmapDecoder->GetFrameCount(&uFrameCount);
+    }
+
+    SAFE_RELEASE(pWicBitmapDecoder);
+
+    return SUCCEEDED(hr) ? uFrameCount : 0;
+}
+
+//////////////////////////////////////////////////////////////////////////
+
+UINT32 SdkWICImageHelper::GetReducedDecodeScale(UINT32 uSrcWidth, UINT32 uSrcHeight, UINT32 uDestWidth, UINT32 uDestHeight)
+{
+    if ( (0 == uSrcWidth) || (0 == uSrcHeight) )
+    {
+        return 1;
+    }
+
+    uDestWidth  = (0 == uDestWidth)  ? uSrcWidth  : uDestWidth;
+    uDestHeight = (0 == uDestHeight) ? uSrcHeight : uDestHeight;
+
+    // The biggest scale is tried first, the reduced image is scaled to the destination later,
+    // so it should not be smaller than the destination.
+    for (UINT32 uScale = MAX_WIC_REDUCED_DECODE_SCALE; uScale > 1; uScale /= 2)
+    {
+        if ( ((uSrcWidth  + uScale - 1) / uScale >= uDestWidth) &&
+             ((uSrcHeight + uScale - 1) / uScale >= uDestHeight) )
+        {
+            return uScale;
+        }
+    }
+
+    return 1;
+}
+
+//////////////////////////////////////////////////////////////////////////
+
 HRESULT SdkWICImageHelper::CloneWICBitmapSource(IWICBitmapSource *pWICBitmapSource, IWICBitmapSource **ppWICBitmapDest)
 {
     if ( (NULL == pWICBitmapSource) || (NULL == s_pImagingFactory) || (NULL == ppWICBitmapDest))
@@ -641,4 +1088,258 @@ IWICBitmapScaler* SdkWICImageHelper::CreateBitmapScaler(IN IWICBitmapSource* pWI
     SAFE_RELEASE(pBitmapScaler);
 
     return NULL;
-}
\ No newline at end of file
+}
+
+//////////////////////////////////////////////////////////////////////////
+
+HRESULT SdkWICImageHelper::CreateFrameSource(IN IWICBitmapFrameDecode *pFrame, UINT32 uDestWidth, UINT32 uDestHeight,
+                                             OUT IWICBitmapSource **ppSource)
+{
+    if ( (NULL == pFrame) || (NULL == ppSource) )
+    {
+        return E_INVALIDARG;
+    }
+
+    *ppSource = NULL;
+
+    if ( (0 == uDestWidth) && (0 == uDestHeight) )
+    {
+        *ppSource = pFrame;
+        pFrame->AddRef();
+        return S_OK;
+    }
+
+    // The original size is filled here, the reduced image has another size.
+    UINT32 uWidth  = 0;
+    UINT32 uHeight = 0;
+    HRESULT hr = pFrame->GetSize(&uWidth, &uHeight);
+    if ( FAILED(hr) )
+    {
+        return hr;
+    }
+
+    uDestWidth  = (0 == uDestWidth)  ? uWidth  : uDestWidth;
+    uDestHeight = (0 == uDestHeight) ? uHeight : uDestHeight;
+
+    IWICBitmapSource *pReducedSource = NULL;
+    if (S_OK != CreateReducedSource(pFrame, uDestWidth, uDestHeight, &pReducedSource))
+    {
+        pReducedSource = pFrame;
+        pReducedSource->AddRef();
+    }
+
+    IWICBitmapScaler *pScaler = CreateBitmapScaler(pReducedSource, uDestWidth, uDestHeight);
+    if (NULL != pScaler)
+    {
+        *ppSource = pScaler;
+    }
+    else
+    {
+        *ppSource = pReducedSource;
+        pReducedSource->AddRef();
+    }
+
+    SAFE_RELEASE(pReducedSource);
+
+    return S_OK;
+}
+
+//////////////////////////////////////////////////////////////////////////
+
+HRESULT SdkWICImageHelper::CreateReducedSource(IN IWICBitmapFrameDecode *pFrame, UINT32 uMinWidth, UINT32 uMinHeight,
+                                               OUT IWICBitmapSource **ppSource)
+{
+    if ( (NULL == pFrame) || (NULL == ppSource) )
+    {
+        return E_INVALIDARG;
+    }
+
+    *ppSource = NULL;
+
+    UINT32 uWidth  = 0;
+    UINT32 uHeight = 0;
+    if ( FAILED(pFrame->GetSize(&uWidth, &uHeight)) )
+    {
+        return E_FAIL;
+    }
+
+    uMinWidth  = max(uMinWidth, (UINT32)1);
+    uMinHeight = max(uMinHeight, (UINT32)1);
+
+    UINT32 uScale = GetReducedDecodeScale(uWidth, uHeight, uMinWidth, uMinHeight);
+    if (uScale <= 1)
+    {
+        return S_FALSE;
+    }
+
+    // The codecs which scale natively, such as JPEG by the DCT, implement IWICBitmapSourceTransform,
+    // only the reduced pixels are decoded.
+    IWICBitmapSourceTransform *pTransform = NULL;
+    if ( SUCCEEDED(pFrame->QueryInterface(IID_PPV_ARGS(&pTransform))) )
+    {
+        UINT32 uReducedWidth  = (uWidth  + uScale - 1) / uScale;
+        UINT32 uReducedHeight = (uHeight + uScale - 1) / uScale;
+        WICPixelFormatGUID guidFormat = GUID_WICPixelFormat32bppPBGRA;
+
+        HRESULT hr = pTransform->GetClosestSize(&uReducedWidth, &uReducedHeight);
+        if ( SUCCEEDED(hr) )
+        {
+            hr = pTransform->GetClosestPixelFormat(&guidFormat);
+        }
+
+        if ( SUCCEEDED(hr) && (uReducedWidth >= uMinWidth) && (uReducedHeight >= uMinHeight) &&
+             (uReducedWidth < uWidth) && (uReducedHeight < uHeight) )
+        {
+            IWICBitmap *pBitmap = NULL;
+            hr = s_pImagingFactory->CreateBitmap(
+                uReducedWidth, uReducedHeight, guidFormat, WICBitmapCacheOnLoad, &pBitmap);
+            if ( SUCCEEDED(hr) )
+            {
+                WICRect rcLock = { 0, 0, (INT)uReducedWidth, (INT)uReducedHeight };
+                IWICBitmapLock *pLock = NULL;
+                hr = pBitmap->Lock(&rcLock, WICBitmapLockWrite, &pLock);
+                if ( SUCCEEDED(hr) )
+                {
+                    UINT uStride = 0;
+                    UINT uBufferSize = 0;
+                    BYTE *pData = NULL;
+                    hr = pLock->GetStride(&uStride);
+                    if ( SUCCEEDED(hr) )
+                    {
+                        hr = pLock->GetDataPointer(&uBufferSize, &pData);
+                    }
+                    if ( SUCCEEDED(hr) )
+                    {
+                        hr = pTransform->CopyPixels(NULL, uReducedWidth, uReducedHeight, &guidFormat,
+                            WICBitmapTransformRotate0, uStride, uBufferSize, pData);
+                    }
+                }
+                SAFE_RELEASE(pLock);
+            }
+
+            if ( SUCCEEDED(hr) )
+            {
+                *ppSource = pBitmap;
+                pBitmap = NULL;
+            }
+            SAFE_RELEASE(pBitmap);
+        }
+
+        SAFE_RELEASE(pTransform);
+
+        if (NULL != *ppSource)
+        {
+            return S_OK;
+        }
+    }
+
+    // The camera images and some TIFF files have an embedded thumbnail, it is used when it
+    // is big enough and has the same aspect ratio.
+    IWICBitmapSource *pThumbnail = NULL;
+    if ( SUCCEEDED(pFrame->GetThumbnail(&pThumbnail)) )
+    {
+        UINT32 uThumbWidth  = 0;
+        UINT32 uThumbHeight = 0;
+        pThumbnail->GetSize(&uThumbWidth, &uThumbHeight);
+
+        UINT64 uDiff = (UINT64)uThumbWidth * uHeight;
+        UINT64 uSame = (UINT64)uThumbHeight * uWidth;
+        uDiff = (uDiff > uSame) ? (uDiff - uSame) : (uSame - uDiff);
+
+        if ( (uThumbWidth >= uMinWidth) && (uThumbHeight >= uMinHeight) &&
+             (uThumbWidth < uWidth) && (uDiff <= max(uWidth, uHeight)) )
+        {
+            *ppSource = pThumbnail;
+            pThumbnail = NULL;
+        }
+
+        SAFE_RELEASE(pThumbnail);
+    }
+
+    return (NULL != *ppSource) ? S_OK : S_FALSE;
+}
+
+//////////////////////////////////////////////////////////////////////////
+
+HRESULT SdkWICImageHelper::ResetFormatConverter(IN IWICBitmapSource *pSource)
+{
+    SAFE_RELEASE(m_pConvertedSourceBitmap);
+
+    HRESULT hr = s_pImagingFactory->CreateFormatConverter(&m_pConvertedSourceBitmap);
+    if ( SUCCEEDED(hr) )
+    {
+        hr = m_pConvertedSourceBitmap->Initialize(
+            pSource,                         // Input bitmap to convert.
+            GUID_WICPixelFormat32bppPBGRA,   // Input bitmap to convert.
+            WICBitmapDitherTypeNone,         // Destination pixel format.
+            NULL,                            // Specified dither pattern.
+            0.0f,                            // Specify a particular palette.
+            WICBitmapPaletteTypeCustom);     // Palette translation type.
+    }
+
+    if ( FAILED(hr) )
+    {
+        SAFE_RELEASE(m_pConvertedSourceBitmap);
+    }
+
+    return hr;
+}
+
+//////////////////////////////////////////////////////////////////////////
+
+HRESULT SdkWICImageHelper::CreateEncoder(REFGUID guidContainer, OUT IWICBitmapEncoder **ppEncoder)
+{
+    for (vector<IWICBitmapEncoderInfo*>::iterator iter = s_vctEncoderInfos.begin(); iter != s_vctEncoderInfos.end(); ++iter)
+    {
+        GUID guidFormat = GUID_NULL;
+        if ( SUCCEEDED((*iter)->GetContainerFormat(&guidFormat)) && IsEqualGUID(guidFormat, guidContainer) )
+        {
+            return (*iter)->CreateInstance(ppEncoder);
+        }
+    }
+
+    return s_pImagingFactory->CreateEncoder(guidContainer, NULL, ppEncoder);
+}
+
+//////////////////////////////////////////////////////////////////////////
+
+BOOL SdkWICImageHelper::LoadFromCache(IN const wstring& strKey)
+{
+    IWICBitmap *pBitmap = NULL;
+    if ( !SdkWICImageCache::Lookup(strKey.c_str(), &pBitmap) )
+    {
+        return FALSE;
+    }
+
+    HRESULT hr = ResetFormatConverter(pBitmap);
+    SAFE_RELEASE(pBitmap);
+
+    return SUCCEEDED(hr) ? TRUE : FALSE;
+}
+
+//////////////////////////////////////////////////////////////////////////
+
+void SdkWICImageHelper::CacheConvertedImage(IN const wstring& strKey)
+{
+    UINT32 uWidth = 0;
+    UINT32 uHeight = 0;
+    if ( (NULL == m_pConvertedSourceBitmap) ||
+         FAILED(m_pConvertedSourceBitmap->GetSize(&uWidth, &uHeight)) ||
+         !SdkWICImageCache::IsCacheable(uWidth, uHeight) )
+    {
+        return;
+    }
+
+    // The pixels are decoded now instead of each time the converter is drawn, and the
+    // decoder is released so that the file can be modified.
+    IWICBitmap *pBitmap = NULL;
+    HRESULT hr = s_pImagingFactory->CreateBitmapFromSource(
+        m_pConvertedSourceBitmap, WICBitmapCacheOnLoad, &pBitmap);
+    if ( SUCCEEDED(hr) )
+    {
+        SdkWICImageCache::Insert(strKey.c_str(), pBitmap);
+        ResetFormatConverter(pBitmap);
+    }
+
+    SAFE_RELEASE(pBitmap);
+}
@@ -80,6 +80,15 @@ public:
     */
     BOOL LoadFromResource(UINT uResId, HMODULE hModule = NULL);
 
+    /*!
+    * @brief Load a still image from a bitmap source, such as a bitmap decoded by SdkImageDecodeService.
+    *
+    * @param pSource     [I/ ] The bitmap source.
+    *
+    * @return TRUE if succeeds, otherwise return FALSE.
+    */
+    BOOL LoadFromWICBitmap(IWICBitmapSource *pSource);
+
     /*!
     * @brief Set the image type, which indicates which image can be processed by current class.
     *
@@ -160,6 +169,23 @@ public:
     */
     BOOL IsEndAnimation();
 
+    /*!
+    * @brief Set the max bytes of the composed frames kept by this GIF. The frames are composed
+    *        in the first loop and kept, the later loops draw them without decoding. A GIF whose
+    *        frames are bigger than the limit is decoded and composed in each loop. If the cache
+    *        is disabled while its frames are painted, the animation goes on from the painted frame.
+    *
+    * @param uBytes         [I/ ] The bytes, 0 disables the frame cache.
+    */
+    void SetFrameCacheLimit(UINT64 uBytes);
+
+    /*!
+    * @brief Indicates whether all frames are composed and cached.
+    *
+    * @return TRUE if all frames are cached, otherwise return FALSE.
+    */
+    BOOL IsFrameCached();
+
 protected:
 
     /*!
@@ -217,6 +243,27 @@ protected:
     */
     BOOL GetFrameRect(OUT D2D1_RECT_F& rc);
 
+    /*!
+    * @brief Keep a copy of the frame composed on the compatible render target, the frames are
+    *        kept only in order from the first one and while they fit the limit.
+    *
+    * @param uFrameIndex    [I/ ] The index of the composed frame.
+    */
+    void CacheComposedFrame(UINT uFrameIndex);
+
+    /*!
+    * @brief Release the cached frames.
+    */
+    void ClearFrameCache();
+
+    /*!
+    * @brief Copy the cached frame painted now to the compatible render target and read its
+    *        disposal and bound again, so the next frame can be composed on it.
+    *
+    * @return TRUE if succeeds, otherwise return FALSE.
+    */
+    BOOL RestorePaintFrame();
+
     /*!
     * @brief Get the current background color of GIF.
     *
@@ -257,6 +304,11 @@ private:
     ID2D1RenderTarget       *m_pRenderTarget;           // The render target.
     SdkWICAnimatedGif       *m_pWicAnimatedGif;         // SdkWICAnimatedGif instance to process GIF with WIC.
     ID2D1BitmapRenderTarget *m_pBitmapRenderTarget;     // The compatible render target.
+    UINT64                   m_uFrameCacheLimit;        // The max bytes of the cached frames.
+    UINT                     m_uPaintFrameIndex;        // The cached frame painted now, valid if m_isPaintFromCache.
+    BOOL                     m_isPaintFromCache;        // The painted frame is a cached frame.
+    vector<ID2D1Bitmap*>     m_vctFrameCache;           // The composed frames from the first one.
+    vector<UINT>             m_vctFrameDelays;          // The delays of the cached frames.
 };
 
 END_NAMESPACE_D2D
@@ -85,6 +85,18 @@ public:
     */
     BOOL LoadFromHBITMAP(HBITMAP hBitmap, UINT32 uDestWidth = 0, UINT32 uDestHeight = 0);
 
+    /*!
+    * @brief Load a image from a shared HBITMAP, the pixels are not copied until the D2D bitmap
+    *        is created, and the theme draws it from the bitmap atlas of the render target.
+    *
+    * @param hBitmap        [I/ ] The handle to HBITMAP, it is not owned by the object and should
+    *                             be valid until the application exits, such as the images of
+    *                             SdkResManager.
+    *
+    * @return TRUE if succeeds, otherwise return FALSE.
+    */
+    BOOL LoadFromSharedHBITMAP(HBITMAP hBitmap);
+
     /*!
     * @brief Load a image from a resource.
     *
@@ -99,6 +111,15 @@ public:
     */
     BOOL LoadFromResource(UINT uResId, HMODULE hModule = NULL, UINT32 uDestWidth = 0, UINT32 uDestHeight = 0);
 
+    /*!
+    * @brief Load a image from a bitmap source, such as a bitmap decoded by SdkImageDecodeService.
+    *
+    * @param pSource        [I/ ] The bitmap source.
+    *
+    * @return TRUE if succeeds, otherwise return FALSE.
+    */
+    BOOL LoadFromWICBitmap(IWICBitmapSource *pSource);
+
     /*!
     * @brief Get an instance of ID2D1Bitmap, which can be used to draw with render target.
     *
@@ -108,6 +129,13 @@ public:
     */
     BOOL GetD2DBitmap(OUT ID2D1Bitmap **ppD2DBitmap);
 
+    /*!
+    * @brief Get the shared HBITMAP loaded by LoadFromSharedHBITMAP.
+    *
+    * @return The handle to HBITMAP, NULL if the image is not loaded from a shared HBITMAP.
+    */
+    HBITMAP GetSharedHBITMAP() const;
+
     /*!
     * @brief Get the width of image.
     *
@@ -155,6 +183,9 @@ private:
     ID2D1Bitmap             *m_pD2DBitmap;          // The ID2D1Bitmap instance, represents a bitmap load from file or resource.
     ID2D1RenderTarget       *m_pRenderTarget;       // The Render target, used to create ID2D1Bitmap instance.
     SdkWICImageHelper       *m_pWICImageHelper;     // The pointer to SdkWICImageHelper, used to process image file.
+    HBITMAP                  m_hSharedBitmap;       // The shared bitmap, which is not owned by the object.
+    UINT                     m_uSharedWidth;        // The width of the shared bitmap.
+    UINT                     m_uSharedHeight;       // The height of the shared bitmap.
 };
 
 END_NAMESPACE_D2D
@@ -0,0 +1,134 @@
+/*!
+* @file D2DBitmapAtlas.h
+*
+* @brief This file defines the class D2DBitmapAtlas, which packs the shared skin bitmaps
+*        into a few big bitmaps of one render target.
+*
+* Copyright (C) 2011, LZT Corporation.
+*
+* @author Li Hong
+* @date 2011/06/30
+*/
+
+#ifdef __cplusplus
+#ifndef _D2DBITMAPATLAS_H_
+#define _D2DBITMAPATLAS_H_
+
+#include "SdkCommon.h"
+#include "SdkCommonMacro.h"
+
+BEGIN_NAMESPACE_D2D
+
+#define D2D_ATLAS_PAGE_SIZE         1024        // The width and height of one atlas page.
+#define D2D_ATLAS_MAX_PAGES         4           // The max count of the pages of one atlas.
+#define D2D_ATLAS_MAX_IMAGE_SIZE    256         // The images larger than it are not packed.
+#define D2D_ATLAS_GUTTER            1           // The edge pixels copied around each image.
+
+/*!
+* @brief The D2DBitmapAtlas class. The images are placed in the pages from top to bottom
+*        in rows, each image is surrounded by a copy of its edge pixels, so the linear
+*        sampling at the edge does not read the neighbour image.
+*
+* @remark The key of the image is the HBITMAP, so it must be a shared bitmap which is not
+*         deleted while the atlas is alive, such as the images of SdkResManager.
+*/
+class CLASS_DECLSPEC D2DBitmapAtlas
+{
+public:
+
+    /*!
+    * @brief The constructor function.
+    *
+    * @param pRenderTarget  [I/ ] The render target which the page bitmaps are created with.
+    */
+    D2DBitmapAtlas(ID2D1RenderTarget *pRenderTarget);
+
+    /*!
+    * @brief The destructor function.
+    */
+    ~D2DBitmapAtlas();
+
+    /*!
+    * @brief Get the render target of the atlas, the caller should not release it.
+    *
+    * @return The render target.
+    */
+    ID2D1RenderTarget* GetRenderTarget() const;
+
+    /*!
+    * @brief Get the page bitmap and the area of the specified image, the image is packed
+    *        and uploaded when it is requested first time.
+    *
+    * @param hBitmap        [I/ ] The shared bitmap, it should be a 32bpp bitmap.
+    * @param uWidth         [I/ ] The width of the bitmap.
+    * @param uHeight        [I/ ] The height of the bitmap.
+    * @param ppD2DBitmap    [ /O] The page bitmap, the caller should release it.
+    * @param rcSource       [ /O] The area of the image in the page bitmap.
+    *
+    * @return TRUE if succeeds, FALSE if the image is too large or the atlas is full.
+    */
+    BOOL GetBitmap(
+        IN HBITMAP hBitmap,
+        IN UINT32 uWidth,
+        IN UINT32 uHeight,
+        OUT ID2D1Bitmap **ppD2DBitmap,
+        OUT D2D1_RECT_F& rcSource);
+
+    /*!
+    * @brief Get the count of the page bitmaps.
+    *
+    * @return The count of the pages.
+    */
+    UINT GetPageCount() const;
+
+    /*!
+    * @brief Get the count of the images in the atlas.
+    *
+    * @return The count of the images.
+    */
+    UINT GetImageCount() const;
+
+private:
+
+    /*!
+    * @brief The page of the atlas.
+    */
+    struct _ATLAS_PAGE;
+
+    /*!
+    * @brief The image placed in the atlas.
+    */
+    struct _ATLAS_IMAGE;
+
+    /*!
+    * @brief Find a free area of the specified size, a new page is created if the last one is full.
+    *
+    * @param uCellWidth     [I/ ] The width of the image with the gutter.
+    * @param uCellHeight    [I/ ] The height of the image with the gutter.
+    * @param pImage         [ /O] The image whose page and position are set.
+    *
+    * @return TRUE if succeeds, otherwise FALSE.
+    */
+    BOOL PlaceImage(UINT32 uCellWidth, UINT32 uCellHeight, OUT _ATLAS_IMAGE *pImage);
+
+    /*!
+    * @brief Copy the pixels of the bitmap and its gutter to the page.
+    *
+    * @param hBitmap        [I/ ] The bitmap.
+    * @param pImage         [I/ ] The image which indicates the page and the position.
+    *
+    * @return TRUE if succeeds, otherwise FALSE.
+    */
+    BOOL UploadImage(HBITMAP hBitmap, const _ATLAS_IMAGE *pImage);
+
+private:
+
+    ID2D1RenderTarget                  *m_pRenderTarget;    // The render target which creates the pages.
+    vector<_ATLAS_PAGE*>                m_vctPages;         // The pages of the atlas.
+    map<HBITMAP, _ATLAS_IMAGE*>         m_mapImages;        // The placed images.
+};
+
+END_NAMESPACE_D2D
+
+#endif // _D2DBITMAPATLAS_H_
+#endif // __cplusplus
@@ -68,6 +68,28 @@ public:
     */
     HRESULT InitDCDevice();
 
+    /*!
+    * @brief Initialize the software render target, which draws into a bitmap with CPU, so
+    *        neither window nor GPU is needed. It is created again if the size is changed.
+    *
+    * @param uWidth     [I/ ] The width of the bitmap in pixels.
+    * @param uHeight    [I/ ] The height of the bitmap in pixels.
+    *
+    * @return S_OK is success, E_FALSE is failure.
+    *
+    * @remark The DPI of the target is always 96, so the frames are the same on all machines.
+    */
+    HRESULT InitSoftwareDevice(UINT32 uWidth, UINT32 uHeight);
+
+    /*!
+    * @brief Get the bitmap of the software render target, it is valid after calling to EndDraw.
+    *
+    * @param ppBitmap   [ /O] Output instance of IWICBitmap.
+    *
+    * @return S_OK if succeeds, E_FAIL if the software render target is not initialized.
+    */
+    HRESULT GetSoftwareBitmap(OUT IWICBitmap **ppBitmap);
+
     /*!
     * @brief Get the instance of ID2D1Factory interface.
     *
@@ -95,6 +117,28 @@ public:
     */
     void GetRenderTarget(OUT ID2D1RenderTarget **ppTarget);
 
+    /*!
+    * @brief Get the render target of the device, the layer targets pushed by PushLayerTarget
+    *        are ignored. The resources shared by the layers should be created with it.
+    *
+    * @param ppTarget   [ /O] Output instance of ID2D1RenderTarget.
+    */
+    void GetDeviceRenderTarget(OUT ID2D1RenderTarget **ppTarget);
+
+    /*!
+    * @brief Draw into a layer target instead of the render target, GetRenderTarget returns the
+    *        layer target until PopLayerTarget is called. The layers can be nested.
+    *
+    * @param pLayerTarget   [I/ ] The layer target compatible with the render target, it should
+    *                             be kept alive until it is popped.
+    */
+    void PushLayerTarget(IN ID2D1RenderTarget *pLayerTarget);
+
+    /*!
+    * @brief Remove the layer target pushed by PushLayerTarget.
+    */
+    void PopLayerTarget();
+
     /*!
     * @brief Begin to prepare scene to draw with D2D, generally, you should NOT call
     *        this method in your drawing code.
@@ -111,7 +155,52 @@ public:
     void EndDraw();
 
     /*!
-    * @brief Get the desktop DPI.
+    * @brief Clip the drawing to a dirty rectangle and clear it, it is called between BeginDraw
+    *        and EndDraw, so only the dirty part of the render target is drawn again.
+    *
+    * @param rcDirty    [I/ ] The dirty rectangle in DIPs.
+    * @param isClearRT  [I/ ] Clear the dirty rectangle or not.
+    */
+    void PushDirtyRect(IN const D2D1_RECT_F& rcDirty, BOOL isClearRT = TRUE);
+
+    /*!
+    * @brief Remove the clip pushed by PushDirtyRect.
+    */
+    void PopDirtyRect();
+
+    /*!
+    * @brief Indicates whether the render target keeps the content of the last frame, if so,
+    *        only the dirty rectangles need to be drawn. It is FALSE for the new or recreated
+    *        target, and for the targets which are not the HWND or software render target.
+    *
+    * @return TRUE if the content is kept, otherwise FALSE.
+    */
+    BOOL IsContentRetained() const;
+
+    /*!
+    * @brief Mark the content of the render target as lost, the next frame is drawn entirely.
+    *        Typically it is called when a frame is skipped.
+    */
+    void DiscardContent();
+
+    /*!
+    * @brief Increase a counter of the frame being drawn.
+    *
+    * @param stat       [I/ ] The counter, one value of DEVICE_FRAMESTAT.
+    */
+    void IncreaseFrameStat(DEVICE_FRAMESTAT stat);
+
+    /*!
+    * @brief Get a counter of the frame drawn last time.
+    *
+    * @param stat       [I/ ] The counter, one value of DEVICE_FRAMESTAT.
+    *
+    * @return The count.
+    */
+    UINT32 GetFrameStat(DEVICE_FRAMESTAT stat) const;
+
+    /*!
+    * @brief Get the desktop DPI, it is always 96 for the software render target.
     *
     * @param dpiX               [ /O] The DPI X value.
     * @param dpiY               [ /O] The DPI Y value.
@@ -224,20 +313,41 @@ protected:
     */
     void RemoveD2DDeviceFromList(D2DDevice *pD2DDevice);
 
+    /*!
+    * @brief Get the render target of current paint target type, it is not add-ref.
+    *
+    * @return The render target, may be NULL.
+    */
+    ID2D1RenderTarget* GetCurrentTarget() const;
+
+    /*!
+    * @brief Get the color to clear the render target of current paint target type.
+    *
+    * @return The clear color.
+    */
+    D2D1_COLOR_F GetClearColor() const;
+
 protected:
 
     FLOAT                            m_fOpacity;                    // Opacity value, 0.0 to 1.0.
     HDC                              m_hMemDC;                      // The memory device context.
     HWND                             m_hWnd;                        // The handle to window.
     BOOL                             m_isPaintModeChange;           // Indicates whether paint mode is changed.
+    BOOL                             m_isContentLost;               // Indicates whether the HWND render target lost the last frame.
     DEVICE_TARGET_TYPE               m_paintTargetType;             // The paint mode.
     IWICBitmap                      *m_pWICBitmap;                  // The WIC bitmap held by WIC Bitmap render target.
     ID2D1Factory                    *m_pD2DFactory;                 // The instance of ID2D1Factory, it is the entry of D2D.
     ID2D1HwndRenderTarget           *m_pRenderTarget;               // The Render target instance.
     ID2D1DCRenderTarget             *m_pDCRenderTarget;             // The GDI DC render target.
     ID2D1RenderTarget               *m_pWICBitmapRenderTarget;      // The memory render target.
+    ID2D1RenderTarget               *m_pSoftwareRenderTarget;       // The software render target.
+    IWICBitmap                      *m_pSoftwareBitmap;             // The bitmap of the software render target.
     IDWriteBitmapRenderTarget       *m_pDWriteBitmapTarget;         // The Direct write bitmap target.
     vector<ID2DDeviceStateChange*>   m_vctDeviceChangeListeners;    // The device change listeners.
+    vector<ID2D1RenderTarget*>       m_vctLayerTargets;             // The layer targets being drawn, not add-ref.
+    UINT32                           m_uSoftwareWidth;              // The width of the software render target.
+    UINT32                           m_uSoftwareHeight;             // The height of the software render target.
+    UINT32                           m_frameStats[DEVICE_FRAMESTAT_COUNT];  // The counters of the frame.
 
     static vector<D2DDevice*>        s_vctD2DDeviceList;            // The D2DDevice list.
 };
@@ -81,6 +81,18 @@ public:
     */
     BOOL SetImage(HBITMAP hBitmap, VIEW_STYLE style, UINT32 uWidth = 0, UINT32 uHeight = 0);
 
+    /*!
+    * @brief Set the focused image from a shared HBITMAP, the pixels are not copied and the
+    *        image is drawn from the bitmap atlas of the theme.
+    *
+    * @param hBitmap    [I/ ] Handle to HBITMAP, it should be valid until the application exits,
+    *                         such as the images of SdkResManager.
+    * @param style      [I/ ] The style of this image.
+    *
+    * @return TRUE if success, otherwise return FALSE.
+    */
+    BOOL SetSharedImage(HBITMAP hBitmap, VIEW_STYLE style);
+
     /*!
     * @brief Set the focused image.
     *
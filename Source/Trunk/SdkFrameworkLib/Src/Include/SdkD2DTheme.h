@@ -46,6 +46,16 @@ public:
 
 public:
 
+    /*!
+    * @brief The constructor function.
+    */
+    SdkD2DTheme();
+
+    /*!
+    * @brief The destructor function.
+    */
+    virtual ~SdkD2DTheme();
+
     virtual void OnPushClip(
         SdkViewElement *pView,
         ID2D1RenderTarget *pRT,
@@ -164,6 +174,7 @@ private:
         SdkViewElement *pView,
         ID2D1RenderTarget *pRT,
         ID2D1Bitmap *pD2DBitmap,
+        const D2D1_RECT_F& rcSource,
         FLOAT destX,
         FLOAT destY,
         FLOAT destWidth,
@@ -173,9 +184,36 @@ private:
         FLOAT srcWidth,
         FLOAT srcHeight);
 
+    /*!
+    * @brief Get the D2D bitmap to draw the specified bitmap, it is the page of the bitmap atlas
+    *        if the bitmap is loaded from a shared HBITMAP.
+    *
+    * @param pRT            [I/ ] The render target.
+    * @param pBitmap        [I/ ] The bitmap.
+    * @param ppD2DBitmap    [ /O] The D2D bitmap, the caller should release it.
+    * @param rcSource       [ /O] The area of the image in the D2D bitmap.
+    *
+    * @return TRUE if succeeds, otherwise FALSE.
+    */
+    BOOL GetThemeBitmap(
+        ID2D1RenderTarget *pRT,
+        D2DBitmap *pBitmap,
+        OUT ID2D1Bitmap **ppD2DBitmap,
+        OUT D2D1_RECT_F& rcSource);
+
+    /*!
+    * @brief Get or create the bitmap atlas of the specified render target.
+    *
+    * @param pRT            [I/ ] The render target.
+    *
+    * @return The bitmap atlas, NULL if the render target does not belong to a device.
+    */
+    D2DBitmapAtlas* GetBitmapAtlas(ID2D1RenderTarget *pRT);
+
 private:
 
-    static SdkD2DTheme      *s_pD2DTheme;       // The pointer to SdkD2DTheme.
+    vector<D2DBitmapAtlas*>  m_vctBitmapAtlases;    // The bitmap atlases of the render targets.
+    static SdkD2DTheme      *s_pD2DTheme;           // The pointer to SdkD2DTheme.
 };
 
 END_NAMESPACE_THEME
@@ -31,7 +31,7 @@ typedef enum _IMAGEFILE_TYPE
 /*!
 * @brief The SdkGifView class is used to display GIF file.
 */
-class CLASS_DECLSPEC SdkGifView : public SdkViewElement
+class CLASS_DECLSPEC SdkGifView : public SdkViewElement, public IImageDecodeNotify
 {
 public:
 
@@ -83,6 +83,28 @@ public:
     */
     virtual BOOL LoadFromFile(LPCWSTR lpfile);
 
+    /*!
+    * @brief Load a image from a specified file name in the background, the view is empty
+    *        until the image is decoded. It loads the file at once if the decode service
+    *        is not running.
+    *
+    * @param lpfile      [I/ ] The pointer to file name.
+    * @param priority    [I/ ] The decode priority, the visible image should be decoded first.
+    *
+    * @return TRUE if the request is added or the file is loaded, otherwise return FALSE.
+    */
+    virtual BOOL LoadFromFileAsync(LPCWSTR lpfile, IMAGE_DECODE_PRIORITY priority = IMAGE_DECODE_PRIORITY_VISIBLE);
+
+    /*!
+    * @brief Load a image from the result of SdkImageDecodeService, the still image is
+    *        taken from the decoded bitmap, the animation reads its frames from the file.
+    *
+    * @param lpResult    [I/ ] The decode result.
+    *
+    * @return TRUE if succeeds, otherwise return FALSE.
+    */
+    virtual BOOL LoadFromDecodeResult(IN const IMAGEDECODERESULT *lpResult);
+
     /*!
     * @brief Load a image from a resource.
     *
@@ -138,6 +160,14 @@ public:
     */
     virtual void SetStretchMode(IN IMAGE_STRETCH_MODE stretchMode = IMAGE_STRETCH_MODE_CENTER);
 
+    /*!
+    * @brief Set the max bytes of the composed frames kept for the later loops, the GIF whose
+    *        frames are bigger than it is decoded in each loop.
+    *
+    * @param uBytes         [I/ ] The bytes, 0 disables the frame cache.
+    */
+    virtual void SetFrameCacheLimit(UINT64 uBytes = DEFAULT_GIF_FRAME_CACHE_LIMIT);
+
     /*!
     * @brief Clear the associated data with the view.
     */
@@ -176,6 +206,18 @@ protected:
     */
     virtual void OnDrawItem(ID2D1RenderTarget *pRenderTarget);
 
+    /*!
+    * @brief Called when the image requested by LoadFromFileAsync is decoded.
+    *
+    * @param lpResult       [I/ ] The decode result.
+    */
+    virtual void OnImageDecoded(IN const IMAGEDECODERESULT *lpResult);
+
+    /*!
+    * @brief Cancel the image requested by LoadFromFileAsync.
+    */
+    void CancelImageDecode();
+
     /*!
     * @brief Paint the GIF frame.
     *
@@ -24,7 +24,8 @@ BEGIN_NAMESPACE_VIEWS
 
 class CLASS_DECLSPEC SdkImagePreviewLayout : public SdkViewLayout,
                                              public IAnimationTimerListener,
-                                             public IAnimationListener
+                                             public IAnimationListener,
+                                             public IImageDecodeNotify
 {
 public:
 
@@ -185,6 +186,13 @@ protected:
     */
     VOID OnAnimationTimerUpdate(OUT SdkAnimation *pAnimation);
 
+    /*!
+    * @brief This method is called when the image of a view is decoded.
+    * 
+    * @param lpResult              [I/ ] The decode result.
+    */
+    void OnImageDecoded(IN const IMAGEDECODERESULT *lpResult);
+
     /*!
     * @brief Called when the layout of view is changed.
     *
@@ -268,14 +276,44 @@ private:
     void LayoutView(SdkViewLayout *pLayout, SdkGifView *pImageView, FLOAT fX, FLOAT fY, FLOAT fWidth, FLOAT fHeight);
 
     /*!
-    * @brief The set image information.
+    * @brief The set image information, the image is decoded in the background.
     *
     * @param pImageView         [I/ ] The image view.
     * @param lpFile             [I/ ] The path of the image.
     * @param fWidth             [I/ ] The width of view.
     * @param fHeight            [I/ ] The height of view.
+    * @param priority           [I/ ] The decode priority.
+    */
+    void SetImageInfo(SdkGifView *pImageView, LPCWSTR lpFile, FLOAT fWidth, FLOAT fHeight, IMAGE_DECODE_PRIORITY priority);
+
+    /*!
+    * @brief Show the loaded image, or the default picture if fails.
+    *
+    * @param pImageView         [I/ ] The image view.
+    * @param isImageLoadSuccess [I/ ] Indicates whether the image is loaded.
+    */
+    void OnImageLoaded(SdkGifView *pImageView, BOOL isImageLoadSuccess);
+
+    /*!
+    * @brief Get the decode request id of the image view.
+    *
+    * @param pImageView         [I/ ] The image view.
+    *
+    * @return The pointer to the request id, NULL if the view is not a child.
+    */
+    DWORD* GetDecodeRequestId(SdkGifView *pImageView);
+
+    /*!
+    * @brief Cancel the decode request of the image view.
+    *
+    * @param pImageView         [I/ ] The image view.
+    */
+    void CancelImageDecode(SdkGifView *pImageView);
+
+    /*!
+    * @brief Decode the current image first, then the last and the next images.
     */
-    void SetImageInfo(SdkGifView *pImageView, LPCWSTR lpFile, FLOAT fWidth, FLOAT fHeight);
+    void UpdateDecodePriority();
 
     /*!
     * @brief Called when photo zoom out.
@@ -385,6 +423,9 @@ private:
     SdkGifView             *m_pLastImageView;          // The last image view.
     SdkGifView             *m_pCurImageView;           // The current image view.
     SdkGifView             *m_pNextImageView;          // The current image view.
+    DWORD                   m_dwLastDecodeId;          // The decode request id of the last image view.
+    DWORD                   m_dwCurDecodeId;           // The decode request id of the current image view.
+    DWORD                   m_dwNextDecodeId;          // The decode request id of the next image view.
     SdkViewLayout                  *m_pLastViewLayout;         // The Last View layout
     SdkViewLayout                  *m_pCurViewLayout;          // The current layout.
     SdkViewLayout                  *m_pNextViewLayout;         // The next view layout.
@@ -21,7 +21,7 @@ BEGIN_NAMESPACE_VIEWS
 /*!
 * @brief SdkImageView class.
 */
-class CLASS_DECLSPEC SdkImageView : public virtual SdkViewElement
+class CLASS_DECLSPEC SdkImageView : public virtual SdkViewElement, public IImageDecodeNotify
 {
 public:
 
@@ -44,6 +44,20 @@ public:
     */
     virtual BOOL SetSrcImage(IN LPCWSTR lpFile, UINT32 uDestWidth = 0, UINT32 uDestHeight = 0);
 
+    /*!
+    * @brief Called to decode the image file in the background, the image is shown when it
+    *        is decoded. A preview reduced by the codec, such as 1/8 of a JPEG, is shown first
+    *        and refined by the full image. It loads the file at once if the decode service
+    *        is not running.
+    *
+    * @param lpFile     [I/ ] The path of the image.
+    * @param priority   [I/ ] The decode priority, the visible image should be decoded first.
+    *
+    * @return TRUE if the request is added or the file is loaded, otherwise return FALSE.
+    */
+    virtual BOOL SetSrcImageAsync(IN LPCWSTR lpFile, UINT32 uDestWidth = 0, UINT32 uDestHeight = 0,
+                                  IMAGE_DECODE_PRIORITY priority = IMAGE_DECODE_PRIORITY_VISIBLE);
+
     /*!
     * @brief Called to get the image from files, which will be set as the background.
     *
@@ -131,8 +145,20 @@ protected:
     */
     virtual void ConvertToFitMode(IN FLOAT destWidth,IN FLOAT destHeight, IN OUT FLOAT& srcWidth, IN OUT FLOAT& srcHeight);
 
+    /*!
+    * @brief Called when the image requested by SetSrcImageAsync is decoded.
+    *
+    * @param lpResult       [I/ ] The decode result.
+    */
+    virtual void OnImageDecoded(IN const IMAGEDECODERESULT *lpResult);
+
 private:
 
+    /*!
+    * @brief Cancel the image requested by SetSrcImageAsync.
+    */
+    void CancelImageDecode();
+
     /*!
     * @brief The internal data of image view.
     */
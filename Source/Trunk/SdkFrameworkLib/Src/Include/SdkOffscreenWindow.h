@@ -0,0 +1,112 @@
+/*!
+* @file SdkOffscreenWindow.h
+*
+* @brief This file defines the class SdkOffscreenWindow, renders the views without a window.
+*
+* Copyright (C) 2011, LZT Corporation.
+*
+* @author Li Hong
+* @date 2011/07/04
+*/
+
+#ifdef __cplusplus
+#ifndef _SDKOFFSCREENWINDOW_H_
+#define _SDKOFFSCREENWINDOW_H_
+
+#include "SdkWindow.h"
+
+BEGIN_NAMESPACE_WINDOW
+
+/*!
+* @brief The offscreen window has no handle to window, it renders the views into a bitmap by
+*        the software render target, so the frames do not depend on the display adapter or
+*        the desktop DPI. It is used to compare the rendered frames and to measure the painting.
+*
+* @remark The same as SdkWindowForm, the views invalidated are repainted in their dirty
+*         rectangles only, RenderFrame paints the rectangles invalidated since the last frame.
+*/
+class CLASS_DECLSPEC SdkOffscreenWindow : public SdkWindow
+{
+public:
+
+    /*!
+    * @brief The constructor function.
+    */
+    SdkOffscreenWindow();
+
+    /*!
+    * @brief The destructor function.
+    */
+    virtual ~SdkOffscreenWindow();
+
+    /*!
+    * @brief Set the size of the frame, the root view is resized to the frame.
+    *
+    * @param uWidth     [I/ ] The width of the frame in pixels.
+    * @param uHeight    [I/ ] The height of the frame in pixels.
+    *
+    * @return S_OK if succeeds, otherwise return error code.
+    */
+    HRESULT SetFrameSize(UINT32 uWidth, UINT32 uHeight);
+
+    /*!
+    * @brief Render the views invalidated since the last frame.
+    *
+    * @param isForceFull    [I/ ] TRUE to repaint the whole frame.
+    *
+    * @return S_OK if succeeds, otherwise return error code.
+    */
+    HRESULT RenderFrame(BOOL isForceFull = FALSE);
+
+    /*!
+    * @brief Get the bitmap of the frame, the caller should release it.
+    *
+    * @param ppBitmap   [ /O] The 32bpp premultiplied BGRA bitmap.
+    *
+    * @return S_OK if succeeds, otherwise return error code.
+    */
+    HRESULT GetFrameBitmap(OUT IWICBitmap **ppBitmap);
+
+    /*!
+    * @brief Get the width of the frame.
+    *
+    * @return The width.
+    */
+    virtual LONG GetWidth() const;
+
+    /*!
+    * @brief Get the height of the frame.
+    *
+    * @return The height.
+    */
+    virtual LONG GetHeight() const;
+
+    /*!
+    * @brief Keep the dirty rectangles to be painted by the next RenderFrame.
+    *
+    * @param isErase    [I/ ] TRUE to repaint the rectangle, or the whole frame if it is NULL.
+    * @param lprcPaint  [I/ ] The rectangle in client coordinates.
+    */
+    virtual void Invalidate(BOOL isErase = FALSE, const LPRECT lprcPaint = NULL);
+
+protected:
+
+    /*!
+    * @brief Add a dirty rectangle, it is clipped to the frame.
+    *
+    * @param rcView     [I/ ] The dirty rectangle in view coordinates.
+    */
+    virtual void AddDirtyRect(IN const D2D1_RECT_F& rcView);
+
+protected:
+
+    UINT32          m_uFrameWidth;          // The width of the frame.
+    UINT32          m_uFrameHeight;         // The height of the frame.
+    BOOL            m_isFullFrame;          // Indicates whether the whole frame is repainted.
+    vector<RECT>    m_vctPaintRects;        // The rectangles to be painted by the next frame.
+};
+
+END_NAMESPACE_WINDOW
+
+#endif // _SDKOFFSCREENWINDOW_H_
+#endif // __cplusplus
@@ -17,6 +17,8 @@
 
 BEGIN_NAMESPACE_THEME
 
+class SdkResManagerLock;
+
 
 /*!
 * @brief The image information.
@@ -31,9 +33,15 @@ typedef struct _IMAGEDATA
 
 } IMAGEDATA, *LPIMAGEDATA;
 
+typedef const IMAGEDATA *LPCIMAGEDATA;
+
 
 /*!
 * @brief The SdkResManager class.
+*
+* @remark The images are cached in a hash table keyed by the module and the resource id,
+*         the table can be accessed from any thread. The cached bitmaps are shared by all
+*         the callers and owned by the manager, they are deleted in FreeResLibrary.
 */
 class CLASS_DECLSPEC SdkResManager
 {
@@ -59,12 +67,26 @@ public:
     */
     static HMODULE GetResModule();
 
+    /*!
+    * @brief Load the images of a manifest into the cache in advance, it is called by
+    *        SdkUIRunTime::InitializeUIRunTime with IDR_PRELOAD_IMAGES, and it can be called
+    *        from a background thread with the images of the main window.
+    *
+    * @param nManifestId    [I/ ] The id of the RCDATA resource, it is an array of WORD image ids.
+    * @param hModule        [I/ ] The module handle. If you want to get resource from default, should be NULL.
+    *
+    * @return The count of the images of the manifest which are in the cache, -1 if the
+    *         manifest is not found.
+    */
+    static int PreloadImages(int nManifestId, HMODULE hModule = NULL);
+
     /*!
     * @brief Get image from specified default HMODULE.
     *
     * @param nResId     [I/ ] The resource id.
     *
-    * @return The handle to the HBITMAP.
+    * @return The handle to the HBITMAP, it is shared and owned by the cache, do not
+    *         delete or modify it.
     */
     static HBITMAP GetImage(int nResId);
 
@@ -74,7 +96,8 @@ public:
     * @param nResId     [I/ ] The resource id.
     * @param hModule    [I/ ] The module handle. If you want to get resource from default, should be NULL.
     *
-    * @return The handle to the HBITMAP.
+    * @return The handle to the HBITMAP, it is shared and owned by the cache, do not
+    *         delete or modify it.
     */
     static HBITMAP GetImage(int nResId, HMODULE hModule);
 
@@ -84,9 +107,10 @@ public:
     * @param nResId     [I/ ] The resource id.
     * @param hModule    [I/ ] The module handle. If you want to get resource from default, should be NULL.
     *
-    * @return The pointer to IMAGEINFO structure, should not delete the memory.
+    * @return The pointer to IMAGEDATA structure, it is valid until FreeResLibrary is called,
+    *         should not delete the memory.
     */
-    static LPIMAGEDATA GetImageInfo(int nResId, HMODULE hModule);
+    static LPCIMAGEDATA GetImageInfo(int nResId, HMODULE hModule);
 
     /*!
     * @brief Get the string from specified HMODULE.
@@ -102,21 +126,48 @@ public:
 private:
 
     /*!
-    * @brief Find image data from list according to the specified resource id and module handle.
+    * @brief Find image data from hash table according to the specified resource id and module handle,
+    *        the caller should hold the lock.
     *
     * @param nResId     [I/ ] The resource id.
-    * @param hModule    [I/ ] The module handle. If you want to get resource from default, should be NULL.
+    * @param hModule    [I/ ] The module handle.
     *
     * @return The pointer to IMAGEDATA data, NULL if not found.
     */
     static LPIMAGEDATA FindImageData(int nResId, HMODULE hModule);
 
+    /*!
+    * @brief Add the image data to the hash table, the caller should hold the lock.
+    *
+    * @param lpImageData    [I/ ] The image data, the table takes the ownership.
+    */
+    static void InsertImageData(LPIMAGEDATA lpImageData);
+
+    /*!
+    * @brief Delete all the cached images.
+    */
+    static void ClearImageData();
+
+    /*!
+    * @brief Get the bucket index of the specified resource id and module handle.
+    *
+    * @param nResId     [I/ ] The resource id.
+    * @param hModule    [I/ ] The module handle.
+    * @param nBuckets   [I/ ] The count of the buckets, it is power of 2.
+    *
+    * @return The bucket index.
+    */
+    static size_t GetBucketIndex(int nResId, HMODULE hModule, size_t nBuckets);
+
 private:
 
-    static HMODULE               s_hResModule;              // The resource library module.
-    static vector<wstring>       s_vctStrings;              // The string list.
-    static vector<LPIMAGEDATA>   s_vctImageInfos;           // The image informations.
-    static SdkWICImageHelper    *s_pImageHelper;            // The image helper.
+    friend class SdkResManagerLock;
+
+    static HMODULE                      s_hResModule;       // The resource library module.
+    static vector<wstring>              s_vctStrings;       // The string list.
+    static CRITICAL_SECTION             s_csLock;           // The lock of the image table.
+    static size_t                       s_nImageCount;      // The count of the cached images.
+    static vector< vector<LPIMAGEDATA> > s_vctImageBuckets; // The hash buckets of the cached images.
 };
 
 END_NAMESPACE_THEME
@@ -37,6 +37,7 @@ BEGIN_NAMESPACE_WINDOW
 class SdkWindow;
 class SdkWindowForm;
 class SdkWindowDialog;
+class SdkOffscreenWindow;
 class SdkMessageBox;
 END_NAMESPACE_WINDOW
 
@@ -47,6 +48,7 @@ END_NAMESPACE_WINDOW
 BEGIN_NAMESPACE_VIEWS
 class SdkViewElement;
 class SdkViewLayout;
+class SdkViewGridIndex;
 class SdkComboBox;
 class SdkEditBox;
 class SdkButton;
@@ -98,6 +100,7 @@ END_NAMESPACE_UILIB
 BEGIN_NAMESPACE_D2D
 class D2DAnimatedGif;
 class D2DBitmap;
+class D2DBitmapAtlas;
 class D2DBitmapBrush;
 class D2DBrush;
 class D2DCustomTextRenderer;
@@ -466,9 +469,24 @@ typedef enum _DEVICE_TARGET_TYPE
     DEVICE_TARGET_TYPE_HWND             = 1,        // HWND target.
     DEVICE_TARGET_TYPE_MEMORY           = 2,        // Bitmap target.
     DEVICE_TARGET_TYPE_DC               = 3,        // DC target.
+    DEVICE_TARGET_TYPE_SOFTWARE         = 4,        // Bitmap target rasterized by CPU, no window is needed.
 
 } DEVICE_TARGET_TYPE;
 
+
+/*!
+* @brief The counters of the frame being drawn, they are reset by BeginDraw.
+*/
+typedef enum _DEVICE_FRAMESTAT
+{
+    DEVICE_FRAMESTAT_PAINTVIEW          = 0,        // The views painted.
+    DEVICE_FRAMESTAT_CULLVIEW           = 1,        // The views out of the dirty rectangles.
+    DEVICE_FRAMESTAT_RECORDLAYER        = 2,        // The cached layers recorded.
+    DEVICE_FRAMESTAT_DRAWLAYER          = 3,        // The cached layers drawn.
+    DEVICE_FRAMESTAT_COUNT              = 4,        // The count of the counters.
+
+} DEVICE_FRAMESTAT;
+
 END_NAMESPACE_D2D
 
 #endif // _SDKUICOMMON_H_
@@ -22,6 +22,7 @@
 #include "SdkScaleAnimation.h"
 #include "SdkViewElement.h"
 #include "SdkViewLayout.h"
+#include "SdkViewGridIndex.h"
 #include "SdkButton.h"
 #include "SdkRadioButton.h"
 #include "SdkCheckBox.h"
@@ -48,6 +49,7 @@
 #include "SdkBaseAdapter.h"
 #include "SdkDataSetObserver.h"
 #include "D2DBitmap.h"
+#include "D2DBitmapAtlas.h"
 #include "D2DSolidColorBrush.h"
 #include "D2DBitmapBrush.h"
 #include "D2DLinearGradientBrush.h"
@@ -58,6 +60,7 @@
 #include "SdkWindow.h"
 #include "SdkWindowForm.h"
 #include "SdkWindowDialog.h"
+#include "SdkOffscreenWindow.h"
 #include "SdkMessageBox.h"
 #include "SdkUIRunTime.h"
 #include "SdkResManager.h"
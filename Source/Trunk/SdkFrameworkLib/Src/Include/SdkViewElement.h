@@ -78,6 +78,7 @@ typedef enum _VIEW_STATE
     VIEW_STATE_CANCELEVENT                  = 0x00100000,       // Cancel event.
     VIEW_STATE_DISABLECANCELEVENT           = 0x00200000,       // Disable cancel clicking.
     VIEW_STATE_PAINTALLVIEWS                = 0x00800000,       // Paint all children of a view layout.
+    VIEW_STATE_CACHELAYER                   = 0x01000000,       // Paint the view and its children from a cached layer.
 
 } VIEW_STATE;
 
@@ -484,6 +485,25 @@ public:
     */
     void SetRoundCornerRadius(FLOAT fRadiusX = 10.0f, FLOAT fRadiusY = 10.0f);
 
+    /*!
+    * @brief Enable or disable the layer cache. The view and its children are recorded into a
+    *        bitmap, which is drawn instead of them until one of them is invalidated. It is
+    *        useful for the static views, such as backgrounds, group boxes and tab headers.
+    *
+    * @param fEnable        [I/ ] TRUE if enable, FALSE if disable.
+    *
+    * @remark The children out of the bounds of the view are not in the layer. The view is
+    *         drawn directly while its animation is running.
+    */
+    void SetLayerCacheEnable(BOOL fEnable);
+
+    /*!
+    * @brief Indicates whether the layer cache is enabled.
+    *
+    * @return TRUE if enabled, otherwise FALSE.
+    */
+    BOOL IsLayerCacheEnable() const;
+
     /*!
     * @brief Set border width, maximum value is 4.0f.
     *
@@ -896,6 +916,44 @@ protected:
     */
     Matrix3x2F GetAbsoluteMatrix();
 
+    /*!
+    * @brief Mark the cached absolute offset, matrix and drawing rectangle of the view and its
+    *        children out of date, they are computed again when they are used.
+    *
+    * @remark If the cache of a view is out of date, so are its children's, the derived class
+    *         which has children should stop at the view whose cache is out of date.
+    */
+    virtual void InvalidateWorldCache();
+
+    /*!
+    * @brief Indicates whether the cached absolute offset, matrix and drawing rectangle are valid.
+    *
+    * @return TRUE if valid, otherwise FALSE.
+    */
+    BOOL IsWorldCacheValid() const;
+
+    /*!
+    * @brief Compute the absolute offset, matrix and drawing rectangle if they are out of date,
+    *        the parent views are computed first.
+    */
+    void UpdateWorldCache();
+
+    /*!
+    * @brief Take the current animation matrix for the children, they are invalidated if the
+    *        matrix is changed. It is called before drawing the children.
+    */
+    void SyncAnimationMatrix();
+
+    /*!
+    * @brief Get the bounds of the points which IsPtInRect accepts.
+    *
+    * @param rcBounds       [ /O] The bounds in window view coordinates.
+    *
+    * @return FALSE if the bounds change at any time because the animation matrix is applied,
+    *         otherwise TRUE.
+    */
+    BOOL GetHitTestBounds(OUT D2D1_RECT_F& rcBounds);
+
     /*!
     * @brief Convert specified point to another point, if no matrix takes on the view, 
     *        returned point is same with source point.
@@ -958,6 +1016,54 @@ protected:
     */
     void ForceInvalidate();
 
+    /*!
+    * @brief Get the bounds covered by the view when it is painted, the T, S, R matrix and the
+    *        animation matrix are applied, the border is included.
+    *
+    * @param rcBounds       [ /O] The bounds in window view coordinates.
+    */
+    void GetPaintBounds(OUT D2D1_RECT_F& rcBounds);
+
+    /*!
+    * @brief Indicates whether the view is out of the dirty rectangle being painted, the derived
+    *        class should not draw its children if it is culled.
+    *
+    * @return TRUE if culled, otherwise FALSE.
+    */
+    BOOL IsPaintCulled() const;
+
+    /*!
+    * @brief Add the bounds painted last time and the current bounds to the dirty rectangles
+    *        of the window, so that the old and the new place are both repainted.
+    */
+    void AddDirtyBounds();
+
+    /*!
+    * @brief Paint the view, it is drawn from the cached layer if the layer cache is enabled,
+    *        otherwise OnPaint is called. The parent should call it to paint its children.
+    */
+    void PaintView();
+
+    /*!
+    * @brief Mark the cached layers of the view and its parents out of date, they are recorded
+    *        again when painted next time.
+    */
+    void InvalidateLayerCache();
+
+    /*!
+    * @brief Record the view and its children into the cached layer.
+    *
+    * @param rcBounds       [I/ ] The paint bounds of the view.
+    *
+    * @return S_OK if succeeds, otherwise the error of D2D.
+    */
+    HRESULT RecordLayer(IN const D2D1_RECT_F& rcBounds);
+
+    /*!
+    * @brief Release the cached layer.
+    */
+    void ReleaseLayer();
+
     /*!
     * @brief Call this method to set the class name, typically, it is called in derived
     *        class and the memory pointed by lpClassName should not be in stack, instead existing
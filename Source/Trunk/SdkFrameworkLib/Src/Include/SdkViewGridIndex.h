@@ -0,0 +1,143 @@
+/*!
+* @file SdkViewGridIndex.h
+*
+* @brief This file defines the class SdkViewGridIndex, a uniform grid over the bounds of the
+*        children of a layout, which is used to find the children under a point.
+*
+* Copyright (C) 2011, LZT Corporation.
+*
+* @author Li Hong
+* @date 2011/06/30
+*/
+
+#ifdef __cplusplus
+#ifndef _SDKVIEWGRIDINDEX_H_
+#define _SDKVIEWGRIDINDEX_H_
+
+#include "SdkUICommon.h"
+
+BEGIN_NAMESPACE_VIEWS
+
+#define VIEW_GRID_MIN_ITEMS         64          // The min count of the children to use the index.
+#define VIEW_GRID_ITEMS_PER_CELL    4           // The average count of the children in one cell.
+#define VIEW_GRID_MAX_CELLS         128         // The max count of the cells in one direction.
+
+/*!
+* @brief The SdkViewGridIndex class. The items are the indices of the children, each item is
+*        put into the cells covered by its bounds, the items without fixed bounds, such as the
+*        animating views, are tested for every point.
+*
+* @remark The items and the points out of the grid are clamped to the edge cells, so an item
+*         is always found at the points of its bounds even if it moves out of the grid.
+*/
+class CLASS_DECLSPEC SdkViewGridIndex
+{
+public:
+
+    /*!
+    * @brief The constructor function.
+    */
+    SdkViewGridIndex();
+
+    /*!
+    * @brief The destructor function.
+    */
+    ~SdkViewGridIndex();
+
+    /*!
+    * @brief Mark all items out of date, the index should be reset.
+    */
+    void Invalidate();
+
+    /*!
+    * @brief Mark an item out of date, its bounds should be set again. If most of the items
+    *        are out of date, the index is invalidated.
+    *
+    * @param uItem          [I/ ] The index of the item.
+    */
+    void InvalidateItem(UINT32 uItem);
+
+    /*!
+    * @brief Indicates whether the index should be reset.
+    *
+    * @return TRUE if it should be reset, otherwise FALSE.
+    */
+    BOOL IsInvalid() const;
+
+    /*!
+    * @brief Get the items which are out of date and mark them up to date.
+    *
+    * @param vctItems       [ /O] The items out of date.
+    */
+    void TakeDirtyItems(OUT vector<UINT32>& vctItems);
+
+    /*!
+    * @brief Remove all items and make the grid cover the rectangle.
+    *
+    * @param rcExtent       [I/ ] The rectangle covered by the grid, typically the union of the
+    *                             bounds of the items.
+    * @param uItemCount     [I/ ] The count of the items, the items are not found until their
+    *                             bounds are set.
+    */
+    void Reset(IN const D2D1_RECT_F& rcExtent, UINT32 uItemCount);
+
+    /*!
+    * @brief Set the bounds of an item.
+    *
+    * @param uItem          [I/ ] The index of the item.
+    * @param pBounds        [I/ ] The bounds, NULL means the item is tested for every point.
+    */
+    void SetItem(UINT32 uItem, IN const D2D1_RECT_F *pBounds);
+
+    /*!
+    * @brief Get the items which may contain the point.
+    *
+    * @param x              [I/ ] The x value of the point.
+    * @param y              [I/ ] The y value of the point.
+    * @param vctItems       [ /O] The items from the greatest index to the least.
+    */
+    void HitTest(FLOAT x, FLOAT y, OUT vector<UINT32>& vctItems) const;
+
+private:
+
+    /*!
+    * @brief The item of the index.
+    */
+    typedef struct _GRIDITEM
+    {
+        RECT        rcCells;            // The range of the cells, the right and bottom are included.
+        BOOL        isInGrid;           // Indicates whether the item is in the cells.
+        BOOL        isFree;             // Indicates whether the item is tested for every point.
+        BOOL        isDirty;            // Indicates whether the item is out of date.
+
+    } GRIDITEM;
+
+    /*!
+    * @brief Get the range of the cells covered by the rectangle.
+    */
+    void GetCellRange(IN const D2D1_RECT_F& rc, OUT RECT& rcCells) const;
+
+    /*!
+    * @brief Remove the item from the cells or the list of the items without bounds.
+    */
+    void RemoveItem(UINT32 uItem);
+
+private:
+
+    BOOL                        m_isInvalid;            // Indicates whether the index should be reset.
+    INT32                       m_nCols;                // The count of the columns.
+    INT32                       m_nRows;                // The count of the rows.
+    FLOAT                       m_fLeft;                // The left of the grid.
+    FLOAT                       m_fTop;                 // The top of the grid.
+    FLOAT                       m_fCellWidth;           // The width of one cell.
+    FLOAT                       m_fCellHeight;          // The height of one cell.
+    vector<GRIDITEM>            m_vctItems;             // The items.
+    vector<UINT32>              m_vctDirtyItems;        // The items out of date.
+    vector<UINT32>              m_vctFreeItems;         // The items without bounds.
+    vector< vector<UINT32> >    m_vctCells;             // The items of each cell, row by row.
+};
+
+END_NAMESPACE_VIEWS
+
+#endif // _SDKVIEWGRIDINDEX_H_
+#endif // __cplusplus
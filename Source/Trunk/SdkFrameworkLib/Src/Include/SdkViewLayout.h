@@ -22,6 +22,8 @@ BEGIN_NAMESPACE_VIEWS
 */
 class CLASS_DECLSPEC SdkViewLayout : public SdkViewElement
 {
+    friend class SdkViewElement;
+
 public:
 
     /*!
@@ -147,6 +149,25 @@ public:
     */
     virtual BOOL RemoveChildAt(UINT index);
 
+    /*!
+    * @brief Enable or disable the hit-test index of the children. With the index, finding
+    *        the event source only tests the children near the mouse, it is used when the
+    *        layout has VIEW_GRID_MIN_ITEMS children at least.
+    *
+    * @param fEnable    [I/ ] TRUE to enable, FALSE to disable.
+    *
+    * @remark The children should not accept the points out of their bounds, the default
+    *         FindEventSource of the views does not.
+    */
+    void SetHitTestIndexEnable(BOOL fEnable);
+
+    /*!
+    * @brief Indicates whether the hit-test index of the children is enabled.
+    *
+    * @return TRUE if enabled, otherwise FALSE.
+    */
+    BOOL IsHitTestIndexEnable() const;
+
     /*!
     * @brief Find the event source.
     *
@@ -198,6 +219,25 @@ protected:
     */
     virtual void SetWindow(SdkWindow *pWindow);
 
+    /*!
+    * @brief Mark the cache of the view and its children out of date, the children are skipped
+    *        if the cache of the view is already out of date.
+    */
+    virtual void InvalidateWorldCache();
+
+    /*!
+    * @brief Called when the cached bounds of a child are out of date.
+    *
+    * @param pChild     [I/ ] The child.
+    */
+    virtual void OnChildWorldChanged(SdkViewElement *pChild);
+
+    /*!
+    * @brief Update the bounds of the children which are out of date in the hit-test index,
+    *        the index is reset if the children are changed.
+    */
+    void UpdateHitTestIndex();
+
     /*!
     * @brief Called when window is destroy.
     *
@@ -220,6 +260,7 @@ protected:
 
     vector<SdkViewElement*>     m_vctChildren;              // The children list.
     vector<SdkViewElement*>     m_vctRemovedChildren;       // The removed list.
+    SdkViewGridIndex           *m_pHitTestIndex;            // The hit-test index of children, NULL if disabled.
 };
 
 END_NAMESPACE_VIEWS
@@ -17,6 +17,8 @@
 
 BEGIN_NAMESPACE_WINDOW
 
+#define MAX_DIRTY_RECT_COUNT        4       // The max number of dirty rectangles in one frame, more are merged.
+
 /*!
 * @brief The window state values.
 */
@@ -158,6 +160,16 @@ public:
     */
     virtual void GetDesktopDpi(FLOAT *pdpiX, FLOAT *pdpiY);
 
+    /*!
+    * @brief Indicates whether the rectangle intersects the dirty rectangle being painted. The
+    *        views out of the dirty rectangle are not painted.
+    *
+    * @param rcView     [I/ ] The rectangle in view coordinates.
+    *
+    * @return TRUE if it should be painted, it is always TRUE when the whole window is painted.
+    */
+    virtual BOOL IsRectDirty(IN const D2D1_RECT_F& rcView) const;
+
 public:
 
     /*
@@ -280,6 +292,49 @@ protected:
     */
     virtual void AddEventViews(SdkViewElement *pView);
 
+    /*!
+    * @brief Add a dirty rectangle, it is repainted in the next frame with the other dirty
+    *        rectangles. Invalidate function invalidates the dirty rectangles.
+    *
+    * @param rcView     [I/ ] The dirty rectangle in view coordinates.
+    */
+    virtual void AddDirtyRect(IN const D2D1_RECT_F& rcView);
+
+    /*!
+    * @brief Paint the root view in each dirty rectangle, the other part of the render target
+    *        is kept. It should be called between BeginDraw and EndDraw.
+    *
+    * @param vctRects   [I/ ] The dirty rectangles in client coordinates.
+    */
+    virtual void PaintDirtyRects(IN const vector<RECT>& vctRects);
+
+    /*!
+    * @brief Convert the rectangle in view coordinates to client coordinates, the result
+    *        covers all pixels touched by the rectangle.
+    *
+    * @param rcView     [I/ ] The rectangle in view coordinates.
+    * @param rcClient   [ /O] The rectangle in client coordinates.
+    */
+    void ViewToClientRect(IN const D2D1_RECT_F& rcView, OUT RECT& rcClient);
+
+    /*!
+    * @brief Convert the rectangle in client coordinates to view coordinates.
+    *
+    * @param rcClient   [I/ ] The rectangle in client coordinates.
+    * @param rcView     [ /O] The rectangle in view coordinates.
+    */
+    void ClientToViewRect(IN const RECT& rcClient, OUT D2D1_RECT_F& rcView);
+
+    /*!
+    * @brief Add a rectangle to the rectangles. The rectangles which are covered are removed,
+    *        if the count exceeds MAX_DIRTY_RECT_COUNT, the two rectangles whose union grows
+    *        the least area are merged.
+    *
+    * @param vctRects   [I/O] The rectangles.
+    * @param rc         [I/ ] The rectangle to be added.
+    */
+    static void MergeDirtyRect(IN OUT vector<RECT>& vctRects, IN const RECT& rc);
+
 protected:
 
     HWND             m_hWnd;                // The handle to window.
@@ -290,6 +345,9 @@ protected:
     D2DDevice       *m_pD2DDevice;          // The D2DDevice instance.
     D3DDevice       *m_pD3DDevice;          // D3DDevice instance.
     SdkViewElement  *m_pRootView;           // The content view instance.
+    BOOL             m_isPaintingDirty;     // Indicates whether a dirty rectangle is being painted.
+    D2D1_RECT_F      m_rcPaintingDirty;     // The dirty rectangle being painted, in view coordinates.
+    vector<RECT>     m_vctDirtyRects;       // The dirty rectangles not invalidated, in client coordinates.
 
     static vector<SdkWindow*> s_vctWindows; // The window list.
 };
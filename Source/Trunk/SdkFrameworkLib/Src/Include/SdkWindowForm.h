@@ -282,6 +282,15 @@ private:
     */
     static LRESULT CALLBACK WndProc(HWND hWnd, UINT message, WPARAM wParam, LPARAM lParam);
 
+    /*
+    * @brief Get the rectangles of the update region, they are merged to MAX_DIRTY_RECT_COUNT
+    *        rectangles at most. The rectangles are empty if the whole client should be painted.
+    *
+    * @param hWnd       [I/ ] The handle to the window.
+    * @param vctRects   [ /O] The rectangles of the update region.
+    */
+    static void GetUpdateRects(HWND hWnd, OUT vector<RECT>& vctRects);
+
 protected:
 
     HBITMAP                     m_hMemBitmap;               // The handle to a compatible memory bitmap.
@@ -292,6 +301,7 @@ protected:
     HINSTANCE                   m_hInst;                    // The instance of current process.
     vector<SdkViewElement*>     m_vctEventViews;            // The event views collection.
     map<UINT, SdkViewElement*>  m_mapTargetViews;           // The target views collection.
+    vector<RECT>                m_vctPaintRects;            // The rectangles of the update region.
     static BOOL                 s_hasRegClass;              // Indicate whether register class.
 };
 
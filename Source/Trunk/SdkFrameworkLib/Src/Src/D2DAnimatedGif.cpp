@@ -21,7 +21,10 @@ D2DAnimatedGif::D2DAnimatedGif() : m_pD2DBitmap(NULL),
                                    m_pRenderTarget(NULL),
                                    m_pBitmapRenderTarget(NULL),
                                    m_bkColor(ColorF(0, 0)),
-                                   m_pWicAnimatedGif(new SdkWICAnimatedGif())
+                                   m_pWicAnimatedGif(new SdkWICAnimatedGif()),
+                                   m_uFrameCacheLimit(DEFAULT_GIF_FRAME_CACHE_LIMIT),
+                                   m_uPaintFrameIndex(0),
+                                   m_isPaintFromCache(FALSE)
 {
 }
 
@@ -29,6 +32,7 @@ D2DAnimatedGif::D2DAnimatedGif() : m_pD2DBitmap(NULL),
 
 D2DAnimatedGif::~D2DAnimatedGif()
 {
+    ClearFrameCache();
     SAFE_RELEASE(m_pD2DBitmap);
     SAFE_RELEASE(m_pRenderTarget);
     SAFE_RELEASE(m_pBitmapRenderTarget);
@@ -96,6 +100,7 @@ BOOL D2DAnimatedGif::LoadFromFile(LPCWSTR lpfile)
         retVal = m_pWicAnimatedGif->LoadFromFile(lpfile);
         if (retVal)
         {
+            ClearFrameCache();
             SAFE_RELEASE(m_pD2DBitmap);
             SAFE_RELEASE(m_pBitmapRenderTarget);
         }
@@ -115,6 +120,27 @@ BOOL D2DAnimatedGif::LoadFromResource(UINT uResId, HMODULE hModule)
         retVal = m_pWicAnimatedGif->LoadFromResource(uResId, hModule);
         if (retVal)
         {
+            ClearFrameCache();
+            SAFE_RELEASE(m_pD2DBitmap);
+            SAFE_RELEASE(m_pBitmapRenderTarget);
+        }
+    }
+
+    return retVal;
+}
+
+//////////////////////////////////////////////////////////////////////////
+
+BOOL D2DAnimatedGif::LoadFromWICBitmap(IWICBitmapSource *pSource)
+{
+    BOOL retVal = FALSE;
+
+    if (NULL != m_pWicAnimatedGif)
+    {
+        retVal = m_pWicAnimatedGif->LoadFromWICBitmap(pSource);
+        if (retVal)
+        {
+            ClearFrameCache();
             SAFE_RELEASE(m_pD2DBitmap);
             SAFE_RELEASE(m_pBitmapRenderTarget);
         }
@@ -174,6 +200,16 @@ BOOL D2DAnimatedGif::OnPaintNextFrame()
     if (NULL != m_pBitmapRenderTarget)
     {
         UINT uFrameIndex = m_pWicAnimatedGif->GetFrameIndex();
+
+        // The later loops draw the composed frames of the first loop.
+        m_isPaintFromCache = IsFrameCached();
+        if (m_isPaintFromCache)
+        {
+            m_uPaintFrameIndex = uFrameIndex;
+            m_pWicAnimatedGif->SkipNextFrame(m_vctFrameDelays[uFrameIndex]);
+            return TRUE;
+        }
+
         DisposeCurrentFrame(m_pWicAnimatedGif->GetFrameDisposal());
 
         ID2D1Bitmap *pFrameBitmap = NULL;
@@ -199,6 +235,8 @@ BOOL D2DAnimatedGif::OnPaintNextFrame()
             }
             m_pBitmapRenderTarget->DrawBitmap(pFrameBitmap, frameRc);
             m_pBitmapRenderTarget->EndDraw();
+
+            CacheComposedFrame(uFrameIndex);
         }
         SAFE_RELEASE(pFrameBitmap);
     }
@@ -212,7 +250,13 @@ BOOL D2DAnimatedGif::GetPaintBitmap(ID2D1Bitmap **ppD2DBitmap)
 {
     HRESULT hr = E_FAIL;
 
-    if (NULL != m_pBitmapRenderTarget)
+    if (m_isPaintFromCache && (m_uPaintFrameIndex < m_vctFrameCache.size()) && (NULL != ppD2DBitmap))
+    {
+        (*ppD2DBitmap) = m_vctFrameCache[m_uPaintFrameIndex];
+        (*ppD2DBitmap)->AddRef();
+        hr = S_OK;
+    }
+    else if (NULL != m_pBitmapRenderTarget)
     {
         hr = m_pBitmapRenderTarget->GetBitmap(ppD2DBitmap);
     }
@@ -267,6 +311,27 @@ BOOL D2DAnimatedGif::IsEndAnimation()
 
 //////////////////////////////////////////////////////////////////////////
 
+void D2DAnimatedGif::SetFrameCacheLimit(UINT64 uBytes)
+{
+    m_uFrameCacheLimit = uBytes;
+    if (0 == uBytes)
+    {
+        // The compatible render target still holds the last frame of the first loop.
+        RestorePaintFrame();
+        ClearFrameCache();
+    }
+}
+
+//////////////////////////////////////////////////////////////////////////
+
+BOOL D2DAnimatedGif::IsFrameCached()
+{
+    UINT uFrameCount = GetFrameCount();
+    return (uFrameCount > 1) && (m_vctFrameCache.size() == uFrameCount);
+}
+
+//////////////////////////////////////////////////////////////////////////
+
 BOOL D2DAnimatedGif::DisposeCurrentFrame(UINT uFrameDisposal)
 {
     switch (uFrameDisposal)
@@ -431,6 +496,99 @@ BOOL D2DAnimatedGif::GetFrameRect(OUT D2D1_RECT_F& rc)
 
 //////////////////////////////////////////////////////////////////////////
 
+void D2DAnimatedGif::CacheComposedFrame(UINT uFrameIndex)
+{
+    UINT uFrameCount = GetFrameCount();
+    if ( (NULL == m_pBitmapRenderTarget) || (0 == m_uFrameCacheLimit) || (uFrameCount <= 1) )
+    {
+        return;
+    }
+
+    // A frame is composed on the previous ones, so the frames are kept in order from the
+    // first one, the cache starts again when the first frame is composed again.
+    if (0 == uFrameIndex)
+    {
+        ClearFrameCache();
+    }
+
+    if (uFrameIndex != m_vctFrameCache.size())
+    {
+        return;
+    }
+
+    // The GIF is streamed if all its frames do not fit the limit.
+    D2D1_SIZE_U pixelSize = m_pBitmapRenderTarget->GetPixelSize();
+    UINT64 uBytes = (UINT64)pixelSize.width * pixelSize.height * 4 * uFrameCount;
+    if (uBytes > m_uFrameCacheLimit)
+    {
+        return;
+    }
+
+    ID2D1Bitmap *pFrameBitmap = NULL;
+    D2D1_BITMAP_PROPERTIES bitmapProps = D2D1::BitmapProperties(m_pBitmapRenderTarget->GetPixelFormat());
+    HRESULT hr = m_pBitmapRenderTarget->CreateBitmap(pixelSize, bitmapProps, &pFrameBitmap);
+    if (SUCCEEDED(hr))
+    {
+        hr = pFrameBitmap->CopyFromRenderTarget(NULL, m_pBitmapRenderTarget, NULL);
+    }
+
+    if (SUCCEEDED(hr))
+    {
+        m_vctFrameCache.push_back(pFrameBitmap);
+        m_vctFrameDelays.push_back(m_pWicAnimatedGif->GetFrameDelay());
+    }
+    else
+    {
+        SAFE_RELEASE(pFrameBitmap);
+    }
+}
+
+//////////////////////////////////////////////////////////////////////////
+
+void D2DAnimatedGif::ClearFrameCache()
+{
+    for (vector<ID2D1Bitmap*>::iterator iter = m_vctFrameCache.begin(); iter != m_vctFrameCache.end(); ++iter)
+    {
+        SAFE_RELEASE(*iter);
+    }
+
+    m_vctFrameCache.clear();
+    m_vctFrameDelays.clear();
+    m_isPaintFromCache = FALSE;
+}
+
+//////////////////////////////////////////////////////////////////////////
+
+BOOL D2DAnimatedGif::RestorePaintFrame()
+{
+    if ( !m_isPaintFromCache || (m_uPaintFrameIndex >= m_vctFrameCache.size()) || (NULL == m_pBitmapRenderTarget) )
+    {
+        return FALSE;
+    }
+
+    // The cached frame has the pixel format of the compatible render target.
+    ID2D1Bitmap *pTargetBitmap = NULL;
+    HRESULT hr = m_pBitmapRenderTarget->GetBitmap(&pTargetBitmap);
+    if (SUCCEEDED(hr))
+    {
+        hr = pTargetBitmap->CopyFromBitmap(NULL, m_vctFrameCache[m_uPaintFrameIndex], NULL);
+    }
+    SAFE_RELEASE(pTargetBitmap);
+
+    // The cached frames are skipped, so the decoder still has the disposal and the bound of
+    // the last frame. Reading the painted frame does not move the next frame index.
+    if (SUCCEEDED(hr))
+    {
+        IWICFormatConverter *pWicFormatConverter = NULL;
+        hr = m_pWicAnimatedGif->GetFrameAt(m_uPaintFrameIndex, &pWicFormatConverter) ? S_OK : E_FAIL;
+        SAFE_RELEASE(pWicFormatConverter);
+    }
+
+    return SUCCEEDED(hr) ? TRUE : FALSE;
+}
+
+//////////////////////////////////////////////////////////////////////////
+
 void D2DAnimatedGif::SetFrameIndex(UINT uNextFrameIndex)
 {
     if (NULL != m_pWicAnimatedGif)
@@ -463,6 +621,8 @@ void D2DAnimatedGif::OnD2DDeviceStateChange(D2DDevice *pDevice, DEVICE_STATECHAN
     UNREFERENCED_PARAMETER(pDevice);
     UNREFERENCED_PARAMETER(stateVal);
 
+    // The cached frames are the resources of the render target.
+    ClearFrameCache();
     SAFE_RELEASE(m_pRenderTarget);
     SAFE_RELEASE(m_pBitmapRenderTarget);
 }
@@ -474,6 +634,8 @@ void D2DAnimatedGif::OnD2DDeviceResize(D2DDevice *pDevice, DEVICE_STATECHANGE_VA
     UNREFERENCED_PARAMETER(pDevice);
     UNREFERENCED_PARAMETER(stateVal);
 
+    // The cached frames are the resources of the render target.
+    ClearFrameCache();
     SAFE_RELEASE(m_pRenderTarget);
     SAFE_RELEASE(m_pBitmapRenderTarget);
 }
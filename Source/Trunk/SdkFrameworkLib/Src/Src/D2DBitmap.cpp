@@ -18,7 +18,10 @@ USING_NAMESPACE_D2D
 
 D2DBitmap::D2DBitmap() : m_pD2DBitmap(NULL),
                          m_pRenderTarget(NULL),
-                         m_pWICImageHelper(new SdkWICImageHelper())
+                         m_pWICImageHelper(new SdkWICImageHelper()),
+                         m_hSharedBitmap(NULL),
+                         m_uSharedWidth(0),
+                         m_uSharedHeight(0)
 {
 }
 
@@ -86,6 +89,7 @@ BOOL D2DBitmap::HasInitialized()
 BOOL D2DBitmap::LoadFromFile(LPCWSTR lpfile, UINT32 uDestWidth, UINT32 uDestHeight)
 {
     BOOL retVal = FALSE;
+    m_hSharedBitmap = NULL;
 
     if (NULL != m_pWICImageHelper)
     {
@@ -103,6 +107,7 @@ BOOL D2DBitmap::LoadFromFile(LPCWSTR lpfile, UINT32 uDestWidth, UINT32 uDestHeig
 BOOL D2DBitmap::LoadFromHBITMAP(HBITMAP hBitmap, UINT32 uDestWidth, UINT32 uDestHeight)
 {
     BOOL retVal = FALSE;
+    m_hSharedBitmap = NULL;
 
     if (NULL != m_pWICImageHelper)
     {
@@ -117,9 +122,34 @@ BOOL D2DBitmap::LoadFromHBITMAP(HBITMAP hBitmap, UINT32 uDestWidth, UINT32 uDest
 
 //////////////////////////////////////////////////////////////////////////
 
+BOOL D2DBitmap::LoadFromSharedHBITMAP(HBITMAP hBitmap)
+{
+    BITMAP bmp = { 0 };
+    if ( (NULL == hBitmap) || (0 == GetObject(hBitmap, sizeof(BITMAP), &bmp)) )
+    {
+        return FALSE;
+    }
+
+    m_hSharedBitmap = hBitmap;
+    m_uSharedWidth  = (UINT)bmp.bmWidth;
+    m_uSharedHeight = (UINT)bmp.bmHeight;
+
+    // Delete the old bitmap and image data.
+    SAFE_RELEASE(m_pD2DBitmap);
+    if (NULL != m_pWICImageHelper)
+    {
+        m_pWICImageHelper->ClearImageData();
+    }
+
+    return TRUE;
+}
+
+//////////////////////////////////////////////////////////////////////////
+
 BOOL D2DBitmap::LoadFromResource(UINT uResId, HMODULE hModule, UINT32 uDestWidth, UINT32 uDestHeight)
 {
     BOOL retVal = FALSE;
+    m_hSharedBitmap = NULL;
 
     if (NULL != m_pWICImageHelper)
     {
@@ -134,6 +164,24 @@ BOOL D2DBitmap::LoadFromResource(UINT uResId, HMODULE hModule, UINT32 uDestWidth
 
 //////////////////////////////////////////////////////////////////////////
 
+BOOL D2DBitmap::LoadFromWICBitmap(IWICBitmapSource *pSource)
+{
+    BOOL retVal = FALSE;
+    m_hSharedBitmap = NULL;
+
+    if (NULL != m_pWICImageHelper)
+    {
+        retVal = m_pWICImageHelper->LoadFromWICBitmap(pSource);
+    }
+
+    // Delete the old bitmap.
+    SAFE_RELEASE(m_pD2DBitmap);
+
+    return retVal;
+}
+
+//////////////////////////////////////////////////////////////////////////
+
 BOOL D2DBitmap::GetD2DBitmap(OUT ID2D1Bitmap **ppD2DBitmap)
 {
     if ( NULL == ppD2DBitmap || NULL == m_pWICImageHelper )
@@ -145,6 +193,12 @@ BOOL D2DBitmap::GetD2DBitmap(OUT ID2D1Bitmap **ppD2DBitmap)
 
     if ( NULL == m_pD2DBitmap )
     {
+        // The pixels of the shared bitmap are copied only when they are used.
+        if ( NULL != m_hSharedBitmap )
+        {
+            m_pWICImageHelper->LoadFromHBITMAP(m_hSharedBitmap);
+        }
+
         IWICFormatConverter *pWicFormatConverter = NULL;
         m_pWICImageHelper->GetFormatConverter(&pWicFormatConverter);
 
@@ -194,6 +248,13 @@ BOOL D2DBitmap::GetD2DBitmap(OUT ID2D1Bitmap **ppD2DBitmap)
 
 //////////////////////////////////////////////////////////////////////////
 
+HBITMAP D2DBitmap::GetSharedHBITMAP() const
+{
+    return m_hSharedBitmap;
+}
+
+//////////////////////////////////////////////////////////////////////////
+
 UINT D2DBitmap::GetWidth()
 {
     if ( NULL != m_pD2DBitmap )
@@ -203,6 +264,11 @@ UINT D2DBitmap::GetWidth()
         return (UINT)size.width;
     }
 
+    if ( NULL != m_hSharedBitmap )
+    {
+        return m_uSharedWidth;
+    }
+
     return m_pWICImageHelper->GetWidth();
 }
 
@@ -217,6 +283,11 @@ UINT D2DBitmap::GetHeight()
         return (UINT)size.height;
     }
 
+    if ( NULL != m_hSharedBitmap )
+    {
+        return m_uSharedHeight;
+    }
+
     return m_pWICImageHelper->GetHeight();
 }
 
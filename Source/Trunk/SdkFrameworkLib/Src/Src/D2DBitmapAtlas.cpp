@@ -0,0 +1,276 @@
+/*!
+* @file D2DBitmapAtlas.cpp
+*
+* @brief This file defines the class D2DBitmapAtlas, which packs the shared skin bitmaps
+*        into a few big bitmaps of one render target.
+*
+* Copyright (C) 2011, LZT Corporation.
+*
+* @author Li Hong
+* @date 2011/06/30
+*/
+
+#include "stdafx.h"
+#include "D2DBitmapAtlas.h"
+#include "SdkCommonInclude.h"
+
+USING_NAMESPACE_D2D
+
+#define D2D_ATLAS_PIXEL_SIZE        4           // The bytes of one 32bpp pixel.
+
+
+/*!
+* @brief The page of the atlas, the images are placed in rows.
+*/
+struct NAMESPACE_D2D::D2DBitmapAtlas::_ATLAS_PAGE
+{
+    ID2D1Bitmap            *m_pBitmap;          // The page bitmap.
+    UINT32                  m_uRowX;            // The left of the free area in current row.
+    UINT32                  m_uRowY;            // The top of current row.
+    UINT32                  m_uRowHeight;       // The height of current row.
+};
+
+/*!
+* @brief The image placed in the atlas.
+*/
+struct NAMESPACE_D2D::D2DBitmapAtlas::_ATLAS_IMAGE
+{
+    int                     m_nPage;            // The page index, -1 means the image is not packed.
+    UINT32                  m_uLeft;            // The left of the cell, including the gutter.
+    UINT32                  m_uTop;             // The top of the cell, including the gutter.
+    UINT32                  m_uWidth;           // The width of the image.
+    UINT32                  m_uHeight;          // The height of the image.
+};
+
+//////////////////////////////////////////////////////////////////////////
+
+D2DBitmapAtlas::D2DBitmapAtlas(ID2D1RenderTarget *pRenderTarget) : m_pRenderTarget(pRenderTarget)
+{
+    SAFE_ADDREF(m_pRenderTarget);
+}
+
+//////////////////////////////////////////////////////////////////////////
+
+D2DBitmapAtlas::~D2DBitmapAtlas()
+{
+    for each (_ATLAS_PAGE *pPage in m_vctPages)
+    {
+        SAFE_RELEASE(pPage->m_pBitmap);
+        SAFE_DELETE(pPage);
+    }
+
+    for (map<HBITMAP, _ATLAS_IMAGE*>::iterator iter = m_mapImages.begin(); iter != m_mapImages.end(); ++iter)
+    {
+        SAFE_DELETE(iter->second);
+    }
+
+    m_vctPages.clear();
+    m_mapImages.clear();
+
+    SAFE_RELEASE(m_pRenderTarget);
+}
+
+//////////////////////////////////////////////////////////////////////////
+
+ID2D1RenderTarget* D2DBitmapAtlas::GetRenderTarget() const
+{
+    return m_pRenderTarget;
+}
+
+//////////////////////////////////////////////////////////////////////////
+
+BOOL D2DBitmapAtlas::GetBitmap(
+    IN HBITMAP hBitmap,
+    IN UINT32 uWidth,
+    IN UINT32 uHeight,
+    OUT ID2D1Bitmap **ppD2DBitmap,
+    OUT D2D1_RECT_F& rcSource)
+{
+    if ( (NULL == hBitmap) || (NULL == ppD2DBitmap) || (NULL == m_pRenderTarget) )
+    {
+        return FALSE;
+    }
+
+    _ATLAS_IMAGE *pImage = NULL;
+    map<HBITMAP, _ATLAS_IMAGE*>::iterator iter = m_mapImages.find(hBitmap);
+    if ( iter != m_mapImages.end() )
+    {
+        pImage = iter->second;
+    }
+    else
+    {
+        pImage = new _ATLAS_IMAGE();
+        ZeroMemory(pImage, sizeof(_ATLAS_IMAGE));
+        pImage->m_nPage   = -1;
+        pImage->m_uWidth  = uWidth;
+        pImage->m_uHeight = uHeight;
+        m_mapImages[hBitmap] = pImage;
+
+        // The failed image is kept too, so it is not tried again in every frame.
+        BOOL canPack = (uWidth > 0) && (uHeight > 0) &&
+                       (uWidth <= D2D_ATLAS_MAX_IMAGE_SIZE) && (uHeight <= D2D_ATLAS_MAX_IMAGE_SIZE);
+        if ( canPack && PlaceImage(uWidth + 2 * D2D_ATLAS_GUTTER, uHeight + 2 * D2D_ATLAS_GUTTER, pImage) )
+        {
+            if ( !UploadImage(hBitmap, pImage) )
+            {
+                pImage->m_nPage = -1;
+            }
+        }
+    }
+
+    // The size is checked in case the handle is reused by another bitmap.
+    if ( (pImage->m_nPage < 0) || (pImage->m_uWidth != uWidth) || (pImage->m_uHeight != uHeight) )
+    {
+        return FALSE;
+    }
+
+    FLOAT fLeft = (FLOAT)(pImage->m_uLeft + D2D_ATLAS_GUTTER);
+    FLOAT fTop  = (FLOAT)(pImage->m_uTop + D2D_ATLAS_GUTTER);
+    rcSource = D2D1::RectF(fLeft, fTop, fLeft + uWidth, fTop + uHeight);
+
+    (*ppD2DBitmap) = m_vctPages[pImage->m_nPage]->m_pBitmap;
+    SAFE_ADDREF((*ppD2DBitmap));
+
+    return TRUE;
+}
+
+//////////////////////////////////////////////////////////////////////////
+
+UINT D2DBitmapAtlas::GetPageCount() const
+{
+    return (UINT)m_vctPages.size();
+}
+
+//////////////////////////////////////////////////////////////////////////
+
+UINT D2DBitmapAtlas::GetImageCount() const
+{
+    UINT uCount = 0;
+
+    for (map<HBITMAP, _ATLAS_IMAGE*>::const_iterator iter = m_mapImages.begin(); iter != m_mapImages.end(); ++iter)
+    {
+        if ( iter->second->m_nPage >= 0 )
+        {
+            ++uCount;
+        }
+    }
+
+    return uCount;
+}
+
+//////////////////////////////////////////////////////////////////////////
+
+BOOL D2DBitmapAtlas::PlaceImage(UINT32 uCellWidth, UINT32 uCellHeight, OUT _ATLAS_IMAGE *pImage)
+{
+    _ATLAS_PAGE *pPage = m_vctPages.empty() ? NULL : m_vctPages.back();
+
+    if ( NULL != pPage )
+    {
+        // Start a new row if current row has no room.
+        if ( pPage->m_uRowX + uCellWidth > D2D_ATLAS_PAGE_SIZE )
+        {
+            pPage->m_uRowY     += pPage->m_uRowHeight;
+            pPage->m_uRowX      = 0;
+            pPage->m_uRowHeight = 0;
+        }
+
+        if ( pPage->m_uRowY + uCellHeight > D2D_ATLAS_PAGE_SIZE )
+        {
+            pPage = NULL;
+        }
+    }
+
+    if ( NULL == pPage )
+    {
+        if ( m_vctPages.size() >= D2D_ATLAS_MAX_PAGES )
+        {
+            return FALSE;
+        }
+
+        D2D1_BITMAP_PROPERTIES props = D2D1::BitmapProperties(
+            D2D1::PixelFormat(DXGI_FORMAT_B8G8R8A8_UNORM, D2D1_ALPHA_MODE_PREMULTIPLIED));
+
+        ID2D1Bitmap *pBitmap = NULL;
+        HRESULT hr = m_pRenderTarget->CreateBitmap(
+            D2D1::SizeU(D2D_ATLAS_PAGE_SIZE, D2D_ATLAS_PAGE_SIZE), props, &pBitmap);
+        if ( FAILED(hr) )
+        {
+            return FALSE;
+        }
+
+        pPage = new _ATLAS_PAGE();
+        ZeroMemory(pPage, sizeof(_ATLAS_PAGE));
+        pPage->m_pBitmap = pBitmap;
+        m_vctPages.push_back(pPage);
+    }
+
+    pImage->m_nPage = (int)m_vctPages.size() - 1;
+    pImage->m_uLeft = pPage->m_uRowX;
+    pImage->m_uTop  = pPage->m_uRowY;
+
+    pPage->m_uRowX     += uCellWidth;
+    pPage->m_uRowHeight = max(pPage->m_uRowHeight, uCellHeight);
+
+    return TRUE;
+}
+
+//////////////////////////////////////////////////////////////////////////
+
+BOOL D2DBitmapAtlas::UploadImage(HBITMAP hBitmap, const _ATLAS_IMAGE *pImage)
+{
+    UINT32 uWidth  = pImage->m_uWidth;
+    UINT32 uHeight = pImage->m_uHeight;
+    UINT32 uCellWidth  = uWidth + 2 * D2D_ATLAS_GUTTER;
+    UINT32 uCellHeight = uHeight + 2 * D2D_ATLAS_GUTTER;
+    UINT32 uCellStride = uCellWidth * D2D_ATLAS_PIXEL_SIZE;
+
+    BITMAPINFO bmi = { 0 };
+    bmi.bmiHeader.biSize        = sizeof(BITMAPINFOHEADER);
+    bmi.bmiHeader.biWidth       = uWidth;
+    bmi.bmiHeader.biHeight      = -(int)uHeight;
+    bmi.bmiHeader.biPlanes      = 1;
+    bmi.bmiHeader.biBitCount    = 32;
+    bmi.bmiHeader.biCompression = BI_RGB;
+
+    // The image is read first, then it is copied into the middle of the cell.
+    vector<UINT32> vctCell(uCellWidth * uCellHeight, 0);
+    vector<UINT32> vctPixels(uWidth * uHeight, 0);
+
+    HDC hdcScreen = GetDC(NULL);
+    int nLines = GetDIBits(hdcScreen, hBitmap, 0, uHeight, &vctPixels[0], &bmi, DIB_RGB_COLORS);
+    ReleaseDC(NULL, hdcScreen);
+
+    if ( nLines != (int)uHeight )
+    {
+        return FALSE;
+    }
+
+    // The pixels are taken as straight alpha the same as D2DBitmap::LoadFromHBITMAP does,
+    // so the packed image looks the same as the one created by itself.
+    SdkPixelKernels::PremultiplyAlpha(&vctPixels[0], vctPixels.size());
+
+    // Each cell row is the image row with its first and last pixels repeated, the
+    // first and last image rows are repeated as the top and bottom gutter.
+    for (UINT32 y = 0; y < uCellHeight; ++y)
+    {
+        UINT32 uSrcY = (y < D2D_ATLAS_GUTTER) ? 0 : min(y - D2D_ATLAS_GUTTER, uHeight - 1);
+        const UINT32 *pSrcRow = &vctPixels[uSrcY * uWidth];
+        UINT32 *pDestRow = &vctCell[y * uCellWidth];
+
+        for (UINT32 x = 0; x < D2D_ATLAS_GUTTER; ++x)
+        {
+            pDestRow[x] = pSrcRow[0];
+            pDestRow[uCellWidth - 1 - x] = pSrcRow[uWidth - 1];
+        }
+
+        memcpy(pDestRow + D2D_ATLAS_GUTTER, pSrcRow, uWidth * D2D_ATLAS_PIXEL_SIZE);
+    }
+
+    D2D1_RECT_U rcDest = D2D1::RectU(
+        pImage->m_uLeft, pImage->m_uTop, pImage->m_uLeft + uCellWidth, pImage->m_uTop + uCellHeight);
+
+    ID2D1Bitmap *pPageBitmap = m_vctPages[pImage->m_nPage]->m_pBitmap;
+    HRESULT hr = pPageBitmap->CopyFromMemory(&rcDest, &vctCell[0], uCellStride);
+
+    return SUCCEEDED(hr) ? TRUE : FALSE;
+}
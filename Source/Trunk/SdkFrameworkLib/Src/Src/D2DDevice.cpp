@@ -29,11 +29,27 @@ D2DDevice* D2DDevice::FromD2DRenderTarget(ID2D1RenderTarget *pRenderTarget)
     {
         D2DDevice *pD2DDevice = s_vctD2DDeviceList[i];
         if ( (pD2DDevice->m_pRenderTarget == pRenderTarget) || 
-             (pD2DDevice->m_pWICBitmapRenderTarget == pRenderTarget) )
+             (pD2DDevice->m_pWICBitmapRenderTarget == pRenderTarget) ||
+             (pD2DDevice->m_pSoftwareRenderTarget == pRenderTarget) )
         {
             pRetD2DDevice = pD2DDevice;
             break;
         }
+
+        // The resources created by a layer target belong to the device as well.
+        for each (ID2D1RenderTarget *pLayerTarget in pD2DDevice->m_vctLayerTargets)
+        {
+            if (pLayerTarget == pRenderTarget)
+            {
+                pRetD2DDevice = pD2DDevice;
+                break;
+            }
+        }
+
+        if (NULL != pRetD2DDevice)
+        {
+            break;
+        }
     }
 
     return pRetD2DDevice;
@@ -49,10 +65,16 @@ D2DDevice::D2DDevice() : m_hMemDC(NULL),
                          m_pRenderTarget(NULL),
                          m_pDCRenderTarget(NULL),
                          m_pWICBitmapRenderTarget(NULL),
+                         m_pSoftwareRenderTarget(NULL),
+                         m_pSoftwareBitmap(NULL),
                          m_pDWriteBitmapTarget(NULL),
                          m_isPaintModeChange(FALSE),
+                         m_isContentLost(TRUE),
+                         m_uSoftwareWidth(0),
+                         m_uSoftwareHeight(0),
                          m_paintTargetType(DEVICE_TARGET_TYPE_NONE)
 {
+    ZeroMemory(m_frameStats, sizeof(m_frameStats));
     AddD2DDeviceToList(this);
 
     CreateFactory();
@@ -67,6 +89,8 @@ D2DDevice::~D2DDevice()
     SAFE_RELEASE(m_pDCRenderTarget);
     SAFE_RELEASE(m_pWICBitmap);
     SAFE_RELEASE(m_pWICBitmapRenderTarget);
+    SAFE_RELEASE(m_pSoftwareRenderTarget);
+    SAFE_RELEASE(m_pSoftwareBitmap);
     SAFE_RELEASE(m_pDWriteBitmapTarget);
 
     SAFE_DELETE_DC(m_hMemDC);
@@ -88,11 +112,13 @@ HRESULT D2DDevice::InitHwndDevice(HWND hWnd)
             GetClientRect(hWnd, &rc);
 
             m_hWnd = hWnd;
+            m_isContentLost = TRUE;
             D2D1_SIZE_U size = D2D1::SizeU(rc.right - rc.left, rc.bottom - rc.top);
 
+            // Retain the contents, so the next frame only draws the dirty rectangles.
             hr = m_pD2DFactory->CreateHwndRenderTarget(
                 RenderTargetProperties(),
-                HwndRenderTargetProperties(hWnd, size),
+                HwndRenderTargetProperties(hWnd, size, D2D1_PRESENT_OPTIONS_RETAIN_CONTENTS),
                 &m_pRenderTarget);
         }
     }
@@ -153,9 +179,101 @@ HRESULT D2DDevice::InitDCDevice()
 
 //////////////////////////////////////////////////////////////////////////
 
+HRESULT D2DDevice::InitSoftwareDevice(UINT32 uWidth, UINT32 uHeight)
+{
+    HRESULT hr = ( (NULL != m_pD2DFactory) && (uWidth > 0) && (uHeight > 0) ) ? S_OK : E_FAIL;
+
+    if ( SUCCEEDED(hr) )
+    {
+        if ( (NULL != m_pSoftwareRenderTarget) &&
+             ((uWidth != m_uSoftwareWidth) || (uHeight != m_uSoftwareHeight)) )
+        {
+            SAFE_RELEASE(m_pSoftwareRenderTarget);
+        }
+
+        if (NULL == m_pSoftwareRenderTarget)
+        {
+            // The bitmap is kept if the target is released by EndDraw.
+            SAFE_RELEASE(m_pSoftwareBitmap);
+
+            IWICImagingFactory *pWICFactory = NULL;
+            hr = CoCreateInstance(
+                CLSID_WICImagingFactory,
+                NULL,
+                CLSCTX_INPROC_SERVER,
+                IID_PPV_ARGS(&pWICFactory));
+
+            if (SUCCEEDED(hr))
+            {
+                hr = pWICFactory->CreateBitmap(
+                    uWidth,
+                    uHeight,
+                    GUID_WICPixelFormat32bppPBGRA,
+                    WICBitmapCacheOnLoad,
+                    &m_pSoftwareBitmap);
+            }
+
+            if (SUCCEEDED(hr))
+            {
+                D2D1_RENDER_TARGET_PROPERTIES props = D2D1::RenderTargetProperties(
+                    D2D1_RENDER_TARGET_TYPE_SOFTWARE,
+                    D2D1::PixelFormat(
+                    DXGI_FORMAT_B8G8R8A8_UNORM,
+                    D2D1_ALPHA_MODE_PREMULTIPLIED),
+                    96.0f,
+                    96.0f,
+                    D2D1_RENDER_TARGET_USAGE_NONE
+                    );
+
+                hr = m_pD2DFactory->CreateWicBitmapRenderTarget(m_pSoftwareBitmap, props, &m_pSoftwareRenderTarget);
+            }
+
+            if (SUCCEEDED(hr))
+            {
+                // The resources created with the old target are created again at next BeginDraw.
+                m_uSoftwareWidth = uWidth;
+                m_uSoftwareHeight = uHeight;
+                m_isContentLost = TRUE;
+                m_isPaintModeChange = TRUE;
+            }
+            else
+            {
+                SAFE_RELEASE(m_pSoftwareBitmap);
+            }
+
+            SAFE_RELEASE(pWICFactory);
+        }
+    }
+
+    return hr;
+}
+
+//////////////////////////////////////////////////////////////////////////
+
+HRESULT D2DDevice::GetSoftwareBitmap(OUT IWICBitmap **ppBitmap)
+{
+    if ( (NULL == ppBitmap) || (NULL == m_pSoftwareBitmap) )
+    {
+        return E_FAIL;
+    }
+
+    (*ppBitmap) = m_pSoftwareBitmap;
+    (*ppBitmap)->AddRef();
+
+    return S_OK;
+}
+
+//////////////////////////////////////////////////////////////////////////
+
 void D2DDevice::GetDesktopDpi(OUT FLOAT *dpiX, OUT FLOAT *dpiY)
 {
-    if (NULL != m_pD2DFactory)
+    if (DEVICE_TARGET_TYPE_SOFTWARE == m_paintTargetType)
+    {
+        // The software target is created in 96 DPI, so the frames do not depend on the desktop.
+        *dpiX = 96.0f;
+        *dpiY = 96.0f;
+    }
+    else if (NULL != m_pD2DFactory)
     {
         m_pD2DFactory->GetDesktopDpi(dpiX, dpiY);
     }
@@ -213,22 +331,26 @@ HBITMAP D2DDevice::GetMemHBITMAP(OUT UINT32 *pWidth, OUT UINT32 *pHeight)
 
 void D2DDevice::GetRenderTarget(OUT ID2D1RenderTarget **ppTarget)
 {
-    ID2D1RenderTarget *pTempRenderTarget = NULL;
+    ID2D1RenderTarget *pTempRenderTarget = GetCurrentTarget();
 
-    switch (m_paintTargetType)
+    // The views are drawn into the layer target being recorded.
+    if ( !m_vctLayerTargets.empty() )
     {
-    case DEVICE_TARGET_TYPE_HWND:
-        pTempRenderTarget = m_pRenderTarget;
-        break;
-
-    case DEVICE_TARGET_TYPE_MEMORY:
-        pTempRenderTarget = m_pWICBitmapRenderTarget;
-        break;
+        pTempRenderTarget = m_vctLayerTargets.back();
+    }
 
-    case DEVICE_TARGET_TYPE_DC:
-        pTempRenderTarget = m_pDCRenderTarget;
-        break;
+    if (NULL != pTempRenderTarget)
+    {
+        (*ppTarget) = pTempRenderTarget;
+        SAFE_ADDREF((*ppTarget));
     }
+}
+
+//////////////////////////////////////////////////////////////////////////
+
+void D2DDevice::GetDeviceRenderTarget(OUT ID2D1RenderTarget **ppTarget)
+{
+    ID2D1RenderTarget *pTempRenderTarget = GetCurrentTarget();
 
     if (NULL != pTempRenderTarget)
     {
@@ -239,8 +361,30 @@ void D2DDevice::GetRenderTarget(OUT ID2D1RenderTarget **ppTarget)
 
 //////////////////////////////////////////////////////////////////////////
 
+void D2DDevice::PushLayerTarget(IN ID2D1RenderTarget *pLayerTarget)
+{
+    if (NULL != pLayerTarget)
+    {
+        m_vctLayerTargets.push_back(pLayerTarget);
+    }
+}
+
+//////////////////////////////////////////////////////////////////////////
+
+void D2DDevice::PopLayerTarget()
+{
+    if ( !m_vctLayerTargets.empty() )
+    {
+        m_vctLayerTargets.pop_back();
+    }
+}
+
+//////////////////////////////////////////////////////////////////////////
+
 void D2DDevice::BeginDraw(HDC hDC, const LPRECT lpRect, BOOL isClearRT)
 {
+    ZeroMemory(m_frameStats, sizeof(m_frameStats));
+
     switch (m_paintTargetType)
     {
     case DEVICE_TARGET_TYPE_HWND:
@@ -251,7 +395,7 @@ void D2DDevice::BeginDraw(HDC hDC, const LPRECT lpRect, BOOL isClearRT)
                 m_pRenderTarget->BeginDraw();
                 if (isClearRT)
                 {
-                    m_pRenderTarget->Clear(D2D1::ColorF(0, 1.0f));
+                    m_pRenderTarget->Clear(GetClearColor());
                 }
             }
         }
@@ -265,7 +409,7 @@ void D2DDevice::BeginDraw(HDC hDC, const LPRECT lpRect, BOOL isClearRT)
                 m_pWICBitmapRenderTarget->BeginDraw();
                 if (isClearRT)
                 {
-                    m_pWICBitmapRenderTarget->Clear(D2D1::ColorF(0, m_fOpacity));
+                    m_pWICBitmapRenderTarget->Clear(GetClearColor());
                 }
             }
         }
@@ -290,7 +434,25 @@ void D2DDevice::BeginDraw(HDC hDC, const LPRECT lpRect, BOOL isClearRT)
                 m_pDCRenderTarget->BeginDraw();
                 if (isClearRT)
                 {
-                    m_pDCRenderTarget->Clear(D2D1::ColorF(0, m_fOpacity));
+                    m_pDCRenderTarget->Clear(GetClearColor());
+                }
+            }
+        }
+        break;
+
+    case DEVICE_TARGET_TYPE_SOFTWARE:
+        {
+            if ( SUCCEEDED(InitSoftwareDevice(m_uSoftwareWidth, m_uSoftwareHeight)) )
+            {
+                // There is no window to set the paint target type in every frame, so the
+                // resources are notified only once after the target is created.
+                PerformDeviceChangeNotify(DEVICE_STATECHANGE_VALUE_CHANGE);
+                m_isPaintModeChange = FALSE;
+
+                m_pSoftwareRenderTarget->BeginDraw();
+                if (isClearRT)
+                {
+                    m_pSoftwareRenderTarget->Clear(GetClearColor());
                 }
             }
         }
@@ -302,21 +464,7 @@ void D2DDevice::BeginDraw(HDC hDC, const LPRECT lpRect, BOOL isClearRT)
 
 void D2DDevice::EndDraw()
 {
-    ID2D1RenderTarget *pRenderTarget = NULL;
-    switch (m_paintTargetType)
-    {
-    case DEVICE_TARGET_TYPE_HWND:
-        pRenderTarget = m_pRenderTarget;
-        break;
-
-    case DEVICE_TARGET_TYPE_MEMORY:
-        pRenderTarget = m_pWICBitmapRenderTarget;
-        break;
-
-    case DEVICE_TARGET_TYPE_DC:
-        pRenderTarget = m_pDCRenderTarget;
-        break;
-    }
+    ID2D1RenderTarget *pRenderTarget = GetCurrentTarget();
 
     HRESULT hr = (NULL != pRenderTarget) ? pRenderTarget->EndDraw() : E_FAIL;
     if (D2DERR_RECREATE_TARGET == hr)
@@ -324,8 +472,75 @@ void D2DDevice::EndDraw()
         SAFE_RELEASE(m_pRenderTarget);
         SAFE_RELEASE(m_pWICBitmapRenderTarget);
         SAFE_RELEASE(m_pDCRenderTarget);
+        SAFE_RELEASE(m_pSoftwareRenderTarget);
+        m_isContentLost = TRUE;
         PerformDeviceChangeNotify(DEVICE_STATECHANGE_VALUE_RESIZE);
     }
+    else if ( SUCCEEDED(hr) &&
+              ((DEVICE_TARGET_TYPE_HWND == m_paintTargetType) || (DEVICE_TARGET_TYPE_SOFTWARE == m_paintTargetType)) )
+    {
+        m_isContentLost = FALSE;
+    }
+}
+
+//////////////////////////////////////////////////////////////////////////
+
+void D2DDevice::PushDirtyRect(IN const D2D1_RECT_F& rcDirty, BOOL isClearRT)
+{
+    ID2D1RenderTarget *pRenderTarget = GetCurrentTarget();
+    if (NULL != pRenderTarget)
+    {
+        // The clear operation is also clipped by the axis aligned clip.
+        pRenderTarget->PushAxisAlignedClip(rcDirty, D2D1_ANTIALIAS_MODE_ALIASED);
+        if (isClearRT)
+        {
+            pRenderTarget->Clear(GetClearColor());
+        }
+    }
+}
+
+//////////////////////////////////////////////////////////////////////////
+
+void D2DDevice::PopDirtyRect()
+{
+    ID2D1RenderTarget *pRenderTarget = GetCurrentTarget();
+    if (NULL != pRenderTarget)
+    {
+        pRenderTarget->PopAxisAlignedClip();
+    }
+}
+
+//////////////////////////////////////////////////////////////////////////
+
+BOOL D2DDevice::IsContentRetained() const
+{
+    return (NULL != GetCurrentTarget()) &&
+           ((DEVICE_TARGET_TYPE_HWND == m_paintTargetType) || (DEVICE_TARGET_TYPE_SOFTWARE == m_paintTargetType)) &&
+           !m_isContentLost;
+}
+
+//////////////////////////////////////////////////////////////////////////
+
+void D2DDevice::DiscardContent()
+{
+    m_isContentLost = TRUE;
+}
+
+//////////////////////////////////////////////////////////////////////////
+
+void D2DDevice::IncreaseFrameStat(DEVICE_FRAMESTAT stat)
+{
+    if ( (stat >= 0) && (stat < DEVICE_FRAMESTAT_COUNT) )
+    {
+        m_frameStats[stat]++;
+    }
+}
+
+//////////////////////////////////////////////////////////////////////////
+
+UINT32 D2DDevice::GetFrameStat(DEVICE_FRAMESTAT stat) const
+{
+    return ( (stat >= 0) && (stat < DEVICE_FRAMESTAT_COUNT) ) ? m_frameStats[stat] : 0;
 }
 
 //////////////////////////////////////////////////////////////////////////
@@ -338,6 +553,7 @@ void D2DDevice::SetPaintTargetType(DEVICE_TARGET_TYPE paintMode)
     if (m_paintTargetType != paintMode)
     {
         m_paintTargetType = paintMode;
+        m_isContentLost = TRUE;
     }
 }
 
@@ -370,6 +586,7 @@ void D2DDevice::Resize(UINT32 w, UINT32 h)
         {
             D2D1_SIZE_U size = { w, h };
             m_pRenderTarget->Resize(size);
+            m_isContentLost = TRUE;
             m_isPaintModeChange = TRUE;
             PerformDeviceChangeNotify(DEVICE_STATECHANGE_VALUE_RESIZE);
             m_isPaintModeChange = FALSE;
@@ -587,3 +804,39 @@ void D2DDevice::RemoveD2DDeviceFromList(D2DDevice *pD2DDevice)
         s_vctD2DDeviceList.erase(s_vctD2DDeviceList.begin() + nIndex);
     }
 }
+
+//////////////////////////////////////////////////////////////////////////
+
+ID2D1RenderTarget* D2DDevice::GetCurrentTarget() const
+{
+    ID2D1RenderTarget *pRenderTarget = NULL;
+
+    switch (m_paintTargetType)
+    {
+    case DEVICE_TARGET_TYPE_HWND:
+        pRenderTarget = m_pRenderTarget;
+        break;
+
+    case DEVICE_TARGET_TYPE_MEMORY:
+        pRenderTarget = m_pWICBitmapRenderTarget;
+        break;
+
+    case DEVICE_TARGET_TYPE_DC:
+        pRenderTarget = m_pDCRenderTarget;
+        break;
+
+    case DEVICE_TARGET_TYPE_SOFTWARE:
+        pRenderTarget = m_pSoftwareRenderTarget;
+        break;
+    }
+
+    return pRenderTarget;
+}
+
+//////////////////////////////////////////////////////////////////////////
+
+D2D1_COLOR_F D2DDevice::GetClearColor() const
+{
+    // The HWND render target is always opaque.
+    return (DEVICE_TARGET_TYPE_HWND == m_paintTargetType) ? D2D1::ColorF(0, 1.0f) : D2D1::ColorF(0, m_fOpacity);
+}
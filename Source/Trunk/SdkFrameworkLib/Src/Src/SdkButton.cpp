@@ -71,12 +71,12 @@ SdkButton::SdkButton(BOOL isShowDefBk)
 
     if ( isShowDefBk )
     {
-        SetImage(SdkResManager::GetImage(IDB_BUTTON_BK_NORMAL), VIEW_STYLE_NORMAL);
-        SetImage(SdkResManager::GetImage(IDB_BUTTON_BK_HOVER),  VIEW_STYLE_MOUSEHOVER);
-        SetImage(SdkResManager::GetImage(IDB_BUTTON_BK_DOWN),   VIEW_STYLE_MOUSEDOWN);
-        SetImage(SdkResManager::GetImage(IDB_BUTTON_BK_DISABLE), VIEW_STYLE_DISABLE);
-        SetImage(SdkResManager::GetImage(IDB_BUTTON_BK_SELECTED), VIEW_STYLE_SELECTED);
-        SetImage(SdkResManager::GetImage(IDB_BUTTON_BK_SELECTEDHOVER), VIEW_STYLE_SELECTEDOVER);
+        SetSharedImage(SdkResManager::GetImage(IDB_BUTTON_BK_NORMAL), VIEW_STYLE_NORMAL);
+        SetSharedImage(SdkResManager::GetImage(IDB_BUTTON_BK_HOVER),  VIEW_STYLE_MOUSEHOVER);
+        SetSharedImage(SdkResManager::GetImage(IDB_BUTTON_BK_DOWN),   VIEW_STYLE_MOUSEDOWN);
+        SetSharedImage(SdkResManager::GetImage(IDB_BUTTON_BK_DISABLE), VIEW_STYLE_DISABLE);
+        SetSharedImage(SdkResManager::GetImage(IDB_BUTTON_BK_SELECTED), VIEW_STYLE_SELECTED);
+        SetSharedImage(SdkResManager::GetImage(IDB_BUTTON_BK_SELECTEDHOVER), VIEW_STYLE_SELECTEDOVER);
     }
 
     SetClassName(CLASSNAME_BUTTON);
@@ -131,7 +131,7 @@ void SdkButton::ShowUACIcon(BOOL fShow)
         if ( NULL == m_pButtonData->m_pUACShieldBitmap )
         {
             m_pButtonData->m_pUACShieldBitmap = new D2DBitmap();
-            m_pButtonData->m_pUACShieldBitmap->LoadFromHBITMAP(SdkResManager::GetImage(IDB_ICON_UAC_SHIELD));
+            m_pButtonData->m_pUACShieldBitmap->LoadFromSharedHBITMAP(SdkResManager::GetImage(IDB_ICON_UAC_SHIELD));
         }
     }
     else
@@ -178,6 +178,20 @@ BOOL SdkButton::SetImage(HBITMAP hBitmap, VIEW_STYLE style, UINT32 uWidth, UINT3
 
 //////////////////////////////////////////////////////////////////////////
 
+BOOL SdkButton::SetSharedImage(HBITMAP hBitmap, VIEW_STYLE style)
+{
+    D2DBitmap *pBitmap = GetStyleBitmap(style);
+
+    if ( NULL != pBitmap )
+    {
+        return pBitmap->LoadFromSharedHBITMAP(hBitmap);
+    }
+
+    return FALSE;
+}
+
+//////////////////////////////////////////////////////////////////////////
+
 BOOL SdkButton::SetImage(UINT uResId, VIEW_STYLE style, HMODULE hModule, UINT32 uWidth, UINT32 uHeight)
 {
     D2DBitmap *pBitmap = GetStyleBitmap(style);
@@ -64,11 +64,11 @@ SdkCheckBox::SdkCheckBox()
     m_pCheckBoxData->m_pDisableBitmap = new D2DBitmap();
     m_pCheckBoxData->m_pCheckBitmap   = new D2DBitmap();
 
-    m_pCheckBoxData->m_pNormalBitmap->LoadFromHBITMAP(SdkResManager::GetImage(IDB_CHECKBOX_NORMAL));
-    m_pCheckBoxData->m_pHoverBitmap->LoadFromHBITMAP(SdkResManager::GetImage(IDB_CHECKBOX_HOVER));
-    m_pCheckBoxData->m_pDownBitmap->LoadFromHBITMAP(SdkResManager::GetImage(IDB_CHECKBOX_DOWN));
-    m_pCheckBoxData->m_pCheckBitmap->LoadFromHBITMAP(SdkResManager::GetImage(IDB_CHECKBOX_CHECKROUND));
-    m_pCheckBoxData->m_pDisableBitmap->LoadFromHBITMAP(SdkResManager::GetImage(IDB_CHECKBOX_DISABLE));
+    m_pCheckBoxData->m_pNormalBitmap->LoadFromSharedHBITMAP(SdkResManager::GetImage(IDB_CHECKBOX_NORMAL));
+    m_pCheckBoxData->m_pHoverBitmap->LoadFromSharedHBITMAP(SdkResManager::GetImage(IDB_CHECKBOX_HOVER));
+    m_pCheckBoxData->m_pDownBitmap->LoadFromSharedHBITMAP(SdkResManager::GetImage(IDB_CHECKBOX_DOWN));
+    m_pCheckBoxData->m_pCheckBitmap->LoadFromSharedHBITMAP(SdkResManager::GetImage(IDB_CHECKBOX_CHECKROUND));
+    m_pCheckBoxData->m_pDisableBitmap->LoadFromSharedHBITMAP(SdkResManager::GetImage(IDB_CHECKBOX_DISABLE));
 }
 
 //////////////////////////////////////////////////////////////////////////
@@ -329,12 +329,12 @@ void SdkComboBox::InitializeViews()
     m_pComboBoxData->m_pDisableBitmap   = new D2DBitmap();
     m_pComboBoxData->m_pDropHoverBitmap = new D2DBitmap();
 
-    m_pComboBoxData->m_pNormalBitmap->LoadFromHBITMAP(SdkResManager::GetImage(IDB_COMBOBOX_NORMAL));
-    m_pComboBoxData->m_pHoverBitmap->LoadFromHBITMAP(SdkResManager::GetImage(IDB_COMBOBOX_HOVER));
-    m_pComboBoxData->m_pDownBitmap->LoadFromHBITMAP(SdkResManager::GetImage(IDB_COMBOBOX_DOWN));
-    m_pComboBoxData->m_pDropBitmap->LoadFromHBITMAP(SdkResManager::GetImage(IDB_COMBOBOX_OPEN));
-    m_pComboBoxData->m_pDropHoverBitmap->LoadFromHBITMAP(SdkResManager::GetImage(IDB_COMBOBOX_OPEN_HOVER));
-    m_pComboBoxData->m_pDisableBitmap->LoadFromHBITMAP(SdkResManager::GetImage(IDB_COMBOBOX_DISABLE));
+    m_pComboBoxData->m_pNormalBitmap->LoadFromSharedHBITMAP(SdkResManager::GetImage(IDB_COMBOBOX_NORMAL));
+    m_pComboBoxData->m_pHoverBitmap->LoadFromSharedHBITMAP(SdkResManager::GetImage(IDB_COMBOBOX_HOVER));
+    m_pComboBoxData->m_pDownBitmap->LoadFromSharedHBITMAP(SdkResManager::GetImage(IDB_COMBOBOX_DOWN));
+    m_pComboBoxData->m_pDropBitmap->LoadFromSharedHBITMAP(SdkResManager::GetImage(IDB_COMBOBOX_OPEN));
+    m_pComboBoxData->m_pDropHoverBitmap->LoadFromSharedHBITMAP(SdkResManager::GetImage(IDB_COMBOBOX_OPEN_HOVER));
+    m_pComboBoxData->m_pDisableBitmap->LoadFromSharedHBITMAP(SdkResManager::GetImage(IDB_COMBOBOX_DISABLE));
 
     m_pComboBoxData->m_pListBox = new SdkListBox();
     // Set the list box's property is pop-up.
@@ -11,6 +11,8 @@
 
 #include "stdafx.h"
 #include "SdkD2DTheme.h"
+#include "D2DBitmapAtlas.h"
+#include "D2DDevice.h"
 #include "D2DRectUtility.h"
 #include "SdkViewElement.h"
 #include "SdkCommonInclude.h"
@@ -21,6 +23,24 @@ SdkD2DTheme* SdkD2DTheme::s_pD2DTheme = NULL;
 
 //////////////////////////////////////////////////////////////////////////
 
+SdkD2DTheme::SdkD2DTheme()
+{
+}
+
+//////////////////////////////////////////////////////////////////////////
+
+SdkD2DTheme::~SdkD2DTheme()
+{
+    for each (D2DBitmapAtlas *pAtlas in m_vctBitmapAtlases)
+    {
+        SAFE_DELETE(pAtlas);
+    }
+
+    m_vctBitmapAtlases.clear();
+}
+
+//////////////////////////////////////////////////////////////////////////
+
 BOOL SdkD2DTheme::CreateD2DThemeInstance()
 {
     if ( NULL == s_pD2DTheme)
@@ -149,17 +169,13 @@ void SdkD2DTheme::OnDrawBackground(
 {
     UNREFERENCED_PARAMETER(pView);
 
-    if ( !pBitmap->HasInitialized() )
-    {
-        pBitmap->Initialize(pRT);
-    }
-
     ID2D1Bitmap *pD2DBitmap = NULL;
-    pBitmap->GetD2DBitmap(&pD2DBitmap);
+    D2D1_RECT_F rcSource = { 0 };
+    GetThemeBitmap(pRT, pBitmap, &pD2DBitmap, rcSource);
 
     if ( NULL != pD2DBitmap )
     {
-        pRT->DrawBitmap(pD2DBitmap, rc);
+        pRT->DrawBitmap(pD2DBitmap, rc, 1.0f, D2D1_BITMAP_INTERPOLATION_MODE_LINEAR, rcSource);
     }
 
     SAFE_RELEASE(pD2DBitmap);
@@ -215,17 +231,13 @@ void SdkD2DTheme::OnDrawBitmap(
         return;
     }
 
-    if ( !pBitmap->HasInitialized() )
-    {
-        pBitmap->Initialize(pRT);
-    }
-
     ID2D1Bitmap *pD2DBitmap = NULL;
-    pBitmap->GetD2DBitmap(&pD2DBitmap);
+    D2D1_RECT_F rcSource = { 0 };
+    GetThemeBitmap(pRT, pBitmap, &pD2DBitmap, rcSource);
 
     if ( NULL != pD2DBitmap )
     {
-        pRT->DrawBitmap(pD2DBitmap, rc);
+        pRT->DrawBitmap(pD2DBitmap, rc, 1.0f, D2D1_BITMAP_INTERPOLATION_MODE_LINEAR, rcSource);
     }
 
     SAFE_RELEASE(pD2DBitmap);
@@ -267,25 +279,22 @@ void SdkD2DTheme::OnDrawButton(
         return;
     }
 
-    if ( !pBitmap->HasInitialized() )
-    {
-        pBitmap->Initialize(pRT);
-    }
-
     ID2D1Bitmap *pD2DBitmap = NULL;
-    pBitmap->GetD2DBitmap(&pD2DBitmap);
+    D2D1_RECT_F rcSource = { 0 };
+    GetThemeBitmap(pRT, pBitmap, &pD2DBitmap, rcSource);
 
     if ( NULL != pD2DBitmap )
     {
         FLOAT fRCRadiusX = 5;
         FLOAT fRCRadiusY = 5;
-        D2D1_SIZE_F size = pD2DBitmap->GetSize();
+        D2D1_SIZE_F size = { rcSource.right - rcSource.left, rcSource.bottom - rcSource.top };
 
         // Left-top round corner.
         OnDrawButtonBitmap(
             pView,
             pRT,
             pD2DBitmap,
+            rcSource,
             rc.left,
             rc.top,
             fRCRadiusX,
@@ -300,6 +309,7 @@ void SdkD2DTheme::OnDrawButton(
             pView,
             pRT,
             pD2DBitmap,
+            rcSource,
             rc.left,
             rc.bottom - fRCRadiusY,
             fRCRadiusX,
@@ -314,6 +324,7 @@ void SdkD2DTheme::OnDrawButton(
             pView,
             pRT,
             pD2DBitmap,
+            rcSource,
             rc.right - fRCRadiusX,
             rc.top,
             fRCRadiusX,
@@ -328,6 +339,7 @@ void SdkD2DTheme::OnDrawButton(
             pView,
             pRT,
             pD2DBitmap,
+            rcSource,
             rc.right - fRCRadiusX,
             rc.bottom - fRCRadiusY,
             fRCRadiusX,
@@ -342,6 +354,7 @@ void SdkD2DTheme::OnDrawButton(
             pView,
             pRT,
             pD2DBitmap,
+            rcSource,
             rc.left,
             rc.top + fRCRadiusY,
             fRCRadiusX,
@@ -356,6 +369,7 @@ void SdkD2DTheme::OnDrawButton(
             pView,
             pRT,
             pD2DBitmap,
+            rcSource,
             rc.left + fRCRadiusX,
             rc.top,
             (rc.right - rc.left) - 2 * fRCRadiusX,
@@ -370,6 +384,7 @@ void SdkD2DTheme::OnDrawButton(
             pView,
             pRT,
             pD2DBitmap,
+            rcSource,
             rc.right - fRCRadiusX,
             rc.top + fRCRadiusY,
             fRCRadiusX,
@@ -384,6 +399,7 @@ void SdkD2DTheme::OnDrawButton(
             pView,
             pRT,
             pD2DBitmap,
+            rcSource,
             rc.left + fRCRadiusX,
             rc.bottom - fRCRadiusY,
             (rc.right - rc.left) - 2 * fRCRadiusX,
@@ -398,6 +414,7 @@ void SdkD2DTheme::OnDrawButton(
             pView,
             pRT,
             pD2DBitmap,
+            rcSource,
             rc.left + fRCRadiusX,
             rc.top + fRCRadiusY,
             (rc.right - rc.left) - 2 * fRCRadiusX,
@@ -424,20 +441,16 @@ void SdkD2DTheme::OnDrawComboBox(
         return;
     }
 
-    if ( !pBitmap->HasInitialized() )
-    {
-        pBitmap->Initialize(pRT);
-    }
-
     ID2D1Bitmap *pD2DBitmap = NULL;
-    pBitmap->GetD2DBitmap(&pD2DBitmap);
+    D2D1_RECT_F rcSource = { 0 };
+    GetThemeBitmap(pRT, pBitmap, &pD2DBitmap, rcSource);
 
     if ( NULL != pD2DBitmap )
     {
         FLOAT fRCRadiusX = 5;
         FLOAT fRCRadiusY = 5;
         FLOAT fRightSize = 30;
-        D2D1_SIZE_F size = pD2DBitmap->GetSize();
+        D2D1_SIZE_F size = { rcSource.right - rcSource.left, rcSource.bottom - rcSource.top };
 
         UNREFERENCED_PARAMETER(fRCRadiusY);
 
@@ -446,6 +459,7 @@ void SdkD2DTheme::OnDrawComboBox(
             pView,
             pRT,
             pD2DBitmap,
+            rcSource,
             rc.left,
             rc.top,
             fRCRadiusX,
@@ -460,6 +474,7 @@ void SdkD2DTheme::OnDrawComboBox(
             pView,
             pRT,
             pD2DBitmap,
+            rcSource,
             rc.right - fRightSize,
             rc.top,
             fRightSize,
@@ -474,6 +489,7 @@ void SdkD2DTheme::OnDrawComboBox(
             pView,
             pRT,
             pD2DBitmap,
+            rcSource,
             rc.left + fRCRadiusX,
             rc.top,
             (rc.right - rc.left) - fRCRadiusX - fRightSize,
@@ -503,19 +519,14 @@ void SdkD2DTheme::OnDrawRadioButton(
         return;
     }
 
-    // Initialize the bitmap with the render target.
-    if ( !pBitmap->HasInitialized() )
-    {
-        pBitmap->Initialize(pRT);
-    }
-
     ID2D1Bitmap *pD2DBitmap = NULL;
-    pBitmap->GetD2DBitmap(&pD2DBitmap);
+    D2D1_RECT_F rcSource = { 0 };
+    GetThemeBitmap(pRT, pBitmap, &pD2DBitmap, rcSource);
 
     // Draw the bitmap.
     if ( NULL != pD2DBitmap )
     {
-        D2D1_SIZE_F size = pD2DBitmap->GetSize();
+        D2D1_SIZE_F size = { rcSource.right - rcSource.left, rcSource.bottom - rcSource.top };
         FLOAT left = rc.left;
         FLOAT top = rc.top + ((rc.bottom - rc.top) - size.height) / 2;
 
@@ -523,6 +534,7 @@ void SdkD2DTheme::OnDrawRadioButton(
             pView,
             pRT,
             pD2DBitmap,
+            rcSource,
             left,
             top,
             size.width,
@@ -553,7 +565,8 @@ void SdkD2DTheme::OnDrawRadioButton(
             D2D1_SIZE_F size = { 20, 20 };
             if ( NULL != pD2DBitmap )
             {
-                size = pD2DBitmap->GetSize();
+                size.width  = rcSource.right - rcSource.left;
+                size.height = rcSource.bottom - rcSource.top;
             }
 
             D2D1_ELLIPSE ellipse;
@@ -566,6 +579,8 @@ void SdkD2DTheme::OnDrawRadioButton(
         }
         SAFE_RELEASE(pD2DBrush);
     }
+
+    SAFE_RELEASE(pD2DBitmap);
 }
 
 //////////////////////////////////////////////////////////////////////////
@@ -581,18 +596,13 @@ void SdkD2DTheme::OnDrawRadioButton(
         return;
     }
 
-    // Initialize the bitmap with the render target.
-    if ( !pBitmap->HasInitialized() )
-    {
-        pBitmap->Initialize(pRT);
-    }
-
     ID2D1Bitmap *pD2DBitmap = NULL;
-    pBitmap->GetD2DBitmap(&pD2DBitmap);
+    D2D1_RECT_F rcSource = { 0 };
+    GetThemeBitmap(pRT, pBitmap, &pD2DBitmap, rcSource);
 
     if ( NULL != pD2DBitmap )
     {
-        D2D1_SIZE_F size = pD2DBitmap->GetSize();
+        D2D1_SIZE_F size = { rcSource.right - rcSource.left, rcSource.bottom - rcSource.top };
         FLOAT left = rc.left;
         FLOAT top = rc.top + ((rc.bottom - rc.top) - size.height) / 2;
 
@@ -600,6 +610,7 @@ void SdkD2DTheme::OnDrawRadioButton(
             pView,
             pRT,
             pD2DBitmap,
+            rcSource,
             left,
             top,
             size.width,
@@ -626,18 +637,13 @@ void SdkD2DTheme::OnDrawCheckBox(
         return;
     }
 
-    // Initialize the bitmap with the render target.
-    if ( !pBitmap->HasInitialized() )
-    {
-        pBitmap->Initialize(pRT);
-    }
-
     ID2D1Bitmap *pD2DBitmap = NULL;
-    pBitmap->GetD2DBitmap(&pD2DBitmap);
+    D2D1_RECT_F rcSource = { 0 };
+    GetThemeBitmap(pRT, pBitmap, &pD2DBitmap, rcSource);
 
     if ( NULL != pD2DBitmap )
     {
-        D2D1_SIZE_F size = pD2DBitmap->GetSize();
+        D2D1_SIZE_F size = { rcSource.right - rcSource.left, rcSource.bottom - rcSource.top };
         FLOAT left = rc.left;
         FLOAT top = rc.top + ((rc.bottom - rc.top) - size.height) / 2;
 
@@ -645,6 +651,7 @@ void SdkD2DTheme::OnDrawCheckBox(
             pView,
             pRT,
             pD2DBitmap,
+            rcSource,
             left,
             top,
             size.width,
@@ -671,18 +678,13 @@ void SdkD2DTheme::OnDrawProgressBar(
         return;
     }
 
-    // Initialize the bitmap with the render target.
-    if ( !pBitmap->HasInitialized() )
-    {
-        pBitmap->Initialize(pRT);
-    }
-
     ID2D1Bitmap *pD2DBitmap = NULL;
-    pBitmap->GetD2DBitmap(&pD2DBitmap);
+    D2D1_RECT_F rcSource = { 0 };
+    GetThemeBitmap(pRT, pBitmap, &pD2DBitmap, rcSource);
 
     if ( NULL != pD2DBitmap )
     {
-        D2D1_SIZE_F size = pD2DBitmap->GetSize();
+        D2D1_SIZE_F size = { rcSource.right - rcSource.left, rcSource.bottom - rcSource.top };
         FLOAT left = rc.left;
         FLOAT top  = rc.top + ((rc.bottom - rc.top) - size.height) / 2;
         FLOAT offset = 5;
@@ -692,6 +694,7 @@ void SdkD2DTheme::OnDrawProgressBar(
             pView,
             pRT,
             pD2DBitmap,
+            rcSource,
             left,
             top,
             offset,
@@ -708,6 +711,7 @@ void SdkD2DTheme::OnDrawProgressBar(
             pView,
             pRT,
             pD2DBitmap,
+            rcSource,
             left,
             top,
             (rc.right - rc.left) - offset * 2,
@@ -724,6 +728,7 @@ void SdkD2DTheme::OnDrawProgressBar(
             pView,
             pRT,
             pD2DBitmap,
+            rcSource,
             left,
             top,
             offset,
@@ -751,18 +756,13 @@ void SdkD2DTheme::OnDrawProgressBarThumb(
         return;
     }
 
-    // Initialize the bitmap with the render target.
-    if ( !pBitmap->HasInitialized() )
-    {
-        pBitmap->Initialize(pRT);
-    }
-
     ID2D1Bitmap *pD2DBitmap = NULL;
-    pBitmap->GetD2DBitmap(&pD2DBitmap);
+    D2D1_RECT_F rcSource = { 0 };
+    GetThemeBitmap(pRT, pBitmap, &pD2DBitmap, rcSource);
 
     if ( NULL != pD2DBitmap )
     {
-        D2D1_SIZE_F size = pD2DBitmap->GetSize();
+        D2D1_SIZE_F size = { rcSource.right - rcSource.left, rcSource.bottom - rcSource.top };
         FLOAT fCurPos = (fCurPercent / 100.0f) * (pView->GetWidth() - size.width);
         FLOAT top  = rc.top + ((rc.bottom - rc.top) - size.height) / 2;
         FLOAT left = rc.left + fCurPos - size.width / 2;
@@ -771,6 +771,7 @@ void SdkD2DTheme::OnDrawProgressBarThumb(
             pView,
             pRT,
             pD2DBitmap,
+            rcSource,
             left,
             top,
             size.width,
@@ -798,18 +799,13 @@ void SdkD2DTheme::OnDrawRatingView(
         return;
     }
 
-    // Initialize the bitmap with the render target.
-    if ( !pBitmap->HasInitialized() )
-    {
-        pBitmap->Initialize(pRT);
-    }
-
     ID2D1Bitmap *pD2DBitmap = NULL;
-    pBitmap->GetD2DBitmap(&pD2DBitmap);
+    D2D1_RECT_F rcSource = { 0 };
+    GetThemeBitmap(pRT, pBitmap, &pD2DBitmap, rcSource);
 
     if ( NULL != pD2DBitmap )
     {
-        D2D1_SIZE_F size = pD2DBitmap->GetSize();
+        D2D1_SIZE_F size = { rcSource.right - rcSource.left, rcSource.bottom - rcSource.top };
         FLOAT width  = (rc.right - rc.left);
         FLOAT height = (rc.bottom - rc.top);
         FLOAT top  = rc.top + (height - fBitmapSize) / 2;
@@ -819,6 +815,7 @@ void SdkD2DTheme::OnDrawRatingView(
             pView,
             pRT,
             pD2DBitmap,
+            rcSource,
             left,
             top,
             width,
@@ -845,18 +842,13 @@ void SdkD2DTheme::OnDrawTabViewTab(
         return;
     }
 
-    // Initialize the bitmap with the render target.
-    if ( !pBitmap->HasInitialized() )
-    {
-        pBitmap->Initialize(pRT);
-    }
-
     ID2D1Bitmap *pD2DBitmap = NULL;
-    pBitmap->GetD2DBitmap(&pD2DBitmap);
+    D2D1_RECT_F rcSource = { 0 };
+    GetThemeBitmap(pRT, pBitmap, &pD2DBitmap, rcSource);
 
     if ( NULL != pD2DBitmap )
     {
-        D2D1_SIZE_F size = pD2DBitmap->GetSize();
+        D2D1_SIZE_F size = { rcSource.right - rcSource.left, rcSource.bottom - rcSource.top };
         FLOAT width  = (rc.right - rc.left);
         FLOAT height = (rc.bottom - rc.top);
         // The round corner radius is 5, but it has transparent edge.
@@ -868,6 +860,7 @@ void SdkD2DTheme::OnDrawTabViewTab(
             pView,
             pRT,
             pD2DBitmap,
+            rcSource,
             rc.left,
             rc.top,
             fRCRadiusX,
@@ -882,6 +875,7 @@ void SdkD2DTheme::OnDrawTabViewTab(
             pView,
             pRT,
             pD2DBitmap,
+            rcSource,
             rc.right - fRCRadiusX,
             rc.top,
             fRCRadiusX,
@@ -896,6 +890,7 @@ void SdkD2DTheme::OnDrawTabViewTab(
             pView,
             pRT,
             pD2DBitmap,
+            rcSource,
             rc.left + fRCRadiusX,
             rc.top,
             width - 2 * fRCRadiusX,
@@ -910,6 +905,7 @@ void SdkD2DTheme::OnDrawTabViewTab(
             pView,
             pRT,
             pD2DBitmap,
+            rcSource,
             rc.left,
             rc.top + fRCRadiusY,
             fRCRadiusX,
@@ -924,6 +920,7 @@ void SdkD2DTheme::OnDrawTabViewTab(
             pView,
             pRT,
             pD2DBitmap,
+            rcSource,
             rc.right - fRCRadiusX,
             rc.top + fRCRadiusY,
             fRCRadiusX,
@@ -938,6 +935,7 @@ void SdkD2DTheme::OnDrawTabViewTab(
             pView,
             pRT,
             pD2DBitmap,
+            rcSource,
             rc.left + fRCRadiusX,
             rc.top + fRCRadiusY,
             width - 2 * fRCRadiusX,
@@ -965,18 +963,13 @@ void SdkD2DTheme::OnDrawTabViewSingleRoundCorner(
         return;
     }
 
-    // Initialize the bitmap with the render target.
-    if ( !pBitmap->HasInitialized() )
-    {
-        pBitmap->Initialize(pRT);
-    }
-
     ID2D1Bitmap *pD2DBitmap = NULL;
-    pBitmap->GetD2DBitmap(&pD2DBitmap);
+    D2D1_RECT_F rcSource = { 0 };
+    GetThemeBitmap(pRT, pBitmap, &pD2DBitmap, rcSource);
 
     if ( NULL != pD2DBitmap )
     {
-        D2D1_SIZE_F size = pD2DBitmap->GetSize();
+        D2D1_SIZE_F size = { rcSource.right - rcSource.left, rcSource.bottom - rcSource.top };
         FLOAT width  = (rc.right - rc.left);
         FLOAT height = (rc.bottom - rc.top);
         // The round corner radius is 5, but it has transparent edge.
@@ -989,6 +982,7 @@ void SdkD2DTheme::OnDrawTabViewSingleRoundCorner(
                 pView,
                 pRT,
                 pD2DBitmap,
+                rcSource,
                 rc.left + fRCRadiusX,
                 rc.top,
                 width - fRCRadiusX,
@@ -1003,6 +997,7 @@ void SdkD2DTheme::OnDrawTabViewSingleRoundCorner(
                 pView,
                 pRT,
                 pD2DBitmap,
+                rcSource,
                 rc.left,
                 rc.top,
                 fRCRadiusX,
@@ -1017,6 +1012,7 @@ void SdkD2DTheme::OnDrawTabViewSingleRoundCorner(
                 pView,
                 pRT,
                 pD2DBitmap,
+                rcSource,
                 rc.left,
                 rc.top + fRCRadiusY,
                 fRCRadiusX,
@@ -1035,6 +1031,7 @@ void SdkD2DTheme::OnDrawTabViewSingleRoundCorner(
                 pView,
                 pRT,
                 pD2DBitmap,
+                rcSource,
                 rc.right - fRCRadiusX,
                 rc.top,
                 fRCRadiusX,
@@ -1049,6 +1046,7 @@ void SdkD2DTheme::OnDrawTabViewSingleRoundCorner(
                 pView,
                 pRT,
                 pD2DBitmap,
+                rcSource,
                 rc.right - fRCRadiusX,
                 rc.top + fRCRadiusY,
                 fRCRadiusX,
@@ -1063,6 +1061,7 @@ void SdkD2DTheme::OnDrawTabViewSingleRoundCorner(
                 pView,
                 pRT,
                 pD2DBitmap,
+                rcSource,
                 rc.left,
                 rc.top,
                 width - fRCRadiusX + 1,
@@ -1083,6 +1082,7 @@ void SdkD2DTheme::OnDrawButtonBitmap(
     SdkViewElement *pView,
     ID2D1RenderTarget *pRT,
     ID2D1Bitmap *pD2DBitmap,
+    const D2D1_RECT_F& rcSource,
     FLOAT destX,
     FLOAT destY,
     FLOAT destWidth,
@@ -1095,5 +1095,97 @@ void SdkD2DTheme::OnDrawButtonBitmap(
     D2D1_RECT_F destRc = { destX, destY, destX + destWidth, destY + destHeight };
     D2D1_RECT_F srcRc  = { srcX,  srcY,  srcX  + srcWidth,  srcY  + srcHeight  };
 
+    // The source is relative to the image, move it to the image area of the bitmap.
+    D2DRectUtility::OffsetD2DRectF(srcRc, rcSource.left, rcSource.top);
+
     pRT->DrawBitmap(pD2DBitmap, destRc, 1.0f, D2D1_BITMAP_INTERPOLATION_MODE_LINEAR, srcRc);
 }
+
+//////////////////////////////////////////////////////////////////////////
+
+BOOL SdkD2DTheme::GetThemeBitmap(
+    ID2D1RenderTarget *pRT,
+    D2DBitmap *pBitmap,
+    OUT ID2D1Bitmap **ppD2DBitmap,
+    OUT D2D1_RECT_F& rcSource)
+{
+    if ( (NULL == pBitmap) || (NULL == ppD2DBitmap) )
+    {
+        return FALSE;
+    }
+
+    // The shared skin images of all the views are packed into one atlas, so they are
+    // created once for the render target.
+    HBITMAP hSharedBitmap = pBitmap->GetSharedHBITMAP();
+    if ( NULL != hSharedBitmap )
+    {
+        D2DBitmapAtlas *pAtlas = GetBitmapAtlas(pRT);
+        if ( (NULL != pAtlas) &&
+             pAtlas->GetBitmap(hSharedBitmap, pBitmap->GetWidth(), pBitmap->GetHeight(), ppD2DBitmap, rcSource) )
+        {
+            return TRUE;
+        }
+    }
+
+    // Initialize the bitmap with the render target.
+    if ( !pBitmap->HasInitialized() )
+    {
+        pBitmap->Initialize(pRT);
+    }
+
+    pBitmap->GetD2DBitmap(ppD2DBitmap);
+
+    if ( NULL != (*ppD2DBitmap) )
+    {
+        D2D1_SIZE_F size = (*ppD2DBitmap)->GetSize();
+        rcSource = D2D1::RectF(0, 0, size.width, size.height);
+    }
+
+    return (NULL != (*ppD2DBitmap));
+}
+
+//////////////////////////////////////////////////////////////////////////
+
+D2DBitmapAtlas* SdkD2DTheme::GetBitmapAtlas(ID2D1RenderTarget *pRT)
+{
+    // The layer targets of the cached views share the atlas of the device render target.
+    D2DDevice *pD2DDevice = D2DDevice::FromD2DRenderTarget(pRT);
+    if ( NULL != pD2DDevice )
+    {
+        ID2D1RenderTarget *pDeviceRT = NULL;
+        pD2DDevice->GetDeviceRenderTarget(&pDeviceRT);
+        pRT = (NULL != pDeviceRT) ? pDeviceRT : pRT;
+        SAFE_RELEASE(pDeviceRT);
+    }
+
+    for each (D2DBitmapAtlas *pAtlas in m_vctBitmapAtlases)
+    {
+        if ( pRT == pAtlas->GetRenderTarget() )
+        {
+            return pAtlas;
+        }
+    }
+
+    // Only the render targets of the devices have atlases, the temporary ones do not.
+    if ( (NULL == pRT) || (NULL == D2DDevice::FromD2DRenderTarget(pRT)) )
+    {
+        return NULL;
+    }
+
+    // The render target of an atlas is not used after the device is deleted or the render
+    // target is recreated, the atlas is deleted and the images are packed again on demand.
+    for (int i = (int)m_vctBitmapAtlases.size() - 1; i >= 0; --i)
+    {
+        D2DBitmapAtlas *pAtlas = m_vctBitmapAtlases[i];
+        if ( NULL == D2DDevice::FromD2DRenderTarget(pAtlas->GetRenderTarget()) )
+        {
+            SAFE_DELETE(pAtlas);
+            m_vctBitmapAtlases.erase(m_vctBitmapAtlases.begin() + i);
+        }
+    }
+
+    D2DBitmapAtlas *pAtlas = new D2DBitmapAtlas(pRT);
+    m_vctBitmapAtlases.push_back(pAtlas);
+
+    return pAtlas;
+}
@@ -35,9 +35,9 @@ SdkEditBox::SdkEditBox() : m_pNormalBitmap(NULL),
     m_pHoverBitmap   = new D2DBitmap();
     m_pDisableBitmap = new D2DBitmap();
 
-    m_pNormalBitmap->LoadFromHBITMAP(SdkResManager::GetImage(IDB_EDITBOX_NORMAL));
-    m_pHoverBitmap->LoadFromHBITMAP(SdkResManager::GetImage(IDB_EDITBOX_HOVER));
-    m_pDisableBitmap->LoadFromHBITMAP(SdkResManager::GetImage(IDB_EDITBOX_DISABLE));
+    m_pNormalBitmap->LoadFromSharedHBITMAP(SdkResManager::GetImage(IDB_EDITBOX_NORMAL));
+    m_pHoverBitmap->LoadFromSharedHBITMAP(SdkResManager::GetImage(IDB_EDITBOX_HOVER));
+    m_pDisableBitmap->LoadFromSharedHBITMAP(SdkResManager::GetImage(IDB_EDITBOX_DISABLE));
 }
 
 //////////////////////////////////////////////////////////////////////////
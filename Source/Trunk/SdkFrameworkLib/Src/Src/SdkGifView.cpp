@@ -31,6 +31,8 @@ struct NAMESPACE_VIEWS::SdkGifView::_GIFVIEW_INTERNALDATA
     BOOL                        m_hasFirstDraw;         // Indicate whether called pain frame first.
     UINT                        m_uFrameDelay;          // Frame delay.
     UINT_PTR                    m_curTimerID;           // Current timer id.
+    UINT64                      m_uFrameCacheLimit;     // The max bytes of the cached frames.
+    DWORD                       m_dwDecodeRequestId;    // The request id of LoadFromFileAsync.
     IMAGE_STRETCH_MODE          m_stretchMode;          // The flag whether to Stretch the bitmap to fill all view.
     D2DAnimatedGif             *m_pD2DAnimatedGif;      // The pointer to D2DAnimatedGif.
     ID2D1BitmapRenderTarget    *m_pBitmapRenderTarget;  // The compatible render target.
@@ -54,7 +56,9 @@ SdkGifView::SdkGifView()
     m_pGifViewData->m_hasFirstDraw          = FALSE;
     m_pGifViewData->m_isPlaying             = FALSE;
     m_pGifViewData->m_uFrameDelay           = 0;
+    m_pGifViewData->m_dwDecodeRequestId     = 0;
     m_pGifViewData->m_stretchMode           = IMAGE_STRETCH_MODE_CENTER;
+    m_pGifViewData->m_uFrameCacheLimit      = DEFAULT_GIF_FRAME_CACHE_LIMIT;
     m_pGifViewData->m_pD2DAnimatedGif       = new D2DAnimatedGif();
 }
 
@@ -62,6 +66,7 @@ SdkGifView::SdkGifView()
 
 SdkGifView::~SdkGifView()
 {
+    CancelImageDecode();
     SAFE_DELETE(m_pGifViewData->m_pD2DAnimatedGif);
     SAFE_RELEASE(m_pGifViewData->m_pBitmapRenderTarget);
     SAFE_DELETE(m_pGifViewData);
@@ -144,6 +149,7 @@ void SdkGifView::SetAutoStart(BOOL fAutoStart)
 
 BOOL SdkGifView::LoadFromFile(LPCWSTR lpfile)
 {
+    CancelImageDecode();
     Stop();
     SAFE_RELEASE(m_pGifViewData->m_pBitmapRenderTarget);
 
@@ -159,6 +165,7 @@ BOOL SdkGifView::LoadFromFile(LPCWSTR lpfile)
 
 BOOL SdkGifView::LoadFromResource(UINT uResId, HMODULE hModule)
 {
+    CancelImageDecode();
     Stop();
     SAFE_RELEASE(m_pGifViewData->m_pBitmapRenderTarget);
 
@@ -172,6 +179,59 @@ BOOL SdkGifView::LoadFromResource(UINT uResId, HMODULE hModule)
 
 //////////////////////////////////////////////////////////////////////////
 
+BOOL SdkGifView::LoadFromFileAsync(LPCWSTR lpfile, IMAGE_DECODE_PRIORITY priority)
+{
+    CancelImageDecode();
+
+    DWORD dwRequestId = SdkImageDecodeService::DecodeFile(lpfile, 0, 0, priority, this);
+    if ( 0 == dwRequestId )
+    {
+        return LoadFromFile(lpfile);
+    }
+
+    Stop();
+    SAFE_RELEASE(m_pGifViewData->m_pBitmapRenderTarget);
+
+    // The old image is not shown while the new one is decoding.
+    WIC_GIF_TYPE imageType = (NULL != m_pGifViewData->m_pD2DAnimatedGif) ?
+        m_pGifViewData->m_pD2DAnimatedGif->GetImageType() : WIC_GIF_TYPE_GIF;
+    SAFE_DELETE(m_pGifViewData->m_pD2DAnimatedGif);
+    m_pGifViewData->m_pD2DAnimatedGif = new D2DAnimatedGif();
+    m_pGifViewData->m_pD2DAnimatedGif->SetImageType(imageType);
+    m_pGifViewData->m_pD2DAnimatedGif->SetFrameCacheLimit(m_pGifViewData->m_uFrameCacheLimit);
+    m_pGifViewData->m_dwDecodeRequestId = dwRequestId;
+
+    return TRUE;
+}
+
+//////////////////////////////////////////////////////////////////////////
+
+BOOL SdkGifView::LoadFromDecodeResult(IN const IMAGEDECODERESULT *lpResult)
+{
+    if ( (NULL == lpResult) || FAILED(lpResult->hrDecode) )
+    {
+        return FALSE;
+    }
+
+    Stop();
+    SAFE_RELEASE(m_pGifViewData->m_pBitmapRenderTarget);
+
+    if ( NULL == m_pGifViewData->m_pD2DAnimatedGif )
+    {
+        return FALSE;
+    }
+
+    // The frames of an animation are decoded while it is playing, only the header is read here.
+    if ( lpResult->uFrameCount > 1 )
+    {
+        return m_pGifViewData->m_pD2DAnimatedGif->LoadFromFile(lpResult->lpFile);
+    }
+
+    return m_pGifViewData->m_pD2DAnimatedGif->LoadFromWICBitmap(lpResult->pBitmap);
+}
+
+//////////////////////////////////////////////////////////////////////////
+
 void SdkGifView::SetImageType(WIC_GIF_TYPE type)
 {
     if ( NULL != m_pGifViewData->m_pD2DAnimatedGif )
@@ -263,13 +323,26 @@ void SdkGifView::SetStretchMode(IN IMAGE_STRETCH_MODE stretchMode)
 
 //////////////////////////////////////////////////////////////////////////
 
+void SdkGifView::SetFrameCacheLimit(UINT64 uBytes)
+{
+    m_pGifViewData->m_uFrameCacheLimit = uBytes;
+    if (NULL != m_pGifViewData->m_pD2DAnimatedGif)
+    {
+        m_pGifViewData->m_pD2DAnimatedGif->SetFrameCacheLimit(uBytes);
+    }
+}
+
+//////////////////////////////////////////////////////////////////////////
+
 void SdkGifView::ClearAssocData()
 {
+    CancelImageDecode();
     SAFE_DELETE(m_pGifViewData->m_pD2DAnimatedGif);
     SAFE_RELEASE(m_pGifViewData->m_pBitmapRenderTarget);
     SdkViewElement::ClearAssocData();
 
     m_pGifViewData->m_pD2DAnimatedGif = new D2DAnimatedGif();
+    m_pGifViewData->m_pD2DAnimatedGif->SetFrameCacheLimit(m_pGifViewData->m_uFrameCacheLimit);
 }
 
 //////////////////////////////////////////////////////////////////////////
@@ -412,6 +485,44 @@ void SdkGifView::OnDrawItem(ID2D1RenderTarget *pRenderTarget)
 
 //////////////////////////////////////////////////////////////////////////
 
+void SdkGifView::OnImageDecoded(IN const IMAGEDECODERESULT *lpResult)
+{
+    if ( lpResult->dwRequestId != m_pGifViewData->m_dwDecodeRequestId )
+    {
+        return;
+    }
+
+    m_pGifViewData->m_dwDecodeRequestId = 0;
+
+    if ( LoadFromDecodeResult(lpResult) )
+    {
+        AutoAdjustSize(m_pGifViewData->m_isAutoSize);
+
+        // The first drawing may be passed while decoding.
+        if ( m_pGifViewData->m_isAutoStart )
+        {
+            Start();
+        }
+        else
+        {
+            Invalidate();
+        }
+    }
+}
+
+//////////////////////////////////////////////////////////////////////////
+
+void SdkGifView::CancelImageDecode()
+{
+    if ( 0 != m_pGifViewData->m_dwDecodeRequestId )
+    {
+        SdkImageDecodeService::Cancel(m_pGifViewData->m_dwDecodeRequestId);
+        m_pGifViewData->m_dwDecodeRequestId = 0;
+    }
+}
+
+//////////////////////////////////////////////////////////////////////////
+
 void SdkGifView::OnPaintFrame(BOOL fStartTimer)
 {
     if ( NULL != m_pWindow )
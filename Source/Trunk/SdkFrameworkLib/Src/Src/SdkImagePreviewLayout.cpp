@@ -34,6 +34,9 @@ SdkImagePreviewLayout::SdkImagePreviewLayout() :
     m_pLastImageView(NULL),
     m_pCurImageView(NULL),
     m_pNextImageView(NULL),
+    m_dwLastDecodeId(0),
+    m_dwCurDecodeId(0),
+    m_dwNextDecodeId(0),
     m_pCurrentShowView(NULL),
     m_pLeftTranslateAnimation(NULL),
     m_pRightTranslateAnimation(NULL),
@@ -83,6 +86,8 @@ SdkImagePreviewLayout::SdkImagePreviewLayout() :
 
 SdkImagePreviewLayout::~SdkImagePreviewLayout()
 {
+    SdkImageDecodeService::CancelAll(this);
+
     m_pLeftTranslateAnimation->RemoveAnimationListener(this);
     m_pLeftTranslateAnimation->RemoveAnimationTimerListener(this);
     SAFE_DELETE(m_pLeftTranslateAnimation);
@@ -161,7 +166,7 @@ void SdkImagePreviewLayout::SetLastImage( IN LPCWSTR lpFile, INT32 nWidth, INT32
     default:
         break;
     }
-    SetImageInfo(pImageView, lpFile, (FLOAT)nWidth, (FLOAT)nHeight);
+    SetImageInfo(pImageView, lpFile, (FLOAT)nWidth, (FLOAT)nHeight, IMAGE_DECODE_PRIORITY_PREFETCH);
 }
 
 //////////////////////////////////////////////////////////////////////////
@@ -198,7 +203,7 @@ void SdkImagePreviewLayout::SetCurImage( IN LPCWSTR lpFile, INT32 nWidth, INT32
     default:
         break;
     }
-    SetImageInfo(pImageView, lpFile, (FLOAT)nWidth, (FLOAT)nHeight);
+    SetImageInfo(pImageView, lpFile, (FLOAT)nWidth, (FLOAT)nHeight, IMAGE_DECODE_PRIORITY_VISIBLE);
     if(NULL != m_pUpdateHandler)
     {
         m_pUpdateHandler->OnImageSwitchEvent(this);
@@ -240,7 +245,7 @@ void SdkImagePreviewLayout::SetNextImage( IN LPCWSTR lpFile, INT32 nWidth, INT32
     default:
         break;
     }
-    SetImageInfo(pImageView, lpFile, (FLOAT)nWidth, (FLOAT)nHeight);
+    SetImageInfo(pImageView, lpFile, (FLOAT)nWidth, (FLOAT)nHeight, IMAGE_DECODE_PRIORITY_PREFETCH);
 }
 
 //////////////////////////////////////////////////////////////////////////
@@ -636,6 +641,7 @@ void SdkImagePreviewLayout::OnAnimationEnd( SdkAnimation * pAnimation )
     if(m_nCurIndex != m_nNewCurIndex)
     {
         m_nCurIndex = m_nNewCurIndex;
+        UpdateDecodePriority();
         //m_bCanZoom = TRUE;
 
         m_fZoomRate = 1;
@@ -760,24 +766,118 @@ void SdkImagePreviewLayout::CalcLayoutInfo(IN OUT LAYOUTINFO &layoutInfoContent,
 
 //////////////////////////////////////////////////////////////////////////
 
-void SdkImagePreviewLayout::SetImageInfo( SdkGifView *pImageView, LPCWSTR lpFile, FLOAT fWidth, FLOAT fHeight )
+void SdkImagePreviewLayout::SetImageInfo( SdkGifView *pImageView, LPCWSTR lpFile, FLOAT fWidth, FLOAT fHeight, IMAGE_DECODE_PRIORITY priority )
 {
     if(NULL != pImageView)
     {
+        CancelImageDecode(pImageView);
         pImageView->SetLayoutInfo(0, 0, fWidth, fHeight);
-        BOOL isImageLoadSuccess = pImageView->LoadFromFile(lpFile);
-        if (!isImageLoadSuccess)
+
+        // The view is empty until the image is decoded, so flipping the big photos does not block.
+        DWORD dwRequestId = SdkImageDecodeService::DecodeFile(lpFile, 0, 0, priority, this);
+        if (0 != dwRequestId)
         {
-            pImageView->SetLayoutInfo(0, 0, DEFALUT_PICTURE_WIDTH, DEFALUT_PICTURE_HEIGHT);
-            WIC_GIF_TYPE gif_type = pImageView->GetImageType();
-            if (WIC_GIF_TYPE_IMAGE != gif_type)
-            {
-                gif_type = WIC_GIF_TYPE_IMAGE;
-            }
-            pImageView->SetImageType(gif_type);
-            pImageView->LoadFromResource(IDB_PNG_DEFAULT_PICTURE, HINST_THISCOMPONENT);
+            pImageView->Stop();
+            pImageView->ClearAssocData();
+            *GetDecodeRequestId(pImageView) = dwRequestId;
+        }
+        else
+        {
+            OnImageLoaded(pImageView, pImageView->LoadFromFile(lpFile));
+        }
+    }
+}
+
+//////////////////////////////////////////////////////////////////////////
+
+void SdkImagePreviewLayout::OnImageLoaded( SdkGifView *pImageView, BOOL isImageLoadSuccess )
+{
+    if (!isImageLoadSuccess)
+    {
+        pImageView->SetLayoutInfo(0, 0, DEFALUT_PICTURE_WIDTH, DEFALUT_PICTURE_HEIGHT);
+        WIC_GIF_TYPE gif_type = pImageView->GetImageType();
+        if (WIC_GIF_TYPE_IMAGE != gif_type)
+        {
+            gif_type = WIC_GIF_TYPE_IMAGE;
+        }
+        pImageView->SetImageType(gif_type);
+        pImageView->LoadFromResource(IDB_PNG_DEFAULT_PICTURE, HINST_THISCOMPONENT);
+    }
+    pImageView->Start();
+}
+
+//////////////////////////////////////////////////////////////////////////
+
+void SdkImagePreviewLayout::OnImageDecoded( const IMAGEDECODERESULT *lpResult )
+{
+    SdkGifView *pImageViews[] = { m_pLastImageView, m_pCurImageView, m_pNextImageView };
+
+    for (INT32 i = 0; i < (INT32)ARRAYSIZE(pImageViews); ++i)
+    {
+        DWORD *pdwRequestId = GetDecodeRequestId(pImageViews[i]);
+        if ((NULL != pdwRequestId) && (*pdwRequestId == lpResult->dwRequestId))
+        {
+            *pdwRequestId = 0;
+            OnImageLoaded(pImageViews[i], pImageViews[i]->LoadFromDecodeResult(lpResult));
+            this->RequestLayout();
+            break;
+        }
+    }
+}
+
+//////////////////////////////////////////////////////////////////////////
+
+DWORD* SdkImagePreviewLayout::GetDecodeRequestId( SdkGifView *pImageView )
+{
+    if (NULL == pImageView)
+    {
+        return NULL;
+    }
+
+    if (pImageView == m_pLastImageView)
+    {
+        return &m_dwLastDecodeId;
+    }
+
+    if (pImageView == m_pCurImageView)
+    {
+        return &m_dwCurDecodeId;
+    }
+
+    if (pImageView == m_pNextImageView)
+    {
+        return &m_dwNextDecodeId;
+    }
+
+    return NULL;
+}
+
+//////////////////////////////////////////////////////////////////////////
+
+void SdkImagePreviewLayout::CancelImageDecode( SdkGifView *pImageView )
+{
+    DWORD *pdwRequestId = GetDecodeRequestId(pImageView);
+    if ((NULL != pdwRequestId) && (0 != *pdwRequestId))
+    {
+        SdkImageDecodeService::Cancel(*pdwRequestId);
+        *pdwRequestId = 0;
+    }
+}
+
+//////////////////////////////////////////////////////////////////////////
+
+void SdkImagePreviewLayout::UpdateDecodePriority()
+{
+    // The children do not move, m_nCurIndex tells which one is shown.
+    DWORD dwRequestIds[] = { m_dwLastDecodeId, m_dwCurDecodeId, m_dwNextDecodeId };
+
+    for (INT32 i = 0; i < (INT32)ARRAYSIZE(dwRequestIds); ++i)
+    {
+        if (0 != dwRequestIds[i])
+        {
+            SdkImageDecodeService::SetPriority(dwRequestIds[i],
+                (i == m_nCurIndex) ? IMAGE_DECODE_PRIORITY_VISIBLE : IMAGE_DECODE_PRIORITY_PREFETCH);
         }
-        pImageView->Start();
     }
 }
 
@@ -1227,6 +1327,10 @@ void SdkImagePreviewLayout::Reset()
     m_bContinue         = FALSE;
     m_pCurrentShowView  = NULL;
 
+    CancelImageDecode(m_pLastImageView);
+    CancelImageDecode(m_pCurImageView);
+    CancelImageDecode(m_pNextImageView);
+
     m_pLastImageView->Stop();
     m_pCurImageView->Stop();
     m_pNextImageView->Stop();
@@ -1346,11 +1450,13 @@ void SdkImagePreviewLayout::DeleteImageView()
 
     if (NULL != pLastImageView)
     {
+        CancelImageDecode(pLastImageView);
         pLastImageView->Stop();
         pLastImageView->ClearAssocData();
     }
     if (NULL != pNextImageView)
     {
+        CancelImageDecode(pNextImageView);
         pNextImageView->Stop();
         pNextImageView->ClearAssocData();
     }
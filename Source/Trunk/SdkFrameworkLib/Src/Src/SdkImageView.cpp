@@ -26,6 +26,8 @@ struct NAMESPACE_VIEWS::SdkImageView::_IMAGEVIEW_INTERNALDATA
     FLOAT                m_bottomMargin;        // The bottom margin of source image to background.
     D2D1_RECT_F          m_imageDrawRect;       // The image drawing rectangle.
     IMAGE_STRETCH_MODE   m_stretchMode;         // The flag whether to Stretch the bitmap to fill all view.
+    DWORD                m_dwDecodeRequestId;   // The request id of SetSrcImageAsync.
+    D2D1_SIZE_F          m_previewSize;         // The size of the full image while its preview is shown.
     D2DBitmap           *m_pSrcD2DBitmap;       // The pointer which points to the object of D2DBitmap.
 };
 
@@ -47,6 +49,7 @@ SdkImageView::SdkImageView()
 
 SdkImageView::~SdkImageView()
 {
+    CancelImageDecode();
     SAFE_DELETE(m_lpImageViewData->m_pSrcD2DBitmap);
     SAFE_DELETE(m_lpImageViewData);
 }
@@ -55,6 +58,8 @@ SdkImageView::~SdkImageView()
 
 BOOL SdkImageView::SetSrcImage(LPCWSTR lpFile, UINT32 uDestWidth, UINT32 uDestHeight)
 {
+    CancelImageDecode();
+
     BOOL retVal = m_lpImageViewData->m_pSrcD2DBitmap->LoadFromFile(lpFile, uDestWidth, uDestHeight);
     if ( retVal )
     {
@@ -66,8 +71,28 @@ BOOL SdkImageView::SetSrcImage(LPCWSTR lpFile, UINT32 uDestWidth, UINT32 uDestHe
 
 //////////////////////////////////////////////////////////////////////////
 
+BOOL SdkImageView::SetSrcImageAsync(LPCWSTR lpFile, UINT32 uDestWidth, UINT32 uDestHeight, IMAGE_DECODE_PRIORITY priority)
+{
+    CancelImageDecode();
+
+    // The preview of a big image is shown first, then the full image.
+    DWORD dwRequestId = SdkImageDecodeService::DecodeFile(lpFile, uDestWidth, uDestHeight, priority, this, TRUE);
+    if ( 0 == dwRequestId )
+    {
+        return SetSrcImage(lpFile, uDestWidth, uDestHeight);
+    }
+
+    m_lpImageViewData->m_dwDecodeRequestId = dwRequestId;
+
+    return TRUE;
+}
+
+//////////////////////////////////////////////////////////////////////////
+
 BOOL SdkImageView::SetSrcImage(IN D2DBitmap *pD2DBitmap)
 {
+    CancelImageDecode();
+
     SAFE_DELETE(m_lpImageViewData->m_pSrcD2DBitmap);
     m_lpImageViewData->m_pSrcD2DBitmap = pD2DBitmap;
 
@@ -83,6 +108,8 @@ BOOL SdkImageView::SetSrcImage(IN D2DBitmap *pD2DBitmap)
 
 BOOL SdkImageView::SetSrcImage(IN HBITMAP hBitmap, UINT32 uDestWidth, UINT32 uDestHeight)
 {
+    CancelImageDecode();
+
     BOOL retVal = m_lpImageViewData->m_pSrcD2DBitmap->LoadFromHBITMAP(
         hBitmap,
         uDestWidth,
@@ -100,6 +127,8 @@ BOOL SdkImageView::SetSrcImage(IN HBITMAP hBitmap, UINT32 uDestWidth, UINT32 uDe
 
 BOOL SdkImageView::SetSrcImage(UINT resId, HMODULE hModule, UINT32 uDestWidth, UINT32 uDestHeight)
 {
+    CancelImageDecode();
+
     BOOL retVal = m_lpImageViewData->m_pSrcD2DBitmap->LoadFromResource(
         resId,
         hModule,
@@ -153,6 +182,7 @@ void SdkImageView::SetImageMargin(IN FLOAT left, IN FLOAT top, IN FLOAT right, I
 
 void SdkImageView::ClearAssocData()
 {
+    CancelImageDecode();
     SdkViewElement::ClearAssocData();
 
     SAFE_DELETE(m_lpImageViewData->m_pSrcD2DBitmap);
@@ -196,13 +226,20 @@ D2D1_RECT_F SdkImageView::GetDrawRect(const D2D1_RECT_F& viewRc, D2DBitmap *pBit
         pBitmap->GetD2DBitmap(&pID2D1Bitmap);
     }
 
+    // The preview is smaller than the full image, it is drawn in the size of the full image.
+    D2D_SIZE_F imageSize = m_lpImageViewData->m_previewSize;
+    if ( (NULL != pID2D1Bitmap) && ((0 == imageSize.width) || (0 == imageSize.height)) )
+    {
+        imageSize = pID2D1Bitmap->GetSize();
+    }
+
     switch (m_lpImageViewData->m_stretchMode)
     {
     case IMAGE_STRETCH_MODE_CENTER:
         {
             if ( NULL != pID2D1Bitmap )
             {
-                D2D_SIZE_F bitmapSize =  pID2D1Bitmap->GetSize();
+                D2D_SIZE_F bitmapSize = imageSize;
                 FLOAT srcWidth = bitmapSize.width;
                 FLOAT srcHeight = bitmapSize.height;
 
@@ -238,7 +275,7 @@ D2D1_RECT_F SdkImageView::GetDrawRect(const D2D1_RECT_F& viewRc, D2DBitmap *pBit
         {
             if (NULL != pID2D1Bitmap)
             {
-                D2D_SIZE_F bitmapSize = pID2D1Bitmap->GetSize();
+                D2D_SIZE_F bitmapSize = imageSize;
 
                 FLOAT srcWidth = bitmapSize.width;
                 FLOAT srcHeight = bitmapSize.height;
@@ -257,7 +294,7 @@ D2D1_RECT_F SdkImageView::GetDrawRect(const D2D1_RECT_F& viewRc, D2DBitmap *pBit
         {
             if ( NULL != pID2D1Bitmap )
             {
-                D2D_SIZE_F bitmapSize = pID2D1Bitmap->GetSize();
+                D2D_SIZE_F bitmapSize = imageSize;
                 FLOAT srcWidth = bitmapSize.width;
                 FLOAT srcHeight = bitmapSize.height;
 
@@ -275,7 +312,7 @@ D2D1_RECT_F SdkImageView::GetDrawRect(const D2D1_RECT_F& viewRc, D2DBitmap *pBit
         {
             if ( NULL != pID2D1Bitmap )
             {
-                D2D_SIZE_F bitmapSize = pID2D1Bitmap->GetSize();
+                D2D_SIZE_F bitmapSize = imageSize;
                 FLOAT srcWidth = bitmapSize.width;
                 FLOAT srcHeight = bitmapSize.height;
 
@@ -293,7 +330,7 @@ D2D1_RECT_F SdkImageView::GetDrawRect(const D2D1_RECT_F& viewRc, D2DBitmap *pBit
         {
             if ( NULL != pID2D1Bitmap )
             {
-                D2D_SIZE_F bitmapSize = pID2D1Bitmap->GetSize();
+                D2D_SIZE_F bitmapSize = imageSize;
                 FLOAT srcWidth = bitmapSize.width;
                 FLOAT srcHeight = bitmapSize.height;
 
@@ -311,7 +348,7 @@ D2D1_RECT_F SdkImageView::GetDrawRect(const D2D1_RECT_F& viewRc, D2DBitmap *pBit
         {
             if ( NULL != pID2D1Bitmap )
             {
-                D2D_SIZE_F bitmapSize = pID2D1Bitmap->GetSize();
+                D2D_SIZE_F bitmapSize = imageSize;
                 FLOAT srcWidth = bitmapSize.width;
                 FLOAT srcHeight = bitmapSize.height;
 
@@ -360,3 +397,47 @@ void SdkImageView::ConvertToFitMode(IN FLOAT destWidth, IN FLOAT destHeight, IN
         }
     }
 }
+
+//////////////////////////////////////////////////////////////////////////
+
+void SdkImageView::OnImageDecoded(IN const IMAGEDECODERESULT *lpResult)
+{
+    if ( lpResult->dwRequestId != m_lpImageViewData->m_dwDecodeRequestId )
+    {
+        return;
+    }
+
+    // The request of a preview is not finished, the full image follows.
+    if ( !lpResult->isPreview )
+    {
+        m_lpImageViewData->m_dwDecodeRequestId = 0;
+    }
+
+    if ( NULL == m_lpImageViewData->m_pSrcD2DBitmap )
+    {
+        m_lpImageViewData->m_pSrcD2DBitmap = new D2DBitmap();
+    }
+
+    if ( SUCCEEDED(lpResult->hrDecode) &&
+         m_lpImageViewData->m_pSrcD2DBitmap->LoadFromWICBitmap(lpResult->pBitmap) )
+    {
+        m_lpImageViewData->m_previewSize = lpResult->isPreview ?
+            D2D1::SizeF((FLOAT)lpResult->uWidth, (FLOAT)lpResult->uHeight) : D2D1::SizeF(0, 0);
+
+        AddFlag(VIEW_STATE_CLIPVIEW);
+        Invalidate();
+    }
+}
+
+//////////////////////////////////////////////////////////////////////////
+
+void SdkImageView::CancelImageDecode()
+{
+    if ( 0 != m_lpImageViewData->m_dwDecodeRequestId )
+    {
+        SdkImageDecodeService::Cancel(m_lpImageViewData->m_dwDecodeRequestId);
+        m_lpImageViewData->m_dwDecodeRequestId = 0;
+    }
+
+    m_lpImageViewData->m_previewSize = D2D1::SizeF(0, 0);
+}
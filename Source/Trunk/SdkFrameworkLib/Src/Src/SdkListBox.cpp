@@ -56,10 +56,10 @@ SdkListBox::SdkListBox()
     m_pListBoxData->m_pItemSelectBitmap = new D2DBitmap();
     m_pListBoxData->m_pItemHoverBitmap  = new D2DBitmap();
     m_pListBoxData->m_pItemPressBitmap  = new D2DBitmap();
-    m_pListBoxData->m_pItemNormapBitmap->LoadFromHBITMAP(SdkResManager::GetImage(IDB_LISTBOX_ITEM_BK));
-    m_pListBoxData->m_pItemSelectBitmap->LoadFromHBITMAP(SdkResManager::GetImage(IDB_LISTBOX_ITEM_SEL));
-    m_pListBoxData->m_pItemHoverBitmap->LoadFromHBITMAP(SdkResManager::GetImage(IDB_LISTBOX_ITEM_HOVER));
-    m_pListBoxData->m_pItemPressBitmap->LoadFromHBITMAP(SdkResManager::GetImage(IDB_LISTBOX_ITEM_DOWN));
+    m_pListBoxData->m_pItemNormapBitmap->LoadFromSharedHBITMAP(SdkResManager::GetImage(IDB_LISTBOX_ITEM_BK));
+    m_pListBoxData->m_pItemSelectBitmap->LoadFromSharedHBITMAP(SdkResManager::GetImage(IDB_LISTBOX_ITEM_SEL));
+    m_pListBoxData->m_pItemHoverBitmap->LoadFromSharedHBITMAP(SdkResManager::GetImage(IDB_LISTBOX_ITEM_HOVER));
+    m_pListBoxData->m_pItemPressBitmap->LoadFromSharedHBITMAP(SdkResManager::GetImage(IDB_LISTBOX_ITEM_DOWN));
 
     SetClassName(CLASSNAME_LISTBOX);
     SetClickable(FALSE);
@@ -458,27 +458,16 @@ BOOL SdkListBox::OnLongClick(SdkViewElement *pView)
 
 void SdkListBox::OnDrawAllItems(IN ID2D1RenderTarget *pRenderTarget)
 {
-    if ( !m_pListBoxData->m_pItemNormapBitmap->HasInitialized() )
-    {
-        m_pListBoxData->m_pItemNormapBitmap->Initialize(pRenderTarget);
-    }
+    SdkD2DTheme *pD2DTheme = SdkD2DTheme::GetD2DThemeInstance();
 
-    // Draw child's normal bitmap.
-    ID2D1Bitmap *pD2DBitmap = NULL;
-    m_pListBoxData->m_pItemNormapBitmap->GetD2DBitmap(&pD2DBitmap);
-
-    if ( NULL != pD2DBitmap )
+    // Draw child's normal bitmap, it is the shared skin image in the bitmap atlas.
+    int nChildCount = GetChildCount();
+    for (int i = 0; i < nChildCount; ++i)
     {
-        int nChildCount = GetChildCount();
-        for (int i = 0; i < nChildCount; ++i)
-        {
-            SdkViewElement *pChild = m_vctChildren[i];
-            D2D1_RECT_F itemRc = pChild->GetDrawingRect();
-            pRenderTarget->DrawBitmap(pD2DBitmap, itemRc);
-        }
+        SdkViewElement *pChild = m_vctChildren[i];
+        D2D1_RECT_F itemRc = pChild->GetDrawingRect();
+        pD2DTheme->OnDrawBitmap(pChild, pRenderTarget, m_pListBoxData->m_pItemNormapBitmap, itemRc);
     }
-
-    SAFE_RELEASE(pD2DBitmap);
 }
 
 //////////////////////////////////////////////////////////////////////////
@@ -0,0 +1,176 @@
+/*!
+* @file SdkOffscreenWindow.cpp
+*
+* @brief This file defines the class SdkOffscreenWindow, renders the views without a window.
+*
+* Copyright (C) 2011, LZT Corporation.
+*
+* @author Li Hong
+* @date 2011/07/04
+*/
+
+#include "stdafx.h"
+#include "SdkOffscreenWindow.h"
+#include "SdkViewElement.h"
+#include "D2DDevice.h"
+
+USING_NAMESPACE_D2D
+USING_NAMESPACE_WINDOW
+
+SdkOffscreenWindow::SdkOffscreenWindow() : m_uFrameWidth(0),
+                                           m_uFrameHeight(0),
+                                           m_isFullFrame(TRUE)
+{
+    m_pD2DDevice = new D2DDevice();
+    m_pD2DDevice->SetPaintTargetType(DEVICE_TARGET_TYPE_SOFTWARE);
+}
+
+//////////////////////////////////////////////////////////////////////////
+
+SdkOffscreenWindow::~SdkOffscreenWindow()
+{
+}
+
+//////////////////////////////////////////////////////////////////////////
+
+HRESULT SdkOffscreenWindow::SetFrameSize(UINT32 uWidth, UINT32 uHeight)
+{
+    HRESULT hr = m_pD2DDevice->InitSoftwareDevice(uWidth, uHeight);
+    if (SUCCEEDED(hr))
+    {
+        m_uFrameWidth  = uWidth;
+        m_uFrameHeight = uHeight;
+        m_isFullFrame  = TRUE;
+        m_vctPaintRects.clear();
+
+        if (NULL != m_pRootView)
+        {
+            m_pRootView->SetLayoutInfo(0, 0, (FLOAT)uWidth, (FLOAT)uHeight);
+        }
+    }
+
+    return hr;
+}
+
+//////////////////////////////////////////////////////////////////////////
+
+HRESULT SdkOffscreenWindow::RenderFrame(BOOL isForceFull)
+{
+    if ( (NULL == m_pRootView) || (0 == m_uFrameWidth) || (0 == m_uFrameHeight) )
+    {
+        return E_FAIL;
+    }
+
+    // Take the views invalidated since the last call of Invalidate.
+    if (m_nWindowState & WINDOW_STATE_INVALIDATE)
+    {
+        Invalidate();
+    }
+
+    m_pD2DDevice->SetOpacity(m_fOpacity);
+
+    // Only the dirty rectangles are repainted if the last frame is kept by the render target.
+    BOOL isPartialPaint = !isForceFull && !m_isFullFrame && m_pD2DDevice->IsContentRetained();
+    m_pD2DDevice->BeginDraw(NULL, NULL, !isPartialPaint);
+
+    if (isPartialPaint)
+    {
+        PaintDirtyRects(m_vctPaintRects);
+    }
+    else
+    {
+        m_pRootView->OnPaint();
+    }
+
+    m_pD2DDevice->EndDraw();
+
+    m_vctPaintRects.clear();
+    m_isFullFrame = FALSE;
+
+    // The views invalidated while painting, such as the animations, are painted in the next frame.
+    if (m_nWindowState & WINDOW_STATE_INVALIDATE)
+    {
+        Invalidate();
+    }
+
+    // The content is kept only if the frame is drawn.
+    if (!m_pD2DDevice->IsContentRetained())
+    {
+        m_isFullFrame = TRUE;
+        return E_FAIL;
+    }
+
+    return S_OK;
+}
+
+//////////////////////////////////////////////////////////////////////////
+
+HRESULT SdkOffscreenWindow::GetFrameBitmap(OUT IWICBitmap **ppBitmap)
+{
+    return m_pD2DDevice->GetSoftwareBitmap(ppBitmap);
+}
+
+//////////////////////////////////////////////////////////////////////////
+
+LONG SdkOffscreenWindow::GetWidth() const
+{
+    return (LONG)m_uFrameWidth;
+}
+
+//////////////////////////////////////////////////////////////////////////
+
+LONG SdkOffscreenWindow::GetHeight() const
+{
+    return (LONG)m_uFrameHeight;
+}
+
+//////////////////////////////////////////////////////////////////////////
+
+void SdkOffscreenWindow::Invalidate(BOOL isErase, const LPRECT lprcPaint)
+{
+    if (isErase)
+    {
+        if (NULL != lprcPaint)
+        {
+            MergeDirtyRect(m_vctPaintRects, *lprcPaint);
+        }
+        else
+        {
+            m_isFullFrame = TRUE;
+        }
+    }
+    else if (m_nWindowState & WINDOW_STATE_INVALIDATE)
+    {
+        if (m_vctDirtyRects.empty())
+        {
+            m_isFullFrame = TRUE;
+        }
+        else
+        {
+            for (vector<RECT>::iterator itor = m_vctDirtyRects.begin();
+                 itor != m_vctDirtyRects.end(); ++itor)
+            {
+                MergeDirtyRect(m_vctPaintRects, *itor);
+            }
+        }
+    }
+
+    m_vctDirtyRects.clear();
+    RemoveWindowState(WINDOW_STATE_INVALIDATE);
+}
+
+//////////////////////////////////////////////////////////////////////////
+
+void SdkOffscreenWindow::AddDirtyRect(IN const D2D1_RECT_F& rcView)
+{
+    RECT rcDirty = { 0 };
+    RECT rcFrame = { 0, 0, (LONG)m_uFrameWidth, (LONG)m_uFrameHeight };
+    ViewToClientRect(rcView, rcDirty);
+
+    // The rectangle out of the frame is not repainted.
+    if (::IntersectRect(&rcDirty, &rcDirty, &rcFrame))
+    {
+        MergeDirtyRect(m_vctDirtyRects, rcDirty);
+        AddWindowState(WINDOW_STATE_INVALIDATE);
+    }
+}
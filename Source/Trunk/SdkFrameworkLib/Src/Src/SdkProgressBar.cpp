@@ -52,9 +52,9 @@ SdkProgressBar::SdkProgressBar()
     m_pProgressBarData->m_pTrackBitmap      = new D2DBitmap();
     m_pProgressBarData->m_pProgressBitmap   = new D2DBitmap();
 
-    m_pProgressBarData->m_pThumbBitmap->LoadFromHBITMAP(SdkResManager::GetImage(IDB_SEEKBAR_THUMB));
-    m_pProgressBarData->m_pTrackBitmap->LoadFromHBITMAP(SdkResManager::GetImage(IDB_SEEKBAR_TRACK));
-    m_pProgressBarData->m_pProgressBitmap->LoadFromHBITMAP(SdkResManager::GetImage(IDB_SEEKBAR_PROGRESS));
+    m_pProgressBarData->m_pThumbBitmap->LoadFromSharedHBITMAP(SdkResManager::GetImage(IDB_SEEKBAR_THUMB));
+    m_pProgressBarData->m_pTrackBitmap->LoadFromSharedHBITMAP(SdkResManager::GetImage(IDB_SEEKBAR_TRACK));
+    m_pProgressBarData->m_pProgressBitmap->LoadFromSharedHBITMAP(SdkResManager::GetImage(IDB_SEEKBAR_PROGRESS));
 }
 
 //////////////////////////////////////////////////////////////////////////
@@ -64,11 +64,11 @@ SdkRadioButton::SdkRadioButton()
     m_pRadioData->m_pDisableBitmap = new D2DBitmap();
     m_pRadioData->m_pCheckBitmap   = new D2DBitmap();
 
-    m_pRadioData->m_pNormalBitmap->LoadFromHBITMAP(SdkResManager::GetImage(IDB_RADIOBUTOTN_NORMAL));
-    m_pRadioData->m_pHoverBitmap->LoadFromHBITMAP(SdkResManager::GetImage(IDB_RADIOBUTOTN_HOVER));
-    m_pRadioData->m_pDownBitmap->LoadFromHBITMAP(SdkResManager::GetImage(IDB_RADIOBUTOTN_DOWN));
-    m_pRadioData->m_pCheckBitmap->LoadFromHBITMAP(SdkResManager::GetImage(IDB_RADIOBUTOTN_CHECKROUND));
-    m_pRadioData->m_pDisableBitmap->LoadFromHBITMAP(SdkResManager::GetImage(IDB_RADIOBUTOTN_DISABLE));
+    m_pRadioData->m_pNormalBitmap->LoadFromSharedHBITMAP(SdkResManager::GetImage(IDB_RADIOBUTOTN_NORMAL));
+    m_pRadioData->m_pHoverBitmap->LoadFromSharedHBITMAP(SdkResManager::GetImage(IDB_RADIOBUTOTN_HOVER));
+    m_pRadioData->m_pDownBitmap->LoadFromSharedHBITMAP(SdkResManager::GetImage(IDB_RADIOBUTOTN_DOWN));
+    m_pRadioData->m_pCheckBitmap->LoadFromSharedHBITMAP(SdkResManager::GetImage(IDB_RADIOBUTOTN_CHECKROUND));
+    m_pRadioData->m_pDisableBitmap->LoadFromSharedHBITMAP(SdkResManager::GetImage(IDB_RADIOBUTOTN_DISABLE));
 }
 
 //////////////////////////////////////////////////////////////////////////
@@ -62,12 +62,12 @@ SdkRatingView::SdkRatingView()
     m_pRatingViewData->m_pCheckHoverBitmap  = new D2DBitmap();
     m_pRatingViewData->m_pCheckPressBitmap  = new D2DBitmap();
 
-    m_pRatingViewData->m_pNormalBitmap->LoadFromHBITMAP(SdkResManager::GetImage(IDB_RATING_NORMAL));
-    m_pRatingViewData->m_pCheckBitmap ->LoadFromHBITMAP(SdkResManager::GetImage(IDB_RATING_CHECK));
-    m_pRatingViewData->m_pNormalHoverBitmap->LoadFromHBITMAP(SdkResManager::GetImage(IDB_RATING_NORMAL_HOVER));
-    m_pRatingViewData->m_pNormalPressBitmap->LoadFromHBITMAP(SdkResManager::GetImage(IDB_RATING_NORMAL_PRESS));
-    m_pRatingViewData->m_pCheckHoverBitmap->LoadFromHBITMAP(SdkResManager::GetImage(IDB_RATING_CHECK_HOVER));
-    m_pRatingViewData->m_pCheckPressBitmap->LoadFromHBITMAP(SdkResManager::GetImage(IDB_RATING_CHECK_PRESS));
+    m_pRatingViewData->m_pNormalBitmap->LoadFromSharedHBITMAP(SdkResManager::GetImage(IDB_RATING_NORMAL));
+    m_pRatingViewData->m_pCheckBitmap ->LoadFromSharedHBITMAP(SdkResManager::GetImage(IDB_RATING_CHECK));
+    m_pRatingViewData->m_pNormalHoverBitmap->LoadFromSharedHBITMAP(SdkResManager::GetImage(IDB_RATING_NORMAL_HOVER));
+    m_pRatingViewData->m_pNormalPressBitmap->LoadFromSharedHBITMAP(SdkResManager::GetImage(IDB_RATING_NORMAL_PRESS));
+    m_pRatingViewData->m_pCheckHoverBitmap->LoadFromSharedHBITMAP(SdkResManager::GetImage(IDB_RATING_CHECK_HOVER));
+    m_pRatingViewData->m_pCheckPressBitmap->LoadFromSharedHBITMAP(SdkResManager::GetImage(IDB_RATING_CHECK_PRESS));
 
     SetClassName(CLASSNAME_RATINGVIEW);
     SetMinHeight(20);
@@ -14,10 +14,39 @@
 
 USING_NAMESPACE_THEME
 
-HMODULE SdkResManager::s_hResModule = NULL;
-vector<wstring> SdkResManager::s_vctStrings;
-vector<LPIMAGEDATA> SdkResManager::s_vctImageInfos;
-SdkWICImageHelper* SdkResManager::s_pImageHelper = NULL;
+#define RES_IMAGE_MIN_BUCKETS       64              // The initial count of the hash buckets, power of 2.
+
+
+/*!
+* @brief The lock of the image table is created when the module is loaded, the images
+*        which are not freed by FreeResLibrary are deleted here.
+*/
+class NAMESPACE_THEME::SdkResManagerLock
+{
+public:
+
+    SdkResManagerLock()
+    {
+        InitializeCriticalSection(&SdkResManager::s_csLock);
+    }
+
+    ~SdkResManagerLock()
+    {
+        SdkResManager::ClearImageData();
+        DeleteCriticalSection(&SdkResManager::s_csLock);
+    }
+};
+
+
+HMODULE                             SdkResManager::s_hResModule = NULL;
+vector<wstring>                     SdkResManager::s_vctStrings;
+CRITICAL_SECTION                    SdkResManager::s_csLock;
+size_t                              SdkResManager::s_nImageCount = 0;
+vector< vector<LPIMAGEDATA> >       SdkResManager::s_vctImageBuckets;
+
+// It must be defined after the static members, it uses them when it is constructed.
+static SdkResManagerLock            g_resManagerLock;
+
 
 
 //////////////////////////////////////////////////////////////////////////
@@ -29,8 +58,7 @@ BOOL SdkResManager::LoadResLibrary(LPCTSTR lpLibFileName)
         lpLibFileName = L"SdkResourceLib.dll";
     }
 
-    s_hResModule   = ::LoadLibrary(lpLibFileName);
-    s_pImageHelper = new SdkWICImageHelper();
+    s_hResModule = ::LoadLibrary(lpLibFileName);
 
     return (NULL != s_hResModule);
 }
@@ -45,16 +73,7 @@ void SdkResManager::FreeResLibrary()
         s_hResModule = NULL;
     }
 
-    SAFE_DELETE(s_pImageHelper);
-
-    // Delete the cache image data.
-    int nSize = (int)s_vctImageInfos.size();
-    for (int i = 0; i < nSize; ++i)
-    {
-        LPIMAGEDATA lpImageData = s_vctImageInfos[i];
-        SAFE_DELETE_OBJECT(lpImageData->hBitmap);
-        SAFE_DELETE(lpImageData);
-    }
+    ClearImageData();
 }
 
 //////////////////////////////////////////////////////////////////////////
@@ -66,6 +85,42 @@ HMODULE SdkResManager::GetResModule()
 
 //////////////////////////////////////////////////////////////////////////
 
+int SdkResManager::PreloadImages(int nManifestId, HMODULE hModule)
+{
+    if ( NULL == hModule )
+    {
+        hModule = s_hResModule;
+    }
+
+    HRSRC hrSrc = (NULL != hModule) ? FindResource(hModule, MAKEINTRESOURCE(nManifestId), RT_RCDATA) : NULL;
+    if ( NULL == hrSrc )
+    {
+        return -1;
+    }
+
+    const WORD *pResIds = (const WORD*)LockResource(LoadResource(hModule, hrSrc));
+    int nCount = (int)(SizeofResource(hModule, hrSrc) / sizeof(WORD));
+    if ( NULL == pResIds )
+    {
+        return -1;
+    }
+
+    // The images are decoded on the same path as GetImage, the views which are created on
+    // other threads at the same time get the same bitmaps.
+    int nLoaded = 0;
+    for (int i = 0; i < nCount; ++i)
+    {
+        if ( NULL != GetImageInfo(pResIds[i], hModule) )
+        {
+            ++nLoaded;
+        }
+    }
+
+    return nLoaded;
+}
+
+//////////////////////////////////////////////////////////////////////////
+
 HBITMAP SdkResManager::GetImage(int nResId)
 {
     return GetImage(nResId, SdkResManager::GetResModule());
@@ -80,7 +135,7 @@ HBITMAP SdkResManager::GetImage(int nResId, HMODULE hModule)
         hModule = s_hResModule;
     }
 
-    LPIMAGEDATA lpImageData = GetImageInfo(nResId, hModule);
+    LPCIMAGEDATA lpImageData = GetImageInfo(nResId, hModule);
     if ( NULL != lpImageData )
     {
         return lpImageData->hBitmap;
@@ -91,34 +146,57 @@ HBITMAP SdkResManager::GetImage(int nResId, HMODULE hModule)
 
 //////////////////////////////////////////////////////////////////////////
 
-LPIMAGEDATA SdkResManager::GetImageInfo(int nResId, HMODULE hModule)
+LPCIMAGEDATA SdkResManager::GetImageInfo(int nResId, HMODULE hModule)
 {
     if ( NULL == hModule )
     {
         hModule = s_hResModule;
     }
 
+    EnterCriticalSection(&s_csLock);
     LPIMAGEDATA lpImageData = FindImageData(nResId, hModule);
+    LeaveCriticalSection(&s_csLock);
+
+    if ( NULL != lpImageData )
+    {
+        return lpImageData;
+    }
+
+    // The image is decoded out of the lock, the other threads are not blocked by it.
+    SdkWICImageHelper imageHelper;
+    if ( !imageHelper.LoadFromResource(nResId, hModule) )
+    {
+        return NULL;
+    }
+
+    HBITMAP hBitmap = imageHelper.GetHBITMAP();
+    if ( NULL == hBitmap )
+    {
+        return NULL;
+    }
+
+    EnterCriticalSection(&s_csLock);
+
+    // Another thread may load the same image at the same time, the first one is kept.
+    lpImageData = FindImageData(nResId, hModule);
     if ( NULL == lpImageData )
     {
-        if ( NULL != s_pImageHelper )
-        {
-            BOOL isSucceed = s_pImageHelper->LoadFromResource(nResId, hModule);
-            if ( isSucceed )
-            {
-                lpImageData = new IMAGEDATA();
+        lpImageData = new IMAGEDATA();
 
-                lpImageData->hModule = hModule;
-                lpImageData->nResId  = nResId;
-                lpImageData->hBitmap = s_pImageHelper->GetHBITMAP();
-                lpImageData->nHeight = s_pImageHelper->GetHeight();
-                lpImageData->nWidth  = s_pImageHelper->GetWidth();
+        lpImageData->hModule = hModule;
+        lpImageData->nResId  = nResId;
+        lpImageData->hBitmap = hBitmap;
+        lpImageData->nHeight = imageHelper.GetHeight();
+        lpImageData->nWidth  = imageHelper.GetWidth();
 
-                s_vctImageInfos.push_back(lpImageData);
-            }
-        }
+        InsertImageData(lpImageData);
+        hBitmap = NULL;
     }
 
+    LeaveCriticalSection(&s_csLock);
+
+    SAFE_DELETE_OBJECT(hBitmap);
+
     return lpImageData;
 }
 
@@ -140,17 +218,85 @@ LPCTSTR SdkResManager::GetString(int nResId, HMODULE hModule)
 
 LPIMAGEDATA SdkResManager::FindImageData(int nResId, HMODULE hModule)
 {
-    LPIMAGEDATA lpImageData = NULL;
+    if ( s_vctImageBuckets.empty() )
+    {
+        return NULL;
+    }
+
+    size_t nIndex = GetBucketIndex(nResId, hModule, s_vctImageBuckets.size());
 
-    for each (LPIMAGEDATA imageData in s_vctImageInfos)
+    for each (LPIMAGEDATA imageData in s_vctImageBuckets[nIndex])
     {
         if ( nResId  == imageData->nResId &&
              hModule == imageData->hModule )
         {
-            lpImageData = imageData;
-            break;
+            return imageData;
         }
     }
 
-    return lpImageData;
+    return NULL;
+}
+
+//////////////////////////////////////////////////////////////////////////
+
+void SdkResManager::InsertImageData(LPIMAGEDATA lpImageData)
+{
+    size_t nBuckets = s_vctImageBuckets.size();
+
+    // Keep at most one image per bucket on average, the table is doubled when it is full.
+    if ( s_nImageCount >= nBuckets )
+    {
+        size_t nNewBuckets = max(nBuckets * 2, (size_t)RES_IMAGE_MIN_BUCKETS);
+        vector< vector<LPIMAGEDATA> > vctNewBuckets(nNewBuckets);
+
+        for (size_t i = 0; i < nBuckets; ++i)
+        {
+            for each (LPIMAGEDATA imageData in s_vctImageBuckets[i])
+            {
+                size_t nIndex = GetBucketIndex(imageData->nResId, imageData->hModule, nNewBuckets);
+                vctNewBuckets[nIndex].push_back(imageData);
+            }
+        }
+
+        s_vctImageBuckets.swap(vctNewBuckets);
+        nBuckets = nNewBuckets;
+    }
+
+    size_t nIndex = GetBucketIndex(lpImageData->nResId, lpImageData->hModule, nBuckets);
+    s_vctImageBuckets[nIndex].push_back(lpImageData);
+    ++s_nImageCount;
+}
+
+//////////////////////////////////////////////////////////////////////////
+
+void SdkResManager::ClearImageData()
+{
+    EnterCriticalSection(&s_csLock);
+
+    for (size_t i = 0; i < s_vctImageBuckets.size(); ++i)
+    {
+        for each (LPIMAGEDATA imageData in s_vctImageBuckets[i])
+        {
+            SAFE_DELETE_OBJECT(imageData->hBitmap);
+            SAFE_DELETE(imageData);
+        }
+    }
+
+    s_vctImageBuckets.clear();
+    s_nImageCount = 0;
+
+    LeaveCriticalSection(&s_csLock);
+}
+
+//////////////////////////////////////////////////////////////////////////
+
+size_t SdkResManager::GetBucketIndex(int nResId, HMODULE hModule, size_t nBuckets)
+{
+    // The module handles are aligned to 64K, the low bits are always zero.
+    UINT64 uKey = ((UINT64)(UINT_PTR)hModule >> 16) ^ (UINT32)nResId;
+
+    // Fibonacci hashing spreads the sequential resource ids, the high bits are mixed best.
+    uKey *= 0x9E3779B97F4A7C15ULL;
+
+    return (size_t)(uKey >> 32) & (nBuckets - 1);
 }
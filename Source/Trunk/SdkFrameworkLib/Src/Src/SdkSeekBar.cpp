@@ -46,7 +46,7 @@ SdkSeekBar::SdkSeekBar()
     m_pSeekBarData->m_fMaxRange         = 100;
     m_pSeekBarData->m_pThumbBitmap      = new D2DBitmap();
 
-    m_pSeekBarData->m_pThumbBitmap->LoadFromHBITMAP(SdkResManager::GetImage(IDB_SEEKBAR_THUMB));
+    m_pSeekBarData->m_pThumbBitmap->LoadFromSharedHBITMAP(SdkResManager::GetImage(IDB_SEEKBAR_THUMB));
 }
 
 /////////////////////////////////////////////////////////////////////////
@@ -397,14 +397,14 @@ void SdkTabHeader::InitializeViews()
     m_pTabHeaderData->m_pPrevTabBitmap = new D2DBitmap();
     m_pTabHeaderData->m_pNextTabBitmap = new D2DBitmap();
 
-    m_pTabHeaderData->m_pNormalBitmap->LoadFromHBITMAP(SdkResManager::GetImage(IDB_TAB_NORMAL));
-    m_pTabHeaderData->m_pHoverBitmap->LoadFromHBITMAP(SdkResManager::GetImage(IDB_TAB_NORMAL_HOVER));
-    m_pTabHeaderData->m_pSelectBitmap->LoadFromHBITMAP(SdkResManager::GetImage(IDB_TAB_SELECT));
-    m_pTabHeaderData->m_pPressBitmap->LoadFromHBITMAP(SdkResManager::GetImage(IDB_TAB_NORMAL_PRESS));
-    m_pTabHeaderData->m_pTabBarBitmap->LoadFromHBITMAP(SdkResManager::GetImage(IDB_TAB_BAR));
-    m_pTabHeaderData->m_pAddTabBitmap->LoadFromHBITMAP(SdkResManager::GetImage(IDB_TAB_ADD));
-    m_pTabHeaderData->m_pPrevTabBitmap->LoadFromHBITMAP(SdkResManager::GetImage(IDB_TAB_ARROW_LEFT));
-    m_pTabHeaderData->m_pNextTabBitmap->LoadFromHBITMAP(SdkResManager::GetImage(IDB_TAB_ARROW_RIGHT));
+    m_pTabHeaderData->m_pNormalBitmap->LoadFromSharedHBITMAP(SdkResManager::GetImage(IDB_TAB_NORMAL));
+    m_pTabHeaderData->m_pHoverBitmap->LoadFromSharedHBITMAP(SdkResManager::GetImage(IDB_TAB_NORMAL_HOVER));
+    m_pTabHeaderData->m_pSelectBitmap->LoadFromSharedHBITMAP(SdkResManager::GetImage(IDB_TAB_SELECT));
+    m_pTabHeaderData->m_pPressBitmap->LoadFromSharedHBITMAP(SdkResManager::GetImage(IDB_TAB_NORMAL_PRESS));
+    m_pTabHeaderData->m_pTabBarBitmap->LoadFromSharedHBITMAP(SdkResManager::GetImage(IDB_TAB_BAR));
+    m_pTabHeaderData->m_pAddTabBitmap->LoadFromSharedHBITMAP(SdkResManager::GetImage(IDB_TAB_ADD));
+    m_pTabHeaderData->m_pPrevTabBitmap->LoadFromSharedHBITMAP(SdkResManager::GetImage(IDB_TAB_ARROW_LEFT));
+    m_pTabHeaderData->m_pNextTabBitmap->LoadFromSharedHBITMAP(SdkResManager::GetImage(IDB_TAB_ARROW_RIGHT));
 
     // The D2D Text layout object is used to draw text.
     m_pTabHeaderData->m_pD2DTextLayout = new D2DTextLayout();
@@ -421,14 +421,14 @@ void SdkTabHeader::InitializeViews()
     m_pTabHeaderData->m_pNextTabButton->SetViewSize(TAB_NEXTPREV_SIZE, TAB_NEXTPREV_SIZE);
     m_pTabHeaderData->m_pNextTabButton->SetOnClickHandler(this);
     m_pTabHeaderData->m_pPrevTabButton->SetOnClickHandler(this);
-    m_pTabHeaderData->m_pNextTabButton->SetImage(SdkResManager::GetImage(IDB_TAB_ARROW_RIGHT),  VIEW_STYLE_OVERLAY);
-    m_pTabHeaderData->m_pPrevTabButton->SetImage(SdkResManager::GetImage(IDB_TAB_ARROW_LEFT),   VIEW_STYLE_OVERLAY);
-    m_pTabHeaderData->m_pNextTabButton->SetImage(SdkResManager::GetImage(IDB_TAB_NORMAL),       VIEW_STYLE_NORMAL);
-    m_pTabHeaderData->m_pPrevTabButton->SetImage(SdkResManager::GetImage(IDB_TAB_NORMAL),       VIEW_STYLE_NORMAL);
-    m_pTabHeaderData->m_pNextTabButton->SetImage(SdkResManager::GetImage(IDB_TAB_NORMAL_HOVER), VIEW_STYLE_MOUSEHOVER);
-    m_pTabHeaderData->m_pPrevTabButton->SetImage(SdkResManager::GetImage(IDB_TAB_NORMAL_HOVER), VIEW_STYLE_MOUSEHOVER);
-    m_pTabHeaderData->m_pNextTabButton->SetImage(SdkResManager::GetImage(IDB_TAB_NORMAL_PRESS), VIEW_STYLE_MOUSEDOWN);
-    m_pTabHeaderData->m_pPrevTabButton->SetImage(SdkResManager::GetImage(IDB_TAB_NORMAL_PRESS), VIEW_STYLE_MOUSEDOWN);
+    m_pTabHeaderData->m_pNextTabButton->SetSharedImage(SdkResManager::GetImage(IDB_TAB_ARROW_RIGHT),  VIEW_STYLE_OVERLAY);
+    m_pTabHeaderData->m_pPrevTabButton->SetSharedImage(SdkResManager::GetImage(IDB_TAB_ARROW_LEFT),   VIEW_STYLE_OVERLAY);
+    m_pTabHeaderData->m_pNextTabButton->SetSharedImage(SdkResManager::GetImage(IDB_TAB_NORMAL),       VIEW_STYLE_NORMAL);
+    m_pTabHeaderData->m_pPrevTabButton->SetSharedImage(SdkResManager::GetImage(IDB_TAB_NORMAL),       VIEW_STYLE_NORMAL);
+    m_pTabHeaderData->m_pNextTabButton->SetSharedImage(SdkResManager::GetImage(IDB_TAB_NORMAL_HOVER), VIEW_STYLE_MOUSEHOVER);
+    m_pTabHeaderData->m_pPrevTabButton->SetSharedImage(SdkResManager::GetImage(IDB_TAB_NORMAL_HOVER), VIEW_STYLE_MOUSEHOVER);
+    m_pTabHeaderData->m_pNextTabButton->SetSharedImage(SdkResManager::GetImage(IDB_TAB_NORMAL_PRESS), VIEW_STYLE_MOUSEDOWN);
+    m_pTabHeaderData->m_pPrevTabButton->SetSharedImage(SdkResManager::GetImage(IDB_TAB_NORMAL_PRESS), VIEW_STYLE_MOUSEDOWN);
     m_pTabHeaderData->m_pNextTabButton->SetOverlayInfo(0, 0, TAB_NEXTPREV_SIZE, TAB_NEXTPREV_SIZE);
     m_pTabHeaderData->m_pPrevTabButton->SetOverlayInfo(0, 0, TAB_NEXTPREV_SIZE, TAB_NEXTPREV_SIZE);
     m_pTabHeaderData->m_pNextTabButton->SetVisible(FALSE);
@@ -59,7 +59,7 @@ SdkTabView::SdkTabView()
     InsertTab(0, _T(""));
     SetSelTab(0);
 
-    m_pInternalData->m_pBkImage->LoadFromHBITMAP(SdkResManager::GetImage(IDB_TAB_BK));
+    m_pInternalData->m_pBkImage->LoadFromSharedHBITMAP(SdkResManager::GetImage(IDB_TAB_BK));
 }
 
 //////////////////////////////////////////////////////////////////////////
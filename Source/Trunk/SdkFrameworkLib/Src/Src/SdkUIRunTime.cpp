@@ -23,8 +23,13 @@ BOOL SdkUIRunTime::InitializeUIRunTime()
     // Initialize common run-time, such as WIC, COM, Logger, etc.
     BOOL retVal1 = SdkCommonRunTime::InitializeRunTime();
 
-    // Load resource library.
+    // Load resource library, the skin images of the common views are decoded once here
+    // instead of by the first views.
     BOOL retVal2 = SdkResManager::LoadResLibrary();
+    if ( retVal2 )
+    {
+        SdkResManager::PreloadImages(IDR_PRELOAD_IMAGES);
+    }
 
     // Create instance of D2D Theme using to draw D2D graphics.
     BOOL retVal3 = SdkD2DTheme::CreateD2DThemeInstance();
@@ -14,6 +14,7 @@
 #include "SdkViewLayout.h"
 #include "SdkD2DTheme.h"
 #include "D2DSolidColorBrush.h"
+#include <math.h>
 
 USING_NAMESPACE_VIEWS
 
@@ -54,14 +55,28 @@ struct NAMESPACE_VIEWS::_INTERNALDATA
     INT32                    m_nViewState;               // The current state of view.
     BOOL                     m_hasTSRMatrix;             // Indicates whether has T, S, R matrix.
     BOOL                     m_isFocused;                // Indicates focused or not.
+    BOOL                     m_isPaintCulled;            // Indicates out of the dirty rectangle or not.
+    BOOL                     m_isWorldValid;             // Indicates whether the cached world data is valid.
+    BOOL                     m_isLayerValid;             // Indicates whether the cached layer is up to date.
+    D2D1_RECT_F              m_rcPaintBounds;            // The bounds painted last time.
+    D2D1_RECT_F              m_drawingRect;              // The cached drawing rect without own animation.
+    D2D1_POINT_2F            m_absoluteOffset;           // The cached sum of parents' left and top.
+    D2D1_RECT_F              m_rcLayer;                  // The pixel aligned rectangle of the cached layer.
+    D2D1_RECT_F              m_rcLayerBounds;            // The paint bounds when the layer is recorded.
     PVOID                    m_pTag;                     // The pointer to view tag.
     LPCTSTR                  m_lpClassName;              // The class name, do not delete the point.
     D2D1_COLOR_F             m_bkColor;                  // The color of background.
     D2D1_COLOR_F             m_borderColor;              // The border color.
     VIEW_TRANSFORMINFO       m_transformInfo;            // The transform data.
     Matrix3x2F               m_viewMatrix;               // The matrix of view.
+    Matrix3x2F               m_animMatrix;               // The animation matrix applied to the children.
+    Matrix3x2F               m_absoluteMatrix;           // The cached absolute matrix.
+    Matrix3x2F               m_chainMatrix;              // The cached absolute matrix with own animation.
+    Matrix3x2F               m_layerMatrix;              // The absolute matrix when the layer is recorded.
     VIEW_STYLE               m_viewStyle;                // The view style.
     ID2D1Layer              *m_pClipLayer;               // The clip layer.
+    ID2D1BitmapRenderTarget *m_pLayerTarget;             // The cached layer of the view and its children.
+    ID2D1RenderTarget       *m_pLayerDevice;             // The device render target the cached layer belongs to.
     D2DBrush                *m_pD2DBrush;                // The background brush;
     D2DBrush                *m_pBorderBrush;             // The border color brush.
     D2DBitmap               *m_pBKD2DBitmap;             // The pointer which points to the object of D2DBitmap.
@@ -81,6 +96,9 @@ SdkViewElement::SdkViewElement() : m_pWindow(NULL),
     ZeroMemory(m_pInternalData, sizeof(INTERNALDATA));
 
     m_pInternalData->m_viewMatrix           = Matrix3x2F::Identity();
+    m_pInternalData->m_animMatrix           = Matrix3x2F::Identity();
+    m_pInternalData->m_absoluteMatrix       = Matrix3x2F::Identity();
+    m_pInternalData->m_chainMatrix          = Matrix3x2F::Identity();
     m_pInternalData->m_pD2DBrush            = NULL;
     m_pInternalData->m_pBorderBrush         = new D2DSolidColorBrush();
     m_pInternalData->m_bkColor              = D2D1::ColorF(ColorF::Black);
@@ -120,6 +138,7 @@ SdkViewElement::~SdkViewElement()
     SAFE_DELETE(m_pInternalData->m_pBorderBrush);
     SAFE_DELETE(m_pInternalData->m_pBKD2DBitmap);
     SAFE_RELEASE(m_pInternalData->m_pClipLayer);
+    ReleaseLayer();
 
     SAFE_DELETE(m_pInternalData);
 
@@ -166,15 +185,34 @@ void SdkViewElement::OnPaint()
     CombineTSRMatrix();
     Matrix3x2F absoluteMatrix = GetAbsoluteMatrix();
     absoluteMatrix = absoluteMatrix * animMatrix;
-    pRenderTarget->SetTransform(absoluteMatrix);
+
+    // The view out of the dirty rectangle being painted is not drawn.
+    D2D1_RECT_F rcBounds = { 0 };
+    GetPaintBounds(rcBounds);
+    m_pInternalData->m_isPaintCulled = !m_pWindow->IsRectDirty(rcBounds);
+    if ( m_pInternalData->m_isPaintCulled )
+    {
+        pD2DDevice->IncreaseFrameStat(DEVICE_FRAMESTAT_CULLVIEW);
+        SAFE_RELEASE(pRenderTarget);
+        return;
+    }
+
+    pD2DDevice->IncreaseFrameStat(DEVICE_FRAMESTAT_PAINTVIEW);
+    m_pInternalData->m_rcPaintBounds = rcBounds;
+
+    // The transform of the target maps the window view coordinates to the target, it is not
+    // identity when the view is recorded into the layer of a cached view.
+    Matrix3x2F targetMatrix = Matrix3x2F::Identity();
+    pRenderTarget->GetTransform(&targetMatrix);
+    pRenderTarget->SetTransform(absoluteMatrix * targetMatrix);
 
     PushClip(pRenderTarget);
     // All drawing operation should be finished in this virtual method.
     OnDrawItem(pRenderTarget);
     PopClip(pRenderTarget);
 
-    // After drawing, set identity matrix to the target.
-    pRenderTarget->SetTransform(Matrix3x2F::Identity());
+    // After drawing, restore the matrix of the target.
+    pRenderTarget->SetTransform(targetMatrix);
 
     // If the window on which view located is NOT layered window, we use paint to drive animation,
     // If the window is layered window, we use animation timer to drive animation.
@@ -224,13 +262,12 @@ void SdkViewElement::Invalidate(BOOL isUpdateNow)
 {
     if (NULL != m_pWindow)
     {
+        // Only the bounds of the view are repainted.
+        AddDirtyBounds();
+
         if (isUpdateNow)
         {
-            m_pWindow->Invalidate(TRUE);
-        }
-        else
-        {
-            m_pWindow->AddWindowState(WINDOW_STATE_INVALIDATE);
+            m_pWindow->Invalidate(FALSE);
         }
     }
 }
@@ -251,6 +288,17 @@ void SdkViewElement::SetLayoutInfo(FLOAT x, FLOAT y, FLOAT width, FLOAT height)
     m_layoutInfo.height = height;
     m_layoutInfo.width  = width;
 
+    if ( fChanged )
+    {
+        InvalidateWorldCache();
+
+        // The view is moved in the layer of its parent.
+        if ( NULL != m_pInternalData->m_pParentView )
+        {
+            m_pInternalData->m_pParentView->InvalidateLayerCache();
+        }
+    }
+
     // Call this method to give notification to sub class.
     OnLayout(fChanged, x, y, width, height);
 }
@@ -454,6 +502,11 @@ void SdkViewElement::SetBkBrush(IN D2DBrush *pBKBrush)
 void SdkViewElement::SetAnimation(SdkAnimation *pAnimation)
 {
     m_pInternalData->m_pAnimation = pAnimation;
+    SyncAnimationMatrix();
+
+    // The hit-test bounds of the animating view are not fixed.
+    InvalidateWorldCache();
+    InvalidateLayerCache();
 }
 
 //////////////////////////////////////////////////////////////////////////
@@ -478,6 +531,8 @@ void SdkViewElement::StartAnimation(DOUBLE dDelaySecond)
 void SdkViewElement::ClearAnimation()
 {
     m_pInternalData->m_pAnimation = NULL;
+    SyncAnimationMatrix();
+    InvalidateWorldCache();
     ForceInvalidate();
 }
 
@@ -486,6 +541,7 @@ void SdkViewElement::ClearAnimation()
 void SdkViewElement::SetParent(SdkViewLayout *pParentView)
 {
     m_pInternalData->m_pParentView = pParentView;
+    InvalidateWorldCache();
 }
 
 //////////////////////////////////////////////////////////////////////////
@@ -707,6 +763,11 @@ void SdkViewElement::SetVisible(BOOL isVisible)
 
     if (curVisible!= isVisible)
     {
+        if ( NULL != m_pInternalData->m_pParentView )
+        {
+            m_pInternalData->m_pParentView->InvalidateLayerCache();
+        }
+
         OnVisibilityChanged(this, isVisible);
     }
 }
@@ -801,6 +862,30 @@ void SdkViewElement::SetRoundCornerRadius(FLOAT fRadiusX, FLOAT fRadiusY)
 
 //////////////////////////////////////////////////////////////////////////
 
+void SdkViewElement::SetLayerCacheEnable(BOOL fEnable)
+{
+    if ( fEnable )
+    {
+        AddFlag(VIEW_STATE_CACHELAYER);
+    }
+    else
+    {
+        RemoveFlag(VIEW_STATE_CACHELAYER);
+        ReleaseLayer();
+    }
+
+    InvalidateLayerCache();
+}
+
+//////////////////////////////////////////////////////////////////////////
+
+BOOL SdkViewElement::IsLayerCacheEnable() const
+{
+    return (VIEW_STATE_CACHELAYER == (GetState() & VIEW_STATE_CACHELAYER));
+}
+
+//////////////////////////////////////////////////////////////////////////
+
 void SdkViewElement::SetBorderWidth(FLOAT fBorderWidth)
 {
     fBorderWidth = (fBorderWidth > MAX_BORDER_WIDTH) ? MAX_BORDER_WIDTH : fBorderWidth;
@@ -1006,10 +1091,19 @@ D2D1_RECT_F SdkViewElement::GetViewRect()
 
 D2D1_RECT_F SdkViewElement::GetDrawingRect()
 {
+    UpdateWorldCache();
+
+    // The animation of the view changes at any time, so only the rectangle without animation
+    // is cached.
+    if ( !IsAnimMatrixEnable() || (NULL == m_pInternalData->m_pAnimation) )
+    {
+        return m_pInternalData->m_drawingRect;
+    }
+
     D2D1_RECT_F drawRc = { 0 };
     GetAbsoluteRect(drawRc);
 
-    Matrix3x2F matTSR = GetAbsoluteMatrix();
+    Matrix3x2F matTSR = m_pInternalData->m_absoluteMatrix;
     Matrix3x2F matAni = GetAnimationMatrix();
     matTSR = matTSR * matAni;
 
@@ -1518,23 +1612,10 @@ void SdkViewElement::GetAbsoluteRect(OUT D2D1_RECT_F& outRc)
 
 void SdkViewElement::GetAbsolutePoint(IN OUT POINT& outPt)
 {
-    SdkViewLayout *pParentView = m_pInternalData->m_pParentView;
+    UpdateWorldCache();
 
-    FLOAT offsetX = 0.0f;
-    FLOAT offsetY = 0.0f;
-
-    while (NULL != pParentView)
-    {
-        FLOAT dx = pParentView->GetLeft();
-        FLOAT dy = pParentView->GetTop();
-        offsetX += dx;
-        offsetY += dy;
-
-        pParentView = pParentView->GetParent();
-    }
-
-    outPt.x += (LONG)offsetX;
-    outPt.y += (LONG)offsetY;
+    outPt.x += (LONG)m_pInternalData->m_absoluteOffset.x;
+    outPt.y += (LONG)m_pInternalData->m_absoluteOffset.y;
 }
 
 //////////////////////////////////////////////////////////////////////////
@@ -1552,28 +1633,123 @@ void SdkViewElement::GetAbsolutePoint(IN OUT D2D1_POINT_2F& outPt)
 
 Matrix3x2F SdkViewElement::GetAbsoluteMatrix()
 {
-    SdkViewLayout *pParentView = m_pInternalData->m_pParentView;
-    Matrix3x2F matrix = m_pInternalData->m_viewMatrix;
+    UpdateWorldCache();
+
+    return m_pInternalData->m_absoluteMatrix;
+}
+
+//////////////////////////////////////////////////////////////////////////
 
-    while (NULL != pParentView)
+void SdkViewElement::InvalidateWorldCache()
+{
+    if (m_pInternalData->m_isWorldValid)
     {
-        Matrix3x2F viewMatrix = pParentView->m_pInternalData->m_viewMatrix;
-        Matrix3x2F animMatrix = Matrix3x2F::Identity();
+        m_pInternalData->m_isWorldValid = FALSE;
 
-        if (pParentView->IsAnimMatrixEnable() && NULL != pParentView->m_pInternalData->m_pAnimation)
+        // The bounds of the view are out of date in the hit-test index of the parent.
+        if (NULL != m_pInternalData->m_pParentView)
         {
-            TRANSFORMINFO info;
-            if (SUCCEEDED(pParentView->m_pInternalData->m_pAnimation->GetTransform(&info)))
-            {
-                animMatrix = *(Matrix3x2F::ReinterpretBaseType(&(info.matrixTransform)));
-            }
+            m_pInternalData->m_pParentView->OnChildWorldChanged(this);
         }
+    }
+}
+
+//////////////////////////////////////////////////////////////////////////
+
+BOOL SdkViewElement::IsWorldCacheValid() const
+{
+    return m_pInternalData->m_isWorldValid;
+}
+
+//////////////////////////////////////////////////////////////////////////
+
+void SdkViewElement::UpdateWorldCache()
+{
+    if (m_pInternalData->m_isWorldValid)
+    {
+        return;
+    }
+
+    SdkViewLayout *pParentView = m_pInternalData->m_pParentView;
+    Matrix3x2F parentMatrix = Matrix3x2F::Identity();
+    D2D1_POINT_2F offset = { 0.0f, 0.0f };
+
+    if (NULL != pParentView)
+    {
+        // The parent is valid after this, so a valid view always has valid parents.
+        pParentView->UpdateWorldCache();
+
+        parentMatrix = pParentView->m_pInternalData->m_chainMatrix;
+        offset.x = pParentView->m_pInternalData->m_absoluteOffset.x + pParentView->GetLeft();
+        offset.y = pParentView->m_pInternalData->m_absoluteOffset.y + pParentView->GetTop();
+    }
+
+    m_pInternalData->m_absoluteOffset = offset;
+    m_pInternalData->m_absoluteMatrix = m_pInternalData->m_viewMatrix * parentMatrix;
+    m_pInternalData->m_chainMatrix    = m_pInternalData->m_viewMatrix * m_pInternalData->m_animMatrix * parentMatrix;
+    m_pInternalData->m_isWorldValid   = TRUE;
+
+    // The bounding box of the transformed rectangle.
+    D2D1_RECT_F drawRc = { 0 };
+    GetAbsoluteRect(drawRc);
+
+    const Matrix3x2F &matrix = m_pInternalData->m_absoluteMatrix;
+    if (!matrix.IsIdentity())
+    {
+        D2D1_POINT_2F leftTopPT     = matrix.TransformPoint(D2D1::Point2F(drawRc.left,  drawRc.top));
+        D2D1_POINT_2F leftBottomPT  = matrix.TransformPoint(D2D1::Point2F(drawRc.left,  drawRc.bottom));
+        D2D1_POINT_2F rightTopPT    = matrix.TransformPoint(D2D1::Point2F(drawRc.right, drawRc.top));
+        D2D1_POINT_2F rightBottomPT = matrix.TransformPoint(D2D1::Point2F(drawRc.right, drawRc.bottom));
 
-        matrix = matrix * viewMatrix * animMatrix;
-        pParentView = pParentView->GetParent();
+        drawRc.left   = MIN(MIN(leftTopPT.x, leftBottomPT.x), MIN(rightTopPT.x, rightBottomPT.x));
+        drawRc.top    = MIN(MIN(leftTopPT.y, leftBottomPT.y), MIN(rightTopPT.y, rightBottomPT.y));
+        drawRc.right  = MAX(MAX(leftTopPT.x, leftBottomPT.x), MAX(rightTopPT.x, rightBottomPT.x));
+        drawRc.bottom = MAX(MAX(leftTopPT.y, leftBottomPT.y), MAX(rightTopPT.y, rightBottomPT.y));
     }
 
-    return matrix;
+    m_pInternalData->m_drawingRect = drawRc;
+}
+
+//////////////////////////////////////////////////////////////////////////
+
+BOOL SdkViewElement::GetHitTestBounds(OUT D2D1_RECT_F& rcBounds)
+{
+    UpdateWorldCache();
+
+    if ( IsAnimMatrixEnable() && (NULL != m_pInternalData->m_pAnimation) )
+    {
+        return FALSE;
+    }
+
+    // The same transform as IsPtInRect, whose offset is truncated.
+    Matrix3x2F matrix = Matrix3x2F::Translation(
+        (FLOAT)(LONG)m_pInternalData->m_absoluteOffset.x,
+        (FLOAT)(LONG)m_pInternalData->m_absoluteOffset.y) * m_pInternalData->m_absoluteMatrix;
+
+    D2D1_POINT_2F leftTopPT     = matrix.TransformPoint(D2D1::Point2F(GetLeft(),  GetTop()));
+    D2D1_POINT_2F leftBottomPT  = matrix.TransformPoint(D2D1::Point2F(GetLeft(),  GetBottom()));
+    D2D1_POINT_2F rightTopPT    = matrix.TransformPoint(D2D1::Point2F(GetRight(), GetTop()));
+    D2D1_POINT_2F rightBottomPT = matrix.TransformPoint(D2D1::Point2F(GetRight(), GetBottom()));
+
+    // One more pixel for the error of the inverted matrix.
+    rcBounds.left   = MIN(MIN(leftTopPT.x, leftBottomPT.x), MIN(rightTopPT.x, rightBottomPT.x)) - 1.0f;
+    rcBounds.top    = MIN(MIN(leftTopPT.y, leftBottomPT.y), MIN(rightTopPT.y, rightBottomPT.y)) - 1.0f;
+    rcBounds.right  = MAX(MAX(leftTopPT.x, leftBottomPT.x), MAX(rightTopPT.x, rightBottomPT.x)) + 1.0f;
+    rcBounds.bottom = MAX(MAX(leftTopPT.y, leftBottomPT.y), MAX(rightTopPT.y, rightBottomPT.y)) + 1.0f;
+
+    return TRUE;
+}
+
+//////////////////////////////////////////////////////////////////////////
+
+void SdkViewElement::SyncAnimationMatrix()
+{
+    Matrix3x2F animMatrix = GetAnimationMatrix();
+    if (0 != memcmp(&animMatrix, &m_pInternalData->m_animMatrix, sizeof(Matrix3x2F)))
+    {
+        m_pInternalData->m_animMatrix = animMatrix;
+        InvalidateWorldCache();
+    }
 }
 
 //////////////////////////////////////////////////////////////////////////
@@ -1650,6 +1826,11 @@ VIEW_STYLE SdkViewElement::GetStyle() const
 void SdkViewElement::AddFlag(VIEW_STATE state)
 {
     m_pInternalData->m_nViewState |= state;
+
+    if (VIEW_STATE_DISABLEANIMMAT & state)
+    {
+        InvalidateWorldCache();
+    }
 }
 
 //////////////////////////////////////////////////////////////////////////
@@ -1657,6 +1838,11 @@ void SdkViewElement::AddFlag(VIEW_STATE state)
 void SdkViewElement::RemoveFlag(VIEW_STATE state)
 {
     m_pInternalData->m_nViewState &= ~state;
+
+    if (VIEW_STATE_DISABLEANIMMAT & state)
+    {
+        InvalidateWorldCache();
+    }
 }
 
 //////////////////////////////////////////////////////////////////////////
@@ -1667,6 +1853,14 @@ void SdkViewElement::CombineTSRMatrix()
     {
         m_pInternalData->m_viewMatrix = GetTSRMatrix();
         m_pInternalData->m_hasTSRMatrix = FALSE;
+
+        // Translate, Scale and Rotate take effect here, so the cache is invalidated here.
+        InvalidateWorldCache();
+
+        if ( NULL != m_pInternalData->m_pParentView )
+        {
+            m_pInternalData->m_pParentView->InvalidateLayerCache();
+        }
     }
 }
 
@@ -1676,9 +1870,263 @@ void SdkViewElement::ForceInvalidate()
 {
     if (NULL != m_pWindow)
     {
-        //m_pWindow->AddWindowState(WINDOW_STATE_INVALIDATE);
-        m_pWindow->Invalidate(TRUE);
+        AddDirtyBounds();
+        m_pWindow->Invalidate(FALSE);
+    }
+}
+
+//////////////////////////////////////////////////////////////////////////
+
+void SdkViewElement::GetPaintBounds(OUT D2D1_RECT_F& rcBounds)
+{
+    CombineTSRMatrix();
+    rcBounds = GetDrawingRect();
+
+    // The border is drawn on the edge, half of it is out of the view.
+    FLOAT fInflate = m_pInternalData->m_fBorderWidth + 1.0f;
+    rcBounds.left   -= fInflate;
+    rcBounds.top    -= fInflate;
+    rcBounds.right  += fInflate;
+    rcBounds.bottom += fInflate;
+}
+
+//////////////////////////////////////////////////////////////////////////
+
+BOOL SdkViewElement::IsPaintCulled() const
+{
+    return m_pInternalData->m_isPaintCulled;
+}
+
+//////////////////////////////////////////////////////////////////////////
+
+void SdkViewElement::AddDirtyBounds()
+{
+    if (NULL == m_pWindow)
+    {
+        return;
+    }
+
+    // The content of the view is changed, so are the layers containing it.
+    InvalidateLayerCache();
+
+    D2D1_RECT_F rcBounds = { 0 };
+    GetPaintBounds(rcBounds);
+
+    // The view may be moved after it is painted.
+    const D2D1_RECT_F &rcOld = m_pInternalData->m_rcPaintBounds;
+    if ( (rcOld.right > rcOld.left) && (rcOld.bottom > rcOld.top) )
+    {
+        m_pWindow->AddDirtyRect(rcOld);
+    }
+
+    m_pWindow->AddDirtyRect(rcBounds);
+}
+
+//////////////////////////////////////////////////////////////////////////
+
+void SdkViewElement::PaintView()
+{
+    D2DDevice *pD2DDevice = (NULL != m_pWindow) ? m_pWindow->GetD2DDevices() : NULL;
+
+    // The animating view is changed in every frame, so it is drawn directly.
+    BOOL isAnimating = IsAnimMatrixEnable() && (NULL != m_pInternalData->m_pAnimation);
+    if ( !IsLayerCacheEnable() || isAnimating || !IsVisible() || (NULL == pD2DDevice) )
+    {
+        OnPaint();
+        return;
+    }
+
+    // The same as OnPaint, the view out of the dirty rectangle being painted is not drawn.
+    D2D1_RECT_F rcBounds = { 0 };
+    GetPaintBounds(rcBounds);
+    m_pInternalData->m_isPaintCulled = !m_pWindow->IsRectDirty(rcBounds);
+    if ( m_pInternalData->m_isPaintCulled )
+    {
+        pD2DDevice->IncreaseFrameStat(DEVICE_FRAMESTAT_CULLVIEW);
+        return;
+    }
+
+    ID2D1RenderTarget *pRenderTarget = NULL;
+    ID2D1RenderTarget *pDeviceTarget = NULL;
+    pD2DDevice->GetRenderTarget(&pRenderTarget);
+    pD2DDevice->GetDeviceRenderTarget(&pDeviceTarget);
+
+    if ( (NULL == pRenderTarget) || (NULL == pDeviceTarget) )
+    {
+        SAFE_RELEASE(pRenderTarget);
+        SAFE_RELEASE(pDeviceTarget);
+        return;
+    }
+
+    // If only the translation of the view is changed, such as its parent is moved, the layer
+    // is drawn at the new place. The offset should be whole DIPs, or the layer is blurred.
+    Matrix3x2F matrix = GetAbsoluteMatrix();
+    const Matrix3x2F &layerMatrix = m_pInternalData->m_layerMatrix;
+    const D2D1_RECT_F &rcLayerBounds = m_pInternalData->m_rcLayerBounds;
+    FLOAT dx = floor(rcBounds.left - rcLayerBounds.left + 0.5f);
+    FLOAT dy = floor(rcBounds.top  - rcLayerBounds.top  + 0.5f);
+
+    BOOL isLayerValid = m_pInternalData->m_isLayerValid &&
+                        (NULL != m_pInternalData->m_pLayerTarget) &&
+                        (pDeviceTarget == m_pInternalData->m_pLayerDevice) &&
+                        (matrix._11 == layerMatrix._11) && (matrix._12 == layerMatrix._12) &&
+                        (matrix._21 == layerMatrix._21) && (matrix._22 == layerMatrix._22) &&
+                        (fabs(rcBounds.left   - rcLayerBounds.left   - dx) < 0.01f) &&
+                        (fabs(rcBounds.top    - rcLayerBounds.top    - dy) < 0.01f) &&
+                        (fabs(rcBounds.right  - rcLayerBounds.right  - dx) < 0.01f) &&
+                        (fabs(rcBounds.bottom - rcLayerBounds.bottom - dy) < 0.01f);
+
+    HRESULT hr = S_OK;
+    if ( !isLayerValid )
+    {
+        dx = 0.0f;
+        dy = 0.0f;
+        hr = RecordLayer(rcBounds);
+    }
+
+    ID2D1Bitmap *pBitmap = NULL;
+    if ( SUCCEEDED(hr) && SUCCEEDED(m_pInternalData->m_pLayerTarget->GetBitmap(&pBitmap)) )
+    {
+        // The transform of the target maps the window view coordinates to the target.
+        const D2D1_RECT_F &rcLayer = m_pInternalData->m_rcLayer;
+        D2D1_SIZE_F size = pBitmap->GetSize();
+        D2D1_RECT_F rcDest = D2D1::RectF(
+            rcLayer.left + dx,
+            rcLayer.top  + dy,
+            rcLayer.left + dx + size.width,
+            rcLayer.top  + dy + size.height);
+
+        pRenderTarget->DrawBitmap(pBitmap, rcDest, 1.0f, D2D1_BITMAP_INTERPOLATION_MODE_NEAREST_NEIGHBOR);
+        pD2DDevice->IncreaseFrameStat(DEVICE_FRAMESTAT_DRAWLAYER);
+        m_pInternalData->m_rcPaintBounds = rcBounds;
     }
+    else
+    {
+        // The layer cannot be created, draw the view directly.
+        OnPaint();
+    }
+
+    SAFE_RELEASE(pBitmap);
+    SAFE_RELEASE(pRenderTarget);
+    SAFE_RELEASE(pDeviceTarget);
+}
+
+//////////////////////////////////////////////////////////////////////////
+
+void SdkViewElement::InvalidateLayerCache()
+{
+    // The view is drawn in the layers of all its parents.
+    for (SdkViewElement *pView = this; NULL != pView; pView = pView->m_pInternalData->m_pParentView)
+    {
+        pView->m_pInternalData->m_isLayerValid = FALSE;
+    }
+}
+
+//////////////////////////////////////////////////////////////////////////
+
+HRESULT SdkViewElement::RecordLayer(IN const D2D1_RECT_F& rcBounds)
+{
+    D2DDevice *pD2DDevice = m_pWindow->GetD2DDevices();
+    ID2D1RenderTarget *pDeviceTarget = NULL;
+    pD2DDevice->GetDeviceRenderTarget(&pDeviceTarget);
+
+    if ( NULL == pDeviceTarget )
+    {
+        return E_FAIL;
+    }
+
+    // The layer is aligned to whole DIPs.
+    D2D1_RECT_F rcLayer = D2D1::RectF(floor(rcBounds.left), floor(rcBounds.top), ceil(rcBounds.right), ceil(rcBounds.bottom));
+    FLOAT fWidth  = MAX(rcLayer.right - rcLayer.left, 1.0f);
+    FLOAT fHeight = MAX(rcLayer.bottom - rcLayer.top, 1.0f);
+    FLOAT dpiX = 96.0f;
+    FLOAT dpiY = 96.0f;
+    pDeviceTarget->GetDpi(&dpiX, &dpiY);
+    D2D1_SIZE_U pixelSize = D2D1::SizeU((UINT32)ceil(fWidth * dpiX / 96.0f), (UINT32)ceil(fHeight * dpiY / 96.0f));
+
+    // The layer is created again when the device is recreated or the size is changed.
+    if ( NULL != m_pInternalData->m_pLayerTarget )
+    {
+        D2D1_SIZE_U layerSize = m_pInternalData->m_pLayerTarget->GetPixelSize();
+        if ( (pDeviceTarget != m_pInternalData->m_pLayerDevice) ||
+             (layerSize.width != pixelSize.width) ||
+             (layerSize.height != pixelSize.height) )
+        {
+            ReleaseLayer();
+        }
+    }
+
+    HRESULT hr = S_OK;
+    if ( NULL == m_pInternalData->m_pLayerTarget )
+    {
+        // The layer is transparent out of the views, so it has the alpha channel even if the
+        // render target of the device does not.
+        hr = pDeviceTarget->CreateCompatibleRenderTarget(
+            D2D1::SizeF(pixelSize.width * 96.0f / dpiX, pixelSize.height * 96.0f / dpiY),
+            pixelSize,
+            D2D1::PixelFormat(DXGI_FORMAT_B8G8R8A8_UNORM, D2D1_ALPHA_MODE_PREMULTIPLIED),
+            D2D1_COMPATIBLE_RENDER_TARGET_OPTIONS_NONE,
+            &(m_pInternalData->m_pLayerTarget));
+
+        if ( SUCCEEDED(hr) )
+        {
+            // ClearType needs an opaque background, which the layer does not have.
+            m_pInternalData->m_pLayerTarget->SetTextAntialiasMode(D2D1_TEXT_ANTIALIAS_MODE_GRAYSCALE);
+            m_pInternalData->m_pLayerDevice = pDeviceTarget;
+            m_pInternalData->m_pLayerDevice->AddRef();
+        }
+    }
+
+    if ( SUCCEEDED(hr) )
+    {
+        ID2D1BitmapRenderTarget *pLayerTarget = m_pInternalData->m_pLayerTarget;
+
+        // Set before recording, so the views invalidated while recording, such as the running
+        // animations, are recorded again next time.
+        m_pInternalData->m_isLayerValid  = TRUE;
+        m_pInternalData->m_rcLayer       = rcLayer;
+        m_pInternalData->m_rcLayerBounds = rcBounds;
+        m_pInternalData->m_layerMatrix   = GetAbsoluteMatrix();
+
+        // The dirty rectangle being painted does not cull the views in the layer.
+        BOOL isPaintingDirty = m_pWindow->m_isPaintingDirty;
+        m_pWindow->m_isPaintingDirty = FALSE;
+
+        pLayerTarget->BeginDraw();
+        pLayerTarget->Clear(D2D1::ColorF(0, 0.0f));
+        pLayerTarget->SetTransform(Matrix3x2F::Translation(-rcLayer.left, -rcLayer.top));
+
+        pD2DDevice->PushLayerTarget(pLayerTarget);
+        OnPaint();
+        pD2DDevice->PopLayerTarget();
+
+        pLayerTarget->SetTransform(Matrix3x2F::Identity());
+        hr = pLayerTarget->EndDraw();
+
+        m_pWindow->m_isPaintingDirty = isPaintingDirty;
+
+        if ( SUCCEEDED(hr) )
+        {
+            pD2DDevice->IncreaseFrameStat(DEVICE_FRAMESTAT_RECORDLAYER);
+        }
+        else
+        {
+            ReleaseLayer();
+        }
+    }
+
+    SAFE_RELEASE(pDeviceTarget);
+
+    return hr;
+}
+
+//////////////////////////////////////////////////////////////////////////
+
+void SdkViewElement::ReleaseLayer()
+{
+    SAFE_RELEASE(m_pInternalData->m_pLayerTarget);
+    SAFE_RELEASE(m_pInternalData->m_pLayerDevice);
+    m_pInternalData->m_isLayerValid = FALSE;
 }
 
 //////////////////////////////////////////////////////////////////////////
@@ -0,0 +1,221 @@
+/*!
+* @file SdkViewGridIndex.cpp
+*
+* @brief This file defines the class SdkViewGridIndex, a uniform grid over the bounds of the
+*        children of a layout, which is used to find the children under a point.
+*
+* Copyright (C) 2011, LZT Corporation.
+*
+* @author Li Hong
+* @date 2011/06/30
+*/
+
+#include "stdafx.h"
+#include "SdkViewGridIndex.h"
+#include <math.h>
+#include <algorithm>
+#include <functional>
+
+USING_NAMESPACE_VIEWS
+
+
+//////////////////////////////////////////////////////////////////////////
+
+SdkViewGridIndex::SdkViewGridIndex() : m_isInvalid(TRUE),
+                                       m_nCols(0),
+                                       m_nRows(0),
+                                       m_fLeft(0.0f),
+                                       m_fTop(0.0f),
+                                       m_fCellWidth(1.0f),
+                                       m_fCellHeight(1.0f)
+{
+}
+
+//////////////////////////////////////////////////////////////////////////
+
+SdkViewGridIndex::~SdkViewGridIndex()
+{
+}
+
+//////////////////////////////////////////////////////////////////////////
+
+void SdkViewGridIndex::Invalidate()
+{
+    m_isInvalid = TRUE;
+    m_vctDirtyItems.clear();
+}
+
+//////////////////////////////////////////////////////////////////////////
+
+void SdkViewGridIndex::InvalidateItem(UINT32 uItem)
+{
+    if ( m_isInvalid || (uItem >= m_vctItems.size()) || m_vctItems[uItem].isDirty )
+    {
+        return;
+    }
+
+    m_vctItems[uItem].isDirty = TRUE;
+    m_vctDirtyItems.push_back(uItem);
+
+    // Setting most of the items one by one is slower than resetting the index.
+    if ( m_vctDirtyItems.size() > m_vctItems.size() / 2 )
+    {
+        Invalidate();
+    }
+}
+
+//////////////////////////////////////////////////////////////////////////
+
+BOOL SdkViewGridIndex::IsInvalid() const
+{
+    return m_isInvalid;
+}
+
+//////////////////////////////////////////////////////////////////////////
+
+void SdkViewGridIndex::TakeDirtyItems(OUT vector<UINT32>& vctItems)
+{
+    vctItems.swap(m_vctDirtyItems);
+    m_vctDirtyItems.clear();
+
+    for (vector<UINT32>::iterator itor = vctItems.begin(); itor != vctItems.end(); ++itor)
+    {
+        m_vctItems[*itor].isDirty = FALSE;
+    }
+}
+
+//////////////////////////////////////////////////////////////////////////
+
+void SdkViewGridIndex::Reset(IN const D2D1_RECT_F& rcExtent, UINT32 uItemCount)
+{
+    FLOAT fWidth  = MAX(rcExtent.right - rcExtent.left, 1.0f);
+    FLOAT fHeight = MAX(rcExtent.bottom - rcExtent.top, 1.0f);
+
+    // The cells are nearly square, there are VIEW_GRID_ITEMS_PER_CELL items in each cell if
+    // the items are spread evenly.
+    FLOAT fCellCount = MAX((FLOAT)uItemCount / VIEW_GRID_ITEMS_PER_CELL, 1.0f);
+    FLOAT fCellSize = sqrt(fWidth * fHeight / fCellCount);
+    m_nCols = MIN(MAX((INT32)(fWidth / fCellSize), 1), VIEW_GRID_MAX_CELLS);
+    m_nRows = MIN(MAX((INT32)(fHeight / fCellSize), 1), VIEW_GRID_MAX_CELLS);
+
+    m_fLeft       = rcExtent.left;
+    m_fTop        = rcExtent.top;
+    m_fCellWidth  = fWidth / m_nCols;
+    m_fCellHeight = fHeight / m_nRows;
+
+    m_vctCells.clear();
+    m_vctCells.resize(m_nCols * m_nRows);
+    m_vctDirtyItems.clear();
+    m_vctFreeItems.clear();
+
+    GRIDITEM item = { { 0 }, FALSE, FALSE, FALSE };
+    m_vctItems.assign(uItemCount, item);
+
+    m_isInvalid = FALSE;
+}
+
+//////////////////////////////////////////////////////////////////////////
+
+void SdkViewGridIndex::SetItem(UINT32 uItem, IN const D2D1_RECT_F *pBounds)
+{
+    if ( m_isInvalid || (uItem >= m_vctItems.size()) )
+    {
+        return;
+    }
+
+    RemoveItem(uItem);
+
+    GRIDITEM &item = m_vctItems[uItem];
+    if ( NULL == pBounds )
+    {
+        item.isFree = TRUE;
+        m_vctFreeItems.push_back(uItem);
+        return;
+    }
+
+    GetCellRange(*pBounds, item.rcCells);
+    item.isInGrid = TRUE;
+
+    for (INT32 row = item.rcCells.top; row <= item.rcCells.bottom; ++row)
+    {
+        for (INT32 col = item.rcCells.left; col <= item.rcCells.right; ++col)
+        {
+            m_vctCells[row * m_nCols + col].push_back(uItem);
+        }
+    }
+}
+
+//////////////////////////////////////////////////////////////////////////
+
+void SdkViewGridIndex::HitTest(FLOAT x, FLOAT y, OUT vector<UINT32>& vctItems) const
+{
+    vctItems.clear();
+
+    if ( m_isInvalid )
+    {
+        return;
+    }
+
+    D2D1_RECT_F rcPoint = { x, y, x, y };
+    RECT rcCell = { 0 };
+    GetCellRange(rcPoint, rcCell);
+
+    const vector<UINT32> &vctCell = m_vctCells[rcCell.top * m_nCols + rcCell.left];
+    vctItems.reserve(vctCell.size() + m_vctFreeItems.size());
+    vctItems.insert(vctItems.end(), vctCell.begin(), vctCell.end());
+    vctItems.insert(vctItems.end(), m_vctFreeItems.begin(), m_vctFreeItems.end());
+
+    // The greater index is on the top of the z order.
+    sort(vctItems.begin(), vctItems.end(), greater<UINT32>());
+}
+
+//////////////////////////////////////////////////////////////////////////
+
+void SdkViewGridIndex::GetCellRange(IN const D2D1_RECT_F& rc, OUT RECT& rcCells) const
+{
+    rcCells.left   = (LONG)floor((rc.left   - m_fLeft) / m_fCellWidth);
+    rcCells.top    = (LONG)floor((rc.top    - m_fTop)  / m_fCellHeight);
+    rcCells.right  = (LONG)floor((rc.right  - m_fLeft) / m_fCellWidth);
+    rcCells.bottom = (LONG)floor((rc.bottom - m_fTop)  / m_fCellHeight);
+
+    // Clamp to the edge cells, so the items and the points out of the grid still meet.
+    rcCells.left   = MIN(MAX(rcCells.left,   0L), (LONG)m_nCols - 1);
+    rcCells.right  = MIN(MAX(rcCells.right,  0L), (LONG)m_nCols - 1);
+    rcCells.top    = MIN(MAX(rcCells.top,    0L), (LONG)m_nRows - 1);
+    rcCells.bottom = MIN(MAX(rcCells.bottom, 0L), (LONG)m_nRows - 1);
+}
+
+//////////////////////////////////////////////////////////////////////////
+
+void SdkViewGridIndex::RemoveItem(UINT32 uItem)
+{
+    GRIDITEM &item = m_vctItems[uItem];
+
+    if ( item.isInGrid )
+    {
+        for (INT32 row = item.rcCells.top; row <= item.rcCells.bottom; ++row)
+        {
+            for (INT32 col = item.rcCells.left; col <= item.rcCells.right; ++col)
+            {
+                vector<UINT32> &vctCell = m_vctCells[row * m_nCols + col];
+                vector<UINT32>::iterator itor = find(vctCell.begin(), vctCell.end(), uItem);
+                if ( itor != vctCell.end() )
+                {
+                    vctCell.erase(itor);
+                }
+            }
+        }
+
+        item.isInGrid = FALSE;
+    }
+    else if ( item.isFree )
+    {
+        vector<UINT32>::iterator itor = find(m_vctFreeItems.begin(), m_vctFreeItems.end(), uItem);
+        if ( itor != m_vctFreeItems.end() )
+        {
+            m_vctFreeItems.erase(itor);
+        }
+
+        item.isFree = FALSE;
+    }
+}
@@ -12,12 +12,13 @@
 #include "stdafx.h"
 #include "SdkViewLayout.h"
 #include "D2DRectUtility.h"
+#include "SdkViewGridIndex.h"
 
 USING_NAMESPACE_VIEWS
 
 //////////////////////////////////////////////////////////////////////////
 
-SdkViewLayout::SdkViewLayout()
+SdkViewLayout::SdkViewLayout() : m_pHitTestIndex(NULL)
 {
     SetClassName(CLASSNAME_VIEWLAYOUT);
 }
@@ -27,6 +28,7 @@ SdkViewLayout::SdkViewLayout()
 SdkViewLayout::~SdkViewLayout()
 {
     RemoveAllChildren(TRUE);
+    SAFE_DELETE(m_pHitTestIndex);
 }
 
 //////////////////////////////////////////////////////////////////////////
@@ -35,7 +37,8 @@ void SdkViewLayout::OnPaint()
 {
     SdkViewElement::OnPaint();
 
-    if ( IsVisible() )
+    // The children are clipped to the layout, so they are culled with it.
+    if ( IsVisible() && !IsPaintCulled() )
     {
         OnDrawChildren();
     }
@@ -53,6 +56,9 @@ void SdkViewLayout::OnDrawChildren()
         return;
     }
 
+    // The children use the animation matrix of this frame.
+    SyncAnimationMatrix();
+
     D2D1_RECT_F layoutRc = GetDrawingRect();
     D2D1_RECT_F intersectRc = { 0.0f };
     BOOL isAlwaysPaintView = (VIEW_STATE_ALWAYSPAINTVIEW == (GetState() & VIEW_STATE_ALWAYSPAINTVIEW));
@@ -76,8 +82,8 @@ void SdkViewLayout::OnDrawChildren()
             continue;
         }
 
-        // Draw child view.
-        pChild->OnPaint();
+        // Draw child view, from its cached layer if it has.
+        pChild->PaintView();
     }
 
     pRenderTarget->PopAxisAlignedClip();
@@ -284,6 +290,9 @@ BOOL SdkViewLayout::RemoveChild(SdkViewElement * pChild, BOOL fToCache)
 
         if ( fToCache )
         {
+            // The cached child keeps this layout as its parent, so it is still invalidated
+            // with this layout, see InvalidateWorldCache.
+            m_vctChildren[nIndex]->InvalidateWorldCache();
             m_vctRemovedChildren.push_back(m_vctChildren[nIndex]);
             m_vctChildren.erase(m_vctChildren.begin() + nIndex);
         }
@@ -319,6 +328,95 @@ BOOL SdkViewLayout::RemoveChildAt(UINT index)
 
 //////////////////////////////////////////////////////////////////////////
 
+void SdkViewLayout::SetHitTestIndexEnable(BOOL fEnable)
+{
+    if ( fEnable )
+    {
+        if ( NULL == m_pHitTestIndex )
+        {
+            m_pHitTestIndex = new SdkViewGridIndex();
+        }
+    }
+    else
+    {
+        SAFE_DELETE(m_pHitTestIndex);
+    }
+}
+
+//////////////////////////////////////////////////////////////////////////
+
+BOOL SdkViewLayout::IsHitTestIndexEnable() const
+{
+    return (NULL != m_pHitTestIndex);
+}
+
+//////////////////////////////////////////////////////////////////////////
+
+void SdkViewLayout::OnChildWorldChanged(SdkViewElement *pChild)
+{
+    if ( (NULL != m_pHitTestIndex) && (NULL != pChild) )
+    {
+        // The index of the child is saved when the hit-test index is reset.
+        m_pHitTestIndex->InvalidateItem((UINT32)pChild->m_pInternalData->m_nViewIndex);
+    }
+}
+
+//////////////////////////////////////////////////////////////////////////
+
+void SdkViewLayout::UpdateHitTestIndex()
+{
+    if ( NULL == m_pHitTestIndex )
+    {
+        return;
+    }
+
+    D2D1_RECT_F rcBounds = { 0 };
+
+    if ( m_pHitTestIndex->IsInvalid() )
+    {
+        // The parent is up to date after this, so its changes invalidate the index again.
+        UpdateWorldCache();
+
+        UINT32 uCount = (UINT32)m_vctChildren.size();
+        vector<D2D1_RECT_F> vctBounds(uCount);
+        vector<BOOL> vctHasBounds(uCount, FALSE);
+        D2D1_RECT_F rcExtent = GetDrawingRect();
+
+        for (UINT32 i = 0; i < uCount; ++i)
+        {
+            SdkViewElement *pChild = m_vctChildren[i];
+            pChild->m_pInternalData->m_nViewIndex = (INT32)i;
+            vctHasBounds[i] = pChild->GetHitTestBounds(vctBounds[i]);
+            if ( vctHasBounds[i] )
+            {
+                rcExtent.left   = MIN(rcExtent.left,   vctBounds[i].left);
+                rcExtent.top    = MIN(rcExtent.top,    vctBounds[i].top);
+                rcExtent.right  = MAX(rcExtent.right,  vctBounds[i].right);
+                rcExtent.bottom = MAX(rcExtent.bottom, vctBounds[i].bottom);
+            }
+        }
+
+        m_pHitTestIndex->Reset(rcExtent, uCount);
+        for (UINT32 i = 0; i < uCount; ++i)
+        {
+            m_pHitTestIndex->SetItem(i, vctHasBounds[i] ? &vctBounds[i] : NULL);
+        }
+    }
+    else
+    {
+        vector<UINT32> vctItems;
+        m_pHitTestIndex->TakeDirtyItems(vctItems);
+
+        for (vector<UINT32>::iterator itor = vctItems.begin(); itor != vctItems.end(); ++itor)
+        {
+            BOOL hasBounds = m_vctChildren[*itor]->GetHitTestBounds(rcBounds);
+            m_pHitTestIndex->SetItem(*itor, hasBounds ? &rcBounds : NULL);
+        }
+    }
+}
+
+//////////////////////////////////////////////////////////////////////////
+
 SdkViewElement* SdkViewLayout::FindEventSource(UINT message, WPARAM wParam, LPARAM lParam)
 {
     if ( !IsEnable() || !IsVisible() )
@@ -331,7 +429,23 @@ SdkViewElement* SdkViewLayout::FindEventSource(UINT message, WPARAM wParam, LPAR
     FLOAT yPos = (FLOAT)GET_Y_LPARAM(lParam);
     BOOL isTouchOn = IsPtInRect(xPos, yPos);
 
-    if ( isTouchOn )
+    if ( isTouchOn && (NULL != m_pHitTestIndex) && (m_vctChildren.size() >= VIEW_GRID_MIN_ITEMS) )
+    {
+        UpdateHitTestIndex();
+
+        // Only the children near the point are tested, from the top to the bottom.
+        vector<UINT32> vctItems;
+        m_pHitTestIndex->HitTest(xPos, yPos, vctItems);
+        for (vector<UINT32>::iterator itor = vctItems.begin(); itor != vctItems.end(); ++itor)
+        {
+            pSource = m_vctChildren[*itor]->FindEventSource(message, wParam, lParam);
+            if ( NULL != pSource )
+            {
+                break;
+            }
+        }
+    }
+    else if ( isTouchOn )
     {
         // Find the event source from end to begin in the vector.
         for (vector<SdkViewElement*>::reverse_iterator itor = m_vctChildren.rbegin();
@@ -412,6 +526,15 @@ void SdkViewLayout::UpdateChildrenState()
 {
     int nSize = (int)m_vctChildren.size();
 
+    // The indices of the children are changed.
+    if ( NULL != m_pHitTestIndex )
+    {
+        m_pHitTestIndex->Invalidate();
+    }
+
+    // The children are added, removed or reordered in the layer.
+    InvalidateLayerCache();
+
     for (int i = 0; i < nSize; ++i)
     {
         // The last child.
@@ -464,6 +587,40 @@ void SdkViewLayout::SetWindow(SdkWindow *pWindow)
 
 //////////////////////////////////////////////////////////////////////////
 
+void SdkViewLayout::InvalidateWorldCache()
+{
+    // The children of a view out of date are out of date too.
+    if ( !IsWorldCacheValid() )
+    {
+        return;
+    }
+
+    SdkViewElement::InvalidateWorldCache();
+
+    // All children are moved with the view.
+    if ( NULL != m_pHitTestIndex )
+    {
+        m_pHitTestIndex->Invalidate();
+    }
+
+    for (vector<SdkViewElement*>::iterator itor = m_vctChildren.begin();
+         itor != m_vctChildren.end();
+         ++itor)
+    {
+        (*itor)->InvalidateWorldCache();
+    }
+
+    // The removed children still walk up to this layout until they are deleted.
+    for (vector<SdkViewElement*>::iterator itor = m_vctRemovedChildren.begin();
+         itor != m_vctRemovedChildren.end();
+         ++itor)
+    {
+        (*itor)->InvalidateWorldCache();
+    }
+}
+
+//////////////////////////////////////////////////////////////////////////
+
 void SdkViewLayout::OnWindowDestroy(SdkWindow *pWindow)
 {
     SdkViewElement::OnWindowDestroy(pWindow);
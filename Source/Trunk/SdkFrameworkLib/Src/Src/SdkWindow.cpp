@@ -16,6 +16,7 @@
 #include "D2DDevice.h"
 #include "D3DDevice.h"
 #include "SdkCommonInclude.h"
+#include <math.h>
 
 USING_NAMESPACE_D2D
 USING_NAMESPACE_D3D
@@ -49,10 +50,12 @@ SdkWindow::SdkWindow() : m_hWnd(NULL),
                          m_pD3DDevice(NULL),
                          m_fOpacity(1.0f),
                          m_dwBkColor(RGB(255, 255, 255)),
-                         m_nWindowState(WINDOW_STATE_NONE)
+                         m_nWindowState(WINDOW_STATE_NONE),
+                         m_isPaintingDirty(FALSE)
 {
     s_vctWindows.push_back(this);
     ZeroMemory(&WindowViews, sizeof(WINDOWVIEWS));
+    ZeroMemory(&m_rcPaintingDirty, sizeof(D2D1_RECT_F));
 
     m_pRootView = new SdkViewLayout();
     m_pRootView->SetParent(NULL);
@@ -213,13 +216,9 @@ void SdkWindow::GetDesktopDpi(FLOAT *pdpiX, FLOAT *pdpiY)
 {
     if (NULL != m_pD2DDevice)
     {
-        FLOAT dpiX = 1.0f;
-        FLOAT dpiY = 1.0f;
-
-        m_pD2DDevice->GetDesktopDpi(&dpiX, &dpiY);
-
         // The DPI on X and Y always return 1.0, because D3D interfaces don't support DPI change.
-        // and D2D interfaces has considered the DPI changed.
+        // and D2D interfaces has considered the DPI changed. So the desktop DPI is not queried,
+        // this function is called for every view when painting and hit-testing.
         if (NULL != pdpiX)
         {
             *pdpiX = 1.0f; //dpiX / 96.0f;
@@ -238,22 +237,49 @@ void SdkWindow::Invalidate(BOOL isErase, const LPRECT lprcPaint)
 {
     if (isErase)
     {
-        ::InvalidateRect(m_hWnd, NULL, TRUE);
+        ::InvalidateRect(m_hWnd, lprcPaint, TRUE);
         // Here can not call UpdateWindow function, it may lead some issue when play animation.
     }
     else
     {
         if (m_nWindowState & WINDOW_STATE_INVALIDATE)
         {
-            ::InvalidateRect(m_hWnd, NULL, TRUE);
+            if (m_vctDirtyRects.empty())
+            {
+                ::InvalidateRect(m_hWnd, NULL, TRUE);
+            }
+            else
+            {
+                // Only the dirty rectangles are invalidated, the system merges them into
+                // the update region, WM_PAINT repaints the rectangles of the region.
+                for (vector<RECT>::iterator itor = m_vctDirtyRects.begin();
+                     itor != m_vctDirtyRects.end(); ++itor)
+                {
+                    ::InvalidateRect(m_hWnd, &(*itor), FALSE);
+                }
+            }
         }
     }
 
+    m_vctDirtyRects.clear();
     RemoveWindowState(WINDOW_STATE_INVALIDATE);
 }
 
 //////////////////////////////////////////////////////////////////////////
 
+BOOL SdkWindow::IsRectDirty(IN const D2D1_RECT_F& rcView) const
+{
+    if (!m_isPaintingDirty)
+    {
+        return TRUE;
+    }
+
+    return (rcView.left < m_rcPaintingDirty.right && rcView.right > m_rcPaintingDirty.left &&
+            rcView.top < m_rcPaintingDirty.bottom && rcView.bottom > m_rcPaintingDirty.top);
+}
+
+//////////////////////////////////////////////////////////////////////////
+
 void SdkWindow::CenterWindow(BOOL fInScreen)
 {
     if (::IsWindow(m_hWnd))
@@ -376,3 +402,147 @@ void SdkWindow::AddEventViews(SdkViewElement *pView)
 
     // Not implements
 }
+
+//////////////////////////////////////////////////////////////////////////
+
+void SdkWindow::AddDirtyRect(IN const D2D1_RECT_F& rcView)
+{
+    RECT rcDirty = { 0 };
+    RECT rcClient = { 0 };
+    ViewToClientRect(rcView, rcDirty);
+    ::GetClientRect(m_hWnd, &rcClient);
+
+    // The rectangle out of the window is not repainted.
+    if (::IntersectRect(&rcDirty, &rcDirty, &rcClient))
+    {
+        MergeDirtyRect(m_vctDirtyRects, rcDirty);
+        AddWindowState(WINDOW_STATE_INVALIDATE);
+    }
+}
+
+//////////////////////////////////////////////////////////////////////////
+
+void SdkWindow::PaintDirtyRects(IN const vector<RECT>& vctRects)
+{
+    if ( (NULL == m_pD2DDevice) || (NULL == m_pRootView) )
+    {
+        return;
+    }
+
+    m_isPaintingDirty = TRUE;
+
+    for (vector<RECT>::const_iterator itor = vctRects.begin(); itor != vctRects.end(); ++itor)
+    {
+        ClientToViewRect(*itor, m_rcPaintingDirty);
+
+        // The views out of the rectangle are culled by IsRectDirty, the drawing of
+        // the others are clipped to the rectangle.
+        m_pD2DDevice->PushDirtyRect(m_rcPaintingDirty);
+        m_pRootView->OnPaint();
+        m_pD2DDevice->PopDirtyRect();
+    }
+
+    m_isPaintingDirty = FALSE;
+}
+
+//////////////////////////////////////////////////////////////////////////
+
+void SdkWindow::ViewToClientRect(IN const D2D1_RECT_F& rcView, OUT RECT& rcClient)
+{
+    FLOAT dpiX = 96.0f;
+    FLOAT dpiY = 96.0f;
+    if (NULL != m_pD2DDevice)
+    {
+        m_pD2DDevice->GetDesktopDpi(&dpiX, &dpiY);
+    }
+
+    // The views are drawn in DIPs, the anti-aliased edges touch one more pixel.
+    rcClient.left   = (LONG)floor(rcView.left * dpiX / 96.0f) - 1;
+    rcClient.top    = (LONG)floor(rcView.top * dpiY / 96.0f) - 1;
+    rcClient.right  = (LONG)ceil(rcView.right * dpiX / 96.0f) + 1;
+    rcClient.bottom = (LONG)ceil(rcView.bottom * dpiY / 96.0f) + 1;
+}
+
+//////////////////////////////////////////////////////////////////////////
+
+void SdkWindow::ClientToViewRect(IN const RECT& rcClient, OUT D2D1_RECT_F& rcView)
+{
+    FLOAT dpiX = 96.0f;
+    FLOAT dpiY = 96.0f;
+    if (NULL != m_pD2DDevice)
+    {
+        m_pD2DDevice->GetDesktopDpi(&dpiX, &dpiY);
+    }
+
+    rcView.left     = (FLOAT)rcClient.left * 96.0f / dpiX;
+    rcView.top      = (FLOAT)rcClient.top * 96.0f / dpiY;
+    rcView.right    = (FLOAT)rcClient.right * 96.0f / dpiX;
+    rcView.bottom   = (FLOAT)rcClient.bottom * 96.0f / dpiY;
+}
+
+//////////////////////////////////////////////////////////////////////////
+
+void SdkWindow::MergeDirtyRect(IN OUT vector<RECT>& vctRects, IN const RECT& rc)
+{
+    if (::IsRectEmpty(&rc))
+    {
+        return;
+    }
+
+    RECT rcUnion = { 0 };
+    for (vector<RECT>::iterator itor = vctRects.begin(); itor != vctRects.end(); )
+    {
+        ::UnionRect(&rcUnion, &(*itor), &rc);
+        if (::EqualRect(&rcUnion, &(*itor)))
+        {
+            // The rectangle is covered by an existing one.
+            return;
+        }
+
+        if (::EqualRect(&rcUnion, &rc))
+        {
+            itor = vctRects.erase(itor);
+        }
+        else
+        {
+            ++itor;
+        }
+    }
+
+    vctRects.push_back(rc);
+
+    while (vctRects.size() > MAX_DIRTY_RECT_COUNT)
+    {
+        // Merge the pair whose union adds the least area.
+        size_t nFirst = 0;
+        size_t nSecond = 1;
+        LONGLONG llMinGrowth = -1;
+        for (size_t i = 0; i < vctRects.size(); ++i)
+        {
+            for (size_t j = i + 1; j < vctRects.size(); ++j)
+            {
+                const RECT &rc1 = vctRects[i];
+                const RECT &rc2 = vctRects[j];
+                ::UnionRect(&rcUnion, &rc1, &rc2);
+
+                LONGLONG llGrowth =
+                    (LONGLONG)(rcUnion.right - rcUnion.left) * (rcUnion.bottom - rcUnion.top) -
+                    (LONGLONG)(rc1.right - rc1.left) * (rc1.bottom - rc1.top) -
+                    (LONGLONG)(rc2.right - rc2.left) * (rc2.bottom - rc2.top);
+                if ( (llMinGrowth < 0) || (llGrowth < llMinGrowth) )
+                {
+                    llMinGrowth = (llGrowth > 0) ? llGrowth : 0;
+                    nFirst = i;
+                    nSecond = j;
+                }
+            }
+        }
+
+        ::UnionRect(&rcUnion, &vctRects[nFirst], &vctRects[nSecond]);
+        vctRects.erase(vctRects.begin() + nSecond);
+        vctRects.erase(vctRects.begin() + nFirst);
+
+        // The union may cover the other rectangles, merge it again.
+        MergeDirtyRect(vctRects, rcUnion);
+    }
+}
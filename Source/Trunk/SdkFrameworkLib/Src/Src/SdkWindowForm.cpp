@@ -159,6 +159,9 @@ void SdkWindowForm::Invalidate(BOOL isErase, const LPRECT lprcPaint)
                 OnDrawUI(FALSE, lprcPaint);
             }
         }
+
+        // The layered window is updated as a whole.
+        m_vctDirtyRects.clear();
     }
     else
     {
@@ -420,14 +423,35 @@ void SdkWindowForm::OnHwndPaint(HDC hdc, const LPRECT rcPaint)
     {
         m_pD2DDevice->SetPaintTargetType(DEVICE_TARGET_TYPE_HWND);
         m_pD2DDevice->SetOpacity(m_fOpacity);
-        m_pD2DDevice->BeginDraw(hdc, NULL);
+
+        // Only the update region is repainted if the last frame is kept by the render target.
+        BOOL isPartialPaint = !m_vctPaintRects.empty() && m_pD2DDevice->IsContentRetained();
+        m_pD2DDevice->BeginDraw(hdc, NULL, !isPartialPaint);
 
         if ( NULL != m_pRootView )
         {
-            m_pRootView->OnPaint();
+            if (isPartialPaint)
+            {
+                PaintDirtyRects(m_vctPaintRects);
+            }
+            else
+            {
+                m_pRootView->OnPaint();
+            }
         }
 
         m_pD2DDevice->EndDraw();
+
+        // The views invalidated while painting, such as the animations, are painted in the next frame.
+        if (m_nWindowState & WINDOW_STATE_INVALIDATE)
+        {
+            Invalidate();
+        }
+    }
+    else if ( NULL != m_pD2DDevice )
+    {
+        // The frame is skipped, the next frame should be painted as a whole.
+        m_pD2DDevice->DiscardContent();
     }
 }
 
@@ -721,6 +745,9 @@ BOOL SdkWindowForm::OnWndProc(HWND hWnd, UINT message, WPARAM wParam, LPARAM lPa
     {
     case WM_PAINT:
         {
+            // The update region is validated by BeginPaint, so get its rectangles first.
+            GetUpdateRects(hWnd, m_vctPaintRects);
+
             PAINTSTRUCT ps;
             BeginPaint(hWnd, &ps);
             OnPaint(ps.hdc, &ps.rcPaint);
@@ -798,3 +825,49 @@ LRESULT CALLBACK SdkWindowForm::WndProc(HWND hWnd, UINT message, WPARAM wParam,
 
     return DefWindowProc(hWnd, message, wParam, lParam);
 }
+
+//////////////////////////////////////////////////////////////////////////
+
+void SdkWindowForm::GetUpdateRects(HWND hWnd, OUT vector<RECT>& vctRects)
+{
+    vctRects.clear();
+
+    HRGN hRgn = ::CreateRectRgn(0, 0, 0, 0);
+    if (NULL == hRgn)
+    {
+        return;
+    }
+
+    int nRgnType = ::GetUpdateRgn(hWnd, hRgn, FALSE);
+    if ( (SIMPLEREGION == nRgnType) || (COMPLEXREGION == nRgnType) )
+    {
+        DWORD dwSize = ::GetRegionData(hRgn, 0, NULL);
+        vector<BYTE> vctData(dwSize);
+        LPRGNDATA lpRgnData = (dwSize > 0) ? (LPRGNDATA)&vctData[0] : NULL;
+
+        if ( (NULL != lpRgnData) && (dwSize == ::GetRegionData(hRgn, dwSize, lpRgnData)) )
+        {
+            LPRECT lpRects = (LPRECT)lpRgnData->Buffer;
+            for (DWORD i = 0; i < lpRgnData->rdh.nCount; ++i)
+            {
+                MergeDirtyRect(vctRects, lpRects[i]);
+            }
+        }
+    }
+
+    ::DeleteObject(hRgn);
+
+    // Painting the whole client once is cheaper than clipping it.
+    RECT rcClient = { 0 };
+    ::GetClientRect(hWnd, &rcClient);
+    for (vector<RECT>::iterator itor = vctRects.begin(); itor != vctRects.end(); ++itor)
+    {
+        RECT rcCovered = { 0 };
+        ::UnionRect(&rcCovered, &(*itor), &rcClient);
+        if (::EqualRect(&rcCovered, &(*itor)))
+        {
+            vctRects.clear();
+            break;
+        }
+    }
+}
@@ -146,6 +146,11 @@
 //
 #define IDB_ICON_UAC_SHIELD             670
 
+//
+// The manifest of the images which are loaded at startup
+//
+#define IDR_PRELOAD_IMAGES              700
+
 
 // Next default values for new objects
 // 
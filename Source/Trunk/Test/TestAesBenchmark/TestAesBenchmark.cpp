@@ -0,0 +1,395 @@
+// TestAesBenchmark.cpp : Benchmark of the portable AES backend against the number of threads.
+//
+// The portable backend does not use Windows, so the benchmark also runs headless on Linux:
+//
+//   g++ -O2 -pthread -I Test/TestAesBenchmark -I SdkCommonLib/Src/Include -o aesbench
+//       Test/TestAesBenchmark/TestAesBenchmark.cpp SdkCommonLib/Src/Src/SdkAesCipher.cpp
+//       SdkCommonLib/Src/Src/SdkAesGcm.cpp
+//   ./aesbench [-n repeat] [-m megabytes] [-t threads]
+//
+// The data is split into chunks of 1 MB as the chunked container of SdkCryptFile does. Every
+// chunk has its own IV, so the threads crypt the chunks independently. The CBC and GCM modes
+// run with the AES instructions and with the constant-time software, on 1, 2, 4, ... threads
+// up to the processor count or the count of -t. The known answers of FIPS-197 and the GCM
+// specification are checked first, and every run is decrypted and compared with the data.
+//
+
+#include "stdafx.h"
+#include "SdkAesGcm.h"
+
+using namespace std;
+USING_NAMESPACE_COMMON
+
+#define AESBENCH_CHUNK_SIZE     (1024 * 1024)   // The plain size of a chunk, the same as CRYPT_CHUNK_SIZE.
+#define AESBENCH_MAX_THREADS    64              // The max number of threads, the calling thread is one of them.
+
+typedef struct _AESBENCHJOB
+{
+    SdkAesCipher   *pCipher;            // The CBC cipher, NULL for the GCM mode.
+    SdkAesGcm      *pAeadCipher;        // The GCM cipher, NULL for the CBC mode.
+    BYTE           *pbData;             // The data, crypted in place.
+    BYTE           *pbTags;             // The GCM tags, AES_GCM_TAG_SIZE bytes for each chunk.
+    UINT32          uChunkCount;        // The number of chunks.
+    BOOL            isEncrypt;          // Encrypt or decrypt.
+
+} AESBENCHJOB;
+
+typedef struct _AESBENCHWORKER
+{
+    const AESBENCHJOB  *lpJob;          // The shared job.
+    UINT32              uFirstChunk;    // The first chunk of the worker.
+    UINT32              uStep;          // The worker takes every uStep-th chunk.
+    BOOL                isSucceed;      // All GCM tags of the worker are valid.
+
+} AESBENCHWORKER;
+
+
+//////////////////////////////////////////////////////////////////////////
+
+static double GetSeconds()
+{
+#ifdef _WIN32
+    LARGE_INTEGER liFrequency, liCounter;
+    QueryPerformanceFrequency(&liFrequency);
+    QueryPerformanceCounter(&liCounter);
+    return (double)liCounter.QuadPart / liFrequency.QuadPart;
+#else
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+#endif // _WIN32
+}
+
+//////////////////////////////////////////////////////////////////////////
+
+static UINT32 GetProcessorCount()
+{
+#ifdef _WIN32
+    SYSTEM_INFO sinf;
+    GetSystemInfo(&sinf);
+    return (UINT32)sinf.dwNumberOfProcessors;
+#else
+    long nCount = sysconf(_SC_NPROCESSORS_ONLN);
+    return (nCount > 0) ? (UINT32)nCount : 1;
+#endif // _WIN32
+}
+
+//////////////////////////////////////////////////////////////////////////
+
+static void CryptChunks(AESBENCHWORKER *lpWorker)
+{
+    const AESBENCHJOB *lpJob = lpWorker->lpJob;
+
+    // The CBC chain is the state of the cipher, so every worker has its own copy.
+    SdkAesCipher *pCipher = NULL;
+    if (NULL != lpJob->pCipher)
+    {
+        pCipher = static_cast<SdkAesCipher*>(lpJob->pCipher->Clone());
+    }
+
+    lpWorker->isSucceed = TRUE;
+    for (UINT32 i = lpWorker->uFirstChunk; i < lpJob->uChunkCount; i += lpWorker->uStep)
+    {
+        // The IV is the chunk index, it is never reused with the same key.
+        BYTE cbIV[AES_BLOCK_SIZE] = { 0 };
+        for (int j = 0; j < 4; ++j)
+        {
+            cbIV[j] = (BYTE)(i >> (j * 8));
+        }
+
+        BYTE *pbChunk = lpJob->pbData + (size_t)i * AESBENCH_CHUNK_SIZE;
+        if (NULL != pCipher)
+        {
+            pCipher->SetIV(cbIV);
+            if (lpJob->isEncrypt)
+            {
+                pCipher->EncryptBlocksCBC(pbChunk, AESBENCH_CHUNK_SIZE / AES_BLOCK_SIZE);
+            }
+            else
+            {
+                pCipher->DecryptBlocksCBC(pbChunk, AESBENCH_CHUNK_SIZE / AES_BLOCK_SIZE);
+            }
+        }
+        else
+        {
+            BYTE *pbTag = lpJob->pbTags + (size_t)i * AES_GCM_TAG_SIZE;
+            BOOL isSucceed = lpJob->isEncrypt ?
+                lpJob->pAeadCipher->Seal(cbIV, NULL, 0, pbChunk, AESBENCH_CHUNK_SIZE, pbTag) :
+                lpJob->pAeadCipher->Open(cbIV, NULL, 0, pbChunk, AESBENCH_CHUNK_SIZE, pbTag);
+            lpWorker->isSucceed = lpWorker->isSucceed && isSucceed;
+        }
+    }
+
+    SAFE_DELETE(pCipher);
+}
+
+//////////////////////////////////////////////////////////////////////////
+
+#ifdef _WIN32
+static DWORD WINAPI AesBenchThreadProc(LPVOID lpParameter)
+{
+    CryptChunks((AESBENCHWORKER*)lpParameter);
+    return 0;
+}
+#else
+static void* AesBenchThreadProc(void *lpParameter)
+{
+    CryptChunks((AESBENCHWORKER*)lpParameter);
+    return NULL;
+}
+#endif // _WIN32
+
+//////////////////////////////////////////////////////////////////////////
+
+static BOOL RunJob(const AESBENCHJOB &job, UINT32 uThreadCount)
+{
+    vector<AESBENCHWORKER> vctWorkers(uThreadCount);
+    for (UINT32 i = 0; i < uThreadCount; ++i)
+    {
+        vctWorkers[i].lpJob       = &job;
+        vctWorkers[i].uFirstChunk = i;
+        vctWorkers[i].uStep       = uThreadCount;
+        vctWorkers[i].isSucceed   = FALSE;
+    }
+
+    // The first worker runs on this thread, a worker whose thread can not be created too.
+#ifdef _WIN32
+    vector<HANDLE> vctThreads;
+    for (UINT32 i = 1; i < uThreadCount; ++i)
+    {
+        HANDLE hThread = CreateThread(NULL, 0, AesBenchThreadProc, &vctWorkers[i], 0, NULL);
+        if (NULL != hThread)
+        {
+            vctThreads.push_back(hThread);
+        }
+        else
+        {
+            CryptChunks(&vctWorkers[i]);
+        }
+    }
+
+    CryptChunks(&vctWorkers[0]);
+
+    if (!vctThreads.empty())
+    {
+        WaitForMultipleObjects((DWORD)vctThreads.size(), &vctThreads[0], TRUE, INFINITE);
+    }
+
+    for (size_t i = 0; i < vctThreads.size(); ++i)
+    {
+        CloseHandle(vctThreads[i]);
+    }
+#else
+    vector<pthread_t> vctThreads;
+    for (UINT32 i = 1; i < uThreadCount; ++i)
+    {
+        pthread_t thread;
+        if (0 == pthread_create(&thread, NULL, AesBenchThreadProc, &vctWorkers[i]))
+        {
+            vctThreads.push_back(thread);
+        }
+        else
+        {
+            CryptChunks(&vctWorkers[i]);
+        }
+    }
+
+    CryptChunks(&vctWorkers[0]);
+
+    for (size_t i = 0; i < vctThreads.size(); ++i)
+    {
+        pthread_join(vctThreads[i], NULL);
+    }
+#endif // _WIN32
+
+    BOOL isSucceed = TRUE;
+    for (UINT32 i = 0; i < uThreadCount; ++i)
+    {
+        isSucceed = isSucceed && vctWorkers[i].isSucceed;
+    }
+
+    return isSucceed;
+}
+
+//////////////////////////////////////////////////////////////////////////
+
+static BOOL CheckKnownAnswers(BOOL isUseHardware)
+{
+    // FIPS-197 appendix C.1 and C.3, AES-128 and AES-256 on the same plain text.
+    const BYTE cbKey[32] =
+    {
+        0x00, 0x01, 0x02, 0x03, 0x04, 0x05, 0x06, 0x07, 0x08, 0x09, 0x0A, 0x0B, 0x0C, 0x0D, 0x0E, 0x0F,
+        0x10, 0x11, 0x12, 0x13, 0x14, 0x15, 0x16, 0x17, 0x18, 0x19, 0x1A, 0x1B, 0x1C, 0x1D, 0x1E, 0x1F,
+    };
+    const BYTE cbPlain[AES_BLOCK_SIZE] =
+    {
+        0x00, 0x11, 0x22, 0x33, 0x44, 0x55, 0x66, 0x77, 0x88, 0x99, 0xAA, 0xBB, 0xCC, 0xDD, 0xEE, 0xFF,
+    };
+    const BYTE cbCipher128[AES_BLOCK_SIZE] =
+    {
+        0x69, 0xC4, 0xE0, 0xD8, 0x6A, 0x7B, 0x04, 0x30, 0xD8, 0xCD, 0xB7, 0x80, 0x70, 0xB4, 0xC5, 0x5A,
+    };
+    const BYTE cbCipher256[AES_BLOCK_SIZE] =
+    {
+        0x8E, 0xA2, 0xB7, 0xCA, 0x51, 0x67, 0x45, 0xBF, 0xEA, 0xFC, 0x49, 0x90, 0x4B, 0x49, 0x60, 0x89,
+    };
+
+    BOOL isOK = TRUE;
+    const BYTE *pbExpected[2] = { cbCipher128, cbCipher256 };
+    for (int i = 0; i < 2; ++i)
+    {
+        SdkAesCipher aesCipher(cbKey, (0 == i) ? 16 : 32, isUseHardware);
+
+        // One CBC block with a zero IV is the same as ECB, it is decrypted back.
+        const BYTE cbZeroIV[AES_BLOCK_SIZE] = { 0 };
+        BYTE cbBlock[AES_BLOCK_SIZE] = { 0 };
+        memcpy(cbBlock, cbPlain, AES_BLOCK_SIZE);
+        aesCipher.SetIV(cbZeroIV);
+        aesCipher.EncryptBlocksCBC(cbBlock, 1);
+        isOK = isOK && aesCipher.IsValid() && (0 == memcmp(cbBlock, pbExpected[i], AES_BLOCK_SIZE));
+
+        aesCipher.SetIV(cbZeroIV);
+        aesCipher.DecryptBlocksCBC(cbBlock, 1);
+        isOK = isOK && (0 == memcmp(cbBlock, cbPlain, AES_BLOCK_SIZE));
+    }
+
+    // The test case 2 of the GCM specification, the key, the IV and the plain text are zero.
+    const BYTE cbGcmCipher[AES_BLOCK_SIZE] =
+    {
+        0x03, 0x88, 0xDA, 0xCE, 0x60, 0xB6, 0xA3, 0x92, 0xF3, 0x28, 0xC2, 0xB9, 0x71, 0xB2, 0xFE, 0x78,
+    };
+    const BYTE cbGcmTag[AES_GCM_TAG_SIZE] =
+    {
+        0xAB, 0x6E, 0x47, 0xD4, 0x2C, 0xEC, 0x13, 0xBD, 0xF5, 0x3A, 0x67, 0xB2, 0x12, 0x57, 0xBD, 0xDF,
+    };
+
+    const BYTE cbZero[AES_BLOCK_SIZE] = { 0 };
+    BYTE cbData[AES_BLOCK_SIZE] = { 0 };
+    BYTE cbTag[AES_GCM_TAG_SIZE] = { 0 };
+    SdkAesGcm aeadCipher(cbZero, 16, isUseHardware);
+    isOK = isOK && aeadCipher.IsValid() && aeadCipher.Seal(cbZero, NULL, 0, cbData, AES_BLOCK_SIZE, cbTag);
+    isOK = isOK && (0 == memcmp(cbData, cbGcmCipher, AES_BLOCK_SIZE)) && (0 == memcmp(cbTag, cbGcmTag, AES_GCM_TAG_SIZE));
+    isOK = isOK && aeadCipher.Open(cbZero, NULL, 0, cbData, AES_BLOCK_SIZE, cbTag) && (0 == memcmp(cbData, cbZero, AES_BLOCK_SIZE));
+
+    // A changed tag is refused.
+    cbTag[0] ^= 0x01;
+    isOK = isOK && !aeadCipher.Open(cbZero, NULL, 0, cbData, AES_BLOCK_SIZE, cbTag);
+
+    return isOK;
+}
+
+//////////////////////////////////////////////////////////////////////////
+
+int main(int argc, char* argv[])
+{
+    int nRepeat = 2;
+    UINT32 uMegabytes = 16;
+    UINT32 uMaxThreads = GetProcessorCount();
+    for (int i = 1; i < argc; ++i)
+    {
+        if ( (0 == strcmp(argv[i], "-n")) && (i + 1 < argc) )
+        {
+            nRepeat = atoi(argv[++i]);
+            nRepeat = (nRepeat > 0) ? nRepeat : 1;
+        }
+        else if ( (0 == strcmp(argv[i], "-m")) && (i + 1 < argc) )
+        {
+            int nMegabytes = atoi(argv[++i]);
+            uMegabytes = (nMegabytes > 0) ? (UINT32)nMegabytes : 1;
+        }
+        else if ( (0 == strcmp(argv[i], "-t")) && (i + 1 < argc) )
+        {
+            int nThreads = atoi(argv[++i]);
+            uMaxThreads = (nThreads > 0) ? (UINT32)nThreads : 1;
+        }
+    }
+
+    BOOL isHardware = SdkAesCipher::IsHardwareSupported();
+    int nFailCount = 0;
+    nFailCount += CheckKnownAnswers(FALSE) ? 0 : 1;
+    if (isHardware)
+    {
+        nFailCount += CheckKnownAnswers(TRUE) ? 0 : 1;
+    }
+
+    // 1, 2, 4, ... threads and the max count.
+    uMaxThreads = MIN(uMaxThreads, (UINT32)AESBENCH_MAX_THREADS);
+    vector<UINT32> vctThreadCounts;
+    for (UINT32 uCount = 1; uCount < uMaxThreads; uCount *= 2)
+    {
+        vctThreadCounts.push_back(uCount);
+    }
+    vctThreadCounts.push_back(uMaxThreads);
+
+    size_t nDataSize = (size_t)uMegabytes * AESBENCH_CHUNK_SIZE;
+    vector<BYTE> vctPlain(nDataSize);
+    UINT32 uSeed = 0x2011061F;
+    for (size_t i = 0; i < nDataSize; ++i)
+    {
+        uSeed = uSeed * 1103515245 + 12345;
+        vctPlain[i] = (BYTE)(uSeed >> 16);
+    }
+
+    BYTE cbKey[32] = { 0 };
+    for (int i = 0; i < 32; ++i)
+    {
+        uSeed = uSeed * 1103515245 + 12345;
+        cbKey[i] = (BYTE)(uSeed >> 16);
+    }
+
+    vector<BYTE> vctData(vctPlain);
+    vector<BYTE> vctTags((size_t)uMegabytes * AES_GCM_TAG_SIZE);
+
+    printf("AES benchmark, data = %u MB, chunk = 1 MB, processors = %u, AES instructions = %s, repeat = %d\n",
+        uMegabytes, GetProcessorCount(), isHardware ? "yes" : "no", nRepeat);
+    printf("%-24s %8s %14s %14s %6s\n", "mode", "threads", "encrypt MB/s", "decrypt MB/s", "check");
+
+    const char *pszModeNames[] = { "CBC, AES instructions", "GCM, AES instructions", "CBC, software", "GCM, software" };
+    for (int nMode = 0; nMode < 4; ++nMode)
+    {
+        BOOL isUseHardware = (nMode < 2);
+        if (isUseHardware && !isHardware)
+        {
+            continue;
+        }
+
+        SdkAesCipher aesCipher(cbKey, sizeof(cbKey), isUseHardware);
+        SdkAesGcm aeadCipher(cbKey, sizeof(cbKey), isUseHardware);
+        BOOL isGcm = (1 == nMode % 2);
+
+        AESBENCHJOB job = { 0 };
+        job.pCipher     = isGcm ? NULL : &aesCipher;
+        job.pAeadCipher = isGcm ? &aeadCipher : NULL;
+        job.pbData      = &vctData[0];
+        job.pbTags      = &vctTags[0];
+        job.uChunkCount = uMegabytes;
+
+        for (size_t i = 0; i < vctThreadCounts.size(); ++i)
+        {
+            // Every encryption is decrypted before the next one, the tags are of the last one.
+            BOOL isOK = TRUE;
+            double seconds[2] = { 0 };
+            for (int n = 0; n < nRepeat; ++n)
+            {
+                for (int nOp = 0; nOp < 2; ++nOp)
+                {
+                    job.isEncrypt = (0 == nOp);
+                    double dBegin = GetSeconds();
+                    isOK = RunJob(job, vctThreadCounts[i]) && isOK;
+                    seconds[nOp] += GetSeconds() - dBegin;
+                }
+
+                isOK = isOK && (vctData == vctPlain);
+            }
+
+            nFailCount += isOK ? 0 : 1;
+            double dMegabytes = (double)uMegabytes * nRepeat;
+            printf("%-24s %8u %14.1f %14.1f %6s\n", pszModeNames[nMode], vctThreadCounts[i],
+                dMegabytes / seconds[0], dMegabytes / seconds[1], isOK ? "OK" : "FAILED");
+        }
+    }
+
+    printf("%s\n", (0 == nFailCount) ? "all checks passed" : "some checks FAILED");
+
+    return (0 == nFailCount) ? 0 : 1;
+}
@@ -0,0 +1,21 @@
+// stdafx.h : include file for standard system include files,
+// or project specific include files that are used frequently, but
+// are changed infrequently
+//
+
+#pragma once
+
+#ifdef _WIN32
+#include <windows.h>
+#include <tchar.h>
+#else
+#include <time.h>
+#include <pthread.h>
+#include <unistd.h>
+#endif // _WIN32
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <string>
+#include <vector>
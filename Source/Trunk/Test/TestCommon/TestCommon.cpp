@@ -3,12 +3,16 @@
 
 #include "stdafx.h"
 #include "SdkCommonInclude.h"
+#include "SdkResManager.h"
+#include "..\..\SdkResourceLib\Resources\Resource.h"
 #include <stdio.h>
 #include <windows.h> 
 #include <lm.h>
 #include <iostream>
+#include <algorithm>
 
 using namespace std;
+USING_NAMESPACE_THEME
 
 #pragma comment(lib, "Netapi32.lib")
 
@@ -390,6 +394,2066 @@ void ChangePosition()
 }
 
 
+//////////////////////////////////////////////////////////////////////////
+
+BOOL IsSameFile(LPCTSTR lpFilePath1, LPCTSTR lpFilePath2)
+{
+    FILE *pFile1 = NULL;
+    FILE *pFile2 = NULL;
+    _tfopen_s(&pFile1, lpFilePath1, _T("rb"));
+    _tfopen_s(&pFile2, lpFilePath2, _T("rb"));
+
+    BOOL isSame = (NULL != pFile1) && (NULL != pFile2);
+    static BYTE s_buffer1[64 * 1024];
+    static BYTE s_buffer2[64 * 1024];
+    while (isSame)
+    {
+        size_t nRead1 = fread(s_buffer1, 1, sizeof(s_buffer1), pFile1);
+        size_t nRead2 = fread(s_buffer2, 1, sizeof(s_buffer2), pFile2);
+        isSame = (nRead1 == nRead2) && (0 == memcmp(s_buffer1, s_buffer2, nRead1));
+        if (0 == nRead1)
+        {
+            break;
+        }
+    }
+
+    if (NULL != pFile1) fclose(pFile1);
+    if (NULL != pFile2) fclose(pFile2);
+
+    return isSame;
+}
+
+//////////////////////////////////////////////////////////////////////////
+
+void TestParallelCryptFile()
+{
+    const DWORD dwFileSizeMB = 256;
+
+    TCHAR szTempPath[MAX_PATH] = { 0 };
+    TCHAR szSrcPath[MAX_PATH]  = { 0 };
+    TCHAR szWorkPath[MAX_PATH] = { 0 };
+    TCHAR szKeyPath[MAX_PATH]  = { 0 };
+    GetTempPath(MAX_PATH, szTempPath);
+    _stprintf_s(szSrcPath,  MAX_PATH, _T("%sTestParallelCrypt.src"), szTempPath);
+    _stprintf_s(szWorkPath, MAX_PATH, _T("%sTestParallelCrypt.dat"), szTempPath);
+    _stprintf_s(szKeyPath,  MAX_PATH, _T("%sTestParallelCrypt.key"), szTempPath);
+
+    // Create the source file with pseudo random data, the last chunk is not full.
+    FILE *pFile = NULL;
+    _tfopen_s(&pFile, szSrcPath, _T("wb"));
+    if (NULL == pFile)
+    {
+        return;
+    }
+
+    BYTE *pbData = new BYTE[1024 * 1024];
+    UINT32 nSeed = 0x12345678;
+    for (DWORD i = 0; i < dwFileSizeMB; ++i)
+    {
+        for (DWORD j = 0; j < 1024 * 1024; ++j)
+        {
+            nSeed = nSeed * 1103515245 + 12345;
+            pbData[j] = (BYTE)(nSeed >> 16);
+        }
+        fwrite(pbData, 1, 1024 * 1024, pFile);
+    }
+    fwrite(pbData, 1, 12345, pFile);
+    fclose(pFile);
+    SAFE_DELETE_ARRAY(pbData);
+
+    SYSTEM_INFO sinf;
+    GetSystemInfo(&sinf);
+
+    LARGE_INTEGER liFrequency;
+    QueryPerformanceFrequency(&liFrequency);
+
+    printf("Parallel crypt, file size = %u MB, processors = %u\n", dwFileSizeMB, sinf.dwNumberOfProcessors);
+    printf("threads    encrypt MB/s    decrypt MB/s    verify\n");
+
+    // Thread count 0 is the classic serial mode.
+    for (UINT32 nThreads = 0; nThreads <= sinf.dwNumberOfProcessors; nThreads = (0 == nThreads) ? 1 : nThreads * 2)
+    {
+        CopyFile(szSrcPath, szWorkPath, FALSE);
+
+        vector<CryptString> vctFiles;
+        vctFiles.push_back(szWorkPath);
+        DOUBLE dSeconds[2] = { 0 };
+
+        for (int nPass = 0; nPass < 2; ++nPass)
+        {
+            SdkCryptFile cryptFile(FALSE);
+            cryptFile.SetCryptKeyPath(szKeyPath);
+            cryptFile.SetCryptPassword(_T("password"));
+            cryptFile.SetParallelCrypt(nThreads > 0, nThreads);
+
+            if (1 == nPass)
+            {
+                vctFiles[0] = CryptString(szWorkPath) + _T(".tofp");
+            }
+            cryptFile.SetCryptFiles(vctFiles, TRUE);
+
+            LARGE_INTEGER liBegin, liEnd;
+            QueryPerformanceCounter(&liBegin);
+            cryptFile.BeginCrypt((0 == nPass) ? CRYPT_OP_ENCRYPT : CRYPT_OP_DECRYPT);
+            QueryPerformanceCounter(&liEnd);
+
+            dSeconds[nPass] = (DOUBLE)(liEnd.QuadPart - liBegin.QuadPart) / liFrequency.QuadPart;
+        }
+
+        printf("%7u    %12.1f    %12.1f    %s\n",
+            nThreads,
+            dwFileSizeMB / dSeconds[0],
+            dwFileSizeMB / dSeconds[1],
+            IsSameFile(szSrcPath, szWorkPath) ? "OK" : "FAILED");
+
+        DeleteFile(szWorkPath);
+    }
+
+    DeleteFile(szSrcPath);
+    DeleteFile(szKeyPath);
+}
+
+//////////////////////////////////////////////////////////////////////////
+
+void TestCryptBackend()
+{
+    const CRYPT_BACKEND_TYPE backendTypes[] =
+    {
+        CRYPT_BACKEND_CRYPTOAPI,
+        CRYPT_BACKEND_PORTABLE,
+        CRYPT_BACKEND_PORTABLE_SOFTWARE,
+    };
+    const DWORD dwBufferSizes[] = { 4 * 1024, 64 * 1024, 1024 * 1024 };
+    const DWORD dwTotalSize = 64 * 1024 * 1024;
+
+    LARGE_INTEGER liFrequency;
+    QueryPerformanceFrequency(&liFrequency);
+
+    // The reference output of CryptoAPI, other backends must produce the same bytes.
+    const DWORD dwCheckSize = 1000;
+    DWORD dwCheckBufSize = dwCheckSize;
+    SdkCrypt refCrypt;
+    refCrypt.InitializeScene();
+    refCrypt.GetCheckedCbSize(&dwCheckBufSize, TRUE);
+
+    BYTE *pbRef = new BYTE[dwCheckBufSize];
+    BYTE *pbCheck = new BYTE[dwCheckBufSize];
+    for (DWORD i = 0; i < dwCheckBufSize; ++i)
+    {
+        pbRef[i] = (BYTE)(i * 31 + 7);
+    }
+    memcpy_s(pbCheck, dwCheckBufSize, pbRef, dwCheckBufSize);
+    refCrypt.SetBackendType(CRYPT_BACKEND_CRYPTOAPI);
+    refCrypt.EncryptStream(pbRef, dwCheckBufSize, TRUE);
+
+    printf("backend                       buffer        MB/s    identical\n");
+
+    for (int i = 0; i < ARRAYSIZE(backendTypes); ++i)
+    {
+        SdkCrypt crypt;
+        crypt.InitializeScene();
+        if (CRYPT_ERROR_SUCCEED != crypt.SetBackendType(backendTypes[i]))
+        {
+            printf("backend %d is not available\n", backendTypes[i]);
+            continue;
+        }
+
+        BYTE *pbData = new BYTE[dwCheckBufSize];
+        memcpy_s(pbData, dwCheckBufSize, pbCheck, dwCheckBufSize);
+        crypt.EncryptStream(pbData, dwCheckBufSize, TRUE);
+        BOOL isIdentical = (0 == memcmp(pbData, pbRef, dwCheckBufSize));
+        SAFE_DELETE_ARRAY(pbData);
+
+        for (int j = 0; j < ARRAYSIZE(dwBufferSizes); ++j)
+        {
+            DWORD dwBufferSize = dwBufferSizes[j];
+            DWORD dwLoops = dwTotalSize / dwBufferSize;
+
+            // The software backend is slow, a shorter run is enough.
+            if (CRYPT_BACKEND_PORTABLE_SOFTWARE == backendTypes[i])
+            {
+                dwLoops = MAX(dwLoops / 16, 1);
+            }
+
+            pbData = new BYTE[dwBufferSize];
+            ZeroMemory(pbData, dwBufferSize);
+
+            LARGE_INTEGER liBegin, liEnd;
+            QueryPerformanceCounter(&liBegin);
+            for (DWORD k = 0; k < dwLoops; ++k)
+            {
+                crypt.EncryptStream(pbData, dwBufferSize, FALSE);
+            }
+            QueryPerformanceCounter(&liEnd);
+            SAFE_DELETE_ARRAY(pbData);
+
+            DOUBLE dSeconds = (DOUBLE)(liEnd.QuadPart - liBegin.QuadPart) / liFrequency.QuadPart;
+            DOUBLE dMBytes = (DOUBLE)dwLoops * dwBufferSize / (1024 * 1024);
+
+            wprintf(L"%-28s %7u KB %11.1f    %s\n",
+                crypt.GetBackendName(),
+                dwBufferSize / 1024,
+                dMBytes / dSeconds,
+                isIdentical ? L"YES" : L"NO");
+        }
+    }
+
+    SAFE_DELETE_ARRAY(pbRef);
+    SAFE_DELETE_ARRAY(pbCheck);
+}
+
+//////////////////////////////////////////////////////////////////////////
+
+void TestAuthenticatedCryptFile()
+{
+    TCHAR szTempPath[MAX_PATH] = { 0 };
+    TCHAR szSrcPath[MAX_PATH]  = { 0 };
+    TCHAR szWorkPath[MAX_PATH] = { 0 };
+    TCHAR szKeyPath[MAX_PATH]  = { 0 };
+    GetTempPath(MAX_PATH, szTempPath);
+    _stprintf_s(szSrcPath,  MAX_PATH, _T("%sTestAuthCrypt.src"), szTempPath);
+    _stprintf_s(szWorkPath, MAX_PATH, _T("%sTestAuthCrypt.dat"), szTempPath);
+    _stprintf_s(szKeyPath,  MAX_PATH, _T("%sTestAuthCrypt.key"), szTempPath);
+
+    // The file must be big enough to use the chunked container.
+    FILE *pFile = NULL;
+    _tfopen_s(&pFile, szSrcPath, _T("wb"));
+    if (NULL == pFile)
+    {
+        return;
+    }
+
+    BYTE *pbData = new BYTE[1024 * 1024];
+    UINT32 nSeed = 0x87654321;
+    for (DWORD i = 0; i < 32; ++i)
+    {
+        for (DWORD j = 0; j < 1024 * 1024; ++j)
+        {
+            nSeed = nSeed * 1103515245 + 12345;
+            pbData[j] = (BYTE)(nSeed >> 16);
+        }
+        fwrite(pbData, 1, 1024 * 1024, pFile);
+    }
+    fwrite(pbData, 1, 777, pFile);
+    fclose(pFile);
+    SAFE_DELETE_ARRAY(pbData);
+
+    CryptString strCryptPath = CryptString(szWorkPath) + _T(".tofp");
+
+    // The header is a CBC stream, flipping a bit of one cipher block garbles the block and
+    // flips the same bit of the next one. Both blocks are in the tail of the file name after
+    // its terminator, so the header still parses and only the tags can find the change.
+    const long lNameOffset = (long)(sizeof(DWORD) + 2 * MAX_PATH * sizeof(TCHAR));
+    const long lHeaderOffset = (lNameOffset + 3 * MAX_PATH * sizeof(TCHAR) / 4) & ~15L;
+
+    // Pass 0 flips one byte of a chunk in the middle, pass 1 flips one byte of the header,
+    // pass 2 is intact.
+    for (int nPass = 0; nPass < 3; ++nPass)
+    {
+        CopyFile(szSrcPath, szWorkPath, FALSE);
+
+        vector<CryptString> vctFiles;
+        vctFiles.push_back(szWorkPath);
+
+        SdkCryptFile encryptFile(FALSE);
+        encryptFile.SetCryptKeyPath(szKeyPath);
+        encryptFile.SetCryptPassword(_T("password"));
+        encryptFile.SetAuthenticatedCrypt(TRUE);
+        encryptFile.SetCryptFiles(vctFiles, TRUE);
+        encryptFile.BeginCrypt(CRYPT_OP_ENCRYPT);
+
+        if (nPass < 2)
+        {
+            _tfopen_s(&pFile, strCryptPath.c_str(), _T("r+b"));
+            if (NULL != pFile)
+            {
+                __int64 nOffset = (0 == nPass) ? 20 * 1024 * 1024 : lHeaderOffset;
+                BYTE bValue = 0;
+                _fseeki64(pFile, nOffset, SEEK_SET);
+                fread(&bValue, 1, 1, pFile);
+                bValue ^= 0x01;
+                _fseeki64(pFile, nOffset, SEEK_SET);
+                fwrite(&bValue, 1, 1, pFile);
+                fclose(pFile);
+            }
+        }
+
+        vctFiles[0] = strCryptPath;
+
+        SdkCryptFile decryptFile(FALSE);
+        decryptFile.SetCryptKeyPath(szKeyPath);
+        decryptFile.SetCryptPassword(_T("password"));
+        decryptFile.SetCryptFiles(vctFiles, TRUE);
+        decryptFile.BeginCrypt(CRYPT_OP_DECRYPT);
+
+        BOOL hasOutput = (INVALID_FILE_ATTRIBUTES != GetFileAttributes(szWorkPath));
+        if (0 == nPass)
+        {
+            printf("Modified file:  %s\n", hasOutput ? "FAILED, output is written" : "OK, rejected");
+        }
+        else if (1 == nPass)
+        {
+            printf("Modified header: %s\n", hasOutput ? "FAILED, output is written" : "OK, rejected");
+        }
+        else
+        {
+            printf("Intact file:    %s\n", (hasOutput && IsSameFile(szSrcPath, szWorkPath)) ? "OK" : "FAILED");
+        }
+
+        DeleteFile(szWorkPath);
+        DeleteFile(strCryptPath.c_str());
+    }
+
+    DeleteFile(szSrcPath);
+    DeleteFile(szKeyPath);
+}
+
+//////////////////////////////////////////////////////////////////////////
+
+void TestCryptFileReader()
+{
+    TCHAR szTempPath[MAX_PATH] = { 0 };
+    TCHAR szSrcPath[MAX_PATH]  = { 0 };
+    TCHAR szWorkPath[MAX_PATH] = { 0 };
+    TCHAR szKeyPath[MAX_PATH]  = { 0 };
+    GetTempPath(MAX_PATH, szTempPath);
+    _stprintf_s(szSrcPath,  MAX_PATH, _T("%sTestCryptReader.src"), szTempPath);
+    _stprintf_s(szWorkPath, MAX_PATH, _T("%sTestCryptReader.dat"), szTempPath);
+    _stprintf_s(szKeyPath,  MAX_PATH, _T("%sTestCryptReader.key"), szTempPath);
+
+    const DWORD dwFileSize = 64 * 1024 * 1024 + 4321;
+    BYTE *pbSource = new BYTE[dwFileSize];
+    UINT32 nSeed = 0x2468ACE0;
+    for (DWORD i = 0; i < dwFileSize; ++i)
+    {
+        nSeed = nSeed * 1103515245 + 12345;
+        pbSource[i] = (BYTE)(nSeed >> 16);
+    }
+
+    FILE *pFile = NULL;
+    _tfopen_s(&pFile, szSrcPath, _T("wb"));
+    if (NULL == pFile)
+    {
+        SAFE_DELETE_ARRAY(pbSource);
+        return;
+    }
+    fwrite(pbSource, 1, dwFileSize, pFile);
+    fclose(pFile);
+
+    CryptString strCryptPath = CryptString(szWorkPath) + _T(".tofp");
+
+    for (int nPass = 0; nPass < 2; ++nPass)
+    {
+        CopyFile(szSrcPath, szWorkPath, FALSE);
+
+        vector<CryptString> vctFiles;
+        vctFiles.push_back(szWorkPath);
+
+        SdkCryptFile encryptFile(FALSE);
+        encryptFile.SetCryptKeyPath(szKeyPath);
+        encryptFile.SetCryptPassword(_T("password"));
+        encryptFile.SetParallelCrypt(0 == nPass);
+        encryptFile.SetAuthenticatedCrypt(1 == nPass);
+        encryptFile.SetCryptFiles(vctFiles, TRUE);
+        encryptFile.BeginCrypt(CRYPT_OP_ENCRYPT);
+
+        SdkCryptFile cryptFile(FALSE);
+        cryptFile.SetCryptKeyPath(szKeyPath);
+        cryptFile.SetCryptPassword(_T("password"));
+
+        SdkCryptFileReader *pReader = NULL;
+        if (CRYPT_ERROR_SUCCEED != cryptFile.OpenReader(strCryptPath.c_str(), &pReader))
+        {
+            printf("%s: OpenReader FAILED\n", (0 == nPass) ? "CBC chunks" : "GCM chunks");
+            DeleteFile(strCryptPath.c_str());
+            continue;
+        }
+
+        LARGE_INTEGER liFrequency, liBegin, liEnd;
+        QueryPerformanceFrequency(&liFrequency);
+
+        // Random ranges, some of them cross the chunk boundary or the end of file.
+        const DWORD dwMaxRead = 256 * 1024;
+        BYTE *pbRead = new BYTE[dwMaxRead];
+        BOOL isSame = (dwFileSize == pReader->GetLength());
+        const int nReadCount = 2000;
+
+        QueryPerformanceCounter(&liBegin);
+        for (int i = 0; (i < nReadCount) && isSame; ++i)
+        {
+            nSeed = nSeed * 1103515245 + 12345;
+            UINT64 nOffset = (nSeed >> 4) % (dwFileSize + 1024);
+            nSeed = nSeed * 1103515245 + 12345;
+            DWORD dwLength = (nSeed >> 8) % dwMaxRead;
+
+            DWORD dwBytesRead = 0;
+            if (CRYPT_ERROR_SUCCEED != pReader->Read(nOffset, pbRead, dwLength, &dwBytesRead))
+            {
+                isSame = FALSE;
+                break;
+            }
+
+            DWORD dwExpected = (nOffset >= dwFileSize) ? 0 : (DWORD)MIN((UINT64)dwLength, dwFileSize - nOffset);
+            isSame = (dwExpected == dwBytesRead) &&
+                     ((0 == dwBytesRead) || (0 == memcmp(pbRead, pbSource + nOffset, dwBytesRead)));
+        }
+        QueryPerformanceCounter(&liEnd);
+
+        DOUBLE dSeconds = (DOUBLE)(liEnd.QuadPart - liBegin.QuadPart) / liFrequency.QuadPart;
+        printf("%s: %d random reads, %.1f ms, %s\n",
+            (0 == nPass) ? "CBC chunks" : "GCM chunks",
+            nReadCount,
+            dSeconds * 1000,
+            isSame ? "OK" : "FAILED");
+
+        SAFE_DELETE_ARRAY(pbRead);
+        SAFE_DELETE(pReader);
+        DeleteFile(strCryptPath.c_str());
+    }
+
+    SAFE_DELETE_ARRAY(pbSource);
+    DeleteFile(szSrcPath);
+    DeleteFile(szKeyPath);
+}
+
+//////////////////////////////////////////////////////////////////////////
+
+void TestInPlaceCryptFile()
+{
+    const DWORD dwFileSizeMB = 128;
+
+    TCHAR szTempPath[MAX_PATH] = { 0 };
+    TCHAR szSrcPath[MAX_PATH]  = { 0 };
+    TCHAR szWorkPath[MAX_PATH] = { 0 };
+    TCHAR szKeyPath[MAX_PATH]  = { 0 };
+    GetTempPath(MAX_PATH, szTempPath);
+    _stprintf_s(szSrcPath,  MAX_PATH, _T("%sTestInPlaceCrypt.src"), szTempPath);
+    _stprintf_s(szWorkPath, MAX_PATH, _T("%sTestInPlaceCrypt.dat"), szTempPath);
+    _stprintf_s(szKeyPath,  MAX_PATH, _T("%sTestInPlaceCrypt.key"), szTempPath);
+
+    // The last window is not full and its size is not the multiple of the block size.
+    FILE *pFile = NULL;
+    _tfopen_s(&pFile, szSrcPath, _T("wb"));
+    if (NULL == pFile)
+    {
+        return;
+    }
+
+    BYTE *pbData = new BYTE[1024 * 1024];
+    UINT32 nSeed = 0x13579BDF;
+    for (DWORD i = 0; i < dwFileSizeMB; ++i)
+    {
+        for (DWORD j = 0; j < 1024 * 1024; ++j)
+        {
+            nSeed = nSeed * 1103515245 + 12345;
+            pbData[j] = (BYTE)(nSeed >> 16);
+        }
+        fwrite(pbData, 1, 1024 * 1024, pFile);
+    }
+    fwrite(pbData, 1, 70001, pFile);
+    fclose(pFile);
+    SAFE_DELETE_ARRAY(pbData);
+
+    LARGE_INTEGER liFrequency;
+    QueryPerformanceFrequency(&liFrequency);
+
+    CryptString strCryptPath = CryptString(szWorkPath) + _T(".tofp");
+
+    printf("mode        encrypt MB/s    decrypt    verify\n");
+
+    // Pass 0 is the copy mode, pass 1 is the in-place mode, the encrypted files are the same format.
+    for (int nPass = 0; nPass < 2; ++nPass)
+    {
+        CopyFile(szSrcPath, szWorkPath, FALSE);
+
+        vector<CryptString> vctFiles;
+        vctFiles.push_back(szWorkPath);
+
+        SdkCryptFile encryptFile(FALSE);
+        encryptFile.SetCryptKeyPath(szKeyPath);
+        encryptFile.SetCryptPassword(_T("password"));
+        encryptFile.SetInPlaceCrypt(1 == nPass);
+        encryptFile.SetCryptFiles(vctFiles, TRUE);
+
+        LARGE_INTEGER liBegin, liEnd;
+        QueryPerformanceCounter(&liBegin);
+        encryptFile.BeginCrypt(CRYPT_OP_ENCRYPT);
+        QueryPerformanceCounter(&liEnd);
+
+        DOUBLE dSeconds = (DOUBLE)(liEnd.QuadPart - liBegin.QuadPart) / liFrequency.QuadPart;
+        BOOL isRenamed = (INVALID_FILE_ATTRIBUTES == GetFileAttributes(szWorkPath)) &&
+                         (INVALID_FILE_ATTRIBUTES != GetFileAttributes(strCryptPath.c_str()));
+
+        vctFiles[0] = strCryptPath;
+
+        SdkCryptFile decryptFile(FALSE);
+        decryptFile.SetCryptKeyPath(szKeyPath);
+        decryptFile.SetCryptPassword(_T("password"));
+        decryptFile.SetCryptFiles(vctFiles, TRUE);
+        CRYPT_RESULT nResult = decryptFile.BeginCrypt(CRYPT_OP_DECRYPT);
+
+        printf("%-8s %15.1f    %7s    %s\n",
+            (0 == nPass) ? "copy" : "in-place",
+            dwFileSizeMB / dSeconds,
+            (CRYPT_ERROR_SUCCEED == nResult) ? "OK" : "FAILED",
+            (isRenamed && IsSameFile(szSrcPath, szWorkPath)) ? "OK" : "FAILED");
+
+        DeleteFile(szWorkPath);
+        DeleteFile(strCryptPath.c_str());
+    }
+
+    // A journal which does not match the file fails it in the copy mode, the original file
+    // which is kept must not be changed.
+    CryptString strJournalPath = CryptString(szWorkPath) + _T(".tofpj");
+    CopyFile(szSrcPath, szWorkPath, FALSE);
+    _tfopen_s(&pFile, strJournalPath.c_str(), _T("wb"));
+    if (NULL != pFile)
+    {
+        fwrite("stale journal", 1, 13, pFile);
+        fclose(pFile);
+    }
+
+    vector<CryptString> vctFiles;
+    vctFiles.push_back(szWorkPath);
+
+    SdkCryptFile encryptFile(FALSE);
+    encryptFile.SetCryptKeyPath(szKeyPath);
+    encryptFile.SetCryptPassword(_T("password"));
+    encryptFile.SetCryptFiles(vctFiles, FALSE);
+    encryptFile.BeginCrypt(CRYPT_OP_ENCRYPT);
+
+    BOOL isKept = IsSameFile(szSrcPath, szWorkPath) &&
+                  (INVALID_FILE_ATTRIBUTES == GetFileAttributes(strCryptPath.c_str())) &&
+                  (INVALID_FILE_ATTRIBUTES != GetFileAttributes(strJournalPath.c_str()));
+    printf("stale journal, original kept: %s\n", isKept ? "OK" : "FAILED");
+
+    DeleteFile(szWorkPath);
+    DeleteFile(strCryptPath.c_str());
+    DeleteFile(strJournalPath.c_str());
+    DeleteFile(szSrcPath);
+    DeleteFile(szKeyPath);
+}
+
+//////////////////////////////////////////////////////////////////////////
+
+void TestAsyncIOCryptFile()
+{
+    const DWORD dwFileCount = 1000;
+
+    TCHAR szTempPath[MAX_PATH] = { 0 };
+    TCHAR szKeyPath[MAX_PATH]  = { 0 };
+    GetTempPath(MAX_PATH, szTempPath);
+    _stprintf_s(szKeyPath, MAX_PATH, _T("%sTestAsyncIOCrypt.key"), szTempPath);
+
+    // The small files from 0 bytes to about 2 MB, some sizes are not the multiple of the block size.
+    vector<CryptString> vctSrcFiles;
+    vector<CryptString> vctWorkFiles;
+    DWORD dwTotalSize = 0;
+    BYTE *pbData = new BYTE[2 * 1024 * 1024 + 100];
+    UINT32 nSeed = 0x2468ACE0;
+    for (DWORD i = 0; i < dwFileCount; ++i)
+    {
+        TCHAR szFilePath[MAX_PATH] = { 0 };
+        _stprintf_s(szFilePath, MAX_PATH, _T("%sTestAsyncIOCrypt%u.src"), szTempPath, i);
+
+        nSeed = nSeed * 1103515245 + 12345;
+        DWORD dwFileSize = (0 == i % 10) ? ((i / 10) % 33) * 64 * 1024 + (i % 3) : (nSeed >> 8) % (2 * 1024 * 1024);
+        for (DWORD j = 0; j < dwFileSize; ++j)
+        {
+            nSeed = nSeed * 1103515245 + 12345;
+            pbData[j] = (BYTE)(nSeed >> 16);
+        }
+
+        FILE *pFile = NULL;
+        _tfopen_s(&pFile, szFilePath, _T("wb"));
+        if (NULL != pFile)
+        {
+            fwrite(pbData, 1, dwFileSize, pFile);
+            fclose(pFile);
+        }
+
+        dwTotalSize += dwFileSize;
+        vctSrcFiles.push_back(szFilePath);
+        _stprintf_s(szFilePath, MAX_PATH, _T("%sTestAsyncIOCrypt%u.dat"), szTempPath, i);
+        vctWorkFiles.push_back(szFilePath);
+    }
+    SAFE_DELETE_ARRAY(pbData);
+
+    LARGE_INTEGER liFrequency;
+    QueryPerformanceFrequency(&liFrequency);
+
+    DOUBLE dTotalMB = (DOUBLE)dwTotalSize / (1024 * 1024);
+    printf("Small files = %u, total size = %.1f MB\n", dwFileCount, dTotalMB);
+    printf("mode     encrypt MB/s    decrypt MB/s    same output    verify\n");
+
+    // Pass 0 is the synchronous mode, its encrypted files are kept to compare with pass 1.
+    for (int nPass = 0; nPass < 2; ++nPass)
+    {
+        for (DWORD i = 0; i < dwFileCount; ++i)
+        {
+            CopyFile(vctSrcFiles[i].c_str(), vctWorkFiles[i].c_str(), FALSE);
+        }
+
+        vector<CryptString> vctCryptFiles;
+        for each (const CryptString& strWorkFile in vctWorkFiles)
+        {
+            vctCryptFiles.push_back(strWorkFile + _T(".tofp"));
+        }
+
+        DOUBLE dSeconds[2] = { 0 };
+        LARGE_INTEGER liBegin, liEnd;
+
+        SdkCryptFile encryptFile(FALSE);
+        encryptFile.SetCryptKeyPath(szKeyPath);
+        encryptFile.SetCryptPassword(_T("password"));
+        encryptFile.SetAsyncIO(1 == nPass);
+        encryptFile.SetCryptFiles(vctWorkFiles, TRUE);
+
+        QueryPerformanceCounter(&liBegin);
+        encryptFile.BeginCrypt(CRYPT_OP_ENCRYPT);
+        QueryPerformanceCounter(&liEnd);
+        dSeconds[0] = (DOUBLE)(liEnd.QuadPart - liBegin.QuadPart) / liFrequency.QuadPart;
+
+        BOOL isSameOutput = TRUE;
+        for (DWORD i = 0; i < dwFileCount; ++i)
+        {
+            CryptString strSyncFile = vctCryptFiles[i] + _T(".sync");
+            if (0 == nPass)
+            {
+                CopyFile(vctCryptFiles[i].c_str(), strSyncFile.c_str(), FALSE);
+            }
+            else
+            {
+                isSameOutput = isSameOutput && IsSameFile(vctCryptFiles[i].c_str(), strSyncFile.c_str());
+                DeleteFile(strSyncFile.c_str());
+            }
+        }
+
+        SdkCryptFile decryptFile(FALSE);
+        decryptFile.SetCryptKeyPath(szKeyPath);
+        decryptFile.SetCryptPassword(_T("password"));
+        decryptFile.SetAsyncIO(1 == nPass);
+        decryptFile.SetCryptFiles(vctCryptFiles, TRUE);
+
+        QueryPerformanceCounter(&liBegin);
+        decryptFile.BeginCrypt(CRYPT_OP_DECRYPT);
+        QueryPerformanceCounter(&liEnd);
+        dSeconds[1] = (DOUBLE)(liEnd.QuadPart - liBegin.QuadPart) / liFrequency.QuadPart;
+
+        BOOL isVerified = TRUE;
+        for (DWORD i = 0; i < dwFileCount; ++i)
+        {
+            isVerified = isVerified && IsSameFile(vctSrcFiles[i].c_str(), vctWorkFiles[i].c_str());
+            DeleteFile(vctWorkFiles[i].c_str());
+        }
+
+        printf("%-5s %15.1f %15.1f    %11s    %s\n",
+            (0 == nPass) ? "sync" : "async",
+            dTotalMB / dSeconds[0],
+            dTotalMB / dSeconds[1],
+            (0 == nPass) ? "-" : (isSameOutput ? "OK" : "FAILED"),
+            isVerified ? "OK" : "FAILED");
+    }
+
+    for each (const CryptString& strSrcFile in vctSrcFiles)
+    {
+        DeleteFile(strSrcFile.c_str());
+    }
+    DeleteFile(szKeyPath);
+}
+
+//////////////////////////////////////////////////////////////////////////
+
+class BatchCryptSink : public ICryptFileNotify
+{
+public:
+
+    DWORD   dwNextCount;
+    DWORD   dwErrorCount;
+    DWORD   dwLastProgress;
+    DWORD   dwReplaceCount;
+    DWORD   dwThreadId;
+    BOOL    isSameThread;
+
+    BatchCryptSink() : dwNextCount(0), dwErrorCount(0), dwLastProgress(0), dwReplaceCount(0),
+                       dwThreadId(GetCurrentThreadId()), isSameThread(TRUE)
+    {
+    }
+
+    void OnCryptBegin() {}
+    void OnCryptFinish() {}
+
+    void OnCryptNext(IN DWORD dwCurIndex, IN LPCTSTR lpCurFilePath)
+    {
+        ++dwNextCount;
+        isSameThread = isSameThread && (GetCurrentThreadId() == dwThreadId);
+    }
+
+    void OnCryptError(IN LPCTSTR lpErrorMsg)
+    {
+        ++dwErrorCount;
+        wprintf(L"Crypt error: %s\n", lpErrorMsg);
+    }
+
+    void OnProgressChanged(IN DWORD dwCompleted, IN DWORD dwTotal)
+    {
+        dwLastProgress = dwCompleted * 100 / dwTotal;
+        isSameThread = isSameThread && (GetCurrentThreadId() == dwThreadId);
+    }
+
+    void OnReplaceFiles(OUT CRYPT_INQUIRE_RESULT *pResult, IN LPCTSTR lpFileName)
+    {
+        ++dwReplaceCount;
+        isSameThread = isSameThread && (GetCurrentThreadId() == dwThreadId);
+        *pResult = CRYPT_INQUIRE_YES;
+    }
+};
+
+//////////////////////////////////////////////////////////////////////////
+
+void TestBatchCryptFile()
+{
+    const DWORD dwSmallFileCount = 5000;
+    const DWORD dwBigFileCount   = 2;
+    const DWORD dwBigFileSize    = 24 * 1024 * 1024 + 777;
+
+    TCHAR szTempPath[MAX_PATH] = { 0 };
+    TCHAR szKeyPath[MAX_PATH]  = { 0 };
+    GetTempPath(MAX_PATH, szTempPath);
+    _stprintf_s(szKeyPath, MAX_PATH, _T("%sTestBatchCrypt.key"), szTempPath);
+
+    // Many small files from 0 bytes to 256 KB and a few big files.
+    vector<CryptString> vctSrcFiles;
+    vector<CryptString> vctWorkFiles;
+    UINT64 nTotalSize = 0;
+    BYTE *pbData = new BYTE[dwBigFileSize];
+    UINT32 nSeed = 0x1F2E3D4C;
+    for (DWORD i = 0; i < dwSmallFileCount + dwBigFileCount; ++i)
+    {
+        TCHAR szFilePath[MAX_PATH] = { 0 };
+        _stprintf_s(szFilePath, MAX_PATH, _T("%sTestBatchCrypt%u.src"), szTempPath, i);
+
+        nSeed = nSeed * 1103515245 + 12345;
+        DWORD dwFileSize = (i < dwSmallFileCount) ? (nSeed >> 8) % (256 * 1024) : dwBigFileSize;
+        for (DWORD j = 0; j < dwFileSize; ++j)
+        {
+            nSeed = nSeed * 1103515245 + 12345;
+            pbData[j] = (BYTE)(nSeed >> 16);
+        }
+
+        FILE *pFile = NULL;
+        _tfopen_s(&pFile, szFilePath, _T("wb"));
+        if (NULL != pFile)
+        {
+            fwrite(pbData, 1, dwFileSize, pFile);
+            fclose(pFile);
+        }
+
+        nTotalSize += dwFileSize;
+        vctSrcFiles.push_back(szFilePath);
+        _stprintf_s(szFilePath, MAX_PATH, _T("%sTestBatchCrypt%u.dat"), szTempPath, i);
+        vctWorkFiles.push_back(szFilePath);
+    }
+    SAFE_DELETE_ARRAY(pbData);
+
+    SYSTEM_INFO sinf;
+    GetSystemInfo(&sinf);
+
+    LARGE_INTEGER liFrequency;
+    QueryPerformanceFrequency(&liFrequency);
+
+    DOUBLE dTotalMB = (DOUBLE)nTotalSize / (1024 * 1024);
+    printf("Batch crypt, files = %u, total size = %.1f MB, processors = %u\n",
+        dwSmallFileCount + dwBigFileCount, dTotalMB, sinf.dwNumberOfProcessors);
+    printf("mode     encrypt MB/s    decrypt MB/s    notify    verify\n");
+
+    // Pass 0 is the serial mode, pass 1 is the batch mode in which the workers take the big files
+    // of the stream format, pass 2 is the batch mode in which the big files are chunked.
+    const char *pszPassNames[] = { "serial", "batch", "chunk" };
+    for (int nPass = 0; nPass < 3; ++nPass)
+    {
+        for (size_t i = 0; i < vctSrcFiles.size(); ++i)
+        {
+            CopyFile(vctSrcFiles[i].c_str(), vctWorkFiles[i].c_str(), FALSE);
+        }
+
+        // Every tenth encrypted file exists, the workers ask the sink to replace it.
+        vector<CryptString> vctCryptFiles;
+        DWORD dwConflictCount = 0;
+        for each (const CryptString& strWorkFile in vctWorkFiles)
+        {
+            vctCryptFiles.push_back(strWorkFile + _T(".tofp"));
+            if (0 == vctCryptFiles.size() % 10)
+            {
+                FILE *pFile = NULL;
+                _tfopen_s(&pFile, vctCryptFiles.back().c_str(), _T("wb"));
+                if (NULL != pFile)
+                {
+                    fclose(pFile);
+                    ++dwConflictCount;
+                }
+            }
+        }
+
+        DOUBLE dSeconds[2] = { 0 };
+        BOOL isNotified = TRUE;
+
+        for (int nOp = 0; nOp < 2; ++nOp)
+        {
+            BatchCryptSink sink;
+            SdkCryptFile cryptFile(FALSE);
+            cryptFile.SetCryptKeyPath(szKeyPath);
+            cryptFile.SetCryptPassword(_T("password"));
+            cryptFile.SetCryptFileSink(&sink);
+            cryptFile.SetBatchCrypt(0 != nPass);
+            cryptFile.SetParallelCrypt(2 == nPass);
+            cryptFile.SetCryptFiles((0 == nOp) ? vctWorkFiles : vctCryptFiles, TRUE);
+
+            LARGE_INTEGER liBegin, liEnd;
+            QueryPerformanceCounter(&liBegin);
+            cryptFile.BeginCrypt((0 == nOp) ? CRYPT_OP_ENCRYPT : CRYPT_OP_DECRYPT);
+            QueryPerformanceCounter(&liEnd);
+
+            dSeconds[nOp] = (DOUBLE)(liEnd.QuadPart - liBegin.QuadPart) / liFrequency.QuadPart;
+            isNotified = isNotified && sink.isSameThread && (0 == sink.dwErrorCount) &&
+                         (sink.dwNextCount == vctSrcFiles.size()) && (sink.dwLastProgress >= 99) &&
+                         (sink.dwReplaceCount == ((0 == nOp) ? dwConflictCount : 0));
+        }
+
+        BOOL isVerified = TRUE;
+        for (size_t i = 0; i < vctSrcFiles.size(); ++i)
+        {
+            isVerified = isVerified && IsSameFile(vctSrcFiles[i].c_str(), vctWorkFiles[i].c_str());
+            DeleteFile(vctWorkFiles[i].c_str());
+        }
+
+        printf("%-6s %14.1f %15.1f    %6s    %s\n",
+            pszPassNames[nPass],
+            dTotalMB / dSeconds[0],
+            dTotalMB / dSeconds[1],
+            isNotified ? "OK" : "FAILED",
+            isVerified ? "OK" : "FAILED");
+    }
+
+    for each (const CryptString& strSrcFile in vctSrcFiles)
+    {
+        DeleteFile(strSrcFile.c_str());
+    }
+    DeleteFile(szKeyPath);
+}
+
+//////////////////////////////////////////////////////////////////////////
+
+CryptString EncryptWithCachedKey(LPCTSTR lpKeyPath, LPCTSTR lpPassword)
+{
+    CryptString strCipher;
+    SdkCrypt *pCrypt = NULL;
+    if (CRYPT_ERROR_SUCCEED == SdkCryptKeyCache::AcquireCrypt(lpKeyPath, lpPassword, &pCrypt))
+    {
+        BYTE cbData[64] = { 0 };
+        memcpy(cbData, "The data to check the key of the key cache.", 44);
+        if (CRYPT_ERROR_SUCCEED == pCrypt->EncryptStream(cbData, sizeof(cbData), TRUE))
+        {
+            for (DWORD i = 0; i < sizeof(cbData); ++i)
+            {
+                TCHAR szHex[4] = { 0 };
+                _stprintf_s(szHex, 4, _T("%02X"), cbData[i]);
+                strCipher += szHex;
+            }
+        }
+    }
+
+    SAFE_DELETE(pCrypt);
+
+    return strCipher;
+}
+
+//////////////////////////////////////////////////////////////////////////
+
+void TestCryptKeyCache()
+{
+    const int nNameCount = 10000;
+
+    TCHAR szTempPath[MAX_PATH] = { 0 };
+    TCHAR szKeyPath[MAX_PATH]  = { 0 };
+    GetTempPath(MAX_PATH, szTempPath);
+    _stprintf_s(szKeyPath, MAX_PATH, _T("%sTestCryptKeyCache.key"), szTempPath);
+
+    LARGE_INTEGER liFrequency;
+    QueryPerformanceFrequency(&liFrequency);
+
+    // The file names encrypted without the cache are compared with the cached ones.
+    vector<CryptString> vctNames[2];
+    DOUBLE dSeconds[2] = { 0 };
+    for (int nPass = 0; nPass < 2; ++nPass)
+    {
+        SdkCryptKeyCache::SetCapacity((0 == nPass) ? 0 : DEFAULT_KEY_CACHE_ENTRIES);
+
+        LARGE_INTEGER liBegin, liEnd;
+        QueryPerformanceCounter(&liBegin);
+        for (int i = 0; i < nNameCount; ++i)
+        {
+            TCHAR szFileName[MAX_PATH] = { 0 };
+            _stprintf_s(szFileName, MAX_PATH, _T("Document %05d.txt"), i);
+            vctNames[nPass].push_back(SdkCryptFile::EncryptFileName(szFileName));
+        }
+        QueryPerformanceCounter(&liEnd);
+
+        dSeconds[nPass] = (DOUBLE)(liEnd.QuadPart - liBegin.QuadPart) / liFrequency.QuadPart;
+    }
+
+    printf("EncryptFileName x %d: uncached %.3f s, cached %.3f s, same output %s\n",
+        nNameCount, dSeconds[0], dSeconds[1], (vctNames[0] == vctNames[1]) ? "OK" : "FAILED");
+
+    // The key file is cached by the path and the password.
+    SdkCryptKey *pCryptKey = NULL;
+    SdkCrypt keyCreator;
+    if ( (CRYPT_ERROR_SUCCEED == keyCreator.CreateCryptKey(&pCryptKey)) && pCryptKey->SaveToFile(szKeyPath) )
+    {
+        CryptString strCipher1 = EncryptWithCachedKey(szKeyPath, _T("password"));
+        CryptString strCipher2 = EncryptWithCachedKey(szKeyPath, _T("password"));
+        CryptString strCipher3 = EncryptWithCachedKey(szKeyPath, _T("another"));
+        printf("Key file hit:      %s\n", (!strCipher1.empty() && (strCipher1 == strCipher2)) ? "OK" : "FAILED");
+        printf("Other password:    %s\n", (strCipher1 == strCipher3) ? "OK" : "FAILED");
+
+        // Evicted keys are loaded again with the same result.
+        SdkCryptKeyCache::Evict(szKeyPath);
+        printf("Evict and reload:  %s\n", (strCipher1 == EncryptWithCachedKey(szKeyPath, _T("password"))) ? "OK" : "FAILED");
+
+        // A changed key file is not served from the cache.
+        Sleep(20);
+        SdkCryptKey *pNewCryptKey = NULL;
+        SdkCrypt newKeyCreator;
+        if ( (CRYPT_ERROR_SUCCEED == newKeyCreator.CreateCryptKey(&pNewCryptKey)) && pNewCryptKey->SaveToFile(szKeyPath) )
+        {
+            printf("Stale key file:    %s\n", (strCipher1 != EncryptWithCachedKey(szKeyPath, _T("password"))) ? "OK" : "FAILED");
+        }
+        SAFE_DELETE(pNewCryptKey);
+    }
+    SAFE_DELETE(pCryptKey);
+
+    SdkCryptKeyCache::EvictAll();
+    DeleteFile(szKeyPath);
+}
+
+//////////////////////////////////////////////////////////////////////////
+
+void TestBase64Util()
+{
+    const int nFuzzCount = 100000;
+
+    UINT32 nSupportedLevel = SdkBase64Util::GetSimdLevel();
+    printf("Base64 SIMD level = %u\n", nSupportedLevel);
+
+    // The SIMD code must give the same output, return value and buffer contents as the
+    // scalar reference, with random data, short output buffers and broken strings.
+    UINT32 nSeed = 0x13579BDF;
+    DWORD dwFailCount = 0;
+    for (UINT32 nLevel = BASE64_SIMD_SSSE3; nLevel <= nSupportedLevel; ++nLevel)
+    {
+        SdkBase64Util::SetSimdLevel(nLevel);
+
+        for (int i = 0; i < nFuzzCount; ++i)
+        {
+            nSeed = nSeed * 1103515245 + 12345;
+            size_t inlen = (nSeed >> 8) % 300;
+            vector<char> vctData(inlen + 1);
+            for (size_t j = 0; j < inlen; ++j)
+            {
+                nSeed = nSeed * 1103515245 + 12345;
+                vctData[j] = (char)(nSeed >> 16);
+            }
+
+            nSeed = nSeed * 1103515245 + 12345;
+            size_t outlen = (0 == i % 3) ? (nSeed >> 8) % 420 : BASE64_LENGTH(inlen) + 1;
+            vector<char> vctOut1(outlen + 8, '#');
+            vector<char> vctOut2(outlen + 8, '#');
+            SdkBase64Util::Encode(&vctData[0], inlen, &vctOut1[0], outlen);
+            SdkBase64Util::EncodeScalar(&vctData[0], inlen, &vctOut2[0], outlen);
+            dwFailCount += (vctOut1 != vctOut2) ? 1 : 0;
+
+            string strBase64(&vctOut2[0], strnlen(&vctOut2[0], outlen));
+            nSeed = nSeed * 1103515245 + 12345;
+            if ( (0 != i % 2) && !strBase64.empty() )
+            {
+                strBase64[(nSeed >> 8) % strBase64.size()] = (char)(nSeed >> 16);
+            }
+
+            size_t declen1 = (0 == i % 5) ? (nSeed >> 4) % 250 : strBase64.size();
+            size_t declen2 = declen1;
+            vector<char> vctDec1(declen1 + 8, '#');
+            vector<char> vctDec2(declen2 + 8, '#');
+            BOOL isOK1 = SdkBase64Util::Decode(strBase64.c_str(), strBase64.size(), &vctDec1[0], &declen1);
+            BOOL isOK2 = SdkBase64Util::DecodeScalar(strBase64.c_str(), strBase64.size(), &vctDec2[0], &declen2);
+            dwFailCount += ((isOK1 != isOK2) || (declen1 != declen2) || (vctDec1 != vctDec2)) ? 1 : 0;
+
+            string strData(&vctData[0], inlen);
+            string strDecoded;
+            BOOL isRoundTrip = SdkBase64Util::Decode(SdkBase64Util::Encode(strData), strDecoded);
+            dwFailCount += (!isRoundTrip || (strDecoded != strData)) ? 1 : 0;
+        }
+    }
+    printf("Fuzz test: %s\n", (0 == dwFailCount) ? "OK" : "FAILED");
+
+    LARGE_INTEGER liFrequency;
+    QueryPerformanceFrequency(&liFrequency);
+
+    const size_t sizes[] = { 64, 4 * 1024, 1024 * 1024 };
+    const size_t dwTotalSize = 64 * 1024 * 1024;
+    printf("size        level    encode MB/s    decode MB/s\n");
+    for (size_t i = 0; i < ARRAYSIZE(sizes); ++i)
+    {
+        size_t inlen = sizes[i];
+        size_t outlen = BASE64_LENGTH(inlen) + 1;
+        vector<char> vctData(inlen);
+        vector<char> vctBase64(outlen);
+        vector<char> vctDecoded(inlen + 4);
+        for (size_t j = 0; j < inlen; ++j)
+        {
+            nSeed = nSeed * 1103515245 + 12345;
+            vctData[j] = (char)(nSeed >> 16);
+        }
+
+        for (UINT32 nLevel = BASE64_SIMD_NONE; nLevel <= nSupportedLevel; ++nLevel)
+        {
+            SdkBase64Util::SetSimdLevel(nLevel);
+            size_t nRepeat = dwTotalSize / inlen;
+
+            LARGE_INTEGER liBegin, liMiddle, liEnd;
+            QueryPerformanceCounter(&liBegin);
+            for (size_t j = 0; j < nRepeat; ++j)
+            {
+                SdkBase64Util::Encode(&vctData[0], inlen, &vctBase64[0], outlen);
+            }
+            QueryPerformanceCounter(&liMiddle);
+            for (size_t j = 0; j < nRepeat; ++j)
+            {
+                size_t declen = vctDecoded.size();
+                SdkBase64Util::Decode(&vctBase64[0], outlen - 1, &vctDecoded[0], &declen);
+            }
+            QueryPerformanceCounter(&liEnd);
+
+            DOUBLE dTotalMB = (DOUBLE)dwTotalSize / (1024 * 1024);
+            printf("%-10u  %5u %14.1f %14.1f\n", (UINT32)inlen, nLevel,
+                dTotalMB * liFrequency.QuadPart / (liMiddle.QuadPart - liBegin.QuadPart),
+                dTotalMB * liFrequency.QuadPart / (liEnd.QuadPart - liMiddle.QuadPart));
+        }
+    }
+
+    SdkBase64Util::SetSimdLevel(nSupportedLevel);
+}
+
+//////////////////////////////////////////////////////////////////////////
+
+void TestBase64Stream()
+{
+    const int nTestCount = 10000;
+
+    // The pieces are cut at random places, the result must be the same as the whole data.
+    UINT32 nSeed = 0x2B7E1516;
+    DWORD dwFailCount = 0;
+    vector<char> vctBuffer(4096);
+    for (int i = 0; i < nTestCount; ++i)
+    {
+        nSeed = nSeed * 1103515245 + 12345;
+        string strData((nSeed >> 8) % 1000, '\0');
+        for (size_t j = 0; j < strData.size(); ++j)
+        {
+            nSeed = nSeed * 1103515245 + 12345;
+            strData[j] = (char)(nSeed >> 16);
+        }
+
+        for (int nPass = 0; nPass < 2; ++nPass)
+        {
+            const string& strInput = (0 == nPass) ? strData : SdkBase64Util::Encode(strData);
+            const string& strExpect = (0 == nPass) ? SdkBase64Util::Encode(strData) : strData;
+
+            SdkBase64Stream stream(0 == nPass);
+            string strOutput;
+            BOOL isOK = TRUE;
+            size_t nPos = 0;
+            while ( isOK && (nPos < strInput.size()) )
+            {
+                nSeed = nSeed * 1103515245 + 12345;
+                size_t nSize = MIN((nSeed >> 8) % 64, strInput.size() - nPos);
+                size_t nWritten = vctBuffer.size();
+                isOK = stream.Feed(strInput.c_str() + nPos, nSize, &vctBuffer[0], &nWritten);
+                strOutput.append(&vctBuffer[0], nWritten);
+                nPos += nSize;
+            }
+
+            size_t nWritten = vctBuffer.size();
+            isOK = isOK && stream.Finish(&vctBuffer[0], &nWritten);
+            strOutput.append(&vctBuffer[0], nWritten);
+
+            dwFailCount += (!isOK || (strOutput != strExpect)) ? 1 : 0;
+        }
+    }
+    printf("Stream pieces:     %s\n", (0 == dwFailCount) ? "OK" : "FAILED");
+
+    // The characters after the padding and the broken group are errors.
+    char szOut[16] = { 0 };
+    size_t nOut = sizeof(szOut);
+    SdkBase64Stream decoder(FALSE);
+    BOOL isPaddingError = decoder.Feed("QUI=", 4, szOut, &nOut) && !decoder.Feed("QUI=", 4, szOut, &nOut);
+    decoder.Reset();
+    nOut = sizeof(szOut);
+    BOOL isGroupError = decoder.Feed("QUJDR", 5, szOut, &nOut) && !decoder.Finish(szOut, &nOut);
+    printf("Stream errors:     %s\n", (isPaddingError && isGroupError) ? "OK" : "FAILED");
+
+    // The exported key is imported with the same blobs.
+    TCHAR szTempPath[MAX_PATH] = { 0 };
+    TCHAR szKeyPath[MAX_PATH]  = { 0 };
+    GetTempPath(MAX_PATH, szTempPath);
+    _stprintf_s(szKeyPath, MAX_PATH, _T("%sTestBase64Stream.txt"), szTempPath);
+
+    SdkCryptKey *pCryptKey = NULL;
+    SdkCrypt keyCreator;
+    BOOL isKeyOK = FALSE;
+    if ( (CRYPT_ERROR_SUCCEED == keyCreator.CreateCryptKey(&pCryptKey)) && pCryptKey->ExportToFile(szKeyPath, TRUE) )
+    {
+        SdkCryptKey importKey;
+        if (importKey.ImportFromFile(szKeyPath, TRUE))
+        {
+            CRYPTKEYBLOBINFO srcBlob = pCryptKey->GetKeyBlob();
+            CRYPTKEYBLOBINFO dstBlob = importKey.GetKeyBlob();
+            CRYPTKEYBLOBINFO srcXchg = pCryptKey->GetExchKeyBlob();
+            CRYPTKEYBLOBINFO dstXchg = importKey.GetExchKeyBlob();
+            isKeyOK = (srcBlob.dwKeyBlobLen == dstBlob.dwKeyBlobLen) &&
+                      (0 == memcmp(srcBlob.pbKeyBlob, dstBlob.pbKeyBlob, srcBlob.dwKeyBlobLen)) &&
+                      (srcXchg.dwKeyBlobLen == dstXchg.dwKeyBlobLen) &&
+                      (0 == memcmp(srcXchg.pbKeyBlob, dstXchg.pbKeyBlob, srcXchg.dwKeyBlobLen));
+        }
+    }
+    SAFE_DELETE(pCryptKey);
+    DeleteFile(szKeyPath);
+
+    printf("Key export/import: %s\n", isKeyOK ? "OK" : "FAILED");
+}
+
+//////////////////////////////////////////////////////////////////////////
+
+void TestWICImageCache()
+{
+    const int nLoadCount = 200;
+
+    WCHAR szTempPath[MAX_PATH]  = { 0 };
+    WCHAR szImagePath[MAX_PATH] = { 0 };
+    GetTempPathW(MAX_PATH, szTempPath);
+    swprintf_s(szImagePath, MAX_PATH, L"%sTestWICImageCache.png", szTempPath);
+
+    SdkWICImageHelper::WICInitialize();
+
+    // Save a big image to a PNG file.
+    HDC hdcScreen = GetDC(NULL);
+    HBITMAP hBitmap = CreateCompatibleBitmap(hdcScreen, 1920, 1080);
+    ReleaseDC(NULL, hdcScreen);
+
+    BOOL isSaved = FALSE;
+    SdkWICImageHelper srcHelper;
+    if ( srcHelper.LoadFromHBITMAP(hBitmap) )
+    {
+        IWICFormatConverter *pConverter = NULL;
+        srcHelper.GetFormatConverter(&pConverter);
+        isSaved = SdkWICImageHelper::SaveWICBitmapToFile(szImagePath, pConverter);
+        SAFE_RELEASE(pConverter);
+    }
+    srcHelper.ClearImageData();
+    DeleteObject(hBitmap);
+
+    if ( !isSaved )
+    {
+        printf("Save image:        FAILED\n");
+        SdkWICImageHelper::WICUninitialize();
+        return;
+    }
+
+    LARGE_INTEGER liFrequency;
+    QueryPerformanceFrequency(&liFrequency);
+
+    // The image is loaded and its pixels are read as the views do when they draw.
+    vector<BYTE> vctPixels(1920 * 1080 * 4);
+    DOUBLE dSeconds[2] = { 0 };
+    for (int nPass = 0; nPass < 2; ++nPass)
+    {
+        SdkWICImageCache::Clear();
+        SdkWICImageCache::SetBudget((0 == nPass) ? 0 : DEFAULT_WIC_IMAGE_CACHE_BUDGET);
+
+        LARGE_INTEGER liBegin, liEnd;
+        QueryPerformanceCounter(&liBegin);
+        for (int i = 0; i < nLoadCount; ++i)
+        {
+            SdkWICImageHelper helper;
+            IWICFormatConverter *pConverter = NULL;
+            if ( helper.LoadFromFile(szImagePath) && helper.GetFormatConverter(&pConverter) && (NULL != pConverter) )
+            {
+                pConverter->CopyPixels(NULL, 1920 * 4, (UINT)vctPixels.size(), &vctPixels[0]);
+            }
+            SAFE_RELEASE(pConverter);
+        }
+        QueryPerformanceCounter(&liEnd);
+
+        dSeconds[nPass] = (DOUBLE)(liEnd.QuadPart - liBegin.QuadPart) / liFrequency.QuadPart;
+    }
+
+    WICIMAGECACHESTATS stats = { 0 };
+    SdkWICImageCache::GetStats(&stats);
+    printf("Load and draw x %d: uncached %.3f s, cached %.3f s\n", nLoadCount, dSeconds[0], dSeconds[1]);
+    printf("Cache hits:        %s (%I64u hits, %I64u misses)\n",
+        ((nLoadCount - 1 == stats.uHits) && (1 == stats.uEntries)) ? "OK" : "FAILED", stats.uHits, stats.uMisses);
+
+    // Each target size is another image, the budget keeps only the recent ones.
+    SdkWICImageCache::SetBudget(1920 * 1080 * 4);
+    SdkWICImageHelper sizeHelper;
+    sizeHelper.LoadFromFile(szImagePath, 960, 540);
+    sizeHelper.LoadFromFile(szImagePath, 480, 270);
+    SdkWICImageCache::GetStats(&stats);
+    printf("Budget eviction:   %s (%I64u bytes of %I64u)\n",
+        ((stats.uBytes <= stats.uBudget) && (stats.uEvictions > 0)) ? "OK" : "FAILED", stats.uBytes, stats.uBudget);
+    sizeHelper.ClearImageData();
+
+    // A changed file is not served from the cache.
+    Sleep(20);
+    HANDLE hFile = CreateFileW(szImagePath, FILE_WRITE_ATTRIBUTES, 0, NULL, OPEN_EXISTING, 0, NULL);
+    if ( ISVALIDHANDLE(hFile) )
+    {
+        FILETIME ftNow = { 0 };
+        GetSystemTimeAsFileTime(&ftNow);
+        SetFileTime(hFile, NULL, NULL, &ftNow);
+        CloseHandle(hFile);
+    }
+    UINT64 uMisses = stats.uMisses;
+    sizeHelper.LoadFromFile(szImagePath, 960, 540);
+    sizeHelper.ClearImageData();
+    SdkWICImageCache::GetStats(&stats);
+    printf("Stale image file:  %s\n", (stats.uMisses == uMisses + 1) ? "OK" : "FAILED");
+
+    SdkWICImageCache::SetBudget(DEFAULT_WIC_IMAGE_CACHE_BUDGET);
+    SdkWICImageCache::Clear();
+    SdkWICImageHelper::WICUninitialize();
+    DeleteFileW(szImagePath);
+}
+
+//////////////////////////////////////////////////////////////////////////
+
+class ImageDecodeSink : public IImageDecodeNotify
+{
+public:
+
+    vector<DWORD>   vctOrder;
+    DWORD           dwErrorCount;
+    DWORD           dwThreadId;
+    BOOL            isSameThread;
+
+    ImageDecodeSink() : dwErrorCount(0), dwThreadId(GetCurrentThreadId()), isSameThread(TRUE)
+    {
+    }
+
+    void OnImageDecoded(IN const IMAGEDECODERESULT *lpResult)
+    {
+        vctOrder.push_back(lpResult->dwRequestId);
+        isSameThread = isSameThread && (GetCurrentThreadId() == dwThreadId);
+        if ( FAILED(lpResult->hrDecode) || (NULL == lpResult->pBitmap) )
+        {
+            ++dwErrorCount;
+        }
+    }
+};
+
+//////////////////////////////////////////////////////////////////////////
+
+void TestImageDecodeService()
+{
+    const int nFileCount = 8;
+
+    WCHAR szTempPath[MAX_PATH] = { 0 };
+    GetTempPathW(MAX_PATH, szTempPath);
+
+    SdkWICImageHelper::WICInitialize();
+
+    // Save a big image to several PNG files, each file is decoded once.
+    vector<wstring> vctFiles;
+    HDC hdcScreen = GetDC(NULL);
+    HBITMAP hBitmap = CreateCompatibleBitmap(hdcScreen, 1920, 1080);
+    ReleaseDC(NULL, hdcScreen);
+
+    SdkWICImageHelper srcHelper;
+    if ( srcHelper.LoadFromHBITMAP(hBitmap) )
+    {
+        IWICFormatConverter *pConverter = NULL;
+        srcHelper.GetFormatConverter(&pConverter);
+        for (int i = 0; i < nFileCount; ++i)
+        {
+            WCHAR szImagePath[MAX_PATH] = { 0 };
+            swprintf_s(szImagePath, MAX_PATH, L"%sTestImageDecodeService%d.png", szTempPath, i);
+            if ( SdkWICImageHelper::SaveWICBitmapToFile(szImagePath, pConverter) )
+            {
+                vctFiles.push_back(szImagePath);
+            }
+        }
+        SAFE_RELEASE(pConverter);
+    }
+    srcHelper.ClearImageData();
+    DeleteObject(hBitmap);
+
+    if (nFileCount != (int)vctFiles.size())
+    {
+        printf("Save image:        FAILED\n");
+        SdkWICImageHelper::WICUninitialize();
+        return;
+    }
+
+    // The cache would hide the decoding of the second pass.
+    SdkWICImageCache::SetBudget(0);
+
+    LARGE_INTEGER liFrequency, liBegin, liEnd;
+    QueryPerformanceFrequency(&liFrequency);
+
+    // The window thread decodes all images itself.
+    QueryPerformanceCounter(&liBegin);
+    for (int i = 0; i < nFileCount; ++i)
+    {
+        SdkWICImageHelper helper;
+        IWICBitmap *pBitmap = NULL;
+        if ( helper.LoadFromFile(vctFiles[i].c_str()) )
+        {
+            helper.DecodeToBitmap(&pBitmap);
+        }
+        SAFE_RELEASE(pBitmap);
+    }
+    QueryPerformanceCounter(&liEnd);
+    DOUBLE dSyncSeconds = (DOUBLE)(liEnd.QuadPart - liBegin.QuadPart) / liFrequency.QuadPart;
+
+    if ( !SdkImageDecodeService::Initialize() )
+    {
+        printf("Start service:     FAILED\n");
+        SdkWICImageCache::SetBudget(DEFAULT_WIC_IMAGE_CACHE_BUDGET);
+        SdkWICImageHelper::WICUninitialize();
+        return;
+    }
+
+    // The prefetch images are requested first, the visible one is requested at last.
+    ImageDecodeSink sink;
+    vector<DWORD> vctIds;
+    QueryPerformanceCounter(&liBegin);
+    for (int i = 0; i < nFileCount - 1; ++i)
+    {
+        vctIds.push_back(SdkImageDecodeService::DecodeFile(vctFiles[i].c_str(), 0, 0, IMAGE_DECODE_PRIORITY_PREFETCH, &sink));
+    }
+    DWORD dwVisibleId = SdkImageDecodeService::DecodeFile(vctFiles[nFileCount - 1].c_str(), 0, 0, IMAGE_DECODE_PRIORITY_VISIBLE, &sink);
+    DWORD dwCancelId = vctIds[nFileCount - 2];
+    SdkImageDecodeService::Cancel(dwCancelId);
+
+    LARGE_INTEGER liSubmit;
+    QueryPerformanceCounter(&liSubmit);
+
+    // The results are posted to this thread, pump the messages until all are received.
+    DWORD dwStart = GetTickCount();
+    while ( ((int)sink.vctOrder.size() < nFileCount - 1) && (GetTickCount() - dwStart < 30000) )
+    {
+        MsgWaitForMultipleObjects(0, NULL, FALSE, 100, QS_ALLINPUT);
+
+        MSG msg;
+        while ( PeekMessage(&msg, NULL, 0, 0, PM_REMOVE) )
+        {
+            TranslateMessage(&msg);
+            DispatchMessage(&msg);
+        }
+    }
+    QueryPerformanceCounter(&liEnd);
+
+    DOUBLE dSubmitSeconds = (DOUBLE)(liSubmit.QuadPart - liBegin.QuadPart) / liFrequency.QuadPart;
+    DOUBLE dAsyncSeconds  = (DOUBLE)(liEnd.QuadPart - liBegin.QuadPart) / liFrequency.QuadPart;
+
+    // The threads may take some prefetch images before the visible one is requested.
+    size_t nVisibleIndex = find(sink.vctOrder.begin(), sink.vctOrder.end(), dwVisibleId) - sink.vctOrder.begin();
+    BOOL isCancelled = (sink.vctOrder.end() == find(sink.vctOrder.begin(), sink.vctOrder.end(), dwCancelId));
+
+    printf("Decode x %d:        sync %.3f s, async %.3f s (window thread blocked %.3f s)\n",
+        nFileCount, dSyncSeconds, dAsyncSeconds, dSubmitSeconds);
+    printf("All decoded:       %s (%u results, %u errors)\n",
+        (((int)sink.vctOrder.size() == nFileCount - 1) && (0 == sink.dwErrorCount)) ? "OK" : "FAILED",
+        (UINT)sink.vctOrder.size(), sink.dwErrorCount);
+    printf("Visible first:     %s (position %u)\n", (nVisibleIndex <= MAX_IMAGE_DECODE_THREADS) ? "OK" : "FAILED", (UINT)nVisibleIndex);
+    printf("Cancelled request: %s\n", isCancelled ? "OK" : "FAILED");
+    printf("Window thread:     %s\n", sink.isSameThread ? "OK" : "FAILED");
+
+    SdkImageDecodeService::Uninitialize();
+    SdkWICImageCache::SetBudget(DEFAULT_WIC_IMAGE_CACHE_BUDGET);
+    SdkWICImageCache::Clear();
+    SdkWICImageHelper::WICUninitialize();
+
+    for (int i = 0; i < nFileCount; ++i)
+    {
+        DeleteFileW(vctFiles[i].c_str());
+    }
+}
+
+//////////////////////////////////////////////////////////////////////////
+
+BOOL SaveGradientJpeg(LPCWSTR lpFile, UINT uWidth, UINT uHeight)
+{
+    IWICImagingFactory *pFactory = NULL;
+    IWICBitmap *pBitmap = NULL;
+    IWICStream *pStream = NULL;
+    IWICBitmapEncoder *pEncoder = NULL;
+    IWICBitmapFrameEncode *pFrameEncode = NULL;
+
+    HRESULT hr = CoCreateInstance(CLSID_WICImagingFactory, NULL, CLSCTX_INPROC_SERVER, IID_PPV_ARGS(&pFactory));
+    if (SUCCEEDED(hr))
+    {
+        hr = pFactory->CreateBitmap(uWidth, uHeight, GUID_WICPixelFormat24bppBGR, WICBitmapCacheOnLoad, &pBitmap);
+    }
+
+    if (SUCCEEDED(hr))
+    {
+        WICRect rcLock = { 0, 0, (INT)uWidth, (INT)uHeight };
+        IWICBitmapLock *pLock = NULL;
+        hr = pBitmap->Lock(&rcLock, WICBitmapLockWrite, &pLock);
+        if (SUCCEEDED(hr))
+        {
+            UINT uStride = 0;
+            UINT uSize = 0;
+            BYTE *pData = NULL;
+            pLock->GetStride(&uStride);
+            pLock->GetDataPointer(&uSize, &pData);
+            for (UINT y = 0; y < uHeight; ++y)
+            {
+                BYTE *pRow = pData + (SIZE_T)y * uStride;
+                for (UINT x = 0; x < uWidth; ++x)
+                {
+                    pRow[x * 3]     = (BYTE)((x + y) / 8);
+                    pRow[x * 3 + 1] = (BYTE)(x / 29 + y / 23);
+                    pRow[x * 3 + 2] = (BYTE)((x / 16 + y / 16) * 9);
+                }
+            }
+        }
+        SAFE_RELEASE(pLock);
+    }
+
+    if (SUCCEEDED(hr))
+    {
+        hr = pFactory->CreateStream(&pStream);
+    }
+    if (SUCCEEDED(hr))
+    {
+        hr = pStream->InitializeFromFilename(lpFile, GENERIC_WRITE);
+    }
+    if (SUCCEEDED(hr))
+    {
+        hr = pFactory->CreateEncoder(GUID_ContainerFormatJpeg, NULL, &pEncoder);
+    }
+    if (SUCCEEDED(hr))
+    {
+        hr = pEncoder->Initialize(pStream, WICBitmapEncoderNoCache);
+    }
+    if (SUCCEEDED(hr))
+    {
+        hr = pEncoder->CreateNewFrame(&pFrameEncode, NULL);
+    }
+    if (SUCCEEDED(hr))
+    {
+        hr = pFrameEncode->Initialize(NULL);
+    }
+    if (SUCCEEDED(hr))
+    {
+        hr = pFrameEncode->WriteSource(pBitmap, NULL);
+    }
+    if (SUCCEEDED(hr))
+    {
+        hr = pFrameEncode->Commit();
+    }
+    if (SUCCEEDED(hr))
+    {
+        hr = pEncoder->Commit();
+    }
+
+    SAFE_RELEASE(pFrameEncode);
+    SAFE_RELEASE(pEncoder);
+    SAFE_RELEASE(pStream);
+    SAFE_RELEASE(pBitmap);
+    SAFE_RELEASE(pFactory);
+
+    return SUCCEEDED(hr) ? TRUE : FALSE;
+}
+
+//////////////////////////////////////////////////////////////////////////
+
+void TestReducedDecode()
+{
+    const UINT uSrcWidth  = 7296;
+    const UINT uSrcHeight = 5472;
+    const UINT uThumbSize = 256;
+    const int  nLoadCount = 5;
+
+    WCHAR szTempPath[MAX_PATH]  = { 0 };
+    WCHAR szImagePath[MAX_PATH] = { 0 };
+    GetTempPathW(MAX_PATH, szTempPath);
+    swprintf_s(szImagePath, MAX_PATH, L"%sTestReducedDecode.jpg", szTempPath);
+
+    // A 40 MP photo.
+    if ( !SaveGradientJpeg(szImagePath, uSrcWidth, uSrcHeight) )
+    {
+        printf("Save image:        FAILED\n");
+        return;
+    }
+
+    SdkWICImageHelper::WICInitialize();
+    SdkWICImageCache::SetBudget(0);
+
+    LARGE_INTEGER liFrequency, liBegin, liEnd;
+    QueryPerformanceFrequency(&liFrequency);
+
+    // The old way, the full image is decoded and then scaled.
+    UINT uFullWidth = 0;
+    vector<BYTE> vctPixels(uThumbSize * uThumbSize * 4);
+    QueryPerformanceCounter(&liBegin);
+    for (int i = 0; i < nLoadCount; ++i)
+    {
+        SdkWICImageHelper helper;
+        IWICFormatConverter *pConverter = NULL;
+        if ( helper.LoadFromFile(szImagePath) )
+        {
+            helper.CreateScalerWICBitmapSource(uThumbSize, uThumbSize * 3 / 4);
+        }
+        if ( helper.GetFormatConverter(&pConverter) && (NULL != pConverter) )
+        {
+            pConverter->CopyPixels(NULL, uThumbSize * 4, (UINT)vctPixels.size(), &vctPixels[0]);
+            uFullWidth = helper.GetWidth();
+        }
+        SAFE_RELEASE(pConverter);
+    }
+    QueryPerformanceCounter(&liEnd);
+    DOUBLE dFullSeconds = (DOUBLE)(liEnd.QuadPart - liBegin.QuadPart) / liFrequency.QuadPart / nLoadCount;
+
+    // The codec decodes 1/8 of the image by the DCT, only the reduced image is scaled.
+    UINT uReducedWidth = 0;
+    QueryPerformanceCounter(&liBegin);
+    for (int i = 0; i < nLoadCount; ++i)
+    {
+        SdkWICImageHelper helper;
+        IWICFormatConverter *pConverter = NULL;
+        if ( helper.LoadFromFile(szImagePath, uThumbSize, uThumbSize * 3 / 4) &&
+             helper.GetFormatConverter(&pConverter) && (NULL != pConverter) )
+        {
+            pConverter->CopyPixels(NULL, uThumbSize * 4, (UINT)vctPixels.size(), &vctPixels[0]);
+            uReducedWidth = helper.GetWidth();
+        }
+        SAFE_RELEASE(pConverter);
+    }
+    QueryPerformanceCounter(&liEnd);
+    DOUBLE dReducedSeconds = (DOUBLE)(liEnd.QuadPart - liBegin.QuadPart) / liFrequency.QuadPart / nLoadCount;
+
+    printf("Thumbnail %u of 40 MP: full decode %.3f s, reduced decode %.3f s (%.1fx)\n",
+        uThumbSize, dFullSeconds, dReducedSeconds, dFullSeconds / dReducedSeconds);
+    printf("Thumbnail size:    %s (%u, %u)\n",
+        ((uThumbSize == uFullWidth) && (uThumbSize == uReducedWidth)) ? "OK" : "FAILED", uFullWidth, uReducedWidth);
+    printf("Decode scale:      %s\n",
+        (8 == SdkWICImageHelper::GetReducedDecodeScale(uSrcWidth, uSrcHeight, uThumbSize, 0)) &&
+        (2 == SdkWICImageHelper::GetReducedDecodeScale(uSrcWidth, uSrcHeight, uSrcWidth / 2, uSrcHeight / 2)) &&
+        (1 == SdkWICImageHelper::GetReducedDecodeScale(uSrcWidth, uSrcHeight, uSrcWidth / 2 + 1, 0)) ? "OK" : "FAILED");
+
+    // The preview of the full image is 1/8 of it.
+    SdkWICImageHelper previewHelper;
+    UINT32 uPreviewFullWidth = 0;
+    UINT32 uPreviewFullHeight = 0;
+    BOOL isPreviewed = previewHelper.LoadPreviewFromFile(szImagePath, 0, 0, &uPreviewFullWidth, &uPreviewFullHeight);
+    printf("Preview:           %s (%u x %u of %u x %u)\n",
+        (isPreviewed && (uSrcWidth / 8 == previewHelper.GetWidth()) && (uSrcWidth == uPreviewFullWidth)) ? "OK" : "FAILED",
+        previewHelper.GetWidth(), previewHelper.GetHeight(), uPreviewFullWidth, uPreviewFullHeight);
+    previewHelper.ClearImageData();
+
+    SdkWICImageCache::SetBudget(DEFAULT_WIC_IMAGE_CACHE_BUDGET);
+    SdkWICImageCache::Clear();
+    SdkWICImageHelper::WICUninitialize();
+    DeleteFileW(szImagePath);
+}
+
+//////////////////////////////////////////////////////////////////////////
+
+BOOL GetGifFramePixels(SdkWICAnimatedGif &gif, UINT uFrameIndex, OUT vector<BYTE> &vctPixels)
+{
+    IWICFormatConverter *pConverter = NULL;
+    if ( !gif.GetFrameAt(uFrameIndex, &pConverter) || (NULL == pConverter) )
+    {
+        return FALSE;
+    }
+
+    UINT uWidth = 0;
+    UINT uHeight = 0;
+    pConverter->GetSize(&uWidth, &uHeight);
+    vctPixels.resize(uWidth * uHeight * 4 + 4);
+    HRESULT hr = pConverter->CopyPixels(NULL, uWidth * 4, (UINT)vctPixels.size(), &vctPixels[0]);
+    SAFE_RELEASE(pConverter);
+
+    return SUCCEEDED(hr);
+}
+
+//////////////////////////////////////////////////////////////////////////
+
+void TestGifDecoder()
+{
+    const LPCWSTR lpGifPath = L"D:\\a.gif";
+    const int nDecodeCount = 10;
+
+    SdkWICAnimatedGif::WICInitialize();
+    printf("GIF SIMD level = %u\n", SdkGifDecoder::GetSimdLevel());
+
+    SdkWICAnimatedGif wicGif;
+    SdkWICAnimatedGif portableGif;
+    portableGif.SetDecodeBackend(GIF_DECODE_BACKEND_PORTABLE);
+    if ( !wicGif.LoadFromFile(lpGifPath) || !portableGif.LoadFromFile(lpGifPath) )
+    {
+        printf("Load GIF:          FAILED\n");
+        SdkWICAnimatedGif::WICUninitialize();
+        return;
+    }
+
+    // The raw frames and their metadata must be the same as WIC gives.
+    UINT uWidth1 = 0, uHeight1 = 0, uWidth2 = 0, uHeight2 = 0;
+    wicGif.GetSize(uWidth1, uHeight1);
+    portableGif.GetSize(uWidth2, uHeight2);
+    UINT uFrameCount = wicGif.GetFrameCount();
+    DWORD dwFailCount = ((uWidth1 != uWidth2) || (uHeight1 != uHeight2) || (uFrameCount != portableGif.GetFrameCount())) ? 1 : 0;
+    for (UINT i = 0; (0 == dwFailCount) && (i < uFrameCount); ++i)
+    {
+        vector<BYTE> vctPixels1, vctPixels2;
+        RECT rc1 = { 0 }, rc2 = { 0 };
+        BOOL isOK = GetGifFramePixels(wicGif, i, vctPixels1) && GetGifFramePixels(portableGif, i, vctPixels2);
+        wicGif.GetFrameRect(rc1);
+        portableGif.GetFrameRect(rc2);
+        isOK = isOK && (vctPixels1 == vctPixels2) && EqualRect(&rc1, &rc2) &&
+               (wicGif.GetFrameDelay() == portableGif.GetFrameDelay()) &&
+               (wicGif.GetFrameDisposal() == portableGif.GetFrameDisposal());
+        dwFailCount += isOK ? 0 : 1;
+    }
+    printf("Frames (%u):        %s\n", uFrameCount, (0 == dwFailCount) ? "OK" : "FAILED");
+
+    LARGE_INTEGER liFrequency, liBegin, liEnd;
+    QueryPerformanceFrequency(&liFrequency);
+
+    SdkWICAnimatedGif *gifs[2] = { &wicGif, &portableGif };
+    DOUBLE dSeconds[2] = { 0 };
+    vector<BYTE> vctPixels;
+    for (int n = 0; n < 2; ++n)
+    {
+        QueryPerformanceCounter(&liBegin);
+        for (int j = 0; j < nDecodeCount; ++j)
+        {
+            for (UINT i = 0; i < uFrameCount; ++i)
+            {
+                GetGifFramePixels(*gifs[n], i, vctPixels);
+            }
+        }
+        QueryPerformanceCounter(&liEnd);
+        dSeconds[n] = (DOUBLE)(liEnd.QuadPart - liBegin.QuadPart) / liFrequency.QuadPart;
+    }
+
+    DOUBLE dFrames = (DOUBLE)uFrameCount * nDecodeCount;
+    printf("Frame decode:      WIC %.3f ms, portable %.3f ms (%.1fx)\n",
+        dSeconds[0] * 1000 / dFrames, dSeconds[1] * 1000 / dFrames, dSeconds[0] / dSeconds[1]);
+
+    wicGif.ClearData();
+    portableGif.ClearData();
+    SdkWICAnimatedGif::WICUninitialize();
+}
+
+//////////////////////////////////////////////////////////////////////////
+
+void TestPixelKernels()
+{
+    const LPCWSTR lpImagePath = L"D:\\a.png";
+    const int nResizeCount = 10;
+
+    SdkImagesManager::GdiplusInitialize();
+    UINT32 nSupportedLevel = SdkPixelKernels::GetSimdLevel();
+    printf("Pixel SIMD level = %u\n", nSupportedLevel);
+
+    // The mask is white where the color image has the color key, and the color image is
+    // turned to black there.
+    const int nSize = 64;
+    const COLORREF crKey = RGB(255, 0, 255);
+    vector<UINT32> vctPixels(nSize * nSize);
+    for (int i = 0; i < nSize * nSize; ++i)
+    {
+        vctPixels[i] = (0 == (i % 3)) ? 0xFFFF00FF : 0xFF000000 | (i * 2654435761u >> 8);
+    }
+
+    BITMAPINFO bmi = { 0 };
+    bmi.bmiHeader.biSize        = sizeof(BITMAPINFOHEADER);
+    bmi.bmiHeader.biWidth       = nSize;
+    bmi.bmiHeader.biHeight      = -nSize;
+    bmi.bmiHeader.biPlanes      = 1;
+    bmi.bmiHeader.biBitCount    = 32;
+    bmi.bmiHeader.biCompression = BI_RGB;
+
+    VOID *pBits = NULL;
+    HBITMAP hbmColor = CreateDIBSection(NULL, &bmi, DIB_RGB_COLORS, &pBits, NULL, 0);
+    memcpy(pBits, &vctPixels[0], vctPixels.size() * 4);
+    HBITMAP hbmMask = SdkImagesManager::CreateBitmapMask(hbmColor, crKey);
+
+    HDC hdcMem = CreateCompatibleDC(NULL);
+    HGDIOBJ hbmOld = SelectObject(hdcMem, hbmMask);
+    DWORD dwFailCount = 0;
+    for (int i = 0; i < nSize * nSize; ++i)
+    {
+        BOOL isKey = (0xFFFF00FF == vctPixels[i]);
+        COLORREF crMask = GetPixel(hdcMem, i % nSize, i / nSize);
+        UINT32 uColor = ((UINT32*)pBits)[i] & 0xFFFFFF;
+        dwFailCount += (isKey == (RGB(255, 255, 255) == crMask)) ? 0 : 1;
+        dwFailCount += (!isKey || (0 == uColor)) ? 0 : 1;
+    }
+    SelectObject(hdcMem, hbmOld);
+    DeleteDC(hdcMem);
+    DeleteObject(hbmMask);
+    DeleteObject(hbmColor);
+    printf("Color key mask:    %s\n", (0 == dwFailCount) ? "OK" : "FAILED");
+
+    SdkImagesManager imagesManager;
+    if ( !imagesManager.LoadImageFromFile(lpImagePath) )
+    {
+        printf("Load image:        FAILED\n");
+        SdkImagesManager::UnGdiplusInitialize();
+        return;
+    }
+
+    LARGE_INTEGER liFrequency, liBegin, liEnd;
+    QueryPerformanceFrequency(&liFrequency);
+
+    const LPCSTR filterNames[] = { "box", "bilinear", "lanczos" };
+    for (int nFilter = PIXEL_RESIZE_BOX; nFilter <= PIXEL_RESIZE_LANCZOS; ++nFilter)
+    {
+        DOUBLE dSeconds[2] = { 0 };
+        for (int n = 0; n < 2; ++n)
+        {
+            SdkPixelKernels::SetSimdLevel((0 == n) ? PIXEL_SIMD_NONE : nSupportedLevel);
+            QueryPerformanceCounter(&liBegin);
+            for (int j = 0; j < nResizeCount; ++j)
+            {
+                SdkImagesManager copyManager(imagesManager);
+                copyManager.ResizeTo(0.5f, (PIXEL_RESIZE_FILTER)nFilter);
+            }
+            QueryPerformanceCounter(&liEnd);
+            dSeconds[n] = (DOUBLE)(liEnd.QuadPart - liBegin.QuadPart) / liFrequency.QuadPart;
+        }
+
+        printf("Resize %-10s scalar %.3f ms, SIMD %.3f ms (%.1fx)\n", filterNames[nFilter],
+            dSeconds[0] * 1000 / nResizeCount, dSeconds[1] * 1000 / nResizeCount, dSeconds[0] / dSeconds[1]);
+    }
+
+    SdkPixelKernels::SetSimdLevel(nSupportedLevel);
+    SdkImagesManager::UnGdiplusInitialize();
+}
+
+//////////////////////////////////////////////////////////////////////////
+
+void TestThumbnailStore()
+{
+    const LPCWSTR lpFolderPath = L"D:\\Pictures";
+    const UINT nSize = 256;
+
+    if ( !SdkThumbnailStore::Open() )
+    {
+        printf("Open thumbnail store FAILED\n");
+        return;
+    }
+
+    LARGE_INTEGER liFrequency, liBegin, liEnd;
+    QueryPerformanceFrequency(&liFrequency);
+
+    // The first pass extracts the thumbnails from the shell and stores them, the second
+    // pass finds them in the store.
+    for (int nPass = 0; nPass < 2; ++nPass)
+    {
+        THUMBNAILSTORESTATS statsBefore = { 0 };
+        SdkThumbnailStore::GetStats(&statsBefore);
+
+        WCHAR szPattern[MAX_PATH] = { 0 };
+        PathCombine(szPattern, lpFolderPath, L"*.*");
+
+        UINT32 uCount = 0;
+        WIN32_FIND_DATAW findData = { 0 };
+        QueryPerformanceCounter(&liBegin);
+        HANDLE hFind = FindFirstFileW(szPattern, &findData);
+        BOOL hasFile = (INVALID_HANDLE_VALUE != hFind);
+        while (hasFile)
+        {
+            if (0 == (findData.dwFileAttributes & FILE_ATTRIBUTE_DIRECTORY))
+            {
+                WCHAR szFilePath[MAX_PATH] = { 0 };
+                PathCombine(szFilePath, lpFolderPath, findData.cFileName);
+                HBITMAP hBitmap = SdkCommonHelper::ExtractFileThumbnail(szFilePath, nSize, nSize);
+                if (NULL != hBitmap)
+                {
+                    DeleteObject(hBitmap);
+                    ++uCount;
+                }
+            }
+
+            hasFile = FindNextFileW(hFind, &findData);
+        }
+        if (INVALID_HANDLE_VALUE != hFind)
+        {
+            FindClose(hFind);
+        }
+        QueryPerformanceCounter(&liEnd);
+
+        THUMBNAILSTORESTATS stats = { 0 };
+        SdkThumbnailStore::GetStats(&stats);
+        printf("Pass %d: %u thumbnails in %.1f ms, hits = %I64u, inserts = %I64u\n", nPass + 1, uCount,
+            (DOUBLE)(liEnd.QuadPart - liBegin.QuadPart) * 1000 / liFrequency.QuadPart,
+            stats.uHits - statsBefore.uHits, stats.uInserts - statsBefore.uInserts);
+    }
+
+    THUMBNAILSTORESTATS stats = { 0 };
+    SdkThumbnailStore::GetStats(&stats);
+    printf("Entries = %u, data = %I64u bytes, dead = %I64u bytes\n", stats.uEntries, stats.uDataBytes, stats.uDeadBytes);
+
+    SdkThumbnailStore::StartCompaction();
+    SdkThumbnailStore::Close();
+}
+
+//////////////////////////////////////////////////////////////////////////
+
+void TestImageBatchConverter()
+{
+    const LPCWSTR lpFolderPath = L"D:\\Pictures";
+    const LPCWSTR lpTargetPath = L"D:\\Pictures\\Converted";
+    const UINT32 nSize = 1024;
+
+    SdkWICImageHelper::WICInitialize();
+
+    SdkImageBatchConverter converter;
+    converter.SetFilter(PIXEL_RESIZE_LANCZOS);
+
+    WCHAR szPattern[MAX_PATH] = { 0 };
+    PathCombine(szPattern, lpFolderPath, L"*.jpg");
+
+    WIN32_FIND_DATAW findData = { 0 };
+    HANDLE hFind = FindFirstFileW(szPattern, &findData);
+    BOOL hasFile = (INVALID_HANDLE_VALUE != hFind);
+    while (hasFile)
+    {
+        if (0 == (findData.dwFileAttributes & FILE_ATTRIBUTE_DIRECTORY))
+        {
+            WCHAR szSrcPath[MAX_PATH] = { 0 };
+            WCHAR szDestPath[MAX_PATH] = { 0 };
+            PathCombine(szSrcPath, lpFolderPath, findData.cFileName);
+            PathCombine(szDestPath, lpTargetPath, findData.cFileName);
+            PathRemoveExtension(szDestPath);
+            converter.AddJob(szSrcPath, szDestPath, SAVETYPE_PNG, nSize, nSize);
+        }
+
+        hasFile = FindNextFileW(hFind, &findData);
+    }
+    if (INVALID_HANDLE_VALUE != hFind)
+    {
+        FindClose(hFind);
+    }
+
+    // The same jobs with one thread and with all processors, the second run should be faster.
+    // The bytes are reserved before decoding, the peak bytes never exceed the budget unless
+    // one image alone is larger.
+    const UINT64 uBudget = 64 * 1024 * 1024;
+    UINT32 uThreadCounts[2] = { 1, 0 };
+    for (int i = 0; i < 2; ++i)
+    {
+        BOOL isSucceeded = converter.Run(uThreadCounts[i], uBudget);
+
+        IMAGEBATCHSTATS stats = { 0 };
+        converter.GetStats(&stats);
+        printf("Run %d: %s, %u succeeded, %u failed, %.1f ms\n", i + 1, isSucceeded ? "OK" : "FAILED",
+            stats.uSucceeded, stats.uFailed, (DOUBLE)stats.uElapsedTime / 1000);
+        printf("    decode = %.1f ms, resize = %.1f ms, encode = %.1f ms, peak = %I64u bytes\n",
+            (DOUBLE)stats.uDecodeTime / 1000, (DOUBLE)stats.uResizeTime / 1000,
+            (DOUBLE)stats.uEncodeTime / 1000, stats.uPeakBytes);
+        printf("    budget: %s\n", (stats.uPeakBytes <= uBudget) ? "OK" : "EXCEEDED (an image larger than the budget?)");
+    }
+
+    converter.ClearJobs();
+    SdkWICImageHelper::WICUninitialize();
+}
+
+//////////////////////////////////////////////////////////////////////////
+
+static const int g_nResImageIds[] =
+{
+    IDB_BUTTON_BK_NORMAL,   IDB_BUTTON_BK_HOVER,      IDB_BUTTON_BK_DOWN,      IDB_BUTTON_BK_DISABLE,
+    IDB_COMBOBOX_NORMAL,    IDB_COMBOBOX_HOVER,       IDB_COMBOBOX_DOWN,       IDB_COMBOBOX_DISABLE,
+    IDB_RADIOBUTOTN_NORMAL, IDB_RADIOBUTOTN_HOVER,    IDB_RADIOBUTOTN_DOWN,    IDB_RADIOBUTOTN_DISABLE,
+    IDB_CHECKBOX_NORMAL,    IDB_CHECKBOX_HOVER,       IDB_CHECKBOX_DOWN,       IDB_CHECKBOX_DISABLE,
+    IDB_TAB_NORMAL,         IDB_TAB_NORMAL_HOVER,     IDB_TAB_NORMAL_PRESS,    IDB_TAB_SELECT,
+};
+
+struct RESMANAGERTHREAD
+{
+    HANDLE      hStartEvent;                        // All threads start at the same time.
+    int         nThreadIndex;                       // The index of the thread.
+    HBITMAP     hSameKeyBitmap;                     // The bitmap of the key which all threads get.
+    HBITMAP     hBitmaps[ARRAYSIZE(g_nResImageIds)];// The bitmaps of all keys.
+};
+
+unsigned int WINAPI ResManagerThreadProc(LPVOID lpParam)
+{
+    RESMANAGERTHREAD *pData = (RESMANAGERTHREAD*)lpParam;
+    const int nCount = ARRAYSIZE(g_nResImageIds);
+
+    WaitForSingleObject(pData->hStartEvent, INFINITE);
+
+    // First all threads race on one key, then each thread starts from another key.
+    pData->hSameKeyBitmap = SdkResManager::GetImage(g_nResImageIds[0]);
+    for (int i = 0; i < nCount; ++i)
+    {
+        int nIndex = (i + pData->nThreadIndex) % nCount;
+        pData->hBitmaps[nIndex] = SdkResManager::GetImage(g_nResImageIds[nIndex]);
+    }
+
+    return 0;
+}
+
+void TestResManagerCache()
+{
+    const int nThreadCount = 8;
+    const int nRoundCount  = 20;
+    const int nImageCount  = ARRAYSIZE(g_nResImageIds);
+
+    SdkWICImageHelper::WICInitialize();
+
+    // Every round begins with an empty cache, so the threads decode the same images together.
+    DWORD dwBaseObjects = GetGuiResources(GetCurrentProcess(), GR_GDIOBJECTS);
+    BOOL isSameKeyOK = TRUE;
+    BOOL isOtherKeysOK = TRUE;
+    BOOL isNoLeak = TRUE;
+
+    for (int nRound = 0; (nRound < nRoundCount) && SdkResManager::LoadResLibrary(); ++nRound)
+    {
+        DWORD dwModuleObjects = GetGuiResources(GetCurrentProcess(), GR_GDIOBJECTS);
+        HANDLE hStartEvent = CreateEvent(NULL, TRUE, FALSE, NULL);
+        HANDLE hThreads[nThreadCount] = { 0 };
+        RESMANAGERTHREAD threadData[nThreadCount];
+        ZeroMemory(threadData, sizeof(threadData));
+
+        for (int i = 0; i < nThreadCount; ++i)
+        {
+            unsigned int nThreadId = 0;
+            threadData[i].hStartEvent  = hStartEvent;
+            threadData[i].nThreadIndex = i;
+            hThreads[i] = chBEGINTHREADEX(NULL, 0, ResManagerThreadProc, &threadData[i], 0, &nThreadId);
+        }
+
+        SetEvent(hStartEvent);
+        WaitForMultipleObjects(nThreadCount, hThreads, TRUE, INFINITE);
+
+        // The first inserted bitmap is returned to every thread, the bitmaps of the losers
+        // are deleted, so the cache holds one GDI object per image.
+        int nLoaded = 0;
+        for (int j = 0; j < nImageCount; ++j)
+        {
+            HBITMAP hCached = SdkResManager::GetImage(g_nResImageIds[j]);
+            nLoaded += (NULL != hCached) ? 1 : 0;
+            for (int i = 0; i < nThreadCount; ++i)
+            {
+                isOtherKeysOK = isOtherKeysOK && (NULL != hCached) && (threadData[i].hBitmaps[j] == hCached);
+            }
+        }
+
+        for (int i = 0; i < nThreadCount; ++i)
+        {
+            isSameKeyOK = isSameKeyOK && (NULL != threadData[i].hSameKeyBitmap) &&
+                          (threadData[i].hSameKeyBitmap == threadData[0].hBitmaps[0]);
+            SAFE_CLOSE_HANDLE(hThreads[i]);
+        }
+        SAFE_CLOSE_HANDLE(hStartEvent);
+
+        isNoLeak = isNoLeak && (GetGuiResources(GetCurrentProcess(), GR_GDIOBJECTS) == dwModuleObjects + nLoaded);
+
+        SdkResManager::FreeResLibrary();
+    }
+
+    isNoLeak = isNoLeak && (GetGuiResources(GetCurrentProcess(), GR_GDIOBJECTS) == dwBaseObjects);
+
+    printf("Same key:          %s\n", isSameKeyOK ? "OK" : "FAILED");
+    printf("Different keys:    %s\n", isOtherKeysOK ? "OK" : "FAILED");
+    printf("No leaked bitmap:  %s\n", isNoLeak ? "OK" : "FAILED");
+
+    SdkWICImageHelper::WICUninitialize();
+}
+
+//////////////////////////////////////////////////////////////////////////
+
+unsigned int WINAPI ResManagerPreloadThreadProc(LPVOID lpParam)
+{
+    *(int*)lpParam = SdkResManager::PreloadImages(IDR_PRELOAD_IMAGES);
+    return 0;
+}
+
+void TestResManagerPreload()
+{
+    const int nImageCount = ARRAYSIZE(g_nResImageIds);
+
+    SdkWICImageHelper::WICInitialize();
+
+    DWORD dwBaseObjects = GetGuiResources(GetCurrentProcess(), GR_GDIOBJECTS);
+    BOOL isPreloadOK = FALSE;
+    BOOL isCacheHitOK = TRUE;
+    BOOL isRaceOK = TRUE;
+
+    if ( SdkResManager::LoadResLibrary() )
+    {
+        // The manifest is loaded on the main thread, every image is decoded once.
+        DWORD dwModuleObjects = GetGuiResources(GetCurrentProcess(), GR_GDIOBJECTS);
+        int nPreloaded = SdkResManager::PreloadImages(IDR_PRELOAD_IMAGES);
+        DWORD dwPreloadObjects = GetGuiResources(GetCurrentProcess(), GR_GDIOBJECTS);
+        isPreloadOK = (nPreloaded > 0) && (dwPreloadObjects == dwModuleObjects + nPreloaded);
+
+        // The images of the manifest are served from the cache, loading it again decodes nothing.
+        for (int j = 0; j < nImageCount; ++j)
+        {
+            isCacheHitOK = isCacheHitOK && (NULL != SdkResManager::GetImage(g_nResImageIds[j]));
+        }
+        isCacheHitOK = isCacheHitOK && (SdkResManager::PreloadImages(IDR_PRELOAD_IMAGES) == nPreloaded);
+        isCacheHitOK = isCacheHitOK && (GetGuiResources(GetCurrentProcess(), GR_GDIOBJECTS) == dwPreloadObjects);
+        isPreloadOK = isPreloadOK && (-1 == SdkResManager::PreloadImages(IDB_BUTTON_BK_NORMAL));
+
+        SdkResManager::FreeResLibrary();
+        isPreloadOK = isPreloadOK && (GetGuiResources(GetCurrentProcess(), GR_GDIOBJECTS) == dwBaseObjects);
+    }
+
+    if ( SdkResManager::LoadResLibrary() )
+    {
+        // The manifest is loaded on a background thread while the views get their images.
+        DWORD dwModuleObjects = GetGuiResources(GetCurrentProcess(), GR_GDIOBJECTS);
+        HBITMAP hBitmaps[nImageCount] = { 0 };
+        int nPreloaded = 0;
+        unsigned int nThreadId = 0;
+        HANDLE hThread = chBEGINTHREADEX(NULL, 0, ResManagerPreloadThreadProc, &nPreloaded, 0, &nThreadId);
+
+        for (int j = 0; j < nImageCount; ++j)
+        {
+            hBitmaps[j] = SdkResManager::GetImage(g_nResImageIds[j]);
+        }
+
+        WaitForSingleObject(hThread, INFINITE);
+        SAFE_CLOSE_HANDLE(hThread);
+
+        for (int j = 0; j < nImageCount; ++j)
+        {
+            isRaceOK = isRaceOK && (NULL != hBitmaps[j]) && (SdkResManager::GetImage(g_nResImageIds[j]) == hBitmaps[j]);
+        }
+        isRaceOK = isRaceOK && (nPreloaded > 0);
+        isRaceOK = isRaceOK && (GetGuiResources(GetCurrentProcess(), GR_GDIOBJECTS) == dwModuleObjects + nPreloaded);
+
+        SdkResManager::FreeResLibrary();
+        isRaceOK = isRaceOK && (GetGuiResources(GetCurrentProcess(), GR_GDIOBJECTS) == dwBaseObjects);
+    }
+
+    printf("Preload manifest:  %s\n", isPreloadOK ? "OK" : "FAILED");
+    printf("Cache hit:         %s\n", isCacheHitOK ? "OK" : "FAILED");
+    printf("Preload and get:   %s\n", isRaceOK ? "OK" : "FAILED");
+
+    SdkWICImageHelper::WICUninitialize();
+}
+
 //////////////////////////////////////////////////////////////////////////
 
 int _tmain(int argc, _TCHAR* argv[])
@@ -397,10 +2461,29 @@ int _tmain(int argc, _TCHAR* argv[])
     CoInitialize(NULL);
 
     //TestCryptFileClass();
+    //TestParallelCryptFile();
+    //TestAuthenticatedCryptFile();
+    //TestCryptFileReader();
+    //TestInPlaceCryptFile();
+    //TestAsyncIOCryptFile();
+    //TestBatchCryptFile();
+    //TestCryptKeyCache();
+    //TestBase64Util();
+    //TestBase64Stream();
+    //TestWICImageCache();
+    //TestImageDecodeService();
+    //TestReducedDecode();
+    //TestGifDecoder();
+    //TestPixelKernels();
+    //TestThumbnailStore();
+    //TestImageBatchConverter();
+    //TestResManagerCache();
+    //TestResManagerPreload();
     //TestProgressDialog();
 
     //TestGetUserInfo();
     //TestCrypt();
+    //TestCryptBackend();
     //TestMediaContent();
     //TestMediaInfoProvider();
 
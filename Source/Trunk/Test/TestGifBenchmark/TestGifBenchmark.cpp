@@ -0,0 +1,579 @@
+// TestGifBenchmark.cpp : Benchmark of the frame decoding of SdkGifDecoder.
+//
+// The decoder does not use Windows, so the benchmark also runs headless on Linux:
+//
+//   g++ -O2 -I Test/TestGifBenchmark -I SdkCommonLib/Src/Include -o gifbench
+//       Test/TestGifBenchmark/TestGifBenchmark.cpp SdkCommonLib/Src/Src/SdkGifDecoder.cpp
+//   ./gifbench [-n repeat] [file or directory]...
+//
+// Without any file a synthetic corpus is generated. Every frame is composed with the scalar
+// code and the SIMD code, the results must be the same. The broken LZW streams and the
+// truncated or corrupted copies of a synthetic GIF are decoded too, build with
+// -fsanitize=address to check that they stay in the buffers.
+//
+
+#include "stdafx.h"
+#include "SdkGifDecoder.h"
+
+using namespace std;
+USING_NAMESPACE_UTILITIES
+
+typedef struct _GIFBENCHRESULT
+{
+    size_t  nFrames;                    // The frames which are decoded.
+    double  dPixels;                    // The pixels of the frames.
+    double  dLzwSeconds;                // The time of the LZW decoding.
+    double  dScalarSeconds;             // The time of the composing with the scalar code.
+    double  dSimdSeconds;               // The time of the composing with the SIMD code.
+
+} GIFBENCHRESULT;
+
+
+//////////////////////////////////////////////////////////////////////////
+
+static double GetSeconds()
+{
+#ifdef _WIN32
+    LARGE_INTEGER liFrequency, liCounter;
+    QueryPerformanceFrequency(&liFrequency);
+    QueryPerformanceCounter(&liCounter);
+    return (double)liCounter.QuadPart / liFrequency.QuadPart;
+#else
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+#endif // _WIN32
+}
+
+//////////////////////////////////////////////////////////////////////////
+
+static BOOL ReadFileData(const string &strPath, vector<BYTE> &vctData)
+{
+    FILE *pFile = fopen(strPath.c_str(), "rb");
+    if (NULL == pFile)
+    {
+        return FALSE;
+    }
+
+    BYTE buffer[64 * 1024];
+    size_t nRead = 0;
+    vctData.clear();
+    while ((nRead = fread(buffer, 1, sizeof(buffer), pFile)) > 0)
+    {
+        vctData.insert(vctData.end(), buffer, buffer + nRead);
+    }
+    fclose(pFile);
+
+    return TRUE;
+}
+
+//////////////////////////////////////////////////////////////////////////
+
+static void ListGifFiles(const string &strPath, vector<string> &vctFiles)
+{
+#ifdef _WIN32
+    WIN32_FIND_DATAA findData;
+    HANDLE hFind = FindFirstFileA((strPath + "\\*.gif").c_str(), &findData);
+    if (INVALID_HANDLE_VALUE != hFind)
+    {
+        do
+        {
+            vctFiles.push_back(strPath + "\\" + findData.cFileName);
+        } while (FindNextFileA(hFind, &findData));
+        FindClose(hFind);
+        return;
+    }
+#else
+    DIR *pDir = opendir(strPath.c_str());
+    if (NULL != pDir)
+    {
+        struct dirent *pEntry = NULL;
+        while (NULL != (pEntry = readdir(pDir)))
+        {
+            string strName = pEntry->d_name;
+            if ( (strName.size() > 4) && (0 == strcasecmp(strName.c_str() + strName.size() - 4, ".gif")) )
+            {
+                vctFiles.push_back(strPath + "/" + strName);
+            }
+        }
+        closedir(pDir);
+        return;
+    }
+#endif // _WIN32
+
+    vctFiles.push_back(strPath);
+}
+
+
+//////////////////////////////////////////////////////////////////////////
+//
+// The synthetic corpus, the frames cover the interlaced rows, the transparency, the
+// local color tables and all disposal methods.
+//
+//////////////////////////////////////////////////////////////////////////
+
+static void PutWord(vector<BYTE> &vctOut, UINT uValue)
+{
+    vctOut.push_back((BYTE)(uValue & 0xFF));
+    vctOut.push_back((BYTE)(uValue >> 8));
+}
+
+//////////////////////////////////////////////////////////////////////////
+
+static void PutCode(vector<BYTE> &vctBytes, UINT32 &uBits, UINT &uBitCount, UINT uCode, UINT uCodeSize)
+{
+    uBits |= uCode << uBitCount;
+    uBitCount += uCodeSize;
+    while (uBitCount >= 8)
+    {
+        vctBytes.push_back((BYTE)(uBits & 0xFF));
+        uBits >>= 8;
+        uBitCount -= 8;
+    }
+}
+
+//////////////////////////////////////////////////////////////////////////
+
+static void PutLzwData(vector<BYTE> &vctOut, const vector<BYTE> &vctIndices, UINT uMinCodeSize)
+{
+    const UINT uClearCode = 1u << uMinCodeSize;
+    vector<unsigned short> vctTable(4096 * 256, 0);
+    vector<BYTE> vctBytes;
+    UINT32 uBits = 0;
+    UINT uBitCount = 0;
+    UINT uCodeSize = uMinCodeSize + 1;
+    UINT uNextCode = uClearCode + 2;
+
+    PutCode(vctBytes, uBits, uBitCount, uClearCode, uCodeSize);
+    UINT uPrefix = vctIndices[0];
+    for (size_t i = 1; i < vctIndices.size(); ++i)
+    {
+        BYTE k = vctIndices[i];
+        unsigned short uCode = vctTable[uPrefix * 256 + k];
+        if (0 != uCode)
+        {
+            uPrefix = uCode;
+            continue;
+        }
+
+        // The decoder adds the string when it reads the next code, so the code size grows
+        // one code later than the table of the encoder.
+        PutCode(vctBytes, uBits, uBitCount, uPrefix, uCodeSize);
+        vctTable[uPrefix * 256 + k] = (unsigned short)uNextCode++;
+        if ( (uNextCode > (1u << uCodeSize)) && (uCodeSize < 12) )
+        {
+            ++uCodeSize;
+        }
+        if (4096 == uNextCode)
+        {
+            PutCode(vctBytes, uBits, uBitCount, uClearCode, uCodeSize);
+            fill(vctTable.begin(), vctTable.end(), 0);
+            uCodeSize = uMinCodeSize + 1;
+            uNextCode = uClearCode + 2;
+        }
+        uPrefix = k;
+    }
+
+    PutCode(vctBytes, uBits, uBitCount, uPrefix, uCodeSize);
+    if ( (uNextCode + 1 > (1u << uCodeSize)) && (uCodeSize < 12) )
+    {
+        ++uCodeSize;
+    }
+    PutCode(vctBytes, uBits, uBitCount, uClearCode + 1, uCodeSize);
+    if (uBitCount > 0)
+    {
+        vctBytes.push_back((BYTE)(uBits & 0xFF));
+    }
+
+    vctOut.push_back((BYTE)uMinCodeSize);
+    for (size_t i = 0; i < vctBytes.size(); i += 255)
+    {
+        size_t cbBlock = (vctBytes.size() - i < 255) ? vctBytes.size() - i : 255;
+        vctOut.push_back((BYTE)cbBlock);
+        vctOut.insert(vctOut.end(), vctBytes.begin() + i, vctBytes.begin() + i + cbBlock);
+    }
+    vctOut.push_back(0);
+}
+
+//////////////////////////////////////////////////////////////////////////
+
+static void MakeSyntheticGif(UINT uWidth, UINT uHeight, UINT uFrames, UINT32 uSeed, vector<BYTE> &vctOut)
+{
+    vctOut.clear();
+    vctOut.insert(vctOut.end(), (const BYTE*)"GIF89a", (const BYTE*)"GIF89a" + 6);
+    PutWord(vctOut, uWidth);
+    PutWord(vctOut, uHeight);
+    vctOut.push_back(0xF7);             // The global color table of 256 colors.
+    vctOut.push_back(0);
+    vctOut.push_back(0);
+    for (UINT i = 0; i < 256; ++i)
+    {
+        vctOut.push_back((BYTE)i);
+        vctOut.push_back((BYTE)(255 - i));
+        vctOut.push_back((BYTE)(i * 7));
+    }
+
+    const BYTE netscape[] = { 0x21, 0xFF, 11, 'N', 'E', 'T', 'S', 'C', 'A', 'P', 'E', '2', '.', '0', 3, 1, 0, 0, 0 };
+    vctOut.insert(vctOut.end(), netscape, netscape + sizeof(netscape));
+
+    for (UINT uFrame = 0; uFrame < uFrames; ++uFrame)
+    {
+        // The first frame covers the canvas, the others are smaller and move around.
+        UINT uFrameWidth  = (0 == uFrame) ? uWidth  : uWidth / 2 + (uFrame * 13) % (uWidth / 2);
+        UINT uFrameHeight = (0 == uFrame) ? uHeight : uHeight / 2 + (uFrame * 7) % (uHeight / 2);
+        UINT uLeft = (uWidth - uFrameWidth) * (uFrame % 3) / 2;
+        UINT uTop  = (uHeight - uFrameHeight) * ((uFrame / 3) % 3) / 2;
+        BOOL hasTransparency = (0 != uFrame % 2);
+        BOOL isInterlaced = (0 == uFrame % 3);
+        BOOL hasLocalPalette = (2 == uFrame % 4);
+        UINT uDisposal = uFrame % 4;
+
+        BYTE control[] = { 0x21, 0xF9, 4, (BYTE)((uDisposal << 2) | (hasTransparency ? 1 : 0)), 4, 0, 0x10, 0 };
+        vctOut.insert(vctOut.end(), control, control + sizeof(control));
+
+        vctOut.push_back(0x2C);
+        PutWord(vctOut, uLeft);
+        PutWord(vctOut, uTop);
+        PutWord(vctOut, uFrameWidth);
+        PutWord(vctOut, uFrameHeight);
+        vctOut.push_back((BYTE)((hasLocalPalette ? 0x87 : 0) | (isInterlaced ? 0x40 : 0)));
+        if (hasLocalPalette)
+        {
+            for (UINT i = 0; i < 256; ++i)
+            {
+                vctOut.push_back((BYTE)(i * 3));
+                vctOut.push_back((BYTE)i);
+                vctOut.push_back((BYTE)(255 - i));
+            }
+        }
+
+        // Smooth areas like a cartoon with some noise, the rows of an interlaced frame are
+        // written in the order of the passes.
+        vector<BYTE> vctRows((size_t)uFrameWidth * uFrameHeight);
+        for (UINT y = 0; y < uFrameHeight; ++y)
+        {
+            for (UINT x = 0; x < uFrameWidth; ++x)
+            {
+                uSeed = uSeed * 1103515245 + 12345;
+                BYTE index = (BYTE)(((x + uFrame * 5) / 24 + (y / 16) * 9) & 0xFF);
+                vctRows[(size_t)y * uFrameWidth + x] = (0 == (uSeed >> 28)) ? (BYTE)(uSeed >> 16) : index;
+            }
+        }
+
+        vector<BYTE> vctIndices;
+        if (isInterlaced)
+        {
+            const UINT passStart[4] = { 0, 4, 2, 1 };
+            const UINT passStep[4]  = { 8, 8, 4, 2 };
+            for (int nPass = 0; nPass < 4; ++nPass)
+            {
+                for (UINT y = passStart[nPass]; y < uFrameHeight; y += passStep[nPass])
+                {
+                    vctIndices.insert(vctIndices.end(), vctRows.begin() + (size_t)y * uFrameWidth, vctRows.begin() + (size_t)(y + 1) * uFrameWidth);
+                }
+            }
+        }
+        else
+        {
+            vctIndices.swap(vctRows);
+        }
+
+        PutLzwData(vctOut, vctIndices, 8);
+    }
+
+    vctOut.push_back(0x3B);
+}
+
+
+//////////////////////////////////////////////////////////////////////////
+
+static void MakeRunGif(UINT uWidth, UINT uRunCodes, vector<BYTE> &vctOut)
+{
+    // One row of zeros, each code after the first is the next code of the table, so every
+    // string is the previous one and its first byte. The last string is longer than the rest
+    // of the frame.
+    vctOut.clear();
+    vctOut.insert(vctOut.end(), (const BYTE*)"GIF89a", (const BYTE*)"GIF89a" + 6);
+    PutWord(vctOut, uWidth);
+    PutWord(vctOut, 1);
+    vctOut.push_back(0x81);             // The global color table of 4 colors.
+    vctOut.push_back(0);
+    vctOut.push_back(0);
+    for (UINT i = 0; i < 4 * 3; ++i)
+    {
+        vctOut.push_back((BYTE)(i * 20));
+    }
+
+    vctOut.push_back(0x2C);
+    PutWord(vctOut, 0);
+    PutWord(vctOut, 0);
+    PutWord(vctOut, uWidth);
+    PutWord(vctOut, 1);
+    vctOut.push_back(0);
+
+    const UINT uMinCodeSize = 2;
+    vector<BYTE> vctBytes;
+    UINT32 uBits = 0;
+    UINT uBitCount = 0;
+    UINT uCodeSize = uMinCodeSize + 1;
+    UINT uNextCode = (1u << uMinCodeSize) + 2;
+
+    PutCode(vctBytes, uBits, uBitCount, 1u << uMinCodeSize, uCodeSize);
+    PutCode(vctBytes, uBits, uBitCount, 0, uCodeSize);
+    for (UINT i = 0; i < uRunCodes; ++i)
+    {
+        PutCode(vctBytes, uBits, uBitCount, uNextCode, uCodeSize);
+        if ( (++uNextCode == (1u << uCodeSize)) && (uCodeSize < 12) )
+        {
+            ++uCodeSize;
+        }
+    }
+    if (uBitCount > 0)
+    {
+        vctBytes.push_back((BYTE)(uBits & 0xFF));
+    }
+
+    vctOut.push_back((BYTE)uMinCodeSize);
+    for (size_t i = 0; i < vctBytes.size(); i += 255)
+    {
+        size_t cbBlock = (vctBytes.size() - i < 255) ? vctBytes.size() - i : 255;
+        vctOut.push_back((BYTE)cbBlock);
+        vctOut.insert(vctOut.end(), vctBytes.begin() + i, vctBytes.begin() + i + cbBlock);
+    }
+    vctOut.push_back(0);
+    vctOut.push_back(0x3B);
+}
+
+//////////////////////////////////////////////////////////////////////////
+
+static BOOL DecodeAllFrames(const vector<BYTE> &vctData)
+{
+    SdkGifDecoder decoder;
+    if ( !decoder.LoadFromMemory(vctData.empty() ? NULL : &vctData[0], vctData.size()) )
+    {
+        return FALSE;
+    }
+
+    UINT uWidth = decoder.GetWidth();
+    vector<BYTE> vctCanvas((size_t)uWidth * decoder.GetHeight() * 4);
+    for (UINT i = 0; (i < decoder.GetFrameCount()) && !vctCanvas.empty(); ++i)
+    {
+        decoder.ComposeFrame(i, &vctCanvas[0], uWidth * 4);
+    }
+
+    return TRUE;
+}
+
+//////////////////////////////////////////////////////////////////////////
+
+static BOOL CheckBrokenGifs()
+{
+    BOOL isSame = TRUE;
+
+    // The strings of 1 to n zeros fill n * (n + 1) / 2 pixels, the row leaves one more pixel
+    // for the next string, which is cut to it.
+    const UINT runs[] = { 5, 17, 20, 40, 90 };
+    for (size_t i = 0; i < sizeof(runs) / sizeof(runs[0]); ++i)
+    {
+        UINT uWidth = runs[i] * (runs[i] + 1) / 2 + 1;
+        vector<BYTE> vctData;
+        MakeRunGif(uWidth, runs[i], vctData);
+
+        SdkGifDecoder decoder;
+        vector<BYTE> vctIndices(uWidth, 0xFF);
+        BOOL isDecoded = decoder.LoadFromMemory(&vctData[0], vctData.size()) &&
+                         decoder.DecodeFrameIndices(0, &vctIndices[0]);
+        isSame = isSame && isDecoded && (vctIndices == vector<BYTE>(uWidth, 0));
+    }
+
+    // The truncated and corrupted copies of a synthetic GIF must not be read or written out
+    // of the buffers, the decoded pixels are not checked.
+    vector<BYTE> vctGif;
+    MakeSyntheticGif(96, 64, 12, 7, vctGif);
+    UINT32 uSeed = 2011;
+    for (int n = 0; n < 400; ++n)
+    {
+        vector<BYTE> vctBroken(vctGif);
+        uSeed = uSeed * 1103515245 + 12345;
+        if (0 == n % 4)
+        {
+            vctBroken.resize((uSeed >> 8) % vctGif.size());
+        }
+        else
+        {
+            for (int k = 0; k < 1 + n % 8; ++k)
+            {
+                uSeed = uSeed * 1103515245 + 12345;
+                vctBroken[(uSeed >> 8) % vctBroken.size()] ^= (BYTE)(1 + (uSeed >> 3) % 255);
+            }
+        }
+        DecodeAllFrames(vctBroken);
+    }
+
+    return isSame;
+}
+
+//////////////////////////////////////////////////////////////////////////
+
+static BOOL BenchmarkGif(const vector<BYTE> &vctData, int nRepeat, GIFBENCHRESULT &result)
+{
+    SdkGifDecoder decoder;
+    if ( !decoder.LoadFromMemory(vctData.empty() ? NULL : &vctData[0], vctData.size()) )
+    {
+        return FALSE;
+    }
+
+    UINT uWidth = decoder.GetWidth();
+    UINT uHeight = decoder.GetHeight();
+    UINT uFrameCount = decoder.GetFrameCount();
+    UINT32 nSupportedLevel = SdkGifDecoder::GetSimdLevel();
+    vector<BYTE> vctIndices((size_t)uWidth * uHeight);
+    vector<BYTE> vctScalar((size_t)uWidth * uHeight * 4);
+    vector<BYTE> vctSimd((size_t)uWidth * uHeight * 4);
+
+    // The SIMD code must give the same canvas as the scalar code.
+    BOOL isSame = TRUE;
+    for (UINT i = 0; i < uFrameCount; ++i)
+    {
+        SdkGifDecoder::SetSimdLevel(GIF_SIMD_NONE);
+        decoder.ComposeFrame(i, &vctScalar[0], uWidth * 4);
+        SdkGifDecoder::SetSimdLevel(nSupportedLevel);
+        decoder.ComposeFrame(i, &vctSimd[0], uWidth * 4);
+        isSame = isSame && (vctScalar == vctSimd);
+    }
+
+    memset(&result, 0, sizeof(result));
+    double dBegin = GetSeconds();
+    for (int n = 0; n < nRepeat; ++n)
+    {
+        for (UINT i = 0; i < uFrameCount; ++i)
+        {
+            GIF_FRAME_INFO info;
+            decoder.GetFrameInfo(i, info);
+            if ((size_t)info.uWidth * info.uHeight > vctIndices.size())
+            {
+                vctIndices.resize((size_t)info.uWidth * info.uHeight);
+            }
+            decoder.DecodeFrameIndices(i, &vctIndices[0]);
+        }
+    }
+    result.dLzwSeconds = GetSeconds() - dBegin;
+
+    UINT32 levels[2] = { GIF_SIMD_NONE, nSupportedLevel };
+    double seconds[2] = { 0 };
+    for (int nLevel = 0; nLevel < 2; ++nLevel)
+    {
+        SdkGifDecoder::SetSimdLevel(levels[nLevel]);
+        dBegin = GetSeconds();
+        for (int n = 0; n < nRepeat; ++n)
+        {
+            for (UINT i = 0; i < uFrameCount; ++i)
+            {
+                decoder.ComposeFrame(i, &vctSimd[0], uWidth * 4);
+            }
+        }
+        seconds[nLevel] = GetSeconds() - dBegin;
+    }
+    SdkGifDecoder::SetSimdLevel(nSupportedLevel);
+
+    result.nFrames        = (size_t)uFrameCount * nRepeat;
+    result.dPixels        = (double)uWidth * uHeight * result.nFrames;
+    result.dScalarSeconds = seconds[0];
+    result.dSimdSeconds   = seconds[1];
+
+    return isSame;
+}
+
+//////////////////////////////////////////////////////////////////////////
+
+int main(int argc, char* argv[])
+{
+    int nRepeat = 10;
+    vector<string> vctFiles;
+    for (int i = 1; i < argc; ++i)
+    {
+        if ( (0 == strcmp(argv[i], "-n")) && (i + 1 < argc) )
+        {
+            nRepeat = atoi(argv[++i]);
+            nRepeat = (nRepeat > 0) ? nRepeat : 1;
+        }
+        else
+        {
+            ListGifFiles(argv[i], vctFiles);
+        }
+    }
+
+    vector< vector<BYTE> > vctCorpus;
+    vector<string> vctNames;
+    if (vctFiles.empty())
+    {
+        const UINT sizes[][3] = { { 64, 64, 24 }, { 320, 240, 30 }, { 640, 480, 20 }, { 1280, 720, 8 } };
+        for (size_t i = 0; i < sizeof(sizes) / sizeof(sizes[0]); ++i)
+        {
+            char szName[64] = { 0 };
+            sprintf(szName, "synthetic %ux%u", sizes[i][0], sizes[i][1]);
+            vctCorpus.push_back(vector<BYTE>());
+            MakeSyntheticGif(sizes[i][0], sizes[i][1], sizes[i][2], (UINT32)(i + 1), vctCorpus.back());
+            vctNames.push_back(szName);
+        }
+    }
+    else
+    {
+        for (size_t i = 0; i < vctFiles.size(); ++i)
+        {
+            vctCorpus.push_back(vector<BYTE>());
+            if ( !ReadFileData(vctFiles[i], vctCorpus.back()) )
+            {
+                vctCorpus.pop_back();
+                continue;
+            }
+            vctNames.push_back(vctFiles[i]);
+        }
+    }
+
+    printf("GIF SIMD level = %u, repeat = %d\n", SdkGifDecoder::GetSimdLevel(), nRepeat);
+
+    BOOL isBrokenOk = CheckBrokenGifs();
+    printf("%-40s %7s\n", "broken LZW and corrupted files", isBrokenOk ? "OK" : "FAILED");
+
+    printf("%-40s %7s %10s %10s %10s %6s\n", "file", "frames", "LZW MP/s", "scalar", "SIMD", "check");
+
+    GIFBENCHRESULT total;
+    memset(&total, 0, sizeof(total));
+    int nFailCount = isBrokenOk ? 0 : 1;
+    for (size_t i = 0; i < vctCorpus.size(); ++i)
+    {
+        GIFBENCHRESULT result;
+        memset(&result, 0, sizeof(result));
+        BOOL isSame = BenchmarkGif(vctCorpus[i], nRepeat, result);
+        if (0 == result.nFrames)
+        {
+            printf("%-40s %7s\n", vctNames[i].c_str(), "not a GIF");
+            continue;
+        }
+        nFailCount += isSame ? 0 : 1;
+
+        double dMegaPixels = result.dPixels / 1e6;
+        printf("%-40s %7u %10.1f %10.1f %10.1f %6s\n", vctNames[i].c_str(), (UINT)(result.nFrames / nRepeat),
+            dMegaPixels / result.dLzwSeconds, dMegaPixels / result.dScalarSeconds, dMegaPixels / result.dSimdSeconds,
+            isSame ? "OK" : "FAILED");
+
+        total.nFrames        += result.nFrames;
+        total.dPixels        += result.dPixels;
+        total.dLzwSeconds    += result.dLzwSeconds;
+        total.dScalarSeconds += result.dScalarSeconds;
+        total.dSimdSeconds   += result.dSimdSeconds;
+    }
+
+    if (total.nFrames > 0)
+    {
+        double dMegaPixels = total.dPixels / 1e6;
+        printf("%-40s %7u %10.1f %10.1f %10.1f\n", "total (MP/s)", (UINT)(total.nFrames / nRepeat),
+            dMegaPixels / total.dLzwSeconds, dMegaPixels / total.dScalarSeconds, dMegaPixels / total.dSimdSeconds);
+        printf("%-40s %7s %10.3f %10.3f %10.3f\n", "total (ms/frame)", "",
+            total.dLzwSeconds * 1000 / total.nFrames, total.dScalarSeconds * 1000 / total.nFrames,
+            total.dSimdSeconds * 1000 / total.nFrames);
+    }
+
+    return (0 == nFailCount) ? 0 : 1;
+}
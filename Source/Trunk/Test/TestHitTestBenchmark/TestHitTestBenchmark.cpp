@@ -0,0 +1,190 @@
+// TestHitTestBenchmark.cpp : Benchmark of the mouse-move hit-testing of a layout with many children.
+//
+// The window is not created, the views only need the SdkWindow object. Link with SdkCommonLib
+// and SdkFrameworkLib:
+//
+//   TestHitTestBenchmark.exe [-n moves] [-c children]
+//
+// The children are placed in a grid and overlap their neighbours, so the z order decides the
+// event source. Every mouse move is tested with the linear scan and the hit-test index, the
+// event sources must be the same. Some children are moved and brought to front between the
+// moves, so the incremental update of the index is measured too.
+//
+
+#include "stdafx.h"
+#include "SdkCommonInclude.h"
+#include "SdkUICommonInclude.h"
+
+using namespace std;
+USING_NAMESPACE_VIEWS
+USING_NAMESPACE_WINDOW
+USING_NAMESPACE_UILIB
+
+#define HITBENCH_CELL_SIZE      20.0f           // The distance between the children.
+#define HITBENCH_VIEW_SIZE      28.0f           // The size of one child, larger than the distance.
+
+
+//////////////////////////////////////////////////////////////////////////
+
+static double GetSeconds()
+{
+    LARGE_INTEGER liFrequency, liCounter;
+    QueryPerformanceFrequency(&liFrequency);
+    QueryPerformanceCounter(&liCounter);
+    return (double)liCounter.QuadPart / liFrequency.QuadPart;
+}
+
+//////////////////////////////////////////////////////////////////////////
+
+static UINT32 NextRandom(UINT32 &uSeed)
+{
+    uSeed = uSeed * 1103515245 + 12345;
+    return (uSeed >> 8);
+}
+
+//////////////////////////////////////////////////////////////////////////
+
+static void ChangeChildren(SdkViewLayout *pLayout, int nMove, UINT32 &uSeed, FLOAT fWidth, FLOAT fHeight)
+{
+    int nCount = pLayout->GetChildCount();
+
+    // Move some children, such as dragging in a gallery.
+    for (int i = 0; i < 8; ++i)
+    {
+        SdkViewElement *pChild = NULL;
+        if ( pLayout->GetChildAt(NextRandom(uSeed) % nCount, &pChild) )
+        {
+            pChild->SetViewPos((FLOAT)(NextRandom(uSeed) % (UINT32)fWidth),
+                               (FLOAT)(NextRandom(uSeed) % (UINT32)fHeight));
+        }
+    }
+
+    // Bring one child to front now and then, the indices of the children change.
+    if ( 0 == (nMove % 256) )
+    {
+        SdkViewElement *pChild = NULL;
+        if ( pLayout->GetChildAt(NextRandom(uSeed) % nCount, &pChild) )
+        {
+            pLayout->BringViewToFront(pChild);
+        }
+    }
+}
+
+//////////////////////////////////////////////////////////////////////////
+
+static double RunMoves(SdkViewLayout *pLayout, int nMoves, vector<INT32> &vctSources,
+                       FLOAT fWidth, FLOAT fHeight)
+{
+    UINT32 uPointSeed = 2011;
+    UINT32 uChangeSeed = 1106;
+    vctSources.clear();
+
+    double dTime = 0.0;
+    for (int n = 0; n < nMoves; ++n)
+    {
+        ChangeChildren(pLayout, n, uChangeSeed, fWidth, fHeight);
+
+        LPARAM lParam = MAKELPARAM(NextRandom(uPointSeed) % (UINT32)fWidth,
+                                   NextRandom(uPointSeed) % (UINT32)fHeight);
+
+        double dStart = GetSeconds();
+        SdkViewElement *pSource = pLayout->FindEventSource(WM_MOUSEMOVE, 0, lParam);
+        dTime += GetSeconds() - dStart;
+
+        // Keep the index of the source, the views of the two runs are different objects.
+        vctSources.push_back((NULL != pSource) ? pLayout->GetIndexOfChild(pSource) : -1);
+    }
+
+    return dTime;
+}
+
+//////////////////////////////////////////////////////////////////////////
+
+static BOOL RunCase(UINT32 uChildCount, int nMoves)
+{
+    UINT32 uCols = (UINT32)sqrt((double)uChildCount);
+    uCols = (uCols > 0) ? uCols : 1;
+    UINT32 uRows = (uChildCount + uCols - 1) / uCols;
+    FLOAT fWidth = uCols * HITBENCH_CELL_SIZE + HITBENCH_VIEW_SIZE;
+    FLOAT fHeight = uRows * HITBENCH_CELL_SIZE + HITBENCH_VIEW_SIZE;
+
+    // The children are built twice, so both runs start with the same tree.
+    vector<INT32> vctLinearSources;
+    vector<INT32> vctIndexSources;
+    double dLinearTime = 0.0;
+    double dIndexTime = 0.0;
+    BOOL isSame = TRUE;
+
+    for (int nRun = 0; nRun < 2; ++nRun)
+    {
+        SdkWindowForm window;
+        SdkViewLayout *pLayout = new SdkViewLayout();
+        pLayout->SetLayoutInfo(0.0f, 0.0f, fWidth, fHeight);
+        pLayout->SetHitTestIndexEnable(1 == nRun);
+        window.AddView(pLayout);
+
+        for (UINT32 i = 0; i < uChildCount; ++i)
+        {
+            SdkViewElement *pChild = new SdkViewElement();
+            pChild->SetLayoutInfo((i % uCols) * HITBENCH_CELL_SIZE, (i / uCols) * HITBENCH_CELL_SIZE,
+                                  HITBENCH_VIEW_SIZE, HITBENCH_VIEW_SIZE);
+            pLayout->AddView(pChild);
+        }
+
+        vector<INT32> &vctSources = (0 == nRun) ? vctLinearSources : vctIndexSources;
+        double dTime = RunMoves(pLayout, nMoves, vctSources, fWidth, fHeight);
+
+        if (0 == nRun)
+        {
+            dLinearTime = dTime;
+        }
+        else
+        {
+            dIndexTime = dTime;
+        }
+    }
+
+    isSame = (vctLinearSources == vctIndexSources);
+
+    printf("%8u children  %6d moves  linear %9.2f us  index %9.2f us  %6.1fx  %s\n",
+        uChildCount, nMoves,
+        dLinearTime * 1e6 / nMoves, dIndexTime * 1e6 / nMoves,
+        (dIndexTime > 0.0) ? dLinearTime / dIndexTime : 0.0,
+        isSame ? "ok" : "MISMATCH");
+
+    return isSame;
+}
+
+//////////////////////////////////////////////////////////////////////////
+
+int _tmain(int argc, _TCHAR* argv[])
+{
+    int nMoves = 5000;
+    UINT32 uChildCount = 10000;
+    for (int i = 1; i < argc; ++i)
+    {
+        if ( (0 == _tcscmp(argv[i], _T("-n"))) && (i + 1 < argc) )
+        {
+            nMoves = _ttoi(argv[++i]);
+            nMoves = (nMoves > 0) ? nMoves : 1;
+        }
+        else if ( (0 == _tcscmp(argv[i], _T("-c"))) && (i + 1 < argc) )
+        {
+            int nCount = _ttoi(argv[++i]);
+            uChildCount = (nCount > 0) ? (UINT32)nCount : 1;
+        }
+    }
+
+    SdkUIRunTime::InitializeUIRunTime();
+
+    int nFailCount = 0;
+    const UINT32 childCounts[] = { 100, 1000, uChildCount };
+    for (size_t i = 0; i < sizeof(childCounts) / sizeof(childCounts[0]); ++i)
+    {
+        nFailCount += RunCase(childCounts[i], nMoves) ? 0 : 1;
+    }
+
+    SdkUIRunTime::UninitializeUIRunTime();
+
+    return (0 == nFailCount) ? 0 : 1;
+}
@@ -0,0 +1,69 @@
+// PaintFrame.cpp : The frames of TestPaintBenchmark and their comparison.
+//
+
+#include "PaintFrame.h"
+#include <stdlib.h>
+
+
+//////////////////////////////////////////////////////////////////////////
+
+void ResizePaintFrame(PAINTFRAME &frame, unsigned int uWidth, unsigned int uHeight)
+{
+    frame.uWidth  = uWidth;
+    frame.uHeight = uHeight;
+    frame.vctPixels.assign((size_t)uWidth * uHeight * 4, 0);
+}
+
+//////////////////////////////////////////////////////////////////////////
+
+bool ComparePaintFrames(const PAINTFRAME &frame1, const PAINTFRAME &frame2, int nTolerance, PAINTFRAMEDIFF &diff)
+{
+    diff.nDiffCount = 0;
+    diff.nMaxDiff   = 0;
+    diff.nFirstX    = -1;
+    diff.nFirstY    = -1;
+
+    bool isSameSize = (frame1.uWidth == frame2.uWidth) && (frame1.uHeight == frame2.uHeight) &&
+                      (frame1.vctPixels.size() == frame2.vctPixels.size()) &&
+                      (frame1.vctPixels.size() == (size_t)frame1.uWidth * frame1.uHeight * 4);
+    if (!isSameSize)
+    {
+        size_t nPixels1 = (size_t)frame1.uWidth * frame1.uHeight;
+        size_t nPixels2 = (size_t)frame2.uWidth * frame2.uHeight;
+        diff.nDiffCount = (int)((nPixels1 > nPixels2) ? nPixels1 : nPixels2);
+        diff.nMaxDiff   = 255;
+        diff.nFirstX    = 0;
+        diff.nFirstY    = 0;
+        return false;
+    }
+
+    // Count the pixels which have a channel out of the tolerance.
+    const unsigned char *pPixels1 = frame1.vctPixels.empty() ? NULL : &frame1.vctPixels[0];
+    const unsigned char *pPixels2 = frame2.vctPixels.empty() ? NULL : &frame2.vctPixels[0];
+    for (unsigned int y = 0; y < frame1.uHeight; ++y)
+    {
+        for (unsigned int x = 0; x < frame1.uWidth; ++x)
+        {
+            size_t nOffset = ((size_t)y * frame1.uWidth + x) * 4;
+            int nPixelDiff = 0;
+            for (size_t c = 0; c < 4; ++c)
+            {
+                int nDiff = abs((int)pPixels1[nOffset + c] - (int)pPixels2[nOffset + c]);
+                nPixelDiff = (nDiff > nPixelDiff) ? nDiff : nPixelDiff;
+            }
+
+            diff.nMaxDiff = (nPixelDiff > diff.nMaxDiff) ? nPixelDiff : diff.nMaxDiff;
+            if (nPixelDiff > nTolerance)
+            {
+                if (0 == diff.nDiffCount)
+                {
+                    diff.nFirstX = (int)x;
+                    diff.nFirstY = (int)y;
+                }
+                diff.nDiffCount++;
+            }
+        }
+    }
+
+    return (0 == diff.nDiffCount);
+}
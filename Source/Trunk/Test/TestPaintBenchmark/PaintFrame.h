@@ -0,0 +1,57 @@
+// PaintFrame.h : The frames of TestPaintBenchmark and their comparison.
+//
+// This file and PaintFrame.cpp use neither COM, WIC nor Direct2D, only the C++ library, so
+// the comparison can be built headless when the frames come from another rasterizer:
+//
+//   g++ -O2 -c -I Test/TestPaintBenchmark Test/TestPaintBenchmark/PaintFrame.cpp
+//
+
+#pragma once
+
+#include <vector>
+
+/*!
+* @brief The pixels of one frame, 32bpp premultiplied BGRA, the rows are packed.
+*/
+typedef struct _PAINTFRAME
+{
+    unsigned int                uWidth;         // The width of the frame.
+    unsigned int                uHeight;        // The height of the frame.
+    std::vector<unsigned char>  vctPixels;      // The pixels, uWidth * uHeight * 4 bytes.
+
+} PAINTFRAME;
+
+/*!
+* @brief The difference of two frames.
+*/
+typedef struct _PAINTFRAMEDIFF
+{
+    int         nDiffCount;             // The number of the pixels which have a channel out of the tolerance.
+    int         nMaxDiff;               // The max difference of one channel.
+    int         nFirstX;                // The x of the first pixel out of the tolerance, -1 if none.
+    int         nFirstY;                // The y of the first pixel out of the tolerance, -1 if none.
+
+} PAINTFRAMEDIFF;
+
+/*!
+* @brief Set the size of the frame and clear its pixels.
+*
+* @param frame          [ /O] The frame.
+* @param uWidth         [I/ ] The width of the frame.
+* @param uHeight        [I/ ] The height of the frame.
+*/
+void ResizePaintFrame(PAINTFRAME &frame, unsigned int uWidth, unsigned int uHeight);
+
+/*!
+* @brief Compare two frames.
+*
+* @param frame1         [I/ ] The first frame.
+* @param frame2         [I/ ] The second frame.
+* @param nTolerance     [I/ ] The max difference of one channel which is still the same.
+* @param diff           [ /O] The difference.
+*
+* @return true if the frames have the same size and no pixel is out of the tolerance.
+*
+* @remark The frames of the different sizes differ in every pixel of the larger one.
+*/
+bool ComparePaintFrames(const PAINTFRAME &frame1, const PAINTFRAME &frame2, int nTolerance, PAINTFRAMEDIFF &diff);
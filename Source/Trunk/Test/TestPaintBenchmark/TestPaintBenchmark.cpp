@@ -0,0 +1,1076 @@
+// TestPaintBenchmark.cpp : Benchmark and golden-frame test of the painting of the views.
+//
+// The views are rendered by SdkOffscreenWindow into the software render target, so no window
+// is created and the frames do not depend on the display adapter. Link with SdkCommonLib and
+// SdkFrameworkLib:
+//
+//   TestPaintBenchmark.exe [-n frames] [-golden dir] [-update] [-t tolerance]
+//
+// The same scene is rendered with and without the layer cache of the panel. In every frame one
+// view is moved over the panel, and now and then a tile in the panel is changed, so only the
+// dirty rectangles are repainted. Some frames of the direct run are compared with the PNG files
+// in the golden folder, "Golden" by default. With -update the files are written instead. The
+// same frames of the cached run are compared with the frames of the direct run. The last frame
+// is also compared with a full repaint of the same scene. Before the runs, the merging of the
+// dirty rectangles by SdkWindow is checked with fixed rectangles, and the frames of an animated
+// GIF painted from the frame cache of D2DAnimatedGif, or composed again after the cache is
+// dropped, are compared with the frames composed without the cache.
+//
+// The golden set is not shipped until it is written by -update on the reference machine, so
+// when the golden folder does not exist the golden comparison is skipped, the other checks
+// still run. A missing file in an existing folder is a failure. The exit code is 0 if all
+// checks pass, 77 if they pass but the golden comparison is skipped, 1 otherwise.
+//
+// Linux: the frames are rendered by the Direct2D software render target and the PNG files are
+// read and written by WIC, so the harness runs only on Windows. The frames and the comparison
+// are in PaintFrame.cpp which needs neither COM nor WIC, it builds headless, but there is no
+// headless rasterizer of the views and no PNG codec, so nothing runs on Linux yet.
+//
+
+#include "stdafx.h"
+#include "SdkCommonInclude.h"
+#include "SdkUICommonInclude.h"
+#include "D2DAnimatedGif.h"
+#include "PaintFrame.h"
+
+using namespace std;
+USING_NAMESPACE_D2D
+USING_NAMESPACE_VIEWS
+USING_NAMESPACE_WINDOW
+USING_NAMESPACE_UILIB
+
+#define PAINTBENCH_WIDTH        640             // The width of the frame.
+#define PAINTBENCH_HEIGHT       480             // The height of the frame.
+#define PAINTBENCH_COLS         10              // The columns of the tiles in the panel.
+#define PAINTBENCH_ROWS         8               // The rows of the tiles in the panel.
+#define PAINTBENCH_TILE_SIZE    44.0f           // The size of one tile.
+#define PAINTBENCH_CHECK_COUNT  4               // The number of the frames compared with the golden files.
+#define PAINTBENCH_EXIT_SKIPPED 77              // The exit code when the golden comparison is skipped.
+#define PAINTBENCH_GIF_SIZE     16              // The width and height of the GIF of the frame cache check.
+#define PAINTBENCH_GIF_FRAMES   4               // The frames of that GIF.
+#define PAINTBENCH_GIF_LOOPS    3               // The loops painted by the frame cache check.
+
+/*!
+* @brief What is done with the golden files.
+*/
+typedef enum _PAINTBENCH_GOLDEN
+{
+    PAINTBENCH_GOLDEN_COMPARE   = 0,    // The frames are compared with the golden files.
+    PAINTBENCH_GOLDEN_UPDATE    = 1,    // The golden files are written.
+    PAINTBENCH_GOLDEN_SKIP      = 2,    // There is no golden set, the golden comparison is skipped.
+
+} PAINTBENCH_GOLDEN;
+
+/*!
+* @brief The options of the run.
+*/
+typedef struct _PAINTBENCHOPTIONS
+{
+    int         nFrames;                // The number of the frames.
+    int         nTolerance;             // The max difference of one channel.
+    BOOL        isUpdate;               // Write the golden files instead of comparing.
+    PAINTBENCH_GOLDEN golden;           // What is done with the golden files.
+    LPCTSTR     lpGoldenDir;            // The folder of the golden files.
+
+} PAINTBENCHOPTIONS;
+
+/*!
+* @brief The result of one run.
+*/
+typedef struct _PAINTBENCHRESULT
+{
+    double      dTotalTime;             // The seconds of all frames.
+    double      dMaxTime;               // The seconds of the slowest frame.
+    UINT64      uStats[DEVICE_FRAMESTAT_COUNT];  // The counters summed over the frames.
+    int         nFailCount;             // The number of the frames which do not match.
+
+} PAINTBENCHRESULT;
+
+/*!
+* @brief The views of the scene which are changed while running.
+*/
+typedef struct _PAINTBENCHSCENE
+{
+    SdkViewLayout      *pPanel;         // The panel of the tiles.
+    SdkViewElement     *pMover;         // The view moved in every frame.
+    vector<SdkViewElement*> vctTiles;   // The tiles.
+
+} PAINTBENCHSCENE;
+
+
+//////////////////////////////////////////////////////////////////////////
+
+static double GetSeconds()
+{
+    LARGE_INTEGER liFrequency, liCounter;
+    QueryPerformanceFrequency(&liFrequency);
+    QueryPerformanceCounter(&liCounter);
+    return (double)liCounter.QuadPart / liFrequency.QuadPart;
+}
+
+//////////////////////////////////////////////////////////////////////////
+
+static UINT32 NextRandom(UINT32 &uSeed)
+{
+    uSeed = uSeed * 1103515245 + 12345;
+    return (uSeed >> 8);
+}
+
+//////////////////////////////////////////////////////////////////////////
+
+static HBITMAP CreatePatternBitmap(int nWidth, int nHeight)
+{
+    BITMAPINFO bmi = { 0 };
+    bmi.bmiHeader.biSize        = sizeof(BITMAPINFOHEADER);
+    bmi.bmiHeader.biWidth       = nWidth;
+    bmi.bmiHeader.biHeight      = -nHeight;
+    bmi.bmiHeader.biPlanes      = 1;
+    bmi.bmiHeader.biBitCount    = 32;
+    bmi.bmiHeader.biCompression = BI_RGB;
+
+    BYTE *pBits = NULL;
+    HBITMAP hBitmap = CreateDIBSection(NULL, &bmi, DIB_RGB_COLORS, (void**)&pBits, NULL, 0);
+    if ( (NULL == hBitmap) || (NULL == pBits) )
+    {
+        return hBitmap;
+    }
+
+    // A gradient with a checker, the edges of the checker show the filtering of the bitmap.
+    for (int y = 0; y < nHeight; ++y)
+    {
+        for (int x = 0; x < nWidth; ++x)
+        {
+            BYTE *pPixel = pBits + (y * nWidth + x) * 4;
+            BOOL isDark = (((x / 8) + (y / 8)) % 2) == 1;
+            pPixel[0] = (BYTE)(255 * x / nWidth);
+            pPixel[1] = (BYTE)(255 * y / nHeight);
+            pPixel[2] = isDark ? 64 : 224;
+            pPixel[3] = 255;
+        }
+    }
+
+    return hBitmap;
+}
+
+//////////////////////////////////////////////////////////////////////////
+
+static void BuildScene(SdkOffscreenWindow &window, BOOL isLayerCache, PAINTBENCHSCENE &scene)
+{
+    HBITMAP hBitmap = CreatePatternBitmap(64, 64);
+
+    scene.pPanel = new SdkViewLayout();
+    scene.pPanel->SetLayoutInfo(20.0f, 20.0f,
+                                PAINTBENCH_COLS * PAINTBENCH_TILE_SIZE + 20.0f,
+                                PAINTBENCH_ROWS * PAINTBENCH_TILE_SIZE + 20.0f);
+    scene.pPanel->SetBkColor(ColorF(0.85f, 0.87f, 0.90f));
+    scene.pPanel->SetBorderWidth(2.0f);
+    scene.pPanel->SetBorderColor(ColorF(ColorF::DarkSlateGray));
+    scene.pPanel->SetRoundCornerEnable(TRUE);
+    scene.pPanel->SetRoundCornerRadius(12.0f, 12.0f);
+    scene.pPanel->SetLayerCacheEnable(isLayerCache);
+    window.AddView(scene.pPanel);
+
+    scene.vctTiles.clear();
+    for (int i = 0; i < PAINTBENCH_COLS * PAINTBENCH_ROWS; ++i)
+    {
+        FLOAT x = 10.0f + (i % PAINTBENCH_COLS) * PAINTBENCH_TILE_SIZE;
+        FLOAT y = 10.0f + (i / PAINTBENCH_COLS) * PAINTBENCH_TILE_SIZE;
+        FLOAT fSize = PAINTBENCH_TILE_SIZE - 6.0f;
+
+        SdkViewElement *pTile = new SdkViewElement();
+        pTile->SetLayoutInfo(x, y, fSize, fSize);
+        pTile->SetBkColor(ColorF((i % 7) / 7.0f, (i % 5) / 5.0f, (i % 3) / 3.0f));
+
+        // Mix the kinds of drawing: borders, round corners, bitmaps and transforms.
+        switch (i % 5)
+        {
+        case 1:
+            pTile->SetBorderWidth(1.5f);
+            pTile->SetBorderColor(ColorF(ColorF::Black));
+            break;
+
+        case 2:
+            pTile->SetRoundCornerEnable(TRUE);
+            pTile->SetRoundCornerRadius(8.0f, 8.0f);
+            break;
+
+        case 3:
+            pTile->SetBkImage(hBitmap, (UINT32)fSize, (UINT32)fSize);
+            break;
+
+        case 4:
+            {
+                POINTF pt = { fSize / 2, fSize / 2 };
+                pTile->Rotate(15.0f * (i % 4), pt);
+            }
+            break;
+        }
+
+        scene.pPanel->AddView(pTile);
+        scene.vctTiles.push_back(pTile);
+    }
+
+    // The last tile sticks out of the panel, the panel clips it.
+    scene.vctTiles.back()->SetViewSize(PAINTBENCH_TILE_SIZE * 2, PAINTBENCH_TILE_SIZE * 2);
+
+    scene.pMover = new SdkViewElement();
+    scene.pMover->SetLayoutInfo(0.0f, 0.0f, 60.0f, 60.0f);
+    scene.pMover->SetBkColor(ColorF(ColorF::OrangeRed, 0.8f));
+    scene.pMover->SetRoundCornerEnable(TRUE);
+    scene.pMover->SetRoundCornerRadius(30.0f, 30.0f);
+    scene.pMover->SetBorderWidth(3.0f);
+    scene.pMover->SetBorderColor(ColorF(ColorF::White));
+    window.AddView(scene.pMover);
+
+    DeleteObject(hBitmap);
+}
+
+//////////////////////////////////////////////////////////////////////////
+
+static void ChangeScene(PAINTBENCHSCENE &scene, int nFrame, UINT32 &uSeed)
+{
+    // The mover goes over the panel on a Lissajous curve, in whole DIPs.
+    FLOAT x = floor(290.0f + 260.0f * (FLOAT)sin(nFrame * 0.031));
+    FLOAT y = floor(210.0f + 180.0f * (FLOAT)sin(nFrame * 0.047));
+    scene.pMover->SetViewPos(x, y);
+    scene.pMover->Invalidate();
+
+    // Change a tile now and then, the layer of the panel is recorded again.
+    if ( 0 == (nFrame % 16) )
+    {
+        SdkViewElement *pTile = scene.vctTiles[NextRandom(uSeed) % scene.vctTiles.size()];
+        pTile->SetBkColor(ColorF((NextRandom(uSeed) % 256) / 255.0f,
+                                 (NextRandom(uSeed) % 256) / 255.0f,
+                                 (NextRandom(uSeed) % 256) / 255.0f));
+        pTile->Invalidate();
+    }
+}
+
+//////////////////////////////////////////////////////////////////////////
+
+static HRESULT ReadPixels(IWICBitmapSource *pSource, PAINTFRAME &frame)
+{
+    UINT32 uWidth = 0, uHeight = 0;
+    HRESULT hr = pSource->GetSize(&uWidth, &uHeight);
+    if (SUCCEEDED(hr) && ((0 == uWidth) || (0 == uHeight)))
+    {
+        hr = E_FAIL;
+    }
+
+    if (SUCCEEDED(hr))
+    {
+        ResizePaintFrame(frame, uWidth, uHeight);
+        hr = pSource->CopyPixels(NULL, uWidth * 4, (UINT)frame.vctPixels.size(), &frame.vctPixels[0]);
+    }
+
+    return hr;
+}
+
+//////////////////////////////////////////////////////////////////////////
+
+static HRESULT SaveGolden(IWICImagingFactory *pFactory, IWICBitmap *pBitmap, LPCWSTR lpFile)
+{
+    IWICStream *pStream = NULL;
+    IWICBitmapEncoder *pEncoder = NULL;
+    IWICBitmapFrameEncode *pFrame = NULL;
+
+    HRESULT hr = pFactory->CreateStream(&pStream);
+    if (SUCCEEDED(hr))
+    {
+        hr = pStream->InitializeFromFilename(lpFile, GENERIC_WRITE);
+    }
+
+    if (SUCCEEDED(hr))
+    {
+        hr = pFactory->CreateEncoder(GUID_ContainerFormatPng, NULL, &pEncoder);
+    }
+
+    if (SUCCEEDED(hr))
+    {
+        hr = pEncoder->Initialize(pStream, WICBitmapEncoderNoCache);
+    }
+
+    if (SUCCEEDED(hr))
+    {
+        hr = pEncoder->CreateNewFrame(&pFrame, NULL);
+    }
+
+    if (SUCCEEDED(hr))
+    {
+        hr = pFrame->Initialize(NULL);
+    }
+
+    if (SUCCEEDED(hr))
+    {
+        // The pixels are converted from the premultiplied format by the encoder.
+        WICPixelFormatGUID format = GUID_WICPixelFormat32bppBGRA;
+        hr = pFrame->SetPixelFormat(&format);
+    }
+
+    if (SUCCEEDED(hr))
+    {
+        hr = pFrame->WriteSource(pBitmap, NULL);
+    }
+
+    if (SUCCEEDED(hr))
+    {
+        hr = pFrame->Commit();
+    }
+
+    if (SUCCEEDED(hr))
+    {
+        hr = pEncoder->Commit();
+    }
+
+    SAFE_RELEASE(pFrame);
+    SAFE_RELEASE(pEncoder);
+    SAFE_RELEASE(pStream);
+
+    return hr;
+}
+
+//////////////////////////////////////////////////////////////////////////
+
+static HRESULT LoadGolden(IWICImagingFactory *pFactory, LPCWSTR lpFile, PAINTFRAME &frame)
+{
+    IWICBitmapDecoder *pDecoder = NULL;
+    IWICBitmapFrameDecode *pFrame = NULL;
+    IWICFormatConverter *pConverter = NULL;
+
+    HRESULT hr = pFactory->CreateDecoderFromFilename(lpFile, NULL, GENERIC_READ,
+                                                     WICDecodeMetadataCacheOnDemand, &pDecoder);
+    if (SUCCEEDED(hr))
+    {
+        hr = pDecoder->GetFrame(0, &pFrame);
+    }
+
+    if (SUCCEEDED(hr))
+    {
+        hr = pFactory->CreateFormatConverter(&pConverter);
+    }
+
+    if (SUCCEEDED(hr))
+    {
+        hr = pConverter->Initialize(pFrame, GUID_WICPixelFormat32bppPBGRA,
+                                    WICBitmapDitherTypeNone, NULL, 0.0f, WICBitmapPaletteTypeCustom);
+    }
+
+    if (SUCCEEDED(hr))
+    {
+        hr = ReadPixels(pConverter, frame);
+    }
+
+    SAFE_RELEASE(pConverter);
+    SAFE_RELEASE(pFrame);
+    SAFE_RELEASE(pDecoder);
+
+    return hr;
+}
+
+//////////////////////////////////////////////////////////////////////////
+
+static void PrintDiff(LPCTSTR lpCaseName, LPCTSTR lpWhat, const PAINTFRAMEDIFF &diff)
+{
+    _tprintf(_T("  %s %s: %d pixels differ, the first at (%d, %d), max difference %d\n"),
+        lpCaseName, lpWhat, diff.nDiffCount, diff.nFirstX, diff.nFirstY, diff.nMaxDiff);
+}
+
+//////////////////////////////////////////////////////////////////////////
+
+static BOOL CheckFrame(IWICImagingFactory *pFactory, SdkOffscreenWindow &window, int nFrame,
+                       const PAINTBENCHOPTIONS &options, LPCTSTR lpCaseName,
+                       const PAINTFRAME *pDirectFrame, PAINTFRAME &frame)
+{
+    IWICBitmap *pBitmap = NULL;
+    HRESULT hr = window.GetFrameBitmap(&pBitmap);
+    if (SUCCEEDED(hr))
+    {
+        hr = ReadPixels(pBitmap, frame);
+    }
+
+    if (FAILED(hr))
+    {
+        _tprintf(_T("  %s frame %d: no bitmap, hr = 0x%08X\n"), lpCaseName, nFrame, hr);
+        SAFE_RELEASE(pBitmap);
+        return FALSE;
+    }
+
+    WCHAR szFile[MAX_PATH] = { 0 };
+    swprintf_s(szFile, MAX_PATH, L"%s\\paint_frame%04d.png", options.lpGoldenDir, nFrame);
+
+    TCHAR szWhat[64] = { 0 };
+    _stprintf_s(szWhat, ARRAYSIZE(szWhat), _T("frame %d"), nFrame);
+
+    BOOL isSame = FALSE;
+    PAINTFRAMEDIFF diff = { 0 };
+    if (NULL != pDirectFrame)
+    {
+        // The cached run is compared with the same frame of the direct run.
+        isSame = ComparePaintFrames(frame, *pDirectFrame, options.nTolerance, diff) ? TRUE : FALSE;
+        if (!isSame)
+        {
+            _tcscat_s(szWhat, ARRAYSIZE(szWhat), _T(" against the direct run"));
+            PrintDiff(lpCaseName, szWhat, diff);
+        }
+    }
+    else if (PAINTBENCH_GOLDEN_SKIP == options.golden)
+    {
+        isSame = TRUE;
+    }
+    else if (PAINTBENCH_GOLDEN_UPDATE == options.golden)
+    {
+        hr = SaveGolden(pFactory, pBitmap, szFile);
+        isSame = SUCCEEDED(hr);
+        if (!isSame)
+        {
+            _tprintf(_T("  %s frame %d: cannot write %s, hr = 0x%08X\n"), lpCaseName, nFrame, szFile, hr);
+        }
+    }
+    else if (INVALID_FILE_ATTRIBUTES == GetFileAttributesW(szFile))
+    {
+        _tprintf(_T("  %s frame %d: %s is missing, run with -update to write it\n"), lpCaseName, nFrame, szFile);
+    }
+    else
+    {
+        PAINTFRAME golden;
+        hr = LoadGolden(pFactory, szFile, golden);
+        if (FAILED(hr))
+        {
+            _tprintf(_T("  %s frame %d: cannot read %s, hr = 0x%08X\n"), lpCaseName, nFrame, szFile, hr);
+        }
+        else
+        {
+            isSame = ComparePaintFrames(frame, golden, options.nTolerance, diff) ? TRUE : FALSE;
+            if (!isSame)
+            {
+                PrintDiff(lpCaseName, szWhat, diff);
+            }
+        }
+    }
+
+    SAFE_RELEASE(pBitmap);
+
+    return isSame;
+}
+
+//////////////////////////////////////////////////////////////////////////
+
+static BOOL CheckFullRepaint(SdkOffscreenWindow &window, const PAINTBENCHOPTIONS &options, LPCTSTR lpCaseName)
+{
+    // The frame painted by the dirty rectangles should be the same as a full repaint.
+    PAINTFRAME partial;
+    PAINTFRAME full;
+
+    IWICBitmap *pBitmap = NULL;
+    HRESULT hr = window.GetFrameBitmap(&pBitmap);
+    if (SUCCEEDED(hr))
+    {
+        hr = ReadPixels(pBitmap, partial);
+    }
+
+    if (SUCCEEDED(hr))
+    {
+        hr = window.RenderFrame(TRUE);
+    }
+
+    if (SUCCEEDED(hr))
+    {
+        hr = ReadPixels(pBitmap, full);
+    }
+
+    SAFE_RELEASE(pBitmap);
+
+    if (FAILED(hr))
+    {
+        _tprintf(_T("  %s full repaint failed, hr = 0x%08X\n"), lpCaseName, hr);
+        return FALSE;
+    }
+
+    PAINTFRAMEDIFF diff = { 0 };
+    BOOL isSame = ComparePaintFrames(partial, full, options.nTolerance, diff) ? TRUE : FALSE;
+    if (!isSame)
+    {
+        PrintDiff(lpCaseName, _T("full repaint"), diff);
+    }
+
+    return isSame;
+}
+
+//////////////////////////////////////////////////////////////////////////
+
+static BOOL RunCase(IWICImagingFactory *pFactory, BOOL isLayerCache, const PAINTBENCHOPTIONS &options,
+                    vector<PAINTFRAME> &vctDirectFrames, PAINTBENCHRESULT &result)
+{
+    LPCTSTR lpCaseName = isLayerCache ? _T("cached") : _T("direct");
+    ZeroMemory(&result, sizeof(PAINTBENCHRESULT));
+
+    SdkOffscreenWindow window;
+    if ( FAILED(window.SetFrameSize(PAINTBENCH_WIDTH, PAINTBENCH_HEIGHT)) )
+    {
+        _tprintf(_T("  %s: cannot create the software render target\n"), lpCaseName);
+        result.nFailCount = 1;
+        return FALSE;
+    }
+
+    PAINTBENCHSCENE scene;
+    BuildScene(window, isLayerCache, scene);
+
+    // Only the first, two middle and the last frames are compared, so the golden files are few.
+    // The direct run keeps the frames, the cached run is compared with them.
+    int checkFrames[PAINTBENCH_CHECK_COUNT] = { 0, options.nFrames / 3, options.nFrames * 2 / 3, options.nFrames - 1 };
+    int nNextCheck = 0;
+    vctDirectFrames.resize(PAINTBENCH_CHECK_COUNT);
+
+    UINT32 uSeed = 2011;
+    D2DDevice *pD2DDevice = window.GetD2DDevices();
+    for (int n = 0; n < options.nFrames; ++n)
+    {
+        ChangeScene(scene, n, uSeed);
+
+        double dStart = GetSeconds();
+        HRESULT hr = window.RenderFrame();
+        double dTime = GetSeconds() - dStart;
+
+        if (FAILED(hr))
+        {
+            _tprintf(_T("  %s frame %d: render failed, hr = 0x%08X\n"), lpCaseName, n, hr);
+            result.nFailCount++;
+            break;
+        }
+
+        result.dTotalTime += dTime;
+        result.dMaxTime = MAX(result.dMaxTime, dTime);
+        for (int i = 0; i < DEVICE_FRAMESTAT_COUNT; ++i)
+        {
+            result.uStats[i] += pD2DDevice->GetFrameStat((DEVICE_FRAMESTAT)i);
+        }
+
+        while ( (nNextCheck < PAINTBENCH_CHECK_COUNT) && (checkFrames[nNextCheck] == n) )
+        {
+            PAINTFRAME frame;
+            const PAINTFRAME *pDirectFrame = isLayerCache ? &vctDirectFrames[nNextCheck] : NULL;
+            result.nFailCount += CheckFrame(pFactory, window, n, options, lpCaseName, pDirectFrame, frame) ? 0 : 1;
+            if (!isLayerCache)
+            {
+                vctDirectFrames[nNextCheck] = frame;
+            }
+
+            nNextCheck++;
+        }
+    }
+
+    if (0 == result.nFailCount)
+    {
+        result.nFailCount += CheckFullRepaint(window, options, lpCaseName) ? 0 : 1;
+    }
+
+    return (0 == result.nFailCount);
+}
+
+/*!
+* @brief It only gives the benchmark the merging of the dirty rectangles of SdkWindow.
+*/
+class DirtyRectWindow : public SdkWindow
+{
+public:
+
+    static void Merge(vector<RECT> &vctRects, const RECT &rc)
+    {
+        MergeDirtyRect(vctRects, rc);
+    }
+};
+
+//////////////////////////////////////////////////////////////////////////
+
+static BOOL HasRect(const vector<RECT> &vctRects, const RECT &rc)
+{
+    for (size_t i = 0; i < vctRects.size(); ++i)
+    {
+        if (EqualRect(&vctRects[i], &rc))
+        {
+            return TRUE;
+        }
+    }
+
+    return FALSE;
+}
+
+//////////////////////////////////////////////////////////////////////////
+
+static BOOL IsCovered(const vector<RECT> &vctRects, const RECT &rc)
+{
+    for (size_t i = 0; i < vctRects.size(); ++i)
+    {
+        RECT rcUnion = { 0 };
+        UnionRect(&rcUnion, &vctRects[i], &rc);
+        if (EqualRect(&rcUnion, &vctRects[i]))
+        {
+            return TRUE;
+        }
+    }
+
+    return FALSE;
+}
+
+//////////////////////////////////////////////////////////////////////////
+
+static int CheckDirtyRects()
+{
+    int nFailCount = 0;
+
+    // A covered rectangle is dropped, a covering one replaces the rectangles it covers, an
+    // empty one is ignored.
+    {
+        RECT rcBig = { 0, 0, 100, 100 };
+        RECT rcInner = { 10, 10, 20, 20 };
+        RECT rcOuter = { -10, -10, 200, 200 };
+        RECT rcOther = { 300, 0, 310, 10 };
+        RECT rcEmpty = { 50, 50, 50, 80 };
+        vector<RECT> vctRects;
+        DirtyRectWindow::Merge(vctRects, rcBig);
+        DirtyRectWindow::Merge(vctRects, rcInner);
+        DirtyRectWindow::Merge(vctRects, rcEmpty);
+        BOOL isOK = (1 == vctRects.size()) && HasRect(vctRects, rcBig);
+        DirtyRectWindow::Merge(vctRects, rcOther);
+        DirtyRectWindow::Merge(vctRects, rcOuter);
+        isOK = isOK && (2 == vctRects.size()) && HasRect(vctRects, rcOuter) && HasRect(vctRects, rcOther);
+        if (!isOK)
+        {
+            _tprintf(_T("  dirty rects: the covered rectangles are not removed\n"));
+            nFailCount++;
+        }
+    }
+
+    // One more than MAX_DIRTY_RECT_COUNT far apart rectangles, the two near ones are merged.
+    {
+        RECT rcNear1 = { 0, 0, 10, 10 };
+        RECT rcNear2 = { 12, 0, 22, 10 };
+        RECT rcNearUnion = { 0, 0, 22, 10 };
+        vector<RECT> vctRects;
+        DirtyRectWindow::Merge(vctRects, rcNear1);
+        DirtyRectWindow::Merge(vctRects, rcNear2);
+        for (int i = 0; i < MAX_DIRTY_RECT_COUNT - 1; ++i)
+        {
+            RECT rcFar = { 1000 * (i + 1), 1000, 1000 * (i + 1) + 10, 1010 };
+            DirtyRectWindow::Merge(vctRects, rcFar);
+        }
+
+        BOOL isOK = (MAX_DIRTY_RECT_COUNT == vctRects.size()) && HasRect(vctRects, rcNearUnion);
+        if (!isOK)
+        {
+            _tprintf(_T("  dirty rects: the pair of the least growth is not merged\n"));
+            nFailCount++;
+        }
+    }
+
+    // The union of the merged pair covers a third rectangle which is removed by merging again,
+    // so fewer than MAX_DIRTY_RECT_COUNT rectangles are left.
+    {
+        RECT rcTop = { 0, 0, 100, 60 };
+        RECT rcBottom = { 0, 40, 100, 100 };
+        RECT rcMiddle = { 40, 30, 60, 70 };
+        RECT rcUnion = { 0, 0, 100, 100 };
+        vector<RECT> vctRects;
+        DirtyRectWindow::Merge(vctRects, rcTop);
+        DirtyRectWindow::Merge(vctRects, rcBottom);
+        DirtyRectWindow::Merge(vctRects, rcMiddle);
+        for (int i = 0; i < MAX_DIRTY_RECT_COUNT - 2; ++i)
+        {
+            RECT rcFar = { 1000 * (i + 1), 1000, 1000 * (i + 1) + 10, 1010 };
+            DirtyRectWindow::Merge(vctRects, rcFar);
+        }
+
+        BOOL isOK = (MAX_DIRTY_RECT_COUNT - 1 == vctRects.size()) && HasRect(vctRects, rcUnion) &&
+                    !HasRect(vctRects, rcMiddle);
+        if (!isOK)
+        {
+            _tprintf(_T("  dirty rects: the union is not merged again\n"));
+            nFailCount++;
+        }
+    }
+
+    // Random rectangles, never more than MAX_DIRTY_RECT_COUNT and every one stays covered.
+    {
+        UINT32 uSeed = 2011;
+        vector<RECT> vctRects;
+        vector<RECT> vctAdded;
+        BOOL isOK = TRUE;
+        for (int i = 0; (i < 1000) && isOK; ++i)
+        {
+            LONG x = (LONG)(NextRandom(uSeed) % PAINTBENCH_WIDTH);
+            LONG y = (LONG)(NextRandom(uSeed) % PAINTBENCH_HEIGHT);
+            RECT rc = { x, y, x + 1 + (LONG)(NextRandom(uSeed) % 80), y + 1 + (LONG)(NextRandom(uSeed) % 80) };
+            DirtyRectWindow::Merge(vctRects, rc);
+            vctAdded.push_back(rc);
+
+            isOK = (vctRects.size() <= MAX_DIRTY_RECT_COUNT);
+            for (size_t j = 0; (j < vctAdded.size()) && isOK; ++j)
+            {
+                isOK = IsCovered(vctRects, vctAdded[j]);
+            }
+
+            // Start again now and then, so the rectangles do not grow to the whole frame.
+            if (0 == (i % 50))
+            {
+                vctRects.clear();
+                vctAdded.clear();
+            }
+        }
+
+        if (!isOK)
+        {
+            _tprintf(_T("  dirty rects: a rectangle is lost or too many are kept\n"));
+            nFailCount++;
+        }
+    }
+
+    _tprintf(_T("dirty rects %s\n"), (0 == nFailCount) ? _T("ok") : _T("MISMATCH"));
+
+    return nFailCount;
+}
+
+//////////////////////////////////////////////////////////////////////////
+//
+// The frame cache of D2DAnimatedGif. The GIF is written by hand, its frames are smaller than
+// the canvas, have the transparent pixels and are disposed to the background or not, so a
+// frame composed on a wrong previous frame differs.
+//
+//////////////////////////////////////////////////////////////////////////
+
+static void PutGifWord(vector<BYTE> &vctOut, UINT uValue)
+{
+    vctOut.push_back((BYTE)(uValue & 0xFF));
+    vctOut.push_back((BYTE)(uValue >> 8));
+}
+
+//////////////////////////////////////////////////////////////////////////
+
+static void MakeFrameCacheGif(vector<BYTE> &vctOut)
+{
+    // The left, top, width, height and disposal of the frames.
+    const UINT frames[PAINTBENCH_GIF_FRAMES][5] =
+    {
+        { 0, 0, 16, 16, DM_NONE       },
+        { 0, 0, 8,  8,  DM_BACKGROUND },
+        { 8, 8, 8,  8,  DM_NONE       },
+        { 4, 0, 8,  16, DM_BACKGROUND },
+    };
+
+    vctOut.clear();
+    vctOut.insert(vctOut.end(), (const BYTE*)"GIF89a", (const BYTE*)"GIF89a" + 6);
+    PutGifWord(vctOut, PAINTBENCH_GIF_SIZE);
+    PutGifWord(vctOut, PAINTBENCH_GIF_SIZE);
+    vctOut.push_back(0x81);             // The global color table of 4 colors.
+    vctOut.push_back(0);
+    vctOut.push_back(0);
+
+    const BYTE palette[] = { 0, 0, 0, 255, 0, 0, 0, 255, 0, 0, 0, 255 };
+    vctOut.insert(vctOut.end(), palette, palette + sizeof(palette));
+
+    const BYTE netscape[] = { 0x21, 0xFF, 11, 'N', 'E', 'T', 'S', 'C', 'A', 'P', 'E', '2', '.', '0', 3, 1, 0, 0, 0 };
+    vctOut.insert(vctOut.end(), netscape, netscape + sizeof(netscape));
+
+    for (UINT uFrame = 0; uFrame < PAINTBENCH_GIF_FRAMES; ++uFrame)
+    {
+        const UINT *pFrame = frames[uFrame];
+
+        // The color 0 is transparent.
+        BYTE control[] = { 0x21, 0xF9, 4, (BYTE)((pFrame[4] << 2) | 1), 10, 0, 0, 0 };
+        vctOut.insert(vctOut.end(), control, control + sizeof(control));
+
+        vctOut.push_back(0x2C);
+        PutGifWord(vctOut, pFrame[0]);
+        PutGifWord(vctOut, pFrame[1]);
+        PutGifWord(vctOut, pFrame[2]);
+        PutGifWord(vctOut, pFrame[3]);
+        vctOut.push_back(0);
+
+        // The codes have 3 bits, a clear code before every two pixels keeps the table of the
+        // decoder from growing, so the pixels need no compression.
+        vector<BYTE> vctCodes;
+        for (UINT y = 0; y < pFrame[3]; ++y)
+        {
+            for (UINT x = 0; x < pFrame[2]; ++x)
+            {
+                if (0 == (y * pFrame[2] + x) % 2)
+                {
+                    vctCodes.push_back(4);
+                }
+                vctCodes.push_back((BYTE)((0 == uFrame) ? 1 : (x + y * 3 + uFrame) % 4));
+            }
+        }
+        vctCodes.push_back(5);
+
+        vector<BYTE> vctBytes;
+        UINT uBits = 0;
+        UINT uBitCount = 0;
+        for (size_t i = 0; i < vctCodes.size(); ++i)
+        {
+            uBits |= (UINT)vctCodes[i] << uBitCount;
+            uBitCount += 3;
+            while (uBitCount >= 8)
+            {
+                vctBytes.push_back((BYTE)(uBits & 0xFF));
+                uBits >>= 8;
+                uBitCount -= 8;
+            }
+        }
+        if (uBitCount > 0)
+        {
+            vctBytes.push_back((BYTE)(uBits & 0xFF));
+        }
+
+        vctOut.push_back(2);
+        for (size_t i = 0; i < vctBytes.size(); i += 255)
+        {
+            size_t cbBlock = MIN(vctBytes.size() - i, (size_t)255);
+            vctOut.push_back((BYTE)cbBlock);
+            vctOut.insert(vctOut.end(), vctBytes.begin() + i, vctBytes.begin() + i + cbBlock);
+        }
+        vctOut.push_back(0);
+    }
+
+    vctOut.push_back(0x3B);
+}
+
+//////////////////////////////////////////////////////////////////////////
+
+static BOOL WriteTempFile(const vector<BYTE> &vctData, LPWSTR lpFile)
+{
+    WCHAR szDir[MAX_PATH] = { 0 };
+    if ( (0 == GetTempPathW(MAX_PATH, szDir)) || (0 == GetTempFileNameW(szDir, L"gif", 0, lpFile)) )
+    {
+        return FALSE;
+    }
+
+    HANDLE hFile = CreateFileW(lpFile, GENERIC_WRITE, 0, NULL, CREATE_ALWAYS, FILE_ATTRIBUTE_NORMAL, NULL);
+    if (INVALID_HANDLE_VALUE == hFile)
+    {
+        return FALSE;
+    }
+
+    DWORD cbWritten = 0;
+    BOOL isOk = WriteFile(hFile, &vctData[0], (DWORD)vctData.size(), &cbWritten, NULL) && (cbWritten == vctData.size());
+    CloseHandle(hFile);
+
+    return isOk;
+}
+
+//////////////////////////////////////////////////////////////////////////
+
+static BOOL PlayGif(LPCWSTR lpFile, BOOL isFrameCache, UINT uDropCacheFrame, vector<PAINTFRAME> &vctFrames)
+{
+    LPCTSTR lpCaseName = isFrameCache ? _T("gif cached") : _T("gif uncached");
+
+    // The GIF unregisters from the device of the window, so it is destroyed first.
+    SdkOffscreenWindow window;
+    D2DAnimatedGif gif;
+    D2DDevice *pD2DDevice = window.GetD2DDevices();
+    if ( FAILED(window.SetFrameSize(PAINTBENCH_GIF_SIZE, PAINTBENCH_GIF_SIZE))
+      || !gif.Initialize(pD2DDevice) || !gif.LoadFromFile(lpFile) )
+    {
+        _tprintf(_T("  %s: cannot load the GIF\n"), lpCaseName);
+        return FALSE;
+    }
+
+    gif.SetFrameCacheLimit(isFrameCache ? DEFAULT_GIF_FRAME_CACHE_LIMIT : 0);
+
+    ID2D1RenderTarget *pTarget = NULL;
+    pD2DDevice->GetRenderTarget(&pTarget);
+
+    BOOL isOk = (NULL != pTarget);
+    vctFrames.resize(PAINTBENCH_GIF_FRAMES * PAINTBENCH_GIF_LOOPS);
+    for (UINT n = 0; isOk && (n < vctFrames.size()); ++n)
+    {
+        ID2D1Bitmap *pBitmap = NULL;
+        isOk = gif.OnPaintNextFrame() && gif.GetPaintBitmap(&pBitmap);
+
+        // The painted frame is drawn on the frame of the window to read its pixels.
+        HRESULT hr = E_FAIL;
+        if (isOk)
+        {
+            pTarget->BeginDraw();
+            pTarget->Clear(ColorF(0, 0));
+            pTarget->DrawBitmap(pBitmap);
+            hr = pTarget->EndDraw();
+        }
+
+        IWICBitmap *pFrameBitmap = NULL;
+        if (SUCCEEDED(hr))
+        {
+            hr = window.GetFrameBitmap(&pFrameBitmap);
+        }
+        if (SUCCEEDED(hr))
+        {
+            hr = ReadPixels(pFrameBitmap, vctFrames[n]);
+        }
+        SAFE_RELEASE(pFrameBitmap);
+        SAFE_RELEASE(pBitmap);
+
+        if (FAILED(hr))
+        {
+            _tprintf(_T("  %s frame %u: cannot read the painted frame, hr = 0x%08X\n"), lpCaseName, n, hr);
+            isOk = FALSE;
+        }
+
+        // The frames after the first loop are painted from the cache until it is dropped.
+        if (isOk && isFrameCache && (n == uDropCacheFrame))
+        {
+            isOk = gif.IsFrameCached();
+            if (!isOk)
+            {
+                _tprintf(_T("  %s frame %u: the frames are not cached\n"), lpCaseName, n);
+            }
+            gif.SetFrameCacheLimit(0);
+        }
+    }
+
+    SAFE_RELEASE(pTarget);
+
+    return isOk;
+}
+
+//////////////////////////////////////////////////////////////////////////
+
+static int CheckGifFrameCache(const PAINTBENCHOPTIONS &options)
+{
+    vector<BYTE> vctData;
+    MakeFrameCacheGif(vctData);
+
+    WCHAR szFile[MAX_PATH] = { 0 };
+    if (!WriteTempFile(vctData, szFile))
+    {
+        _tprintf(_T("gif frame cache MISMATCH, cannot write the GIF\n"));
+        return 1;
+    }
+
+    // The cache is dropped in the middle of the second loop, after a frame which is disposed to
+    // the background, so the next frames are composed on the painted frame.
+    vector<PAINTFRAME> vctUncached;
+    vector<PAINTFRAME> vctCached;
+    int nFailCount = 0;
+    nFailCount += PlayGif(szFile, FALSE, 0, vctUncached) ? 0 : 1;
+    nFailCount += PlayGif(szFile, TRUE, PAINTBENCH_GIF_FRAMES + 1, vctCached) ? 0 : 1;
+    DeleteFileW(szFile);
+
+    for (size_t i = 0; (0 == nFailCount) && (i < vctCached.size()); ++i)
+    {
+        PAINTFRAMEDIFF diff = { 0 };
+        if (!ComparePaintFrames(vctCached[i], vctUncached[i], options.nTolerance, diff))
+        {
+            TCHAR szWhat[64] = { 0 };
+            _stprintf_s(szWhat, ARRAYSIZE(szWhat), _T("frame %u"), (UINT)i);
+            PrintDiff(_T("gif cached"), szWhat, diff);
+            nFailCount++;
+        }
+    }
+
+    _tprintf(_T("gif frame cache %s\n"), (0 == nFailCount) ? _T("ok") : _T("MISMATCH"));
+
+    return nFailCount;
+}
+
+//////////////////////////////////////////////////////////////////////////
+
+static void PrintResult(LPCTSTR lpCaseName, int nFrames, const PAINTBENCHRESULT &result)
+{
+    _tprintf(_T("%-8s %6d frames  avg %8.3f ms  max %8.3f ms  painted %7.1f  culled %7.1f  recorded %5.2f  layers %6.1f  %s\n"),
+        lpCaseName, nFrames,
+        result.dTotalTime * 1e3 / nFrames, result.dMaxTime * 1e3,
+        (double)result.uStats[DEVICE_FRAMESTAT_PAINTVIEW] / nFrames,
+        (double)result.uStats[DEVICE_FRAMESTAT_CULLVIEW] / nFrames,
+        (double)result.uStats[DEVICE_FRAMESTAT_RECORDLAYER] / nFrames,
+        (double)result.uStats[DEVICE_FRAMESTAT_DRAWLAYER] / nFrames,
+        (0 == result.nFailCount) ? _T("ok") : _T("MISMATCH"));
+}
+
+//////////////////////////////////////////////////////////////////////////
+
+int _tmain(int argc, _TCHAR* argv[])
+{
+    PAINTBENCHOPTIONS options = { 0 };
+    options.nFrames = 600;
+    options.nTolerance = 2;
+    options.isUpdate = FALSE;
+    options.lpGoldenDir = _T("Golden");
+
+    for (int i = 1; i < argc; ++i)
+    {
+        if ( (0 == _tcscmp(argv[i], _T("-n"))) && (i + 1 < argc) )
+        {
+            options.nFrames = _ttoi(argv[++i]);
+            options.nFrames = (options.nFrames > 0) ? options.nFrames : 1;
+        }
+        else if ( (0 == _tcscmp(argv[i], _T("-t"))) && (i + 1 < argc) )
+        {
+            options.nTolerance = _ttoi(argv[++i]);
+        }
+        else if ( (0 == _tcscmp(argv[i], _T("-golden"))) && (i + 1 < argc) )
+        {
+            options.lpGoldenDir = argv[++i];
+        }
+        else if (0 == _tcscmp(argv[i], _T("-update")))
+        {
+            options.isUpdate = TRUE;
+        }
+    }
+
+    CoInitialize(NULL);
+    SdkUIRunTime::InitializeUIRunTime();
+
+    IWICImagingFactory *pFactory = NULL;
+    HRESULT hr = CoCreateInstance(CLSID_WICImagingFactory, NULL, CLSCTX_INPROC_SERVER, IID_PPV_ARGS(&pFactory));
+
+    // The golden set is written on the reference machine, until then it is skipped.
+    if (options.isUpdate)
+    {
+        CreateDirectory(options.lpGoldenDir, NULL);
+        options.golden = PAINTBENCH_GOLDEN_UPDATE;
+    }
+    else if (INVALID_FILE_ATTRIBUTES == GetFileAttributes(options.lpGoldenDir))
+    {
+        options.golden = PAINTBENCH_GOLDEN_SKIP;
+    }
+    else
+    {
+        options.golden = PAINTBENCH_GOLDEN_COMPARE;
+    }
+
+    int nFailCount = CheckDirtyRects();
+    nFailCount += CheckGifFrameCache(options);
+    if (FAILED(hr))
+    {
+        _tprintf(_T("Cannot create the WIC factory, hr = 0x%08X\n"), hr);
+        nFailCount++;
+    }
+    else
+    {
+        // The direct run goes first, it is compared with the golden files and the cached run
+        // is compared with its frames.
+        vector<PAINTFRAME> vctDirectFrames;
+        PAINTBENCHRESULT directResult;
+        PAINTBENCHRESULT cachedResult;
+        nFailCount += RunCase(pFactory, FALSE, options, vctDirectFrames, directResult) ? 0 : 1;
+        nFailCount += RunCase(pFactory, TRUE, options, vctDirectFrames, cachedResult) ? 0 : 1;
+
+        PrintResult(_T("direct"), options.nFrames, directResult);
+        PrintResult(_T("cached"), options.nFrames, cachedResult);
+    }
+
+    if (PAINTBENCH_GOLDEN_SKIP == options.golden)
+    {
+        _tprintf(_T("golden   SKIPPED, %s does not exist, run with -update to write the golden set\n"),
+            options.lpGoldenDir);
+    }
+
+    SAFE_RELEASE(pFactory);
+    SdkUIRunTime::UninitializeUIRunTime();
+    CoUninitialize();
+
+    if (0 != nFailCount)
+    {
+        return 1;
+    }
+
+    return (PAINTBENCH_GOLDEN_SKIP == options.golden) ? PAINTBENCH_EXIT_SKIPPED : 0;
+}
@@ -0,0 +1,298 @@
+// TestPixelKernelBenchmark.cpp : Benchmark of the SdkPixelKernels against the scalar code.
+//
+// The kernels do not use Windows, so the benchmark also runs headless on Linux:
+//
+//   g++ -O2 -I Test/TestPixelKernelBenchmark -I SdkCommonLib/Src/Include -o pixelbench
+//       Test/TestPixelKernelBenchmark/TestPixelKernelBenchmark.cpp SdkCommonLib/Src/Src/SdkPixelKernels.cpp
+//   ./pixelbench [-n repeat] [-s width height]
+//
+// Every kernel runs with the scalar code and the SIMD code on the same images, the results
+// must be the same. Some images have odd sizes, so the tails of the SIMD code are checked too.
+//
+
+#include "stdafx.h"
+#include "SdkPixelKernels.h"
+
+using namespace std;
+USING_NAMESPACE_UTILITIES
+
+typedef struct _PIXELBENCHIMAGE
+{
+    UINT            uWidth;             // The width of the image.
+    UINT            uHeight;            // The height of the image.
+    vector<UINT32>  vctPixels;          // The premultiplied pixels.
+
+} PIXELBENCHIMAGE;
+
+typedef struct _PIXELBENCHCASE
+{
+    const char     *pszName;            // The name of the kernel.
+    UINT            uDestWidth;         // The width of the result, 0 means the kernel is not a resize.
+    UINT            uDestHeight;        // The height of the result.
+    int             nKernel;            // The kernel, see RunKernel.
+
+} PIXELBENCHCASE;
+
+
+//////////////////////////////////////////////////////////////////////////
+
+static double GetSeconds()
+{
+#ifdef _WIN32
+    LARGE_INTEGER liFrequency, liCounter;
+    QueryPerformanceFrequency(&liFrequency);
+    QueryPerformanceCounter(&liCounter);
+    return (double)liCounter.QuadPart / liFrequency.QuadPart;
+#else
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+#endif // _WIN32
+}
+
+//////////////////////////////////////////////////////////////////////////
+
+static void MakeImage(UINT uWidth, UINT uHeight, UINT32 uSeed, PIXELBENCHIMAGE &image)
+{
+    image.uWidth = uWidth;
+    image.uHeight = uHeight;
+    image.vctPixels.resize((size_t)uWidth * uHeight);
+
+    // Gradients with some noise, a transparent hole and some pixels of the color key.
+    for (UINT y = 0; y < uHeight; ++y)
+    {
+        for (UINT x = 0; x < uWidth; ++x)
+        {
+            uSeed = uSeed * 1103515245 + 12345;
+            UINT32 uAlpha = ((x / 16 + y / 16) % 5 == 0) ? 0 : 255 - ((uSeed >> 24) & 0x3F);
+            UINT32 uBlue  = (x * 255 / uWidth) ^ ((uSeed >> 16) & 0x0F);
+            UINT32 uGreen = (y * 255 / uHeight);
+            UINT32 uRed   = ((x + y) * 3) & 0xFF;
+            UINT32 uPixel = (uAlpha << 24) | (uRed << 16) | (uGreen << 8) | uBlue;
+            image.vctPixels[(size_t)y * uWidth + x] = (0 == (uSeed >> 29)) ? (uPixel & 0xFF000000) | 0xFF00FF : uPixel;
+        }
+    }
+
+    SdkPixelKernels::PremultiplyAlpha(&image.vctPixels[0], image.vctPixels.size());
+}
+
+//////////////////////////////////////////////////////////////////////////
+
+static void RunKernel(const PIXELBENCHCASE &kernel, const PIXELBENCHIMAGE &image, vector<BYTE> &vctOut)
+{
+    size_t nCount = image.vctPixels.size();
+    UINT uStride = image.uWidth * 4;
+
+    switch (kernel.nKernel)
+    {
+    case 0:
+        {
+            vctOut.assign((const BYTE*)&image.vctPixels[0], (const BYTE*)&image.vctPixels[0] + nCount * 4);
+            SdkPixelKernels::UnpremultiplyAlpha((UINT32*)&vctOut[0], nCount);
+        }
+        break;
+
+    case 1:
+        {
+            vctOut.assign((const BYTE*)&image.vctPixels[0], (const BYTE*)&image.vctPixels[0] + nCount * 4);
+            SdkPixelKernels::UnpremultiplyAlpha((UINT32*)&vctOut[0], nCount);
+            SdkPixelKernels::PremultiplyAlpha((UINT32*)&vctOut[0], nCount);
+        }
+        break;
+
+    case 2:
+        {
+            vctOut.resize(nCount * 4);
+            SdkPixelKernels::SwapRedBlue(&image.vctPixels[0], (UINT32*)&vctOut[0], nCount);
+        }
+        break;
+
+    case 3:
+        {
+            UINT uMaskStride = ((image.uWidth + 15) / 16) * 2;
+            vctOut.resize((size_t)uMaskStride * image.uHeight + sizeof(size_t));
+            size_t nMatched = SdkPixelKernels::CreateColorKeyMask((const BYTE*)&image.vctPixels[0], image.uWidth,
+                image.uHeight, uStride, 0xFF00FF, &vctOut[0], uMaskStride);
+            memcpy(&vctOut[(size_t)uMaskStride * image.uHeight], &nMatched, sizeof(size_t));
+        }
+        break;
+
+    default:
+        {
+            vctOut.resize((size_t)kernel.uDestWidth * kernel.uDestHeight * 4);
+            SdkPixelKernels::ResizeImage((const BYTE*)&image.vctPixels[0], image.uWidth, image.uHeight, uStride,
+                &vctOut[0], kernel.uDestWidth, kernel.uDestHeight, kernel.uDestWidth * 4,
+                (PIXEL_RESIZE_FILTER)(kernel.nKernel - 4));
+        }
+        break;
+    }
+}
+
+//////////////////////////////////////////////////////////////////////////
+
+static BOOL CheckKernel(const PIXELBENCHCASE &kernel, const PIXELBENCHIMAGE &image, UINT32 nSupportedLevel)
+{
+    vector<BYTE> vctScalar;
+    vector<BYTE> vctSimd;
+
+    SdkPixelKernels::SetSimdLevel(PIXEL_SIMD_NONE);
+    RunKernel(kernel, image, vctScalar);
+    SdkPixelKernels::SetSimdLevel(nSupportedLevel);
+    RunKernel(kernel, image, vctSimd);
+
+    return (vctScalar == vctSimd) ? TRUE : FALSE;
+}
+
+//////////////////////////////////////////////////////////////////////////
+
+static BOOL CheckReference(const PIXELBENCHIMAGE &image)
+{
+    // The premultiplication rounds to the nearest, the same as (c * a + 127) / 255.
+    BOOL isOK = TRUE;
+    vector<UINT32> vctPixels(256 * 256);
+    for (UINT32 a = 0; a < 256; ++a)
+    {
+        for (UINT32 c = 0; c < 256; ++c)
+        {
+            vctPixels[a * 256 + c] = (a << 24) | (c << 16) | (c << 8) | c;
+        }
+    }
+    SdkPixelKernels::PremultiplyAlpha(&vctPixels[0], vctPixels.size());
+    for (UINT32 a = 0; a < 256; ++a)
+    {
+        for (UINT32 c = 0; c < 256; ++c)
+        {
+            UINT32 v = (c * a + 127) / 255;
+            isOK = isOK && (vctPixels[a * 256 + c] == ((a << 24) | (v << 16) | (v << 8) | v));
+        }
+    }
+
+    // The opaque pixels do not change in the unpremultiplication, the swap is undone by itself.
+    vector<UINT32> vctOpaque(image.vctPixels);
+    for (size_t i = 0; i < vctOpaque.size(); ++i)
+    {
+        vctOpaque[i] |= 0xFF000000;
+    }
+    vector<UINT32> vctCopy(vctOpaque);
+    SdkPixelKernels::UnpremultiplyAlpha(&vctCopy[0], vctCopy.size());
+    isOK = isOK && (vctCopy == vctOpaque);
+    SdkPixelKernels::SwapRedBlue(&vctCopy[0], &vctCopy[0], vctCopy.size());
+    SdkPixelKernels::SwapRedBlue(&vctCopy[0], &vctCopy[0], vctCopy.size());
+    isOK = isOK && (vctCopy == vctOpaque);
+
+    // A flat image keeps its color with all filters.
+    vector<UINT32> vctFlat(37 * 23, 0x80402010);
+    vector<UINT32> vctResized(91 * 11, 0);
+    for (int nFilter = PIXEL_RESIZE_BOX; nFilter <= PIXEL_RESIZE_LANCZOS; ++nFilter)
+    {
+        SdkPixelKernels::ResizeImage((const BYTE*)&vctFlat[0], 37, 23, 37 * 4, (BYTE*)&vctResized[0], 91, 11, 91 * 4,
+            (PIXEL_RESIZE_FILTER)nFilter);
+        for (size_t i = 0; i < vctResized.size(); ++i)
+        {
+            isOK = isOK && (0x80402010 == vctResized[i]);
+        }
+    }
+
+    return isOK;
+}
+
+//////////////////////////////////////////////////////////////////////////
+
+int main(int argc, char* argv[])
+{
+    int nRepeat = 10;
+    UINT uWidth = 1920;
+    UINT uHeight = 1080;
+    for (int i = 1; i < argc; ++i)
+    {
+        if ( (0 == strcmp(argv[i], "-n")) && (i + 1 < argc) )
+        {
+            nRepeat = atoi(argv[++i]);
+            nRepeat = (nRepeat > 0) ? nRepeat : 1;
+        }
+        else if ( (0 == strcmp(argv[i], "-s")) && (i + 2 < argc) )
+        {
+            uWidth  = (UINT)atoi(argv[++i]);
+            uHeight = (UINT)atoi(argv[++i]);
+            uWidth  = (uWidth > 0) ? uWidth : 1;
+            uHeight = (uHeight > 0) ? uHeight : 1;
+        }
+    }
+
+    UINT32 nSupportedLevel = SdkPixelKernels::GetSimdLevel();
+    int nFailCount = 0;
+
+    // The sizes which are not multiples of the SIMD width check the tails.
+    const UINT checkSizes[][2] = { { 1, 1 }, { 7, 3 }, { 17, 9 }, { 33, 65 }, { 255, 129 } };
+    for (size_t i = 0; i < sizeof(checkSizes) / sizeof(checkSizes[0]); ++i)
+    {
+        PIXELBENCHIMAGE image;
+        MakeImage(checkSizes[i][0], checkSizes[i][1], (UINT32)(i + 1), image);
+        nFailCount += CheckReference(image) ? 0 : 1;
+
+        UINT uW = image.uWidth, uH = image.uHeight;
+        const UINT destSizes[][2] = { { uW, uH }, { (uW + 2) / 3, (uH + 1) / 2 }, { uW * 2 + 1, uH * 3 }, { uW, uH * 2 + 1 }, { uW * 3 + 2, uH } };
+        for (int nKernel = 0; nKernel < 7; ++nKernel)
+        {
+            for (size_t j = 0; j < sizeof(destSizes) / sizeof(destSizes[0]); ++j)
+            {
+                PIXELBENCHCASE kernel = { "", destSizes[j][0], destSizes[j][1], nKernel };
+                nFailCount += CheckKernel(kernel, image, nSupportedLevel) ? 0 : 1;
+                if (nKernel < 4)
+                {
+                    break;
+                }
+            }
+        }
+    }
+
+    PIXELBENCHIMAGE image;
+    MakeImage(uWidth, uHeight, 2011, image);
+
+    const PIXELBENCHCASE kernels[] =
+    {
+        { "unpremultiply",          0, 0, 0 },
+        { "unpremultiply + premultiply", 0, 0, 1 },
+        { "swap red blue",          0, 0, 2 },
+        { "color key mask",         0, 0, 3 },
+        { "box 1/2",                (uWidth + 1) / 2, (uHeight + 1) / 2, 4 + PIXEL_RESIZE_BOX },
+        { "bilinear 1/2",           (uWidth + 1) / 2, (uHeight + 1) / 2, 4 + PIXEL_RESIZE_BILINEAR },
+        { "lanczos 1/2",            (uWidth + 1) / 2, (uHeight + 1) / 2, 4 + PIXEL_RESIZE_LANCZOS },
+        { "bilinear thumbnail",     (uWidth + 7) / 8, (uHeight + 7) / 8, 4 + PIXEL_RESIZE_BILINEAR },
+        { "bilinear x1.5",          uWidth * 3 / 2, uHeight * 3 / 2, 4 + PIXEL_RESIZE_BILINEAR },
+        { "lanczos x1.5",           uWidth * 3 / 2, uHeight * 3 / 2, 4 + PIXEL_RESIZE_LANCZOS },
+    };
+
+    printf("pixel SIMD level = %u, image = %ux%u, repeat = %d\n", nSupportedLevel, uWidth, uHeight, nRepeat);
+    printf("%-30s %10s %10s %8s %6s\n", "kernel", "scalar", "SIMD", "speedup", "check");
+
+    vector<BYTE> vctOut;
+    for (size_t i = 0; i < sizeof(kernels) / sizeof(kernels[0]); ++i)
+    {
+        BOOL isSame = CheckKernel(kernels[i], image, nSupportedLevel);
+        nFailCount += isSame ? 0 : 1;
+
+        UINT32 levels[2] = { PIXEL_SIMD_NONE, nSupportedLevel };
+        double seconds[2] = { 0 };
+        for (int nLevel = 0; nLevel < 2; ++nLevel)
+        {
+            SdkPixelKernels::SetSimdLevel(levels[nLevel]);
+            double dBegin = GetSeconds();
+            for (int n = 0; n < nRepeat; ++n)
+            {
+                RunKernel(kernels[i], image, vctOut);
+            }
+            seconds[nLevel] = GetSeconds() - dBegin;
+        }
+        SdkPixelKernels::SetSimdLevel(nSupportedLevel);
+
+        // The speed is in the source megapixels per second.
+        double dMegaPixels = (double)uWidth * uHeight * nRepeat / 1e6;
+        printf("%-30s %10.1f %10.1f %7.2fx %6s\n", kernels[i].pszName, dMegaPixels / seconds[0],
+            dMegaPixels / seconds[1], seconds[0] / seconds[1], isSame ? "OK" : "FAILED");
+    }
+
+    printf("%s\n", (0 == nFailCount) ? "all checks passed" : "some checks FAILED");
+
+    return (0 == nFailCount) ? 0 : 1;
+}
@@ -0,0 +1,421 @@
+// TestThemeAtlasBenchmark.cpp : Benchmark and pixel test of the bitmap atlas of the D2D theme.
+//
+// The skin images are drawn by SdkD2DTheme into the software render target, so no window is
+// created and the frames do not depend on the display adapter. Link with SdkCommonLib and
+// SdkFrameworkLib:
+//
+//   TestThemeAtlasBenchmark.exe [-n frames] [-t tolerance]
+//
+// The images loaded from the shared HBITMAPs of SdkResManager are drawn from the pages of the
+// atlas, the standalone copies loaded by LoadFromHBITMAP are drawn from their own bitmaps. Every
+// image is drawn at its size, stretched, shrunk and at a half pixel offset, and the frame drawn
+// from the atlas is compared with the frame drawn from the standalone copies. The check is done
+// again after the render target is recreated and after the device is deleted, so the atlas is
+// packed again for the new render target. At last a frame of many skinned views is timed with
+// and without the atlas.
+//
+
+#include "stdafx.h"
+#include "SdkCommonInclude.h"
+#include "SdkUICommonInclude.h"
+#include "SdkD2DTheme.h"
+#include "..\..\SdkResourceLib\Resources\Resource.h"
+
+using namespace std;
+USING_NAMESPACE_D2D
+USING_NAMESPACE_THEME
+USING_NAMESPACE_UILIB
+
+#define ATLASBENCH_WIDTH        800             // The width of the frame.
+#define ATLASBENCH_HEIGHT       600             // The height of the frame.
+#define ATLASBENCH_COLS         24              // The columns of the views in the timed frame.
+#define ATLASBENCH_ROWS         30              // The rows of the views in the timed frame.
+#define ATLASBENCH_CELL_WIDTH   32.0f           // The width of one view in the timed frame.
+#define ATLASBENCH_CELL_HEIGHT  20.0f           // The height of one view in the timed frame.
+
+/*!
+* @brief The skin images drawn by the test.
+*/
+static const int g_nSkinImageIds[] =
+{
+    IDB_BUTTON_BK_NORMAL,   IDB_BUTTON_BK_HOVER,      IDB_BUTTON_BK_DOWN,      IDB_BUTTON_BK_DISABLE,
+    IDB_COMBOBOX_NORMAL,    IDB_COMBOBOX_HOVER,       IDB_COMBOBOX_DOWN,       IDB_COMBOBOX_DISABLE,
+    IDB_RADIOBUTOTN_NORMAL, IDB_RADIOBUTOTN_HOVER,    IDB_RADIOBUTOTN_DOWN,    IDB_RADIOBUTOTN_DISABLE,
+    IDB_CHECKBOX_NORMAL,    IDB_CHECKBOX_HOVER,       IDB_CHECKBOX_DOWN,       IDB_CHECKBOX_DISABLE,
+    IDB_TAB_NORMAL,         IDB_TAB_NORMAL_HOVER,     IDB_TAB_NORMAL_PRESS,    IDB_TAB_SELECT,
+};
+
+/*!
+* @brief One bitmap drawn in the frame.
+*/
+typedef struct _ATLASBENCHDRAW
+{
+    int             nImageIndex;        // The index of the image in g_nSkinImageIds.
+    D2D1_RECT_F     rcDest;             // The destination rectangle.
+
+} ATLASBENCHDRAW;
+
+/*!
+* @brief The result of the timed frames of one case.
+*/
+typedef struct _ATLASBENCHRESULT
+{
+    double      dFirstTime;             // The seconds of the first frame, the bitmaps are created.
+    double      dTotalTime;             // The seconds of the other frames.
+    int         nDrawCount;             // The number of the bitmaps drawn in one frame.
+
+} ATLASBENCHRESULT;
+
+
+//////////////////////////////////////////////////////////////////////////
+
+static double GetSeconds()
+{
+    LARGE_INTEGER liFrequency, liCounter;
+    QueryPerformanceFrequency(&liFrequency);
+    QueryPerformanceCounter(&liCounter);
+    return (double)liCounter.QuadPart / liFrequency.QuadPart;
+}
+
+//////////////////////////////////////////////////////////////////////////
+
+static void LoadBitmaps(BOOL isShared, int nCount, vector<D2DBitmap*> &vctBitmaps)
+{
+    // Every view owns its D2DBitmap, the views of the same skin share the image of SdkResManager.
+    for (int i = 0; i < nCount; ++i)
+    {
+        HBITMAP hBitmap = SdkResManager::GetImage(g_nSkinImageIds[i % ARRAYSIZE(g_nSkinImageIds)]);
+
+        D2DBitmap *pBitmap = new D2DBitmap();
+        if (isShared)
+        {
+            pBitmap->LoadFromSharedHBITMAP(hBitmap);
+        }
+        else
+        {
+            pBitmap->LoadFromHBITMAP(hBitmap);
+        }
+
+        vctBitmaps.push_back(pBitmap);
+    }
+}
+
+//////////////////////////////////////////////////////////////////////////
+
+static void DeleteBitmaps(vector<D2DBitmap*> &vctBitmaps)
+{
+    for each (D2DBitmap *pBitmap in vctBitmaps)
+    {
+        SAFE_DELETE(pBitmap);
+    }
+
+    vctBitmaps.clear();
+}
+
+//////////////////////////////////////////////////////////////////////////
+
+static void BuildCheckDraws(vector<ATLASBENCHDRAW> &vctDraws)
+{
+    // Each image is drawn at its size, stretched, shrunk and at a half pixel offset. The
+    // filtering of the scaled and offset draws reads the edge pixels, so the gutter of the
+    // atlas is checked too.
+    static const FLOAT scales[] = { 1.0f, 1.5f, 0.5f, 1.0f };
+    static const FLOAT offsets[] = { 0.0f, 0.0f, 0.0f, 0.5f };
+
+    FLOAT x = 4.0f;
+    FLOAT y = 4.0f;
+    FLOAT fRowHeight = 0.0f;
+
+    vctDraws.clear();
+    for (int i = 0; i < (int)ARRAYSIZE(g_nSkinImageIds); ++i)
+    {
+        BITMAP bmp = { 0 };
+        GetObject(SdkResManager::GetImage(g_nSkinImageIds[i]), sizeof(BITMAP), &bmp);
+
+        for (int j = 0; j < (int)ARRAYSIZE(scales); ++j)
+        {
+            FLOAT fWidth = bmp.bmWidth * scales[j];
+            FLOAT fHeight = bmp.bmHeight * scales[j];
+            if ( (x + fWidth + 4.0f > ATLASBENCH_WIDTH) && (x > 4.0f) )
+            {
+                x = 4.0f;
+                y += fRowHeight + 4.0f;
+                fRowHeight = 0.0f;
+            }
+
+            ATLASBENCHDRAW draw = { i, D2D1::RectF(x + offsets[j], y + offsets[j],
+                                                   x + offsets[j] + fWidth, y + offsets[j] + fHeight) };
+            vctDraws.push_back(draw);
+
+            x += fWidth + 4.0f;
+            fRowHeight = MAX(fRowHeight, fHeight + 1.0f);
+        }
+    }
+}
+
+//////////////////////////////////////////////////////////////////////////
+
+static void BuildTimedDraws(vector<ATLASBENCHDRAW> &vctDraws)
+{
+    vctDraws.clear();
+    for (int i = 0; i < ATLASBENCH_COLS * ATLASBENCH_ROWS; ++i)
+    {
+        FLOAT x = (i % ATLASBENCH_COLS) * ATLASBENCH_CELL_WIDTH;
+        FLOAT y = (i / ATLASBENCH_COLS) * ATLASBENCH_CELL_HEIGHT;
+
+        ATLASBENCHDRAW draw = { i, D2D1::RectF(x + 1.0f, y + 1.0f,
+                                               x + ATLASBENCH_CELL_WIDTH - 1.0f,
+                                               y + ATLASBENCH_CELL_HEIGHT - 1.0f) };
+        vctDraws.push_back(draw);
+    }
+}
+
+//////////////////////////////////////////////////////////////////////////
+
+static HRESULT DrawFrame(D2DDevice *pD2DDevice, const vector<D2DBitmap*> &vctBitmaps,
+                         const vector<ATLASBENCHDRAW> &vctDraws)
+{
+    SdkD2DTheme *pTheme = SdkD2DTheme::GetD2DThemeInstance();
+    ID2D1RenderTarget *pRT = NULL;
+
+    pD2DDevice->BeginDraw();
+    pD2DDevice->GetRenderTarget(&pRT);
+    if (NULL == pRT)
+    {
+        pD2DDevice->EndDraw();
+        return E_FAIL;
+    }
+
+    pRT->Clear(D2D1::ColorF(D2D1::ColorF::White));
+    for each (const ATLASBENCHDRAW &draw in vctDraws)
+    {
+        pTheme->OnDrawBitmap(NULL, pRT, vctBitmaps[draw.nImageIndex % vctBitmaps.size()], draw.rcDest);
+    }
+
+    SAFE_RELEASE(pRT);
+    pD2DDevice->EndDraw();
+
+    return S_OK;
+}
+
+//////////////////////////////////////////////////////////////////////////
+
+static HRESULT ReadFrame(D2DDevice *pD2DDevice, vector<BYTE> &vctPixels)
+{
+    IWICBitmap *pBitmap = NULL;
+    HRESULT hr = pD2DDevice->GetSoftwareBitmap(&pBitmap);
+
+    UINT32 uWidth = 0, uHeight = 0;
+    if (SUCCEEDED(hr))
+    {
+        hr = pBitmap->GetSize(&uWidth, &uHeight);
+    }
+
+    if (SUCCEEDED(hr))
+    {
+        vctPixels.resize(uWidth * uHeight * 4);
+        hr = pBitmap->CopyPixels(NULL, uWidth * 4, (UINT)vctPixels.size(), &vctPixels[0]);
+    }
+
+    SAFE_RELEASE(pBitmap);
+
+    return hr;
+}
+
+//////////////////////////////////////////////////////////////////////////
+
+static int ComparePixels(const vector<BYTE> &vctPixels1, const vector<BYTE> &vctPixels2, int nTolerance,
+                         int &nMaxDiff)
+{
+    nMaxDiff = 0;
+    if (vctPixels1.size() != vctPixels2.size())
+    {
+        nMaxDiff = 255;
+        return (int)(MAX(vctPixels1.size(), vctPixels2.size()) / 4);
+    }
+
+    // Count the pixels which have a channel out of the tolerance.
+    int nDiffCount = 0;
+    for (size_t i = 0; i < vctPixels1.size(); i += 4)
+    {
+        int nPixelDiff = 0;
+        for (size_t c = 0; c < 4; ++c)
+        {
+            int nDiff = abs((int)vctPixels1[i + c] - (int)vctPixels2[i + c]);
+            nPixelDiff = MAX(nPixelDiff, nDiff);
+        }
+
+        nMaxDiff = MAX(nMaxDiff, nPixelDiff);
+        nDiffCount += (nPixelDiff > nTolerance) ? 1 : 0;
+    }
+
+    return nDiffCount;
+}
+
+//////////////////////////////////////////////////////////////////////////
+
+static BOOL CheckAtlasFrame(D2DDevice *pD2DDevice, const vector<D2DBitmap*> &vctShared,
+                            const vector<ATLASBENCHDRAW> &vctDraws, int nTolerance, LPCTSTR lpCaseName)
+{
+    // The standalone copies are loaded again for every render target, the shared bitmaps are
+    // kept, like the views which live longer than the render target.
+    vector<D2DBitmap*> vctStandalone;
+    LoadBitmaps(FALSE, (int)ARRAYSIZE(g_nSkinImageIds), vctStandalone);
+
+    vector<BYTE> vctAtlas;
+    vector<BYTE> vctReference;
+    HRESULT hr = DrawFrame(pD2DDevice, vctShared, vctDraws);
+    if (SUCCEEDED(hr))
+    {
+        hr = ReadFrame(pD2DDevice, vctAtlas);
+    }
+
+    if (SUCCEEDED(hr))
+    {
+        hr = DrawFrame(pD2DDevice, vctStandalone, vctDraws);
+    }
+
+    if (SUCCEEDED(hr))
+    {
+        hr = ReadFrame(pD2DDevice, vctReference);
+    }
+
+    DeleteBitmaps(vctStandalone);
+
+    if (FAILED(hr))
+    {
+        _tprintf(_T("  %s: draw failed, hr = 0x%08X\n"), lpCaseName, hr);
+        return FALSE;
+    }
+
+    int nMaxDiff = 0;
+    int nDiffCount = ComparePixels(vctAtlas, vctReference, nTolerance, nMaxDiff);
+    _tprintf(_T("  %-24s %d draws  %d pixels differ  max difference %d  %s\n"),
+        lpCaseName, (int)vctDraws.size(), nDiffCount, nMaxDiff, (0 == nDiffCount) ? _T("ok") : _T("MISMATCH"));
+
+    return (0 == nDiffCount);
+}
+
+//////////////////////////////////////////////////////////////////////////
+
+static BOOL RunTimedCase(BOOL isShared, int nFrames, ATLASBENCHRESULT &result)
+{
+    ZeroMemory(&result, sizeof(ATLASBENCHRESULT));
+
+    // A new device, so the atlas of the other case is not used.
+    D2DDevice *pD2DDevice = new D2DDevice();
+    pD2DDevice->SetPaintTargetType(DEVICE_TARGET_TYPE_SOFTWARE);
+    HRESULT hr = pD2DDevice->InitSoftwareDevice(ATLASBENCH_WIDTH, ATLASBENCH_HEIGHT);
+
+    vector<ATLASBENCHDRAW> vctDraws;
+    BuildTimedDraws(vctDraws);
+
+    vector<D2DBitmap*> vctBitmaps;
+    LoadBitmaps(isShared, (int)vctDraws.size(), vctBitmaps);
+    result.nDrawCount = (int)vctDraws.size();
+
+    for (int n = 0; (n < nFrames) && SUCCEEDED(hr); ++n)
+    {
+        double dStart = GetSeconds();
+        hr = DrawFrame(pD2DDevice, vctBitmaps, vctDraws);
+        double dTime = GetSeconds() - dStart;
+
+        if (0 == n)
+        {
+            result.dFirstTime = dTime;
+        }
+        else
+        {
+            result.dTotalTime += dTime;
+        }
+    }
+
+    DeleteBitmaps(vctBitmaps);
+    SAFE_DELETE(pD2DDevice);
+
+    return SUCCEEDED(hr);
+}
+
+//////////////////////////////////////////////////////////////////////////
+
+static void PrintResult(LPCTSTR lpCaseName, int nFrames, const ATLASBENCHRESULT &result)
+{
+    _tprintf(_T("%-10s %5d frames  %d views  first %8.3f ms  avg %8.3f ms  %6.3f us/draw\n"),
+        lpCaseName, nFrames, result.nDrawCount,
+        result.dFirstTime * 1e3,
+        result.dTotalTime * 1e3 / MAX(nFrames - 1, 1),
+        result.dTotalTime * 1e6 / MAX(nFrames - 1, 1) / MAX(result.nDrawCount, 1));
+}
+
+//////////////////////////////////////////////////////////////////////////
+
+int _tmain(int argc, _TCHAR* argv[])
+{
+    int nFrames = 200;
+    int nTolerance = 2;
+
+    for (int i = 1; i < argc; ++i)
+    {
+        if ( (0 == _tcscmp(argv[i], _T("-n"))) && (i + 1 < argc) )
+        {
+            nFrames = _ttoi(argv[++i]);
+            nFrames = (nFrames > 1) ? nFrames : 2;
+        }
+        else if ( (0 == _tcscmp(argv[i], _T("-t"))) && (i + 1 < argc) )
+        {
+            nTolerance = _ttoi(argv[++i]);
+        }
+    }
+
+    CoInitialize(NULL);
+    SdkUIRunTime::InitializeUIRunTime();
+
+    int nFailCount = 0;
+    vector<ATLASBENCHDRAW> vctDraws;
+    BuildCheckDraws(vctDraws);
+
+    vector<D2DBitmap*> vctShared;
+    LoadBitmaps(TRUE, (int)ARRAYSIZE(g_nSkinImageIds), vctShared);
+
+    D2DDevice *pD2DDevice = new D2DDevice();
+    pD2DDevice->SetPaintTargetType(DEVICE_TARGET_TYPE_SOFTWARE);
+    HRESULT hr = pD2DDevice->InitSoftwareDevice(ATLASBENCH_WIDTH, ATLASBENCH_HEIGHT);
+    if (FAILED(hr))
+    {
+        _tprintf(_T("Cannot create the software render target, hr = 0x%08X\n"), hr);
+        nFailCount++;
+    }
+    else
+    {
+        _tprintf(_T("Atlas against standalone bitmaps:\n"));
+        nFailCount += CheckAtlasFrame(pD2DDevice, vctShared, vctDraws, nTolerance, _T("first target")) ? 0 : 1;
+
+        // Another size recreates the render target of the same device.
+        hr = pD2DDevice->InitSoftwareDevice(ATLASBENCH_WIDTH, ATLASBENCH_HEIGHT + 1);
+        nFailCount += SUCCEEDED(hr) ? 0 : 1;
+        nFailCount += CheckAtlasFrame(pD2DDevice, vctShared, vctDraws, nTolerance, _T("recreated target")) ? 0 : 1;
+
+        // The device is deleted, the atlas of its render target is not used any more.
+        SAFE_DELETE(pD2DDevice);
+        pD2DDevice = new D2DDevice();
+        pD2DDevice->SetPaintTargetType(DEVICE_TARGET_TYPE_SOFTWARE);
+        hr = pD2DDevice->InitSoftwareDevice(ATLASBENCH_WIDTH, ATLASBENCH_HEIGHT);
+        nFailCount += SUCCEEDED(hr) ? 0 : 1;
+        nFailCount += CheckAtlasFrame(pD2DDevice, vctShared, vctDraws, nTolerance, _T("recreated device")) ? 0 : 1;
+
+        ATLASBENCHRESULT atlasResult;
+        ATLASBENCHRESULT standaloneResult;
+        nFailCount += RunTimedCase(TRUE, nFrames, atlasResult) ? 0 : 1;
+        nFailCount += RunTimedCase(FALSE, nFrames, standaloneResult) ? 0 : 1;
+
+        PrintResult(_T("atlas"), nFrames, atlasResult);
+        PrintResult(_T("standalone"), nFrames, standaloneResult);
+    }
+
+    SAFE_DELETE(pD2DDevice);
+    DeleteBitmaps(vctShared);
+    SdkUIRunTime::UninitializeUIRunTime();
+    CoUninitialize();
+
+    return (0 == nFailCount) ? 0 : 1;
+}
@@ -0,0 +1,449 @@
+// TestViewTreeBenchmark.cpp : Benchmark of the cached absolute transforms and drawing rectangles
+// of the view tree.
+//
+// The views are not attached to a window, so no device is created. Link with SdkCommonLib and
+// SdkFrameworkLib:
+//
+//   TestViewTreeBenchmark.exe [-n repeat]
+//
+// Every tree is queried three ways: the parent walk which GetAbsoluteMatrix and GetAbsolutePoint
+// did before the cache, the cache rebuilt after the root is moved, and the cache which is valid.
+// Before the timing, the walk and the cache are compared after every change of the tree: the
+// T, S, R matrices and the animations of some views are changed, some views are removed to the
+// cache of their parent and their old parent is moved, and some views are moved to another
+// parent. The rectangles of the walk and the cache must be the same.
+//
+
+#include "stdafx.h"
+#include "SdkCommonInclude.h"
+#include "SdkUICommonInclude.h"
+
+using namespace std;
+USING_NAMESPACE_VIEWS
+USING_NAMESPACE_ANIMATION
+
+/*!
+* @brief The animation of the benchmark, its matrix is set by the benchmark instead of the timer.
+*/
+class BenchAnimation : public SdkAnimation
+{
+public:
+
+    BenchAnimation() : m_matrix(Matrix3x2F::Identity())
+    {
+    }
+
+    void SetMatrix(const Matrix3x2F &matrix)
+    {
+        m_matrix = matrix;
+    }
+
+    virtual HRESULT GetTransform(OUT LPTRANSFORMINFO pTransform, IN BOOL bUpdateValue = TRUE)
+    {
+        UNREFERENCED_PARAMETER(bUpdateValue);
+
+        pTransform->typeTransform = TRANSFORM_TYPE_UNKNOWN;
+        pTransform->matrixTransform = m_matrix;
+        pTransform->dAlpha = 1.0;
+
+        return S_OK;
+    }
+
+private:
+
+    Matrix3x2F      m_matrix;           // The animation matrix.
+};
+
+/*!
+* @brief The view of the benchmark, it walks the parents as the view did before the cache.
+*/
+class BenchView : public SdkViewLayout
+{
+public:
+
+    BenchView() : m_walkViewMatrix(Matrix3x2F::Identity()),
+                  m_isTSRPending(FALSE),
+                  m_fDx(0.0f),
+                  m_fDy(0.0f),
+                  m_fScale(1.0f),
+                  m_fAngle(0.0f)
+    {
+    }
+
+    /*!
+    * @brief Set the T, S, R of the view, the scale and the rotation are around the center.
+    *        The matrix takes effect in ApplyTransform, as it does in OnPaint.
+    */
+    void SetTSR(FLOAT fDx, FLOAT fDy, FLOAT fScale, FLOAT fAngle)
+    {
+        POINTF centerPt = { GetWidth() / 2, GetHeight() / 2 };
+
+        Translate(fDx, fDy);
+        Scale(fScale, fScale, centerPt);
+        Rotate(fAngle, centerPt);
+
+        m_fDx = fDx;
+        m_fDy = fDy;
+        m_fScale = fScale;
+        m_fAngle = fAngle;
+        m_isTSRPending = TRUE;
+    }
+
+    /*!
+    * @brief Combine the T, S, R matrix and sync the animation matrix, as OnPaint does before
+    *        the children are drawn.
+    */
+    void ApplyTransform()
+    {
+        if (m_isTSRPending)
+        {
+            // The same matrix as GetTSRMatrix, but with the offset of the walk.
+            Matrix3x2F parentMatrix = Matrix3x2F::Identity();
+            D2D1_POINT_2F offset = { 0.0f, 0.0f };
+            WalkParents(parentMatrix, offset);
+
+            D2D1_POINT_2F centerPt =
+            {
+                GetWidth() / 2 + (FLOAT)((LONG)GetLeft() + (LONG)offset.x),
+                GetHeight() / 2 + (FLOAT)((LONG)GetTop() + (LONG)offset.y)
+            };
+
+            m_walkViewMatrix = Matrix3x2F::Translation(m_fDx, m_fDy) *
+                               Matrix3x2F::Scale(m_fScale, m_fScale, centerPt) *
+                               Matrix3x2F::Rotation(m_fAngle, centerPt);
+            m_isTSRPending = FALSE;
+
+            CombineTSRMatrix();
+        }
+
+        SyncAnimationMatrix();
+    }
+
+    /*!
+    * @brief Get the drawing rectangle by walking the parents, as it was done before the cache.
+    *        The four corners of the rectangle are transformed and their bounding box is returned.
+    */
+    D2D1_RECT_F GetWalkedDrawingRect()
+    {
+        Matrix3x2F parentMatrix = Matrix3x2F::Identity();
+        D2D1_POINT_2F offset = { 0.0f, 0.0f };
+        WalkParents(parentMatrix, offset);
+
+        LONG left = (LONG)GetLeft() + (LONG)offset.x;
+        LONG top  = (LONG)GetTop() + (LONG)offset.y;
+        D2D1_RECT_F drawRc = D2D1::RectF((FLOAT)left, (FLOAT)top,
+            (FLOAT)(left + (LONG)GetWidth()), (FLOAT)(top + (LONG)GetHeight()));
+
+        // The animation of the view is not cached, it is multiplied only if the view has one.
+        Matrix3x2F matrix = m_walkViewMatrix * parentMatrix;
+        if (NULL != GetAnimation())
+        {
+            matrix = matrix * GetAnimationMatrix();
+        }
+
+        if (!matrix.IsIdentity())
+        {
+            D2D1_POINT_2F leftTopPT     = matrix.TransformPoint(D2D1::Point2F(drawRc.left,  drawRc.top));
+            D2D1_POINT_2F leftBottomPT  = matrix.TransformPoint(D2D1::Point2F(drawRc.left,  drawRc.bottom));
+            D2D1_POINT_2F rightTopPT    = matrix.TransformPoint(D2D1::Point2F(drawRc.right, drawRc.top));
+            D2D1_POINT_2F rightBottomPT = matrix.TransformPoint(D2D1::Point2F(drawRc.right, drawRc.bottom));
+
+            drawRc.left   = MIN(MIN(leftTopPT.x, leftBottomPT.x), MIN(rightTopPT.x, rightBottomPT.x));
+            drawRc.top    = MIN(MIN(leftTopPT.y, leftBottomPT.y), MIN(rightTopPT.y, rightBottomPT.y));
+            drawRc.right  = MAX(MAX(leftTopPT.x, leftBottomPT.x), MAX(rightTopPT.x, rightBottomPT.x));
+            drawRc.bottom = MAX(MAX(leftTopPT.y, leftBottomPT.y), MAX(rightTopPT.y, rightBottomPT.y));
+        }
+
+        return drawRc;
+    }
+
+private:
+
+    /*!
+    * @brief Walk the parents from the root down. The offsets are added and the matrices are
+    *        multiplied in the same order as the cache, so the results are the same to the bit.
+    *
+    * @param parentMatrix   [ /O] The view and animation matrices of all parents.
+    * @param offset         [ /O] The offset of all parents.
+    */
+    void WalkParents(Matrix3x2F &parentMatrix, D2D1_POINT_2F &offset)
+    {
+        BenchView *pParentView = static_cast<BenchView*>(GetParent());
+        if (NULL == pParentView)
+        {
+            return;
+        }
+
+        pParentView->WalkParents(parentMatrix, offset);
+
+        offset.x = offset.x + pParentView->GetLeft();
+        offset.y = offset.y + pParentView->GetTop();
+        parentMatrix = pParentView->m_walkViewMatrix * pParentView->GetAnimationMatrix() * parentMatrix;
+    }
+
+    Matrix3x2F      m_walkViewMatrix;   // The T, S, R matrix which is combined.
+    BOOL            m_isTSRPending;     // Whether the T, S, R is set but not combined.
+    FLOAT           m_fDx;              // The translation on the x axis.
+    FLOAT           m_fDy;              // The translation on the y axis.
+    FLOAT           m_fScale;           // The scale around the center.
+    FLOAT           m_fAngle;           // The rotation around the center, in degrees.
+};
+
+typedef struct _VIEWTREEBENCHCASE
+{
+    const char     *pszName;            // The name of the tree.
+    UINT            uDepth;             // The levels below the root.
+    UINT            uFanOut;            // The children of every layout.
+
+} VIEWTREEBENCHCASE;
+
+#define VIEWTREEBENCH_ANIMATION_COUNT   3
+
+
+//////////////////////////////////////////////////////////////////////////
+
+static double GetSeconds()
+{
+    LARGE_INTEGER liFrequency, liCounter;
+    QueryPerformanceFrequency(&liFrequency);
+    QueryPerformanceCounter(&liCounter);
+    return (double)liCounter.QuadPart / liFrequency.QuadPart;
+}
+
+//////////////////////////////////////////////////////////////////////////
+
+static void BuildTree(BenchView *pParent, UINT uDepth, UINT uFanOut, vector<BenchView*> &vctViews)
+{
+    if (0 == uDepth)
+    {
+        return;
+    }
+
+    for (UINT i = 0; i < uFanOut; ++i)
+    {
+        BenchView *pView = new BenchView();
+        pView->SetLayoutInfo((FLOAT)(i % 64) * 3.0f + 1.0f, (FLOAT)(i / 64) * 2.0f + 1.0f, 40.0f, 20.0f);
+        pParent->AddView(pView);
+        vctViews.push_back(pView);
+
+        BuildTree(pView, uDepth - 1, uFanOut, vctViews);
+    }
+}
+
+//////////////////////////////////////////////////////////////////////////
+
+static UINT CheckTree(const vector<BenchView*> &vctViews)
+{
+    UINT uMismatchCount = 0;
+    for (size_t i = 0; i < vctViews.size(); ++i)
+    {
+        D2D1_RECT_F walkRc = vctViews[i]->GetWalkedDrawingRect();
+        D2D1_RECT_F cacheRc = vctViews[i]->GetDrawingRect();
+        if (0 != memcmp(&walkRc, &cacheRc, sizeof(D2D1_RECT_F)))
+        {
+            uMismatchCount++;
+        }
+    }
+
+    return uMismatchCount;
+}
+
+//////////////////////////////////////////////////////////////////////////
+
+static void TransformTree(const vector<BenchView*> &vctViews, BenchAnimation *pAnimations, UINT uRound)
+{
+    // Every 7th view is transformed, the scale is kept around 1 so the deep trees stay in range.
+    for (size_t i = 0; i < vctViews.size(); ++i)
+    {
+        if (3 == (i + uRound) % 7)
+        {
+            FLOAT fScale = (0 == (i & 1)) ? 1.05f : 0.95f;
+            vctViews[i]->SetTSR((FLOAT)uRound + 1.0f, 1.0f, fScale, (FLOAT)((i + uRound) % 31) - 15.0f);
+        }
+
+        if ( (0 == uRound) && (5 == i % 11) )
+        {
+            vctViews[i]->SetAnimation(&pAnimations[i % VIEWTREEBENCH_ANIMATION_COUNT]);
+        }
+    }
+
+    for (UINT i = 0; i < VIEWTREEBENCH_ANIMATION_COUNT; ++i)
+    {
+        D2D1_POINT_2F centerPt = { 100.0f * i, 50.0f };
+        pAnimations[i].SetMatrix(Matrix3x2F::Rotation((FLOAT)(5 * i + uRound), centerPt) *
+                                 Matrix3x2F::Translation((FLOAT)uRound, (FLOAT)i));
+    }
+
+    // The parents are before their children, as the views are painted.
+    for (size_t i = 0; i < vctViews.size(); ++i)
+    {
+        vctViews[i]->ApplyTransform();
+    }
+}
+
+//////////////////////////////////////////////////////////////////////////
+
+static UINT ChangeTree(BenchView *pRoot, const vector<BenchView*> &vctViews, BenchAnimation *pAnimations)
+{
+    UINT uMismatchCount = 0;
+
+    // The T, S, R matrices and the animations.
+    TransformTree(vctViews, pAnimations, 0);
+    uMismatchCount += CheckTree(vctViews);
+    TransformTree(vctViews, pAnimations, 1);
+    pRoot->SetViewPos(5.0f, 3.0f);
+    uMismatchCount += CheckTree(vctViews);
+
+    // The removed views keep their parent, they are queried before and after the parent moves.
+    vector<BOOL> vctRemoved(vctViews.size(), FALSE);
+    vector<SdkViewLayout*> vctOldParents;
+    for (size_t i = 1; i < vctViews.size(); ++i)
+    {
+        if (50 == i % 97)
+        {
+            SdkViewLayout *pParent = vctViews[i]->GetParent();
+            pParent->RemoveChild(vctViews[i], TRUE);
+            vctOldParents.push_back(pParent);
+            vctRemoved[i] = TRUE;
+        }
+    }
+
+    uMismatchCount += CheckTree(vctViews);
+    for (size_t i = 0; i < vctOldParents.size(); ++i)
+    {
+        vctOldParents[i]->SetViewPos(vctOldParents[i]->GetLeft() + 3.0f, vctOldParents[i]->GetTop() + 2.0f);
+    }
+    uMismatchCount += CheckTree(vctViews);
+
+    // AddView sets the new parent of the moved views. The first child of the root is not below
+    // any of them, so no loop is made.
+    SdkViewLayout *pNewParent = vctViews[1];
+    for (size_t i = 2; i < vctViews.size(); ++i)
+    {
+        if ( (40 == i % 89) && !vctRemoved[i] )
+        {
+            pNewParent->AddView(vctViews[i]);
+        }
+    }
+
+    uMismatchCount += CheckTree(vctViews);
+    TransformTree(vctViews, pAnimations, 2);
+    pRoot->SetViewPos(1.0f, 0.0f);
+    uMismatchCount += CheckTree(vctViews);
+
+    return uMismatchCount;
+}
+
+//////////////////////////////////////////////////////////////////////////
+
+static BOOL RunCase(const VIEWTREEBENCHCASE &benchCase, int nRepeat)
+{
+    BenchView *pRoot = new BenchView();
+    pRoot->SetLayoutInfo(0.0f, 0.0f, 4096.0f, 2160.0f);
+
+    vector<BenchView*> vctViews;
+    vctViews.push_back(pRoot);
+    BuildTree(pRoot, benchCase.uDepth, benchCase.uFanOut, vctViews);
+
+    // The results of the walk and the cache must be the same after every change.
+    BenchAnimation *pAnimations = new BenchAnimation[VIEWTREEBENCH_ANIMATION_COUNT];
+    UINT uMismatchCount = CheckTree(vctViews);
+    uMismatchCount += ChangeTree(pRoot, vctViews, pAnimations);
+
+    FLOAT fSum = 0.0f;
+    double dWalkStart = GetSeconds();
+    for (int n = 0; n < nRepeat; ++n)
+    {
+        for (size_t i = 0; i < vctViews.size(); ++i)
+        {
+            fSum += vctViews[i]->GetWalkedDrawingRect().right;
+        }
+    }
+    double dWalkTime = GetSeconds() - dWalkStart;
+
+    // Moving the root invalidates every view, it is the cost of the first frame after layout.
+    double dRebuildStart = GetSeconds();
+    for (int n = 0; n < nRepeat; ++n)
+    {
+        pRoot->SetViewPos((FLOAT)((n & 1) + 1), 0.0f);
+        for (size_t i = 0; i < vctViews.size(); ++i)
+        {
+            fSum += vctViews[i]->GetDrawingRect().right;
+        }
+    }
+    double dRebuildTime = GetSeconds() - dRebuildStart;
+
+    double dCachedStart = GetSeconds();
+    for (int n = 0; n < nRepeat; ++n)
+    {
+        for (size_t i = 0; i < vctViews.size(); ++i)
+        {
+            fSum += vctViews[i]->GetDrawingRect().right;
+        }
+    }
+    double dCachedTime = GetSeconds() - dCachedStart;
+
+    double dQueries = (double)vctViews.size() * nRepeat;
+    printf("%-24s %8u views  walk %8.1f ns  rebuild %8.1f ns  cached %8.1f ns  %6.1fx  ",
+        benchCase.pszName, (UINT)vctViews.size(),
+        dWalkTime * 1e9 / dQueries, dRebuildTime * 1e9 / dQueries, dCachedTime * 1e9 / dQueries,
+        (dCachedTime > 0.0) ? dWalkTime / dCachedTime : 0.0);
+    if (0 == uMismatchCount)
+    {
+        printf("ok\n");
+    }
+    else
+    {
+        printf("MISMATCH %u\n", uMismatchCount);
+    }
+
+    // Keep the sum, so the queries are not optimized out.
+    if (fSum < 0.0f)
+    {
+        printf("%f\n", fSum);
+    }
+
+    // The root deletes its children, the removed views are deleted by their old parents.
+    delete pRoot;
+    delete [] pAnimations;
+
+    return (0 == uMismatchCount);
+}
+
+//////////////////////////////////////////////////////////////////////////
+
+int _tmain(int argc, _TCHAR* argv[])
+{
+    int nRepeat = 20;
+    for (int i = 1; i < argc; ++i)
+    {
+        if ( (0 == _tcscmp(argv[i], _T("-n"))) && (i + 1 < argc) )
+        {
+            nRepeat = _ttoi(argv[++i]);
+            nRepeat = (nRepeat > 0) ? nRepeat : 1;
+        }
+    }
+
+    // The animations create the animation manager.
+    CoInitialize(NULL);
+
+    const VIEWTREEBENCHCASE cases[] =
+    {
+        { "deep 16",            16,     1 },
+        { "deep 64",            64,     1 },
+        { "deep 256",           256,    1 },
+        { "wide 10000",         1,      10000 },
+        { "deep and wide 8^4",  4,      8 },
+        { "deep and wide 4^7",  7,      4 },
+    };
+
+    int nFailCount = 0;
+    for (size_t i = 0; i < sizeof(cases) / sizeof(cases[0]); ++i)
+    {
+        nFailCount += RunCase(cases[i], nRepeat) ? 0 : 1;
+    }
+
+    CoUninitialize();
+
+    return (0 == nFailCount) ? 0 : 1;
+}